@@ -79,6 +79,7 @@ SELECT add_compression_policy('sensor_readings', INTERVAL '7 days', if_not_exist
 
 -- 保留策略 (可选: 90天后删除原始数据)
 -- SELECT add_retention_policy('sensor_readings', INTERVAL '90 days', if_not_exists => TRUE);
+-- 注: 控制服务启动时按 config local.storage 重新设置压缩 / 保留策略 (db/timeseries_storage.cpp)
 
 -- ============================================================
 -- 传感器数据连续聚合视图 (每分钟统计)
@@ -167,7 +168,8 @@ CREATE TABLE IF NOT EXISTS weight_samples (
     phase       TEXT,                       -- 阶段: drain, wait_empty, inject, wait_stable
     weight      REAL NOT NULL,              -- 重量 (g)
     is_stable   BOOLEAN DEFAULT FALSE,      -- 是否稳定
-    trend       TEXT                        -- 趋势: stable, increasing, decreasing
+    trend       TEXT,                       -- 趋势: stable, increasing, decreasing
+    seq         BIGSERIAL                   -- 写入次序, 与 time 组成分页游标 (time, seq)
 );
 
 SELECT create_hypertable('weight_samples', 'time',
@@ -188,6 +190,7 @@ SELECT add_compression_policy('weight_samples', INTERVAL '3 days', if_not_exists
 
 -- 保留策略 (30天后删除)
 SELECT add_retention_policy('weight_samples', INTERVAL '30 days', if_not_exists => TRUE);
+-- 注: 1s / 1min / 1h 连续聚合 (weight_samples_1s/_1m/_1h) 及上述策略由控制服务启动时创建和重设
 
 COMMENT ON TABLE runs IS '实验运行记录';
 COMMENT ON TABLE test_results IS '进样测试结果';
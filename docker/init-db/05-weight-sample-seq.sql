@@ -0,0 +1,14 @@
+-- ============================================================
+-- 称重样本分页游标
+-- GetWeightSamples / StreamWeightSamples 按 (time, seq) keyset 分页,
+-- 同一时刻的多条样本由 seq 区分. 已有数据的 seq 为 NULL, 查询时视为 0.
+-- ============================================================
+CREATE SEQUENCE IF NOT EXISTS weight_samples_seq_seq;
+
+ALTER TABLE weight_samples
+    ADD COLUMN IF NOT EXISTS seq BIGINT;
+
+ALTER TABLE weight_samples
+    ALTER COLUMN seq SET DEFAULT nextval('weight_samples_seq_seq');
+
+COMMENT ON COLUMN weight_samples.seq IS '写入次序, 与 time 组成分页游标';
@@ -0,0 +1,37 @@
+-- ============================================================
+-- 耗材数据变更通知
+-- enose-control 的 ConsumableCache 监听 consumables_changed 频道,
+-- 其他工具 (psql, 迁移脚本等) 直接修改这些表时缓存也会失效.
+-- 语句级触发器: 每条语句只通知一次, payload 为表名.
+-- ============================================================
+CREATE OR REPLACE FUNCTION notify_consumables_changed()
+RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('consumables_changed', TG_TABLE_NAME);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+DO $$
+BEGIN
+    -- liquids
+    IF NOT EXISTS (SELECT 1 FROM pg_trigger WHERE tgname = 'trg_liquids_notify') THEN
+        CREATE TRIGGER trg_liquids_notify
+            AFTER INSERT OR UPDATE OR DELETE ON liquids
+            FOR EACH STATEMENT EXECUTE FUNCTION notify_consumables_changed();
+    END IF;
+    
+    -- pump_assignments
+    IF NOT EXISTS (SELECT 1 FROM pg_trigger WHERE tgname = 'trg_pump_assignments_notify') THEN
+        CREATE TRIGGER trg_pump_assignments_notify
+            AFTER INSERT OR UPDATE OR DELETE ON pump_assignments
+            FOR EACH STATEMENT EXECUTE FUNCTION notify_consumables_changed();
+    END IF;
+    
+    -- consumables
+    IF NOT EXISTS (SELECT 1 FROM pg_trigger WHERE tgname = 'trg_consumables_notify') THEN
+        CREATE TRIGGER trg_consumables_notify
+            AFTER INSERT OR UPDATE OR DELETE ON consumables
+            FOR EACH STATEMENT EXECUTE FUNCTION notify_consumables_changed();
+    END IF;
+END $$;
@@ -0,0 +1,26 @@
+-- ============================================================
+-- 实验队列
+-- ExperimentService 按 priority DESC, id 顺序依次取出 queued 项执行;
+-- 程序以 protobuf JSON 形式保存, 出队时重新验证 (液体余量等可能已变化).
+-- ============================================================
+CREATE TABLE IF NOT EXISTS experiment_queue (
+    id                   BIGSERIAL PRIMARY KEY,
+    created_at           TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+    started_at           TIMESTAMPTZ,
+    completed_at         TIMESTAMPTZ,
+    priority             INTEGER NOT NULL DEFAULT 0,
+    name                 TEXT NOT NULL,
+    program_id           TEXT NOT NULL,
+    program              JSONB NOT NULL,
+    -- queued, running, completed, error, aborted, cancelled, rejected
+    state                TEXT NOT NULL DEFAULT 'queued',
+    run_id               INTEGER REFERENCES runs(id) ON DELETE SET NULL,
+    estimated_duration_s DOUBLE PRECISION NOT NULL DEFAULT 0,
+    error_message        TEXT
+);
+
+-- 只索引等待中的项: 取下一项和列出队列都走这个部分索引
+CREATE INDEX IF NOT EXISTS idx_experiment_queue_pending
+    ON experiment_queue (priority DESC, id) WHERE state = 'queued';
+CREATE INDEX IF NOT EXISTS idx_experiment_queue_completed_at
+    ON experiment_queue (completed_at DESC) WHERE completed_at IS NOT NULL;
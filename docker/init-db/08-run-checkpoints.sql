@@ -0,0 +1,11 @@
+-- ============================================================
+-- 实验运行检查点
+-- ExperimentService 在步骤边界把执行计划位置、动态空瓶值和本次消耗量写入 checkpoint;
+-- 进程重启时仍为 running 的记录改为 interrupted, 有检查点的可从最近的安全步骤续跑.
+-- config_json.program 保存完整程序 (protobuf JSON), 续跑时重新编译.
+-- ============================================================
+ALTER TABLE runs ADD COLUMN IF NOT EXISTS checkpoint JSONB;
+ALTER TABLE runs ADD COLUMN IF NOT EXISTS checkpoint_at TIMESTAMPTZ;
+
+CREATE INDEX IF NOT EXISTS idx_runs_interrupted
+    ON runs (created_at DESC) WHERE state = 'interrupted';
@@ -0,0 +1,21 @@
+-- ============================================================
+-- 传感器基线与漂移校正
+-- 控制服务在基线阶段 (PhaseMarker) 按 (传感器, 加热步) 跟踪基线, 定期 upsert 到 sensor_baselines,
+-- 重启后读回继续校正. reference 为通道预热完成时的基线, 校正值 = 读数 × reference / baseline
+-- (PID: 读数 - (baseline - reference)).
+-- sensor_readings.channels_corrected 与 channels 同布局, 保存写入时的校正值;
+-- 由本地记录日志补传的行为 NULL.
+-- ============================================================
+CREATE TABLE IF NOT EXISTS sensor_baselines (
+    device_id       TEXT NOT NULL,
+    sensor_type     TEXT NOT NULL,                  -- mox_d / mox_a / pid
+    sensor_idx      SMALLINT NOT NULL,
+    heater_step     SMALLINT NOT NULL,
+    baseline        DOUBLE PRECISION NOT NULL,
+    reference       DOUBLE PRECISION NOT NULL DEFAULT 0,
+    samples         BIGINT NOT NULL DEFAULT 0,
+    updated_at      TIMESTAMPTZ NOT NULL DEFAULT NOW(),
+    PRIMARY KEY (device_id, sensor_type, sensor_idx, heater_step)
+);
+
+ALTER TABLE sensor_readings ADD COLUMN IF NOT EXISTS channels_corrected BYTEA;
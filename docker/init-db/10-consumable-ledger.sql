@@ -0,0 +1,12 @@
+-- ============================================================
+-- 耗材消耗批次去重
+-- enose-control 的 ConsumableLedger 在内存中累计泵液体消耗和耗材运行时间,
+-- 按步骤边界 / 定时以一个事务批量提交. 每批的 ID 与累计值一起写在本地日志中,
+-- 提交后崩溃、重启重放同一批时据此跳过, 消耗量不会重复累加.
+-- ============================================================
+CREATE TABLE IF NOT EXISTS consumable_ledger_batches (
+    batch_id        TEXT PRIMARY KEY,
+    applied_at      TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+COMMENT ON TABLE consumable_ledger_batches IS '已提交的耗材消耗批次 (ConsumableLedger 重放去重)';
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/** @brief count 条连续序号的 MOX 读数 (8 通道轮转) */
+std::vector<hal::SensorSample> make_samples(std::size_t count);
+
+/**
+ * @brief 在 connection_string 指向的数据库里建临时 schema enose_bench 并注册数据库用例
+ *
+ * 写入只落在 enose_bench.weight_samples, 不触碰生产表. 连接或建表失败时不注册, 返回 false
+ */
+bool setup_database_benchmarks(const std::string& connection_string);
+
+/** @brief 删除 enose_bench schema (setup 成功后调用) */
+void teardown_database_benchmarks();
+
+} // namespace bench
@@ -0,0 +1,109 @@
+#include "bench/bench_common.hpp"
+#include "db/connection_pool.hpp"
+#include "db/test_run_repository.hpp"
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <pqxx/pqxx>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+constexpr const char* SCRATCH_SCHEMA = "enose_bench";
+
+std::string scratch_connection;
+
+// 与 init-db 的 weight_samples 相同的列和超表设置, 不带指向 runs 的外键
+void create_scratch_schema(pqxx::connection& conn) {
+    pqxx::work txn(conn);
+    txn.exec(std::string("DROP SCHEMA IF EXISTS ") + SCRATCH_SCHEMA + " CASCADE");
+    txn.exec(std::string("CREATE SCHEMA ") + SCRATCH_SCHEMA);
+    txn.exec(std::string("CREATE TABLE ") + SCRATCH_SCHEMA + ".weight_samples ("
+             "time TIMESTAMPTZ NOT NULL, run_id INTEGER, cycle INTEGER, phase TEXT, "
+             "weight REAL NOT NULL, is_stable BOOLEAN DEFAULT FALSE, trend TEXT, seq BIGSERIAL)");
+    txn.exec(std::string("CREATE INDEX ON ") + SCRATCH_SCHEMA + ".weight_samples (run_id, time DESC)");
+    txn.exec(std::string("CREATE INDEX ON ") + SCRATCH_SCHEMA + ".weight_samples (run_id, cycle)");
+    txn.commit();
+
+    // 没有 TimescaleDB 扩展时退化为普通表
+    try {
+        pqxx::work hyper(conn);
+        hyper.exec(std::string("SELECT create_hypertable('") + SCRATCH_SCHEMA + ".weight_samples', 'time', "
+                   "chunk_time_interval => INTERVAL '1 hour')");
+        hyper.commit();
+    } catch (const std::exception& e) {
+        spdlog::warn("Bench: weight_samples is a plain table ({})", e.what());
+    }
+}
+
+/**
+ * TestRunRepository::insert_weight_samples (WeightSampleWriter 的批量路径): 从连接池取连接,
+ * 一批一个事务 COPY 后提交. 连接池的 search_path 以 enose_bench 优先, weight_samples 落在临时表.
+ * 参数为每批行数
+ */
+void BM_InsertWeightSamples(benchmark::State& state) {
+    const auto rows = static_cast<std::size_t>(state.range(0));
+    db::TestRunRepository repository;
+    std::vector<db::WeightSampleRecord> samples(rows);
+    int cycle = 0;
+    for (auto _ : state) {
+        const auto now = std::chrono::system_clock::now();
+        ++cycle;
+        for (std::size_t r = 0; r < rows; ++r) {
+            auto& s = samples[r];
+            s.time = now + std::chrono::microseconds(r);
+            s.run_id = 1;
+            s.cycle = cycle;
+            s.phase = "inject";
+            s.weight = 320.0f + static_cast<float>(r % 50) * 0.1f;
+            s.is_stable = (r % 4) == 0;
+            s.trend = "increasing";
+        }
+        if (!repository.insert_weight_samples(samples)) {
+            state.SkipWithError("insert_weight_samples failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rows));
+}
+
+} // namespace
+
+bool setup_database_benchmarks(const std::string& connection_string) {
+    try {
+        pqxx::connection conn(connection_string);
+        create_scratch_schema(conn);
+    } catch (const std::exception& e) {
+        spdlog::warn("Bench: Skipping database benchmarks: {}", e.what());
+        return false;
+    }
+
+    // 其余表 (预处理语句引用) 仍从 public 解析, 只读不写
+    scratch_connection = connection_string + " options='-c search_path=" + SCRATCH_SCHEMA + ",public'";
+    if (!db::ConnectionPool::instance().initialize(scratch_connection, 1)) {
+        spdlog::warn("Bench: Skipping database benchmarks: connection pool failed to initialize");
+        teardown_database_benchmarks();
+        return false;
+    }
+
+    benchmark::RegisterBenchmark("BM_InsertWeightSamples", BM_InsertWeightSamples)
+        ->Arg(256)->Arg(4096)->UseRealTime();
+    return true;
+}
+
+void teardown_database_benchmarks() {
+    db::ConnectionPool::instance().shutdown();
+    try {
+        pqxx::connection conn(scratch_connection);
+        pqxx::work txn(conn);
+        txn.exec(std::string("DROP SCHEMA IF EXISTS ") + SCRATCH_SCHEMA + " CASCADE");
+        txn.commit();
+    } catch (const std::exception& e) {
+        spdlog::warn("Bench: Failed to drop schema {}: {}", SCRATCH_SCHEMA, e.what());
+    }
+}
+
+} // namespace bench
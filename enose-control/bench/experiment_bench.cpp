@@ -0,0 +1,99 @@
+#include "workflows/yaml_parser.hpp"
+#include "workflows/experiment_validator.hpp"
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <string>
+
+namespace bench {
+
+namespace {
+
+/**
+ * @brief 生成 groups 组 [进样 → 采集 → 排废 → 清洗] 的平铺实验程序
+ */
+std::string make_program_yaml(std::size_t groups) {
+    std::string yaml =
+        "id: bench_program\n"
+        "name: bench\n"
+        "version: 1.0.0\n"
+        "hardware:\n"
+        "  bottle_capacity_ml: 150\n"
+        "  max_fill_ml: 100\n"
+        "  liquids:\n"
+        "    - id: sample_a\n"
+        "      name: A\n"
+        "      pump_index: 0\n"
+        "      available_ml: 100000\n"
+        "      type: LIQUID_SAMPLE\n"
+        "    - id: sample_b\n"
+        "      name: B\n"
+        "      pump_index: 1\n"
+        "      available_ml: 100000\n"
+        "      type: LIQUID_SAMPLE\n"
+        "    - id: water\n"
+        "      name: water\n"
+        "      pump_index: 2\n"
+        "      available_ml: 100000\n"
+        "      type: LIQUID_RINSE\n"
+        "steps:\n";
+    for (std::size_t i = 0; i < groups; ++i) {
+        yaml += fmt::format(
+            "  - name: inject_{0}\n"
+            "    inject:\n"
+            "      components:\n"
+            "        - liquid_id: sample_a\n"
+            "          ratio: {1}\n"
+            "        - liquid_id: sample_b\n"
+            "          ratio: {2}\n"
+            "      target_volume_ml: 15\n"
+            "      tolerance: 0.5\n"
+            "      flow_rate_ml_min: 5\n"
+            "  - name: acquire_{0}\n"
+            "    acquire:\n"
+            "      gas_pump_pwm: 60\n"
+            "      duration_s: 30\n"
+            "      max_duration_s: 60\n"
+            "  - name: drain_{0}\n"
+            "    drain:\n"
+            "      gas_pump_pwm: 80\n"
+            "      timeout_s: 60\n"
+            "  - name: wash_{0}\n"
+            "    wash:\n"
+            "      wash_volume_ml: 20\n"
+            "      repeat_count: 1\n",
+            i, 1 + i % 3, 3 - i % 3);
+    }
+    return yaml;
+}
+
+// 参数为加热组数; 64 组 = 256 步, 1024 组 = 4096 步 (超过 PARALLEL_MIN_STEPS, 验证走分段并行)
+void BM_ExperimentParse(benchmark::State& state) {
+    const auto groups = static_cast<std::size_t>(state.range(0));
+    const std::string yaml = make_program_yaml(groups);
+    for (auto _ : state) {
+        auto result = enose::workflows::YamlParser::parse(yaml);
+        benchmark::DoNotOptimize(result.success);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * groups * 4));
+}
+BENCHMARK(BM_ExperimentParse)->Arg(64)->Arg(1024);
+
+void BM_ExperimentValidate(benchmark::State& state) {
+    const auto groups = static_cast<std::size_t>(state.range(0));
+    auto parsed = enose::workflows::YamlParser::parse(make_program_yaml(groups));
+    if (!parsed.success) {
+        state.SkipWithError(("generated program does not parse: " + parsed.error_message).c_str());
+        return;
+    }
+    enose::workflows::ExperimentValidator validator;
+    for (auto _ : state) {
+        auto result = validator.validate(parsed.program);
+        benchmark::DoNotOptimize(result.valid);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * groups * 4));
+}
+BENCHMARK(BM_ExperimentValidate)->Arg(64)->Arg(1024);
+
+} // namespace
+
+} // namespace bench
@@ -0,0 +1,50 @@
+#include "hal/actuator_driver.hpp"
+#include "hal/load_cell_driver.hpp"
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <memory>
+
+namespace bench {
+
+namespace {
+
+/**
+ * Moonraker notify_status_update → LoadCellDriver (滤波, 统计, 溢出判定, 排废/等待判定).
+ *
+ * ActuatorDriver 不连接 Moonraker, 由基准直接发出它的 on_status_update; 每次迭代在 io 线程上
+ * 执行驱动投递到自己 strand 的处理, 与运行时的路径相同. 参数: 0 = 滑动平均, 1 = 卡尔曼
+ */
+void BM_LoadCellUpdate(benchmark::State& state) {
+    boost::asio::io_context io;
+    auto work = boost::asio::make_work_guard(io);
+    auto actuator = std::make_shared<hal::ActuatorDriver>(io);
+
+    hal::LoadCellConfig config;
+    config.filter_mode = state.range(0) ? hal::WeightFilterMode::KALMAN : hal::WeightFilterMode::MOVING_AVERAGE;
+    auto driver = std::make_shared<hal::LoadCellDriver>(io, actuator, config);
+    driver->start();
+    io.poll();
+
+    nlohmann::json status = {{"load_cell " + config.name, {{"raw_sample", 0.1}, {"force_g", 320.0}}}};
+    auto& force = status.begin().value()["force_g"];
+    std::size_t i = 0;
+    for (auto _ : state) {
+        force = 320.0 + 0.25 * static_cast<double>(i++ % 16);
+        actuator->on_status_update(status);
+        io.poll();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    benchmark::DoNotOptimize(driver->get_filtered_weight());
+
+    driver->stop();
+    io.poll();
+    driver.reset();
+    work.reset();
+    io.run();
+}
+BENCHMARK(BM_LoadCellUpdate)->Arg(0)->Arg(1);
+
+} // namespace
+
+} // namespace bench
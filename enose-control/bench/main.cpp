@@ -0,0 +1,38 @@
+/**
+ * enose-bench: 主机热路径微基准 (Google Benchmark)
+ *
+ * 直接链接 enose-control 的实现 (enose_core), 测的是生产代码本身:
+ * 传感器数据行/二进制帧解码, SensorServiceImpl 向 gRPC 订阅者扇出, LoadCellDriver 的
+ * 推送处理, 采集稳定性判定 (与改动前的整窗扫描对比), 实验程序解析与验证, 称重样本批量 COPY.
+ *
+ * 用法: enose-bench [--benchmark_filter=...] [--benchmark_out=result.json --benchmark_out_format=json]
+ * 设置 ENOSE_BENCH_DB (libpq 连接字符串) 时运行数据库用例, 写入临时 schema enose_bench, 结束后删除.
+ * 结果用 Google Benchmark 的 tools/compare.py 比较两个版本.
+ */
+
+#include "bench/bench_common.hpp"
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <cstdlib>
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    spdlog::set_level(spdlog::level::warn);
+    const char* db = std::getenv("ENOSE_BENCH_DB");
+    const bool database = db && *db && bench::setup_database_benchmarks(db);
+
+    // 被测代码的日志 (驱动启动信息, 验证警告) 会主导耗时, 计时期间关闭
+    spdlog::set_level(spdlog::level::off);
+    benchmark::RunSpecifiedBenchmarks();
+    spdlog::set_level(spdlog::level::warn);
+
+    if (database) {
+        bench::teardown_database_benchmarks();
+    }
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "bench/bench_common.hpp"
+#include "hal/sensor_driver.hpp"
+#include "hal/sensor_frame.hpp"
+#include "grpc/sensor_service_impl.hpp"
+#include "enose_service.grpc.pb.h"
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+#include <fmt/format.h>
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+std::vector<hal::SensorSample> make_samples(std::size_t count) {
+    std::vector<hal::SensorSample> samples(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto& s = samples[i];
+        s.seq = static_cast<uint32_t>(1000 + i);
+        s.tick_ms = static_cast<uint32_t>(123456 + i * 17);
+        s.sensor_idx = static_cast<uint8_t>(i % 8);
+        s.sensor_id = 0x1000u + static_cast<uint32_t>(i % 8);
+        s.value = 152340.5f + static_cast<float>(i);
+        s.temperature = 25.31f;
+        s.humidity = 41.27f;
+        s.pressure = 1009.84f;
+        s.heater_step = 3;
+        s.type = hal::SensorType::MOX_DIGITAL;
+    }
+    return samples;
+}
+
+namespace {
+
+// 固件 JSON 数据行 (格式同 DataReporter / SensorBoardSim)
+std::string make_data_line(const hal::SensorSample& s) {
+    return fmt::format(
+        R"({{"type":"data","seq":{},"tick":{},"s":{},"id":{},"v":{:.1f},"st":"mox_d","gi":{},"T":{:.2f},"H":{:.2f},"P":{:.2f}}})",
+        s.seq, s.tick_ms, s.sensor_idx, s.sensor_id, s.value, s.heater_step,
+        s.temperature, s.humidity, s.pressure);
+}
+
+// SensorDriver::handle_line 的解码 (快速路径, 不构建 DOM)
+void BM_SensorLineParse(benchmark::State& state) {
+    const std::string line = make_data_line(make_samples(1).front());
+    hal::SensorSample out;
+    for (auto _ : state) {
+        auto kind = hal::sensor_frame::parse_data_line(line, out);
+        benchmark::DoNotOptimize(kind);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_SensorLineParse);
+
+// SensorDriver::handle_frame 的解码; 参数为帧内读数数 (1 = 单条帧, 8 = 批量帧)
+void BM_SensorFrameDecode(benchmark::State& state) {
+    const auto count = static_cast<std::size_t>(state.range(0));
+    auto samples = make_samples(count);
+    const std::string encoded = hal::sensor_frame::encode_frame(samples.data(), count, count > 1);
+    // 去掉前后的 0x00 分隔符, 与驱动交给 decode_frame 的输入相同
+    const std::vector<uint8_t> frame(encoded.begin() + 1, encoded.end() - 1);
+    hal::SensorSample out[hal::sensor_frame::MAX_FRAME_SAMPLES];
+    for (auto _ : state) {
+        auto decoded = hal::sensor_frame::decode_frame(frame.data(), frame.size(), out);
+        benchmark::DoNotOptimize(decoded);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_SensorFrameDecode)->Arg(1)->Arg(8);
+
+/**
+ * SensorDriver::on_readings → SensorServiceImpl::on_sensor_readings → 各 SubscribeSensorReadings 流.
+ *
+ * 服务注册到进程内 gRPC 服务器, 订阅者是经 InProcessChannel 连接的真实客户端 (各一个读线程);
+ * 计时的是驱动 strand 上的分发 (转换 + 入队), 写出由服务的 reactor 异步完成.
+ * 参数为订阅者数, 每次迭代分发一个 8 读数的批量帧.
+ */
+void BM_SensorFanOut(benchmark::State& state) {
+    const auto subscribers = static_cast<std::size_t>(state.range(0));
+    boost::asio::io_context io;
+    auto sensor = std::make_shared<hal::SensorDriver>(io);
+    enose_grpc::SensorServiceImpl service(sensor);
+
+    ::grpc::ServerBuilder builder;
+    builder.RegisterService(&service);
+    auto server = builder.BuildAndStart();
+    if (!server) {
+        state.SkipWithError("in-process gRPC server failed to start");
+        return;
+    }
+    auto stub = ::enose::service::SensorService::NewStub(server->InProcessChannel({}));
+
+    std::vector<std::unique_ptr<::grpc::ClientContext>> contexts;
+    std::vector<std::thread> readers;
+    std::atomic<std::size_t> streaming{0};
+    std::atomic<uint64_t> delivered{0};
+    for (std::size_t i = 0; i < subscribers; ++i) {
+        contexts.push_back(std::make_unique<::grpc::ClientContext>());
+        readers.emplace_back([&, ctx = contexts.back().get()]() {
+            ::enose::service::SubscribeSensorReadingsRequest request;
+            auto reader = stub->SubscribeSensorReadings(ctx, request);
+            ::enose::service::SensorReading reading;
+            bool first = true;
+            while (reader->Read(&reading)) {
+                if (first) {
+                    streaming.fetch_add(1);
+                    first = false;
+                }
+                delivered.fetch_add(1, std::memory_order_relaxed);
+            }
+            reader->Finish();
+        });
+    }
+
+    const auto samples = make_samples(8);
+    const std::span<const hal::SensorSample> frame(samples);
+    // 订阅在 reactor 上异步建立: 分发到所有订阅者都收到第一条后再开始计时
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (streaming.load() < subscribers && std::chrono::steady_clock::now() < deadline) {
+        sensor->on_readings(frame);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (streaming.load() < subscribers) {
+        state.SkipWithError("subscribers did not start streaming");
+    } else {
+        const uint64_t delivered_before = delivered.load();
+        for (auto _ : state) {
+            sensor->on_readings(frame);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * samples.size()));
+        // 计时结束时已写到客户端的读数 (其余在队列中或按溢出策略丢弃)
+        state.counters["delivered"] = benchmark::Counter(
+            static_cast<double>(delivered.load() - delivered_before), benchmark::Counter::kIsRate);
+    }
+
+    for (auto& ctx : contexts) {
+        ctx->TryCancel();
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+}
+BENCHMARK(BM_SensorFanOut)->Arg(1)->Arg(8)->Arg(64)->UseRealTime();
+
+} // namespace
+
+} // namespace bench
@@ -0,0 +1,87 @@
+#include "hal/sensor_sample.hpp"
+#include "hal/stability_detector.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace bench {
+
+namespace {
+
+// 8 个 MOX 传感器 × 10 个加热步, 每 10ms 一条读数 (与 heater_cycle_estimate_s 的量级一致);
+// 数值在各通道自己的基线上小幅波动, 检测器不会提前判稳
+std::vector<hal::SensorSample> make_stream(std::size_t count) {
+    std::vector<hal::SensorSample> samples(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto& s = samples[i];
+        s.seq = static_cast<uint32_t>(i);
+        s.tick_ms = static_cast<uint32_t>(i * 10);
+        s.sensor_idx = static_cast<uint8_t>(i % 8);
+        s.heater_step = static_cast<uint8_t>((i / 8) % 10);
+        s.type = hal::SensorType::MOX_DIGITAL;
+        const double baseline = 100000.0 + 5000.0 * s.sensor_idx + 800.0 * s.heater_step;
+        s.value = static_cast<float>(baseline * (1.0 + 0.05 * std::sin(static_cast<double>(i) * 0.013)));
+    }
+    return samples;
+}
+
+constexpr std::size_t STREAM_SAMPLES = 1 << 16;
+
+/**
+ * 改动前 ExperimentServiceImpl::wait_for_sensor_stability 的判定: 所有通道混在一个 deque,
+ * 按 "约 10Hz" 保留 window_s × 10 条, 每条读数对整个窗口求 min/max (O(窗口)).
+ * 参数为窗口秒数
+ */
+void BM_StabilityBefore(benchmark::State& state) {
+    const double window_s = static_cast<double>(state.range(0));
+    const auto samples = make_stream(STREAM_SAMPLES);
+    const auto keep = static_cast<std::size_t>(window_s * 10);
+    std::deque<double> readings;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        readings.push_back(samples[i++ % samples.size()].value);
+        while (readings.size() > 1 && readings.size() > keep) {
+            readings.pop_front();
+        }
+        bool stable = false;
+        if (readings.size() >= 10) {
+            const double min_val = *std::min_element(readings.begin(), readings.end());
+            const double max_val = *std::max_element(readings.begin(), readings.end());
+            const double mean_val = (min_val + max_val) / 2.0;
+            stable = mean_val > 0 && ((max_val - min_val) / mean_val) * 100.0 <= 1.0;
+        }
+        benchmark::DoNotOptimize(stable);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_StabilityBefore)->Arg(10)->Arg(60);
+
+/**
+ * hal::StabilityDetector: 按 (类型, 传感器, 加热步) 分 80 个通道, 每通道单调队列维护
+ * min/max, 每条读数摊还 O(1); 窗口按设备时间而不是按条数. 参数为窗口秒数
+ */
+void BM_StabilityDetector(benchmark::State& state) {
+    const auto window_ms = static_cast<uint32_t>(state.range(0) * 1000);
+    const auto samples = make_stream(STREAM_SAMPLES);
+    hal::StabilityDetector detector(window_ms, 1.0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        // 流回绕时设备时间继续前进, 避免窗口因时间倒退被清空
+        const std::size_t n = i++;
+        auto sample = samples[n % samples.size()];
+        sample.tick_ms = static_cast<uint32_t>(n * 10);
+        detector.push(sample);
+        benchmark::DoNotOptimize(detector.stable());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.counters["channels"] = static_cast<double>(detector.active_channels());
+}
+BENCHMARK(BM_StabilityDetector)->Arg(10)->Arg(60);
+
+} // namespace
+
+} // namespace bench
@@ -0,0 +1,32 @@
+from conan import ConanFile
+
+
+class EnoseControlConan(ConanFile):
+    settings = "os", "compiler", "build_type", "arch"
+    generators = "CMakeDeps", "CMakeToolchain"
+
+    # 可选: Arrow / Parquet 列式导出 (ExportService.ExportRun), 默认不构建 Arrow 与 Thrift
+    # 启用: conan install . -o "&:with_arrow=True"
+    # 可选: enose-bench 微基准 (cmake -DENOSE_BUILD_BENCH=ON)
+    # 启用: conan install . -o "&:with_benchmark=True"
+    options = {"with_arrow": [True, False], "with_benchmark": [True, False]}
+    default_options = {"with_arrow": False, "with_benchmark": False}
+
+    def requirements(self):
+        self.requires("boost/1.83.0")
+        self.requires("fmt/10.2.1")
+        self.requires("spdlog/1.13.0")
+        self.requires("nlohmann_json/3.11.3")
+        self.requires("grpc/1.54.3")
+        self.requires("protobuf/3.21.12")
+        self.requires("yaml-cpp/0.8.0")
+        # libpqxx 使用系统包 (apt install libpqxx-dev:arm64)
+        if self.options.with_arrow:
+            self.requires("arrow/14.0.2")
+        if self.options.with_benchmark:
+            self.requires("benchmark/1.8.3")
+
+    def configure(self):
+        if self.options.with_arrow:
+            self.options["arrow"].parquet = True
+            self.options["arrow"].with_zstd = True
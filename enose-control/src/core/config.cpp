@@ -1,6 +1,10 @@
 #include "config.hpp"
+#include <algorithm>
 #include <fstream>
+#include <set>
+#include <sstream>
 #include <spdlog/spdlog.h>
+#include <yaml-cpp/yaml.h>
 
 namespace core {
 
@@ -14,6 +18,7 @@ void from_json(const nlohmann::json& j, DatabaseConfig& c) {
     if (j.contains("password")) j.at("password").get_to(c.password);
     if (j.contains("ssl_mode")) j.at("ssl_mode").get_to(c.ssl_mode);
     if (j.contains("pool_size")) j.at("pool_size").get_to(c.pool_size);
+    if (j.contains("min_pool_size")) j.at("min_pool_size").get_to(c.min_pool_size);
     if (j.contains("connect_timeout_sec")) j.at("connect_timeout_sec").get_to(c.connect_timeout_sec);
 }
 
@@ -32,9 +37,55 @@ void from_json(const nlohmann::json& j, GpuWorkerConfig& c) {
     if (j.contains("api_path")) j.at("api_path").get_to(c.api_path);
 }
 
+void from_json(const nlohmann::json& j, JournalConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("directory")) j.at("directory").get_to(c.directory);
+    if (j.contains("segment_size_mb")) j.at("segment_size_mb").get_to(c.segment_size_mb);
+    if (j.contains("max_total_mb")) j.at("max_total_mb").get_to(c.max_total_mb);
+    if (j.contains("upload_interval_sec")) j.at("upload_interval_sec").get_to(c.upload_interval_sec);
+}
+
+void from_json(const nlohmann::json& j, StorageConfig& c) {
+    if (j.contains("manage")) j.at("manage").get_to(c.manage);
+    if (j.contains("sensor_compress_after_days")) j.at("sensor_compress_after_days").get_to(c.sensor_compress_after_days);
+    if (j.contains("sensor_retention_days")) j.at("sensor_retention_days").get_to(c.sensor_retention_days);
+    if (j.contains("weight_compress_after_days")) j.at("weight_compress_after_days").get_to(c.weight_compress_after_days);
+    if (j.contains("weight_retention_days")) j.at("weight_retention_days").get_to(c.weight_retention_days);
+    if (j.contains("aggregate_1s_retention_days")) j.at("aggregate_1s_retention_days").get_to(c.aggregate_1s_retention_days);
+    if (j.contains("aggregate_1m_retention_days")) j.at("aggregate_1m_retention_days").get_to(c.aggregate_1m_retention_days);
+    if (j.contains("aggregate_1h_retention_days")) j.at("aggregate_1h_retention_days").get_to(c.aggregate_1h_retention_days);
+}
+
+void from_json(const nlohmann::json& j, ExportConfig& c) {
+    if (j.contains("directory")) j.at("directory").get_to(c.directory);
+    if (j.contains("batch_rows")) j.at("batch_rows").get_to(c.batch_rows);
+    if (j.contains("parquet_compression")) j.at("parquet_compression").get_to(c.parquet_compression);
+    if (j.contains("parquet_row_group_rows")) j.at("parquet_row_group_rows").get_to(c.parquet_row_group_rows);
+}
+
+void from_json(const nlohmann::json& j, ArchiveConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("directory")) j.at("directory").get_to(c.directory);
+    if (j.contains("settle_sec")) j.at("settle_sec").get_to(c.settle_sec);
+    if (j.contains("retry_interval_sec")) j.at("retry_interval_sec").get_to(c.retry_interval_sec);
+    if (j.contains("backfill_runs")) j.at("backfill_runs").get_to(c.backfill_runs);
+    if (j.contains("max_open")) j.at("max_open").get_to(c.max_open);
+}
+
+void from_json(const nlohmann::json& j, LedgerConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("directory")) j.at("directory").get_to(c.directory);
+    if (j.contains("flush_interval_ms")) j.at("flush_interval_ms").get_to(c.flush_interval_ms);
+}
+
 void from_json(const nlohmann::json& j, LocalConfig& c) {
     if (j.contains("timescaledb")) j.at("timescaledb").get_to(c.timescaledb);
     if (j.contains("redis")) j.at("redis").get_to(c.redis);
+    if (j.contains("journal")) j.at("journal").get_to(c.journal);
+    if (j.contains("storage")) j.at("storage").get_to(c.storage);
+    if (j.contains("exports")) j.at("exports").get_to(c.exports);
+    if (j.contains("archive")) j.at("archive").get_to(c.archive);
+    if (j.contains("ledger")) j.at("ledger").get_to(c.ledger);
 }
 
 void from_json(const nlohmann::json& j, CloudConfig& c) {
@@ -48,16 +99,74 @@ void from_json(const nlohmann::json& j, LanConfig& c) {
     if (j.contains("timescaledb")) j.at("timescaledb").get_to(c.timescaledb);
 }
 
+void from_json(const nlohmann::json& j, GrpcWebConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("host")) j.at("host").get_to(c.host);
+    if (j.contains("port")) j.at("port").get_to(c.port);
+    if (j.contains("flush_interval_ms")) j.at("flush_interval_ms").get_to(c.flush_interval_ms);
+    if (j.contains("max_coalesce_bytes")) j.at("max_coalesce_bytes").get_to(c.max_coalesce_bytes);
+    if (j.contains("allow_origin")) j.at("allow_origin").get_to(c.allow_origin);
+}
+
 void from_json(const nlohmann::json& j, GrpcConfig& c) {
     if (j.contains("host")) j.at("host").get_to(c.host);
     if (j.contains("port")) j.at("port").get_to(c.port);
+    if (j.contains("stream_queue_size")) j.at("stream_queue_size").get_to(c.stream_queue_size);
+    if (j.contains("stream_overflow")) j.at("stream_overflow").get_to(c.stream_overflow);
+    if (j.contains("stream_compression")) j.at("stream_compression").get_to(c.stream_compression);
+    if (j.contains("web")) j.at("web").get_to(c.web);
+}
+
+void from_json(const nlohmann::json& j, SensorBoardConfig& c) {
+    if (j.contains("device_id")) j.at("device_id").get_to(c.device_id);
+    if (j.contains("serial_port")) j.at("serial_port").get_to(c.serial_port);
+    if (j.contains("usb_serial")) j.at("usb_serial").get_to(c.usb_serial);
+    if (j.contains("baud_rate")) j.at("baud_rate").get_to(c.baud_rate);
 }
 
 void from_json(const nlohmann::json& j, SensorConfig& c) {
     if (j.contains("serial_port")) j.at("serial_port").get_to(c.serial_port);
+    if (j.contains("usb_serial")) j.at("usb_serial").get_to(c.usb_serial);
+    if (j.contains("device_id")) j.at("device_id").get_to(c.device_id);
     if (j.contains("baud_rate")) j.at("baud_rate").get_to(c.baud_rate);
     if (j.contains("channels")) j.at("channels").get_to(c.channels);
     if (j.contains("sample_rate_hz")) j.at("sample_rate_hz").get_to(c.sample_rate_hz);
+    if (j.contains("binary_protocol")) j.at("binary_protocol").get_to(c.binary_protocol);
+    if (j.contains("batch_size")) j.at("batch_size").get_to(c.batch_size);
+    if (j.contains("replay_file")) j.at("replay_file").get_to(c.replay_file);
+    if (j.contains("replay_speed")) j.at("replay_speed").get_to(c.replay_speed);
+    if (j.contains("replay_loop")) j.at("replay_loop").get_to(c.replay_loop);
+    if (j.contains("clock_sync_interval_ms")) j.at("clock_sync_interval_ms").get_to(c.clock_sync_interval_ms);
+    if (j.contains("additional_boards")) j.at("additional_boards").get_to(c.additional_boards);
+    if (j.contains("merge_window_ms")) j.at("merge_window_ms").get_to(c.merge_window_ms);
+}
+
+void from_json(const nlohmann::json& j, AnalysisConfig& c) {
+    if (j.contains("baseline_alpha")) j.at("baseline_alpha").get_to(c.baseline_alpha);
+    if (j.contains("noise_threshold")) j.at("noise_threshold").get_to(c.noise_threshold);
+    if (j.contains("baseline_drift_threshold")) j.at("baseline_drift_threshold").get_to(c.baseline_drift_threshold);
+    if (j.contains("saturation_min")) j.at("saturation_min").get_to(c.saturation_min);
+    if (j.contains("saturation_max")) j.at("saturation_max").get_to(c.saturation_max);
+    if (j.contains("humidity_min")) j.at("humidity_min").get_to(c.humidity_min);
+    if (j.contains("humidity_max")) j.at("humidity_max").get_to(c.humidity_max);
+    if (j.contains("temperature_min")) j.at("temperature_min").get_to(c.temperature_min);
+    if (j.contains("temperature_max")) j.at("temperature_max").get_to(c.temperature_max);
+    if (j.contains("baseline_phases")) j.at("baseline_phases").get_to(c.baseline_phases);
+    if (j.contains("drift_alpha")) j.at("drift_alpha").get_to(c.drift_alpha);
+    if (j.contains("drift_clip")) j.at("drift_clip").get_to(c.drift_clip);
+    if (j.contains("drift_warmup_samples")) j.at("drift_warmup_samples").get_to(c.drift_warmup_samples);
+    if (j.contains("baseline_persist_interval_sec")) j.at("baseline_persist_interval_sec").get_to(c.baseline_persist_interval_sec);
+    if (j.contains("fingerprint_steps")) j.at("fingerprint_steps").get_to(c.fingerprint_steps);
+    if (j.contains("fingerprint_sensors")) j.at("fingerprint_sensors").get_to(c.fingerprint_sensors);
+    if (j.contains("fingerprint_max_missing")) j.at("fingerprint_max_missing").get_to(c.fingerprint_max_missing);
+}
+
+void from_json(const nlohmann::json& j, InferenceConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("model_path")) j.at("model_path").get_to(c.model_path);
+    if (j.contains("max_batch")) j.at("max_batch").get_to(c.max_batch);
+    if (j.contains("queue_capacity")) j.at("queue_capacity").get_to(c.queue_capacity);
+    if (j.contains("min_confidence")) j.at("min_confidence").get_to(c.min_confidence);
 }
 
 void from_json(const nlohmann::json& j, ActuatorConfig& c) {
@@ -65,8 +174,50 @@ void from_json(const nlohmann::json& j, ActuatorConfig& c) {
     if (j.contains("moonraker_port")) j.at("moonraker_port").get_to(c.moonraker_port);
 }
 
+void from_json(const nlohmann::json& j, SimFaultConfig& c) {
+    if (j.contains("latency_ms")) j.at("latency_ms").get_to(c.latency_ms);
+    if (j.contains("jitter_ms")) j.at("jitter_ms").get_to(c.jitter_ms);
+    if (j.contains("drop_rate")) j.at("drop_rate").get_to(c.drop_rate);
+    if (j.contains("corrupt_rate")) j.at("corrupt_rate").get_to(c.corrupt_rate);
+    if (j.contains("disconnect_interval_sec")) j.at("disconnect_interval_sec").get_to(c.disconnect_interval_sec);
+}
+
+void from_json(const nlohmann::json& j, SimSensorBoardConfig& c) {
+    if (j.contains("link")) j.at("link").get_to(c.link);
+    if (j.contains("sensors")) j.at("sensors").get_to(c.sensors);
+    if (j.contains("heater_time_base_ms")) j.at("heater_time_base_ms").get_to(c.heater_time_base_ms);
+    if (j.contains("autostart")) j.at("autostart").get_to(c.autostart);
+    if (j.contains("odor_response")) j.at("odor_response").get_to(c.odor_response);
+    if (j.contains("response_tau_sec")) j.at("response_tau_sec").get_to(c.response_tau_sec);
+    if (j.contains("noise")) j.at("noise").get_to(c.noise);
+    if (j.contains("clock_skew_ppm")) j.at("clock_skew_ppm").get_to(c.clock_skew_ppm);
+    if (j.contains("faults")) j.at("faults").get_to(c.faults);
+}
+
+void from_json(const nlohmann::json& j, SimMoonrakerConfig& c) {
+    if (j.contains("host")) j.at("host").get_to(c.host);
+    if (j.contains("port")) j.at("port").get_to(c.port);
+    if (j.contains("status_interval_ms")) j.at("status_interval_ms").get_to(c.status_interval_ms);
+    if (j.contains("grams_per_mm")) j.at("grams_per_mm").get_to(c.grams_per_mm);
+    if (j.contains("empty_bottle_g")) j.at("empty_bottle_g").get_to(c.empty_bottle_g);
+    if (j.contains("invert_reading")) j.at("invert_reading").get_to(c.invert_reading);
+    if (j.contains("noise_g")) j.at("noise_g").get_to(c.noise_g);
+    if (j.contains("drain_rate_g_s")) j.at("drain_rate_g_s").get_to(c.drain_rate_g_s);
+    if (j.contains("clean_rate_g_s")) j.at("clean_rate_g_s").get_to(c.clean_rate_g_s);
+    if (j.contains("restart_ms")) j.at("restart_ms").get_to(c.restart_ms);
+    if (j.contains("faults")) j.at("faults").get_to(c.faults);
+}
+
+void from_json(const nlohmann::json& j, SimulatorConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("seed")) j.at("seed").get_to(c.seed);
+    if (j.contains("sensor_board")) j.at("sensor_board").get_to(c.sensor_board);
+    if (j.contains("moonraker")) j.at("moonraker").get_to(c.moonraker);
+}
+
 void from_json(const nlohmann::json& j, DataPipelineConfig& c) {
     if (j.contains("buffer_size")) j.at("buffer_size").get_to(c.buffer_size);
+    if (j.contains("batch_rows")) j.at("batch_rows").get_to(c.batch_rows);
     if (j.contains("batch_write_interval_ms")) j.at("batch_write_interval_ms").get_to(c.batch_write_interval_ms);
     if (j.contains("redis_stream_name")) j.at("redis_stream_name").get_to(c.redis_stream_name);
     if (j.contains("redis_stream_max_len")) j.at("redis_stream_max_len").get_to(c.redis_stream_max_len);
@@ -80,32 +231,153 @@ void from_json(const nlohmann::json& j, LoggingConfig& c) {
     if (j.contains("max_files")) j.at("max_files").get_to(c.max_files);
 }
 
+void from_json(const nlohmann::json& j, MetricsConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("host")) j.at("host").get_to(c.host);
+    if (j.contains("port")) j.at("port").get_to(c.port);
+}
+
+void from_json(const nlohmann::json& j, RuntimeConfig& c) {
+    if (j.contains("io_threads")) j.at("io_threads").get_to(c.io_threads);
+    if (j.contains("safety_priority")) j.at("safety_priority").get_to(c.safety_priority);
+    if (j.contains("safety_cpu")) j.at("safety_cpu").get_to(c.safety_cpu);
+}
+
+void from_json(const nlohmann::json& j, HotReloadConfig& c) {
+    if (j.contains("enabled")) j.at("enabled").get_to(c.enabled);
+    if (j.contains("yaml_directory")) j.at("yaml_directory").get_to(c.yaml_directory);
+    if (j.contains("debounce_ms")) j.at("debounce_ms").get_to(c.debounce_ms);
+}
+
+void from_json(const nlohmann::json& j, ConfigValues& c) {
+    if (j.contains("local")) j.at("local").get_to(c.local);
+    if (j.contains("cloud")) j.at("cloud").get_to(c.cloud);
+    if (j.contains("lan")) j.at("lan").get_to(c.lan);
+    if (j.contains("grpc")) j.at("grpc").get_to(c.grpc);
+    if (j.contains("sensor")) j.at("sensor").get_to(c.sensor);
+    if (j.contains("analysis")) j.at("analysis").get_to(c.analysis);
+    if (j.contains("inference")) j.at("inference").get_to(c.inference);
+    if (j.contains("actuator")) j.at("actuator").get_to(c.actuator);
+    if (j.contains("simulator")) j.at("simulator").get_to(c.simulator);
+    if (j.contains("data_pipeline")) j.at("data_pipeline").get_to(c.data_pipeline);
+    if (j.contains("logging")) j.at("logging").get_to(c.logging);
+    if (j.contains("metrics")) j.at("metrics").get_to(c.metrics);
+    if (j.contains("runtime")) j.at("runtime").get_to(c.runtime);
+    if (j.contains("hot_reload")) j.at("hot_reload").get_to(c.hot_reload);
+}
+
+namespace {
+
+bool valid_port(int port) {
+    return port > 0 && port <= 65535;
+}
+
+// 相对路径按配置文件所在目录解析
+std::filesystem::path resolve_path(const std::string& config_path, const std::filesystem::path& path) {
+    if (path.is_absolute() || config_path.empty()) return path;
+    return (std::filesystem::path(config_path).parent_path() / path).lexically_normal();
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + path.string());
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+} // namespace
+
+std::vector<std::string> validate_config(const ConfigValues& c) {
+    std::vector<std::string> errors;
+    static const std::set<std::string> levels = {"debug", "info", "warn", "error"};
+    if (!levels.contains(c.logging.level)) {
+        errors.push_back("logging.level must be one of debug/info/warn/error, got \"" + c.logging.level + "\"");
+    }
+    if (!valid_port(c.grpc.port)) errors.push_back("grpc.port out of range");
+    if (c.grpc.stream_queue_size <= 0) errors.push_back("grpc.stream_queue_size must be positive");
+    if (c.grpc.stream_overflow != "drop_oldest" && c.grpc.stream_overflow != "decimate") {
+        errors.push_back("grpc.stream_overflow must be drop_oldest or decimate");
+    }
+    static const std::set<std::string> compression = {"none", "low", "medium", "high"};
+    if (!compression.contains(c.grpc.stream_compression)) {
+        errors.push_back("grpc.stream_compression must be one of none/low/medium/high");
+    }
+    const auto& web = c.grpc.web;
+    if (web.enabled) {
+        if (!valid_port(web.port)) errors.push_back("grpc.web.port out of range");
+        if (web.flush_interval_ms < 0 || web.flush_interval_ms > 1000) errors.push_back("grpc.web.flush_interval_ms must be 0-1000");
+        if (web.max_coalesce_bytes < 1024) errors.push_back("grpc.web.max_coalesce_bytes must be >= 1024");
+    }
+    if (c.metrics.enabled && !valid_port(c.metrics.port)) errors.push_back("metrics.port out of range");
+    if (!valid_port(c.actuator.moonraker_port)) errors.push_back("actuator.moonraker_port out of range");
+    if (c.sensor.baud_rate <= 0) errors.push_back("sensor.baud_rate must be positive");
+    if (c.sensor.batch_size < 0 || c.sensor.batch_size > 8) errors.push_back("sensor.batch_size must be 0-8");
+    if (c.sensor.sample_rate_hz <= 0) errors.push_back("sensor.sample_rate_hz must be positive");
+    if (c.data_pipeline.buffer_size < 1 || c.data_pipeline.batch_rows < 1) {
+        errors.push_back("data_pipeline.buffer_size and batch_rows must be positive");
+    }
+    const auto& db = c.local.timescaledb;
+    if (db.enabled && (!valid_port(db.port) || db.pool_size < 1 || db.min_pool_size < 0 || db.min_pool_size > db.pool_size)) {
+        errors.push_back("local.timescaledb: invalid port or pool size");
+    }
+    const auto& a = c.analysis;
+    if (a.saturation_min >= a.saturation_max) errors.push_back("analysis.saturation_min must be below saturation_max");
+    if (a.humidity_min >= a.humidity_max) errors.push_back("analysis.humidity_min must be below humidity_max");
+    if (a.temperature_min >= a.temperature_max) errors.push_back("analysis.temperature_min must be below temperature_max");
+    if (a.baseline_alpha <= 0.0 || a.baseline_alpha > 1.0) errors.push_back("analysis.baseline_alpha must be in (0, 1]");
+    if (a.drift_alpha <= 0.0 || a.drift_alpha > 1.0) errors.push_back("analysis.drift_alpha must be in (0, 1]");
+    if (c.inference.min_confidence < 0.0 || c.inference.min_confidence > 1.0) {
+        errors.push_back("inference.min_confidence must be in [0, 1]");
+    }
+    if (c.runtime.io_threads < 1) errors.push_back("runtime.io_threads must be at least 1");
+    if (c.runtime.safety_priority < 0 || c.runtime.safety_priority > 99) errors.push_back("runtime.safety_priority must be 0-99");
+    if (c.hot_reload.debounce_ms < 0) errors.push_back("hot_reload.debounce_ms must not be negative");
+    return errors;
+}
+
+bool ConfigSnapshot::section_changed(const ConfigSnapshot& previous, const std::string& section) const {
+    static const nlohmann::json missing;
+    auto value = [&](const nlohmann::json& document) -> const nlohmann::json& {
+        auto it = document.find(section);
+        return it == document.end() ? missing : *it;
+    };
+    return value(document) != value(previous.document);
+}
+
 // Config 单例实现
+Config::Config() : snapshot_(std::make_shared<const ConfigSnapshot>()) {}
+
 Config& Config::instance() {
     static Config instance;
     return instance;
 }
 
 bool Config::load(const std::string& config_path) {
+    std::lock_guard lock(reload_mutex_);
     config_path_ = config_path;
-    
-    std::ifstream file(config_path);
-    if (!file.is_open()) {
-        spdlog::error("Config: Failed to open config file: {}", config_path);
+
+    // 启动时校验失败只告警, 与之前的行为一致; 热加载时同样的错误会拒绝发布
+    std::vector<std::string> errors;
+    auto initial = read_snapshot(errors);
+    if (!initial) {
+        for (const auto& error : errors) {
+            spdlog::error("Config: {}", error);
+        }
         return false;
     }
-    
-    try {
-        nlohmann::json j;
-        file >> j;
-        parse_json(j);
-        spdlog::info("Config: Loaded configuration from {}", config_path);
-        return true;
-    }
-    catch (const std::exception& e) {
-        spdlog::error("Config: Failed to parse config file: {}", e.what());
-        return false;
+    for (const auto& error : errors) {
+        spdlog::warn("Config: {}", error);
     }
+
+    static_cast<ConfigValues&>(*this) = initial->values;
+    initial->version = snapshot_.load()->version + 1;
+    initial->loaded_at = std::chrono::system_clock::now();
+    snapshot_.store(std::make_shared<const ConfigSnapshot>(std::move(*initial)));
+    spdlog::info("Config: Loaded configuration from {}", config_path);
+    return true;
 }
 
 bool Config::reload() {
@@ -116,15 +388,140 @@ bool Config::reload() {
     return load(config_path_);
 }
 
-void Config::parse_json(const nlohmann::json& j) {
-    if (j.contains("local")) j.at("local").get_to(local);
-    if (j.contains("cloud")) j.at("cloud").get_to(cloud);
-    if (j.contains("lan")) j.at("lan").get_to(lan);
-    if (j.contains("grpc")) j.at("grpc").get_to(grpc);
-    if (j.contains("sensor")) j.at("sensor").get_to(sensor);
-    if (j.contains("actuator")) j.at("actuator").get_to(actuator);
-    if (j.contains("data_pipeline")) j.at("data_pipeline").get_to(data_pipeline);
-    if (j.contains("logging")) j.at("logging").get_to(logging);
+std::filesystem::path Config::load_cell_path() const {
+    return resolve_path(config_path_, "load_cell.json");
+}
+
+std::filesystem::path Config::yaml_directory() const {
+    return resolve_path(config_path_, snapshot()->values.hot_reload.yaml_directory);
+}
+
+void Config::add_validator(Validator validator) {
+    std::lock_guard lock(reload_mutex_);
+    validators_.push_back(std::move(validator));
+}
+
+// config.json 无法读取或解析时返回 nullopt; 其余问题只记入 errors, 由调用方决定是否发布
+std::optional<ConfigSnapshot> Config::read_snapshot(std::vector<std::string>& errors) const {
+    ConfigSnapshot snapshot;
+    try {
+        snapshot.document = nlohmann::json::parse(read_file(config_path_));
+        from_json(snapshot.document, snapshot.values);
+    } catch (const std::exception& e) {
+        errors.push_back(std::string("Failed to parse config file: ") + e.what());
+        return std::nullopt;
+    }
+    for (auto& error : validate_config(snapshot.values)) {
+        errors.push_back(std::move(error));
+    }
+
+    auto load_cell = load_cell_path();
+    if (std::filesystem::exists(load_cell)) {
+        try {
+            snapshot.load_cell = nlohmann::json::parse(read_file(load_cell));
+            if (!snapshot.load_cell.is_object()) {
+                errors.push_back(load_cell.filename().string() + ": top level must be an object");
+            }
+        } catch (const std::exception& e) {
+            errors.push_back(load_cell.filename().string() + ": " + e.what());
+        }
+    }
+
+    auto yaml_dir = resolve_path(config_path_, snapshot.values.hot_reload.yaml_directory);
+    std::error_code ec;
+    if (std::filesystem::is_directory(yaml_dir, ec)) {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(yaml_dir, ec)) {
+            auto ext = entry.path().extension();
+            if (!entry.is_regular_file() || (ext != ".yaml" && ext != ".yml")) continue;
+            auto relative = entry.path().lexically_relative(yaml_dir).generic_string();
+            try {
+                auto content = read_file(entry.path());
+                YAML::Load(content);
+                snapshot.yaml_files.emplace(relative, std::move(content));
+            } catch (const std::exception& e) {
+                errors.push_back(relative + ": " + e.what());
+            }
+        }
+    }
+    return snapshot;
+}
+
+bool Config::reload_snapshot() {
+    std::lock_guard lock(reload_mutex_);
+    if (config_path_.empty()) {
+        spdlog::error("Config: No config file path set");
+        return false;
+    }
+
+    std::vector<std::string> errors;
+    auto candidate = read_snapshot(errors);
+    if (candidate) {
+        for (const auto& validator : validators_) {
+            for (auto& error : validator(*candidate)) {
+                errors.push_back(std::move(error));
+            }
+        }
+    }
+    if (!errors.empty()) {
+        ++rejected_;
+        for (const auto& error : errors) {
+            spdlog::error("Config: Reload rejected: {}", error);
+        }
+        return false;
+    }
+
+    auto previous = snapshot_.load();
+    std::set<std::string> sections;
+    for (const auto& [key, value] : candidate->document.items()) sections.insert(key);
+    for (const auto& [key, value] : previous->document.items()) sections.insert(key);
+    for (const auto& section : sections) {
+        if (candidate->section_changed(*previous, section)) {
+            candidate->changed.push_back(section);
+        }
+    }
+    if (candidate->load_cell != previous->load_cell) {
+        candidate->changed.push_back("load_cell.json");
+    }
+    std::set<std::string> yaml_paths;
+    for (const auto& [path, content] : candidate->yaml_files) yaml_paths.insert(path);
+    for (const auto& [path, content] : previous->yaml_files) yaml_paths.insert(path);
+    for (const auto& path : yaml_paths) {
+        auto a = candidate->yaml_files.find(path);
+        auto b = previous->yaml_files.find(path);
+        if (a == candidate->yaml_files.end() || b == previous->yaml_files.end() || a->second != b->second) {
+            candidate->changed.push_back(path);
+        }
+    }
+    if (candidate->changed.empty()) {
+        ++unchanged_;
+        return false;
+    }
+
+    candidate->version = previous->version + 1;
+    candidate->loaded_at = std::chrono::system_clock::now();
+    auto current = std::make_shared<const ConfigSnapshot>(std::move(*candidate));
+    snapshot_.store(current);
+    ++reloads_;
+
+    std::string changed;
+    for (const auto& name : current->changed) {
+        if (!changed.empty()) changed += ", ";
+        changed += name;
+    }
+    spdlog::info("Config: Published version {} (changed: {})", current->version, changed);
+
+    // 在锁内发出: 订阅者按版本顺序收到通知 (处理函数内不可再调用 reload_snapshot / add_validator)
+    on_reloaded(*previous, *current);
+    return true;
+}
+
+Config::Stats Config::stats() const {
+    Stats stats;
+    stats.version = snapshot()->version;
+    stats.reloads = reloads_;
+    stats.rejected = rejected_;
+    stats.unchanged = unchanged_;
+    return stats;
 }
 
 } // namespace core
@@ -1,7 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <optional>
+#include <boost/signals2.hpp>
 #include <nlohmann/json.hpp>
 
 namespace core {
@@ -15,7 +25,8 @@ struct DatabaseConfig {
     std::string user = "enose";
     std::string password;
     std::string ssl_mode;
-    int pool_size = 5;
+    int pool_size = 5;              // 连接池上限
+    int min_pool_size = 1;          // 常驻连接数
     int connect_timeout_sec = 10;
     
     // 生成连接字符串
@@ -24,7 +35,8 @@ struct DatabaseConfig {
                           " port=" + std::to_string(port) +
                           " dbname=" + database +
                           " user=" + user +
-                          " password=" + password;
+                          " password=" + password +
+                          " connect_timeout=" + std::to_string(connect_timeout_sec);
         if (!ssl_mode.empty()) {
             conn += " sslmode=" + ssl_mode;
         }
@@ -53,10 +65,61 @@ struct GpuWorkerConfig {
     }
 };
 
+// 本地记录日志配置 (数据库不可用时的落盘缓冲)
+struct JournalConfig {
+    bool enabled = true;
+    std::string directory = "/var/lib/enose-control/journal";
+    int segment_size_mb = 16;       // 单个段文件大小
+    int max_total_mb = 2048;        // 所有段合计上限, 超出时删除最旧的段
+    int upload_interval_sec = 30;   // 补传线程重试间隔
+};
+
+// 时序数据存储策略 (连续聚合 / 压缩 / 保留), 天数为 0 表示关闭该策略
+struct StorageConfig {
+    bool manage = true;                     // 启动时由控制服务设置策略
+    int sensor_compress_after_days = 7;
+    int sensor_retention_days = 0;
+    int weight_compress_after_days = 3;
+    int weight_retention_days = 30;
+    int aggregate_1s_retention_days = 30;
+    int aggregate_1m_retention_days = 365;
+    int aggregate_1h_retention_days = 0;
+};
+
+// 运行的列式导出 (ExportService.ExportRun)
+struct ExportConfig {
+    std::string directory = "/var/lib/enose-control/exports";  // Parquet 文件写入 <directory>/run-<id>/
+    int batch_rows = 4096;                  // 每个 Arrow record batch 的行数
+    std::string parquet_compression = "zstd";
+    int parquet_row_group_rows = 65536;     // 写入时整组缓存在内存中
+};
+
+// 已结束运行的 mmap 归档 (ExportService.GetRunArchive / ReadRunArchive)
+struct ArchiveConfig {
+    bool enabled = true;
+    std::string directory = "/var/lib/enose-control/archives";  // <directory>/run-<id>.enra
+    int settle_sec = 5;                     // 运行结束后等待异步写入落库
+    int retry_interval_sec = 60;
+    int backfill_runs = 20;                 // 启动时补做最近 N 个运行的归档
+    int max_open = 8;                       // 同时保持映射的归档数
+};
+
+// 泵液体消耗 / 耗材运行时间账本 (批量提交到 pump_assignments / consumables)
+struct LedgerConfig {
+    bool enabled = true;
+    std::string directory = "/var/lib/enose-control/ledger";  // 未提交批次的本地日志
+    int flush_interval_ms = 5000;           // 步骤边界之外的定时提交间隔
+};
+
 // 本地服务配置
 struct LocalConfig {
     DatabaseConfig timescaledb;
     RedisConfig redis;
+    JournalConfig journal;
+    StorageConfig storage;
+    ExportConfig exports;
+    ArchiveConfig archive;
+    LedgerConfig ledger;
 };
 
 // 云端配置
@@ -73,9 +136,25 @@ struct LanConfig {
 };
 
 // gRPC 服务配置
+// 内置 grpc-web 网关 (UI 直连, 不经外部代理)
+struct GrpcWebConfig {
+    bool enabled = true;
+    std::string host = "0.0.0.0";
+    int port = 8080;
+    int flush_interval_ms = 20;                     // 流消息合并写出的最长等待; 0 = 逐条写出
+    int max_coalesce_bytes = 65536;                 // 待写达到该字节数立即写出
+    // CORS Access-Control-Allow-Origin; 空 (默认) 则不发送, 只有同源页面能调用.
+    // UI 由其他源提供时设为该源, 例如 "http://enose.local:3000"
+    std::string allow_origin;
+};
+
 struct GrpcConfig {
     std::string host = "0.0.0.0";
     int port = 50051;
+    int stream_queue_size = 1024;                   // 每个流订阅者的队列上限 (条)
+    std::string stream_overflow = "drop_oldest";    // 队列满时: drop_oldest / decimate
+    std::string stream_compression = "low";         // 服务端流的压缩级别: none / low / medium / high (与客户端协商算法)
+    GrpcWebConfig web;
     
     std::string address() const {
         return host + ":" + std::to_string(port);
@@ -83,11 +162,63 @@ struct GrpcConfig {
 };
 
 // 传感器配置
+// 额外的传感器板 (主板之外), 其余参数沿用主板
+struct SensorBoardConfig {
+    std::string device_id;          // 客户端按此 id 订阅 / 下发命令, 不可与其他板重复
+    std::string serial_port;
+    std::string usb_serial;
+    int baud_rate = 0;              // 0 = 沿用主板
+};
+
 struct SensorConfig {
     std::string serial_port = "/dev/ttyUSB0";
+    std::string usb_serial;         // 非空时按 USB 序列号在 /dev/serial/by-id 下查找, 优先于 serial_port
+    std::string device_id = "bme688-devkit-v1";    // SensorFrame.device_id, 对应 config/sensor_boards 中的板 id
     int baud_rate = 115200;
     int channels = 16;
     int sample_rate_hz = 10;
+    bool binary_protocol = false;   // 通过 sync 协商二进制数据帧
+    int batch_size = 0;             // 二进制模式下每帧读数条数 (0 = 不批量, 最大 8)
+    std::string replay_file;        // 非空时不打开串口, 回放该记录 (bmerawdata / bmespecimen / 抓包), 相对路径按配置文件目录解析
+    double replay_speed = 1.0;      // 回放倍速, 0 = 不限速
+    bool replay_loop = false;
+    int clock_sync_interval_ms = 5000;  // 主机-设备时钟同步间隔, 0 = 不同步 (读数用到达时间)
+    std::vector<SensorBoardConfig> additional_boards;  // 多板采集, 上面的字段描述主板 (board 0)
+    int merge_window_ms = 50;       // 多板合并流等待慢板的最长时间, 超过后不再保证按时间排序
+};
+
+// 实时分析配置 (SubscribeAnalysisResults 的特征提取与质量标志)
+struct AnalysisConfig {
+    double baseline_alpha = 0.05;           // 基线 EWMA 系数
+    double noise_threshold = 0.02;          // 相对噪声 σ 超过时标记 QF_EXCESS_NOISE
+    double baseline_drift_threshold = 0.005;// 基线相对斜率 (1/s) 超过时标记 QF_BASELINE_UNSTABLE
+    double saturation_min = 1.0;            // 读数不在 (min, max) 内时标记 QF_SENSOR_SATURATION
+    double saturation_max = 1.0e8;
+    double humidity_min = 5.0;              // %RH
+    double humidity_max = 90.0;
+    double temperature_min = 0.0;           // °C
+    double temperature_max = 60.0;
+
+    // 基线跟踪与漂移校正: 只在这些 PhaseMarker 阶段内 (阶段名不区分大小写) 更新基线
+    std::vector<std::string> baseline_phases = {"baseline"};
+    double drift_alpha = 0.02;              // 基线 EWMA 系数
+    double drift_clip = 0.05;               // 单条读数对基线的修正上限 (相对)
+    int drift_warmup_samples = 10;          // 预热条数, 达到后锁定参考基线
+    int baseline_persist_interval_sec = 60; // 基线写回数据库的间隔
+
+    // 指纹矩阵 (加热步 × 传感器); 实时流的步数随 ConfigureHeater 更新
+    int fingerprint_steps = 10;
+    int fingerprint_sensors = 8;
+    int fingerprint_max_missing = 0;        // 允许缺失的单元数, 超过则丢弃该周期
+};
+
+// 设备端气味分类 (每个完整加热周期的指纹矩阵推理一次)
+struct InferenceConfig {
+    bool enabled = false;
+    std::string model_path = "models/odor_classifier.json";
+    int max_batch = 8;                      // 一次推理合并的最多周期数
+    int queue_capacity = 32;                // 待推理队列上限, 满时丢弃最旧的
+    double min_confidence = 0.6;            // 最高得分不低于此值时发布系统事件
 };
 
 // 执行器配置
@@ -96,9 +227,55 @@ struct ActuatorConfig {
     int moonraker_port = 7125;
 };
 
+// 模拟器故障注入 (各链路独立)
+struct SimFaultConfig {
+    double latency_ms = 0.0;                // 每条发出消息的固定延迟
+    double jitter_ms = 0.0;                 // 额外的均匀随机延迟 [0, jitter_ms), 消息顺序不变
+    double drop_rate = 0.0;                 // 丢弃概率: 传感器读数 (仍进入补发历史) / RPC 响应
+    double corrupt_rate = 0.0;              // 传感器行/帧翻转一个字节的概率
+    double disconnect_interval_sec = 0.0;   // > 0 时按此周期断开链路 (串口重建 pty / 关闭 WebSocket)
+};
+
+// 模拟传感器板 (pty, 与固件 CmdHandler 同一协议)
+struct SimSensorBoardConfig {
+    std::string link = "/tmp/enose-sim-sensor";    // 指向 pty 从端的符号链接, 启用时替代 sensor.serial_port
+    int sensors = 8;
+    int heater_time_base_ms = 140;          // 加热步时长 = durs[i] × time_base
+    bool autostart = false;                 // 不等 init/start 命令直接开始上报
+    double odor_response = 2.0;             // 满浓度时电阻下降倍数 (R = R0 / (1 + k·c))
+    double response_tau_sec = 8.0;          // 气室浓度一阶响应时间常数
+    double noise = 0.005;                   // 电阻相对噪声 σ
+    double clock_skew_ppm = 0.0;            // 设备晶振相对主机的频偏 (验证时钟同步)
+    SimFaultConfig faults;
+};
+
+// 模拟 Moonraker (WebSocket JSON-RPC) 与称重模块
+struct SimMoonrakerConfig {
+    std::string host = "127.0.0.1";         // 启用时替代 actuator.moonraker_host / moonraker_port
+    int port = 7126;
+    int status_interval_ms = 100;           // notify_status_update 推送与物理模型步进间隔
+    double grams_per_mm = 0.0314;           // 蠕动泵每 mm 行程的出液量
+    double empty_bottle_g = 322.66;
+    bool invert_reading = true;             // 与 load_cell.json 的 invert_reading 一致
+    double noise_g = 0.2;                   // force_g 高斯噪声 σ
+    double drain_rate_g_s = 8.0;            // 排废阀开 + 气泵运行时的排液速度
+    double clean_rate_g_s = 5.0;            // 清洗泵 100% 时的进液速度
+    int restart_ms = 1000;                  // FIRMWARE_RESTART 到 ready 的时间
+    SimFaultConfig faults;
+};
+
+// 硬件在环模拟器: 无 ESP32 / Moonraker / HX711 时运行完整实验
+struct SimulatorConfig {
+    bool enabled = false;
+    uint32_t seed = 0;                      // 噪声与故障注入的随机种子, 0 = 随机
+    SimSensorBoardConfig sensor_board;
+    SimMoonrakerConfig moonraker;
+};
+
 // 数据管线配置
 struct DataPipelineConfig {
-    int buffer_size = 1000;
+    int buffer_size = 1000;                 // 传感器读数写库队列上限 (行)
+    int batch_rows = 256;                   // 队列达到该行数立即写入, 不等 batch_write_interval_ms
     int batch_write_interval_ms = 100;
     std::string redis_stream_name = "sensor_data";
     int redis_stream_max_len = 10000;
@@ -113,13 +290,85 @@ struct LoggingConfig {
     int max_files = 5;
 };
 
+// Prometheus 抓取端点 (GET /metrics)
+struct MetricsConfig {
+    bool enabled = true;
+    std::string host = "0.0.0.0";
+    int port = 9464;
+};
+
+// 线程模型: io 线程池 + 安全路径的独立高优先级线程
+struct RuntimeConfig {
+    int io_threads = 2;             // 运行主 io_context 的线程数, 各驱动在自己的 strand 上串行
+    int safety_priority = 80;       // 安全线程 (称重溢出判定) 的 SCHED_FIFO 优先级 1-99, 0 = 普通调度
+    int safety_cpu = -1;            // 安全线程绑定的 CPU 核, -1 = 不绑定
+};
+
+// 配置热加载: inotify 监视 config.json 所在目录和 YAML 配置目录
+struct HotReloadConfig {
+    bool enabled = true;
+    std::string yaml_directory = "../../config";    // heaters / liquids / workflows 等 YAML, 相对路径按配置文件目录解析
+    int debounce_ms = 200;                          // 编辑器保存会产生多个事件, 静默该时长后才重新加载
+};
+
+// config.json 的全部配置节
+struct ConfigValues {
+    LocalConfig local;
+    CloudConfig cloud;
+    LanConfig lan;
+    GrpcConfig grpc;
+    SensorConfig sensor;
+    AnalysisConfig analysis;
+    InferenceConfig inference;
+    ActuatorConfig actuator;
+    SimulatorConfig simulator;
+    DataPipelineConfig data_pipeline;
+    LoggingConfig logging;
+    MetricsConfig metrics;
+    RuntimeConfig runtime;
+    HotReloadConfig hot_reload;
+};
+
+/**
+ * @brief 一次加载得到的不可变配置快照
+ *
+ * 发布后不再修改, 订阅者可以长期持有 shared_ptr; 新版本总是完整替换旧版本.
+ */
+struct ConfigSnapshot {
+    uint64_t version = 0;                           // 每次发布递增, load() 发布 1
+    std::chrono::system_clock::time_point loaded_at;
+    ConfigValues values;                            // config.json
+    nlohmann::json document;                        // config.json 原文, 用于按节比较
+    nlohmann::json load_cell;                       // load_cell.json, 文件不存在时为 null
+    std::map<std::string, std::string> yaml_files;  // YAML 目录下的相对路径 -> 内容 (均已通过解析)
+    std::vector<std::string> changed;               // 相对上一版本的变化: config.json 的节名 / "load_cell.json" / YAML 相对路径
+
+    bool section_changed(const ConfigSnapshot& previous, const std::string& section) const;
+};
+
+// config.json 各节的取值检查, 返回错误描述 (空 = 通过)
+std::vector<std::string> validate_config(const ConfigValues& values);
+
 // 主配置类
-class Config {
+//
+// 公开字段是 load() 时的启动配置, 只在启动阶段读取; 运行期间的配置变化通过 snapshot()
+// 和 on_reloaded 获取. 热加载读取全部文件, 校验失败时保留当前快照.
+class Config : public ConfigValues {
 public:
+    // 校验器: 各子系统检查自己关心的内容 (如 load_cell.json), 返回错误描述
+    using Validator = std::function<std::vector<std::string>(const ConfigSnapshot&)>;
+
+    struct Stats {
+        uint64_t version = 0;
+        uint64_t reloads = 0;           // 发布的新版本 (不含启动)
+        uint64_t rejected = 0;          // 解析或校验失败, 未发布
+        uint64_t unchanged = 0;         // 文件事件到达但内容未变
+    };
+
     // 单例访问
     static Config& instance();
     
-    // 加载配置文件
+    // 加载配置文件 (同时发布快照版本 1)
     bool load(const std::string& config_path);
     
     // 重新加载配置
@@ -127,38 +376,70 @@ public:
     
     // 获取配置路径
     const std::string& config_path() const { return config_path_; }
-    
-    // 各模块配置
-    LocalConfig local;
-    CloudConfig cloud;
-    LanConfig lan;
-    GrpcConfig grpc;
-    SensorConfig sensor;
-    ActuatorConfig actuator;
-    DataPipelineConfig data_pipeline;
-    LoggingConfig logging;
+    std::filesystem::path load_cell_path() const;
+    std::filesystem::path yaml_directory() const;
+
+    // 当前快照, 任意线程可调用
+    std::shared_ptr<const ConfigSnapshot> snapshot() const { return snapshot_.load(); }
+
+    void add_validator(Validator validator);
+
+    /**
+     * @brief 重新读取 config.json / load_cell.json / YAML 目录
+     *
+     * 全部解析和校验通过且内容有变化时发布新版本, 然后在调用线程上发出 on_reloaded.
+     * 多个线程同时调用时串行执行.
+     * @return 是否发布了新版本
+     */
+    bool reload_snapshot();
+
+    Stats stats() const;
+
+    // 新版本发布后发出 (previous 为上一版本)
+    boost::signals2::signal<void(const ConfigSnapshot& previous, const ConfigSnapshot& current)> on_reloaded;
 
 private:
-    Config() = default;
+    Config();
     Config(const Config&) = delete;
     Config& operator=(const Config&) = delete;
     
-    void parse_json(const nlohmann::json& j);
+    std::optional<ConfigSnapshot> read_snapshot(std::vector<std::string>& errors) const;
     
     std::string config_path_;
+
+    std::atomic<std::shared_ptr<const ConfigSnapshot>> snapshot_;
+    std::mutex reload_mutex_;           // 串行化 reload_snapshot, 保护 validators_
+    std::vector<Validator> validators_;
+    std::atomic<uint64_t> reloads_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> unchanged_{0};
 };
 
 // JSON 序列化支持
 void from_json(const nlohmann::json& j, DatabaseConfig& c);
 void from_json(const nlohmann::json& j, RedisConfig& c);
 void from_json(const nlohmann::json& j, GpuWorkerConfig& c);
+void from_json(const nlohmann::json& j, JournalConfig& c);
+void from_json(const nlohmann::json& j, StorageConfig& c);
 void from_json(const nlohmann::json& j, LocalConfig& c);
 void from_json(const nlohmann::json& j, CloudConfig& c);
 void from_json(const nlohmann::json& j, LanConfig& c);
+void from_json(const nlohmann::json& j, GrpcWebConfig& c);
 void from_json(const nlohmann::json& j, GrpcConfig& c);
+void from_json(const nlohmann::json& j, SensorBoardConfig& c);
 void from_json(const nlohmann::json& j, SensorConfig& c);
+void from_json(const nlohmann::json& j, AnalysisConfig& c);
+void from_json(const nlohmann::json& j, InferenceConfig& c);
 void from_json(const nlohmann::json& j, ActuatorConfig& c);
+void from_json(const nlohmann::json& j, SimFaultConfig& c);
+void from_json(const nlohmann::json& j, SimSensorBoardConfig& c);
+void from_json(const nlohmann::json& j, SimMoonrakerConfig& c);
+void from_json(const nlohmann::json& j, SimulatorConfig& c);
 void from_json(const nlohmann::json& j, DataPipelineConfig& c);
 void from_json(const nlohmann::json& j, LoggingConfig& c);
+void from_json(const nlohmann::json& j, MetricsConfig& c);
+void from_json(const nlohmann::json& j, RuntimeConfig& c);
+void from_json(const nlohmann::json& j, HotReloadConfig& c);
+void from_json(const nlohmann::json& j, ConfigValues& c);
 
 } // namespace core
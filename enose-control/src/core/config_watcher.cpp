@@ -0,0 +1,149 @@
+#include "core/config_watcher.hpp"
+#include <boost/asio/post.hpp>
+#include <spdlog/spdlog.h>
+#include <cerrno>
+#include <cstring>
+
+namespace core {
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_ONLYDIR;
+
+bool is_config_file(const std::filesystem::path& path) {
+    auto ext = path.extension();
+    return ext == ".json" || ext == ".yaml" || ext == ".yml";
+}
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(boost::asio::io_context& io, std::chrono::milliseconds debounce)
+    : strand_(boost::asio::make_strand(io)),
+      descriptor_(strand_),
+      debounce_timer_(strand_),
+      debounce_(debounce) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        spdlog::error("ConfigWatcher: inotify_init1 failed: {}", std::strerror(errno));
+        return;
+    }
+    descriptor_.assign(fd);
+}
+
+bool ConfigWatcher::watch(const std::filesystem::path& directory) {
+    if (!descriptor_.is_open()) return false;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory, ec)) {
+        spdlog::warn("ConfigWatcher: Not a directory: {}", directory.string());
+        return false;
+    }
+    bool ok = add_watch(directory);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec)) {
+        if (entry.is_directory()) {
+            ok = add_watch(entry.path()) && ok;
+        }
+    }
+    return ok;
+}
+
+bool ConfigWatcher::add_watch(const std::filesystem::path& directory) {
+    int wd = inotify_add_watch(descriptor_.native_handle(), directory.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        spdlog::warn("ConfigWatcher: Failed to watch {}: {}", directory.string(), std::strerror(errno));
+        return false;
+    }
+    watches_[wd] = directory;
+    spdlog::info("ConfigWatcher: Watching {}", directory.string());
+    return true;
+}
+
+void ConfigWatcher::start() {
+    if (!descriptor_.is_open() || watches_.empty()) return;
+    running_ = true;
+    boost::asio::post(strand_, [this, self = shared_from_this()]() { do_read(); });
+}
+
+void ConfigWatcher::stop() {
+    running_ = false;
+    boost::asio::post(strand_, [this, self = shared_from_this()]() {
+        debounce_timer_.cancel();
+        boost::system::error_code ignored;
+        descriptor_.close(ignored);
+    });
+}
+
+ConfigWatcher::Stats ConfigWatcher::stats() const {
+    Stats stats;
+    stats.watches = watches_.size();
+    stats.events = events_;
+    stats.batches = batches_;
+    stats.overflows = overflows_;
+    return stats;
+}
+
+void ConfigWatcher::do_read() {
+    if (!running_) return;
+    descriptor_.async_read_some(boost::asio::buffer(buffer_),
+        [this, self = shared_from_this()](const boost::system::error_code& ec, std::size_t bytes) {
+            on_read(ec, bytes);
+        });
+}
+
+void ConfigWatcher::on_read(const boost::system::error_code& ec, std::size_t bytes) {
+    if (ec) {
+        if (ec != boost::asio::error::operation_aborted && running_) {
+            spdlog::error("ConfigWatcher: Read failed: {}", ec.message());
+        }
+        return;
+    }
+
+    // 一次 read 返回若干完整的 inotify_event, 每个之后紧跟 len 字节的文件名
+    std::size_t offset = 0;
+    while (offset + sizeof(inotify_event) <= bytes) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buffer_ + offset);
+        offset += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            ++overflows_;
+            pending_overflow_ = true;
+            continue;
+        }
+        if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+        auto it = watches_.find(event->wd);
+        if (it == watches_.end()) continue;
+
+        std::filesystem::path path = it->second / event->name;
+        if (!is_config_file(path)) continue;
+        ++events_;
+        pending_.insert(std::move(path));
+    }
+
+    if (!pending_.empty() || pending_overflow_) {
+        schedule_flush();
+    }
+    do_read();
+}
+
+void ConfigWatcher::schedule_flush() {
+    // 每个新事件都把截止时间后推, 静默 debounce_ 后才发出
+    debounce_timer_.expires_after(debounce_);
+    debounce_timer_.async_wait([this, self = shared_from_this()](const boost::system::error_code& ec) {
+        if (!ec) {
+            flush();
+        }
+    });
+}
+
+void ConfigWatcher::flush() {
+    if (!running_) return;
+    std::vector<std::filesystem::path> changed;
+    if (!pending_overflow_) {
+        changed.assign(pending_.begin(), pending_.end());
+    }
+    pending_.clear();
+    pending_overflow_ = false;
+    ++batches_;
+    on_changed(changed);
+}
+
+} // namespace core
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/signals2.hpp>
+#include <sys/inotify.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief 用 inotify 监视配置目录, 文件变化静默 debounce 后批量发出 on_changed
+ *
+ * 监视目录而不是文件: 编辑器和原子写入 (写临时文件再 rename) 会替换 inode, 按文件监视会丢失.
+ * 只关注 .json / .yaml / .yml 的 IN_CLOSE_WRITE / IN_MOVED_TO / IN_DELETE. inotify 不递归,
+ * watch() 时为已有子目录逐个添加监视. 运行在构造时传入的 io_context 的 strand 上,
+ * on_changed 也在该 strand 上发出.
+ */
+class ConfigWatcher : public std::enable_shared_from_this<ConfigWatcher> {
+public:
+    struct Stats {
+        std::size_t watches = 0;        // 已添加的目录监视
+        uint64_t events = 0;            // 收到的相关文件事件
+        uint64_t batches = 0;           // 合并后发出的 on_changed 次数
+        uint64_t overflows = 0;         // 内核事件队列溢出 (按全部文件变化处理)
+    };
+
+    ConfigWatcher(boost::asio::io_context& io, std::chrono::milliseconds debounce);
+
+    /** @brief 添加目录 (含子目录) 监视, 须在 start() 之前调用 */
+    bool watch(const std::filesystem::path& directory);
+
+    void start();
+    void stop();
+
+    Stats stats() const;
+
+    // 本批次变化的文件; 队列溢出时为空 (无法确定哪些文件变化, 订阅者应全部重新读取)
+    boost::signals2::signal<void(const std::vector<std::filesystem::path>& changed)> on_changed;
+
+private:
+    bool add_watch(const std::filesystem::path& directory);
+    void do_read();
+    void on_read(const boost::system::error_code& ec, std::size_t bytes);
+    void schedule_flush();
+    void flush();
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    boost::asio::posix::stream_descriptor descriptor_;
+    boost::asio::steady_timer debounce_timer_;
+    std::chrono::milliseconds debounce_;
+    std::atomic<bool> running_{false};
+
+    // wd -> 目录; watch() 在 start() 之前完成, 之后只在 strand 上读取
+    std::map<int, std::filesystem::path> watches_;
+    std::set<std::filesystem::path> pending_;
+    bool pending_overflow_ = false;
+    alignas(struct inotify_event) char buffer_[4096];
+
+    std::atomic<uint64_t> events_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> overflows_{0};
+};
+
+} // namespace core
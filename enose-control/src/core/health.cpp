@@ -0,0 +1,120 @@
+#include "core/health.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace core {
+
+HealthRegistry& HealthRegistry::instance() {
+    static HealthRegistry registry;
+    return registry;
+}
+
+HealthRegistry::HealthRegistry() : started_(std::chrono::steady_clock::now()) {}
+
+uint64_t HealthRegistry::uptime_ms() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started_).count());
+}
+
+const char* HealthRegistry::state_name(State state) {
+    switch (state) {
+        case State::STARTING: return "starting";
+        case State::READY: return "ready";
+        case State::DEGRADED: return "degraded";
+        case State::DISABLED: return "disabled";
+    }
+    return "unknown";
+}
+
+void HealthRegistry::add(const std::string& name, std::function<Probe()> probe, bool required) {
+    std::lock_guard lock(mutex_);
+    auto it = std::find_if(entries_.begin(), entries_.end(),
+                           [&](const Entry& e) { return e.info.name == name; });
+    if (it == entries_.end()) {
+        Entry entry;
+        entry.info.name = name;
+        entry.info.since = std::chrono::system_clock::now();
+        it = entries_.insert(entries_.end(), std::move(entry));
+    }
+    it->info.required = required;
+    it->probe = std::move(probe);
+}
+
+void HealthRegistry::add_disabled(const std::string& name, const std::string& reason) {
+    std::lock_guard lock(mutex_);
+    Entry entry;
+    entry.info.name = name;
+    entry.info.state = State::DISABLED;
+    entry.info.detail = reason;
+    entry.info.required = false;
+    entry.info.since = std::chrono::system_clock::now();
+    entries_.push_back(std::move(entry));
+}
+
+void HealthRegistry::evaluate(Entry& entry, std::chrono::system_clock::time_point now) {
+    if (!entry.probe) return;
+    Probe probe;
+    try {
+        probe = entry.probe();
+    } catch (const std::exception& e) {
+        probe.detail = e.what();
+    }
+
+    State state = probe.ok ? State::READY : entry.ever_ready ? State::DEGRADED : State::STARTING;
+    if (probe.ok && !entry.ever_ready) {
+        entry.ever_ready = true;
+        entry.info.ready_after_ms = std::max<uint64_t>(uptime_ms(), 1);
+        spdlog::info("Health: {} ready after {}ms", entry.info.name, entry.info.ready_after_ms);
+    }
+    if (state != entry.info.state) {
+        if (state == State::DEGRADED) {
+            spdlog::warn("Health: {} degraded: {}", entry.info.name, probe.detail);
+        }
+        entry.info.state = state;
+        entry.info.since = now;
+    }
+    entry.info.detail = std::move(probe.detail);
+}
+
+std::vector<HealthRegistry::Subsystem> HealthRegistry::report() {
+    std::lock_guard lock(mutex_);
+    const auto now = std::chrono::system_clock::now();
+    std::vector<Subsystem> result;
+    result.reserve(entries_.size());
+    for (auto& entry : entries_) {
+        evaluate(entry, now);
+        result.push_back(entry.info);
+    }
+    return result;
+}
+
+bool HealthRegistry::ready() {
+    auto subsystems = report();
+    return std::all_of(subsystems.begin(), subsystems.end(), [](const Subsystem& s) {
+        return !s.required || s.state == State::READY;
+    });
+}
+
+std::string HealthRegistry::summary() {
+    auto subsystems = report();
+    std::size_t ready = 0;
+    std::size_t counted = 0;
+    std::string pending;
+    for (const auto& s : subsystems) {
+        if (s.state == State::DISABLED) continue;
+        ++counted;
+        if (s.state == State::READY) {
+            ++ready;
+            continue;
+        }
+        if (!pending.empty()) pending += ", ";
+        pending += s.name + " " + state_name(s.state);
+    }
+    std::string text = "ready=" + std::to_string(ready) + "/" + std::to_string(counted);
+    if (!pending.empty()) {
+        text += " (" + pending + ")";
+    }
+    return text;
+}
+
+} // namespace core
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief 进程级子系统就绪状态 (ControlService.GetHealth 与 systemd STATUS 的数据源)
+ *
+ * 各子系统注册一个探测函数, 查询时当场求值; 探测函数只读取已有的原子状态, 不得阻塞.
+ * 探测失败时, 从未就绪过的子系统报告 STARTING (仍在初始化), 就绪过的报告 DEGRADED.
+ * 启动不再等待全部子系统: gRPC 先监听, 其余子系统并行初始化, 客户端按此判断可用功能.
+ */
+class HealthRegistry {
+public:
+    enum class State { STARTING, READY, DEGRADED, DISABLED };
+
+    struct Probe {
+        bool ok = false;
+        std::string detail;
+    };
+
+    struct Subsystem {
+        std::string name;
+        State state = State::STARTING;
+        std::string detail;
+        bool required = true;                       // 整体就绪是否依赖该子系统
+        std::chrono::system_clock::time_point since;// 进入当前状态的时间
+        uint64_t ready_after_ms = 0;                // 进程启动到首次就绪, 0 = 尚未就绪
+    };
+
+    static HealthRegistry& instance();
+
+    /** @brief 注册子系统; 同名重复注册时替换探测函数 */
+    void add(const std::string& name, std::function<Probe()> probe, bool required = true);
+
+    /** @brief 配置中未启用的子系统, 始终报告 DISABLED */
+    void add_disabled(const std::string& name, const std::string& reason);
+
+    /** @brief 求值全部探测函数, 按注册顺序返回 */
+    std::vector<Subsystem> report();
+
+    /** @brief 全部 required 子系统 READY */
+    bool ready();
+
+    /** @brief 单行摘要, 例如 "ready=3/4 (database starting)" */
+    std::string summary();
+
+    /** @brief 注册表创建 (main 启动时) 至今 */
+    uint64_t uptime_ms() const;
+
+    static const char* state_name(State state);
+
+private:
+    HealthRegistry();
+
+    struct Entry {
+        Subsystem info;
+        std::function<Probe()> probe;
+        bool ever_ready = false;
+    };
+    void evaluate(Entry& entry, std::chrono::system_clock::time_point now);
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::chrono::steady_clock::time_point started_;
+};
+
+} // namespace core
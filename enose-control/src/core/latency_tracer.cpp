@@ -0,0 +1,132 @@
+#include "core/latency_tracer.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace core {
+
+// ============================================================
+// LatencyHistogram
+// ============================================================
+
+std::size_t LatencyHistogram::bucket_index(uint64_t value_ns) {
+    // 小于 2·SUB_BUCKETS 的值每个桶宽 1; 之后区间 [2^m, 2^(m+1)) 按 2^(m - SUB_BUCKET_BITS) 分桶
+    if (value_ns < 2 * SUB_BUCKETS) return static_cast<std::size_t>(value_ns);
+    const unsigned msb = static_cast<unsigned>(std::bit_width(value_ns)) - 1;
+    if (msb >= MAX_EXPONENT) return BUCKET_COUNT - 1;
+    const unsigned shift = msb - SUB_BUCKET_BITS;
+    return static_cast<std::size_t>(shift * SUB_BUCKETS + (value_ns >> shift));
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(std::size_t index) {
+    if (index < 2 * SUB_BUCKETS) return index;
+    const unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+    return (index - shift * SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::bucket_width(std::size_t index) {
+    if (index < 2 * SUB_BUCKETS) return 1;
+    return uint64_t{1} << (index / SUB_BUCKETS - 1);
+}
+
+void LatencyHistogram::record(uint64_t value_ns) {
+    buckets_[bucket_index(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value_ns, std::memory_order_relaxed);
+    uint64_t prev = max_ns_.load(std::memory_order_relaxed);
+    while (value_ns > prev && !max_ns_.compare_exchange_weak(prev, value_ns, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot s;
+    // count 以各桶之和为准, 与并发写入时的桶内容保持一致
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        s.count += s.buckets[i];
+    }
+    s.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    s.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& b : buckets_) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const {
+    if (count == 0) return 0;
+    q = std::clamp(q, 0.0, 1.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            const uint64_t mid = bucket_lower_bound(i) + bucket_width(i) / 2;
+            return std::min(mid, max_ns);
+        }
+    }
+    return max_ns;
+}
+
+// ============================================================
+// LatencyTracer
+// ============================================================
+
+const char* latency_stage_name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::DECODE:              return "decode";
+        case LatencyStage::FANOUT_READINGS:     return "fanout_readings";
+        case LatencyStage::FANOUT_FRAMES:       return "fanout_frames";
+        case LatencyStage::GRPC_WRITE_READINGS: return "grpc_write_readings";
+        case LatencyStage::GRPC_WRITE_FRAMES:   return "grpc_write_frames";
+        case LatencyStage::DB_COMMIT:           return "db_commit";
+        default:                                return "unknown";
+    }
+}
+
+LatencyTracer& LatencyTracer::instance() {
+    static LatencyTracer tracer;
+    return tracer;
+}
+
+LatencyTracer::LatencyTracer()
+    : window_start_ns_(static_cast<int64_t>(mono_ns())) {}
+
+std::vector<LatencyTracer::StageStats> LatencyTracer::stats() const {
+    std::vector<StageStats> out;
+    out.reserve(histograms_.size());
+    for (std::size_t i = 0; i < histograms_.size(); ++i) {
+        const auto snap = histograms_[i].snapshot();
+        StageStats s;
+        s.stage = latency_stage_name(static_cast<LatencyStage>(i));
+        s.count = snap.count;
+        s.mean_us = snap.mean_ns() / 1000.0;
+        s.p50_us = static_cast<double>(snap.percentile(0.50)) / 1000.0;
+        s.p90_us = static_cast<double>(snap.percentile(0.90)) / 1000.0;
+        s.p99_us = static_cast<double>(snap.percentile(0.99)) / 1000.0;
+        s.p999_us = static_cast<double>(snap.percentile(0.999)) / 1000.0;
+        s.max_us = static_cast<double>(snap.max_ns) / 1000.0;
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+uint64_t LatencyTracer::window_seconds() const {
+    const int64_t elapsed = static_cast<int64_t>(mono_ns()) - window_start_ns_.load(std::memory_order_relaxed);
+    return elapsed > 0 ? static_cast<uint64_t>(elapsed) / 1'000'000'000ULL : 0;
+}
+
+void LatencyTracer::reset() {
+    for (auto& h : histograms_) {
+        h.reset();
+    }
+    window_start_ns_.store(static_cast<int64_t>(mono_ns()), std::memory_order_relaxed);
+}
+
+} // namespace core
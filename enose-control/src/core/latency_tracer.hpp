@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief 单调时钟 (ns), 热路径各阶段的时间戳
+ */
+inline uint64_t mono_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief 对数-线性分桶的延迟直方图 (HdrHistogram 布局)
+ *
+ * 每个 2 的幂区间分 SUB_BUCKETS 个等宽桶, 相对误差不超过 1/SUB_BUCKETS (约 3%);
+ * 覆盖 1 ns ~ 2^MAX_EXPONENT ns (约 18 分钟), 超出的值计入最后一个桶.
+ * record() 只做原子加, 可在任意线程并发调用; snapshot() 读取时不停止写入
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 40;
+    static constexpr std::size_t BUCKET_COUNT =
+        (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+
+        /** @brief 分位数 (q ∈ [0, 1]), 返回所在桶的中点; 无样本时为 0 */
+        uint64_t percentile(double q) const;
+        double mean_ns() const { return count > 0 ? static_cast<double>(sum_ns) / count : 0.0; }
+    };
+
+    void record(uint64_t value_ns);
+    Snapshot snapshot() const;
+    void reset();
+
+    static std::size_t bucket_index(uint64_t value_ns);
+    static uint64_t bucket_lower_bound(std::size_t index);
+    static uint64_t bucket_width(std::size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+/**
+ * @brief 传感器数据热路径的阶段, 均从主机收到串口数据块 (SensorSample::rx_ns) 起算
+ */
+enum class LatencyStage : std::size_t {
+    DECODE = 0,             // 串口接收 → 解码完成, 开始分发
+    FANOUT_READINGS,        // → SensorService 读数流入队
+    FANOUT_FRAMES,          // → DataService 帧流入队 (帧在下一加热步的首条读数到达时结束)
+    GRPC_WRITE_READINGS,    // → SubscribeSensorReadings 写出完成
+    GRPC_WRITE_FRAMES,      // → SubscribeSensorData 写出完成
+    DB_COMMIT,              // → sensor_readings 事务提交
+    COUNT
+};
+
+const char* latency_stage_name(LatencyStage stage);
+
+/**
+ * @brief 各阶段延迟直方图的进程级注册表
+ */
+class LatencyTracer {
+public:
+    struct StageStats {
+        std::string stage;
+        uint64_t count = 0;
+        double mean_us = 0.0;
+        double p50_us = 0.0;
+        double p90_us = 0.0;
+        double p99_us = 0.0;
+        double p999_us = 0.0;
+        double max_us = 0.0;
+    };
+
+    static LatencyTracer& instance();
+
+    /**
+     * @brief 记录 origin_ns 到现在的耗时; origin_ns 为 0 (来源未打时间戳) 时忽略
+     */
+    void record_since(LatencyStage stage, uint64_t origin_ns) {
+        if (origin_ns == 0) return;
+        const uint64_t now = mono_ns();
+        histograms_[static_cast<std::size_t>(stage)].record(now > origin_ns ? now - origin_ns : 0);
+    }
+
+    const LatencyHistogram& histogram(LatencyStage stage) const {
+        return histograms_[static_cast<std::size_t>(stage)];
+    }
+
+    /** @brief 各阶段的分位数摘要 (没有样本的阶段也列出, count = 0) */
+    std::vector<StageStats> stats() const;
+
+    /** @brief 统计起点 (启动或上次 reset) 至今的秒数 */
+    uint64_t window_seconds() const;
+
+    void reset();
+
+private:
+    LatencyTracer();
+
+    std::array<LatencyHistogram, static_cast<std::size_t>(LatencyStage::COUNT)> histograms_;
+    std::atomic<int64_t> window_start_ns_;
+};
+
+} // namespace core
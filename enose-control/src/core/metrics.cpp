@@ -0,0 +1,311 @@
+#include "core/metrics.hpp"
+#include "core/latency_tracer.hpp"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+
+namespace core {
+
+namespace metrics_detail {
+
+std::size_t shard_index() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return index;
+}
+
+} // namespace metrics_detail
+
+namespace {
+
+std::string format_value(double v) {
+    if (std::isnan(v)) return "NaN";
+    if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+    return fmt::format("{}", v);
+}
+
+std::string escape_label(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"':  out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default:   out.push_back(c); break;
+        }
+    }
+    return out;
+}
+
+std::string escape_help(const std::string& help) {
+    std::string out;
+    out.reserve(help.size());
+    for (char c : help) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '\n') out += "\\n";
+        else out.push_back(c);
+    }
+    return out;
+}
+
+std::string format_labels(const MetricLabels& labels, const char* extra_key = nullptr,
+                          const std::string& extra_value = {}) {
+    if (labels.empty() && !extra_key) return {};
+    std::string out = "{";
+    bool first = true;
+    for (const auto& [key, value] : labels) {
+        if (!first) out.push_back(',');
+        first = false;
+        out += key;
+        out += "=\"";
+        out += escape_label(value);
+        out.push_back('"');
+    }
+    if (extra_key) {
+        if (!first) out.push_back(',');
+        out += extra_key;
+        out += "=\"";
+        out += extra_value;
+        out.push_back('"');
+    }
+    out.push_back('}');
+    return out;
+}
+
+// HDR 直方图换算为 Prometheus 固定桶: 桶的上沿不超过 le 才计入, 误差在一个 HDR 桶宽 (~3%) 以内
+Histogram::Snapshot to_prometheus(const LatencyHistogram::Snapshot& hdr, const std::vector<double>& bounds) {
+    Histogram::Snapshot out;
+    out.bounds = bounds;
+    out.cumulative.assign(bounds.size() + 1, 0);
+    out.sum = static_cast<double>(hdr.sum_ns) / 1e9;
+
+    std::size_t b = 0;
+    uint64_t running = 0;
+    for (std::size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+        if (hdr.buckets[i] == 0) continue;
+        const double upper_s = static_cast<double>(LatencyHistogram::bucket_lower_bound(i) +
+                                                   LatencyHistogram::bucket_width(i)) / 1e9;
+        while (b < bounds.size() && upper_s > bounds[b]) {
+            out.cumulative[b++] = running;
+        }
+        running += hdr.buckets[i];
+    }
+    while (b < bounds.size()) {
+        out.cumulative[b++] = running;
+    }
+    out.cumulative[bounds.size()] = hdr.count;
+    return out;
+}
+
+} // namespace
+
+// ============================================================
+// Counter / Histogram
+// ============================================================
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    std::sort(bounds_.begin(), bounds_.end());
+    bounds_.erase(std::unique(bounds_.begin(), bounds_.end()), bounds_.end());
+    for (auto& shard : shards_) {
+        shard.counts = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+    }
+}
+
+void Histogram::observe(double v) {
+    const std::size_t bucket = static_cast<std::size_t>(
+        std::lower_bound(bounds_.begin(), bounds_.end(), v) - bounds_.begin());
+    auto& shard = shards_[metrics_detail::shard_index()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(v, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot s;
+    s.bounds = bounds_;
+    s.cumulative.assign(bounds_.size() + 1, 0);
+    for (const auto& shard : shards_) {
+        for (std::size_t i = 0; i <= bounds_.size(); ++i) {
+            s.cumulative[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        s.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < s.cumulative.size(); ++i) {
+        s.cumulative[i] += s.cumulative[i - 1];
+    }
+    return s;
+}
+
+std::vector<double> Histogram::latency_bounds() {
+    return {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+            0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+}
+
+// ============================================================
+// MetricWriter
+// ============================================================
+
+MetricWriter::Family& MetricWriter::family(const std::string& name, const char* type, const std::string& help) {
+    auto& f = families_[MetricsRegistry::full_name(name)];
+    if (f.type.empty()) {
+        f.type = type;
+        f.help = help;
+    }
+    return f;
+}
+
+void MetricWriter::counter(const std::string& name, const std::string& help, double value,
+                           const MetricLabels& labels) {
+    family(name, "counter", help).samples.push_back(
+        MetricsRegistry::full_name(name) + format_labels(labels) + " " + format_value(value));
+}
+
+void MetricWriter::gauge(const std::string& name, const std::string& help, double value,
+                         const MetricLabels& labels) {
+    family(name, "gauge", help).samples.push_back(
+        MetricsRegistry::full_name(name) + format_labels(labels) + " " + format_value(value));
+}
+
+void MetricWriter::histogram(const std::string& name, const std::string& help,
+                             const Histogram::Snapshot& snapshot, const MetricLabels& labels) {
+    const std::string full = MetricsRegistry::full_name(name);
+    auto& f = family(name, "histogram", help);
+    for (std::size_t i = 0; i < snapshot.cumulative.size(); ++i) {
+        const std::string le = i < snapshot.bounds.size() ? format_value(snapshot.bounds[i]) : "+Inf";
+        f.samples.push_back(full + "_bucket" + format_labels(labels, "le", le) + " " +
+                            std::to_string(snapshot.cumulative[i]));
+    }
+    f.samples.push_back(full + "_sum" + format_labels(labels) + " " + format_value(snapshot.sum));
+    f.samples.push_back(full + "_count" + format_labels(labels) + " " +
+                        std::to_string(snapshot.cumulative.empty() ? 0 : snapshot.cumulative.back()));
+}
+
+std::string MetricWriter::render() const {
+    std::string out;
+    for (const auto& [name, f] : families_) {
+        out += "# HELP " + name + " " + escape_help(f.help) + "\n";
+        out += "# TYPE " + name + " " + f.type + "\n";
+        for (const auto& sample : f.samples) {
+            out += sample;
+            out.push_back('\n');
+        }
+    }
+    return out;
+}
+
+// ============================================================
+// MetricsRegistry
+// ============================================================
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+std::string MetricsRegistry::full_name(const std::string& name) {
+    return name.rfind("enose_", 0) == 0 ? name : "enose_" + name;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& e : counters_) {
+        if (e.name == name && e.labels == labels) return *e.metric;
+    }
+    counters_.push_back({name, help, labels, std::make_unique<Counter>()});
+    return *counters_.back().metric;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& e : gauges_) {
+        if (e.name == name && e.labels == labels) return *e.metric;
+    }
+    gauges_.push_back({name, help, labels, std::make_unique<Gauge>()});
+    return *gauges_.back().metric;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                      std::vector<double> bounds, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& e : histograms_) {
+        if (e.name == name && e.labels == labels) return *e.metric;
+    }
+    histograms_.push_back({name, help, labels, std::make_unique<Histogram>(std::move(bounds))});
+    return *histograms_.back().metric;
+}
+
+MetricsRegistry::Registration MetricsRegistry::add_collector(Collector collector) {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    const uint64_t id = next_collector_id_++;
+    collectors_.emplace(id, std::move(collector));
+    return Registration(this, id);
+}
+
+void MetricsRegistry::remove_collector(uint64_t id) {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    collectors_.erase(id);
+}
+
+std::string MetricsRegistry::scrape() const {
+    MetricWriter writer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& e : counters_) {
+            writer.counter(e.name, e.help, static_cast<double>(e.metric->value()), e.labels);
+        }
+        for (const auto& e : gauges_) {
+            writer.gauge(e.name, e.help, e.metric->value(), e.labels);
+        }
+        for (const auto& e : histograms_) {
+            writer.histogram(e.name, e.help, e.metric->snapshot(), e.labels);
+        }
+    }
+
+    // 热路径各阶段延迟 (LatencyTracer, 与 ControlService.GetLatencyStats 同源)
+    const auto& tracer = LatencyTracer::instance();
+    const auto bounds = Histogram::latency_bounds();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(LatencyStage::COUNT); ++i) {
+        const auto stage = static_cast<LatencyStage>(i);
+        writer.histogram("pipeline_latency_seconds",
+                         "Sensor data latency from serial receive to each pipeline stage",
+                         to_prometheus(tracer.histogram(stage).snapshot(), bounds),
+                         {{"stage", latency_stage_name(stage)}});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(collectors_mutex_);
+        for (const auto& [id, collector] : collectors_) {
+            collector(writer);
+        }
+    }
+    return writer.render();
+}
+
+MetricsRegistry::Registration& MetricsRegistry::Registration::operator=(Registration&& other) noexcept {
+    if (this != &other) {
+        reset();
+        registry_ = other.registry_;
+        id_ = other.id_;
+        other.registry_ = nullptr;
+        other.id_ = 0;
+    }
+    return *this;
+}
+
+void MetricsRegistry::Registration::reset() {
+    if (registry_) {
+        registry_->remove_collector(id_);
+        registry_ = nullptr;
+        id_ = 0;
+    }
+}
+
+} // namespace core
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace core {
+
+/**
+ * @brief 指标标签, 按给定顺序输出 (如 {{"stage", "decode"}})
+ */
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+
+constexpr std::size_t SHARDS = 8;
+
+// 每个线程固定写一个分片, 热路径上不同线程互不争用同一缓存行
+std::size_t shard_index();
+
+struct alignas(64) ShardCell {
+    std::atomic<uint64_t> value{0};
+};
+
+} // namespace metrics_detail
+
+/**
+ * @brief 单调递增计数器 (按线程分片, inc 只做一次 relaxed 原子加)
+ */
+class Counter {
+public:
+    void inc(uint64_t n = 1) {
+        shards_[metrics_detail::shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    std::array<metrics_detail::ShardCell, metrics_detail::SHARDS> shards_{};
+};
+
+/**
+ * @brief 可增可减的瞬时值
+ */
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    void add(double v) { value_.fetch_add(v, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{0.0};
+};
+
+/**
+ * @brief 固定桶 (上界, 单位与观测值相同) 的直方图, 按线程分片
+ */
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<uint64_t> cumulative;   // 与 bounds 对应, 末尾一项为 +Inf (= count)
+        double sum = 0.0;
+    };
+    Snapshot snapshot() const;
+
+    /** @brief 默认的延迟桶 (秒): 50µs ~ 10s */
+    static std::vector<double> latency_bounds();
+
+private:
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;   // bounds.size() + 1
+        std::atomic<double> sum{0.0};
+    };
+
+    std::vector<double> bounds_;
+    std::array<Shard, metrics_detail::SHARDS> shards_;
+};
+
+/**
+ * @brief 采集时输出的指标 (供 collector 回调写入组件已有的统计)
+ *
+ * 同名指标的所有样本在输出中连续排列并共用一条 HELP / TYPE
+ */
+class MetricWriter {
+public:
+    void counter(const std::string& name, const std::string& help, double value,
+                 const MetricLabels& labels = {});
+    void gauge(const std::string& name, const std::string& help, double value,
+               const MetricLabels& labels = {});
+    void histogram(const std::string& name, const std::string& help, const Histogram::Snapshot& snapshot,
+                   const MetricLabels& labels = {});
+
+    /** @brief Prometheus 文本格式 (0.0.4) */
+    std::string render() const;
+
+private:
+    struct Family {
+        std::string type;
+        std::string help;
+        std::vector<std::string> samples;
+    };
+
+    Family& family(const std::string& name, const char* type, const std::string& help);
+
+    std::map<std::string, Family> families_;
+};
+
+/**
+ * @brief 进程级指标注册表
+ *
+ * 热路径用 counter() / gauge() / histogram() 取得的引用直接更新 (注册时加锁, 之后无锁);
+ * 已有 stats() 的组件通过 add_collector() 在每次抓取时导出, 不改动其内部结构.
+ * 所有指标名自动加 "enose_" 前缀
+ */
+class MetricsRegistry {
+public:
+    using Collector = std::function<void(MetricWriter&)>;
+
+    /**
+     * @brief 移除 collector 的句柄; 析构时自动移除, 须在 collector 引用的对象销毁前析构
+     */
+    class Registration {
+    public:
+        Registration() = default;
+        Registration(MetricsRegistry* registry, uint64_t id) : registry_(registry), id_(id) {}
+        Registration(Registration&& other) noexcept { *this = std::move(other); }
+        Registration& operator=(Registration&& other) noexcept;
+        ~Registration() { reset(); }
+        Registration(const Registration&) = delete;
+        Registration& operator=(const Registration&) = delete;
+
+        void reset();
+
+    private:
+        MetricsRegistry* registry_ = nullptr;
+        uint64_t id_ = 0;
+    };
+
+    static MetricsRegistry& instance();
+
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help,
+                         std::vector<double> bounds = Histogram::latency_bounds(),
+                         const MetricLabels& labels = {});
+
+    [[nodiscard]] Registration add_collector(Collector collector);
+
+    /** @brief 生成完整的抓取结果 */
+    std::string scrape() const;
+
+    static std::string full_name(const std::string& name);
+
+private:
+    MetricsRegistry() = default;
+
+    void remove_collector(uint64_t id);
+
+    template<typename T>
+    struct Entry {
+        std::string name;
+        std::string help;
+        MetricLabels labels;
+        std::unique_ptr<T> metric;
+    };
+
+    mutable std::mutex mutex_;
+    std::deque<Entry<Counter>> counters_;
+    std::deque<Entry<Gauge>> gauges_;
+    std::deque<Entry<Histogram>> histograms_;
+
+    // collector 在抓取线程上调用; collectors_mutex_ 保证移除返回后不再被调用
+    mutable std::mutex collectors_mutex_;
+    std::map<uint64_t, Collector> collectors_;
+    uint64_t next_collector_id_ = 1;
+};
+
+} // namespace core
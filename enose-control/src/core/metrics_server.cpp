@@ -0,0 +1,146 @@
+#include "core/metrics_server.hpp"
+#include "core/metrics.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <memory>
+
+namespace core {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+constexpr auto SESSION_TIMEOUT = std::chrono::seconds(30);
+constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+} // namespace
+
+class MetricsServer::Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(tcp::socket socket, std::atomic<uint64_t>& scrapes)
+        : stream_(std::move(socket)), scrapes_(scrapes) {}
+
+    void start() { do_read(); }
+
+private:
+    void do_read() {
+        request_ = {};
+        stream_.expires_after(SESSION_TIMEOUT);
+        http::async_read(stream_, buffer_, request_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    self->close();
+                    return;
+                }
+                self->handle_request();
+            });
+    }
+
+    void handle_request() {
+        response_ = {};
+        response_.version(request_.version());
+        response_.keep_alive(request_.keep_alive());
+        response_.set(http::field::server, "enose-control");
+
+        const auto target = request_.target();
+        const bool is_metrics = target == "/metrics" || target.starts_with("/metrics?");
+        if (request_.method() != http::verb::get && request_.method() != http::verb::head) {
+            response_.result(http::status::method_not_allowed);
+            response_.set(http::field::allow, "GET, HEAD");
+        } else if (!is_metrics) {
+            response_.result(http::status::not_found);
+            response_.set(http::field::content_type, "text/plain");
+            response_.body() = "See /metrics\n";
+        } else {
+            ++scrapes_;
+            response_.result(http::status::ok);
+            response_.set(http::field::content_type, CONTENT_TYPE);
+            if (request_.method() == http::verb::get) {
+                response_.body() = MetricsRegistry::instance().scrape();
+            }
+        }
+        response_.prepare_payload();
+
+        http::async_write(stream_, response_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec || !self->response_.keep_alive()) {
+                    self->close();
+                    return;
+                }
+                self->do_read();
+            });
+    }
+
+    void close() {
+        beast::error_code ignored;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+        stream_.socket().close(ignored);
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+    std::atomic<uint64_t>& scrapes_;
+};
+
+MetricsServer::MetricsServer(std::string host, uint16_t port)
+    : host_(std::move(host)), port_(port), acceptor_(io_) {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::start() {
+    if (thread_.joinable()) return;
+
+    tcp::endpoint endpoint(boost::asio::ip::make_address(host_), port_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    port_ = acceptor_.local_endpoint().port();
+    do_accept();
+
+    io_.restart();
+    work_.emplace(io_.get_executor());
+    thread_ = std::thread([this] {
+        try {
+            io_.run();
+        } catch (const std::exception& e) {
+            spdlog::error("MetricsServer: io thread terminated: {}", e.what());
+        }
+    });
+    spdlog::info("MetricsServer: Serving Prometheus metrics on http://{}:{}/metrics", host_, port_);
+}
+
+void MetricsServer::stop() {
+    if (!thread_.joinable()) return;
+    boost::asio::post(io_, [this] {
+        beast::error_code ignored;
+        acceptor_.close(ignored);
+    });
+    work_.reset();
+    io_.stop();
+    thread_.join();
+}
+
+void MetricsServer::do_accept() {
+    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != boost::asio::error::operation_aborted) {
+                spdlog::warn("MetricsServer: Accept failed: {}", ec.message());
+                do_accept();
+            }
+            return;
+        }
+        std::make_shared<Session>(std::move(socket), scrapes_)->start();
+        do_accept();
+    });
+}
+
+} // namespace core
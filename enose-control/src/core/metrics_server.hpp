@@ -0,0 +1,49 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace core {
+
+/**
+ * @brief Prometheus 抓取端点: GET /metrics 返回 MetricsRegistry::scrape()
+ *
+ * 在独立线程和 io_context 上运行, 抓取 (遍历各组件的 stats) 不占用采集 io 线程.
+ * 只实现抓取需要的最小 HTTP/1.1 子集: 每个连接顺序处理请求, 支持 keep-alive
+ */
+class MetricsServer {
+public:
+    MetricsServer(std::string host, uint16_t port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /** @brief 绑定并开始接受连接; 失败时抛出异常 */
+    void start();
+    void stop();
+
+    /** @brief 实际监听端口 (配置为 0 时由系统分配) */
+    uint16_t port() const { return port_; }
+
+    uint64_t scrapes() const { return scrapes_; }
+
+private:
+    class Session;
+
+    void do_accept();
+
+    std::string host_;
+    uint16_t port_;
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::thread thread_;
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace core
@@ -0,0 +1,76 @@
+#include "core/priority_executor.hpp"
+#include <spdlog/spdlog.h>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+namespace core {
+
+PriorityExecutor::PriorityExecutor(Options options) : options_(std::move(options)) {}
+
+PriorityExecutor::~PriorityExecutor() {
+    stop();
+}
+
+void PriorityExecutor::start() {
+    if (thread_.joinable()) return;
+
+    io_.restart();
+    work_.emplace(io_.get_executor());
+    std::promise<void> ready;
+    auto started = ready.get_future();
+    thread_ = std::thread([this, &ready] {
+        apply_thread_options();
+        ready.set_value();
+        try {
+            io_.run();
+        } catch (const std::exception& e) {
+            spdlog::error("PriorityExecutor: {} terminated: {}", options_.name, e.what());
+        }
+    });
+    // 等调度参数生效后再返回, 之后投递的处理都在实时优先级上运行
+    started.wait();
+}
+
+void PriorityExecutor::stop() {
+    if (!thread_.joinable()) return;
+    work_.reset();
+    io_.stop();
+    thread_.join();
+}
+
+void PriorityExecutor::apply_thread_options() {
+    pthread_t self = pthread_self();
+    pthread_setname_np(self, options_.name.substr(0, 15).c_str());
+
+    if (options_.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(options_.cpu, &set);
+        if (int err = pthread_setaffinity_np(self, sizeof(set), &set); err != 0) {
+            spdlog::warn("PriorityExecutor: Could not pin {} to CPU {}: {}",
+                         options_.name, options_.cpu, std::strerror(err));
+        }
+    }
+
+    if (options_.priority <= 0) {
+        spdlog::info("PriorityExecutor: {} running with normal scheduling", options_.name);
+        return;
+    }
+
+    sched_param param{};
+    param.sched_priority = std::clamp(options_.priority,
+                                      sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+    if (int err = pthread_setschedparam(self, SCHED_FIFO, &param); err != 0) {
+        // 常见于未授予 CAP_SYS_NICE 的服务 (systemd: AmbientCapabilities=CAP_SYS_NICE 或 LimitRTPRIO=)
+        spdlog::warn("PriorityExecutor: SCHED_FIFO {} unavailable for {} ({}), using normal scheduling",
+                     param.sched_priority, options_.name, std::strerror(err));
+        return;
+    }
+    realtime_ = true;
+    spdlog::info("PriorityExecutor: {} running with SCHED_FIFO priority {}", options_.name, param.sched_priority);
+}
+
+} // namespace core
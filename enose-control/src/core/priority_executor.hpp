@@ -0,0 +1,51 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace core {
+
+/**
+ * @brief 安全路径专用的执行器: 独立 io_context + 单线程, 尽量以 SCHED_FIFO 运行
+ *
+ * 只承载短小、有界的处理 (称重溢出判定等). 主 io 线程池被大消息解析或慢回调占满时,
+ * 投递到这里的处理仍在实时优先级上立即得到调度. 进程没有 CAP_SYS_NICE / RLIMIT_RTPRIO
+ * 时退回普通调度并告警, 功能不受影响.
+ */
+class PriorityExecutor {
+public:
+    struct Options {
+        std::string name = "enose-safety";  // 线程名 (最长 15 字符)
+        int priority = 80;                  // SCHED_FIFO 优先级 1-99, 0 = 普通调度
+        int cpu = -1;                       // 绑定的 CPU 核, -1 = 不绑定
+    };
+
+    explicit PriorityExecutor(Options options);
+    ~PriorityExecutor();
+
+    PriorityExecutor(const PriorityExecutor&) = delete;
+    PriorityExecutor& operator=(const PriorityExecutor&) = delete;
+
+    void start();
+    void stop();
+
+    /** @brief 在执行线程上运行的 io_context, 组件在其上创建自己的 strand / 定时器 */
+    boost::asio::io_context& context() { return io_; }
+
+    /** @brief 实时调度是否生效 (start() 后有效) */
+    bool is_realtime() const { return realtime_; }
+
+private:
+    void apply_thread_options();
+
+    Options options_;
+    boost::asio::io_context io_;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::thread thread_;
+    std::atomic<bool> realtime_{false};
+};
+
+} // namespace core
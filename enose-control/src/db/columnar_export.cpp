@@ -0,0 +1,746 @@
+#include "columnar_export.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <span>
+
+#ifdef ENOSE_WITH_ARROW
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/ipc/writer.h>
+#include <arrow/util/compression.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#endif
+
+namespace db {
+
+const char* export_table_name(ExportTable table) {
+    switch (table) {
+        case ExportTable::SENSOR_READINGS: return "sensor_readings";
+        case ExportTable::FINGERPRINTS: return "fingerprints";
+        case ExportTable::WEIGHT_SAMPLES: return "weight_samples";
+        case ExportTable::EVENTS: return "events";
+        case ExportTable::STEPS: return "steps";
+    }
+    return "unknown";
+}
+
+ColumnarExporter::ColumnarExporter(std::shared_ptr<const RunExportSource> source, ColumnarExportOptions options)
+    : source_(std::move(source)), options_(std::move(options)) {
+    options_.batch_rows = std::max<std::size_t>(options_.batch_rows, 1);
+    options_.channels = std::clamp<std::size_t>(options_.channels, 1, SensorReadingRecord::MAX_CHANNELS);
+}
+
+#ifdef ENOSE_WITH_ARROW
+
+namespace {
+
+constexpr std::size_t index_of(ExportTable table) { return static_cast<std::size_t>(table); }
+
+int64_t unix_us(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+std::shared_ptr<arrow::DataType> time_type() { return arrow::timestamp(arrow::TimeUnit::MICRO, "UTC"); }
+std::shared_ptr<arrow::DataType> dict_type() { return arrow::dictionary(arrow::int32(), arrow::utf8()); }
+
+// 空字符串写为 null, 字典中不出现 ""
+arrow::Status append_dict(arrow::StringDictionary32Builder& builder, const std::string& value) {
+    return value.empty() ? builder.AppendNull() : builder.Append(value);
+}
+
+arrow::Status finish_into(arrow::ArrayBuilder& builder, arrow::ArrayVector& columns) {
+    ARROW_ASSIGN_OR_RAISE(auto array, builder.Finish());
+    columns.push_back(std::move(array));
+    return arrow::Status::OK();
+}
+
+// ---------------------------------------------------------------- 各表的 batch 构建
+
+class ReadingBatch {
+public:
+    ReadingBatch(std::size_t channels, std::shared_ptr<arrow::Schema> schema)
+        : channels_(channels), schema_(std::move(schema)), time_(time_type(), arrow::default_memory_pool()) {
+        for (std::size_t i = 0; i < channels_; ++i) {
+            raw_.push_back(std::make_unique<arrow::FloatBuilder>());
+            corrected_.push_back(std::make_unique<arrow::FloatBuilder>());
+        }
+    }
+
+    static std::shared_ptr<arrow::Schema> schema(std::size_t channels, int run_id) {
+        arrow::FieldVector fields{
+            arrow::field("time", time_type(), false),
+            arrow::field("frame_seq", arrow::uint64(), false),
+            arrow::field("device_tick", arrow::uint32(), false),
+            arrow::field("heater_step", arrow::uint8(), false),
+            arrow::field("run_tag", dict_type()),
+            arrow::field("phase", dict_type()),
+            arrow::field("gas_mode", dict_type()),
+        };
+        // s<i>: 原始值 (缺失为 NaN); c<i>: 漂移校正值, 该帧无校正时为 null
+        for (std::size_t i = 0; i < channels; ++i) {
+            fields.push_back(arrow::field("s" + std::to_string(i), arrow::float32(), false));
+        }
+        for (std::size_t i = 0; i < channels; ++i) {
+            fields.push_back(arrow::field("c" + std::to_string(i), arrow::float32()));
+        }
+        return arrow::schema(std::move(fields), arrow::key_value_metadata(
+            {"run_id", "channels"}, {std::to_string(run_id), std::to_string(channels)}));
+    }
+
+    arrow::Status append(const SensorReadingRecord& row) {
+        ARROW_RETURN_NOT_OK(time_.Append(unix_us(row.time)));
+        ARROW_RETURN_NOT_OK(frame_seq_.Append(row.frame_seq));
+        ARROW_RETURN_NOT_OK(device_tick_.Append(row.device_tick));
+        ARROW_RETURN_NOT_OK(heater_step_.Append(row.heater_step));
+        ARROW_RETURN_NOT_OK(append_dict(run_tag_, row.run_tag));
+        ARROW_RETURN_NOT_OK(append_dict(phase_, row.phase));
+        ARROW_RETURN_NOT_OK(append_dict(gas_mode_, row.gas_mode));
+        for (std::size_t i = 0; i < channels_; ++i) {
+            ARROW_RETURN_NOT_OK(raw_[i]->Append(row.channels[i]));
+            ARROW_RETURN_NOT_OK(row.corrected ? corrected_[i]->Append((*row.corrected)[i]) : corrected_[i]->AppendNull());
+        }
+        ++rows_;
+        return arrow::Status::OK();
+    }
+
+    int64_t size() const { return rows_; }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> finish() {
+        arrow::ArrayVector columns;
+        for (arrow::ArrayBuilder* builder : std::initializer_list<arrow::ArrayBuilder*>{
+                 &time_, &frame_seq_, &device_tick_, &heater_step_, &run_tag_, &phase_, &gas_mode_}) {
+            ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        }
+        for (auto& builder : raw_) ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        for (auto& builder : corrected_) ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        auto batch = arrow::RecordBatch::Make(schema_, rows_, std::move(columns));
+        rows_ = 0;
+        return batch;
+    }
+
+private:
+    std::size_t channels_;
+    std::shared_ptr<arrow::Schema> schema_;
+    arrow::TimestampBuilder time_;
+    arrow::UInt64Builder frame_seq_;
+    arrow::UInt32Builder device_tick_;
+    arrow::UInt8Builder heater_step_;
+    arrow::StringDictionary32Builder run_tag_;
+    arrow::StringDictionary32Builder phase_;
+    arrow::StringDictionary32Builder gas_mode_;
+    std::vector<std::unique_ptr<arrow::FloatBuilder>> raw_;
+    std::vector<std::unique_ptr<arrow::FloatBuilder>> corrected_;
+    int64_t rows_ = 0;
+};
+
+class FingerprintBatch {
+public:
+    FingerprintBatch(const hal::FingerprintConfig& config, std::shared_ptr<arrow::Schema> schema)
+        : cells_(static_cast<int32_t>(config.steps) * config.sensors), schema_(std::move(schema)),
+          time_(time_type(), arrow::default_memory_pool()),
+          resistance_values_(std::make_shared<arrow::FloatBuilder>()),
+          normalized_values_(std::make_shared<arrow::FloatBuilder>()),
+          resistance_(arrow::default_memory_pool(), resistance_values_, cells_),
+          normalized_(arrow::default_memory_pool(), normalized_values_, cells_) {}
+
+    // 矩阵按行主序 (step × sensor) 展平为定长列表, 步数和传感器数记在 schema 元数据中
+    static std::shared_ptr<arrow::Schema> schema(const hal::FingerprintConfig& config, int run_id) {
+        const int32_t cells = static_cast<int32_t>(config.steps) * config.sensors;
+        return arrow::schema({
+            arrow::field("time", time_type(), false),
+            arrow::field("cycle_seq", arrow::uint64(), false),
+            arrow::field("first_frame_seq", arrow::uint64(), false),
+            arrow::field("last_frame_seq", arrow::uint64(), false),
+            arrow::field("run_tag", dict_type()),
+            arrow::field("phase", dict_type()),
+            arrow::field("missing", arrow::uint32(), false),
+            arrow::field("resistance", arrow::fixed_size_list(arrow::float32(), cells), false),
+            arrow::field("normalized", arrow::fixed_size_list(arrow::float32(), cells), false),
+        }, arrow::key_value_metadata(
+            {"run_id", "steps", "sensors"},
+            {std::to_string(run_id), std::to_string(config.steps), std::to_string(config.sensors)}));
+    }
+
+    arrow::Status append(const hal::FingerprintMatrix& matrix, const SensorReadingRecord& row) {
+        ARROW_RETURN_NOT_OK(time_.Append(unix_us(row.time)));
+        ARROW_RETURN_NOT_OK(cycle_seq_.Append(matrix.cycle_seq));
+        ARROW_RETURN_NOT_OK(first_frame_seq_.Append(matrix.first_frame_seq));
+        ARROW_RETURN_NOT_OK(last_frame_seq_.Append(matrix.last_frame_seq));
+        ARROW_RETURN_NOT_OK(append_dict(run_tag_, row.run_tag));
+        ARROW_RETURN_NOT_OK(append_dict(phase_, row.phase));
+        ARROW_RETURN_NOT_OK(missing_.Append(matrix.missing));
+        ARROW_RETURN_NOT_OK(append_cells(resistance_, *resistance_values_, matrix.resistance,
+                                         std::numeric_limits<float>::quiet_NaN()));
+        ARROW_RETURN_NOT_OK(append_cells(normalized_, *normalized_values_, matrix.normalized, 0.0f));
+        ++rows_;
+        return arrow::Status::OK();
+    }
+
+    int64_t size() const { return rows_; }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> finish() {
+        arrow::ArrayVector columns;
+        for (arrow::ArrayBuilder* builder : std::initializer_list<arrow::ArrayBuilder*>{
+                 &time_, &cycle_seq_, &first_frame_seq_, &last_frame_seq_, &run_tag_, &phase_, &missing_,
+                 &resistance_, &normalized_}) {
+            ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        }
+        auto batch = arrow::RecordBatch::Make(schema_, rows_, std::move(columns));
+        rows_ = 0;
+        return batch;
+    }
+
+private:
+    // 提前完成的周期 (步号回绕) 单元数可能少于 steps × sensors, 不足部分补 fill
+    arrow::Status append_cells(arrow::FixedSizeListBuilder& list, arrow::FloatBuilder& values,
+                               const hal::FingerprintMatrix::Buffer& cells, float fill) {
+        ARROW_RETURN_NOT_OK(list.Append());
+        const auto n = std::min<std::size_t>(cells.size(), static_cast<std::size_t>(cells_));
+        ARROW_RETURN_NOT_OK(values.AppendValues(cells.data(), static_cast<int64_t>(n)));
+        for (auto i = static_cast<int32_t>(n); i < cells_; ++i) {
+            ARROW_RETURN_NOT_OK(values.Append(fill));
+        }
+        return arrow::Status::OK();
+    }
+
+    int32_t cells_;
+    std::shared_ptr<arrow::Schema> schema_;
+    arrow::TimestampBuilder time_;
+    arrow::UInt64Builder cycle_seq_;
+    arrow::UInt64Builder first_frame_seq_;
+    arrow::UInt64Builder last_frame_seq_;
+    arrow::StringDictionary32Builder run_tag_;
+    arrow::StringDictionary32Builder phase_;
+    arrow::UInt32Builder missing_;
+    std::shared_ptr<arrow::FloatBuilder> resistance_values_;
+    std::shared_ptr<arrow::FloatBuilder> normalized_values_;
+    arrow::FixedSizeListBuilder resistance_;
+    arrow::FixedSizeListBuilder normalized_;
+    int64_t rows_ = 0;
+};
+
+class WeightBatch {
+public:
+    explicit WeightBatch(std::shared_ptr<arrow::Schema> schema)
+        : schema_(std::move(schema)), time_(time_type(), arrow::default_memory_pool()) {}
+
+    static std::shared_ptr<arrow::Schema> schema(int run_id) {
+        return arrow::schema({
+            arrow::field("time", time_type(), false),
+            arrow::field("seq", arrow::int64(), false),
+            arrow::field("cycle", arrow::int32(), false),
+            arrow::field("phase", dict_type()),
+            arrow::field("weight", arrow::float32(), false),
+            arrow::field("is_stable", arrow::boolean(), false),
+            arrow::field("trend", dict_type()),
+        }, arrow::key_value_metadata({"run_id"}, {std::to_string(run_id)}));
+    }
+
+    arrow::Status append(const WeightSampleRecord& row) {
+        ARROW_RETURN_NOT_OK(time_.Append(unix_us(row.time)));
+        ARROW_RETURN_NOT_OK(seq_.Append(row.seq));
+        ARROW_RETURN_NOT_OK(cycle_.Append(row.cycle));
+        ARROW_RETURN_NOT_OK(append_dict(phase_, row.phase));
+        ARROW_RETURN_NOT_OK(weight_.Append(row.weight));
+        ARROW_RETURN_NOT_OK(is_stable_.Append(row.is_stable));
+        ARROW_RETURN_NOT_OK(append_dict(trend_, row.trend));
+        ++rows_;
+        return arrow::Status::OK();
+    }
+
+    int64_t size() const { return rows_; }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> finish() {
+        arrow::ArrayVector columns;
+        for (arrow::ArrayBuilder* builder : std::initializer_list<arrow::ArrayBuilder*>{
+                 &time_, &seq_, &cycle_, &phase_, &weight_, &is_stable_, &trend_}) {
+            ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        }
+        auto batch = arrow::RecordBatch::Make(schema_, rows_, std::move(columns));
+        rows_ = 0;
+        return batch;
+    }
+
+private:
+    std::shared_ptr<arrow::Schema> schema_;
+    arrow::TimestampBuilder time_;
+    arrow::Int64Builder seq_;
+    arrow::Int32Builder cycle_;
+    arrow::StringDictionary32Builder phase_;
+    arrow::FloatBuilder weight_;
+    arrow::BooleanBuilder is_stable_;
+    arrow::StringDictionary32Builder trend_;
+    int64_t rows_ = 0;
+};
+
+class EventBatch {
+public:
+    explicit EventBatch(std::shared_ptr<arrow::Schema> schema)
+        : schema_(std::move(schema)), time_(time_type(), arrow::default_memory_pool()) {}
+
+    static std::shared_ptr<arrow::Schema> schema(int run_id) {
+        return arrow::schema({
+            arrow::field("time", time_type(), false),
+            arrow::field("level", dict_type()),
+            arrow::field("source", dict_type()),
+            arrow::field("message", arrow::utf8(), false),
+            arrow::field("context", arrow::utf8()),     // JSON, 记录日志中的事件没有 context
+        }, arrow::key_value_metadata({"run_id"}, {std::to_string(run_id)}));
+    }
+
+    arrow::Status append(const SystemLogRecord& row) {
+        ARROW_RETURN_NOT_OK(time_.Append(unix_us(row.time)));
+        ARROW_RETURN_NOT_OK(append_dict(level_, row.level));
+        ARROW_RETURN_NOT_OK(append_dict(source_, row.source));
+        ARROW_RETURN_NOT_OK(message_.Append(row.message));
+        ARROW_RETURN_NOT_OK(row.context_json.empty() ? context_.AppendNull() : context_.Append(row.context_json));
+        ++rows_;
+        return arrow::Status::OK();
+    }
+
+    int64_t size() const { return rows_; }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> finish() {
+        arrow::ArrayVector columns;
+        for (arrow::ArrayBuilder* builder : std::initializer_list<arrow::ArrayBuilder*>{
+                 &time_, &level_, &source_, &message_, &context_}) {
+            ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        }
+        auto batch = arrow::RecordBatch::Make(schema_, rows_, std::move(columns));
+        rows_ = 0;
+        return batch;
+    }
+
+private:
+    std::shared_ptr<arrow::Schema> schema_;
+    arrow::TimestampBuilder time_;
+    arrow::StringDictionary32Builder level_;
+    arrow::StringDictionary32Builder source_;
+    arrow::StringBuilder message_;
+    arrow::StringBuilder context_;
+    int64_t rows_ = 0;
+};
+
+// phase 连续相同的行合并为一个阶段; seq 为 frame_seq (读数) 或 seq (称重样本)
+class StepBatch {
+public:
+    explicit StepBatch(std::shared_ptr<arrow::Schema> schema)
+        : schema_(std::move(schema)), start_(time_type(), arrow::default_memory_pool()),
+          end_(time_type(), arrow::default_memory_pool()) {}
+
+    static std::shared_ptr<arrow::Schema> schema(int run_id, const char* derived_from) {
+        return arrow::schema({
+            arrow::field("step", arrow::uint32(), false),
+            arrow::field("phase", dict_type()),
+            arrow::field("start_time", time_type(), false),
+            arrow::field("end_time", time_type(), false),
+            arrow::field("first_seq", arrow::int64(), false),
+            arrow::field("last_seq", arrow::int64(), false),
+            arrow::field("rows", arrow::uint64(), false),
+        }, arrow::key_value_metadata({"run_id", "derived_from"}, {std::to_string(run_id), derived_from}));
+    }
+
+    arrow::Status observe(const std::chrono::system_clock::time_point& time, const std::string& phase, int64_t seq) {
+        if (open_ && phase == current_.phase) {
+            current_.end_us = unix_us(time);
+            current_.last_seq = seq;
+            ++current_.rows;
+            return arrow::Status::OK();
+        }
+        ARROW_RETURN_NOT_OK(close());
+        current_ = Step{phase, unix_us(time), unix_us(time), seq, seq, 1};
+        open_ = true;
+        return arrow::Status::OK();
+    }
+
+    arrow::Status close() {
+        if (!open_) return arrow::Status::OK();
+        open_ = false;
+        ARROW_RETURN_NOT_OK(step_.Append(next_step_++));
+        ARROW_RETURN_NOT_OK(append_dict(phase_, current_.phase));
+        ARROW_RETURN_NOT_OK(start_.Append(current_.start_us));
+        ARROW_RETURN_NOT_OK(end_.Append(current_.end_us));
+        ARROW_RETURN_NOT_OK(first_seq_.Append(current_.first_seq));
+        ARROW_RETURN_NOT_OK(last_seq_.Append(current_.last_seq));
+        ARROW_RETURN_NOT_OK(row_count_.Append(current_.rows));
+        ++size_;
+        return arrow::Status::OK();
+    }
+
+    bool empty() const { return next_step_ == 0 && !open_; }
+    int64_t size() const { return size_; }
+
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> finish() {
+        arrow::ArrayVector columns;
+        for (arrow::ArrayBuilder* builder : std::initializer_list<arrow::ArrayBuilder*>{
+                 &step_, &phase_, &start_, &end_, &first_seq_, &last_seq_, &row_count_}) {
+            ARROW_RETURN_NOT_OK(finish_into(*builder, columns));
+        }
+        auto batch = arrow::RecordBatch::Make(schema_, size_, std::move(columns));
+        size_ = 0;
+        return batch;
+    }
+
+private:
+    struct Step {
+        std::string phase;
+        int64_t start_us = 0;
+        int64_t end_us = 0;
+        int64_t first_seq = 0;
+        int64_t last_seq = 0;
+        uint64_t rows = 0;
+    };
+
+    std::shared_ptr<arrow::Schema> schema_;
+    Step current_;
+    bool open_ = false;
+    uint32_t next_step_ = 0;
+    int64_t size_ = 0;
+    arrow::UInt32Builder step_;
+    arrow::StringDictionary32Builder phase_;
+    arrow::TimestampBuilder start_;
+    arrow::TimestampBuilder end_;
+    arrow::Int64Builder first_seq_;
+    arrow::Int64Builder last_seq_;
+    arrow::UInt64Builder row_count_;
+};
+
+// ---------------------------------------------------------------- 写出端
+
+class TableWriter {
+public:
+    virtual ~TableWriter() = default;
+    virtual arrow::Status write(const arrow::RecordBatch& batch) = 0;
+    virtual arrow::Status close() = 0;
+};
+
+using WriterFactory = std::function<arrow::Result<std::unique_ptr<TableWriter>>(
+    ExportTable, const std::shared_ptr<arrow::Schema>&)>;
+
+// IPC 写出的字节先留在缓冲中, 每个 batch 写完后整段取走
+class ChunkBuffer final : public arrow::io::OutputStream {
+public:
+    using arrow::io::OutputStream::Write;
+
+    arrow::Status Write(const void* data, int64_t nbytes) override {
+        buffer_.append(static_cast<const char*>(data), static_cast<std::size_t>(nbytes));
+        position_ += nbytes;
+        return arrow::Status::OK();
+    }
+    arrow::Status Close() override {
+        closed_ = true;
+        return arrow::Status::OK();
+    }
+    arrow::Result<int64_t> Tell() const override { return position_; }
+    bool closed() const override { return closed_; }
+
+    std::string take() {
+        std::string out;
+        out.swap(buffer_);
+        return out;
+    }
+
+private:
+    std::string buffer_;
+    int64_t position_ = 0;
+    bool closed_ = false;
+};
+
+class IpcTableWriter final : public TableWriter {
+public:
+    static arrow::Result<std::unique_ptr<TableWriter>> open(
+        ExportTable table, const std::shared_ptr<arrow::Schema>& schema, const ColumnarExporter::ChunkSink& sink) {
+        auto buffer = std::make_shared<ChunkBuffer>();
+        ARROW_ASSIGN_OR_RAISE(auto writer, arrow::ipc::MakeStreamWriter(buffer, schema));
+        return std::unique_ptr<TableWriter>(new IpcTableWriter(table, std::move(buffer), std::move(writer), sink));
+    }
+
+    arrow::Status write(const arrow::RecordBatch& batch) override {
+        ARROW_RETURN_NOT_OK(writer_->WriteRecordBatch(batch));
+        return emit(static_cast<uint64_t>(batch.num_rows()), false);
+    }
+
+    arrow::Status close() override {
+        ARROW_RETURN_NOT_OK(writer_->Close());
+        return emit(0, true);
+    }
+
+private:
+    IpcTableWriter(ExportTable table, std::shared_ptr<ChunkBuffer> buffer,
+                   std::shared_ptr<arrow::ipc::RecordBatchWriter> writer, const ColumnarExporter::ChunkSink& sink)
+        : table_(table), buffer_(std::move(buffer)), writer_(std::move(writer)), sink_(sink) {}
+
+    arrow::Status emit(uint64_t rows, bool last) {
+        const auto bytes = buffer_->take();
+        if (!sink_(table_, bytes, rows, last)) {
+            return arrow::Status::Cancelled("client disconnected");
+        }
+        return arrow::Status::OK();
+    }
+
+    ExportTable table_;
+    std::shared_ptr<ChunkBuffer> buffer_;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer_;
+    const ColumnarExporter::ChunkSink& sink_;
+};
+
+class ParquetTableWriter final : public TableWriter {
+public:
+    static arrow::Result<std::unique_ptr<TableWriter>> open(
+        const std::shared_ptr<arrow::Schema>& schema, const std::string& path,
+        const std::shared_ptr<parquet::WriterProperties>& properties) {
+        const std::string temp = path + ".tmp";
+        ARROW_ASSIGN_OR_RAISE(auto out, arrow::io::FileOutputStream::Open(temp));
+        // store_schema: 读回时还原 dictionary / 时区等 Arrow 类型
+        auto arrow_properties = parquet::ArrowWriterProperties::Builder().store_schema()->build();
+        ARROW_ASSIGN_OR_RAISE(auto writer, parquet::arrow::FileWriter::Open(
+            *schema, arrow::default_memory_pool(), out, properties, arrow_properties));
+        return std::unique_ptr<TableWriter>(new ParquetTableWriter(path, temp, std::move(out), std::move(writer)));
+    }
+
+    ~ParquetTableWriter() override {
+        if (!closed_) {
+            std::error_code ec;
+            (void)out_->Close();
+            std::filesystem::remove(temp_, ec);
+        }
+    }
+
+    arrow::Status write(const arrow::RecordBatch& batch) override {
+        return writer_->WriteRecordBatch(batch);
+    }
+
+    arrow::Status close() override {
+        ARROW_RETURN_NOT_OK(writer_->Close());
+        ARROW_RETURN_NOT_OK(out_->Close());
+        std::error_code ec;
+        std::filesystem::rename(temp_, path_, ec);
+        if (ec) {
+            return arrow::Status::IOError("rename ", temp_, ": ", ec.message());
+        }
+        closed_ = true;
+        return arrow::Status::OK();
+    }
+
+private:
+    ParquetTableWriter(std::string path, std::string temp, std::shared_ptr<arrow::io::FileOutputStream> out,
+                       std::unique_ptr<parquet::arrow::FileWriter> writer)
+        : path_(std::move(path)), temp_(std::move(temp)), out_(std::move(out)), writer_(std::move(writer)) {}
+
+    std::string path_;
+    std::string temp_;
+    std::shared_ptr<arrow::io::FileOutputStream> out_;
+    std::unique_ptr<parquet::arrow::FileWriter> writer_;
+    bool closed_ = false;
+};
+
+// ---------------------------------------------------------------- 导出流程
+
+template <typename Batch>
+arrow::Status flush(Batch& batch, TableWriter* writer, uint64_t& rows) {
+    if (!writer || batch.size() == 0) return arrow::Status::OK();
+    ARROW_ASSIGN_OR_RAISE(auto record_batch, batch.finish());
+    ARROW_RETURN_NOT_OK(writer->write(*record_batch));
+    rows += static_cast<uint64_t>(record_batch->num_rows());
+    return arrow::Status::OK();
+}
+
+arrow::Status export_run(const RunExportSource& source, const ColumnarExportOptions& options,
+                         const RunExportScope& scope, const WriterFactory& open,
+                         const ColumnarExporter::CancelCheck& cancelled, ColumnarExportResult& result) {
+    auto wanted = [&](ExportTable table) {
+        return options.tables.empty() ||
+               std::find(options.tables.begin(), options.tables.end(), table) != options.tables.end();
+    };
+    auto check_cancelled = [&]() {
+        return cancelled && cancelled() ? arrow::Status::Cancelled("export cancelled") : arrow::Status::OK();
+    };
+    auto& rows = result.rows;
+    std::array<std::unique_ptr<TableWriter>, EXPORT_TABLE_COUNT> writers;
+    const int run_id = scope.run_id;
+
+    const auto reading_schema = ReadingBatch::schema(options.channels, run_id);
+    const auto fingerprint_schema = FingerprintBatch::schema(options.fingerprint, run_id);
+    const auto weight_schema = WeightBatch::schema(run_id);
+    const auto event_schema = EventBatch::schema(run_id);
+    if (wanted(ExportTable::SENSOR_READINGS)) {
+        ARROW_ASSIGN_OR_RAISE(writers[index_of(ExportTable::SENSOR_READINGS)], open(ExportTable::SENSOR_READINGS, reading_schema));
+    }
+    if (wanted(ExportTable::FINGERPRINTS)) {
+        ARROW_ASSIGN_OR_RAISE(writers[index_of(ExportTable::FINGERPRINTS)], open(ExportTable::FINGERPRINTS, fingerprint_schema));
+    }
+    if (wanted(ExportTable::WEIGHT_SAMPLES)) {
+        ARROW_ASSIGN_OR_RAISE(writers[index_of(ExportTable::WEIGHT_SAMPLES)], open(ExportTable::WEIGHT_SAMPLES, weight_schema));
+    }
+    if (wanted(ExportTable::EVENTS)) {
+        ARROW_ASSIGN_OR_RAISE(writers[index_of(ExportTable::EVENTS)], open(ExportTable::EVENTS, event_schema));
+    }
+    auto* reading_writer = writers[index_of(ExportTable::SENSOR_READINGS)].get();
+    auto* fingerprint_writer = writers[index_of(ExportTable::FINGERPRINTS)].get();
+    auto* weight_writer = writers[index_of(ExportTable::WEIGHT_SAMPLES)].get();
+    auto* event_writer = writers[index_of(ExportTable::EVENTS)].get();
+    const bool want_steps = wanted(ExportTable::STEPS);
+
+    // 读数: sensor_readings + fingerprints + steps 共用一遍扫描
+    StepBatch reading_steps(StepBatch::schema(run_id, "sensor_readings"));
+    if (reading_writer || fingerprint_writer || want_steps) {
+        if (auto cursor = source.sensor_readings(scope, options.origin, options.batch_rows)) {
+            ReadingBatch readings(options.channels, reading_schema);
+            FingerprintBatch fingerprints(options.fingerprint, fingerprint_schema);
+            hal::FingerprintAssembler assembler(options.fingerprint);
+            const std::size_t sensors = assembler.config().sensors;
+            std::vector<SensorReadingRecord> page;
+            while (cursor->next(page)) {
+                ARROW_RETURN_NOT_OK(check_cancelled());
+                for (const auto& row : page) {
+                    if (reading_writer) ARROW_RETURN_NOT_OK(readings.append(row));
+                    if (fingerprint_writer) {
+                        const auto& channels = options.fingerprint_drift_corrected && row.corrected ? *row.corrected : row.channels;
+                        const auto* matrix = assembler.push_row(row.frame_seq, row.device_tick, row.heater_step,
+                                                                std::span<const float>(channels.data(), sensors));
+                        if (matrix) ARROW_RETURN_NOT_OK(fingerprints.append(*matrix, row));
+                    }
+                    if (want_steps) {
+                        ARROW_RETURN_NOT_OK(reading_steps.observe(row.time, row.phase, static_cast<int64_t>(row.frame_seq)));
+                    }
+                }
+                ARROW_RETURN_NOT_OK(flush(readings, reading_writer, rows[index_of(ExportTable::SENSOR_READINGS)]));
+                if (fingerprints.size() >= static_cast<int64_t>(options.batch_rows)) {
+                    ARROW_RETURN_NOT_OK(flush(fingerprints, fingerprint_writer, rows[index_of(ExportTable::FINGERPRINTS)]));
+                }
+            }
+            ARROW_RETURN_NOT_OK(flush(fingerprints, fingerprint_writer, rows[index_of(ExportTable::FINGERPRINTS)]));
+        }
+    }
+
+    // 称重样本; 运行没有传感器读数时阶段边界改由称重样本的 phase 得出
+    const bool steps_from_weights = want_steps && reading_steps.empty();
+    StepBatch weight_steps(StepBatch::schema(run_id, "weight_samples"));
+    if (weight_writer || steps_from_weights) {
+        if (auto cursor = source.weight_samples(scope, options.origin, options.batch_rows)) {
+            WeightBatch weights(weight_schema);
+            std::vector<WeightSampleRecord> page;
+            while (cursor->next(page)) {
+                ARROW_RETURN_NOT_OK(check_cancelled());
+                for (const auto& row : page) {
+                    if (weight_writer) ARROW_RETURN_NOT_OK(weights.append(row));
+                    if (steps_from_weights) ARROW_RETURN_NOT_OK(weight_steps.observe(row.time, row.phase, row.seq));
+                }
+                ARROW_RETURN_NOT_OK(flush(weights, weight_writer, rows[index_of(ExportTable::WEIGHT_SAMPLES)]));
+            }
+        }
+    }
+
+    if (event_writer) {
+        if (auto cursor = source.events(scope, options.origin, options.batch_rows)) {
+            EventBatch events(event_schema);
+            std::vector<SystemLogRecord> page;
+            while (cursor->next(page)) {
+                ARROW_RETURN_NOT_OK(check_cancelled());
+                for (const auto& row : page) {
+                    ARROW_RETURN_NOT_OK(events.append(row));
+                }
+                ARROW_RETURN_NOT_OK(flush(events, event_writer, rows[index_of(ExportTable::EVENTS)]));
+            }
+        }
+    }
+
+    // 阶段边界行数很少, 最后一次写出
+    if (want_steps) {
+        auto& steps = steps_from_weights ? weight_steps : reading_steps;
+        ARROW_RETURN_NOT_OK(steps.close());
+        ARROW_ASSIGN_OR_RAISE(writers[index_of(ExportTable::STEPS)],
+            open(ExportTable::STEPS, StepBatch::schema(run_id, steps_from_weights ? "weight_samples" : "sensor_readings")));
+        ARROW_RETURN_NOT_OK(flush(steps, writers[index_of(ExportTable::STEPS)].get(), rows[index_of(ExportTable::STEPS)]));
+    }
+
+    for (auto& writer : writers) {
+        if (writer) ARROW_RETURN_NOT_OK(writer->close());
+    }
+    return arrow::Status::OK();
+}
+
+void finish_result(const arrow::Status& status, ColumnarExportResult& result) {
+    result.ok = status.ok();
+    result.cancelled = status.IsCancelled();
+    if (!status.ok()) {
+        result.error = status.ToString();
+    }
+}
+
+} // namespace
+
+bool ColumnarExporter::available() {
+    return true;
+}
+
+ColumnarExportResult ColumnarExporter::stream(const RunExportScope& scope, const ChunkSink& sink,
+                                              const CancelCheck& cancelled) const {
+    ColumnarExportResult result;
+    WriterFactory open = [&sink](ExportTable table, const std::shared_ptr<arrow::Schema>& schema) {
+        return IpcTableWriter::open(table, schema, sink);
+    };
+    finish_result(export_run(*source_, options_, scope, open, cancelled, result), result);
+    return result;
+}
+
+ColumnarExportResult ColumnarExporter::write_parquet(const RunExportScope& scope, const std::string& directory,
+                                                     const CancelCheck& cancelled) const {
+    ColumnarExportResult result;
+    const auto run_dir = std::filesystem::path(directory) / ("run-" + std::to_string(scope.run_id));
+    std::error_code ec;
+    std::filesystem::create_directories(run_dir, ec);
+    if (ec) {
+        result.error = "cannot create " + run_dir.string() + ": " + ec.message();
+        return result;
+    }
+
+    parquet::WriterProperties::Builder builder;
+    builder.max_row_group_length(static_cast<int64_t>(std::max<std::size_t>(options_.parquet_row_group_rows, 1)));
+    auto codec = arrow::util::Codec::GetCompressionType(options_.parquet_compression);
+    if (codec.ok() && arrow::util::Codec::IsAvailable(*codec)) {
+        builder.compression(*codec);
+    } else {
+        spdlog::warn("ColumnarExporter: Parquet compression '{}' unavailable, writing uncompressed",
+                     options_.parquet_compression);
+    }
+    const auto properties = builder.build();
+
+    WriterFactory open = [&](ExportTable table, const std::shared_ptr<arrow::Schema>& schema) {
+        const auto path = (run_dir / (std::string(export_table_name(table)) + ".parquet")).string();
+        result.files.emplace_back(table, path);
+        return ParquetTableWriter::open(schema, path, properties);
+    };
+    finish_result(export_run(*source_, options_, scope, open, cancelled, result), result);
+    if (!result.ok) {
+        result.files.clear();
+    }
+    return result;
+}
+
+#else // ENOSE_WITH_ARROW
+
+bool ColumnarExporter::available() {
+    return false;
+}
+
+ColumnarExportResult ColumnarExporter::stream(const RunExportScope&, const ChunkSink&, const CancelCheck&) const {
+    ColumnarExportResult result;
+    result.error = "built without Apache Arrow";
+    return result;
+}
+
+ColumnarExportResult ColumnarExporter::write_parquet(const RunExportScope&, const std::string&,
+                                                     const CancelCheck&) const {
+    ColumnarExportResult result;
+    result.error = "built without Apache Arrow / Parquet";
+    return result;
+}
+
+#endif // ENOSE_WITH_ARROW
+
+} // namespace db
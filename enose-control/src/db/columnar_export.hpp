@@ -0,0 +1,87 @@
+#pragma once
+
+#include "run_export.hpp"
+#include "../hal/fingerprint_assembler.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace db {
+
+enum class ExportTable : uint8_t {
+    SENSOR_READINGS,
+    FINGERPRINTS,       // 由读数按 FingerprintAssembler 重建的 加热步 × 传感器 矩阵
+    WEIGHT_SAMPLES,
+    EVENTS,             // 运行时间范围内的 system_logs
+    STEPS,              // 阶段边界: 读数 (无读数时为称重样本) 中 phase 连续相同的区间
+};
+
+constexpr std::size_t EXPORT_TABLE_COUNT = 5;
+
+const char* export_table_name(ExportTable table);
+
+struct ColumnarExportOptions {
+    std::vector<ExportTable> tables;        // 空 = 全部
+    RunExportSource::Origin origin = RunExportSource::Origin::DATABASE;
+    std::size_t batch_rows = 4096;          // 每个 record batch 的行数, 也是游标的页大小
+    std::size_t channels = 16;              // sensor_readings 导出的通道列数 (s0.., c0..)
+    hal::FingerprintConfig fingerprint;
+    bool fingerprint_drift_corrected = false;
+    std::string parquet_compression = "zstd";   // 不可用时退回不压缩
+    std::size_t parquet_row_group_rows = 65536; // 行组越大, 写入时缓存的列页越多
+};
+
+struct ColumnarExportResult {
+    bool ok = false;
+    bool cancelled = false;
+    std::string error;
+    std::array<uint64_t, EXPORT_TABLE_COUNT> rows{};    // 按 ExportTable 下标
+    std::vector<std::pair<ExportTable, std::string>> files; // write_parquet 写出的文件
+};
+
+/**
+ * @brief 把一个运行导出为 Apache Arrow 列式数据
+ *
+ * 每张表一个 schema (时间列为 timestamp[us, UTC], phase / run_tag / gas_mode / level 等重复
+ * 字符串为 dictionary<int32, utf8>). 读数只读一遍: 同一遍中按批写出 sensor_readings,
+ * 喂给 FingerprintAssembler 得到 fingerprints, 并累计 steps; 之后依次读称重样本和系统日志.
+ * 游标每读一页就转成一个 record batch 写出, 内存占用只与 batch_rows 有关.
+ *
+ * stream(): 每张表写成一条 Arrow IPC stream, 每写出一个 batch 就把新增的字节交给 sink;
+ * 同一表的各段按顺序拼接即为完整的流 (首段含 schema, 末段 last=true 含结束标记).
+ * 不同表的段可能交错. write_parquet(): 每张表写一个 Parquet 文件 (先写临时文件再改名).
+ *
+ * 编译时未找到 Arrow / Parquet (未定义 ENOSE_WITH_ARROW) 时 available() 为 false,
+ * 两个导出函数直接返回错误.
+ */
+class ColumnarExporter {
+public:
+    using ChunkSink = std::function<bool(ExportTable table, std::string_view bytes, uint64_t rows, bool last)>;
+    using CancelCheck = std::function<bool()>;
+
+    static bool available();
+
+    ColumnarExporter(std::shared_ptr<const RunExportSource> source, ColumnarExportOptions options);
+
+    /** @brief sink 返回 false (客户端断开) 或 cancelled() 为真时停止 */
+    ColumnarExportResult stream(const RunExportScope& scope, const ChunkSink& sink,
+                                const CancelCheck& cancelled = {}) const;
+
+    /** @brief 写入 directory/run-<run_id>/<table>.parquet */
+    ColumnarExportResult write_parquet(const RunExportScope& scope, const std::string& directory,
+                                       const CancelCheck& cancelled = {}) const;
+
+    const ColumnarExportOptions& options() const { return options_; }
+
+private:
+    std::shared_ptr<const RunExportSource> source_;
+    ColumnarExportOptions options_;
+};
+
+} // namespace db
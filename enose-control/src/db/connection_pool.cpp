@@ -1,6 +1,8 @@
 #include "connection_pool.hpp"
+#include "prepared_statements.hpp"
 #include <spdlog/spdlog.h>
-#include <chrono>
+#include <algorithm>
+#include <vector>
 
 namespace db {
 
@@ -14,110 +16,421 @@ ConnectionPool::~ConnectionPool() {
 }
 
 bool ConnectionPool::initialize(const std::string& connection_string, size_t pool_size) {
+    Options options;
+    options.min_size = pool_size;
+    options.max_size = pool_size;
+    return initialize(connection_string, options);
+}
+
+bool ConnectionPool::initialize(const std::string& connection_string, const Options& options) {
     std::lock_guard<std::mutex> lock(mutex_);
-    
+
     if (initialized_) {
         spdlog::warn("ConnectionPool already initialized");
         return true;
     }
-    
+
     connection_string_ = connection_string;
-    pool_size_ = pool_size;
+    options_ = options;
+    options_.max_size = std::max<size_t>(options_.max_size, 1);
+    options_.min_size = std::min(options_.min_size, options_.max_size);
     shutdown_ = false;
-    
-    spdlog::info("Initializing connection pool with {} connections", pool_size);
-    
+
+    spdlog::info("Initializing connection pool with {}..{} connections",
+                 options_.min_size, options_.max_size);
+
+    // 至少打开一条连接, 确认数据库可达
+    const size_t initial = std::max<size_t>(options_.min_size, 1);
     try {
-        for (size_t i = 0; i < pool_size; ++i) {
-            auto conn = std::make_unique<pqxx::connection>(connection_string);
+        for (size_t i = 0; i < initial; ++i) {
+            auto conn = open_connection();
             if (conn->is_open()) {
-                pool_.push(std::move(conn));
-                spdlog::debug("Created connection {}/{}", i + 1, pool_size);
+                idle_.push_back({std::move(conn), std::chrono::steady_clock::now()});
+                spdlog::debug("Created connection {}/{}", i + 1, initial);
             } else {
                 spdlog::error("Failed to open connection {}", i + 1);
+                idle_.clear();
                 return false;
             }
         }
-        
-        initialized_ = true;
-        spdlog::info("Connection pool initialized successfully");
-        return true;
     } catch (const std::exception& e) {
         spdlog::error("Failed to initialize connection pool: {}", e.what());
+        idle_.clear();
         return false;
     }
+
+    total_ = idle_.size();
+    created_ += total_;
+    healthy_ = true;
+    initialized_ = true;
+    maintenance_ = std::thread(&ConnectionPool::maintenance_loop, this);
+    spdlog::info("Connection pool initialized successfully");
+    return true;
 }
 
-void ConnectionPool::shutdown() {
+void ConnectionPool::start(const std::string& connection_string, const Options& options, Bootstrap bootstrap) {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (!initialized_) return;
-    
-    shutdown_ = true;
+
+    if (initialized_) {
+        spdlog::warn("ConnectionPool already initialized");
+        return;
+    }
+
+    connection_string_ = connection_string;
+    options_ = options;
+    options_.max_size = std::max<size_t>(options_.max_size, 1);
+    options_.min_size = std::min(options_.min_size, options_.max_size);
+    {
+        std::lock_guard<std::mutex> bootstrap_lock(bootstrap_mutex_);
+        bootstrap_ = std::move(bootstrap);
+    }
+    shutdown_ = false;
+    healthy_ = false;
+    initialized_ = true;
+    // 维护线程第一轮不等 health_check_interval, 立即开始预热
+    grow_requested_ = true;
+    maintenance_ = std::thread(&ConnectionPool::maintenance_loop, this);
+    spdlog::info("Connection pool warming up in background ({}..{} connections)",
+                 options_.min_size, options_.max_size);
+}
+
+void ConnectionPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!initialized_) return;
+
+        shutdown_ = true;
+        idle_.clear();
+        total_ = 0;
+        initialized_ = false;
+    }
     cv_.notify_all();
-    
-    while (!pool_.empty()) {
-        pool_.pop();
+    maintenance_cv_.notify_all();
+    if (maintenance_.joinable()) {
+        maintenance_.join();
     }
-    
-    initialized_ = false;
     spdlog::info("Connection pool shutdown");
 }
 
 ConnectionPool::ConnectionGuard ConnectionPool::acquire(int timeout_ms) {
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + std::chrono::milliseconds(timeout_ms);
     std::unique_lock<std::mutex> lock(mutex_);
-    
+
     if (!initialized_ || shutdown_) {
         spdlog::warn("Attempting to acquire connection from uninitialized/shutdown pool");
         return ConnectionGuard(*this, nullptr);
     }
-    
-    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
-    
-    while (pool_.empty() && !shutdown_) {
-        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
-            spdlog::warn("Connection acquire timeout after {}ms", timeout_ms);
+
+    while (!shutdown_) {
+        if (!idle_.empty()) {
+            auto conn = std::move(idle_.back().conn);
+            idle_.pop_back();
+            // 已知断开的连接直接丢弃, 由下一轮新建或等待
+            if (!conn->is_open()) {
+                --total_;
+                ++discarded_;
+                continue;
+            }
+            record_wait(started);
+            return ConnectionGuard(*this, std::move(conn));
+        }
+
+        // 数据库不可达: 立即失败, 不让调用方等到超时
+        if (!healthy_) {
+            ++timeouts_;
+            return ConnectionGuard(*this, nullptr);
+        }
+
+        // 唯一的空闲连接正在被健康检查 ping: 等它回来, 不为此新建连接
+        if (total_ < options_.max_size && !pinging_) {
+            auto conn = grow(lock, deadline);
+            if (!conn) {
+                ++timeouts_;
+                return ConnectionGuard(*this, nullptr);
+            }
+            record_wait(started);
+            return ConnectionGuard(*this, std::move(conn));
+        }
+
+        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout && idle_.empty()) {
+            spdlog::warn("Connection acquire timeout after {}ms ({} in use)", timeout_ms, total_);
+            ++timeouts_;
             return ConnectionGuard(*this, nullptr);
         }
     }
-    
-    if (shutdown_ || pool_.empty()) {
+
+    return ConnectionGuard(*this, nullptr);
+}
+
+ConnectionPool::ConnectionGuard ConnectionPool::try_acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!initialized_ || shutdown_) {
         return ConnectionGuard(*this, nullptr);
     }
-    
-    auto conn = std::move(pool_.front());
-    pool_.pop();
-    
-    // 检查连接是否仍然有效
-    try {
+
+    while (!idle_.empty()) {
+        auto conn = std::move(idle_.back().conn);
+        idle_.pop_back();
         if (!conn->is_open()) {
-            spdlog::warn("Connection was closed, reconnecting...");
-            conn = std::make_unique<pqxx::connection>(connection_string_);
+            --total_;
+            ++discarded_;
+            continue;
         }
+        ++acquired_;
+        return ConnectionGuard(*this, std::move(conn));
+    }
+
+    if (total_ < options_.max_size) {
+        grow_requested_ = true;
+        maintenance_cv_.notify_one();
+    }
+    return ConnectionGuard(*this, nullptr);
+}
+
+std::future<ConnectionPool::ConnectionGuard> ConnectionPool::acquire_async(int timeout_ms) {
+    return std::async(std::launch::async, [this, timeout_ms] { return acquire(timeout_ms); });
+}
+
+std::unique_ptr<pqxx::connection> ConnectionPool::open_connection(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+    std::string connection_string = connection_string_;
+    if (deadline && connection_string.find("://") == std::string::npos) {
+        // 关键字形式的连接串中靠后的同名参数生效; libpq 的 connect_timeout 以秒计, 最小 1
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            *deadline - std::chrono::steady_clock::now()).count();
+        connection_string += " connect_timeout=" + std::to_string(std::max<int64_t>(1, (remaining + 999) / 1000));
+    }
+    auto conn = std::make_unique<pqxx::connection>(connection_string);
+    if (conn->is_open()) {
+        // 并发新建的连接在这里等待 bootstrap 完成, 预处理语句可能依赖它创建的对象
+        std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+        if (bootstrap_) {
+            auto bootstrap = std::move(bootstrap_);
+            bootstrap_ = nullptr;
+            bootstrap(*conn);
+        }
+    }
+    if (conn->is_open()) {
+        prepare_statements(*conn);
+    }
+    return conn;
+}
+
+std::unique_ptr<pqxx::connection> ConnectionPool::grow(std::unique_lock<std::mutex>& lock,
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+    if (deadline && std::chrono::steady_clock::now() >= *deadline) return nullptr;
+    ++total_;
+    lock.unlock();
+
+    std::unique_ptr<pqxx::connection> conn;
+    try {
+        conn = open_connection(deadline);
+        if (!conn->is_open()) conn.reset();
     } catch (const std::exception& e) {
-        spdlog::error("Failed to verify/reconnect: {}", e.what());
-        return ConnectionGuard(*this, nullptr);
+        spdlog::debug("ConnectionPool: Failed to open connection: {}", e.what());
+    }
+
+    lock.lock();
+    if (!conn) {
+        --total_;
+        if (healthy_.exchange(false)) {
+            spdlog::warn("ConnectionPool: Database unreachable, failing acquires fast until it recovers");
+        } else if (created_ == 0 && !reported_unreachable_) {
+            reported_unreachable_ = true;
+            spdlog::warn("ConnectionPool: Database not reachable yet, retrying every {}ms",
+                         options_.health_check_interval.count());
+        }
+        // 让等待中的调用方立即失败
+        cv_.notify_all();
+        return nullptr;
+    }
+
+    const bool first = created_++ == 0;
+    if (!healthy_.exchange(true)) {
+        if (first) {
+            spdlog::info("ConnectionPool: First connection established");
+        } else {
+            spdlog::info("ConnectionPool: Database reachable again");
+        }
     }
-    
-    return ConnectionGuard(*this, std::move(conn));
+    return conn;
 }
 
 void ConnectionPool::release(std::unique_ptr<pqxx::connection> conn) {
     if (!conn) return;
-    
+
     std::lock_guard<std::mutex> lock(mutex_);
-    
+
     if (shutdown_) {
         return;
     }
-    
-    pool_.push(std::move(conn));
+
+    // 查询中断开的连接, 以及 resize 缩小上限后多出的连接不再放回
+    if (!conn->is_open() || total_ > options_.max_size) {
+        --total_;
+        ++discarded_;
+        cv_.notify_one();
+        return;
+    }
+
+    idle_.push_back({std::move(conn), std::chrono::steady_clock::now()});
     cv_.notify_one();
 }
 
+void ConnectionPool::resize(size_t min_size, size_t max_size) {
+    std::deque<IdleConnection> closing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_.max_size = std::max<size_t>(max_size, 1);
+        options_.min_size = std::min(min_size, options_.max_size);
+        // 最旧的空闲连接在队首
+        while (total_ > options_.max_size && !idle_.empty()) {
+            closing.push_back(std::move(idle_.front()));
+            idle_.pop_front();
+            --total_;
+            ++discarded_;
+        }
+        spdlog::info("ConnectionPool: Resized to min={}, max={} ({} open)",
+                     options_.min_size, options_.max_size, total_);
+    }
+    // 扩大上限后等待中的 acquire 可以新建连接; 补足下限在下一个维护周期进行
+    cv_.notify_all();
+    // closing 在锁外析构, 关闭连接
+}
+
+void ConnectionPool::record_wait(std::chrono::steady_clock::time_point started) {
+    const auto waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count());
+    ++acquired_;
+    total_wait_us_ += waited;
+    uint64_t prev = max_wait_us_;
+    while (waited > prev && !max_wait_us_.compare_exchange_weak(prev, waited)) {}
+}
+
+void ConnectionPool::maintenance_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shutdown_) {
+        maintenance_cv_.wait_for(lock, options_.health_check_interval,
+                                 [this] { return shutdown_ || grow_requested_; });
+        if (shutdown_) break;
+
+        bool grow_requested = grow_requested_;
+        grow_requested_ = false;
+        if (!grow_requested) {
+            lock.unlock();
+            check_idle_connections();
+            lock.lock();
+        }
+
+        // 补足 min_size; 响应 try_acquire 的扩容请求; unhealthy 时试连一条探测恢复
+        while (!shutdown_) {
+            const bool below_min = total_ < options_.min_size;
+            const bool can_grow = total_ < options_.max_size;
+            const bool wanted = grow_requested && idle_.empty();
+            if (!below_min && !(can_grow && (wanted || !healthy_))) break;
+
+            auto conn = grow(lock);
+            if (!conn) break;  // 仍不可达, 下个周期再试
+            if (shutdown_) break;
+            idle_.push_back({std::move(conn), std::chrono::steady_clock::now()});
+            cv_.notify_one();
+            grow_requested = false;
+        }
+    }
+}
+
+void ConnectionPool::check_idle_connections() {
+    // 逐条取出 ping, 同一时刻只有一条空闲连接不在 idle_ 中; 本轮开始时的条数为上限
+    size_t remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remaining = idle_.size();
+    }
+
+    size_t closed = 0;
+    size_t broken = 0;
+    for (; remaining > 0; --remaining) {
+        IdleConnection idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shutdown_ || idle_.empty()) break;
+            // 最旧的在队首; 超出 min_size 的长期空闲连接直接回收 (resize 可能并发修改 options_)
+            idle = std::move(idle_.front());
+            idle_.pop_front();
+            if (std::chrono::steady_clock::now() - idle.since > options_.idle_timeout &&
+                total_ > options_.min_size) {
+                --total_;
+                ++discarded_;
+                ++closed;
+                continue;   // 连接在解锁后随 idle 析构关闭
+            }
+            pinging_ = true;
+        }
+
+        bool ok = false;
+        try {
+            pqxx::nontransaction txn(*idle.conn);
+            txn.exec("SELECT 1");
+            ok = true;
+        } catch (const std::exception& e) {
+            spdlog::debug("ConnectionPool: Idle connection failed health check: {}", e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        pinging_ = false;
+        if (shutdown_) return;
+        if (ok) {
+            // 放回队尾 (本轮不会再取到它), 保留原来的空闲起始时间供回收判断
+            idle_.push_back(std::move(idle));
+            if (!healthy_.exchange(true)) {
+                spdlog::info("ConnectionPool: Database reachable again");
+            }
+        } else {
+            --total_;
+            ++discarded_;
+            ++broken;
+        }
+        cv_.notify_all();
+    }
+
+    if (broken > 0) {
+        spdlog::warn("ConnectionPool: Replaced {} broken idle connection(s)", broken);
+    }
+    if (closed > 0) {
+        spdlog::debug("ConnectionPool: Closed {} idle connection(s) above min_size", closed);
+    }
+}
+
 size_t ConnectionPool::available_count() const {
     std::lock_guard<std::mutex> lock(mutex_);
-    return pool_.size();
+    return idle_.size();
+}
+
+size_t ConnectionPool::total_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const {
+    Stats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.total = total_;
+        s.idle = idle_.size();
+        s.in_use = total_ - std::min(total_, idle_.size());
+        s.max_size = options_.max_size;
+    }
+    s.healthy = healthy_;
+    s.acquired = acquired_;
+    s.timeouts = timeouts_;
+    s.created = created_;
+    s.discarded = discarded_;
+    s.total_wait_us = total_wait_us_;
+    s.max_wait_us = max_wait_us_;
+    return s;
 }
 
 // ConnectionGuard implementation
@@ -3,70 +3,173 @@
 #include <pqxx/pqxx>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <deque>
 #include <condition_variable>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <optional>
+#include <thread>
 
 namespace db {
 
+/**
+ * @brief 弹性 PostgreSQL 连接池
+ *
+ * 连接数在 [min_size, max_size] 之间伸缩: 没有空闲连接时按需新建, 超过 min_size
+ * 且空闲超过 idle_timeout 的连接由后台线程关闭. 后台线程同时定期逐条 ping 空闲连接,
+ * 替换失效的连接 (TimescaleDB 重启后自动恢复); 正在 ping 的连接对 acquire 仍算可用,
+ * 等它归还而不是新建.
+ *
+ * 数据库不可达时池标记为 unhealthy, acquire 立即失败而不是等待超时,
+ * 实验线程不会因为数据库重启而停顿; 后台线程恢复连接后自动转为 healthy.
+ *
+ * start() 不等待数据库: 池立即可用 (unhealthy, acquire 快速失败), 由后台线程预热.
+ * 服务启动因此不受数据库慢或不可达影响.
+ */
 class ConnectionPool {
 public:
+    struct Options {
+        size_t min_size = 1;
+        size_t max_size = 5;
+        std::chrono::milliseconds health_check_interval{5000};
+        std::chrono::seconds idle_timeout{60};
+    };
+
+    struct Stats {
+        size_t total = 0;           // 已打开的连接 (含使用中)
+        size_t idle = 0;
+        size_t in_use = 0;
+        size_t max_size = 0;
+        bool healthy = false;
+        uint64_t acquired = 0;
+        uint64_t timeouts = 0;      // 超时或因 unhealthy 快速失败
+        uint64_t created = 0;
+        uint64_t discarded = 0;     // 失效或空闲回收而关闭的连接
+        uint64_t total_wait_us = 0; // 成功获取的累计等待时间
+        uint64_t max_wait_us = 0;
+    };
+
+    // 首条连接建立后、预处理语句之前执行一次 (建表 / 策略等); 不得抛出
+    using Bootstrap = std::function<void(pqxx::connection&)>;
+
     static ConnectionPool& instance();
-    
-    // 初始化连接池
+
+    // 初始化连接池 (固定大小, min = max = pool_size)
     bool initialize(const std::string& connection_string, size_t pool_size = 5);
-    
+
+    // 初始化连接池 (弹性大小); 预先打开 min_size 条连接, 任一失败则初始化失败
+    bool initialize(const std::string& connection_string, const Options& options);
+
+    // 启动连接池但不等待连接: 后台线程立即开始打开 min_size 条连接, 不可达时按
+    // health_check_interval 重试; 预热完成前 acquire 快速失败
+    void start(const std::string& connection_string, const Options& options, Bootstrap bootstrap = nullptr);
+
+    // 在线调整连接数上下限 (配置热加载); 超出新上限的空闲连接立即关闭,
+    // 使用中的在归还时关闭; 低于新下限时由后台线程在下一个维护周期补足
+    void resize(size_t min_size, size_t max_size);
+
+    // 至少成功打开过一条连接
+    bool is_warm() const { return created_ > 0; }
+
     // 关闭连接池
     void shutdown();
-    
+
     // 获取连接 (RAII wrapper)
     class ConnectionGuard {
     public:
         ConnectionGuard(ConnectionPool& pool, std::unique_ptr<pqxx::connection> conn);
         ~ConnectionGuard();
-        
+
         ConnectionGuard(const ConnectionGuard&) = delete;
         ConnectionGuard& operator=(const ConnectionGuard&) = delete;
         ConnectionGuard(ConnectionGuard&& other) noexcept;
         ConnectionGuard& operator=(ConnectionGuard&& other) noexcept;
-        
+
         pqxx::connection& get() { return *conn_; }
         pqxx::connection* operator->() { return conn_.get(); }
         bool valid() const { return conn_ != nullptr; }
-        
+
     private:
         ConnectionPool* pool_;
         std::unique_ptr<pqxx::connection> conn_;
     };
-    
-    // 获取连接 (阻塞，带超时)
+
+    // 获取连接 (阻塞，带超时); 池 unhealthy 时立即返回无效连接
     ConnectionGuard acquire(int timeout_ms = 5000);
-    
+
+    // 只取现成的空闲连接, 从不等待也不新建 (需要扩容时通知后台线程)
+    ConnectionGuard try_acquire();
+
+    // 在后台线程中执行 acquire(timeout_ms)
+    std::future<ConnectionGuard> acquire_async(int timeout_ms = 5000);
+
     // 检查是否已初始化
     bool is_initialized() const { return initialized_; }
-    
+
+    // 最近一次连接 / 健康检查是否成功
+    bool is_healthy() const { return healthy_; }
+
     // 获取连接池状态
     size_t available_count() const;
-    size_t total_count() const { return pool_size_; }
-    
+    size_t total_count() const;
+    Stats stats() const;
+
 private:
+    struct IdleConnection {
+        std::unique_ptr<pqxx::connection> conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
     ConnectionPool() = default;
     ~ConnectionPool();
-    
+
     ConnectionPool(const ConnectionPool&) = delete;
     ConnectionPool& operator=(const ConnectionPool&) = delete;
-    
+
     void release(std::unique_ptr<pqxx::connection> conn);
-    
+
+    // 打开新连接并注册预处理语句 (初始化、扩容和重连共用); 不持有 mutex_ 调用.
+    // 给定 deadline 时以剩余时间覆盖连接串中的 connect_timeout
+    std::unique_ptr<pqxx::connection> open_connection(
+        std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+
+    // 在 mutex_ 之外新建一条连接并计入 total_; 失败时把池标记为 unhealthy.
+    // deadline 已过时不尝试, 返回空且不改变健康状态
+    std::unique_ptr<pqxx::connection> grow(std::unique_lock<std::mutex>& lock,
+        std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+
+    void record_wait(std::chrono::steady_clock::time_point started);
+    void maintenance_loop();
+    void check_idle_connections();
+
     std::string connection_string_;
-    size_t pool_size_{0};
+    Options options_;
+    std::mutex bootstrap_mutex_;
+    Bootstrap bootstrap_;                   // 执行后清空
+    bool reported_unreachable_{false};      // 预热阶段的不可达只告警一次
     std::atomic<bool> initialized_{false};
     std::atomic<bool> shutdown_{false};
-    
+    std::atomic<bool> healthy_{false};
+
     mutable std::mutex mutex_;
-    std::condition_variable cv_;
-    std::queue<std::unique_ptr<pqxx::connection>> pool_;
+    std::condition_variable cv_;            // 有连接归还 / 关闭
+    std::condition_variable maintenance_cv_;
+    std::deque<IdleConnection> idle_;       // 队尾为最近归还的连接
+    size_t total_{0};                       // 已打开 + 正在打开的连接数
+    bool pinging_{false};                   // 维护线程正在 ping 一条空闲连接 (不在 idle_ 中, 仍算可用)
+    bool grow_requested_{false};
+    std::thread maintenance_;
+
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> created_{0};
+    std::atomic<uint64_t> discarded_{0};
+    std::atomic<uint64_t> total_wait_us_{0};
+    std::atomic<uint64_t> max_wait_us_{0};
 };
 
 } // namespace db
@@ -0,0 +1,303 @@
+#include "consumable_cache.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace db {
+
+namespace {
+
+constexpr auto LISTEN_RECONNECT_DELAY = std::chrono::seconds(5);
+
+class ChangeReceiver final : public pqxx::notification_receiver {
+public:
+    ChangeReceiver(pqxx::connection& conn, ConsumableCache& cache)
+        : pqxx::notification_receiver(conn, ConsumableCache::NOTIFY_CHANNEL), cache_(cache) {}
+
+    void operator()(const std::string& payload, int) override {
+        spdlog::debug("ConsumableCache: {} changed", payload);
+        cache_.invalidate();
+    }
+
+private:
+    ConsumableCache& cache_;
+};
+
+} // namespace
+
+// ============================================================
+// Snapshot
+// ============================================================
+
+const LiquidRecord* ConsumableCache::Snapshot::find_liquid(int id) const {
+    for (const auto& liquid : catalog.liquids) {
+        if (liquid.id == id) return &liquid;
+    }
+    return nullptr;
+}
+
+const PumpAssignmentRecord* ConsumableCache::Snapshot::find_pump_assignment(int pump_index) const {
+    for (const auto& assignment : catalog.pump_assignments) {
+        if (assignment.pump_index == pump_index) return &assignment;
+    }
+    return nullptr;
+}
+
+const ConsumableRecord* ConsumableCache::Snapshot::find_consumable(const std::string& id) const {
+    for (const auto& consumable : catalog.consumables) {
+        if (consumable.id == id) return &consumable;
+    }
+    return nullptr;
+}
+
+std::vector<LiquidRecord> ConsumableCache::Snapshot::list_liquids(
+    const std::string& type_filter, bool include_inactive, int limit, int offset) const {
+
+    std::vector<LiquidRecord> results;
+    int skipped = 0;
+    for (const auto& liquid : catalog.liquids) {
+        if (!type_filter.empty() && liquid.type != type_filter) continue;
+        if (!include_inactive && !liquid.is_active) continue;
+        if (skipped++ < offset) continue;
+        if (static_cast<int>(results.size()) >= limit) break;
+        results.push_back(liquid);
+    }
+    return results;
+}
+
+int ConsumableCache::Snapshot::count_liquids(const std::string& type_filter, bool include_inactive) const {
+    return static_cast<int>(std::count_if(catalog.liquids.begin(), catalog.liquids.end(),
+        [&](const LiquidRecord& liquid) {
+            return (type_filter.empty() || liquid.type == type_filter) &&
+                   (include_inactive || liquid.is_active);
+        }));
+}
+
+// ============================================================
+// ConsumableCache
+// ============================================================
+
+ConsumableCache::ConsumableCache(std::shared_ptr<ConsumableRepository> repo)
+    : repo_(std::move(repo)) {}
+
+ConsumableCache::~ConsumableCache() {
+    stop_listener();
+}
+
+std::shared_ptr<const ConsumableCache::Snapshot> ConsumableCache::snapshot() {
+    auto current = snapshot_.load(std::memory_order_acquire);
+    if (current && loaded_generation_.load(std::memory_order_acquire) == generation_.load(std::memory_order_acquire)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return current;
+    }
+
+    std::unique_lock<std::mutex> lock(load_mutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        // 另一个读者正在加载: 有旧快照时直接使用, 不排队等数据库
+        if (current) return current;
+        lock.lock();
+    }
+    // 其他读者可能已在等锁期间完成加载
+    current = snapshot_.load(std::memory_order_acquire);
+    const uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (current && loaded_generation_.load(std::memory_order_acquire) == generation) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return current;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now.time_since_epoch().count() < next_retry_.load(std::memory_order_acquire)) {
+        return current ? current : std::make_shared<const Snapshot>();
+    }
+
+    auto loaded = std::make_shared<Snapshot>();
+    if (!repo_->load_catalog(loaded->catalog)) {
+        load_failures_.fetch_add(1, std::memory_order_relaxed);
+        next_retry_.store((now + RETRY_INTERVAL).time_since_epoch().count(), std::memory_order_release);
+        spdlog::warn("ConsumableCache: Reload failed, serving {} snapshot",
+                     current ? "stale" : "empty");
+        return current ? current : std::make_shared<const Snapshot>();
+    }
+
+    loaded->version = next_version_++;
+    std::shared_ptr<const Snapshot> published = std::move(loaded);
+    snapshot_.store(published, std::memory_order_release);
+    // 加载期间发生的失效使 generation 前移, 下一次读取会再加载
+    loaded_generation_.store(generation, std::memory_order_release);
+    loads_.fetch_add(1, std::memory_order_relaxed);
+    spdlog::debug("ConsumableCache: Loaded snapshot v{} ({} liquids, {} pumps, {} consumables)",
+                  published->version, published->catalog.liquids.size(),
+                  published->catalog.pump_assignments.size(), published->catalog.consumables.size());
+    return published;
+}
+
+void ConsumableCache::invalidate() {
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+    invalidations_.fetch_add(1, std::memory_order_relaxed);
+    next_retry_.store(0, std::memory_order_release);
+}
+
+bool ConsumableCache::invalidate_if(bool changed) {
+    if (changed) invalidate();
+    return changed;
+}
+
+ConsumableCache::Stats ConsumableCache::stats() const {
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.loads = loads_.load(std::memory_order_relaxed);
+    s.load_failures = load_failures_.load(std::memory_order_relaxed);
+    s.invalidations = invalidations_.load(std::memory_order_relaxed);
+    if (auto current = snapshot_.load(std::memory_order_acquire)) {
+        s.version = current->version;
+    }
+    return s;
+}
+
+// ============================================================
+// LISTEN / NOTIFY
+// ============================================================
+
+void ConsumableCache::start_listener(const std::string& connection_string) {
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    if (listener_.joinable()) return;
+    listener_stopping_ = false;
+    listener_ = std::thread(&ConsumableCache::listener_loop, this, connection_string);
+}
+
+void ConsumableCache::stop_listener() {
+    {
+        std::lock_guard<std::mutex> lock(listener_mutex_);
+        if (!listener_.joinable()) return;
+        listener_stopping_ = true;
+    }
+    listener_cv_.notify_all();
+    listener_.join();
+}
+
+void ConsumableCache::listener_loop(std::string connection_string) {
+    while (!listener_stopping_) {
+        try {
+            pqxx::connection conn(connection_string);
+            ChangeReceiver receiver(conn, *this);
+            // 断线期间的通知已丢失
+            invalidate();
+            spdlog::info("ConsumableCache: Listening on {}", NOTIFY_CHANNEL);
+            while (!listener_stopping_) {
+                conn.await_notification(1, 0);
+            }
+            return;
+        } catch (const std::exception& e) {
+            spdlog::warn("ConsumableCache: LISTEN connection lost: {}", e.what());
+        }
+
+        std::unique_lock<std::mutex> lock(listener_mutex_);
+        listener_cv_.wait_for(lock, LISTEN_RECONNECT_DELAY, [this] { return listener_stopping_.load(); });
+    }
+}
+
+// ============================================================
+// 写穿透
+// ============================================================
+
+std::optional<int> ConsumableCache::create_liquid(const std::string& name, const std::string& type,
+                                                  const std::string& description, float density,
+                                                  const std::string& metadata_json) {
+    auto id = repo_->create_liquid(name, type, description, density, metadata_json);
+    invalidate_if(id.has_value());
+    return id;
+}
+
+bool ConsumableCache::update_liquid(int id, const std::string& name, const std::string& type,
+                                    const std::string& description, float density,
+                                    const std::string& metadata_json, bool is_active) {
+    return invalidate_if(repo_->update_liquid(id, name, type, description, density, metadata_json, is_active));
+}
+
+bool ConsumableCache::delete_liquid(int id) {
+    return invalidate_if(repo_->delete_liquid(id));
+}
+
+bool ConsumableCache::set_pump_assignment(int pump_index, std::optional<int> liquid_id, const std::string& notes,
+                                          std::optional<double> initial_volume_ml,
+                                          std::optional<double> low_volume_threshold_ml) {
+    return invalidate_if(repo_->set_pump_assignment(pump_index, liquid_id, notes,
+                                                    initial_volume_ml, low_volume_threshold_ml));
+}
+
+bool ConsumableCache::set_pump_volume(int pump_index, double initial_volume_ml,
+                                      std::optional<double> low_volume_threshold_ml, bool reset_consumed) {
+    return invalidate_if(repo_->set_pump_volume(pump_index, initial_volume_ml, low_volume_threshold_ml,
+                                                reset_consumed));
+}
+
+bool ConsumableCache::add_pump_consumption(int pump_index, double volume_ml, std::optional<int> experiment_id) {
+    return invalidate_if(repo_->add_pump_consumption(pump_index, volume_ml, experiment_id));
+}
+
+bool ConsumableCache::add_runtime(const std::string& id, int64_t seconds) {
+    return invalidate_if(repo_->add_runtime(id, seconds));
+}
+
+// ============================================================
+// 消耗账本
+// ============================================================
+
+void ConsumableCache::set_ledger(std::shared_ptr<ConsumableLedger> ledger) {
+    ledger_ = std::move(ledger);
+    if (ledger_) {
+        // 在账本线程上立即重新加载, 实验线程的余量检查不必等待数据库
+        ledger_->set_on_committed([this] {
+            invalidate();
+            snapshot();
+        });
+    }
+}
+
+void ConsumableCache::record_pump_consumption(int pump_index, double volume_ml, std::optional<int> experiment_id) {
+    if (ledger_) {
+        ledger_->add_pump_consumption(pump_index, volume_ml, experiment_id);
+    } else {
+        add_pump_consumption(pump_index, volume_ml, experiment_id);
+    }
+}
+
+void ConsumableCache::record_runtime(const std::string& id, int64_t seconds) {
+    if (ledger_) {
+        ledger_->add_runtime(id, seconds);
+    } else {
+        add_runtime(id, seconds);
+    }
+}
+
+void ConsumableCache::flush_ledger() {
+    if (ledger_) ledger_->flush();
+}
+
+PumpAssignmentRecord ConsumableCache::with_unflushed(PumpAssignmentRecord record) const {
+    if (ledger_) record.consumed_volume_ml += ledger_->unflushed_pump_ml(record.pump_index);
+    return record;
+}
+
+ConsumableRecord ConsumableCache::with_unflushed(ConsumableRecord record) const {
+    if (ledger_) record.accumulated_seconds += ledger_->unflushed_runtime(record.id);
+    return record;
+}
+
+std::optional<double> ConsumableCache::available_ml(int pump_index) const {
+    // 只读已发布的快照, 不在调用线程上重新加载
+    auto current = snapshot_.load(std::memory_order_acquire);
+    if (!current) return std::nullopt;
+    const auto* assignment = current->find_pump_assignment(pump_index);
+    if (!assignment || assignment->initial_volume_ml <= 0) return std::nullopt;
+    return with_unflushed(*assignment).remaining_volume_ml();
+}
+
+bool ConsumableCache::reset_consumable(const std::string& id, const std::string& notes) {
+    return invalidate_if(repo_->reset_consumable(id, notes));
+}
+
+bool ConsumableCache::update_lifetime(const std::string& id, int64_t lifetime_seconds) {
+    return invalidate_if(repo_->update_lifetime(id, lifetime_seconds));
+}
+
+} // namespace db
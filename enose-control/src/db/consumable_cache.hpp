@@ -0,0 +1,153 @@
+#pragma once
+
+#include "consumable_ledger.hpp"
+#include "consumable_repository.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief ConsumableRepository 前的进程内读穿透缓存
+ *
+ * 液体 / 泵配置 / 耗材一天只变动几次, 但 UI 持续轮询. 读取返回不可变的
+ * Snapshot (std::atomic<shared_ptr> 交换), 命中时不加锁也不访问数据库;
+ * 快照过期后由第一个读者在 load_mutex_ 下重新加载, 其他读者不等锁, 继续使用旧快照
+ * (只有从未加载成功时才等待). load_mutex_ 只串行化加载, 失效也不取锁.
+ *
+ * 失效来源:
+ *   - 经本类的写方法 (转发给同一个 ConsumableRepository 后立即失效)
+ *   - 其他工具改表: start_listener() 以 LISTEN consumables_changed 监听
+ *     (触发器见 docker/init-db/06-consumable-notify.sql)
+ *
+ * 元数据字段不缓存, 通过 repository() 直接访问.
+ *
+ * 设置了 ConsumableLedger 时, 实验线程的消耗 (record_*) 只记入账本, 由账本批量提交;
+ * with_unflushed() / available_ml() 把账本中尚未提交的量叠加到快照上.
+ */
+class ConsumableCache {
+public:
+    struct Snapshot {
+        uint64_t version = 0;  // 每次加载递增
+        ConsumableCatalog catalog;
+
+        const LiquidRecord* find_liquid(int id) const;
+        const PumpAssignmentRecord* find_pump_assignment(int pump_index) const;
+        const ConsumableRecord* find_consumable(const std::string& id) const;
+
+        // 与 ConsumableRepository::list_liquids / count_liquids 语义相同
+        std::vector<LiquidRecord> list_liquids(const std::string& type_filter, bool include_inactive,
+                                               int limit, int offset) const;
+        int count_liquids(const std::string& type_filter, bool include_inactive) const;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t loads = 0;
+        uint64_t load_failures = 0;
+        uint64_t invalidations = 0;
+        uint64_t version = 0;
+    };
+
+    explicit ConsumableCache(std::shared_ptr<ConsumableRepository> repo);
+    ~ConsumableCache();
+
+    ConsumableCache(const ConsumableCache&) = delete;
+    ConsumableCache& operator=(const ConsumableCache&) = delete;
+
+    /**
+     * @brief 当前快照; 过期时同步重新加载
+     *
+     * 加载失败时返回上一份快照 (可能过期), 从未加载成功时返回空快照.
+     * 失败后 RETRY_INTERVAL 内不再重试, 数据库不可用时读者不会排队等待.
+     */
+    std::shared_ptr<const Snapshot> snapshot();
+
+    /** @brief 标记快照过期, 下一次读取时重新加载 */
+    void invalidate();
+
+    /**
+     * @brief 启动 LISTEN 线程 (独立连接, 不占用连接池)
+     */
+    void start_listener(const std::string& connection_string);
+    void stop_listener();
+
+    Stats stats() const;
+
+    ConsumableRepository& repository() { return *repo_; }
+
+    // === 写穿透: 转发给仓库, 成功后失效 ===
+    std::optional<int> create_liquid(const std::string& name, const std::string& type,
+                                     const std::string& description, float density,
+                                     const std::string& metadata_json);
+    bool update_liquid(int id, const std::string& name, const std::string& type,
+                       const std::string& description, float density,
+                       const std::string& metadata_json, bool is_active);
+    bool delete_liquid(int id);
+
+    bool set_pump_assignment(int pump_index, std::optional<int> liquid_id, const std::string& notes,
+                             std::optional<double> initial_volume_ml = std::nullopt,
+                             std::optional<double> low_volume_threshold_ml = std::nullopt);
+    bool set_pump_volume(int pump_index, double initial_volume_ml,
+                         std::optional<double> low_volume_threshold_ml = std::nullopt,
+                         bool reset_consumed = true);
+    bool add_pump_consumption(int pump_index, double volume_ml,
+                              std::optional<int> experiment_id = std::nullopt);
+
+    bool add_runtime(const std::string& id, int64_t seconds);
+
+    // === 实验线程上的消耗: 有账本时只在内存中累加, 否则同步写库 ===
+    void set_ledger(std::shared_ptr<ConsumableLedger> ledger);
+    void record_pump_consumption(int pump_index, double volume_ml, std::optional<int> experiment_id = std::nullopt);
+    void record_runtime(const std::string& id, int64_t seconds);
+    /** @brief 步骤边界: 请求账本尽快提交 (不等待) */
+    void flush_ledger();
+
+    /** @brief 叠加账本中尚未提交的消耗量 / 运行时间 */
+    PumpAssignmentRecord with_unflushed(PumpAssignmentRecord record) const;
+    ConsumableRecord with_unflushed(ConsumableRecord record) const;
+
+    /** @brief 泵的实时余量 (ml), 不访问数据库; 未设置初始容量 (不跟踪余量) 或尚未加载快照时为空 */
+    std::optional<double> available_ml(int pump_index) const;
+
+    bool reset_consumable(const std::string& id, const std::string& notes);
+    bool update_lifetime(const std::string& id, int64_t lifetime_seconds);
+
+    static constexpr auto RETRY_INTERVAL = std::chrono::seconds(2);
+    static constexpr const char* NOTIFY_CHANNEL = "consumables_changed";
+
+private:
+    bool invalidate_if(bool changed);
+    void listener_loop(std::string connection_string);
+
+    std::shared_ptr<ConsumableRepository> repo_;
+    std::shared_ptr<ConsumableLedger> ledger_;  // 启动时设置一次
+
+    std::atomic<std::shared_ptr<const Snapshot>> snapshot_;
+    std::atomic<uint64_t> generation_{1};  // invalidate() 递增; 快照记录加载时的值
+    std::atomic<uint64_t> loaded_generation_{0};
+
+    std::mutex load_mutex_;                 // 串行化加载; 读者和 invalidate() 不等它
+    std::atomic<std::chrono::steady_clock::rep> next_retry_{0};  // 加载失败后的重试时刻
+    uint64_t next_version_{1};              // load_mutex_ 保护
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> loads_{0};
+    std::atomic<uint64_t> load_failures_{0};
+    std::atomic<uint64_t> invalidations_{0};
+
+    std::mutex listener_mutex_;
+    std::condition_variable listener_cv_;
+    std::atomic<bool> listener_stopping_{false};
+    std::thread listener_;
+};
+
+} // namespace db
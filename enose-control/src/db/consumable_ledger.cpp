@@ -0,0 +1,307 @@
+#include "consumable_ledger.hpp"
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace db {
+
+ConsumableLedger::ConsumableLedger(std::shared_ptr<ConsumableRepository> repo, Options options)
+    : repo_(std::move(repo))
+    , options_(std::move(options))
+    , active_path_(options_.directory + "/ledger.jsonl")
+    , flushing_path_(options_.directory + "/ledger.flushing.jsonl") {}
+
+ConsumableLedger::~ConsumableLedger() {
+    stop();
+}
+
+bool ConsumableLedger::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return true;
+
+    std::error_code ec;
+    std::filesystem::create_directories(options_.directory, ec);
+    if (ec) {
+        spdlog::error("ConsumableLedger: Cannot create {}: {}", options_.directory, ec.message());
+        return false;
+    }
+
+    // 上次退出时未提交的批次: 封存的按原 ID 重放, 当前批次继续累加
+    if (std::filesystem::exists(flushing_path_, ec)) {
+        ConsumptionBatch batch;
+        if (read_journal(flushing_path_, batch) && !batch.empty()) {
+            sealed_ = std::move(batch);
+            ++batches_replayed_;
+        } else {
+            std::filesystem::remove(flushing_path_, ec);
+        }
+    }
+    pending_ = ConsumptionBatch{};
+    if (std::filesystem::exists(active_path_, ec) && read_journal(active_path_, pending_) && !pending_.empty()) {
+        ++batches_replayed_;
+    }
+    if (pending_.id.empty()) {
+        pending_.id = new_batch_id();
+    }
+    std::string error;
+    if (!open_active_locked(&error)) {
+        spdlog::error("ConsumableLedger: {}", error);
+        return false;
+    }
+    if (batches_replayed_ > 0) {
+        spdlog::info("ConsumableLedger: Recovered {} uncommitted batch(es) from {}",
+                     batches_replayed_.load(), options_.directory);
+    }
+
+    stopping_ = false;
+    thread_ = std::thread(&ConsumableLedger::commit_loop, this);
+    return true;
+}
+
+void ConsumableLedger::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    // 提交线程已退出, 在调用线程上做最后一次提交 (失败时留给下次启动重放)
+    commit_once();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_) {
+        std::fflush(active_);
+        ::fdatasync(fileno(active_));
+        std::fclose(active_);
+        active_ = nullptr;
+    }
+}
+
+void ConsumableLedger::add_pump_consumption(int pump_index, double volume_ml, std::optional<int> experiment_id) {
+    if (pump_index < 0 || pump_index > 7 || !(volume_ml > 0)) return;
+
+    nlohmann::json line = {{"pump", pump_index}, {"ml", volume_ml}};
+    if (experiment_id) line["experiment_id"] = *experiment_id;
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.pump_ml[{pump_index, experiment_id}] += volume_ml;
+    append_locked(line.dump());
+    ++entries_recorded_;
+}
+
+void ConsumableLedger::add_runtime(const std::string& id, int64_t seconds) {
+    if (seconds <= 0) return;
+
+    const nlohmann::json line = {{"consumable", id}, {"seconds", seconds}};
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.runtime_seconds[id] += seconds;
+    append_locked(line.dump());
+    ++entries_recorded_;
+}
+
+void ConsumableLedger::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+    }
+    cv_.notify_all();
+}
+
+void ConsumableLedger::set_on_committed(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    on_committed_ = std::move(callback);
+}
+
+double ConsumableLedger::unflushed_pump_ml(int pump_index) const {
+    double total = 0;
+    auto add = [&](const ConsumptionBatch& batch) {
+        for (const auto& [key, volume_ml] : batch.pump_ml) {
+            if (key.first == pump_index) total += volume_ml;
+        }
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    add(pending_);
+    if (sealed_) add(*sealed_);
+    return total;
+}
+
+int64_t ConsumableLedger::unflushed_runtime(const std::string& id) const {
+    int64_t total = 0;
+    auto add = [&](const ConsumptionBatch& batch) {
+        auto it = batch.runtime_seconds.find(id);
+        if (it != batch.runtime_seconds.end()) total += it->second;
+    };
+    std::lock_guard<std::mutex> lock(mutex_);
+    add(pending_);
+    if (sealed_) add(*sealed_);
+    return total;
+}
+
+ConsumableLedger::Stats ConsumableLedger::stats() const {
+    Stats s;
+    s.entries_recorded = entries_recorded_;
+    s.batches_committed = batches_committed_;
+    s.commit_failures = commit_failures_;
+    s.batches_replayed = batches_replayed_;
+    s.last_commit_ms = last_commit_ms_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.commit_pending = sealed_.has_value();
+    return s;
+}
+
+void ConsumableLedger::commit_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, options_.flush_interval, [this] { return stopping_ || flush_requested_; });
+        if (stopping_) break;
+        flush_requested_ = false;
+        lock.unlock();
+        commit_once();
+        lock.lock();
+    }
+}
+
+bool ConsumableLedger::commit_once() {
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!sealed_ && !pending_.empty() && !seal_locked()) return false;
+        if (!sealed_) return true;
+        if (active_) fd = fileno(active_);
+    }
+    // active_ 只在提交线程 (或其退出后的 stop) 上关闭, 可以在锁外 fdatasync
+    if (fd >= 0) ::fdatasync(fd);
+
+    if (!ConnectionPool::instance().is_healthy()) return false;
+
+    const auto started = std::chrono::steady_clock::now();
+    if (!repo_->apply_consumption(*sealed_)) {
+        ++commit_failures_;
+        spdlog::warn("ConsumableLedger: Commit of batch {} failed, will retry", sealed_->id);
+        return false;
+    }
+    last_commit_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    ++batches_committed_;
+
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sealed_.reset();
+        std::error_code ec;
+        std::filesystem::remove(flushing_path_, ec);
+        callback = on_committed_;
+    }
+    if (callback) callback();
+    return true;
+}
+
+bool ConsumableLedger::seal_locked() {
+    if (active_) {
+        std::fflush(active_);
+        ::fdatasync(fileno(active_));
+        std::fclose(active_);
+        active_ = nullptr;
+    }
+    std::error_code ec;
+    std::filesystem::rename(active_path_, flushing_path_, ec);
+    if (ec) {
+        spdlog::error("ConsumableLedger: Cannot seal {}: {}", active_path_, ec.message());
+        open_active_locked();
+        return false;
+    }
+    sealed_ = std::move(pending_);
+    pending_ = ConsumptionBatch{};
+    pending_.id = new_batch_id();
+    std::string error;
+    if (!open_active_locked(&error)) {
+        spdlog::error("ConsumableLedger: {}", error);
+    }
+    return true;
+}
+
+bool ConsumableLedger::open_active_locked(std::string* error) {
+    // 以当前批次的累计值重写日志, 之后的消耗追加在其后
+    const std::string temp = active_path_ + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << nlohmann::json{{"batch", pending_.id}}.dump() << '\n';
+        for (const auto& [key, volume_ml] : pending_.pump_ml) {
+            nlohmann::json line = {{"pump", key.first}, {"ml", volume_ml}};
+            if (key.second) line["experiment_id"] = *key.second;
+            out << line.dump() << '\n';
+        }
+        for (const auto& [id, seconds] : pending_.runtime_seconds) {
+            out << nlohmann::json{{"consumable", id}, {"seconds", seconds}}.dump() << '\n';
+        }
+        if (!out.flush()) {
+            if (error) *error = "Cannot write " + temp;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, active_path_, ec);
+    if (ec) {
+        if (error) *error = "Cannot replace " + active_path_ + ": " + ec.message();
+        return false;
+    }
+    active_ = std::fopen(active_path_.c_str(), "ab");
+    if (!active_) {
+        if (error) *error = "Cannot open " + active_path_ + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void ConsumableLedger::append_locked(const std::string& line) {
+    if (!active_) return;
+    std::fputs(line.c_str(), active_);
+    std::fputc('\n', active_);
+    std::fflush(active_);
+}
+
+std::string ConsumableLedger::new_batch_id() {
+    static std::mt19937_64 rng{std::random_device{}()};
+    static std::mutex rng_mutex;
+    const auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lock(rng_mutex);
+    return fmt::format("{:x}-{:016x}", now, rng());
+}
+
+bool ConsumableLedger::read_journal(const std::string& path, ConsumptionBatch& batch) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string text;
+    bool header = true;
+    while (std::getline(in, text)) {
+        // 崩溃时最后一行可能不完整
+        auto line = nlohmann::json::parse(text, nullptr, false);
+        if (line.is_discarded() || !line.is_object()) continue;
+        if (header) {
+            header = false;
+            if (line.contains("batch")) {
+                batch.id = line["batch"].get<std::string>();
+                continue;
+            }
+        }
+        if (line.contains("pump")) {
+            std::optional<int> experiment_id;
+            if (line.contains("experiment_id")) experiment_id = line["experiment_id"].get<int>();
+            batch.pump_ml[{line["pump"].get<int>(), experiment_id}] += line.value("ml", 0.0);
+        } else if (line.contains("consumable")) {
+            batch.runtime_seconds[line["consumable"].get<std::string>()] += line.value("seconds", int64_t{0});
+        }
+    }
+    if (batch.id.empty()) {
+        batch.id = new_batch_id();
+    }
+    return true;
+}
+
+} // namespace db
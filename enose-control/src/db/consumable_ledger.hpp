@@ -0,0 +1,111 @@
+#pragma once
+
+#include "consumable_repository.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace db {
+
+/**
+ * @brief 泵液体消耗与耗材运行时间的内存账本, 由后台线程批量提交
+ *
+ * 实验线程上 add_pump_consumption / add_runtime 只在内存中累加并追加一行本地日志
+ * (fflush 到内核, 进程崩溃不丢), 不访问数据库. 后台线程在 flush() (步骤边界) 或
+ * flush_interval 到期时把当前批次封存, 以一个事务调用 ConsumableRepository::apply_consumption.
+ *
+ * 本地日志 (directory 下):
+ *   ledger.jsonl           当前批次: 首行 {"batch": id}, 之后每行一条消耗
+ *   ledger.flushing.jsonl  已封存、正在 (或等待重试) 提交的批次
+ * 提交成功后删除 flushing 文件; 启动时两份文件都读回, flushing 批次按原 ID 重放
+ * (数据库按 ID 去重, 提交后崩溃不会重复累加). 每次提交前对当前日志 fdatasync, 掉电最多丢失
+ * 一个 flush_interval 内的记录.
+ *
+ * 提交失败 (数据库不可达) 时保留封存批次, 下一周期重试; 其间新的消耗继续累加在当前批次.
+ * unflushed_*() 返回尚未提交的累计值, 与 ConsumableCache 快照相加即为实时余量.
+ */
+class ConsumableLedger {
+public:
+    struct Options {
+        std::string directory = "/var/lib/enose-control/ledger";
+        std::chrono::milliseconds flush_interval{5000};
+    };
+
+    struct Stats {
+        uint64_t entries_recorded = 0;
+        uint64_t batches_committed = 0;
+        uint64_t commit_failures = 0;
+        uint64_t batches_replayed = 0;      // 启动时从本地日志恢复的批次
+        double last_commit_ms = 0;
+        bool commit_pending = false;        // 有等待重试的封存批次
+    };
+
+    ConsumableLedger(std::shared_ptr<ConsumableRepository> repo, Options options);
+    ~ConsumableLedger();
+
+    ConsumableLedger(const ConsumableLedger&) = delete;
+    ConsumableLedger& operator=(const ConsumableLedger&) = delete;
+
+    /** @brief 读回本地日志并启动提交线程; 日志目录不可写时返回 false */
+    bool start();
+
+    /** @brief 封存并尝试提交剩余的消耗 (数据库不可达时留在本地日志, 下次启动重放) */
+    void stop();
+
+    void add_pump_consumption(int pump_index, double volume_ml, std::optional<int> experiment_id = std::nullopt);
+    void add_runtime(const std::string& id, int64_t seconds);
+
+    /** @brief 请求尽快提交 (不等待) */
+    void flush();
+
+    /** @brief 提交成功后在提交线程上调用 (ConsumableCache 据此失效快照) */
+    void set_on_committed(std::function<void()> callback);
+
+    double unflushed_pump_ml(int pump_index) const;
+    int64_t unflushed_runtime(const std::string& id) const;
+
+    Stats stats() const;
+
+private:
+    void commit_loop();
+    // 返回 false 表示有封存批次提交失败
+    bool commit_once();
+    bool seal_locked();
+    bool open_active_locked(std::string* error = nullptr);
+    void append_locked(const std::string& line);
+
+    static std::string new_batch_id();
+    static bool read_journal(const std::string& path, ConsumptionBatch& batch);
+
+    std::shared_ptr<ConsumableRepository> repo_;
+    Options options_;
+    std::string active_path_;
+    std::string flushing_path_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_{false};
+    bool flush_requested_{false};
+    std::thread thread_;
+
+    ConsumptionBatch pending_;                  // 当前批次 (ledger.jsonl)
+    std::optional<ConsumptionBatch> sealed_;    // 正在提交的批次 (ledger.flushing.jsonl), 只有提交线程修改
+    std::FILE* active_{nullptr};
+    std::function<void()> on_committed_;
+
+    std::atomic<uint64_t> entries_recorded_{0};
+    std::atomic<uint64_t> batches_committed_{0};
+    std::atomic<uint64_t> commit_failures_{0};
+    std::atomic<uint64_t> batches_replayed_{0};
+    std::atomic<double> last_commit_ms_{0};
+};
+
+} // namespace db
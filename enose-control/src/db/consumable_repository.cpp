@@ -1,10 +1,181 @@
 #include "consumable_repository.hpp"
+#include "prepared_statements.hpp"
 #include <spdlog/spdlog.h>
+#include <cstdio>
 #include <iomanip>
 #include <sstream>
 
 namespace db {
 
+namespace {
+
+constexpr const char* LIST_LIQUIDS = "consumable_list_liquids";
+constexpr const char* COUNT_LIQUIDS = "consumable_count_liquids";
+constexpr const char* GET_LIQUID = "consumable_get_liquid";
+constexpr const char* CREATE_LIQUID = "consumable_create_liquid";
+constexpr const char* UPDATE_LIQUID = "consumable_update_liquid";
+constexpr const char* DELETE_LIQUID = "consumable_delete_liquid";
+constexpr const char* LIST_PUMP_ASSIGNMENTS = "consumable_list_pump_assignments";
+constexpr const char* GET_PUMP_ASSIGNMENT = "consumable_get_pump_assignment";
+constexpr const char* SET_PUMP_ASSIGNMENT = "consumable_set_pump_assignment";
+constexpr const char* SET_PUMP_VOLUME = "consumable_set_pump_volume";
+constexpr const char* ADD_PUMP_CONSUMPTION = "consumable_add_pump_consumption";
+constexpr const char* INSERT_PUMP_CONSUMPTION = "consumable_insert_pump_consumption";
+constexpr const char* LIST_CONSUMABLES = "consumable_list_consumables";
+constexpr const char* GET_CONSUMABLE = "consumable_get_consumable";
+constexpr const char* ADD_RUNTIME = "consumable_add_runtime";
+constexpr const char* LOCK_ACCUMULATED = "consumable_lock_accumulated";
+constexpr const char* RESET_CONSUMABLE = "consumable_reset_consumable";
+constexpr const char* INSERT_CONSUMABLE_HISTORY = "consumable_insert_history";
+constexpr const char* UPDATE_LIFETIME = "consumable_update_lifetime";
+constexpr const char* CLAIM_LEDGER_BATCH = "consumable_claim_ledger_batch";
+constexpr const char* APPLY_PUMP_CONSUMPTION = "consumable_apply_pump_consumption";
+constexpr const char* APPLY_RUNTIME = "consumable_apply_runtime";
+constexpr const char* LIST_METADATA_FIELDS = "consumable_list_metadata_fields";
+constexpr const char* CREATE_METADATA_FIELD = "consumable_create_metadata_field";
+constexpr const char* UPDATE_METADATA_FIELD = "consumable_update_metadata_field";
+constexpr const char* DELETE_METADATA_FIELD = "consumable_delete_metadata_field";
+
+constexpr const char* LIQUID_COLUMNS =
+    "SELECT id, name, type, description, density, "
+    "COALESCE(metadata::text, '{}'), is_active, created_at, updated_at FROM liquids ";
+constexpr const char* PUMP_ASSIGNMENT_COLUMNS =
+    "SELECT pump_index, liquid_id, notes, updated_at, "
+    "COALESCE(initial_volume_ml, 0), COALESCE(consumed_volume_ml, 0), "
+    "COALESCE(low_volume_threshold_ml, 10) FROM pump_assignments ";
+constexpr const char* CONSUMABLE_COLUMNS =
+    "SELECT id, name, type, accumulated_seconds, lifetime_seconds, "
+    "warning_threshold, critical_threshold, last_reset_at, updated_at FROM consumables ";
+
+// 可选过滤条件以 NULL 参数表示, 每个语句只有一个固定的 SQL 文本
+const PreparedStatement CONSUMABLE_STATEMENTS[] = {
+    {LIST_LIQUIDS, std::string(LIQUID_COLUMNS) +
+        "WHERE ($1::TEXT IS NULL OR type = $1) AND ($2::BOOLEAN OR is_active) "
+        "ORDER BY name LIMIT $3 OFFSET $4"},  // LIMIT NULL = 不限
+    {COUNT_LIQUIDS,
+        "SELECT COUNT(*) FROM liquids "
+        "WHERE ($1::TEXT IS NULL OR type = $1) AND ($2::BOOLEAN OR is_active)"},
+    {GET_LIQUID, std::string(LIQUID_COLUMNS) + "WHERE id = $1"},
+    {CREATE_LIQUID,
+        "INSERT INTO liquids (name, type, description, density, metadata) "
+        "VALUES ($1, $2, $3, $4, $5::jsonb) RETURNING id"},
+    {UPDATE_LIQUID,
+        "UPDATE liquids SET name = $2, type = $3, description = $4, density = $5, "
+        "metadata = $6::jsonb, is_active = $7 WHERE id = $1"},
+    {DELETE_LIQUID, "DELETE FROM liquids WHERE id = $1"},
+
+    {LIST_PUMP_ASSIGNMENTS, std::string(PUMP_ASSIGNMENT_COLUMNS) + "ORDER BY pump_index"},
+    {GET_PUMP_ASSIGNMENT, std::string(PUMP_ASSIGNMENT_COLUMNS) + "WHERE pump_index = $1"},
+    // 给出 initial_volume_ml ($4) 时视为绑定新液体, 同时重置消耗量
+    {SET_PUMP_ASSIGNMENT,
+        "UPDATE pump_assignments SET liquid_id = $2, notes = $3, "
+        "initial_volume_ml = COALESCE($4::DOUBLE PRECISION, initial_volume_ml), "
+        "consumed_volume_ml = CASE WHEN $4::DOUBLE PRECISION IS NULL THEN consumed_volume_ml ELSE 0 END, "
+        "low_volume_threshold_ml = COALESCE($5::DOUBLE PRECISION, low_volume_threshold_ml) "
+        "WHERE pump_index = $1"},
+    {SET_PUMP_VOLUME,
+        "UPDATE pump_assignments SET initial_volume_ml = $2, "
+        "consumed_volume_ml = CASE WHEN $3::BOOLEAN THEN 0 ELSE consumed_volume_ml END, "
+        "low_volume_threshold_ml = COALESCE($4::DOUBLE PRECISION, low_volume_threshold_ml) "
+        "WHERE pump_index = $1"},
+    {ADD_PUMP_CONSUMPTION,
+        "UPDATE pump_assignments SET consumed_volume_ml = COALESCE(consumed_volume_ml, 0) + $2 "
+        "WHERE pump_index = $1 RETURNING liquid_id"},
+    {INSERT_PUMP_CONSUMPTION,
+        "INSERT INTO pump_consumption_history (pump_index, liquid_id, volume_ml, experiment_id) "
+        "VALUES ($1, $2, $3, $4)"},
+
+    {LIST_CONSUMABLES, std::string(CONSUMABLE_COLUMNS) + "ORDER BY type, id"},
+    {GET_CONSUMABLE, std::string(CONSUMABLE_COLUMNS) + "WHERE id = $1"},
+    {ADD_RUNTIME,
+        "UPDATE consumables SET accumulated_seconds = accumulated_seconds + $2 "
+        "WHERE id = $1 RETURNING accumulated_seconds"},
+    {LOCK_ACCUMULATED, "SELECT accumulated_seconds FROM consumables WHERE id = $1 FOR UPDATE"},
+    {RESET_CONSUMABLE,
+        "UPDATE consumables SET accumulated_seconds = 0, last_reset_at = NOW() WHERE id = $1"},
+    {INSERT_CONSUMABLE_HISTORY,
+        "INSERT INTO consumable_history (consumable_id, action, old_accumulated_seconds, "
+        "new_accumulated_seconds, delta_seconds, notes) VALUES ($1, $2, $3, $4, $5, $6)"},
+    {UPDATE_LIFETIME, "UPDATE consumables SET lifetime_seconds = $2 WHERE id = $1"},
+
+    // ConsumableLedger 批量提交; 数组参数以 PostgreSQL 数组字面量传入
+    {CLAIM_LEDGER_BATCH,
+        "INSERT INTO consumable_ledger_batches (batch_id) VALUES ($1) "
+        "ON CONFLICT DO NOTHING RETURNING batch_id"},
+    {APPLY_PUMP_CONSUMPTION,
+        "WITH d AS (SELECT * FROM unnest($1::INTEGER[], $2::DOUBLE PRECISION[], $3::INTEGER[]) "
+        "    AS d(pump_index, volume_ml, experiment_id)), "
+        "u AS (UPDATE pump_assignments p "
+        "    SET consumed_volume_ml = COALESCE(p.consumed_volume_ml, 0) + t.volume_ml "
+        "    FROM (SELECT pump_index, SUM(volume_ml) AS volume_ml FROM d GROUP BY pump_index) t "
+        "    WHERE p.pump_index = t.pump_index RETURNING p.pump_index, p.liquid_id) "
+        "INSERT INTO pump_consumption_history (pump_index, liquid_id, volume_ml, experiment_id) "
+        "SELECT d.pump_index, u.liquid_id, d.volume_ml, d.experiment_id FROM d JOIN u USING (pump_index)"},
+    {APPLY_RUNTIME,
+        "WITH d AS (SELECT * FROM unnest($1::TEXT[], $2::BIGINT[]) AS d(id, delta_seconds)), "
+        "u AS (UPDATE consumables c SET accumulated_seconds = c.accumulated_seconds + d.delta_seconds "
+        "    FROM d WHERE c.id = d.id RETURNING c.id, c.accumulated_seconds, d.delta_seconds) "
+        "INSERT INTO consumable_history (consumable_id, action, old_accumulated_seconds, "
+        "new_accumulated_seconds, delta_seconds) "
+        "SELECT id, 'runtime_add', accumulated_seconds - delta_seconds, accumulated_seconds, delta_seconds FROM u"},
+
+    {LIST_METADATA_FIELDS,
+        "SELECT id, entity_type, field_key, field_name, field_type, "
+        "description, is_required, default_value, "
+        "COALESCE(options::text, '{}'), display_order, is_active "
+        "FROM metadata_fields WHERE entity_type = $1 AND ($2::BOOLEAN OR is_active) "
+        "ORDER BY display_order, field_key"},
+    {CREATE_METADATA_FIELD,
+        "INSERT INTO metadata_fields (entity_type, field_key, field_name, field_type, "
+        "description, is_required, default_value, options, display_order) "
+        "VALUES ($1, $2, $3, $4, $5, $6, $7, $8::jsonb, $9) RETURNING id"},
+    {UPDATE_METADATA_FIELD,
+        "UPDATE metadata_fields SET field_name = $2, description = $3, is_required = $4, "
+        "default_value = $5, options = $6::jsonb, display_order = $7, is_active = $8 "
+        "WHERE id = $1"},
+    {DELETE_METADATA_FIELD, "DELETE FROM metadata_fields WHERE id = $1"},
+};
+
+// 空字符串表示不过滤
+std::optional<std::string> filter_param(const std::string& value) {
+    if (value.empty()) return std::nullopt;
+    return value;
+}
+
+// PostgreSQL 数组字面量: {1,2,NULL} / {"a","b"}
+template <typename T, typename Format>
+std::string array_literal(const std::vector<T>& values, Format format) {
+    std::string out = "{";
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) out += ',';
+        out += format(values[i]);
+    }
+    out += '}';
+    return out;
+}
+
+std::string quote_array_element(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+std::string format_double(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", value);
+    return buf;
+}
+
+} // namespace
+
+std::span<const PreparedStatement> consumable_statements() {
+    return CONSUMABLE_STATEMENTS;
+}
+
 // ============================================================
 // 时间戳工具函数
 // ============================================================
@@ -23,6 +194,46 @@ std::chrono::system_clock::time_point ConsumableRepository::parse_timestamp(cons
     return std::chrono::system_clock::from_time_t(std::mktime(&tm));
 }
 
+LiquidRecord ConsumableRepository::liquid_from_row(const pqxx::row& row) {
+    LiquidRecord record;
+    record.id = row[0].as<int>();
+    record.name = row[1].as<std::string>();
+    record.type = row[2].as<std::string>();
+    record.description = row[3].is_null() ? "" : row[3].as<std::string>();
+    record.density = row[4].as<float>();
+    record.metadata_json = row[5].as<std::string>();
+    record.is_active = row[6].as<bool>();
+    record.created_at = parse_timestamp(row[7].as<std::string>());
+    record.updated_at = parse_timestamp(row[8].as<std::string>());
+    return record;
+}
+
+PumpAssignmentRecord ConsumableRepository::pump_assignment_from_row(const pqxx::row& row) {
+    PumpAssignmentRecord record;
+    record.pump_index = row[0].as<int>();
+    record.liquid_id = row[1].is_null() ? std::nullopt : std::optional<int>(row[1].as<int>());
+    record.notes = row[2].is_null() ? "" : row[2].as<std::string>();
+    record.updated_at = parse_timestamp(row[3].as<std::string>());
+    record.initial_volume_ml = row[4].as<double>();
+    record.consumed_volume_ml = row[5].as<double>();
+    record.low_volume_threshold_ml = row[6].as<double>();
+    return record;
+}
+
+ConsumableRecord ConsumableRepository::consumable_from_row(const pqxx::row& row) {
+    ConsumableRecord record;
+    record.id = row[0].as<std::string>();
+    record.name = row[1].as<std::string>();
+    record.type = row[2].as<std::string>();
+    record.accumulated_seconds = row[3].as<int64_t>();
+    record.lifetime_seconds = row[4].as<int64_t>();
+    record.warning_threshold = row[5].as<float>();
+    record.critical_threshold = row[6].as<float>();
+    record.last_reset_at = parse_timestamp(row[7].as<std::string>());
+    record.updated_at = parse_timestamp(row[8].as<std::string>());
+    return record;
+}
+
 // ============================================================
 // 液体管理
 // ============================================================
@@ -42,34 +253,12 @@ std::vector<LiquidRecord> ConsumableRepository::list_liquids(
             return results;
         }
         
-        std::string sql = "SELECT id, name, type, description, density, "
-                         "COALESCE(metadata::text, '{}'), is_active, created_at, updated_at "
-                         "FROM liquids WHERE 1=1";
-        
-        if (!type_filter.empty()) {
-            sql += " AND type = " + conn->quote(type_filter);
-        }
-        if (!include_inactive) {
-            sql += " AND is_active = true";
-        }
-        sql += " ORDER BY name LIMIT " + std::to_string(limit) + 
-               " OFFSET " + std::to_string(offset);
-        
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(sql);
+        pqxx::result res = txn.exec_prepared(LIST_LIQUIDS, filter_param(type_filter),
+                                             include_inactive, limit, offset);
         
         for (const auto& row : res) {
-            LiquidRecord record;
-            record.id = row[0].as<int>();
-            record.name = row[1].as<std::string>();
-            record.type = row[2].as<std::string>();
-            record.description = row[3].is_null() ? "" : row[3].as<std::string>();
-            record.density = row[4].as<float>();
-            record.metadata_json = row[5].as<std::string>();
-            record.is_active = row[6].as<bool>();
-            record.created_at = parse_timestamp(row[7].as<std::string>());
-            record.updated_at = parse_timestamp(row[8].as<std::string>());
-            results.push_back(record);
+            results.push_back(liquid_from_row(row));
         }
         
         txn.commit();
@@ -86,24 +275,11 @@ std::optional<LiquidRecord> ConsumableRepository::get_liquid(int id) {
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "SELECT id, name, type, description, density, "
-            "COALESCE(metadata::text, '{}'), is_active, created_at, updated_at "
-            "FROM liquids WHERE id = " + std::to_string(id));
+        pqxx::result res = txn.exec_prepared(GET_LIQUID, id);
         
         if (res.empty()) return std::nullopt;
         
-        const auto& row = res[0];
-        LiquidRecord record;
-        record.id = row[0].as<int>();
-        record.name = row[1].as<std::string>();
-        record.type = row[2].as<std::string>();
-        record.description = row[3].is_null() ? "" : row[3].as<std::string>();
-        record.density = row[4].as<float>();
-        record.metadata_json = row[5].as<std::string>();
-        record.is_active = row[6].as<bool>();
-        record.created_at = parse_timestamp(row[7].as<std::string>());
-        record.updated_at = parse_timestamp(row[8].as<std::string>());
+        LiquidRecord record = liquid_from_row(res[0]);
         
         txn.commit();
         return record;
@@ -125,11 +301,8 @@ std::optional<int> ConsumableRepository::create_liquid(
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "INSERT INTO liquids (name, type, description, density, metadata) "
-            "VALUES (" + conn->quote(name) + ", " + conn->quote(type) + ", " +
-            conn->quote(description) + ", " + std::to_string(density) + ", " +
-            conn->quote(metadata_json) + "::jsonb) RETURNING id");
+        pqxx::result res = txn.exec_prepared(CREATE_LIQUID, name, type, description,
+                                             density, metadata_json);
         
         int id = res[0][0].as<int>();
         txn.commit();
@@ -156,14 +329,8 @@ bool ConsumableRepository::update_liquid(
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec(
-            "UPDATE liquids SET name = " + conn->quote(name) +
-            ", type = " + conn->quote(type) +
-            ", description = " + conn->quote(description) +
-            ", density = " + std::to_string(density) +
-            ", metadata = " + conn->quote(metadata_json) + "::jsonb" +
-            ", is_active = " + (is_active ? "true" : "false") +
-            " WHERE id = " + std::to_string(id));
+        txn.exec_prepared(UPDATE_LIQUID, id, name, type, description, density,
+                          metadata_json, is_active);
         
         txn.commit();
         return true;
@@ -179,7 +346,7 @@ bool ConsumableRepository::delete_liquid(int id) {
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec("DELETE FROM liquids WHERE id = " + std::to_string(id));
+        txn.exec_prepared(DELETE_LIQUID, id);
         txn.commit();
         
         spdlog::info("Deleted liquid id={}", id);
@@ -195,16 +362,8 @@ int ConsumableRepository::count_liquids(const std::string& type_filter, bool inc
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return 0;
         
-        std::string sql = "SELECT COUNT(*) FROM liquids WHERE 1=1";
-        if (!type_filter.empty()) {
-            sql += " AND type = " + conn->quote(type_filter);
-        }
-        if (!include_inactive) {
-            sql += " AND is_active = true";
-        }
-        
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(sql);
+        pqxx::result res = txn.exec_prepared(COUNT_LIQUIDS, filter_param(type_filter), include_inactive);
         txn.commit();
         
         return res[0][0].as<int>();
@@ -226,22 +385,10 @@ std::vector<PumpAssignmentRecord> ConsumableRepository::get_pump_assignments() {
         if (!conn.valid()) return results;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "SELECT pump_index, liquid_id, notes, updated_at, "
-            "COALESCE(initial_volume_ml, 0), COALESCE(consumed_volume_ml, 0), "
-            "COALESCE(low_volume_threshold_ml, 10) "
-            "FROM pump_assignments ORDER BY pump_index");
+        pqxx::result res = txn.exec_prepared(LIST_PUMP_ASSIGNMENTS);
         
         for (const auto& row : res) {
-            PumpAssignmentRecord record;
-            record.pump_index = row[0].as<int>();
-            record.liquid_id = row[1].is_null() ? std::nullopt : std::optional<int>(row[1].as<int>());
-            record.notes = row[2].is_null() ? "" : row[2].as<std::string>();
-            record.updated_at = parse_timestamp(row[3].as<std::string>());
-            record.initial_volume_ml = row[4].as<double>();
-            record.consumed_volume_ml = row[5].as<double>();
-            record.low_volume_threshold_ml = row[6].as<double>();
-            results.push_back(record);
+            results.push_back(pump_assignment_from_row(row));
         }
         
         txn.commit();
@@ -264,23 +411,9 @@ bool ConsumableRepository::set_pump_assignment(int pump_index, std::optional<int
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return false;
         
-        std::string liquid_id_str = liquid_id.has_value() ? std::to_string(*liquid_id) : "NULL";
-        
-        std::string sql = "UPDATE pump_assignments SET liquid_id = " + liquid_id_str +
-            ", notes = " + conn->quote(notes);
-        
-        if (initial_volume_ml.has_value()) {
-            sql += ", initial_volume_ml = " + std::to_string(*initial_volume_ml);
-            sql += ", consumed_volume_ml = 0";  // 绑定新液体时重置消耗量
-        }
-        if (low_volume_threshold_ml.has_value()) {
-            sql += ", low_volume_threshold_ml = " + std::to_string(*low_volume_threshold_ml);
-        }
-        
-        sql += " WHERE pump_index = " + std::to_string(pump_index);
-        
         pqxx::work txn(conn.get());
-        txn.exec(sql);
+        txn.exec_prepared(SET_PUMP_ASSIGNMENT, pump_index, liquid_id, notes,
+                          initial_volume_ml, low_volume_threshold_ml);
         txn.commit();
         
         spdlog::info("Set pump {} assignment to liquid_id={}", pump_index, 
@@ -304,20 +437,9 @@ bool ConsumableRepository::set_pump_volume(int pump_index, double initial_volume
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return false;
         
-        std::string sql = "UPDATE pump_assignments SET initial_volume_ml = " + 
-                          std::to_string(initial_volume_ml);
-        
-        if (reset_consumed) {
-            sql += ", consumed_volume_ml = 0";
-        }
-        if (low_volume_threshold_ml.has_value()) {
-            sql += ", low_volume_threshold_ml = " + std::to_string(*low_volume_threshold_ml);
-        }
-        
-        sql += " WHERE pump_index = " + std::to_string(pump_index);
-        
         pqxx::work txn(conn.get());
-        txn.exec(sql);
+        txn.exec_prepared(SET_PUMP_VOLUME, pump_index, initial_volume_ml, reset_consumed,
+                          low_volume_threshold_ml);
         txn.commit();
         
         spdlog::info("Set pump {} volume to {} ml (reset_consumed={})", 
@@ -342,28 +464,16 @@ bool ConsumableRepository::add_pump_consumption(int pump_index, double volume_ml
         
         pqxx::work txn(conn.get());
         
-        // 更新消耗量
-        txn.exec(
-            "UPDATE pump_assignments SET consumed_volume_ml = "
-            "COALESCE(consumed_volume_ml, 0) + " + std::to_string(volume_ml) +
-            " WHERE pump_index = " + std::to_string(pump_index));
+        // 更新消耗量, 同时取回当前绑定的液体ID
+        pqxx::result res = txn.exec_prepared(ADD_PUMP_CONSUMPTION, pump_index, volume_ml);
         
-        // 获取当前绑定的液体ID
-        pqxx::result res = txn.exec(
-            "SELECT liquid_id FROM pump_assignments WHERE pump_index = " + 
-            std::to_string(pump_index));
-        
-        std::string liquid_id_str = "NULL";
+        std::optional<int> liquid_id;
         if (!res.empty() && !res[0][0].is_null()) {
-            liquid_id_str = std::to_string(res[0][0].as<int>());
+            liquid_id = res[0][0].as<int>();
         }
         
         // 记录历史
-        std::string exp_id_str = experiment_id.has_value() ? std::to_string(*experiment_id) : "NULL";
-        txn.exec(
-            "INSERT INTO pump_consumption_history (pump_index, liquid_id, volume_ml, experiment_id) "
-            "VALUES (" + std::to_string(pump_index) + ", " + liquid_id_str + ", " +
-            std::to_string(volume_ml) + ", " + exp_id_str + ")");
+        txn.exec_prepared(INSERT_PUMP_CONSUMPTION, pump_index, liquid_id, volume_ml, experiment_id);
         
         txn.commit();
         
@@ -385,23 +495,11 @@ std::optional<PumpAssignmentRecord> ConsumableRepository::get_pump_assignment(in
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "SELECT pump_index, liquid_id, notes, updated_at, "
-            "COALESCE(initial_volume_ml, 0), COALESCE(consumed_volume_ml, 0), "
-            "COALESCE(low_volume_threshold_ml, 10) "
-            "FROM pump_assignments WHERE pump_index = " + std::to_string(pump_index));
+        pqxx::result res = txn.exec_prepared(GET_PUMP_ASSIGNMENT, pump_index);
         
         if (res.empty()) return std::nullopt;
         
-        const auto& row = res[0];
-        PumpAssignmentRecord record;
-        record.pump_index = row[0].as<int>();
-        record.liquid_id = row[1].is_null() ? std::nullopt : std::optional<int>(row[1].as<int>());
-        record.notes = row[2].is_null() ? "" : row[2].as<std::string>();
-        record.updated_at = parse_timestamp(row[3].as<std::string>());
-        record.initial_volume_ml = row[4].as<double>();
-        record.consumed_volume_ml = row[5].as<double>();
-        record.low_volume_threshold_ml = row[6].as<double>();
+        PumpAssignmentRecord record = pump_assignment_from_row(res[0]);
         
         txn.commit();
         return record;
@@ -423,23 +521,10 @@ std::vector<ConsumableRecord> ConsumableRepository::get_all_consumables() {
         if (!conn.valid()) return results;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "SELECT id, name, type, accumulated_seconds, lifetime_seconds, "
-            "warning_threshold, critical_threshold, last_reset_at, updated_at "
-            "FROM consumables ORDER BY type, id");
+        pqxx::result res = txn.exec_prepared(LIST_CONSUMABLES);
         
         for (const auto& row : res) {
-            ConsumableRecord record;
-            record.id = row[0].as<std::string>();
-            record.name = row[1].as<std::string>();
-            record.type = row[2].as<std::string>();
-            record.accumulated_seconds = row[3].as<int64_t>();
-            record.lifetime_seconds = row[4].as<int64_t>();
-            record.warning_threshold = row[5].as<float>();
-            record.critical_threshold = row[6].as<float>();
-            record.last_reset_at = parse_timestamp(row[7].as<std::string>());
-            record.updated_at = parse_timestamp(row[8].as<std::string>());
-            results.push_back(record);
+            results.push_back(consumable_from_row(row));
         }
         
         txn.commit();
@@ -456,24 +541,11 @@ std::optional<ConsumableRecord> ConsumableRepository::get_consumable(const std::
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "SELECT id, name, type, accumulated_seconds, lifetime_seconds, "
-            "warning_threshold, critical_threshold, last_reset_at, updated_at "
-            "FROM consumables WHERE id = " + conn->quote(id));
+        pqxx::result res = txn.exec_prepared(GET_CONSUMABLE, id);
         
         if (res.empty()) return std::nullopt;
         
-        const auto& row = res[0];
-        ConsumableRecord record;
-        record.id = row[0].as<std::string>();
-        record.name = row[1].as<std::string>();
-        record.type = row[2].as<std::string>();
-        record.accumulated_seconds = row[3].as<int64_t>();
-        record.lifetime_seconds = row[4].as<int64_t>();
-        record.warning_threshold = row[5].as<float>();
-        record.critical_threshold = row[6].as<float>();
-        record.last_reset_at = parse_timestamp(row[7].as<std::string>());
-        record.updated_at = parse_timestamp(row[8].as<std::string>());
+        ConsumableRecord record = consumable_from_row(res[0]);
         
         txn.commit();
         return record;
@@ -492,29 +564,20 @@ bool ConsumableRepository::add_runtime(const std::string& id, int64_t seconds) {
         
         pqxx::work txn(conn.get());
         
-        // 获取当前值
-        pqxx::result res = txn.exec(
-            "SELECT accumulated_seconds FROM consumables WHERE id = " + conn->quote(id));
+        // 原子累加, 由返回的新值推出旧值
+        pqxx::result res = txn.exec_prepared(ADD_RUNTIME, id, seconds);
         
         if (res.empty()) {
             spdlog::warn("Consumable not found: {}", id);
             return false;
         }
         
-        int64_t old_value = res[0][0].as<int64_t>();
-        int64_t new_value = old_value + seconds;
-        
-        // 更新累积时间
-        txn.exec(
-            "UPDATE consumables SET accumulated_seconds = " + std::to_string(new_value) +
-            " WHERE id = " + conn->quote(id));
+        int64_t new_value = res[0][0].as<int64_t>();
+        int64_t old_value = new_value - seconds;
         
         // 记录历史
-        txn.exec(
-            "INSERT INTO consumable_history (consumable_id, action, old_accumulated_seconds, "
-            "new_accumulated_seconds, delta_seconds) VALUES (" +
-            conn->quote(id) + ", 'runtime_add', " + std::to_string(old_value) + ", " +
-            std::to_string(new_value) + ", " + std::to_string(seconds) + ")");
+        txn.exec_prepared(INSERT_CONSUMABLE_HISTORY, id, "runtime_add", old_value, new_value,
+                          seconds, std::optional<std::string>{});
         
         txn.commit();
         return true;
@@ -524,6 +587,61 @@ bool ConsumableRepository::add_runtime(const std::string& id, int64_t seconds) {
     }
 }
 
+bool ConsumableRepository::apply_consumption(const ConsumptionBatch& batch) {
+    if (batch.empty()) return true;
+    
+    std::vector<int> pumps;
+    std::vector<double> volumes;
+    std::vector<std::optional<int>> experiments;
+    for (const auto& [key, volume_ml] : batch.pump_ml) {
+        if (key.first < 0 || key.first > 7) continue;
+        pumps.push_back(key.first);
+        volumes.push_back(volume_ml);
+        experiments.push_back(key.second);
+    }
+    std::vector<std::string> ids;
+    std::vector<int64_t> seconds;
+    for (const auto& [id, delta] : batch.runtime_seconds) {
+        if (delta <= 0) continue;
+        ids.push_back(id);
+        seconds.push_back(delta);
+    }
+    
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+        
+        pqxx::work txn(conn.get());
+        
+        if (txn.exec_prepared(CLAIM_LEDGER_BATCH, batch.id).empty()) {
+            spdlog::info("Consumption batch {} already applied, skipping", batch.id);
+            return true;
+        }
+        if (!pumps.empty()) {
+            txn.exec_prepared(APPLY_PUMP_CONSUMPTION,
+                array_literal(pumps, [](int v) { return std::to_string(v); }),
+                array_literal(volumes, format_double),
+                array_literal(experiments, [](const std::optional<int>& v) {
+                    return v ? std::to_string(*v) : std::string("NULL");
+                }));
+        }
+        if (!ids.empty()) {
+            txn.exec_prepared(APPLY_RUNTIME,
+                array_literal(ids, quote_array_element),
+                array_literal(seconds, [](int64_t v) { return std::to_string(v); }));
+        }
+        
+        txn.commit();
+        
+        spdlog::debug("Applied consumption batch {} ({} pump rows, {} consumables)",
+                      batch.id, pumps.size(), ids.size());
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("ConsumableRepository::apply_consumption error: {}", e.what());
+        return false;
+    }
+}
+
 bool ConsumableRepository::reset_consumable(const std::string& id, const std::string& notes) {
     try {
         auto conn = ConnectionPool::instance().acquire();
@@ -531,9 +649,8 @@ bool ConsumableRepository::reset_consumable(const std::string& id, const std::st
         
         pqxx::work txn(conn.get());
         
-        // 获取当前值
-        pqxx::result res = txn.exec(
-            "SELECT accumulated_seconds FROM consumables WHERE id = " + conn->quote(id));
+        // 获取当前值 (锁定该行直到提交)
+        pqxx::result res = txn.exec_prepared(LOCK_ACCUMULATED, id);
         
         if (res.empty()) {
             spdlog::warn("Consumable not found: {}", id);
@@ -543,16 +660,11 @@ bool ConsumableRepository::reset_consumable(const std::string& id, const std::st
         int64_t old_value = res[0][0].as<int64_t>();
         
         // 重置累积时间
-        txn.exec(
-            "UPDATE consumables SET accumulated_seconds = 0, last_reset_at = NOW() "
-            "WHERE id = " + conn->quote(id));
+        txn.exec_prepared(RESET_CONSUMABLE, id);
         
         // 记录历史
-        txn.exec(
-            "INSERT INTO consumable_history (consumable_id, action, old_accumulated_seconds, "
-            "new_accumulated_seconds, delta_seconds, notes) VALUES (" +
-            conn->quote(id) + ", 'reset', " + std::to_string(old_value) + ", 0, " +
-            std::to_string(-old_value) + ", " + conn->quote(notes) + ")");
+        txn.exec_prepared(INSERT_CONSUMABLE_HISTORY, id, "reset", old_value, int64_t{0},
+                          -old_value, notes);
         
         txn.commit();
         spdlog::info("Reset consumable: {} (was {} seconds)", id, old_value);
@@ -569,9 +681,7 @@ bool ConsumableRepository::update_lifetime(const std::string& id, int64_t lifeti
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec(
-            "UPDATE consumables SET lifetime_seconds = " + std::to_string(lifetime_seconds) +
-            " WHERE id = " + conn->quote(id));
+        txn.exec_prepared(UPDATE_LIFETIME, id, lifetime_seconds);
         
         txn.commit();
         spdlog::info("Updated consumable {} lifetime to {} seconds", id, lifetime_seconds);
@@ -596,18 +706,8 @@ std::vector<MetadataFieldRecord> ConsumableRepository::list_metadata_fields(
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return results;
         
-        std::string sql = "SELECT id, entity_type, field_key, field_name, field_type, "
-                         "description, is_required, default_value, "
-                         "COALESCE(options::text, '{}'), display_order, is_active "
-                         "FROM metadata_fields WHERE entity_type = " + conn->quote(entity_type);
-        
-        if (!include_inactive) {
-            sql += " AND is_active = true";
-        }
-        sql += " ORDER BY display_order, field_key";
-        
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(sql);
+        pqxx::result res = txn.exec_prepared(LIST_METADATA_FIELDS, entity_type, include_inactive);
         
         for (const auto& row : res) {
             MetadataFieldRecord record;
@@ -649,14 +749,9 @@ std::optional<int> ConsumableRepository::create_metadata_field(
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        pqxx::result res = txn.exec(
-            "INSERT INTO metadata_fields (entity_type, field_key, field_name, field_type, "
-            "description, is_required, default_value, options, display_order) VALUES (" +
-            conn->quote(entity_type) + ", " + conn->quote(field_key) + ", " +
-            conn->quote(field_name) + ", " + conn->quote(field_type) + ", " +
-            conn->quote(description) + ", " + (is_required ? "true" : "false") + ", " +
-            conn->quote(default_value) + ", " + conn->quote(options_json) + "::jsonb, " +
-            std::to_string(display_order) + ") RETURNING id");
+        pqxx::result res = txn.exec_prepared(CREATE_METADATA_FIELD, entity_type, field_key,
+                                             field_name, field_type, description, is_required,
+                                             default_value, options_json, display_order);
         
         int id = res[0][0].as<int>();
         txn.commit();
@@ -684,15 +779,8 @@ bool ConsumableRepository::update_metadata_field(
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec(
-            "UPDATE metadata_fields SET field_name = " + conn->quote(field_name) +
-            ", description = " + conn->quote(description) +
-            ", is_required = " + (is_required ? "true" : "false") +
-            ", default_value = " + conn->quote(default_value) +
-            ", options = " + conn->quote(options_json) + "::jsonb" +
-            ", display_order = " + std::to_string(display_order) +
-            ", is_active = " + (is_active ? "true" : "false") +
-            " WHERE id = " + std::to_string(id));
+        txn.exec_prepared(UPDATE_METADATA_FIELD, id, field_name, description, is_required,
+                          default_value, options_json, display_order, is_active);
         
         txn.commit();
         return true;
@@ -708,7 +796,7 @@ bool ConsumableRepository::delete_metadata_field(int id) {
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec("DELETE FROM metadata_fields WHERE id = " + std::to_string(id));
+        txn.exec_prepared(DELETE_METADATA_FIELD, id);
         txn.commit();
         
         spdlog::info("Deleted metadata field id={}", id);
@@ -719,4 +807,37 @@ bool ConsumableRepository::delete_metadata_field(int id) {
     }
 }
 
+// ============================================================
+// 缓存加载
+// ============================================================
+
+bool ConsumableRepository::load_catalog(ConsumableCatalog& catalog) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+        
+        // 可重复读: 三张表来自同一时刻
+        pqxx::transaction<pqxx::isolation_level::repeatable_read, pqxx::write_policy::read_only> txn(conn.get());
+        
+        ConsumableCatalog loaded;
+        for (const auto& row : txn.exec_prepared(LIST_LIQUIDS, std::optional<std::string>{}, true,
+                                                 std::optional<int>{}, 0)) {
+            loaded.liquids.push_back(liquid_from_row(row));
+        }
+        for (const auto& row : txn.exec_prepared(LIST_PUMP_ASSIGNMENTS)) {
+            loaded.pump_assignments.push_back(pump_assignment_from_row(row));
+        }
+        for (const auto& row : txn.exec_prepared(LIST_CONSUMABLES)) {
+            loaded.consumables.push_back(consumable_from_row(row));
+        }
+        txn.commit();
+        
+        catalog = std::move(loaded);
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("ConsumableRepository::load_catalog error: {}", e.what());
+        return false;
+    }
+}
+
 } // namespace db
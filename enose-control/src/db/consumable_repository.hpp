@@ -1,7 +1,9 @@
 #pragma once
 
 #include "connection_pool.hpp"
+#include <map>
 #include <optional>
+#include <utility>
 #include <vector>
 #include <chrono>
 #include <string>
@@ -97,6 +99,26 @@ struct MetadataFieldRecord {
     bool is_active{true};
 };
 
+// ============================================================
+// 液体 / 泵配置 / 耗材的完整快照 (ConsumableCache 的数据源)
+// ============================================================
+struct ConsumableCatalog {
+    std::vector<LiquidRecord> liquids;                  // 含停用, 按 name 排序
+    std::vector<PumpAssignmentRecord> pump_assignments; // 按 pump_index 排序
+    std::vector<ConsumableRecord> consumables;          // 按 type, id 排序
+};
+
+// ============================================================
+// 一批累计的泵液体消耗与耗材运行时间 (ConsumableLedger 的提交单位)
+// ============================================================
+struct ConsumptionBatch {
+    std::string id;                                                 // 全局唯一, 重放时据此去重
+    std::map<std::pair<int, std::optional<int>>, double> pump_ml;   // (pump_index, experiment_id) → ml
+    std::map<std::string, int64_t> runtime_seconds;                 // consumable_id → 秒
+
+    bool empty() const { return pump_ml.empty() && runtime_seconds.empty(); }
+};
+
 // ============================================================
 // 耗材仓库
 // ============================================================
@@ -159,6 +181,14 @@ public:
     
     bool update_lifetime(const std::string& id, int64_t lifetime_seconds);
     
+    /**
+     * @brief 在一个事务内提交一批消耗: 每张表一条多行语句 (unnest 数组参数)
+     *
+     * batch.id 先写入 consumable_ledger_batches, 已存在时 (提交后崩溃、重启重放) 跳过整批并返回 true.
+     * 每个 (泵, 实验) 写一条 pump_consumption_history, 每个耗材写一条 runtime_add 历史.
+     */
+    bool apply_consumption(const ConsumptionBatch& batch);
+    
     // === 元数据字段管理 ===
     std::vector<MetadataFieldRecord> list_metadata_fields(
         const std::string& entity_type,
@@ -186,10 +216,19 @@ public:
         bool is_active);
     
     bool delete_metadata_field(int id);
+    
+    // === 缓存加载 ===
+    
+    // 在同一事务中读取三张表; 与其他读取方法不同, 失败时返回 false 而不是空结果
+    bool load_catalog(ConsumableCatalog& catalog);
 
 private:
     std::string format_timestamp(const std::chrono::system_clock::time_point& tp);
     std::chrono::system_clock::time_point parse_timestamp(const std::string& ts);
+    
+    LiquidRecord liquid_from_row(const pqxx::row& row);
+    PumpAssignmentRecord pump_assignment_from_row(const pqxx::row& row);
+    ConsumableRecord consumable_from_row(const pqxx::row& row);
 };
 
 } // namespace db
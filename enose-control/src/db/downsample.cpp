@@ -0,0 +1,57 @@
+#include "downsample.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace db {
+
+std::vector<std::size_t> lttb_select(std::span<const double> x, std::span<const double> y,
+                                     std::size_t threshold) {
+    const std::size_t n = std::min(x.size(), y.size());
+    std::vector<std::size_t> selected;
+    if (threshold < 3 || n <= threshold) {
+        selected.resize(n);
+        std::iota(selected.begin(), selected.end(), std::size_t{0});
+        return selected;
+    }
+
+    selected.reserve(threshold);
+    selected.push_back(0);
+
+    // 首尾之外的 n - 2 个点均分成 threshold - 2 个桶
+    const double bucket_size = static_cast<double>(n - 2) / static_cast<double>(threshold - 2);
+    std::size_t a = 0;
+    for (std::size_t i = 0; i < threshold - 2; ++i) {
+        const std::size_t begin = static_cast<std::size_t>(std::floor(i * bucket_size)) + 1;
+        const std::size_t end = std::min(static_cast<std::size_t>(std::floor((i + 1) * bucket_size)) + 1, n - 1);
+
+        // 下一桶均值 (最后一个桶以末点为下一桶)
+        const std::size_t next_begin = end;
+        const std::size_t next_end = std::min(static_cast<std::size_t>(std::floor((i + 2) * bucket_size)) + 1, n);
+        double avg_x = 0, avg_y = 0;
+        for (std::size_t j = next_begin; j < next_end; ++j) {
+            avg_x += x[j];
+            avg_y += y[j];
+        }
+        const double count = static_cast<double>(std::max<std::size_t>(next_end - next_begin, 1));
+        avg_x /= count;
+        avg_y /= count;
+
+        double best_area = -1;
+        std::size_t best = begin;
+        for (std::size_t j = begin; j < end; ++j) {
+            const double area = std::abs((x[a] - avg_x) * (y[j] - y[a]) - (x[a] - x[j]) * (avg_y - y[a]));
+            if (area > best_area) {
+                best_area = area;
+                best = j;
+            }
+        }
+        selected.push_back(best);
+        a = best;
+    }
+
+    selected.push_back(n - 1);
+    return selected;
+}
+
+} // namespace db
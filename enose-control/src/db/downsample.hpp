@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Largest-Triangle-Three-Buckets 降采样
+ *
+ * 从按 x 升序的 (x, y) 序列中选出至多 threshold 个点的下标 (升序), 保留首尾点;
+ * 每个桶选取与前一选中点及下一桶均值构成三角形面积最大的点, 曲线形状 (峰谷) 得以保留.
+ * threshold < 3 或点数不超过 threshold 时返回全部下标.
+ */
+std::vector<std::size_t> lttb_select(std::span<const double> x, std::span<const double> y,
+                                     std::size_t threshold);
+
+} // namespace db
@@ -0,0 +1,269 @@
+#include "experiment_queue_repository.hpp"
+#include "prepared_statements.hpp"
+#include <spdlog/spdlog.h>
+
+namespace db {
+
+namespace {
+
+constexpr const char* ENQUEUE = "experiment_queue_enqueue";
+constexpr const char* LIST_QUEUED = "experiment_queue_list_queued";
+constexpr const char* LIST_RECENT = "experiment_queue_list_recent";
+constexpr const char* REORDER = "experiment_queue_reorder";
+constexpr const char* CANCEL = "experiment_queue_cancel";
+constexpr const char* PEEK_NEXT = "experiment_queue_peek_next";
+constexpr const char* CLAIM = "experiment_queue_claim";
+constexpr const char* SET_RUN_ID = "experiment_queue_set_run_id";
+constexpr const char* FINISH = "experiment_queue_finish";
+constexpr const char* ABORT_STALE = "experiment_queue_abort_stale";
+
+// 时间列以 Unix 微秒返回, 不经过字符串解析
+constexpr const char* ENTRY_COLUMNS =
+    "id, (EXTRACT(EPOCH FROM created_at) * 1000000)::BIGINT AS created_us, "
+    "(EXTRACT(EPOCH FROM started_at) * 1000000)::BIGINT AS started_us, "
+    "(EXTRACT(EPOCH FROM completed_at) * 1000000)::BIGINT AS completed_us, "
+    "priority, name, program_id, state, run_id, estimated_duration_s, error_message ";
+
+constexpr const char* QUEUE_ORDER = "ORDER BY priority DESC, id ";
+
+const PreparedStatement EXPERIMENT_QUEUE_STATEMENTS[] = {
+    {ENQUEUE,
+        std::string("INSERT INTO experiment_queue (name, priority, program_id, program, estimated_duration_s) "
+                    "VALUES ($1, $2, $3, $4::JSONB, $5) RETURNING ") + ENTRY_COLUMNS},
+    {LIST_QUEUED,
+        std::string("SELECT ") + ENTRY_COLUMNS + "FROM experiment_queue WHERE state='queued' " + QUEUE_ORDER},
+    {LIST_RECENT,
+        std::string("SELECT ") + ENTRY_COLUMNS + "FROM experiment_queue WHERE state<>'queued' "
+        "ORDER BY COALESCE(completed_at, 'infinity') DESC, id DESC LIMIT $1"},
+    {REORDER,
+        std::string("UPDATE experiment_queue SET priority=$2 WHERE id=$1 AND state='queued' RETURNING ") +
+        ENTRY_COLUMNS},
+    {CANCEL,
+        std::string("UPDATE experiment_queue SET state='cancelled', completed_at=NOW() "
+                    "WHERE id=$1 AND state='queued' RETURNING ") + ENTRY_COLUMNS},
+    {PEEK_NEXT,
+        std::string("SELECT ") + ENTRY_COLUMNS + ", program::TEXT AS program_json "
+        "FROM experiment_queue WHERE state='queued' " + QUEUE_ORDER + "LIMIT 1"},
+    {CLAIM,
+        "UPDATE experiment_queue SET state='running', started_at=NOW() "
+        "WHERE id=$1 AND state='queued' RETURNING id"},
+    {SET_RUN_ID, "UPDATE experiment_queue SET run_id=$2 WHERE id=$1"},
+    {FINISH,
+        "UPDATE experiment_queue SET state=$2, completed_at=NOW(), "
+        "error_message=COALESCE($3::TEXT, error_message) WHERE id=$1"},
+    {ABORT_STALE,
+        "UPDATE experiment_queue SET state='aborted', completed_at=NOW(), "
+        "error_message='控制程序在执行中重启' WHERE state='running' RETURNING id"},
+};
+
+std::chrono::system_clock::time_point from_us(int64_t us) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(us)));
+}
+
+QueueEntryRecord entry_from_row(const pqxx::row& row) {
+    QueueEntryRecord record;
+    record.id = row["id"].as<int64_t>();
+    record.created_at = from_us(row["created_us"].as<int64_t>());
+    if (!row["started_us"].is_null()) record.started_at = from_us(row["started_us"].as<int64_t>());
+    if (!row["completed_us"].is_null()) record.completed_at = from_us(row["completed_us"].as<int64_t>());
+    record.priority = row["priority"].as<int>();
+    record.name = row["name"].as<std::string>();
+    record.program_id = row["program_id"].as<std::string>();
+    record.state = row["state"].as<std::string>();
+    if (!row["run_id"].is_null()) record.run_id = row["run_id"].as<int>();
+    record.estimated_duration_s = row["estimated_duration_s"].as<double>();
+    if (!row["error_message"].is_null()) record.error_message = row["error_message"].as<std::string>();
+    return record;
+}
+
+std::vector<QueueEntryRecord> entries_from_result(const pqxx::result& result) {
+    std::vector<QueueEntryRecord> records;
+    records.reserve(result.size());
+    for (const auto& row : result) {
+        records.push_back(entry_from_row(row));
+    }
+    return records;
+}
+
+} // namespace
+
+std::span<const PreparedStatement> experiment_queue_statements() {
+    return EXPERIMENT_QUEUE_STATEMENTS;
+}
+
+std::optional<QueueEntryRecord> ExperimentQueueRepository::enqueue(const std::string& name, int priority,
+                                                                   const std::string& program_id,
+                                                                   const std::string& program_json,
+                                                                   double estimated_duration_s) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return std::nullopt;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(ENQUEUE, name, priority, program_id, program_json, estimated_duration_s);
+        txn.commit();
+
+        if (result.empty()) return std::nullopt;
+        auto record = entry_from_row(result[0]);
+        spdlog::info("Enqueued experiment id={} program={} priority={}", record.id, program_id, priority);
+        return record;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to enqueue experiment: {}", e.what());
+        return std::nullopt;
+    }
+}
+
+std::vector<QueueEntryRecord> ExperimentQueueRepository::list_queued() {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return {};
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(LIST_QUEUED);
+        txn.commit();
+        return entries_from_result(result);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to list experiment queue: {}", e.what());
+        return {};
+    }
+}
+
+std::vector<QueueEntryRecord> ExperimentQueueRepository::list_recent(int limit) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return {};
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(LIST_RECENT, limit);
+        txn.commit();
+        return entries_from_result(result);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to list recent queue entries: {}", e.what());
+        return {};
+    }
+}
+
+std::optional<QueueEntryRecord> ExperimentQueueRepository::reorder(int64_t id, int priority) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return std::nullopt;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(REORDER, id, priority);
+        txn.commit();
+
+        if (result.empty()) return std::nullopt;
+        return entry_from_row(result[0]);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to reorder queue entry {}: {}", id, e.what());
+        return std::nullopt;
+    }
+}
+
+std::optional<QueueEntryRecord> ExperimentQueueRepository::cancel(int64_t id) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return std::nullopt;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(CANCEL, id);
+        txn.commit();
+
+        if (result.empty()) return std::nullopt;
+        spdlog::info("Cancelled queue entry id={}", id);
+        return entry_from_row(result[0]);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to cancel queue entry {}: {}", id, e.what());
+        return std::nullopt;
+    }
+}
+
+std::optional<QueueEntryRecord> ExperimentQueueRepository::peek_next() {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return std::nullopt;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(PEEK_NEXT);
+        txn.commit();
+
+        if (result.empty()) return std::nullopt;
+        auto record = entry_from_row(result[0]);
+        record.program_json = result[0]["program_json"].as<std::string>();
+        return record;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to peek experiment queue: {}", e.what());
+        return std::nullopt;
+    }
+}
+
+bool ExperimentQueueRepository::claim(int64_t id) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(CLAIM, id);
+        txn.commit();
+        return !result.empty();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to claim queue entry {}: {}", id, e.what());
+        return false;
+    }
+}
+
+bool ExperimentQueueRepository::set_run_id(int64_t id, int run_id) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+
+        pqxx::work txn(conn.get());
+        txn.exec_prepared(SET_RUN_ID, id, run_id);
+        txn.commit();
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to set run id of queue entry {}: {}", id, e.what());
+        return false;
+    }
+}
+
+bool ExperimentQueueRepository::finish(int64_t id, const std::string& state, const std::string& error_message) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+
+        pqxx::work txn(conn.get());
+        std::optional<std::string> error;
+        if (!error_message.empty()) error = error_message;
+        txn.exec_prepared(FINISH, id, state, error);
+        txn.commit();
+
+        spdlog::info("Queue entry id={} finished with state={}", id, state);
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to finish queue entry {}: {}", id, e.what());
+        return false;
+    }
+}
+
+int ExperimentQueueRepository::abort_stale() {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return 0;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(ABORT_STALE);
+        txn.commit();
+
+        if (!result.empty()) {
+            spdlog::warn("Marked {} interrupted queue entries as aborted", result.size());
+        }
+        return static_cast<int>(result.size());
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to abort stale queue entries: {}", e.what());
+        return 0;
+    }
+}
+
+} // namespace db
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace db {
+
+// 实验队列项 (对应 experiment_queue 表)
+struct QueueEntryRecord {
+    int64_t id{0};
+    std::chrono::system_clock::time_point created_at;
+    std::optional<std::chrono::system_clock::time_point> started_at;
+    std::optional<std::chrono::system_clock::time_point> completed_at;
+    int priority{0};
+    std::string name;
+    std::string program_id;
+    std::string program_json;   // 只有 peek_next 填充
+    std::string state;          // queued, running, completed, error, aborted, cancelled, rejected
+    std::optional<int> run_id;
+    double estimated_duration_s{0};
+    std::string error_message;
+};
+
+/**
+ * @brief 持久化的实验队列
+ *
+ * 执行顺序为 priority DESC, id ASC. 取下一项分两步: peek_next 读出程序 (可提前验证 / 编译),
+ * 真正开始时 claim 把它从 queued 改为 running; 期间被取消或改优先级时 claim 失败 / 队首变化,
+ * 调用方重新 peek.
+ */
+class ExperimentQueueRepository {
+public:
+    ExperimentQueueRepository() = default;
+
+    std::optional<QueueEntryRecord> enqueue(const std::string& name, int priority,
+                                            const std::string& program_id,
+                                            const std::string& program_json,
+                                            double estimated_duration_s);
+
+    // 等待中的项, 按执行顺序
+    std::vector<QueueEntryRecord> list_queued();
+
+    // 最近结束 (或正在执行) 的项, 新的在前
+    std::vector<QueueEntryRecord> list_recent(int limit = 20);
+
+    // 只能修改 / 取消等待中的项, 否则返回 nullopt
+    std::optional<QueueEntryRecord> reorder(int64_t id, int priority);
+    std::optional<QueueEntryRecord> cancel(int64_t id);
+
+    // 队首 (含程序 JSON), 队列为空时返回 nullopt
+    std::optional<QueueEntryRecord> peek_next();
+
+    // queued → running; 已被取消或已被占用时返回 false
+    bool claim(int64_t id);
+
+    // 记录开始执行后在 runs 表中的 id
+    bool set_run_id(int64_t id, int run_id);
+
+    // 记为终态: completed / error / aborted (执行后), rejected (出队验证失败)
+    bool finish(int64_t id, const std::string& state, const std::string& error_message = "");
+
+    // 启动时调用: 上次进程退出时仍在执行的项记为 aborted
+    int abort_stale();
+};
+
+} // namespace db
@@ -0,0 +1,156 @@
+#include "journal_uploader.hpp"
+#include <spdlog/spdlog.h>
+#include <iomanip>
+#include <sstream>
+
+namespace db {
+
+namespace {
+
+std::string format_timestamp(const std::chrono::system_clock::time_point& tp) {
+    auto time_t = std::chrono::system_clock::to_time_t(tp);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        tp.time_since_epoch()) % 1000000;
+
+    std::ostringstream oss;
+    oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    oss << '.' << std::setfill('0') << std::setw(6) << us.count() << "+00";
+    return oss.str();
+}
+
+// 数据库拒绝了段中的数据 (而不是连接或服务端暂时不可用): 重试同一段必然再次失败
+bool is_data_error(const std::exception& e) {
+    if (dynamic_cast<const pqxx::broken_connection*>(&e)) return false;
+    if (dynamic_cast<const pqxx::conversion_error*>(&e)) return true;
+    if (const auto* sql = dynamic_cast<const pqxx::sql_error*>(&e)) {
+        // SQLSTATE 22xxx 数据异常 (编码、数值越界等), 23xxx 违反约束
+        const std::string& state = sql->sqlstate();
+        return state.rfind("22", 0) == 0 || state.rfind("23", 0) == 0;
+    }
+    return false;
+}
+
+} // namespace
+
+JournalUploader::JournalUploader(std::shared_ptr<RecordingJournal> journal, std::string connection_string,
+                                 Options options)
+    : journal_(std::move(journal))
+    , connection_string_(std::move(connection_string))
+    , options_(options) {}
+
+JournalUploader::~JournalUploader() {
+    stop();
+}
+
+void JournalUploader::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    stopping_ = false;
+    thread_ = std::thread(&JournalUploader::upload_loop, this);
+}
+
+void JournalUploader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+JournalUploader::Stats JournalUploader::stats() const {
+    Stats s;
+    s.segments_uploaded = segments_uploaded_;
+    s.rows_uploaded = rows_uploaded_;
+    s.failures = failures_;
+    s.segments_quarantined = segments_quarantined_;
+    s.uploading = uploading_;
+    return s;
+}
+
+void JournalUploader::upload_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        lock.unlock();
+        upload_pending();
+        lock.lock();
+        cv_.wait_for(lock, options_.retry_interval, [this] { return stopping_; });
+    }
+}
+
+void JournalUploader::upload_pending() {
+    const auto journal_stats = journal_->stats();
+    if (journal_stats.sealed_segments == 0 && journal_stats.active_records == 0) return;
+
+    try {
+        pqxx::connection conn(connection_string_);
+        uploading_ = true;
+
+        // 数据库已可达: 封存当前段, 连同之前的段一起补传
+        journal_->rotate();
+        auto segments = journal_->sealed_segments();
+        spdlog::info("JournalUploader: Database reachable, backfilling {} segment(s)", segments.size());
+
+        for (const auto& path : segments) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) break;
+            }
+
+            RecordingJournal::SegmentContents contents;
+            if (!RecordingJournal::read_segment(path, contents)) {
+                journal_->quarantine_segment(path);
+                continue;
+            }
+
+            const auto started = std::chrono::steady_clock::now();
+            uint64_t rows = 0;
+            try {
+                rows = upload_segment(conn, contents);
+            } catch (const std::exception& e) {
+                // 连接错误: 断开, 下个周期从该段重试; 数据错误: 隔离该段, 继续补传后面的段
+                if (!is_data_error(e)) throw;
+                ++failures_;
+                ++segments_quarantined_;
+                journal_->quarantine_segment(path, std::string("rejected by the database: ") + e.what());
+                continue;
+            }
+            journal_->remove_segment(path);
+            ++segments_uploaded_;
+            rows_uploaded_ += rows;
+            spdlog::info("JournalUploader: Backfilled {} ({} rows, {}ms)", path, rows,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - started).count());
+        }
+        uploading_ = false;
+    } catch (const std::exception& e) {
+        uploading_ = false;
+        ++failures_;
+        spdlog::warn("JournalUploader: Backfill deferred: {}", e.what());
+    }
+}
+
+uint64_t JournalUploader::upload_segment(pqxx::connection& conn,
+                                         const RecordingJournal::SegmentContents& contents) {
+    // 同一事务: 段要么整体写入要么整体重试
+    pqxx::work txn(conn);
+    if (!contents.sensor_readings.empty()) {
+        SensorReadingRepository::copy_readings(txn, contents.device_id, contents.channels,
+                                               contents.sensor_readings);
+    }
+    if (!contents.weight_samples.empty()) {
+        TestRunRepository::copy_weight_samples(txn, contents.weight_samples);
+    }
+    if (!contents.events.empty()) {
+        auto stream = pqxx::stream_to::table(txn, {"system_logs"}, {"time", "level", "source", "message"});
+        for (const auto& event : contents.events) {
+            stream.write_values(format_timestamp(event.time), event.level, event.source, event.message);
+        }
+        stream.complete();
+    }
+    txn.commit();
+    return contents.sensor_readings.size() + contents.weight_samples.size() + contents.events.size();
+}
+
+} // namespace db
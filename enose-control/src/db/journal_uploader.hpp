@@ -0,0 +1,73 @@
+#pragma once
+
+#include "recording_journal.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace db {
+
+/**
+ * @brief 把 RecordingJournal 的已封存段补传到 TimescaleDB
+ *
+ * 后台线程每 retry_interval 检查一次: 有待补传的段 (或当前段非空) 时用独立连接
+ * (不占用连接池, 启动时连接池初始化失败也能补传) 连接数据库, 先封存当前段,
+ * 再按序号逐段在一个事务内 COPY 到 sensor_readings / weight_samples / system_logs,
+ * 提交成功后删除段文件. 连接错误时断开, 等下一个周期从该段重试; 数据库拒绝段中的数据
+ * (SQLSTATE 22 / 23 类, 或客户端类型转换失败) 时把该段隔离为 .bad 并继续补传后面的段,
+ * 一个坏段不会挡住之后的全部补传.
+ *
+ * 提交成功但删除失败时该段会被再次补传 (重复行), 这是唯一的非幂等窗口.
+ */
+class JournalUploader {
+public:
+    struct Options {
+        std::chrono::seconds retry_interval{30};
+    };
+
+    struct Stats {
+        uint64_t segments_uploaded = 0;
+        uint64_t rows_uploaded = 0;
+        uint64_t failures = 0;
+        uint64_t segments_quarantined = 0;  // 数据错误, 已隔离不再补传
+        bool uploading = false;
+    };
+
+    JournalUploader(std::shared_ptr<RecordingJournal> journal, std::string connection_string, Options options);
+    ~JournalUploader();
+
+    JournalUploader(const JournalUploader&) = delete;
+    JournalUploader& operator=(const JournalUploader&) = delete;
+
+    void start();
+    void stop();
+
+    Stats stats() const;
+
+private:
+    void upload_loop();
+    void upload_pending();
+    uint64_t upload_segment(pqxx::connection& conn, const RecordingJournal::SegmentContents& contents);
+
+    std::shared_ptr<RecordingJournal> journal_;
+    std::string connection_string_;
+    Options options_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_{false};
+    std::thread thread_;
+
+    std::atomic<uint64_t> segments_uploaded_{0};
+    std::atomic<uint64_t> rows_uploaded_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> segments_quarantined_{0};
+    std::atomic<bool> uploading_{false};
+};
+
+} // namespace db
@@ -0,0 +1,21 @@
+#include "prepared_statements.hpp"
+#include <spdlog/spdlog.h>
+
+namespace db {
+
+void prepare_statements(pqxx::connection& conn) {
+    for (auto statements : {consumable_statements(), test_run_statements(), experiment_queue_statements(),
+                            sensor_baseline_statements(), sensor_reading_statements()}) {
+        for (const auto& statement : statements) {
+            // 单条失败 (例如迁移尚未执行, 表或列不存在) 不影响其余语句和连接本身,
+            // 该语句在调用时报错, 与未预处理时一样只影响对应的查询
+            try {
+                conn.prepare(statement.name, statement.sql);
+            } catch (const std::exception& e) {
+                spdlog::warn("Failed to prepare statement {}: {}", statement.name, e.what());
+            }
+        }
+    }
+}
+
+} // namespace db
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <span>
+#include <string>
+
+namespace db {
+
+/**
+ * @brief 具名预处理语句
+ *
+ * 各仓库在自己的 .cpp 中定义语句表 (SQL 与使用处放在一起), ConnectionPool 每创建
+ * 一条连接就全部 prepare 一次; 之后仓库只用 txn.exec_prepared(name, ...) 执行,
+ * PostgreSQL 不再对每次调用重新解析和规划, 参数也不再拼接进 SQL.
+ */
+struct PreparedStatement {
+    const char* name;
+    std::string sql;
+};
+
+std::span<const PreparedStatement> consumable_statements();
+std::span<const PreparedStatement> test_run_statements();
+std::span<const PreparedStatement> experiment_queue_statements();
+std::span<const PreparedStatement> sensor_baseline_statements();
+std::span<const PreparedStatement> sensor_reading_statements();
+
+/**
+ * @brief 在新连接上注册所有仓库的预处理语句; 个别语句失败时记录警告并继续
+ */
+void prepare_statements(pqxx::connection& conn);
+
+} // namespace db
@@ -0,0 +1,744 @@
+#include "recording_journal.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace db {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char SEGMENT_MAGIC[8] = {'E', 'N', 'J', 'R', 'N', 'L', '1', '\0'};
+constexpr char FOOTER_MAGIC[8] = {'E', 'N', 'J', 'I', 'D', 'X', '1', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr const char* SEGMENT_PREFIX = "segment-";
+constexpr const char* SEGMENT_SUFFIX = ".enj";
+
+enum class RecordType : uint16_t {
+    Empty = 0,          // 预分配区域 (全零), 标志段内记录结束
+    SensorReading = 1,
+    WeightSample = 2,
+    Event = 3,
+};
+constexpr std::size_t RECORD_TYPES = 4;
+
+struct RecordHeader {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t crc;           // 整条记录 (crc 字段置零) 的 CRC32
+    int64_t time_us;        // Unix 微秒
+};
+
+struct SensorPayload {
+    int32_t run_id;         // -1 = 无
+    uint32_t device_tick;
+    uint64_t frame_seq;
+    uint8_t heater_step;
+    uint8_t reserved[7];
+    char run_tag[40];
+    char phase[24];
+    char gas_mode[8];
+    float channels[SensorReadingRecord::MAX_CHANNELS];
+};
+
+struct WeightPayload {
+    int32_t run_id;
+    int32_t cycle;
+    float weight;
+    uint8_t is_stable;
+    uint8_t reserved[3];
+    char phase[24];
+    char trend[16];
+};
+
+struct EventPayload {
+    char level[8];
+    char source[32];
+    char message[200];
+};
+
+constexpr std::size_t PAYLOAD_SIZE = RecordingJournal::RECORD_SIZE - sizeof(RecordHeader);
+static_assert(sizeof(RecordHeader) == 16);
+static_assert(sizeof(SensorPayload) <= PAYLOAD_SIZE);
+static_assert(sizeof(WeightPayload) <= PAYLOAD_SIZE);
+static_assert(sizeof(EventPayload) <= PAYLOAD_SIZE);
+
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    uint64_t sequence;
+    int64_t created_us;
+    uint32_t channels;
+    uint32_t reserved;
+    char device_id[64];
+};
+static_assert(sizeof(SegmentHeader) <= RecordingJournal::RECORD_SIZE);
+
+// 位于文件最后 sizeof(SegmentFooter) 字节, 其前紧接 index_entries 个 IndexEntry
+struct SegmentFooter {
+    char magic[8];
+    uint64_t record_count;
+    int64_t first_time_us;
+    int64_t last_time_us;
+    uint64_t counts[RECORD_TYPES];
+    uint32_t index_stride;
+    uint32_t index_entries;
+};
+
+struct IndexEntry {
+    int64_t time_us;
+    uint64_t record;
+};
+
+using RecordBuffer = std::array<unsigned char, RecordingJournal::RECORD_SIZE>;
+
+const std::array<uint32_t, 256>& crc_table() {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    return table;
+}
+
+uint32_t record_crc(const unsigned char* record) {
+    const auto& table = crc_table();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < RecordingJournal::RECORD_SIZE; ++i) {
+        unsigned char byte = record[i];
+        if (i >= offsetof(RecordHeader, crc) && i < offsetof(RecordHeader, crc) + sizeof(uint32_t)) {
+            byte = 0;
+        }
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+int64_t to_unix_us(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point from_unix_us(int64_t us) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(us)));
+}
+
+template<std::size_t N>
+void copy_text(char (&dst)[N], const std::string& src) {
+    std::memcpy(dst, src.data(), std::min(src.size(), N));
+}
+
+template<std::size_t N>
+std::string read_text(const char (&src)[N]) {
+    return std::string(src, strnlen(src, N));
+}
+
+template<typename Payload>
+Payload* payload_of(RecordBuffer& buffer) {
+    return reinterpret_cast<Payload*>(buffer.data() + sizeof(RecordHeader));
+}
+
+RecordBuffer make_record(RecordType type, int64_t time_us) {
+    RecordBuffer buffer{};
+    RecordHeader header{};
+    header.type = static_cast<uint16_t>(type);
+    header.time_us = time_us;
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    return buffer;
+}
+
+void finish_record(RecordBuffer& buffer) {
+    const uint32_t crc = record_crc(buffer.data());
+    std::memcpy(buffer.data() + offsetof(RecordHeader, crc), &crc, sizeof(crc));
+}
+
+bool valid_record(const unsigned char* record, RecordHeader& header) {
+    std::memcpy(&header, record, sizeof(header));
+    if (header.type == 0 || header.type >= RECORD_TYPES) return false;
+    return record_crc(record) == header.crc;
+}
+
+std::size_t index_entries_for(std::size_t records) {
+    return (records + RecordingJournal::INDEX_STRIDE - 1) / RecordingJournal::INDEX_STRIDE;
+}
+
+bool parse_segment_seq(const fs::path& path, uint64_t& seq) {
+    const std::string name = path.filename().string();
+    const std::string prefix = SEGMENT_PREFIX;
+    const std::string suffix = SEGMENT_SUFFIX;
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    try {
+        seq = std::stoull(name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()));
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// 文件尾部有有效的 SegmentFooter 即视为已封存
+bool read_footer(int fd, off_t size, SegmentFooter& footer) {
+    if (size < static_cast<off_t>(RecordingJournal::RECORD_SIZE + sizeof(SegmentFooter))) return false;
+    if (::pread(fd, &footer, sizeof(footer), size - static_cast<off_t>(sizeof(footer))) !=
+        static_cast<ssize_t>(sizeof(footer))) {
+        return false;
+    }
+    return std::memcmp(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) == 0;
+}
+
+} // namespace
+
+/**
+ * @brief 正在写入 (或崩溃后恢复中) 的段
+ */
+struct RecordingJournal::Segment {
+    std::string path;
+    uint64_t seq = 0;
+    int fd = -1;
+    unsigned char* base = nullptr;      // mmap 的整个预分配文件
+    std::size_t mapped_bytes = 0;
+    std::size_t capacity = 0;
+    std::size_t count = 0;
+    int64_t first_time_us = 0;
+    int64_t last_time_us = 0;
+    uint64_t counts[RECORD_TYPES]{};
+    std::vector<IndexEntry> index;
+
+    ~Segment() { close(); }
+
+    unsigned char* slot(std::size_t i) const { return base + RECORD_SIZE * (i + 1); }
+
+    void note(std::size_t i, uint16_t type, int64_t time_us) {
+        if (i == 0) first_time_us = time_us;
+        last_time_us = time_us;
+        ++counts[type];
+        if (i % INDEX_STRIDE == 0) index.push_back({time_us, static_cast<uint64_t>(i)});
+    }
+
+    /**
+     * @brief 截掉未使用的预分配区域, 写入索引尾部并落盘
+     */
+    bool seal() {
+        if (base) {
+            ::msync(base, mapped_bytes, MS_SYNC);
+            ::munmap(base, mapped_bytes);
+            base = nullptr;
+        }
+        const off_t records_end = static_cast<off_t>(RECORD_SIZE * (count + 1));
+        SegmentFooter footer{};
+        std::memcpy(footer.magic, FOOTER_MAGIC, sizeof(FOOTER_MAGIC));
+        footer.record_count = count;
+        footer.first_time_us = first_time_us;
+        footer.last_time_us = last_time_us;
+        std::copy(std::begin(counts), std::end(counts), footer.counts);
+        footer.index_stride = INDEX_STRIDE;
+        footer.index_entries = static_cast<uint32_t>(index.size());
+
+        const std::size_t index_bytes = index.size() * sizeof(IndexEntry);
+        bool ok = ::ftruncate(fd, records_end) == 0 &&
+                  ::pwrite(fd, index.data(), index_bytes, records_end) == static_cast<ssize_t>(index_bytes) &&
+                  ::pwrite(fd, &footer, sizeof(footer), records_end + static_cast<off_t>(index_bytes)) ==
+                      static_cast<ssize_t>(sizeof(footer)) &&
+                  ::fdatasync(fd) == 0;
+        close();
+        return ok;
+    }
+
+    void close() {
+        if (base) {
+            ::munmap(base, mapped_bytes);
+            base = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+};
+
+RecordingJournal::RecordingJournal(Options options)
+    : options_(std::move(options)) {
+    options_.channels = std::min(options_.channels, SensorReadingRecord::MAX_CHANNELS);
+    options_.segment_bytes = std::max<std::size_t>(options_.segment_bytes, RECORD_SIZE * 1024);
+}
+
+RecordingJournal::~RecordingJournal() {
+    stop();
+}
+
+bool RecordingJournal::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) return true;
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec) {
+        spdlog::error("RecordingJournal: Cannot create {}: {}", options_.directory, ec.message());
+        return false;
+    }
+    fs::remove(spare_path(), ec);
+
+    recover_segments();
+
+    stopping_ = false;
+    started_ = true;
+    sync_thread_ = std::thread(&RecordingJournal::sync_loop, this);
+    spdlog::info("RecordingJournal: Ready in {} ({} pending segment(s), next seq {})",
+                 options_.directory, sealed_segments_locked().size(), next_seq_);
+    return true;
+}
+
+void RecordingJournal::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_) return;
+        stopping_ = true;
+        seal_locked();
+        started_ = false;
+    }
+    cv_.notify_all();
+    if (sync_thread_.joinable()) {
+        sync_thread_.join();
+    }
+    std::error_code ec;
+    fs::remove(spare_path(), ec);
+    spdlog::info("RecordingJournal: Stopped (appended={}, dropped={})",
+                 records_appended_.load(), records_dropped_.load());
+}
+
+void RecordingJournal::append(const SensorReadingRecord& record) {
+    const int64_t time_us = to_unix_us(record.time);
+    auto buffer = make_record(RecordType::SensorReading, time_us);
+    auto* payload = payload_of<SensorPayload>(buffer);
+    payload->run_id = record.run_id.value_or(-1);
+    payload->device_tick = record.device_tick;
+    payload->frame_seq = record.frame_seq;
+    payload->heater_step = record.heater_step;
+    copy_text(payload->run_tag, record.run_tag);
+    copy_text(payload->phase, record.phase);
+    copy_text(payload->gas_mode, record.gas_mode);
+    std::memcpy(payload->channels, record.channels.data(), sizeof(payload->channels));
+    finish_record(buffer);
+    append_raw(buffer.data(), time_us);
+}
+
+void RecordingJournal::append(const WeightSampleRecord& record) {
+    const int64_t time_us = to_unix_us(record.time);
+    auto buffer = make_record(RecordType::WeightSample, time_us);
+    auto* payload = payload_of<WeightPayload>(buffer);
+    payload->run_id = record.run_id;
+    payload->cycle = record.cycle;
+    payload->weight = record.weight;
+    payload->is_stable = record.is_stable ? 1 : 0;
+    copy_text(payload->phase, record.phase);
+    copy_text(payload->trend, record.trend);
+    finish_record(buffer);
+    append_raw(buffer.data(), time_us);
+}
+
+void RecordingJournal::append(const JournalEvent& event) {
+    const int64_t time_us = to_unix_us(event.time);
+    auto buffer = make_record(RecordType::Event, time_us);
+    auto* payload = payload_of<EventPayload>(buffer);
+    copy_text(payload->level, event.level);
+    copy_text(payload->source, event.source);
+    copy_text(payload->message, event.message);
+    finish_record(buffer);
+    append_raw(buffer.data(), time_us);
+}
+
+void RecordingJournal::append_raw(const unsigned char* record, int64_t time_us) {
+    bool want_spare = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_ || stopping_ || (!active_ && !open_segment_locked())) {
+            ++records_dropped_;
+            return;
+        }
+
+        auto& seg = *active_;
+        std::memcpy(seg.slot(seg.count), record, RECORD_SIZE);
+        uint16_t type;
+        std::memcpy(&type, record, sizeof(type));
+        seg.note(seg.count, type, time_us);
+        ++seg.count;
+        ++records_appended_;
+
+        if (seg.count == seg.capacity) {
+            seal_locked();
+        }
+        want_spare = !spare_ready_ && spare_for_seq_ != next_seq_;
+    }
+    if (want_spare) {
+        cv_.notify_one();
+    }
+}
+
+void RecordingJournal::rotate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active_ && active_->count > 0) {
+        seal_locked();
+    }
+}
+
+bool RecordingJournal::open_segment_locked() {
+    enforce_capacity_locked();
+
+    auto seg = std::make_unique<Segment>();
+    seg->seq = next_seq_;
+    seg->path = segment_path(seg->seq);
+    seg->capacity = capacity();
+    seg->mapped_bytes = file_bytes();
+
+    // 优先使用后台线程预分配好的文件, 避免在采集线程里做 fallocate
+    bool from_spare = false;
+    if (spare_ready_) {
+        spare_ready_ = false;
+        from_spare = ::rename(spare_path().c_str(), seg->path.c_str()) == 0;
+    }
+    seg->fd = ::open(seg->path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (seg->fd < 0) {
+        spdlog::error("RecordingJournal: Cannot open {}: {}", seg->path, std::strerror(errno));
+        return false;
+    }
+    if (!from_spare) {
+        int err = ::posix_fallocate(seg->fd, 0, static_cast<off_t>(seg->mapped_bytes));
+        if (err != 0) {
+            spdlog::error("RecordingJournal: Cannot allocate {}: {}", seg->path, std::strerror(err));
+            seg->close();
+            ::unlink(seg->path.c_str());
+            return false;
+        }
+    }
+
+    void* base = ::mmap(nullptr, seg->mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (base == MAP_FAILED) {
+        spdlog::error("RecordingJournal: mmap {} failed: {}", seg->path, std::strerror(errno));
+        seg->close();
+        ::unlink(seg->path.c_str());
+        return false;
+    }
+    seg->base = static_cast<unsigned char*>(base);
+
+    SegmentHeader header{};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.record_size = RECORD_SIZE;
+    header.capacity = seg->capacity;
+    header.sequence = seg->seq;
+    header.created_us = to_unix_us(std::chrono::system_clock::now());
+    header.channels = static_cast<uint32_t>(options_.channels);
+    copy_text(header.device_id, options_.device_id);
+    std::memcpy(seg->base, &header, sizeof(header));
+
+    ++next_seq_;
+    spdlog::info("RecordingJournal: Recording to {}", seg->path);
+    active_ = std::move(seg);
+    return true;
+}
+
+void RecordingJournal::seal_locked() {
+    if (!active_) return;
+    auto seg = std::move(active_);
+    if (seg->count == 0) {
+        seg->close();
+        ::unlink(seg->path.c_str());
+        return;
+    }
+    if (seg->seal()) {
+        ++segments_sealed_;
+        spdlog::info("RecordingJournal: Sealed {} ({} records)", seg->path, seg->count);
+    } else {
+        spdlog::error("RecordingJournal: Failed to seal {}: {}", seg->path, std::strerror(errno));
+    }
+}
+
+void RecordingJournal::recover_segments() {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t seq;
+        if (!entry.is_regular_file() || !parse_segment_seq(entry.path(), seq)) continue;
+        next_seq_ = std::max(next_seq_, seq + 1);
+
+        Segment seg;
+        seg.path = entry.path().string();
+        seg.seq = seq;
+        seg.fd = ::open(seg.path.c_str(), O_RDWR | O_CLOEXEC);
+        if (seg.fd < 0) continue;
+
+        struct stat st{};
+        SegmentFooter footer{};
+        if (::fstat(seg.fd, &st) != 0 || read_footer(seg.fd, st.st_size, footer)) continue;
+
+        // 未封存 (上次未正常退出): 扫描到第一条无效记录为止, 补写尾部
+        SegmentHeader header{};
+        if (st.st_size < static_cast<off_t>(RECORD_SIZE) ||
+            ::pread(seg.fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+            seg.close();
+            quarantine_segment(seg.path);
+            continue;
+        }
+        RecordBuffer buffer;
+        RecordHeader rec{};
+        off_t offset = RECORD_SIZE;
+        while (offset + static_cast<off_t>(RECORD_SIZE) <= st.st_size &&
+               ::pread(seg.fd, buffer.data(), RECORD_SIZE, offset) == static_cast<ssize_t>(RECORD_SIZE) &&
+               valid_record(buffer.data(), rec)) {
+            seg.note(seg.count, rec.type, rec.time_us);
+            ++seg.count;
+            offset += RECORD_SIZE;
+        }
+
+        if (seg.count == 0) {
+            seg.close();
+            fs::remove(entry.path(), ec);
+            continue;
+        }
+        if (seg.seal()) {
+            ++segments_sealed_;
+            spdlog::warn("RecordingJournal: Recovered unsealed segment {} ({} records)", seg.path, seg.count);
+        }
+    }
+}
+
+void RecordingJournal::enforce_capacity_locked() {
+    auto sealed = sealed_segments_locked();
+    std::error_code ec;
+    uint64_t total = file_bytes();
+    std::vector<uint64_t> sizes;
+    for (const auto& path : sealed) {
+        sizes.push_back(fs::file_size(path, ec));
+        total += sizes.back();
+    }
+    for (std::size_t i = 0; i < sealed.size() && total > options_.max_total_bytes; ++i) {
+        spdlog::warn("RecordingJournal: Disk budget exceeded, evicting {} before upload", sealed[i]);
+        fs::remove(sealed[i], ec);
+        total -= sizes[i];
+        ++segments_evicted_;
+    }
+}
+
+void RecordingJournal::sync_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, options_.sync_interval, [this] {
+            return stopping_ || (active_ && !spare_ready_ && spare_for_seq_ != next_seq_);
+        });
+        if (stopping_) break;
+
+        // 只请求内核安排回写, 不等待; 页缓存把多次 append 合并成少量块写入
+        if (active_ && active_->base) {
+            ::msync(active_->base, active_->mapped_bytes, MS_ASYNC);
+        }
+
+        // 正在记录时提前分配下一个段文件
+        if (active_ && !spare_ready_ && spare_for_seq_ != next_seq_) {
+            spare_for_seq_ = next_seq_;
+            lock.unlock();
+            prepare_spare();
+            lock.lock();
+        }
+    }
+}
+
+void RecordingJournal::prepare_spare() {
+    const std::string path = spare_path();
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    int err = ::posix_fallocate(fd, 0, static_cast<off_t>(file_bytes()));
+    ::close(fd);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (err == 0) {
+        spare_ready_ = true;
+    } else {
+        spdlog::warn("RecordingJournal: Cannot preallocate spare segment: {}", std::strerror(err));
+        ::unlink(path.c_str());
+    }
+}
+
+std::vector<std::string> RecordingJournal::sealed_segments() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sealed_segments_locked();
+}
+
+std::vector<std::string> RecordingJournal::sealed_segments_locked() const {
+    std::vector<std::pair<uint64_t, std::string>> found;
+    const std::string active_path = active_ ? active_->path : std::string();
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t seq;
+        if (!entry.is_regular_file() || !parse_segment_seq(entry.path(), seq)) continue;
+        if (entry.path().string() == active_path) continue;
+        found.emplace_back(seq, entry.path().string());
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> paths;
+    paths.reserve(found.size());
+    for (auto& [seq, path] : found) {
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+void RecordingJournal::remove_segment(const std::string& path) {
+    std::error_code ec;
+    if (fs::remove(path, ec)) {
+        ++segments_removed_;
+    }
+}
+
+void RecordingJournal::quarantine_segment(const std::string& path, const std::string& reason) {
+    std::error_code ec;
+    fs::rename(path, path + ".bad", ec);
+    spdlog::error("RecordingJournal: Quarantined segment {} as {}.bad ({})", path, path, reason);
+}
+
+bool RecordingJournal::read_segment(const std::string& path, SegmentContents& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    SegmentFooter footer{};
+    if (::fstat(fd, &st) != 0 || !read_footer(fd, st.st_size, footer)) {
+        ::close(fd);
+        return false;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+    const auto* base = static_cast<const unsigned char*>(mapped);
+
+    SegmentHeader header{};
+    std::memcpy(&header, base, sizeof(header));
+    const std::size_t records_end = RECORD_SIZE * (footer.record_count + 1);
+    const bool ok = std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) == 0 &&
+                    header.record_size == RECORD_SIZE &&
+                    records_end + footer.index_entries * sizeof(IndexEntry) + sizeof(SegmentFooter) == size;
+    if (!ok) {
+        ::munmap(mapped, size);
+        return false;
+    }
+
+    out = {};
+    out.device_id = read_text(header.device_id);
+    out.channels = std::min<std::size_t>(header.channels, SensorReadingRecord::MAX_CHANNELS);
+    out.sensor_readings.reserve(footer.counts[static_cast<std::size_t>(RecordType::SensorReading)]);
+    out.weight_samples.reserve(footer.counts[static_cast<std::size_t>(RecordType::WeightSample)]);
+
+    RecordBuffer buffer;
+    RecordHeader rec{};
+    for (std::size_t i = 0; i < footer.record_count; ++i) {
+        std::memcpy(buffer.data(), base + RECORD_SIZE * (i + 1), RECORD_SIZE);
+        if (!valid_record(buffer.data(), rec)) continue;
+
+        switch (static_cast<RecordType>(rec.type)) {
+        case RecordType::SensorReading: {
+            const auto* p = payload_of<SensorPayload>(buffer);
+            SensorReadingRecord r;
+            r.time = from_unix_us(rec.time_us);
+            if (p->run_id >= 0) r.run_id = p->run_id;
+            r.run_tag = read_text(p->run_tag);
+            r.phase = read_text(p->phase);
+            r.gas_mode = read_text(p->gas_mode);
+            r.heater_step = p->heater_step;
+            r.frame_seq = p->frame_seq;
+            r.device_tick = p->device_tick;
+            std::memcpy(r.channels.data(), p->channels, sizeof(p->channels));
+            out.sensor_readings.push_back(std::move(r));
+            break;
+        }
+        case RecordType::WeightSample: {
+            const auto* p = payload_of<WeightPayload>(buffer);
+            WeightSampleRecord r;
+            r.time = from_unix_us(rec.time_us);
+            r.run_id = p->run_id;
+            r.cycle = p->cycle;
+            r.phase = read_text(p->phase);
+            r.weight = p->weight;
+            r.is_stable = p->is_stable != 0;
+            r.trend = read_text(p->trend);
+            out.weight_samples.push_back(std::move(r));
+            break;
+        }
+        case RecordType::Event: {
+            const auto* p = payload_of<EventPayload>(buffer);
+            out.events.push_back({from_unix_us(rec.time_us), read_text(p->level),
+                                  read_text(p->source), read_text(p->message)});
+            break;
+        }
+        case RecordType::Empty:
+            break;
+        }
+    }
+
+    ::munmap(mapped, size);
+    return true;
+}
+
+RecordingJournal::Stats RecordingJournal::stats() const {
+    Stats s;
+    s.records_appended = records_appended_;
+    s.records_dropped = records_dropped_;
+    s.segments_sealed = segments_sealed_;
+    s.segments_removed = segments_removed_;
+    s.segments_evicted = segments_evicted_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.active_records = active_ ? active_->count : 0;
+    auto sealed = sealed_segments_locked();
+    s.sealed_segments = sealed.size();
+    std::error_code ec;
+    for (const auto& path : sealed) {
+        s.disk_bytes += fs::file_size(path, ec);
+    }
+    if (active_) s.disk_bytes += active_->mapped_bytes;
+    return s;
+}
+
+std::string RecordingJournal::segment_path(uint64_t seq) const {
+    std::ostringstream oss;
+    oss << SEGMENT_PREFIX << std::setfill('0') << std::setw(10) << seq << SEGMENT_SUFFIX;
+    return (fs::path(options_.directory) / oss.str()).string();
+}
+
+std::string RecordingJournal::spare_path() const {
+    return (fs::path(options_.directory) / "spare.tmp").string();
+}
+
+std::size_t RecordingJournal::capacity() const {
+    // 预留段头和满段时的索引尾部
+    const std::size_t records = options_.segment_bytes / RECORD_SIZE - 2;
+    return records - (index_entries_for(records) * sizeof(IndexEntry)) / RECORD_SIZE;
+}
+
+std::size_t RecordingJournal::file_bytes() const {
+    const std::size_t records = capacity();
+    return RECORD_SIZE * (records + 1) + index_entries_for(records) * sizeof(IndexEntry) + sizeof(SegmentFooter);
+}
+
+} // namespace db
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "sensor_reading_repository.hpp"
+#include "test_run_repository.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+// 系统事件记录 (对应 system_logs 表的一行)
+struct JournalEvent {
+    std::chrono::system_clock::time_point time;
+    std::string level;      // info / warning / error
+    std::string source;
+    std::string message;
+};
+
+/**
+ * @brief 数据库不可用时的本地追加写记录日志
+ *
+ * 写入 directory 下按序号命名的段文件 (segment-<seq>.enj), 每个段预分配固定大小并 mmap,
+ * append 只是一次 ~256 字节的 memcpy, 由后台线程定期 msync(MS_ASYNC) 让页缓存批量回写,
+ * 不为每条记录产生一次 SD 卡写入. 段写满或 rotate() 时写入索引尾部并封存,
+ * 封存的段由 JournalUploader 补传到 TimescaleDB 后删除.
+ *
+ * 段文件布局 (小端, 与树莓派原生字节序一致):
+ *   [段头 256B][记录 0][记录 1]...[记录 capacity-1][索引尾部]
+ * 每条记录 256 字节定宽: 类型 + CRC32 + 微秒时间戳 + 按类型解释的负载; 变长字符串截断到定长.
+ * 索引尾部记录条数、时间范围和每 INDEX_STRIDE 条一个的 (时间, 记录号) 稀疏索引.
+ * 崩溃后未封存的段在下次启动时按 CRC 扫描到第一条无效记录, 补写尾部后封存.
+ *
+ * append 可在任意线程调用; 段满时若后台线程已预分配好下一个段文件则只需 rename + mmap.
+ */
+class RecordingJournal {
+public:
+    struct Options {
+        std::string directory = "/var/lib/enose-control/journal";
+        std::string device_id = "default";          // 随段头保存, 补传时写入 sensor_readings.device_id
+        std::size_t channels = 16;
+        std::size_t segment_bytes = 16u << 20;
+        std::size_t max_total_bytes = 2048ull << 20; // 超出时删除最旧的已封存段
+        std::chrono::milliseconds sync_interval{1000};
+    };
+
+    struct Stats {
+        uint64_t records_appended = 0;
+        uint64_t records_dropped = 0;       // 无法打开段文件时丢弃
+        uint64_t segments_sealed = 0;
+        uint64_t segments_removed = 0;      // 补传完成后删除
+        uint64_t segments_evicted = 0;      // 超出 max_total_bytes 未补传即删除
+        std::size_t active_records = 0;
+        std::size_t sealed_segments = 0;
+        uint64_t disk_bytes = 0;
+    };
+
+    // 一个已封存段解码后的内容
+    struct SegmentContents {
+        std::string device_id;
+        std::size_t channels = 0;
+        std::vector<SensorReadingRecord> sensor_readings;
+        std::vector<WeightSampleRecord> weight_samples;
+        std::vector<JournalEvent> events;
+    };
+
+    static constexpr std::size_t RECORD_SIZE = 256;
+    static constexpr std::size_t INDEX_STRIDE = 256;
+
+    explicit RecordingJournal(Options options);
+    ~RecordingJournal();
+
+    RecordingJournal(const RecordingJournal&) = delete;
+    RecordingJournal& operator=(const RecordingJournal&) = delete;
+
+    /**
+     * @brief 创建目录, 封存上次遗留的未封存段, 启动后台同步线程
+     * @return 目录不可用时返回 false (之后的 append 计为丢弃)
+     */
+    bool start();
+
+    /** @brief 封存当前段并停止后台线程 */
+    void stop();
+
+    void append(const SensorReadingRecord& record);
+    void append(const WeightSampleRecord& record);
+    void append(const JournalEvent& event);
+
+    /** @brief 封存当前段 (非空时), 让补传线程立即可以处理 */
+    void rotate();
+
+    /** @brief 已封存、待补传的段文件, 按序号从旧到新 */
+    std::vector<std::string> sealed_segments() const;
+
+    /** @brief 补传完成后删除段文件 */
+    void remove_segment(const std::string& path);
+
+    /** @brief 无法解码或被数据库拒绝的段改名为 .bad 保留现场, 不再补传 */
+    void quarantine_segment(const std::string& path, const std::string& reason = "unreadable");
+
+    /**
+     * @brief 解码一个已封存的段文件
+     * @return 文件不完整或格式不符时返回 false
+     */
+    static bool read_segment(const std::string& path, SegmentContents& out);
+
+    Stats stats() const;
+
+    const Options& options() const { return options_; }
+
+private:
+    struct Segment;
+
+    void append_raw(const unsigned char* record, int64_t time_us);
+    bool open_segment_locked();
+    void seal_locked();
+    void recover_segments();
+    void enforce_capacity_locked();
+    void sync_loop();
+    void prepare_spare();
+    std::vector<std::string> sealed_segments_locked() const;
+
+    std::string segment_path(uint64_t seq) const;
+    std::string spare_path() const;
+    std::size_t capacity() const;
+    std::size_t file_bytes() const;
+
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unique_ptr<Segment> active_;
+    uint64_t next_seq_{1};
+    bool spare_ready_{false};
+    uint64_t spare_for_seq_{0};             // 已为该序号尝试过预分配, 失败后不再重试
+    bool started_{false};
+    bool stopping_{false};
+    std::thread sync_thread_;
+
+    std::atomic<uint64_t> records_appended_{0};
+    std::atomic<uint64_t> records_dropped_{0};
+    std::atomic<uint64_t> segments_sealed_{0};
+    std::atomic<uint64_t> segments_removed_{0};
+    std::atomic<uint64_t> segments_evicted_{0};
+};
+
+} // namespace db
@@ -0,0 +1,456 @@
+#include "run_archive.hpp"
+#include <spdlog/spdlog.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace db {
+
+namespace {
+
+constexpr std::size_t COLUMN_ALIGNMENT = 64;
+constexpr std::size_t SPOOL_BUFFER_BYTES = 64 * 1024;
+constexpr std::size_t COPY_CHUNK_BYTES = 1 << 20;
+
+uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t unix_us(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+void set_error(std::string* error, std::string message) {
+    if (error) *error = std::move(message);
+}
+
+// runs.config_json / metadata 是 JSON 文本; 无法解析时按原文保存
+nlohmann::json parse_or_string(const std::string& text) {
+    if (text.empty()) return nullptr;
+    auto j = nlohmann::json::parse(text, nullptr, false);
+    return j.is_discarded() ? nlohmann::json(text) : j;
+}
+
+bool write_all(std::FILE* file, const void* data, std::size_t bytes) {
+    return bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool pad_to(std::FILE* file, uint64_t& position, uint64_t target) {
+    static const unsigned char zeros[COLUMN_ALIGNMENT] = {};
+    while (position < target) {
+        const auto n = static_cast<std::size_t>(std::min<uint64_t>(target - position, sizeof(zeros)));
+        if (!write_all(file, zeros, n)) return false;
+        position += n;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string_view ArchiveColumn::column_name() const {
+    return std::string_view(name, strnlen(name, NAME_BYTES));
+}
+
+// ---------------------------------------------------------------- RunArchive
+
+std::shared_ptr<const RunArchive> RunArchive::open(const std::string& path, std::string* error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        set_error(error, path + ": " + std::strerror(errno));
+        return nullptr;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(RunArchiveHeader)) {
+        ::close(fd);
+        set_error(error, path + ": truncated");
+        return nullptr;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        set_error(error, path + ": mmap: " + std::strerror(errno));
+        return nullptr;
+    }
+    std::shared_ptr<const RunArchive> archive(new RunArchive(path, static_cast<const unsigned char*>(mapped), size));
+
+    // 校验头部和各段边界, 之后的访问不再检查
+    const auto& h = archive->header();
+    auto within = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+    if (std::memcmp(h.magic, RunArchiveHeader::MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != RunArchiveHeader::VERSION || h.header_bytes != sizeof(RunArchiveHeader) ||
+        h.file_bytes != size || h.index_stride == 0 ||
+        !within(h.json_offset, h.json_bytes) ||
+        !within(h.columns_offset, static_cast<uint64_t>(h.column_count) * sizeof(ArchiveColumn)) ||
+        !within(h.index_offset, h.index_entries * sizeof(ArchiveIndexEntry)) ||
+        h.columns_offset % alignof(ArchiveColumn) != 0 || h.index_offset % alignof(ArchiveIndexEntry) != 0) {
+        set_error(error, path + ": invalid archive header");
+        return nullptr;
+    }
+    for (const auto& column : archive->columns()) {
+        const uint64_t rows = column.table == 0 ? h.rows : h.weight_rows;
+        if (column.width == 0 || column.count != rows || column.offset % COLUMN_ALIGNMENT != 0 ||
+            column.count > std::numeric_limits<uint64_t>::max() / column.width ||
+            !within(column.offset, column.count * column.width)) {
+            set_error(error, path + ": invalid column " + std::string(column.column_name()));
+            return nullptr;
+        }
+    }
+
+    // 稀疏索引: 第 i 项指向第 i * index_stride 行, 时间与该行一致 (lower_bound 直接用 row 切区间)
+    const auto times = archive->column<int64_t>("time_us");
+    const std::span<const ArchiveIndexEntry> index(
+        reinterpret_cast<const ArchiveIndexEntry*>(archive->data_ + h.index_offset), h.index_entries);
+    if (times.size() != h.rows || index.size() != (h.rows + h.index_stride - 1) / h.index_stride) {
+        set_error(error, path + ": invalid time index");
+        return nullptr;
+    }
+    for (std::size_t i = 0; i < index.size(); ++i) {
+        if (index[i].row != i * h.index_stride || index[i].time_us != times[index[i].row] ||
+            (i > 0 && index[i].time_us < index[i - 1].time_us)) {
+            set_error(error, path + ": invalid time index entry " + std::to_string(i));
+            return nullptr;
+        }
+    }
+    return archive;
+}
+
+RunArchive::~RunArchive() {
+    ::munmap(const_cast<unsigned char*>(data_), size_);
+}
+
+std::string_view RunArchive::json() const {
+    const auto& h = header();
+    return std::string_view(reinterpret_cast<const char*>(data_ + h.json_offset), h.json_bytes);
+}
+
+std::span<const ArchiveColumn> RunArchive::columns() const {
+    const auto& h = header();
+    return {reinterpret_cast<const ArchiveColumn*>(data_ + h.columns_offset), h.column_count};
+}
+
+const ArchiveColumn* RunArchive::find_column(std::string_view name) const {
+    for (const auto& column : columns()) {
+        if (column.column_name() == name) return &column;
+    }
+    return nullptr;
+}
+
+uint64_t RunArchive::lower_bound(int64_t time_us) const {
+    const auto& h = header();
+    const auto times = column<int64_t>("time_us");
+    if (times.empty()) return 0;
+    const std::span<const ArchiveIndexEntry> index(
+        reinterpret_cast<const ArchiveIndexEntry*>(data_ + h.index_offset), h.index_entries);
+
+    // 最后一个 time_us < t 的索引项之后才可能出现 >= t 的行
+    auto it = std::lower_bound(index.begin(), index.end(), time_us,
+        [](const ArchiveIndexEntry& e, int64_t t) { return e.time_us < t; });
+    const uint64_t first = it == index.begin() ? 0 : std::prev(it)->row;
+    const uint64_t last = it == index.end() ? times.size() : std::min<uint64_t>(it->row + 1, times.size());
+    return static_cast<uint64_t>(std::lower_bound(times.begin() + first, times.begin() + last, time_us) - times.begin());
+}
+
+std::pair<uint64_t, uint64_t> RunArchive::row_range(int64_t start_us, int64_t end_us) const {
+    if (end_us < start_us) return {0, 0};
+    const uint64_t first = lower_bound(start_us);
+    const uint64_t last = end_us == std::numeric_limits<int64_t>::max() ? header().rows : lower_bound(end_us + 1);
+    return {first, std::max(first, last)};
+}
+
+std::pair<uint64_t, uint64_t> RunArchive::weight_row_range(int64_t start_us, int64_t end_us) const {
+    const auto times = column<int64_t>("w.time_us");
+    if (end_us < start_us || times.empty()) return {0, 0};
+    const auto first = std::lower_bound(times.begin(), times.end(), start_us);
+    const auto last = std::upper_bound(first, times.end(), end_us);
+    return {static_cast<uint64_t>(first - times.begin()), static_cast<uint64_t>(last - times.begin())};
+}
+
+// ---------------------------------------------------------------- RunArchiveWriter
+
+RunArchiveWriter::RunArchiveWriter(std::string path, std::size_t channels)
+    : path_(std::move(path)), channels_(std::min(channels, SensorReadingRecord::MAX_CHANNELS)) {
+    spool_dir_ = path_ + ".spool";
+}
+
+RunArchiveWriter::~RunArchiveWriter() {
+    cleanup();
+}
+
+RunArchiveWriter::Spool& RunArchiveWriter::add_spool(std::string name, ArchiveColumnType type,
+                                                     uint8_t width, uint8_t table) {
+    auto spool = std::make_unique<Spool>();
+    spool->name = std::move(name);
+    spool->type = type;
+    spool->width = width;
+    spool->table = table;
+    spools_.push_back(std::move(spool));
+    return *spools_.back();
+}
+
+bool RunArchiveWriter::open(std::string* error) {
+    std::error_code ec;
+    std::filesystem::remove_all(spool_dir_, ec);
+    std::filesystem::create_directories(spool_dir_, ec);
+    if (ec) {
+        set_error(error, spool_dir_ + ": " + ec.message());
+        return false;
+    }
+
+    add_spool("time_us", ArchiveColumnType::I64, 8, 0);
+    add_spool("frame_seq", ArchiveColumnType::U64, 8, 0);
+    add_spool("device_tick", ArchiveColumnType::U32, 4, 0);
+    add_spool("heater_step", ArchiveColumnType::U8, 1, 0);
+    add_spool("phase", ArchiveColumnType::U16, 2, 0);
+    add_spool("gas_mode", ArchiveColumnType::U8, 1, 0);
+    add_spool("run_tag", ArchiveColumnType::U16, 2, 0);
+    for (std::size_t i = 0; i < channels_; ++i) {
+        add_spool("s" + std::to_string(i), ArchiveColumnType::F32, 4, 0);
+    }
+    for (std::size_t i = 0; i < channels_; ++i) {
+        add_spool("c" + std::to_string(i), ArchiveColumnType::F32, 4, 0);
+    }
+    weight_first_ = spools_.size();
+    add_spool("w.time_us", ArchiveColumnType::I64, 8, 1);
+    add_spool("w.seq", ArchiveColumnType::I64, 8, 1);
+    add_spool("w.cycle", ArchiveColumnType::I32, 4, 1);
+    add_spool("w.phase", ArchiveColumnType::U16, 2, 1);
+    add_spool("w.weight", ArchiveColumnType::F32, 4, 1);
+    add_spool("w.is_stable", ArchiveColumnType::U8, 1, 1);
+
+    for (std::size_t i = 0; i < spools_.size(); ++i) {
+        const auto file = spool_dir_ + "/" + std::to_string(i);
+        spools_[i]->file = std::fopen(file.c_str(), "w+b");
+        if (!spools_[i]->file) {
+            set_error(error, file + ": " + std::strerror(errno));
+            cleanup();
+            return false;
+        }
+        std::setvbuf(spools_[i]->file, nullptr, _IOFBF, SPOOL_BUFFER_BYTES);
+    }
+    return true;
+}
+
+void RunArchiveWriter::write(Spool& spool, const void* value) {
+    if (std::fwrite(value, spool.width, 1, spool.file) != 1) {
+        failed_ = true;
+    }
+    ++spool.count;
+}
+
+uint16_t RunArchiveWriter::intern(std::vector<std::string>& dictionary, std::map<std::string, uint16_t>& index,
+                                  const std::string& value) {
+    auto it = index.find(value);
+    if (it != index.end()) return it->second;
+    if (dictionary.size() > std::numeric_limits<uint16_t>::max()) return 0;
+    const auto id = static_cast<uint16_t>(dictionary.size());
+    dictionary.push_back(value);
+    index.emplace(value, id);
+    return id;
+}
+
+void RunArchiveWriter::append(const SensorReadingRecord& row) {
+    const int64_t time_us = unix_us(row.time);
+    if (rows_ % INDEX_STRIDE == 0) {
+        index_.push_back({time_us, rows_});
+    }
+    if (rows_ == 0) first_us_ = time_us;
+    last_us_ = time_us;
+
+    if (!step_open_ || row.phase != step_phase_) {
+        close_step();
+        step_open_ = true;
+        step_phase_ = row.phase;
+        step_start_us_ = time_us;
+        step_first_row_ = rows_;
+    }
+    step_end_us_ = time_us;
+
+    const uint16_t phase = intern(phases_, phase_index_, row.phase);
+    const auto gas_mode = static_cast<uint8_t>(std::min<uint16_t>(intern(gas_modes_, gas_mode_index_, row.gas_mode), 255));
+    const uint16_t run_tag = intern(run_tags_, run_tag_index_, row.run_tag);
+
+    std::size_t i = 0;
+    write(*spools_[i++], &time_us);
+    write(*spools_[i++], &row.frame_seq);
+    write(*spools_[i++], &row.device_tick);
+    write(*spools_[i++], &row.heater_step);
+    write(*spools_[i++], &phase);
+    write(*spools_[i++], &gas_mode);
+    write(*spools_[i++], &run_tag);
+    for (std::size_t c = 0; c < channels_; ++c) {
+        write(*spools_[i++], &row.channels[c]);
+    }
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (std::size_t c = 0; c < channels_; ++c) {
+        write(*spools_[i++], row.corrected ? &(*row.corrected)[c] : &nan);
+    }
+    ++rows_;
+}
+
+void RunArchiveWriter::append(const WeightSampleRecord& row) {
+    const int64_t time_us = unix_us(row.time);
+    if (weight_rows_ == 0) weight_first_us_ = time_us;
+    weight_last_us_ = time_us;
+
+    const uint16_t phase = intern(phases_, phase_index_, row.phase);
+    const uint8_t stable = row.is_stable ? 1 : 0;
+    std::size_t i = weight_first_;
+    write(*spools_[i++], &time_us);
+    write(*spools_[i++], &row.seq);
+    write(*spools_[i++], &row.cycle);
+    write(*spools_[i++], &phase);
+    write(*spools_[i++], &row.weight);
+    write(*spools_[i++], &stable);
+    ++weight_rows_;
+}
+
+void RunArchiveWriter::close_step() {
+    if (!step_open_) return;
+    steps_.push_back({
+        {"phase", step_phase_},
+        {"start_us", step_start_us_},
+        {"end_us", step_end_us_},
+        {"first_row", step_first_row_},
+        {"rows", rows_ - step_first_row_},
+    });
+    step_open_ = false;
+}
+
+bool RunArchiveWriter::finish(const TestRunRecord& run, const nlohmann::json& extra, std::string* error) {
+    if (spools_.empty()) {
+        set_error(error, "archive writer not open");
+        return false;
+    }
+    close_step();
+    for (auto& spool : spools_) {
+        if (std::fflush(spool->file) != 0) failed_ = true;
+    }
+    if (failed_) {
+        set_error(error, "failed to write column spool under " + spool_dir_);
+        cleanup();
+        return false;
+    }
+
+    nlohmann::json header_json = extra.is_object() ? extra : nlohmann::json::object();
+    header_json["format"] = "enose-run-archive";
+    header_json["version"] = RunArchiveHeader::VERSION;
+    header_json["run_id"] = run.id;
+    header_json["state"] = run.state;
+    header_json["created_at_us"] = unix_us(run.created_at);
+    header_json["completed_at_us"] = run.completed_at ? nlohmann::json(unix_us(*run.completed_at)) : nlohmann::json(nullptr);
+    header_json["total_steps"] = run.total_steps;
+    header_json["program"] = parse_or_string(run.config_json);
+    header_json["metadata"] = parse_or_string(run.metadata_json);
+    header_json["channels"] = channels_;
+    header_json["phases"] = phases_;
+    header_json["gas_modes"] = gas_modes_;
+    header_json["run_tags"] = run_tags_;
+    header_json["steps"] = steps_;
+    header_json["archived_at_us"] = unix_us(std::chrono::system_clock::now());
+    const std::string json_text = header_json.dump();
+
+    // 布局: 头 | JSON | 列目录 | 索引 | 各列 (64 字节对齐)
+    RunArchiveHeader header{};
+    std::memcpy(header.magic, RunArchiveHeader::MAGIC, sizeof(header.magic));
+    header.version = RunArchiveHeader::VERSION;
+    header.header_bytes = sizeof(RunArchiveHeader);
+    header.run_id = run.id;
+    header.channels = static_cast<uint32_t>(channels_);
+    header.rows = rows_;
+    header.weight_rows = weight_rows_;
+    header.start_us = rows_ > 0 ? first_us_ : weight_first_us_;
+    header.end_us = rows_ > 0 ? last_us_ : weight_last_us_;
+    header.json_offset = sizeof(RunArchiveHeader);
+    header.json_bytes = json_text.size();
+    header.columns_offset = align_up(header.json_offset + header.json_bytes, 8);
+    header.column_count = static_cast<uint32_t>(spools_.size());
+    header.index_stride = INDEX_STRIDE;
+    header.index_offset = align_up(header.columns_offset + spools_.size() * sizeof(ArchiveColumn), 8);
+    header.index_entries = index_.size();
+
+    std::vector<ArchiveColumn> directory(spools_.size());
+    uint64_t offset = align_up(header.index_offset + index_.size() * sizeof(ArchiveIndexEntry), COLUMN_ALIGNMENT);
+    for (std::size_t i = 0; i < spools_.size(); ++i) {
+        const auto& spool = *spools_[i];
+        auto& column = directory[i];
+        std::memset(&column, 0, sizeof(column));
+        std::strncpy(column.name, spool.name.c_str(), ArchiveColumn::NAME_BYTES - 1);
+        column.type = spool.type;
+        column.width = spool.width;
+        column.table = spool.table;
+        column.offset = offset;
+        column.count = spool.count;
+        offset = align_up(offset + spool.count * spool.width, COLUMN_ALIGNMENT);
+    }
+    header.file_bytes = directory.empty() ? offset
+        : directory.back().offset + directory.back().count * directory.back().width;
+
+    const std::string temp = path_ + ".tmp";
+    std::FILE* out = std::fopen(temp.c_str(), "wb");
+    if (!out) {
+        set_error(error, temp + ": " + std::strerror(errno));
+        cleanup();
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = write_all(out, &header, sizeof(header));
+    position += sizeof(header);
+    ok = ok && write_all(out, json_text.data(), json_text.size());
+    position += json_text.size();
+    ok = ok && pad_to(out, position, header.columns_offset);
+    ok = ok && write_all(out, directory.data(), directory.size() * sizeof(ArchiveColumn));
+    position += directory.size() * sizeof(ArchiveColumn);
+    ok = ok && pad_to(out, position, header.index_offset);
+    ok = ok && write_all(out, index_.data(), index_.size() * sizeof(ArchiveIndexEntry));
+    position += index_.size() * sizeof(ArchiveIndexEntry);
+
+    std::vector<unsigned char> buffer(COPY_CHUNK_BYTES);
+    for (std::size_t i = 0; ok && i < spools_.size(); ++i) {
+        ok = pad_to(out, position, directory[i].offset);
+        std::rewind(spools_[i]->file);
+        uint64_t remaining = directory[i].count * directory[i].width;
+        while (ok && remaining > 0) {
+            const auto n = std::fread(buffer.data(), 1, static_cast<std::size_t>(std::min<uint64_t>(remaining, buffer.size())),
+                                      spools_[i]->file);
+            ok = n > 0 && write_all(out, buffer.data(), n);
+            remaining -= n;
+            position += n;
+        }
+    }
+    ok = ok && std::fflush(out) == 0 && ::fsync(fileno(out)) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    cleanup();
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp, path_, ec);
+    }
+    if (!ok || ec) {
+        std::filesystem::remove(temp, ec);
+        set_error(error, "failed to write " + path_);
+        return false;
+    }
+    return true;
+}
+
+void RunArchiveWriter::cleanup() {
+    for (auto& spool : spools_) {
+        if (spool->file) {
+            std::fclose(spool->file);
+            spool->file = nullptr;
+        }
+    }
+    spools_.clear();
+    std::error_code ec;
+    std::filesystem::remove_all(spool_dir_, ec);
+}
+
+} // namespace db
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "sensor_reading_repository.hpp"
+#include "test_run_repository.hpp"
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace db {
+
+/**
+ * 运行归档文件 (run-<id>.enra) 布局, 小端 (与树莓派原生字节序一致), 可直接 mmap 使用:
+ *
+ *   [RunArchiveHeader 128B][JSON 头][列目录 ArchiveColumn × n][时间索引 ArchiveIndexEntry × m][列 0][列 1]...
+ *
+ * - JSON 头: 运行记录 (program = runs.config_json, metadata, state, 起止时间), 设备与通道数,
+ *   phase / gas_mode / run_tag 字典 (列中存下标, 0 为空字符串) 和阶段边界 (steps).
+ * - 列: 每列一段连续的定宽数组, 起始按 64 字节对齐. 读数表每帧一行: time_us, frame_seq,
+ *   device_tick, heater_step, phase, gas_mode, run_tag, s0..s{n-1} (原始值), c0..c{n-1}
+ *   (漂移校正值, 无校正为 NaN); 称重表以 "w." 为前缀.
+ * - 时间索引: 读数表每 index_stride 行一个 (time_us, row), 与 time_us 列一起做两级二分查找.
+ */
+struct RunArchiveHeader {
+    static constexpr char MAGIC[8] = {'E', 'N', 'O', 'S', 'R', 'U', 'N', '\0'};
+    static constexpr uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;          // sizeof(RunArchiveHeader)
+    int32_t run_id;
+    uint32_t channels;
+    uint64_t rows;                  // 读数行数
+    uint64_t weight_rows;
+    int64_t start_us;               // 首 / 末读数时间 (无读数时为称重样本), Unix 微秒
+    int64_t end_us;
+    uint64_t json_offset;
+    uint64_t json_bytes;
+    uint64_t columns_offset;
+    uint32_t column_count;
+    uint32_t index_stride;
+    uint64_t index_offset;
+    uint64_t index_entries;
+    uint64_t file_bytes;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(RunArchiveHeader) == 128);
+
+enum class ArchiveColumnType : uint8_t { I64, U64, I32, U32, U16, U8, F32 };
+
+struct ArchiveColumn {
+    static constexpr std::size_t NAME_BYTES = 24;
+
+    char name[NAME_BYTES];          // 以 '\0' 结尾
+    ArchiveColumnType type;
+    uint8_t width;                  // 元素字节数
+    uint8_t table;                  // 0 = 读数, 1 = 称重样本
+    uint8_t reserved[5];
+    uint64_t offset;                // 文件内偏移, 64 字节对齐
+    uint64_t count;                 // 元素个数 (= 所属表的行数)
+
+    std::string_view column_name() const;
+};
+static_assert(sizeof(ArchiveColumn) == 48);
+
+struct ArchiveIndexEntry {
+    int64_t time_us;
+    uint64_t row;
+};
+
+/**
+ * @brief 只读打开的归档 (整个文件 mmap), 列以 span 直接指向映射内存
+ *
+ * 对象不可变, 可在多个线程间共享; 最后一个 shared_ptr 释放时 munmap.
+ */
+class RunArchive {
+public:
+    /** @brief 打开并校验文件; 失败时返回空并写入 error */
+    static std::shared_ptr<const RunArchive> open(const std::string& path, std::string* error = nullptr);
+
+    ~RunArchive();
+
+    RunArchive(const RunArchive&) = delete;
+    RunArchive& operator=(const RunArchive&) = delete;
+
+    const RunArchiveHeader& header() const { return *reinterpret_cast<const RunArchiveHeader*>(data_); }
+    std::string_view json() const;
+    std::span<const ArchiveColumn> columns() const;
+    const ArchiveColumn* find_column(std::string_view name) const;
+
+    /** @brief 列内容; 列不存在或元素宽度与 T 不符时为空 */
+    template <typename T>
+    std::span<const T> column(std::string_view name) const {
+        const auto* c = find_column(name);
+        if (!c || c->width != sizeof(T)) return {};
+        return {reinterpret_cast<const T*>(data_ + c->offset), static_cast<std::size_t>(c->count)};
+    }
+
+    /** @brief 整个文件 */
+    std::span<const unsigned char> bytes() const { return {data_, size_}; }
+
+    /** @brief 第一个 time_us >= t 的读数行: 先在稀疏索引上二分, 再在一个索引区间内二分 */
+    uint64_t lower_bound(int64_t time_us) const;
+
+    /** @brief [start_us, end_us] 内的读数行 [first, last) */
+    std::pair<uint64_t, uint64_t> row_range(int64_t start_us, int64_t end_us) const;
+
+    /** @brief [start_us, end_us] 内的称重样本行 (称重表无稀疏索引, 直接在 w.time_us 上二分) */
+    std::pair<uint64_t, uint64_t> weight_row_range(int64_t start_us, int64_t end_us) const;
+
+    const std::string& path() const { return path_; }
+
+private:
+    RunArchive(std::string path, const unsigned char* data, std::size_t size)
+        : path_(std::move(path)), data_(data), size_(size) {}
+
+    std::string path_;
+    const unsigned char* data_;
+    std::size_t size_;
+};
+
+/**
+ * @brief 逐行追加并生成归档
+ *
+ * 每列先写入各自的临时文件 (顺序写, 内存只占各列的 stdio 缓冲), finish() 时按布局把各列
+ * 依次拷入 <path>.tmp, 写好头部后 fsync 并改名为 path; 读者只会看到完整的文件.
+ * 读数须按时间顺序追加 (与 sensor_readings 的 keyset 顺序一致).
+ */
+class RunArchiveWriter {
+public:
+    static constexpr uint32_t INDEX_STRIDE = 1024;
+
+    RunArchiveWriter(std::string path, std::size_t channels);
+    ~RunArchiveWriter();
+
+    RunArchiveWriter(const RunArchiveWriter&) = delete;
+    RunArchiveWriter& operator=(const RunArchiveWriter&) = delete;
+
+    /** @brief 创建临时目录和各列文件 */
+    bool open(std::string* error = nullptr);
+
+    void append(const SensorReadingRecord& row);
+    void append(const WeightSampleRecord& row);
+
+    /**
+     * @brief 写出归档
+     * @param run 写入 JSON 头的运行记录
+     * @param extra 合并进 JSON 头的其他字段 (device_id 等)
+     */
+    bool finish(const TestRunRecord& run, const nlohmann::json& extra, std::string* error = nullptr);
+
+    uint64_t rows() const { return rows_; }
+    uint64_t weight_rows() const { return weight_rows_; }
+
+private:
+    struct Spool {
+        std::string name;
+        ArchiveColumnType type;
+        uint8_t width;
+        uint8_t table;
+        std::FILE* file = nullptr;
+        uint64_t count = 0;
+    };
+
+    Spool& add_spool(std::string name, ArchiveColumnType type, uint8_t width, uint8_t table);
+    void write(Spool& spool, const void* value);
+    uint16_t intern(std::vector<std::string>& dictionary, std::map<std::string, uint16_t>& index,
+                    const std::string& value);
+    void close_step();
+    void cleanup();
+
+    std::string path_;
+    std::string spool_dir_;
+    std::size_t channels_;
+    std::vector<std::unique_ptr<Spool>> spools_;
+    std::size_t weight_first_ = 0;          // spools_ 中称重表的第一列
+    bool failed_ = false;
+
+    uint64_t rows_ = 0;
+    uint64_t weight_rows_ = 0;
+    int64_t first_us_ = 0;
+    int64_t last_us_ = 0;
+    int64_t weight_first_us_ = 0;
+    int64_t weight_last_us_ = 0;
+    std::vector<ArchiveIndexEntry> index_;
+
+    std::vector<std::string> phases_{""};
+    std::map<std::string, uint16_t> phase_index_{{"", 0}};
+    std::vector<std::string> gas_modes_{""};
+    std::map<std::string, uint16_t> gas_mode_index_{{"", 0}};
+    std::vector<std::string> run_tags_{""};
+    std::map<std::string, uint16_t> run_tag_index_{{"", 0}};
+
+    // 阶段边界 (读数中 phase 连续相同的区间)
+    nlohmann::json steps_ = nlohmann::json::array();
+    bool step_open_ = false;
+    std::string step_phase_;
+    int64_t step_start_us_ = 0;
+    int64_t step_end_us_ = 0;
+    uint64_t step_first_row_ = 0;
+};
+
+} // namespace db
@@ -0,0 +1,234 @@
+#include "run_archiver.hpp"
+#include "connection_pool.hpp"
+#include <spdlog/spdlog.h>
+#include <filesystem>
+
+namespace db {
+
+RunArchiver::RunArchiver(std::shared_ptr<const RunExportSource> source, std::shared_ptr<TestRunRepository> runs,
+                         Options options)
+    : source_(std::move(source))
+    , runs_(std::move(runs))
+    , options_(std::move(options)) {}
+
+RunArchiver::~RunArchiver() {
+    stop();
+}
+
+void RunArchiver::start() {
+    std::error_code ec;
+    std::filesystem::create_directories(options_.directory, ec);
+    if (ec) {
+        spdlog::warn("RunArchiver: Cannot create {}: {}", options_.directory, ec.message());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    stopping_ = false;
+    thread_ = std::thread(&RunArchiver::archive_loop, this);
+}
+
+void RunArchiver::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+std::string RunArchiver::path_for(int run_id) const {
+    return options_.directory + "/run-" + std::to_string(run_id) + ".enra";
+}
+
+void RunArchiver::request(int run_id) {
+    if (run_id <= 0) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queued_.insert(run_id).second) return;
+        queue_.emplace_back(std::chrono::steady_clock::now() + options_.settle_delay, run_id);
+    }
+    cv_.notify_all();
+}
+
+std::shared_ptr<const RunArchive> RunArchiver::open(int run_id) {
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+            if (it->first == run_id) {
+                cache_.splice(cache_.begin(), cache_, it);
+                return cache_.front().second;
+            }
+        }
+    }
+
+    const auto path = path_for(run_id);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return nullptr;
+    std::string error;
+    auto archive = RunArchive::open(path, &error);
+    if (!archive) {
+        spdlog::warn("RunArchiver: {}", error);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.emplace_front(run_id, archive);
+    while (cache_.size() > options_.max_open) {
+        cache_.pop_back();
+    }
+    return archive;
+}
+
+void RunArchiver::evict(int run_id) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    cache_.remove_if([run_id](const auto& entry) { return entry.first == run_id; });
+}
+
+RunArchiver::Stats RunArchiver::stats() const {
+    Stats s;
+    s.built = built_;
+    s.failures = failures_;
+    s.bytes = bytes_;
+    s.last_build_ms = last_build_ms_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.pending = queue_.size();
+    }
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    s.open_archives = cache_.size();
+    return s;
+}
+
+void RunArchiver::archive_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (!ConnectionPool::instance().is_healthy()) {
+            cv_.wait_for(lock, options_.retry_interval, [this] { return stopping_; });
+            continue;
+        }
+        if (!backfilled_) {
+            lock.unlock();
+            backfill();
+            lock.lock();
+            backfilled_ = true;
+            continue;
+        }
+        if (queue_.empty()) {
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            continue;
+        }
+        const auto [ready_at, run_id] = queue_.front();
+        if (std::chrono::steady_clock::now() < ready_at) {
+            cv_.wait_until(lock, ready_at, [this] { return stopping_; });
+            continue;
+        }
+        queue_.pop_front();
+        queued_.erase(run_id);
+
+        lock.unlock();
+        const bool done = build(run_id);
+        lock.lock();
+        if (!done && queued_.insert(run_id).second) {
+            // 数据库在生成过程中断开、记录日志尚未补传等: 稍后重试
+            queue_.emplace_back(std::chrono::steady_clock::now() + options_.retry_interval, run_id);
+        }
+    }
+}
+
+void RunArchiver::backfill() {
+    if (options_.backfill_runs <= 0 || !runs_) return;
+    // 最近 backfill_runs 个运行里可续跑的必在最新的 backfill_runs 个可续跑记录中
+    std::set<int> resumable;
+    for (const auto& run : runs_->list_resumable(std::nullopt, options_.backfill_runs)) {
+        resumable.insert(run.id);
+    }
+    int queued = 0;
+    for (const auto& run : runs_->list_runs(options_.backfill_runs)) {
+        if (run.state == "running" || resumable.count(run.id)) continue;
+        std::error_code ec;
+        if (std::filesystem::exists(path_for(run.id), ec)) continue;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queued_.insert(run.id).second) continue;
+        queue_.emplace_back(std::chrono::steady_clock::now(), run.id);
+        ++queued;
+    }
+    if (queued > 0) {
+        spdlog::info("RunArchiver: Backfilling {} run archive(s)", queued);
+    }
+}
+
+bool RunArchiver::build(int run_id) {
+    const auto path = path_for(run_id);
+    std::error_code ec;
+
+    const auto run = runs_ ? runs_->get_run(run_id) : std::nullopt;
+    if (!run) {
+        if (!ConnectionPool::instance().is_healthy()) return false;
+        spdlog::warn("RunArchiver: Run {} not found, skipping", run_id);
+        return true;
+    }
+    if (run->state == "running") {
+        return true;    // 结束时会再次 request
+    }
+    // 数据库短暂不可达期间的读数先进了记录日志, 补传前从数据库读出的运行不完整
+    if (source_->has_origin(RunExportSource::Origin::JOURNAL) &&
+        source_->resolve(run_id, RunExportSource::Origin::JOURNAL)) {
+        spdlog::info("RunArchiver: Run {} still has journal data pending upload, deferring", run_id);
+        return false;
+    }
+    const auto scope = source_->resolve(run_id, RunExportSource::Origin::DATABASE);
+    if (!scope) return false;
+
+    const auto started = std::chrono::steady_clock::now();
+    RunArchiveWriter writer(path, source_->channels());
+    std::string error;
+    bool ok = writer.open(&error);
+    if (ok) {
+        // 游标读取失败时返回 false 且不再有数据, 由 error() 区分读完与出错
+        auto readings = source_->sensor_readings(*scope, RunExportSource::Origin::DATABASE, options_.page_rows);
+        std::vector<SensorReadingRecord> reading_page;
+        while (readings->next(reading_page)) {
+            for (const auto& row : reading_page) writer.append(row);
+        }
+        auto weights = readings->error().empty()
+            ? source_->weight_samples(*scope, RunExportSource::Origin::DATABASE, options_.page_rows) : nullptr;
+        std::vector<WeightSampleRecord> weight_page;
+        while (weights && weights->next(weight_page)) {
+            for (const auto& row : weight_page) writer.append(row);
+        }
+        if (!readings->error().empty()) {
+            error = "reading sensor_readings: " + readings->error();
+            ok = false;
+        } else if (!weights->error().empty()) {
+            error = "reading weight_samples: " + weights->error();
+            ok = false;
+        } else if (!ConnectionPool::instance().is_healthy()) {
+            error = "database became unavailable";
+            ok = false;
+        }
+    }
+    ok = ok && writer.finish(*run, {{"origin", "database"}}, &error);
+
+    if (!ok) {
+        ++failures_;
+        // 列暂存目录由 writer 析构时删除; finish 失败时已删除 .tmp, 这里兜底 (如进程曾在写出中途退出)
+        std::filesystem::remove(path + ".tmp", ec);
+        spdlog::warn("RunArchiver: Failed to archive run {}: {}", run_id, error);
+        return false;
+    }
+    // 重新生成时已打开的旧映射仍指向被替换的文件, 之后的 open() 映射新文件
+    evict(run_id);
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    const auto bytes = std::filesystem::file_size(path, ec);
+    ++built_;
+    bytes_ += ec ? 0 : bytes;
+    last_build_ms_ = ms;
+    spdlog::info("RunArchiver: Archived run {} ({} readings, {} weight samples, {} bytes) in {:.0f} ms",
+                 run_id, writer.rows(), writer.weight_rows(), ec ? 0 : bytes, ms);
+    return true;
+}
+
+} // namespace db
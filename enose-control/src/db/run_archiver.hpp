@@ -0,0 +1,100 @@
+#pragma once
+
+#include "run_archive.hpp"
+#include "run_export.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace db {
+
+/**
+ * @brief 为已结束的运行生成 RunArchive, 供离线分析直接读取而不再查询数据库
+ *
+ * 运行结束 (TestRunRepository::on_run_completed) 时 request() 入队, 后台线程等待
+ * settle_delay (异步写入的读数 / 称重样本落库) 后经 RunExportSource 的数据库游标逐页读取,
+ * 写成 <directory>/run-<id>.enra; 已有归档 (续跑前中断时生成的) 会被原子替换.
+ * 启动时补做最近 backfill_runs 个已结束但没有归档的运行, 有检查点的 interrupted 运行
+ * 还可能续跑, 不补做. 连接池 unhealthy、游标读取出错或记录日志中还有该运行未补传的数据时
+ * 不生成 (归档会不完整), 每 retry_interval 重试.
+ *
+ * open() 返回共享的只读映射, 最多缓存 max_open 个, 之后按最近使用淘汰.
+ */
+class RunArchiver {
+public:
+    struct Options {
+        std::string directory = "/var/lib/enose-control/archives";
+        std::chrono::seconds settle_delay{5};
+        std::chrono::seconds retry_interval{60};
+        int backfill_runs = 20;
+        std::size_t page_rows = 4096;
+        std::size_t max_open = 8;
+    };
+
+    struct Stats {
+        uint64_t built = 0;
+        uint64_t failures = 0;
+        uint64_t bytes = 0;             // 累计生成的归档字节数
+        double last_build_ms = 0;
+        std::size_t pending = 0;
+        std::size_t open_archives = 0;
+    };
+
+    RunArchiver(std::shared_ptr<const RunExportSource> source, std::shared_ptr<TestRunRepository> runs,
+                Options options);
+    ~RunArchiver();
+
+    RunArchiver(const RunArchiver&) = delete;
+    RunArchiver& operator=(const RunArchiver&) = delete;
+
+    void start();
+    void stop();
+
+    /** @brief 排队 (重新) 生成归档, 已在队列中时忽略; 线程安全, 不阻塞 */
+    void request(int run_id);
+
+    /** @brief 打开已生成的归档; 不存在时返回空 */
+    std::shared_ptr<const RunArchive> open(int run_id);
+
+    std::string path_for(int run_id) const;
+
+    Stats stats() const;
+
+private:
+    void archive_loop();
+    void backfill();
+    bool build(int run_id);
+    void evict(int run_id);
+
+    std::shared_ptr<const RunExportSource> source_;
+    std::shared_ptr<TestRunRepository> runs_;
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_{false};
+    bool backfilled_{false};
+    std::thread thread_;
+    // (可以开始生成的时间, run_id)
+    std::deque<std::pair<std::chrono::steady_clock::time_point, int>> queue_;
+    std::set<int> queued_;                  // 在 queue_ 中 (生成中的不算, 期间的 request 会再排一次)
+
+    mutable std::mutex cache_mutex_;
+    std::list<std::pair<int, std::shared_ptr<const RunArchive>>> cache_;  // 最近使用的在前
+
+    std::atomic<uint64_t> built_{0};
+    std::atomic<uint64_t> failures_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<double> last_build_ms_{0};
+};
+
+} // namespace db
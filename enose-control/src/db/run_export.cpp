@@ -0,0 +1,261 @@
+#include "run_export.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <functional>
+
+namespace db {
+
+namespace {
+
+int64_t to_unix_us(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+bool in_scope(const RunExportScope& scope, const std::chrono::system_clock::time_point& time) {
+    return (!scope.start_time || time >= *scope.start_time) && (!scope.end_time || time <= *scope.end_time);
+}
+
+class DbReadingCursor final : public ExportCursor<SensorReadingRecord> {
+public:
+    DbReadingCursor(std::shared_ptr<SensorReadingRepository> repo, const RunExportScope& scope, std::size_t page_rows)
+        : repo_(std::move(repo)) {
+        query_.run_id = scope.run_id;
+        query_.limit = static_cast<int>(page_rows);
+    }
+
+    bool next(std::vector<SensorReadingRecord>& out) override {
+        out.clear();
+        if (done_) return false;
+        out = repo_->read_page(query_, &error_);
+        if (!error_.empty() || out.size() < static_cast<std::size_t>(query_.limit)) done_ = true;
+        if (!out.empty()) {
+            query_.after = SensorReadingCursor{to_unix_us(out.back().time), out.back().frame_seq};
+        }
+        return !out.empty();
+    }
+
+private:
+    std::shared_ptr<SensorReadingRepository> repo_;
+    SensorReadingQuery query_;
+    bool done_ = false;
+};
+
+class DbWeightCursor final : public ExportCursor<WeightSampleRecord> {
+public:
+    DbWeightCursor(std::shared_ptr<TestRunRepository> repo, const RunExportScope& scope, std::size_t page_rows)
+        : repo_(std::move(repo)) {
+        query_.run_id = scope.run_id;
+        query_.limit = static_cast<int>(page_rows);
+    }
+
+    bool next(std::vector<WeightSampleRecord>& out) override {
+        out.clear();
+        if (done_) return false;
+        out = repo_->get_weight_samples_page(query_, &error_);
+        if (!error_.empty() || out.size() < static_cast<std::size_t>(query_.limit)) done_ = true;
+        if (!out.empty()) {
+            query_.after = WeightSampleCursor{to_unix_us(out.back().time), out.back().seq};
+        }
+        return !out.empty();
+    }
+
+private:
+    std::shared_ptr<TestRunRepository> repo_;
+    WeightSampleQuery query_;
+    bool done_ = false;
+};
+
+class DbEventCursor final : public ExportCursor<SystemLogRecord> {
+public:
+    DbEventCursor(std::shared_ptr<TestRunRepository> repo, const RunExportScope& scope, std::size_t page_rows)
+        : repo_(std::move(repo)) {
+        query_.start_time = scope.start_time;
+        query_.end_time = scope.end_time;
+        query_.limit = static_cast<int>(page_rows);
+    }
+
+    bool next(std::vector<SystemLogRecord>& out) override {
+        out.clear();
+        if (done_) return false;
+        out = repo_->get_system_logs_page(query_);
+        if (out.size() < static_cast<std::size_t>(query_.limit)) done_ = true;
+        if (!out.empty()) {
+            // 游标时刻不变时累加跳过的行数, 否则只跳过本页末尾同一时刻的行
+            const int64_t last_us = to_unix_us(out.back().time);
+            int64_t same = 0;
+            for (auto it = out.rbegin(); it != out.rend() && to_unix_us(it->time) == last_us; ++it) {
+                ++same;
+            }
+            if (query_.after && query_.after->time_us == last_us) {
+                query_.after->skip += same;
+            } else {
+                query_.after = SystemLogCursor{last_us, same};
+            }
+        }
+        return !out.empty();
+    }
+
+private:
+    std::shared_ptr<TestRunRepository> repo_;
+    SystemLogQuery query_;
+    bool done_ = false;
+};
+
+/**
+ * 逐段解码记录日志, 每次只持有一个段中属于该运行的行.
+ * 导出期间被补传线程删除的段读取失败时跳过 (其内容此时已在数据库中).
+ */
+template <typename Row>
+class JournalCursor final : public ExportCursor<Row> {
+public:
+    using Extract = std::function<void(RecordingJournal::SegmentContents&, std::vector<Row>&)>;
+
+    JournalCursor(std::vector<std::string> segments, std::size_t page_rows, Extract extract)
+        : segments_(std::move(segments)), page_rows_(page_rows), extract_(std::move(extract)) {}
+
+    bool next(std::vector<Row>& out) override {
+        out.clear();
+        while (out.size() < page_rows_) {
+            if (pos_ == rows_.size()) {
+                if (segment_ == segments_.size()) break;
+                rows_.clear();
+                pos_ = 0;
+                RecordingJournal::SegmentContents contents;
+                const auto& path = segments_[segment_++];
+                if (RecordingJournal::read_segment(path, contents)) {
+                    extract_(contents, rows_);
+                } else {
+                    spdlog::warn("RunExportSource: Skipping unreadable journal segment {}", path);
+                }
+                continue;
+            }
+            out.push_back(std::move(rows_[pos_++]));
+        }
+        return !out.empty();
+    }
+
+private:
+    std::vector<std::string> segments_;
+    std::size_t segment_ = 0;
+    std::size_t page_rows_;
+    Extract extract_;
+    std::vector<Row> rows_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace
+
+RunExportSource::RunExportSource(std::shared_ptr<SensorReadingRepository> readings,
+                                 std::shared_ptr<TestRunRepository> runs,
+                                 std::shared_ptr<RecordingJournal> journal)
+    : readings_(std::move(readings)), runs_(std::move(runs)), journal_(std::move(journal)) {}
+
+RunExportSource::Origin RunExportSource::preferred_origin() const {
+    if (journal_ && !ConnectionPool::instance().is_healthy()) {
+        return Origin::JOURNAL;
+    }
+    return Origin::DATABASE;
+}
+
+bool RunExportSource::has_origin(Origin origin) const {
+    if (origin == Origin::JOURNAL) return journal_ != nullptr;
+    return runs_ && ConnectionPool::instance().is_initialized();
+}
+
+std::size_t RunExportSource::channels() const {
+    if (readings_) return readings_->options().channels;
+    if (journal_) return journal_->options().channels;
+    return 16;
+}
+
+std::optional<RunExportScope> RunExportSource::resolve(int run_id, Origin origin) const {
+    RunExportScope scope;
+    scope.run_id = run_id;
+
+    if (origin == Origin::DATABASE) {
+        if (!runs_) return std::nullopt;
+        auto run = runs_->get_run(run_id);
+        if (!run) return std::nullopt;
+        scope.start_time = run->created_at;
+        scope.end_time = run->completed_at.value_or(std::chrono::system_clock::now());
+        return scope;
+    }
+
+    if (!journal_) return std::nullopt;
+    // 让当前段中的最新数据也可读
+    journal_->rotate();
+    bool found = false;
+    auto widen = [&](const std::chrono::system_clock::time_point& time) {
+        if (!found || time < *scope.start_time) scope.start_time = time;
+        if (!found || time > *scope.end_time) scope.end_time = time;
+        found = true;
+    };
+    for (const auto& path : journal_->sealed_segments()) {
+        RecordingJournal::SegmentContents contents;
+        if (!RecordingJournal::read_segment(path, contents)) continue;
+        for (const auto& row : contents.sensor_readings) {
+            if (row.run_id == run_id) widen(row.time);
+        }
+        for (const auto& row : contents.weight_samples) {
+            if (row.run_id == run_id) widen(row.time);
+        }
+    }
+    if (!found) return std::nullopt;
+    return scope;
+}
+
+std::unique_ptr<ExportCursor<SensorReadingRecord>> RunExportSource::sensor_readings(
+    const RunExportScope& scope, Origin origin, std::size_t page_rows) const {
+    page_rows = std::max<std::size_t>(page_rows, 1);
+    if (origin == Origin::DATABASE) {
+        if (!readings_) return nullptr;
+        return std::make_unique<DbReadingCursor>(readings_, scope, page_rows);
+    }
+    if (!journal_) return nullptr;
+    return std::make_unique<JournalCursor<SensorReadingRecord>>(journal_->sealed_segments(), page_rows,
+        [run_id = scope.run_id](RecordingJournal::SegmentContents& contents, std::vector<SensorReadingRecord>& rows) {
+            for (auto& row : contents.sensor_readings) {
+                if (row.run_id == run_id) rows.push_back(std::move(row));
+            }
+        });
+}
+
+std::unique_ptr<ExportCursor<WeightSampleRecord>> RunExportSource::weight_samples(
+    const RunExportScope& scope, Origin origin, std::size_t page_rows) const {
+    page_rows = std::max<std::size_t>(page_rows, 1);
+    if (origin == Origin::DATABASE) {
+        if (!runs_) return nullptr;
+        return std::make_unique<DbWeightCursor>(runs_, scope, page_rows);
+    }
+    if (!journal_) return nullptr;
+    return std::make_unique<JournalCursor<WeightSampleRecord>>(journal_->sealed_segments(), page_rows,
+        [run_id = scope.run_id](RecordingJournal::SegmentContents& contents, std::vector<WeightSampleRecord>& rows) {
+            for (auto& row : contents.weight_samples) {
+                if (row.run_id == run_id) rows.push_back(std::move(row));
+            }
+        });
+}
+
+std::unique_ptr<ExportCursor<SystemLogRecord>> RunExportSource::events(
+    const RunExportScope& scope, Origin origin, std::size_t page_rows) const {
+    page_rows = std::max<std::size_t>(page_rows, 1);
+    if (origin == Origin::DATABASE) {
+        if (!runs_) return nullptr;
+        return std::make_unique<DbEventCursor>(runs_, scope, page_rows);
+    }
+    if (!journal_) return nullptr;
+    return std::make_unique<JournalCursor<SystemLogRecord>>(journal_->sealed_segments(), page_rows,
+        [scope](RecordingJournal::SegmentContents& contents, std::vector<SystemLogRecord>& rows) {
+            for (auto& event : contents.events) {
+                if (!in_scope(scope, event.time)) continue;
+                SystemLogRecord record;
+                record.time = event.time;
+                record.level = std::move(event.level);
+                record.source = std::move(event.source);
+                record.message = std::move(event.message);
+                rows.push_back(std::move(record));
+            }
+        });
+}
+
+} // namespace db
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "recording_journal.hpp"
+#include "sensor_reading_repository.hpp"
+#include "test_run_repository.hpp"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace db {
+
+// 一次导出覆盖的运行: run_id 加时间范围 (系统日志没有 run_id, 只能按时间筛选)
+struct RunExportScope {
+    int run_id{0};
+    std::optional<std::chrono::system_clock::time_point> start_time;
+    std::optional<std::chrono::system_clock::time_point> end_time;
+};
+
+/**
+ * @brief 逐页读取导出数据的游标; next() 读完或出错时返回 false 且 out 为空
+ *
+ * 出错 (数据库游标查询失败) 后 error() 非空, 已读出的数据不完整.
+ */
+template <typename Row>
+class ExportCursor {
+public:
+    virtual ~ExportCursor() = default;
+    virtual bool next(std::vector<Row>& out) = 0;
+
+    const std::string& error() const { return error_; }
+
+protected:
+    std::string error_;
+};
+
+/**
+ * @brief 按运行读取 sensor_readings / weight_samples / system_logs 的数据源
+ *
+ * 数据来自数据库或本地记录日志 (数据库不可达期间尚未补传的数据只在记录日志中).
+ * 游标每页至多 page_rows 行, 导出占用的内存只与页大小有关, 与运行长度无关:
+ * 数据库游标按 keyset 分页 (与 read_page / get_weight_samples_page 相同),
+ * 记录日志游标一次只解码一个已封存的段 (至多 segment_bytes / 256 条记录).
+ */
+class RunExportSource {
+public:
+    enum class Origin { DATABASE, JOURNAL };
+
+    RunExportSource(std::shared_ptr<SensorReadingRepository> readings,
+                    std::shared_ptr<TestRunRepository> runs,
+                    std::shared_ptr<RecordingJournal> journal);
+
+    /** @brief 连接池健康时用数据库, 否则用记录日志 (未启用记录日志时仍为数据库) */
+    Origin preferred_origin() const;
+
+    bool has_origin(Origin origin) const;
+
+    /**
+     * @brief 确定运行的时间范围
+     *
+     * 数据库: runs.created_at ~ completed_at (未完成时到当前时间); 运行不存在时返回空.
+     * 记录日志: 先封存当前段, 再扫描各段中属于该运行的读数和称重样本的最早 / 最晚时间;
+     * 记录日志中没有该运行的数据时返回空.
+     */
+    std::optional<RunExportScope> resolve(int run_id, Origin origin) const;
+
+    std::unique_ptr<ExportCursor<SensorReadingRecord>> sensor_readings(
+        const RunExportScope& scope, Origin origin, std::size_t page_rows) const;
+    std::unique_ptr<ExportCursor<WeightSampleRecord>> weight_samples(
+        const RunExportScope& scope, Origin origin, std::size_t page_rows) const;
+    std::unique_ptr<ExportCursor<SystemLogRecord>> events(
+        const RunExportScope& scope, Origin origin, std::size_t page_rows) const;
+
+    /** @brief 读数的通道数 (记录日志取自段头, 数据库取自 SensorReadingRepository 的配置) */
+    std::size_t channels() const;
+
+private:
+    std::shared_ptr<SensorReadingRepository> readings_;
+    std::shared_ptr<TestRunRepository> runs_;
+    std::shared_ptr<RecordingJournal> journal_;
+};
+
+} // namespace db
@@ -0,0 +1,142 @@
+#include "sensor_baseline_repository.hpp"
+#include "prepared_statements.hpp"
+#include <spdlog/spdlog.h>
+
+namespace db {
+
+namespace {
+
+constexpr const char* LOAD_BASELINES = "sensor_baseline_load";
+constexpr const char* UPSERT_BASELINE = "sensor_baseline_upsert";
+
+const PreparedStatement SENSOR_BASELINE_STATEMENTS[] = {
+    {LOAD_BASELINES,
+        "SELECT sensor_type, sensor_idx, heater_step, baseline, reference, samples "
+        "FROM sensor_baselines WHERE device_id = $1"},
+    {UPSERT_BASELINE,
+        "INSERT INTO sensor_baselines (device_id, sensor_type, sensor_idx, heater_step, baseline, reference, samples) "
+        "VALUES ($1, $2, $3, $4, $5, $6, $7) "
+        "ON CONFLICT (device_id, sensor_type, sensor_idx, heater_step) DO UPDATE SET "
+        "baseline = EXCLUDED.baseline, reference = EXCLUDED.reference, "
+        "samples = EXCLUDED.samples, updated_at = NOW()"},
+};
+
+} // namespace
+
+std::span<const PreparedStatement> sensor_baseline_statements() {
+    return SENSOR_BASELINE_STATEMENTS;
+}
+
+SensorBaselineRepository::SensorBaselineRepository(std::string device_id)
+    : device_id_(std::move(device_id)) {}
+
+SensorBaselineRepository::~SensorBaselineRepository() {
+    stop();
+}
+
+std::vector<SensorBaselineRecord> SensorBaselineRepository::load() {
+    std::vector<SensorBaselineRecord> records;
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return records;
+
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(LOAD_BASELINES, device_id_);
+        txn.commit();
+
+        records.reserve(result.size());
+        for (const auto& row : result) {
+            SensorBaselineRecord r;
+            r.sensor_type = row[0].as<std::string>();
+            r.sensor_idx = row[1].as<int>();
+            r.heater_step = row[2].as<int>();
+            r.baseline = row[3].as<double>();
+            r.reference = row[4].as<double>();
+            r.samples = row[5].as<int64_t>();
+            records.push_back(std::move(r));
+        }
+        spdlog::info("SensorBaselineRepository: Loaded {} baselines for {}", records.size(), device_id_);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to load sensor baselines: {}", e.what());
+    }
+    return records;
+}
+
+void SensorBaselineRepository::enqueue(std::vector<SensorBaselineRecord> records) {
+    if (records.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& r : records) {
+            Key key{r.sensor_type, r.sensor_idx, r.heater_step};
+            pending_.insert_or_assign(std::move(key), std::move(r));
+        }
+    }
+    cv_.notify_one();
+}
+
+void SensorBaselineRepository::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_.joinable()) return;
+    stopping_ = false;
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+void SensorBaselineRepository::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    writer_.join();
+}
+
+void SensorBaselineRepository::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) return;
+
+        std::vector<SensorBaselineRecord> batch;
+        batch.reserve(pending_.size());
+        for (auto& [key, record] : pending_) batch.push_back(std::move(record));
+        pending_.clear();
+        const bool stopping = stopping_;
+
+        lock.unlock();
+        const bool ok = write(batch);
+        lock.lock();
+
+        if (!ok) {
+            // 期间到达的新值更新, 保留新值
+            for (auto& r : batch) {
+                Key key{r.sensor_type, r.sensor_idx, r.heater_step};
+                pending_.try_emplace(std::move(key), std::move(r));
+            }
+            if (stopping) return;
+            cv_.wait_for(lock, RETRY_DELAY, [this] { return stopping_; });
+        } else if (stopping) {
+            return;
+        }
+    }
+}
+
+bool SensorBaselineRepository::write(const std::vector<SensorBaselineRecord>& records) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+
+        pqxx::work txn(conn.get());
+        for (const auto& r : records) {
+            txn.exec_prepared(UPSERT_BASELINE, device_id_, r.sensor_type, r.sensor_idx, r.heater_step,
+                              r.baseline, r.reference, r.samples);
+        }
+        txn.commit();
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to save sensor baselines: {}", e.what());
+        return false;
+    }
+}
+
+} // namespace db
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace db {
+
+// 传感器通道基线 (对应 sensor_baselines 表的一行)
+struct SensorBaselineRecord {
+    std::string sensor_type;        // mox_d / mox_a / pid (SensorSample::type_name)
+    int sensor_idx{0};
+    int heater_step{0};
+    double baseline{0};             // 当前基线
+    double reference{0};            // 参考基线 (漂移校正的目标), 0 = 尚未预热完成
+    int64_t samples{0};
+};
+
+/**
+ * @brief 每个设备各通道基线的持久化
+ *
+ * load() 在启动时同步读取; enqueue() 只把最新值放进内存 (同一通道覆盖旧值),
+ * 由独立写线程合并后在一个事务里 upsert, 采集线程不等待数据库.
+ * 数据库故障时保留待写内容, 下次写入时重试.
+ */
+class SensorBaselineRepository {
+public:
+    explicit SensorBaselineRepository(std::string device_id);
+    ~SensorBaselineRepository();
+
+    std::vector<SensorBaselineRecord> load();
+
+    void enqueue(std::vector<SensorBaselineRecord> records);
+
+    void start();
+
+    /**
+     * @brief 写出剩余内容后停止写线程 (须在 ConnectionPool::shutdown 之前调用)
+     */
+    void stop();
+
+    static constexpr auto RETRY_DELAY = std::chrono::seconds(5);
+
+private:
+    using Key = std::tuple<std::string, int, int>;
+
+    void writer_loop();
+    bool write(const std::vector<SensorBaselineRecord>& records);
+
+    std::string device_id_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<Key, SensorBaselineRecord> pending_;
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+} // namespace db
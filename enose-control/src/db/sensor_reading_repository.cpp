@@ -0,0 +1,322 @@
+#include "sensor_reading_repository.hpp"
+#include "recording_journal.hpp"
+#include "prepared_statements.hpp"
+#include "core/latency_tracer.hpp"
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace db {
+
+namespace {
+constexpr auto RETRY_DELAY = std::chrono::seconds(1);
+constexpr int ACQUIRE_TIMEOUT_MS = 1000;
+
+constexpr const char* READINGS_PAGE = "sensor_reading_page";
+
+// $1 device_id, $2 run_id, $3 run_tag, $4 start_us, $5 end_us, $6/$7 游标 (time_us, seq), $8 limit
+// (time, seq) > after: 先用 time >= 缩小范围, 同一时刻再按帧序号排除
+const PreparedStatement SENSOR_READING_STATEMENTS[] = {
+    {READINGS_PAGE,
+        "SELECT (EXTRACT(EPOCH FROM time) * 1000000)::BIGINT AS time_us, run_id, "
+        "channels, channels_corrected, metadata::TEXT AS metadata "
+        "FROM sensor_readings "
+        "WHERE device_id = $1 "
+        "AND ($2::INT IS NULL OR run_id = $2) "
+        "AND ($3::TEXT IS NULL OR metadata->>'run' = $3) "
+        "AND ($4::BIGINT IS NULL OR time >= TIMESTAMPTZ 'epoch' + $4 * INTERVAL '1 microsecond') "
+        "AND ($5::BIGINT IS NULL OR time < TIMESTAMPTZ 'epoch' + $5 * INTERVAL '1 microsecond') "
+        "AND ($6::BIGINT IS NULL OR ("
+        "  time >= TIMESTAMPTZ 'epoch' + $6 * INTERVAL '1 microsecond' AND "
+        "  (time > TIMESTAMPTZ 'epoch' + $6 * INTERVAL '1 microsecond' "
+        "   OR COALESCE((metadata->>'seq')::BIGINT, 0) > $7))) "
+        "ORDER BY time, COALESCE((metadata->>'seq')::BIGINT, 0) LIMIT $8"},
+};
+
+std::optional<int64_t> to_unix_us(const std::optional<std::chrono::system_clock::time_point>& tp) {
+    if (!tp) return std::nullopt;
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp->time_since_epoch()).count();
+}
+
+// BYTEA 中的 float32 (小端) 解码到 out 的前 channels 个通道
+void decode_channels(const pqxx::field& field, std::size_t channels,
+                     std::array<float, SensorReadingRecord::MAX_CHANNELS>& out) {
+    out.fill(std::numeric_limits<float>::quiet_NaN());
+    const auto bytes = field.as<std::basic_string<std::byte>>();
+    const std::size_t n = std::min(channels, bytes.size() / sizeof(float));
+    std::memcpy(out.data(), bytes.data(), n * sizeof(float));
+}
+
+} // namespace
+
+std::span<const PreparedStatement> sensor_reading_statements() {
+    return SENSOR_READING_STATEMENTS;
+}
+
+SensorReadingRepository::SensorReadingRepository(Options options)
+    : options_(std::move(options)) {
+    if (options_.channels > SensorReadingRecord::MAX_CHANNELS) {
+        options_.channels = SensorReadingRecord::MAX_CHANNELS;
+    }
+}
+
+SensorReadingRepository::~SensorReadingRepository() {
+    stop();
+}
+
+void SensorReadingRepository::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_.joinable()) return;
+    stopping_ = false;
+    writer_ = std::thread(&SensorReadingRepository::writer_loop, this);
+    spdlog::info("SensorReadingRepository: Writer started (device={}, channels={})",
+                 options_.device_id, options_.channels);
+}
+
+void SensorReadingRepository::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    spdlog::info("SensorReadingRepository: Writer stopped (written={}, journaled={}, dropped={})",
+                 rows_written_.load(), rows_journaled_.load(), rows_dropped_.load());
+}
+
+void SensorReadingRepository::enqueue(SensorReadingRecord record) {
+    // 数据库不可达时直接落盘, 不在内存里积压
+    if (journal_ && !ConnectionPool::instance().is_healthy()) {
+        journal_->append(record);
+        ++rows_journaled_;
+        return;
+    }
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= options_.queue_capacity) {
+            spill(queue_.front());
+            queue_.pop_front();
+        }
+        queue_.push_back(std::move(record));
+        notify = queue_.size() >= options_.batch_rows;
+    }
+    if (notify) {
+        cv_.notify_one();
+    }
+}
+
+SensorReadingRepository::Stats SensorReadingRepository::stats() const {
+    Stats s;
+    s.rows_written = rows_written_;
+    s.rows_dropped = rows_dropped_;
+    s.flushes = flushes_;
+    s.write_errors = write_errors_;
+    s.rows_journaled = rows_journaled_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.queued = queue_.size();
+    return s;
+}
+
+void SensorReadingRepository::writer_loop() {
+    // 专用连接: 写线程存续期间一直占用, 故障时归还并重新获取
+    std::optional<ConnectionPool::ConnectionGuard> conn;
+    std::vector<SensorReadingRecord> batch;
+    bool stopping = false;
+
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, options_.flush_interval, [this] {
+                return stopping_ || queue_.size() >= options_.batch_rows;
+            });
+            stopping = stopping_;
+            if (queue_.empty()) continue;
+
+            batch.assign(std::make_move_iterator(queue_.begin()),
+                         std::make_move_iterator(queue_.end()));
+            queue_.clear();
+        }
+
+        bool ok = false;
+        try {
+            if (!conn || !conn->valid()) {
+                conn.emplace(ConnectionPool::instance().acquire(ACQUIRE_TIMEOUT_MS));
+            }
+            ok = conn->valid() && write_batch_on(conn->get(), batch);
+        } catch (const std::exception& e) {
+            spdlog::error("SensorReadingRepository: COPY failed: {}", e.what());
+            conn.reset();
+        }
+
+        if (ok) {
+            rows_written_ += batch.size();
+            ++flushes_;
+            batch.clear();
+            continue;
+        }
+
+        ++write_errors_;
+        if (stopping) {
+            spdlog::warn("SensorReadingRepository: {} {} rows on shutdown",
+                         journal_ ? "Journaling" : "Dropping", batch.size());
+            for (const auto& record : batch) {
+                spill(record);
+            }
+            break;
+        }
+
+        // 放回队首, 保留时间顺序; 超出容量的最旧行丢弃
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            if (queue_.size() >= options_.queue_capacity) {
+                for (; it != batch.rend(); ++it) {
+                    spill(*it);
+                }
+                break;
+            }
+            queue_.push_front(std::move(*it));
+        }
+        batch.clear();
+        cv_.wait_for(lock, RETRY_DELAY, [this] { return stopping_; });
+    }
+}
+
+bool SensorReadingRepository::write_batch_on(pqxx::connection& conn,
+                                             const std::vector<SensorReadingRecord>& batch) {
+    pqxx::work txn(conn);
+    copy_readings(txn, options_.device_id, options_.channels, batch);
+    txn.commit();
+    auto& tracer = core::LatencyTracer::instance();
+    for (const auto& record : batch) {
+        tracer.record_since(core::LatencyStage::DB_COMMIT, record.rx_ns);
+    }
+    return true;
+}
+
+void SensorReadingRepository::copy_readings(pqxx::work& txn, const std::string& device_id,
+                                            std::size_t channel_count,
+                                            const std::vector<SensorReadingRecord>& batch) {
+    auto stream = pqxx::stream_to::table(txn, {"sensor_readings"},
+                                         {"time", "run_id", "device_id", "channels", "channels_corrected",
+                                          "metadata"});
+
+    // channels: float32 小端 (树莓派原生字节序)
+    channel_count = std::min(channel_count, SensorReadingRecord::MAX_CHANNELS);
+    std::basic_string<std::byte> channels(channel_count * sizeof(float), std::byte{0});
+    std::optional<std::basic_string<std::byte>> corrected;
+    for (const auto& record : batch) {
+        std::memcpy(channels.data(), record.channels.data(), channels.size());
+        corrected.reset();
+        if (record.corrected) {
+            corrected.emplace(channels.size(), std::byte{0});
+            std::memcpy(corrected->data(), record.corrected->data(), corrected->size());
+        }
+        stream.write_values(format_timestamp(record.time), record.run_id,
+                            device_id, channels, corrected, encode_metadata(record));
+    }
+
+    stream.complete();
+}
+
+std::vector<SensorReadingRecord> SensorReadingRepository::read_page(const SensorReadingQuery& query,
+                                                                   std::string* error) {
+    std::vector<SensorReadingRecord> records;
+
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) {
+            if (error) *error = "no database connection";
+            return records;
+        }
+
+        pqxx::work txn(conn.get());
+        std::optional<int64_t> after_us;
+        int64_t after_seq = 0;
+        if (query.after) {
+            after_us = query.after->time_us;
+            after_seq = static_cast<int64_t>(query.after->frame_seq);
+        }
+        std::optional<std::string> run_tag;
+        if (!query.run_tag.empty()) run_tag = query.run_tag;
+        auto result = txn.exec_prepared(READINGS_PAGE,
+            options_.device_id, query.run_id, run_tag,
+            to_unix_us(query.start_time), to_unix_us(query.end_time),
+            after_us, after_seq, query.limit
+        );
+        txn.commit();
+
+        records.reserve(result.size());
+        for (const auto& row : result) {
+            SensorReadingRecord record;
+            record.time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::microseconds(row["time_us"].as<int64_t>())));
+            if (!row["run_id"].is_null()) record.run_id = row["run_id"].as<int>();
+            decode_channels(row["channels"], options_.channels, record.channels);
+            if (!row["channels_corrected"].is_null()) {
+                decode_channels(row["channels_corrected"], options_.channels, record.corrected.emplace());
+            }
+            if (!row["metadata"].is_null()) {
+                const auto meta = nlohmann::json::parse(row["metadata"].as<std::string>(), nullptr, false);
+                if (meta.is_object()) {
+                    record.heater_step = meta.value("heater_step", uint8_t{0});
+                    record.frame_seq = meta.value("seq", uint64_t{0});
+                    record.device_tick = meta.value("tick", uint32_t{0});
+                    record.run_tag = meta.value("run", std::string());
+                    record.phase = meta.value("phase", std::string());
+                    record.gas_mode = meta.value("gas_mode", std::string());
+                }
+            }
+            records.push_back(std::move(record));
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read sensor readings: {}", e.what());
+        records.clear();
+        if (error) *error = e.what();
+    }
+
+    return records;
+}
+
+void SensorReadingRepository::spill(const SensorReadingRecord& record) {
+    if (journal_) {
+        journal_->append(record);
+        ++rows_journaled_;
+    } else {
+        ++rows_dropped_;
+    }
+}
+
+std::string SensorReadingRepository::encode_metadata(const SensorReadingRecord& record) {
+    nlohmann::json meta = {
+        {"heater_step", record.heater_step},
+        {"seq", record.frame_seq},
+        {"tick", record.device_tick},
+    };
+    if (!record.run_tag.empty()) meta["run"] = record.run_tag;
+    if (!record.phase.empty()) meta["phase"] = record.phase;
+    if (!record.gas_mode.empty()) meta["gas_mode"] = record.gas_mode;
+    return meta.dump();
+}
+
+std::string SensorReadingRepository::format_timestamp(const std::chrono::system_clock::time_point& tp) {
+    auto time_t = std::chrono::system_clock::to_time_t(tp);
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        tp.time_since_epoch()) % 1000000;
+
+    std::ostringstream oss;
+    oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
+    oss << '.' << std::setfill('0') << std::setw(6) << us.count() << "+00";
+    return oss.str();
+}
+
+} // namespace db
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+class RecordingJournal;
+
+// 传感器原始数据记录 (对应 sensor_readings 表的一行 = 一个加热步的所有通道)
+struct SensorReadingRecord {
+    static constexpr std::size_t MAX_CHANNELS = 32;
+
+    std::chrono::system_clock::time_point time;
+    std::optional<int> run_id;          // runs.id, 无持久化运行时为空
+    std::string run_tag;                // 实验运行标识 (ExperimentService run_id)
+    std::string phase;
+    std::string gas_mode;               // chamber / bypass
+    uint8_t heater_step{0};
+    uint64_t frame_seq{0};
+    uint32_t device_tick{0};
+    std::array<float, MAX_CHANNELS> channels;   // 按 sensor_idx, 缺失为 NaN
+    std::optional<std::array<float, MAX_CHANNELS>> corrected;  // 漂移校正值 (channels_corrected), 无基线时为空
+    uint64_t rx_ns{0};                  // 帧最后一条读数的主机接收时间 (core::mono_ns), 只用于提交延迟统计, 不入库
+};
+
+// sensor_readings 的 keyset 分页游标
+struct SensorReadingCursor {
+    int64_t time_us{0};     // Unix 微秒
+    uint64_t frame_seq{0};
+};
+
+// sensor_readings 查询条件 (空字段不过滤)
+struct SensorReadingQuery {
+    std::optional<int> run_id;
+    std::string run_tag;
+    std::optional<std::chrono::system_clock::time_point> start_time;
+    std::optional<std::chrono::system_clock::time_point> end_time;
+    std::optional<SensorReadingCursor> after;
+    int limit{2000};
+};
+
+/**
+ * @brief sensor_readings 超表的异步写入器
+ *
+ * enqueue() 只在内存队列中追加, 可在采集 (io) 线程调用, 从不访问数据库;
+ * 独立写线程持有一条专用连接, 按条数或时间水位用 COPY (pqxx::stream_to) 批量写入.
+ * 队列满时丢弃最旧的记录并计数, 数据库故障期间保留队列内容并重试.
+ * 设置了 RecordingJournal 时, 连接池 unhealthy 期间的新记录和本应丢弃的记录改写入本地记录日志.
+ */
+class SensorReadingRepository {
+public:
+    struct Options {
+        std::string device_id = "default";
+        std::size_t channels = 16;                      // channels BYTEA 中的 float32 个数
+        std::size_t queue_capacity = 1000;              // 内存队列上限 (行)
+        std::size_t batch_rows = 256;                   // 达到该行数立即写入
+        std::chrono::milliseconds flush_interval{100};  // 最长缓存时间
+    };
+
+    struct Stats {
+        uint64_t rows_written = 0;
+        uint64_t rows_dropped = 0;
+        uint64_t flushes = 0;
+        uint64_t write_errors = 0;
+        uint64_t rows_journaled = 0;    // 改写入本地记录日志
+        std::size_t queued = 0;
+    };
+
+    explicit SensorReadingRepository(Options options);
+    ~SensorReadingRepository();
+
+    /**
+     * @brief 数据库不可用时的落盘去处 (须在 start / enqueue 之前设置)
+     */
+    void set_journal(std::shared_ptr<RecordingJournal> journal) { journal_ = std::move(journal); }
+
+    void start();
+
+    /**
+     * @brief 写出队列中剩余的记录后停止写线程 (须在 ConnectionPool::shutdown 之前调用)
+     */
+    void stop();
+
+    /**
+     * @brief 追加一行, 不阻塞
+     */
+    void enqueue(SensorReadingRecord record);
+
+    Stats stats() const;
+
+    const Options& options() const { return options_; }
+
+    /**
+     * @brief 按 (time, frame_seq) 顺序读取本设备的一页记录 (导出用, 同步访问数据库)
+     *
+     * channels / corrected 按 options.channels 解码, 其余通道为 NaN; 出错时返回空,
+     * 并写入 error (与读完无法区分的调用方据此判断).
+     */
+    std::vector<SensorReadingRecord> read_page(const SensorReadingQuery& query, std::string* error = nullptr);
+
+    /**
+     * @brief 在调用方事务中以 COPY 写入一批记录 (写线程和记录日志补传共用)
+     * @param channels channels BYTEA 中的 float32 个数
+     */
+    static void copy_readings(pqxx::work& txn, const std::string& device_id, std::size_t channels,
+                              const std::vector<SensorReadingRecord>& batch);
+
+private:
+    void writer_loop();
+    bool write_batch_on(pqxx::connection& conn, const std::vector<SensorReadingRecord>& batch);
+    void spill(const SensorReadingRecord& record);
+    static std::string encode_metadata(const SensorReadingRecord& record);
+    static std::string format_timestamp(const std::chrono::system_clock::time_point& tp);
+
+    Options options_;
+    std::shared_ptr<RecordingJournal> journal_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<SensorReadingRecord> queue_;
+    bool stopping_{false};
+    std::thread writer_;
+
+    std::atomic<uint64_t> rows_written_{0};
+    std::atomic<uint64_t> rows_dropped_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<uint64_t> rows_journaled_{0};
+};
+
+} // namespace db
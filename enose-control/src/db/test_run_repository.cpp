@@ -1,22 +1,241 @@
 #include "test_run_repository.hpp"
+#include "downsample.hpp"
+#include "prepared_statements.hpp"
+#include "timeseries_storage.hpp"
+#include "weight_sample_writer.hpp"
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
 #include <iomanip>
 #include <sstream>
 
 namespace db {
 
+namespace {
+
+constexpr const char* CREATE_RUN = "test_run_create_run";
+constexpr const char* UPDATE_RUN_STATE = "test_run_update_run_state";
+constexpr const char* COMPLETE_RUN = "test_run_complete_run";
+constexpr const char* GET_RUN = "test_run_get_run";
+constexpr const char* GET_RUNNING = "test_run_get_running";
+constexpr const char* LIST_RUNS = "test_run_list_runs";
+constexpr const char* SAVE_CHECKPOINT = "test_run_save_checkpoint";
+constexpr const char* MARK_INTERRUPTED = "test_run_mark_interrupted";
+constexpr const char* LIST_RESUMABLE = "test_run_list_resumable";
+constexpr const char* INSERT_RESULT = "test_run_insert_result";
+constexpr const char* GET_RESULTS = "test_run_get_results";
+constexpr const char* DURATION_STATISTICS = "test_run_duration_statistics";
+constexpr const char* INSERT_WEIGHT_SAMPLE = "test_run_insert_weight_sample";
+constexpr const char* WEIGHT_SAMPLES_PAGE = "test_run_weight_samples_page";
+constexpr const char* WEIGHT_SAMPLES_RANGE = "test_run_weight_samples_range";
+constexpr const char* WEIGHT_SAMPLES_BUCKETS = "test_run_weight_samples_buckets";
+constexpr const char* RECENT_WEIGHT_SAMPLES = "test_run_recent_weight_samples";
+constexpr const char* SYSTEM_LOGS_PAGE = "test_run_system_logs_page";
+constexpr const char* AGGREGATE_RANGE = "test_run_weight_aggregate_range";
+constexpr const char* AGGREGATE_BUCKETS_1S = "test_run_weight_aggregate_buckets_1s";
+constexpr const char* AGGREGATE_BUCKETS_1M = "test_run_weight_aggregate_buckets_1m";
+constexpr const char* AGGREGATE_BUCKETS_1H = "test_run_weight_aggregate_buckets_1h";
+
+constexpr const char* RUN_COLUMNS =
+    "SELECT id, created_at, completed_at, state, config_json, "
+    "current_step, total_steps, error_message, metadata FROM runs ";
+
+// 公共过滤条件: $1 run_id, $2 cycle, $3 start_us, $4 end_us (可为 NULL)
+constexpr const char* WEIGHT_SAMPLE_FILTER =
+    "WHERE run_id = $1 "
+    "AND ($2::INT IS NULL OR cycle = $2) "
+    "AND ($3::BIGINT IS NULL OR time >= TIMESTAMPTZ 'epoch' + $3 * INTERVAL '1 microsecond') "
+    "AND ($4::BIGINT IS NULL OR time <= TIMESTAMPTZ 'epoch' + $4 * INTERVAL '1 microsecond') ";
+
+// 连续聚合上的过滤条件 (参数同上): 取与 [start, end] 有重叠的聚合桶
+constexpr const char* AGGREGATE_FILTER =
+    "WHERE run_id = $1 "
+    "AND ($2::INT IS NULL OR cycle = $2) "
+    "AND ($3::BIGINT IS NULL OR last_time >= TIMESTAMPTZ 'epoch' + $3 * INTERVAL '1 microsecond') "
+    "AND ($4::BIGINT IS NULL OR first_time <= TIMESTAMPTZ 'epoch' + $4 * INTERVAL '1 microsecond') ";
+
+// 把聚合桶再合并到 $5 微秒宽的桶, 输出列与 WEIGHT_SAMPLES_BUCKETS 相同.
+// 只取完全落在 [start, end] 内的聚合桶 ([full_start, full_end)); 两端不完整的桶
+// 从原始表取区间内的样本补齐, 每个样本自成一行, 不会带入区间外的点
+std::string aggregate_buckets_sql(const TimeseriesStorage::TierInfo& tier) {
+    const std::string width = std::to_string(tier.width_us) + " * INTERVAL '1 microsecond'";
+    return std::string(
+        "WITH edges AS (SELECT "
+        "  time_bucket(") + width + ", TIMESTAMPTZ 'epoch' + ($3::BIGINT - 1) * INTERVAL '1 microsecond') + "
+        + width + " AS full_start, "
+        "  time_bucket(" + width + ", TIMESTAMPTZ 'epoch' + ($4::BIGINT + 1) * INTERVAL '1 microsecond') AS full_end), "
+        "src AS ("
+        "  SELECT bucket, first_time, first_w, last_time, last_w, min_time, min_w, max_time, max_w, "
+        "    cycle, phase, is_stable, trend "
+        "  FROM " + tier.view + ", edges "
+        "  WHERE run_id = $1 "
+        "  AND ($2::INT IS NULL OR cycle = $2) "
+        "  AND ($3::BIGINT IS NULL OR bucket >= full_start) "
+        "  AND ($4::BIGINT IS NULL OR bucket < full_end) "
+        "  UNION ALL "
+        "  SELECT time_bucket(" + width + ", time), time, weight, time, weight, time, weight, time, weight, "
+        "    cycle, phase, is_stable, trend "
+        "  FROM weight_samples, edges " + WEIGHT_SAMPLE_FILTER +
+        "  AND (($3::BIGINT IS NOT NULL AND time < full_start) OR ($4::BIGINT IS NOT NULL AND time >= full_end))) "
+        "SELECT "
+        "(EXTRACT(EPOCH FROM min(first_time)) * 1000000)::BIGINT AS first_us, first(first_w, first_time) AS first_w, "
+        "(EXTRACT(EPOCH FROM max(last_time)) * 1000000)::BIGINT AS last_us, last(last_w, last_time) AS last_w, "
+        "(EXTRACT(EPOCH FROM first(min_time, min_w)) * 1000000)::BIGINT AS min_us, min(min_w) AS min_w, "
+        "(EXTRACT(EPOCH FROM last(max_time, max_w)) * 1000000)::BIGINT AS max_us, max(max_w) AS max_w, "
+        "last(cycle, last_time) AS cycle, last(phase, last_time) AS phase, "
+        "bool_and(is_stable) AS is_stable, last(trend, last_time) AS trend "
+        "FROM src "
+        "GROUP BY time_bucket($5::BIGINT * INTERVAL '1 microsecond', bucket) "
+        "ORDER BY 1";
+}
+
+const TimeseriesStorage::TierInfo& tier_info(TimeseriesStorage::Tier tier) {
+    for (const auto& info : TimeseriesStorage::tiers()) {
+        if (info.tier == tier) return info;
+    }
+    return TimeseriesStorage::tiers().front();
+}
+
+const char* aggregate_buckets_statement(TimeseriesStorage::Tier tier) {
+    switch (tier) {
+    case TimeseriesStorage::Tier::Second: return AGGREGATE_BUCKETS_1S;
+    case TimeseriesStorage::Tier::Minute: return AGGREGATE_BUCKETS_1M;
+    case TimeseriesStorage::Tier::Hour: return AGGREGATE_BUCKETS_1H;
+    case TimeseriesStorage::Tier::Raw: break;
+    }
+    return WEIGHT_SAMPLES_BUCKETS;
+}
+
+const PreparedStatement TEST_RUN_STATEMENTS[] = {
+    {CREATE_RUN,
+        "INSERT INTO runs (config_json, total_steps, state) VALUES ($1, $2, 'running') RETURNING id"},
+    // current_step / error_message 为 NULL 时保持原值
+    {UPDATE_RUN_STATE,
+        "UPDATE runs SET state=$1, current_step=COALESCE($2::INT, current_step), "
+        "error_message=COALESCE($3::TEXT, error_message) WHERE id=$4"},
+    {COMPLETE_RUN, "UPDATE runs SET state=$1, completed_at=NOW() WHERE id=$2"},
+    {GET_RUN, std::string(RUN_COLUMNS) + "WHERE id=$1"},
+    {GET_RUNNING, std::string(RUN_COLUMNS) + "WHERE state='running' ORDER BY created_at DESC LIMIT 1"},
+    {LIST_RUNS, std::string(RUN_COLUMNS) +
+        "WHERE ($3::TEXT IS NULL OR state=$3) ORDER BY created_at DESC LIMIT $1 OFFSET $2"},
+    {SAVE_CHECKPOINT,
+        "UPDATE runs SET checkpoint=$2::JSONB, checkpoint_at=NOW(), current_step=$3 WHERE id=$1"},
+    {MARK_INTERRUPTED, "UPDATE runs SET state='interrupted' WHERE state='running' RETURNING id"},
+    {LIST_RESUMABLE,
+        "SELECT id, created_at, state, config_json, current_step, total_steps, "
+        "checkpoint::TEXT AS checkpoint, "
+        "(EXTRACT(EPOCH FROM checkpoint_at) * 1000000)::BIGINT AS checkpoint_us "
+        "FROM runs WHERE state='interrupted' AND checkpoint IS NOT NULL "
+        "AND ($1::INT IS NULL OR id=$1) ORDER BY created_at DESC LIMIT $2"},
+    {INSERT_RESULT,
+        "INSERT INTO test_results (run_id, param_set_id, param_set_name, cycle, "
+        "total_volume, pump0_volume, pump1_volume, pump2_volume, pump3_volume, "
+        "pump4_volume, pump5_volume, pump6_volume, pump7_volume, "
+        "speed, empty_weight, full_weight, injected_weight, "
+        "drain_duration_ms, wait_empty_duration_ms, inject_duration_ms, "
+        "wait_stable_duration_ms, total_duration_ms) "
+        "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22)"},
+    {GET_RESULTS, "SELECT * FROM test_results WHERE run_id=$1 ORDER BY time"},
+    // 最近 $1 条结果的时长回归: 名义进样时长 = 最大泵行程 / 速度 (GREATEST 忽略 NULL 列)
+    {DURATION_STATISTICS,
+        "SELECT count(*) AS n, "
+        "regr_slope(inject_duration_ms / 1000.0, nominal_s) AS inject_slope, "
+        "regr_intercept(inject_duration_ms / 1000.0, nominal_s) AS inject_intercept, "
+        "regr_slope(drain_duration_ms / 1000.0, full_weight - empty_weight) AS drain_slope, "
+        "regr_intercept(drain_duration_ms / 1000.0, full_weight - empty_weight) AS drain_intercept, "
+        "avg(wait_empty_duration_ms) / 1000.0 AS wait_empty_s "
+        "FROM (SELECT *, GREATEST(pump0_volume, pump1_volume, pump2_volume, pump3_volume, "
+        "  pump4_volume, pump5_volume, pump6_volume, pump7_volume) / speed AS nominal_s "
+        "  FROM test_results "
+        "  WHERE speed > 0 AND inject_duration_ms > 0 AND drain_duration_ms > 0 "
+        "  ORDER BY time DESC LIMIT $1) recent"},
+
+    {INSERT_WEIGHT_SAMPLE,
+        "INSERT INTO weight_samples (time, run_id, cycle, phase, weight, is_stable, trend) "
+        "VALUES (NOW(), $1, $2, $3, $4, $5, $6)"},
+    // (time, seq) > after: 先用 time >= 走 (run_id, time) 索引, 同一时刻再按 seq 排除
+    // 旧数据 seq 为 NULL, 视为 0
+    {WEIGHT_SAMPLES_PAGE,
+        std::string(
+            "SELECT (EXTRACT(EPOCH FROM time) * 1000000)::BIGINT AS time_us, "
+            "COALESCE(seq, 0) AS seq, run_id, cycle, phase, weight, is_stable, trend "
+            "FROM weight_samples ") + WEIGHT_SAMPLE_FILTER +
+        "AND ($5::BIGINT IS NULL OR ("
+        "  time >= TIMESTAMPTZ 'epoch' + $5 * INTERVAL '1 microsecond' AND "
+        "  (time > TIMESTAMPTZ 'epoch' + $5 * INTERVAL '1 microsecond' OR COALESCE(seq, 0) > $6))) "
+        "ORDER BY time, seq NULLS FIRST LIMIT $7"},
+    {WEIGHT_SAMPLES_RANGE,
+        std::string(
+            "SELECT count(*) AS n, "
+            "(EXTRACT(EPOCH FROM min(time)) * 1000000)::BIGINT AS first_us, "
+            "(EXTRACT(EPOCH FROM max(time)) * 1000000)::BIGINT AS last_us "
+            "FROM weight_samples ") + WEIGHT_SAMPLE_FILTER},
+    {WEIGHT_SAMPLES_BUCKETS,
+        std::string(
+            "SELECT "
+            "(EXTRACT(EPOCH FROM min(time)) * 1000000)::BIGINT AS first_us, first(weight, time) AS first_w, "
+            "(EXTRACT(EPOCH FROM max(time)) * 1000000)::BIGINT AS last_us, last(weight, time) AS last_w, "
+            "(EXTRACT(EPOCH FROM first(time, weight)) * 1000000)::BIGINT AS min_us, min(weight) AS min_w, "
+            "(EXTRACT(EPOCH FROM last(time, weight)) * 1000000)::BIGINT AS max_us, max(weight) AS max_w, "
+            "last(cycle, time) AS cycle, last(phase, time) AS phase, "
+            "bool_and(is_stable) AS is_stable, last(trend, time) AS trend "
+            "FROM weight_samples ") + WEIGHT_SAMPLE_FILTER +
+        "GROUP BY time_bucket($5::BIGINT * INTERVAL '1 microsecond', time) "
+        "ORDER BY 1"},
+    {RECENT_WEIGHT_SAMPLES,
+        "SELECT time, run_id, cycle, phase, weight, is_stable, trend "
+        "FROM weight_samples WHERE run_id=$1 "
+        "ORDER BY time DESC LIMIT $2"},
+
+    // 从游标时刻开始, 跳过该时刻已读出的 $4 行
+    {SYSTEM_LOGS_PAGE,
+        "SELECT (EXTRACT(EPOCH FROM time) * 1000000)::BIGINT AS time_us, level, source, message, context "
+        "FROM system_logs "
+        "WHERE ($1::BIGINT IS NULL OR time >= TIMESTAMPTZ 'epoch' + $1 * INTERVAL '1 microsecond') "
+        "AND ($2::BIGINT IS NULL OR time <= TIMESTAMPTZ 'epoch' + $2 * INTERVAL '1 microsecond') "
+        "AND ($3::BIGINT IS NULL OR time >= TIMESTAMPTZ 'epoch' + $3 * INTERVAL '1 microsecond') "
+        "ORDER BY time, source, message OFFSET $4 LIMIT $5"},
+
+    // 按小时聚合估算样本数和时间范围, 不扫描原始表; 边界桶可能多计, 只用于选择桶宽
+    {AGGREGATE_RANGE,
+        std::string(
+            "SELECT COALESCE(sum(n), 0)::BIGINT AS n, "
+            "(EXTRACT(EPOCH FROM GREATEST(min(first_time), "
+            "  TIMESTAMPTZ 'epoch' + $3::BIGINT * INTERVAL '1 microsecond')) * 1000000)::BIGINT AS first_us, "
+            "(EXTRACT(EPOCH FROM LEAST(max(last_time), "
+            "  TIMESTAMPTZ 'epoch' + $4::BIGINT * INTERVAL '1 microsecond')) * 1000000)::BIGINT AS last_us "
+            "FROM weight_samples_1h ") + AGGREGATE_FILTER},
+    {AGGREGATE_BUCKETS_1S, aggregate_buckets_sql(tier_info(TimeseriesStorage::Tier::Second))},
+    {AGGREGATE_BUCKETS_1M, aggregate_buckets_sql(tier_info(TimeseriesStorage::Tier::Minute))},
+    {AGGREGATE_BUCKETS_1H, aggregate_buckets_sql(tier_info(TimeseriesStorage::Tier::Hour))},
+};
+
+} // namespace
+
+std::span<const PreparedStatement> test_run_statements() {
+    return TEST_RUN_STATEMENTS;
+}
+
 std::string TestRunRepository::format_timestamp(const std::chrono::system_clock::time_point& tp) {
     auto time_t = std::chrono::system_clock::to_time_t(tp);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        tp.time_since_epoch()) % 1000;
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+        tp.time_since_epoch()) % 1000000;
     
     std::ostringstream oss;
     oss << std::put_time(std::gmtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    oss << '.' << std::setfill('0') << std::setw(3) << ms.count();
+    oss << '.' << std::setfill('0') << std::setw(6) << us.count() << "+00";
     return oss.str();
 }
 
+void TestRunRepository::set_sample_writer(std::shared_ptr<WeightSampleWriter> writer) {
+    sample_writer_ = std::move(writer);
+}
+
+void TestRunRepository::set_aggregates_enabled(bool enabled) {
+    aggregates_enabled_ = enabled;
+}
+
 std::chrono::system_clock::time_point TestRunRepository::parse_timestamp(const std::string& ts) {
     std::tm tm = {};
     std::istringstream ss(ts);
@@ -33,10 +252,7 @@ std::optional<int> TestRunRepository::create_run(const std::string& config_json,
         }
         
         pqxx::work txn(conn.get());
-        auto result = txn.exec_params(
-            "INSERT INTO runs (config_json, total_steps, state) VALUES ($1, $2, 'running') RETURNING id",
-            config_json, total_steps
-        );
+        auto result = txn.exec_prepared(CREATE_RUN, config_json, total_steps);
         txn.commit();
         
         if (!result.empty()) {
@@ -58,27 +274,11 @@ bool TestRunRepository::update_run_state(int run_id, const std::string& state,
         
         pqxx::work txn(conn.get());
         
-        if (current_step >= 0 && !error_msg.empty()) {
-            txn.exec_params(
-                "UPDATE runs SET state=$1, current_step=$2, error_message=$3 WHERE id=$4",
-                state, current_step, error_msg, run_id
-            );
-        } else if (current_step >= 0) {
-            txn.exec_params(
-                "UPDATE runs SET state=$1, current_step=$2 WHERE id=$3",
-                state, current_step, run_id
-            );
-        } else if (!error_msg.empty()) {
-            txn.exec_params(
-                "UPDATE runs SET state=$1, error_message=$2 WHERE id=$3",
-                state, error_msg, run_id
-            );
-        } else {
-            txn.exec_params(
-                "UPDATE runs SET state=$1 WHERE id=$2",
-                state, run_id
-            );
-        }
+        std::optional<int> step;
+        if (current_step >= 0) step = current_step;
+        std::optional<std::string> error;
+        if (!error_msg.empty()) error = error_msg;
+        txn.exec_prepared(UPDATE_RUN_STATE, state, step, error, run_id);
         
         txn.commit();
         return true;
@@ -94,18 +294,16 @@ bool TestRunRepository::complete_run(int run_id, const std::string& state) {
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec_params(
-            "UPDATE runs SET state=$1, completed_at=NOW() WHERE id=$2",
-            state, run_id
-        );
+        txn.exec_prepared(COMPLETE_RUN, state, run_id);
         txn.commit();
         
         spdlog::info("Completed test run id={} with state={}", run_id, state);
-        return true;
     } catch (const std::exception& e) {
         spdlog::error("Failed to complete run: {}", e.what());
         return false;
     }
+    on_run_completed(run_id, state);
+    return true;
 }
 
 std::optional<TestRunRecord> TestRunRepository::get_run(int run_id) {
@@ -114,12 +312,7 @@ std::optional<TestRunRecord> TestRunRepository::get_run(int run_id) {
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        auto result = txn.exec_params(
-            "SELECT id, created_at, completed_at, state, config_json, "
-            "current_step, total_steps, error_message, metadata "
-            "FROM runs WHERE id=$1",
-            run_id
-        );
+        auto result = txn.exec_prepared(GET_RUN, run_id);
         txn.commit();
         
         if (result.empty()) return std::nullopt;
@@ -154,11 +347,7 @@ std::optional<TestRunRecord> TestRunRepository::get_running_test() {
         if (!conn.valid()) return std::nullopt;
         
         pqxx::work txn(conn.get());
-        auto result = txn.exec(
-            "SELECT id, created_at, completed_at, state, config_json, "
-            "current_step, total_steps, error_message, metadata "
-            "FROM runs WHERE state='running' ORDER BY created_at DESC LIMIT 1"
-        );
+        auto result = txn.exec_prepared(GET_RUNNING);
         txn.commit();
         
         if (result.empty()) return std::nullopt;
@@ -187,23 +376,9 @@ std::vector<TestRunRecord> TestRunRepository::list_runs(int limit, int offset,
         if (!conn.valid()) return records;
         
         pqxx::work txn(conn.get());
-        pqxx::result result;
-        
-        if (state_filter.empty()) {
-            result = txn.exec_params(
-                "SELECT id, created_at, completed_at, state, config_json, "
-                "current_step, total_steps, error_message, metadata "
-                "FROM runs ORDER BY created_at DESC LIMIT $1 OFFSET $2",
-                limit, offset
-            );
-        } else {
-            result = txn.exec_params(
-                "SELECT id, created_at, completed_at, state, config_json, "
-                "current_step, total_steps, error_message, metadata "
-                "FROM runs WHERE state=$1 ORDER BY created_at DESC LIMIT $2 OFFSET $3",
-                state_filter, limit, offset
-            );
-        }
+        std::optional<std::string> state;
+        if (!state_filter.empty()) state = state_filter;
+        pqxx::result result = txn.exec_prepared(LIST_RUNS, limit, offset, state);
         txn.commit();
         
         for (const auto& row : result) {
@@ -226,20 +401,81 @@ std::vector<TestRunRecord> TestRunRepository::list_runs(int limit, int offset,
     return records;
 }
 
+bool TestRunRepository::save_checkpoint(int run_id, int current_step, const std::string& checkpoint_json) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return false;
+        
+        pqxx::work txn(conn.get());
+        txn.exec_prepared(SAVE_CHECKPOINT, run_id, checkpoint_json, current_step);
+        txn.commit();
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to save checkpoint of run {}: {}", run_id, e.what());
+        return false;
+    }
+}
+
+int TestRunRepository::mark_interrupted() {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return 0;
+        
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(MARK_INTERRUPTED);
+        txn.commit();
+        
+        if (!result.empty()) {
+            spdlog::warn("Marked {} runs left running by the previous process as interrupted", result.size());
+        }
+        return static_cast<int>(result.size());
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to mark interrupted runs: {}", e.what());
+        return 0;
+    }
+}
+
+std::vector<TestRunRecord> TestRunRepository::list_resumable(std::optional<int> run_id, int limit) {
+    std::vector<TestRunRecord> records;
+    
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return records;
+        
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(LIST_RESUMABLE, run_id, limit);
+        txn.commit();
+        
+        for (const auto& row : result) {
+            TestRunRecord record;
+            record.id = row["id"].as<int>();
+            record.created_at = parse_timestamp(row["created_at"].as<std::string>());
+            record.state = row["state"].as<std::string>();
+            record.config_json = row["config_json"].as<std::string>();
+            record.current_step = row["current_step"].as<int>();
+            record.total_steps = row["total_steps"].as<int>();
+            record.checkpoint_json = row["checkpoint"].as<std::string>();
+            if (!row["checkpoint_us"].is_null()) {
+                record.checkpoint_at = std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::microseconds(row["checkpoint_us"].as<int64_t>())));
+            }
+            records.push_back(record);
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to list resumable runs: {}", e.what());
+    }
+    
+    return records;
+}
+
 bool TestRunRepository::insert_result(int run_id, const workflows::TestResult& result) {
     try {
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec_params(
-            "INSERT INTO test_results (run_id, param_set_id, param_set_name, cycle, "
-            "total_volume, pump0_volume, pump1_volume, pump2_volume, pump3_volume, "
-            "pump4_volume, pump5_volume, pump6_volume, pump7_volume, "
-            "speed, empty_weight, full_weight, injected_weight, "
-            "drain_duration_ms, wait_empty_duration_ms, inject_duration_ms, "
-            "wait_stable_duration_ms, total_duration_ms) "
-            "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22)",
+        txn.exec_prepared(INSERT_RESULT,
             run_id, result.param_set_id, result.param_set_name, result.cycle,
             result.total_volume, result.pump0_volume, result.pump1_volume,
             result.pump2_volume, result.pump3_volume,
@@ -267,10 +503,7 @@ std::vector<TestResultRecord> TestRunRepository::get_results(int run_id) {
         if (!conn.valid()) return records;
         
         pqxx::work txn(conn.get());
-        auto result = txn.exec_params(
-            "SELECT * FROM test_results WHERE run_id=$1 ORDER BY time",
-            run_id
-        );
+        auto result = txn.exec_prepared(GET_RESULTS, run_id);
         txn.commit();
         
         for (const auto& row : result) {
@@ -308,18 +541,52 @@ std::vector<TestResultRecord> TestRunRepository::get_results(int run_id) {
     return records;
 }
 
+std::optional<enose::workflows::SimulationCalibration> TestRunRepository::get_simulation_calibration(int limit) {
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return std::nullopt;
+        
+        pqxx::work txn(conn.get());
+        auto result = txn.exec_prepared(DURATION_STATISTICS, limit);
+        txn.commit();
+        if (result.empty()) return std::nullopt;
+        
+        const auto& row = result[0];
+        enose::workflows::SimulationCalibration calibration;
+        calibration.samples = row["n"].as<int>(0);
+        calibration.inject_slope = row["inject_slope"].as<double>(0);
+        calibration.inject_intercept_s = row["inject_intercept"].as<double>(0);
+        calibration.drain_s_per_g = row["drain_slope"].as<double>(0);
+        calibration.drain_intercept_s = row["drain_intercept"].as<double>(0);
+        calibration.wait_empty_s = row["wait_empty_s"].as<double>(0);
+        return calibration;
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to get duration statistics: {}", e.what());
+        return std::nullopt;
+    }
+}
+
 bool TestRunRepository::insert_weight_sample(int run_id, int cycle, const std::string& phase,
                                               float weight, bool is_stable, const std::string& trend) {
+    if (sample_writer_) {
+        sample_writer_->enqueue(WeightSampleRecord{
+            .time = std::chrono::system_clock::now(),
+            .run_id = run_id,
+            .cycle = cycle,
+            .phase = phase,
+            .weight = weight,
+            .is_stable = is_stable,
+            .trend = trend,
+        });
+        return true;
+    }
+    
     try {
         auto conn = ConnectionPool::instance().acquire();
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        txn.exec_params(
-            "INSERT INTO weight_samples (time, run_id, cycle, phase, weight, is_stable, trend) "
-            "VALUES (NOW(), $1, $2, $3, $4, $5, $6)",
-            run_id, cycle, phase, weight, is_stable, trend
-        );
+        txn.exec_prepared(INSERT_WEIGHT_SAMPLE, run_id, cycle, phase, weight, is_stable, trend);
         txn.commit();
         return true;
     } catch (const std::exception& e) {
@@ -336,25 +603,7 @@ bool TestRunRepository::insert_weight_samples(const std::vector<WeightSampleReco
         if (!conn.valid()) return false;
         
         pqxx::work txn(conn.get());
-        
-        // 使用 COPY 或批量 INSERT 提高性能
-        std::ostringstream sql;
-        sql << "INSERT INTO weight_samples (time, run_id, cycle, phase, weight, is_stable, trend) VALUES ";
-        
-        bool first = true;
-        for (const auto& s : samples) {
-            if (!first) sql << ",";
-            first = false;
-            sql << "('" << format_timestamp(s.time) << "',"
-                << s.run_id << ","
-                << s.cycle << ","
-                << txn.quote(s.phase) << ","
-                << s.weight << ","
-                << (s.is_stable ? "true" : "false") << ","
-                << txn.quote(s.trend) << ")";
-        }
-        
-        txn.exec(sql.str());
+        copy_weight_samples(txn, samples);
         txn.commit();
         
         spdlog::debug("Inserted {} weight samples", samples.size());
@@ -365,56 +614,191 @@ bool TestRunRepository::insert_weight_samples(const std::vector<WeightSampleReco
     }
 }
 
+void TestRunRepository::copy_weight_samples(pqxx::work& txn,
+                                            const std::vector<WeightSampleRecord>& samples) {
+    auto stream = pqxx::stream_to::table(txn, {"weight_samples"},
+                                         {"time", "run_id", "cycle", "phase", "weight", "is_stable", "trend"});
+    for (const auto& s : samples) {
+        stream.write_values(format_timestamp(s.time), s.run_id, s.cycle, s.phase,
+                            s.weight, s.is_stable, s.trend);
+    }
+    stream.complete();
+}
+
+namespace {
+
+int64_t to_unix_us(const std::chrono::system_clock::time_point& tp) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point from_unix_us(int64_t us) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(us)));
+}
+
+std::optional<int64_t> to_unix_us(const std::optional<std::chrono::system_clock::time_point>& tp) {
+    if (!tp) return std::nullopt;
+    return to_unix_us(*tp);
+}
+
+// 把每个时间桶的首/尾/最小/最大点展开为按时间排序的候选点, 再用 LTTB 选出 max_points 个
+std::vector<WeightSampleRecord> select_bucket_points(const pqxx::result& buckets, int run_id, int max_points) {
+    std::vector<WeightSampleRecord> candidates;
+    candidates.reserve(buckets.size() * 4);
+    for (const auto& row : buckets) {
+        WeightSampleRecord base;
+        base.run_id = run_id;
+        base.cycle = row["cycle"].is_null() ? 0 : row["cycle"].as<int>();
+        base.phase = row["phase"].is_null() ? "" : row["phase"].as<std::string>();
+        base.is_stable = row["is_stable"].as<bool>(false);
+        if (!row["trend"].is_null()) {
+            base.trend = row["trend"].as<std::string>();
+        }
+        
+        std::array<std::pair<int64_t, float>, 4> points = {{
+            {row["first_us"].as<int64_t>(), row["first_w"].as<float>()},
+            {row["min_us"].as<int64_t>(), row["min_w"].as<float>()},
+            {row["max_us"].as<int64_t>(), row["max_w"].as<float>()},
+            {row["last_us"].as<int64_t>(), row["last_w"].as<float>()},
+        }};
+        std::sort(points.begin(), points.end());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            if (i > 0 && points[i].first == points[i - 1].first) continue;
+            WeightSampleRecord record = base;
+            record.time = from_unix_us(points[i].first);
+            record.weight = points[i].second;
+            candidates.push_back(std::move(record));
+        }
+    }
+    
+    std::vector<double> xs, ys;
+    xs.reserve(candidates.size());
+    ys.reserve(candidates.size());
+    for (const auto& c : candidates) {
+        xs.push_back(static_cast<double>(to_unix_us(c.time)));
+        ys.push_back(c.weight);
+    }
+    
+    std::vector<WeightSampleRecord> records;
+    auto selected = lttb_select(xs, ys, static_cast<std::size_t>(max_points));
+    records.reserve(selected.size());
+    for (auto idx : selected) {
+        records.push_back(std::move(candidates[idx]));
+    }
+    return records;
+}
+
+} // namespace
+
 std::vector<WeightSampleRecord> TestRunRepository::get_weight_samples(int run_id,
     std::optional<int> cycle,
     std::optional<std::chrono::system_clock::time_point> start_time,
     std::optional<std::chrono::system_clock::time_point> end_time,
     int limit) {
     
+    WeightSampleQuery query;
+    query.run_id = run_id;
+    query.cycle = cycle;
+    query.start_time = start_time;
+    query.end_time = end_time;
+    query.limit = limit;
+    return get_weight_samples_page(query);
+}
+
+std::vector<WeightSampleRecord> TestRunRepository::get_weight_samples_page(const WeightSampleQuery& query,
+                                                                           std::string* error) {
     std::vector<WeightSampleRecord> records;
     
     try {
         auto conn = ConnectionPool::instance().acquire();
-        if (!conn.valid()) return records;
+        if (!conn.valid()) {
+            if (error) *error = "no database connection";
+            return records;
+        }
         
         pqxx::work txn(conn.get());
         
-        std::ostringstream sql;
-        sql << "SELECT time, run_id, cycle, phase, weight, is_stable, trend "
-            << "FROM weight_samples WHERE run_id=" << run_id;
-        
-        if (cycle) {
-            sql << " AND cycle=" << *cycle;
-        }
-        if (start_time) {
-            sql << " AND time >= '" << format_timestamp(*start_time) << "'";
-        }
-        if (end_time) {
-            sql << " AND time <= '" << format_timestamp(*end_time) << "'";
+        std::optional<int64_t> after_us;
+        int64_t after_seq = 0;
+        if (query.after) {
+            after_us = query.after->time_us;
+            after_seq = query.after->seq;
         }
-        
-        sql << " ORDER BY time LIMIT " << limit;
-        
-        auto result = txn.exec(sql.str());
+        auto result = txn.exec_prepared(WEIGHT_SAMPLES_PAGE,
+            query.run_id, query.cycle, to_unix_us(query.start_time), to_unix_us(query.end_time),
+            after_us, after_seq, query.limit
+        );
         txn.commit();
         
+        records.reserve(result.size());
         for (const auto& row : result) {
             WeightSampleRecord record;
-            record.time = parse_timestamp(row["time"].as<std::string>());
+            record.time = from_unix_us(row["time_us"].as<int64_t>());
+            record.seq = row["seq"].as<int64_t>();
             record.run_id = row["run_id"].as<int>();
-            record.cycle = row["cycle"].as<int>();
-            record.phase = row["phase"].as<std::string>();
+            record.cycle = row["cycle"].is_null() ? 0 : row["cycle"].as<int>();
+            record.phase = row["phase"].is_null() ? "" : row["phase"].as<std::string>();
             record.weight = row["weight"].as<float>();
-            record.is_stable = row["is_stable"].as<bool>();
+            record.is_stable = row["is_stable"].as<bool>(false);
             if (!row["trend"].is_null()) {
                 record.trend = row["trend"].as<std::string>();
             }
-            records.push_back(record);
+            records.push_back(std::move(record));
         }
     } catch (const std::exception& e) {
         spdlog::error("Failed to get weight samples: {}", e.what());
+        records.clear();
+        if (error) *error = e.what();
+    }
+    
+    return records;
+}
+
+std::vector<WeightSampleRecord> TestRunRepository::get_weight_samples_downsampled(
+    const WeightSampleQuery& query, int max_points) {
+    
+    std::vector<WeightSampleRecord> records;
+    if (max_points <= 0) return records;
+    int64_t total = 0;
+    
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return records;
+        
+        pqxx::work txn(conn.get());
+        const auto start_us = to_unix_us(query.start_time);
+        const auto end_us = to_unix_us(query.end_time);
+        
+        auto range = txn.exec_prepared(aggregates_enabled_ ? AGGREGATE_RANGE : WEIGHT_SAMPLES_RANGE,
+            query.run_id, query.cycle, start_us, end_us);
+        total = range[0]["n"].as<int64_t>();
+        
+        if (total > max_points) {
+            // 每桶至多贡献 4 个候选点 (首/尾/最小/最大), LTTB 再从中选出 max_points 个
+            const int64_t span_us = range[0]["last_us"].as<int64_t>() - range[0]["first_us"].as<int64_t>();
+            const int64_t bucket_us = std::max<int64_t>(span_us / max_points + 1, 1);
+            // 桶宽不小于某级聚合时直接在该聚合上分桶, 不扫描原始样本
+            const auto& tier = aggregates_enabled_ ? TimeseriesStorage::coarsest_for(bucket_us)
+                                                   : TimeseriesStorage::tiers().front();
+            auto buckets = txn.exec_prepared(aggregate_buckets_statement(tier.tier),
+                query.run_id, query.cycle, start_us, end_us, bucket_us);
+            records = select_bucket_points(buckets, query.run_id, max_points);
+            spdlog::debug("Downsampled {} weight samples for run {} to {} points ({} buckets from {})",
+                          total, query.run_id, records.size(), buckets.size(), tier.view);
+        }
+        txn.commit();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to get downsampled weight samples: {}", e.what());
+        return records;
     }
     
+    // 样本不多于 max_points: 直接返回原始样本
+    if (total > 0 && total <= max_points) {
+        WeightSampleQuery all = query;
+        all.after.reset();
+        all.limit = static_cast<int>(total);
+        return get_weight_samples_page(all);
+    }
     return records;
 }
 
@@ -426,12 +810,7 @@ std::vector<WeightSampleRecord> TestRunRepository::get_recent_weight_samples(int
         if (!conn.valid()) return records;
         
         pqxx::work txn(conn.get());
-        auto result = txn.exec_params(
-            "SELECT time, run_id, cycle, phase, weight, is_stable, trend "
-            "FROM weight_samples WHERE run_id=$1 "
-            "ORDER BY time DESC LIMIT $2",
-            run_id, last_n
-        );
+        auto result = txn.exec_prepared(RECENT_WEIGHT_SAMPLES, run_id, last_n);
         txn.commit();
         
         // 反转顺序使其按时间正序
@@ -455,4 +834,43 @@ std::vector<WeightSampleRecord> TestRunRepository::get_recent_weight_samples(int
     return records;
 }
 
+std::vector<SystemLogRecord> TestRunRepository::get_system_logs_page(const SystemLogQuery& query) {
+    std::vector<SystemLogRecord> records;
+    
+    try {
+        auto conn = ConnectionPool::instance().acquire();
+        if (!conn.valid()) return records;
+        
+        pqxx::work txn(conn.get());
+        
+        std::optional<int64_t> after_us;
+        int64_t skip = 0;
+        if (query.after) {
+            after_us = query.after->time_us;
+            skip = query.after->skip;
+        }
+        auto result = txn.exec_prepared(SYSTEM_LOGS_PAGE,
+            to_unix_us(query.start_time), to_unix_us(query.end_time), after_us, skip, query.limit
+        );
+        txn.commit();
+        
+        records.reserve(result.size());
+        for (const auto& row : result) {
+            SystemLogRecord record;
+            record.time = from_unix_us(row["time_us"].as<int64_t>());
+            record.level = row["level"].as<std::string>();
+            record.source = row["source"].as<std::string>();
+            record.message = row["message"].as<std::string>();
+            if (!row["context"].is_null()) {
+                record.context_json = row["context"].as<std::string>();
+            }
+            records.push_back(std::move(record));
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to get system logs: {}", e.what());
+    }
+    
+    return records;
+}
+
 } // namespace db
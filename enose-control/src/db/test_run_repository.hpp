@@ -2,9 +2,14 @@
 
 #include "connection_pool.hpp"
 #include "../workflows/test_controller.hpp"
+#include "../workflows/experiment_simulator.hpp"
+#include <boost/signals2.hpp>
+#include <atomic>
+#include <cstdint>
 #include <optional>
 #include <vector>
 #include <chrono>
+#include <memory>
 
 namespace db {
 
@@ -13,12 +18,14 @@ struct TestRunRecord {
     int id{0};
     std::chrono::system_clock::time_point created_at;
     std::optional<std::chrono::system_clock::time_point> completed_at;
-    std::string state;  // running, completed, error, aborted
+    std::string state;  // running, completed, error, aborted, interrupted
     std::string config_json;
     int current_step{0};
     int total_steps{0};
     std::string error_message;
     std::string metadata_json;
+    std::string checkpoint_json;    // 只有 list_resumable 填充
+    std::optional<std::chrono::system_clock::time_point> checkpoint_at;
 };
 
 // 测试结果记录 (对应 test_results 表)
@@ -51,7 +58,8 @@ struct TestResultRecord {
 
 // 称重样本记录 (对应 weight_samples 表)
 struct WeightSampleRecord {
-    std::chrono::system_clock::time_point time;
+    std::chrono::system_clock::time_point time;     // 微秒精度
+    int64_t seq{0};                                  // 同一时刻样本的次序 (降采样结果为 0)
     int run_id{0};
     int cycle{0};
     std::string phase;
@@ -60,10 +68,57 @@ struct WeightSampleRecord {
     std::string trend;
 };
 
+// 称重样本分页游标: 按 (time, seq) 严格递增, 下一页从游标之后开始
+struct WeightSampleCursor {
+    int64_t time_us{0};     // Unix 微秒
+    int64_t seq{0};
+};
+
+// 称重样本查询条件
+struct WeightSampleQuery {
+    int run_id{0};
+    std::optional<int> cycle;
+    std::optional<std::chrono::system_clock::time_point> start_time;
+    std::optional<std::chrono::system_clock::time_point> end_time;
+    std::optional<WeightSampleCursor> after;    // keyset 分页, 不用 OFFSET
+    int limit{10000};
+};
+
+// 系统日志记录 (对应 system_logs 表)
+struct SystemLogRecord {
+    std::chrono::system_clock::time_point time;
+    std::string level;
+    std::string source;
+    std::string message;
+    std::string context_json;   // 无 context 时为空
+};
+
+// system_logs 没有唯一键: 游标记到最后一行的时间, 以及该时刻已读出的行数
+struct SystemLogCursor {
+    int64_t time_us{0};     // Unix 微秒
+    int64_t skip{0};
+};
+
+// 系统日志查询条件
+struct SystemLogQuery {
+    std::optional<std::chrono::system_clock::time_point> start_time;
+    std::optional<std::chrono::system_clock::time_point> end_time;
+    std::optional<SystemLogCursor> after;
+    int limit{2000};
+};
+
+class WeightSampleWriter;
+
 class TestRunRepository {
 public:
     TestRunRepository() = default;
     
+    // 设置后 insert_weight_sample 改为入队异步写入, 不再逐条往返数据库
+    void set_sample_writer(std::shared_ptr<WeightSampleWriter> writer);
+    
+    // TimeseriesStorage::apply 成功后启用: 降采样查询改用最粗的可用连续聚合
+    void set_aggregates_enabled(bool enabled);
+    
     // === 测试运行管理 ===
     
     // 创建新的测试运行记录，返回 run_id
@@ -73,15 +128,29 @@ public:
     bool update_run_state(int run_id, const std::string& state, 
                           int current_step = -1, const std::string& error_msg = "");
     
-    // 完成测试运行
+    // 完成测试运行; 成功后发出 on_run_completed
     bool complete_run(int run_id, const std::string& state);
     
+    // complete_run 提交后在调用线程上发出 (run_id, state), 订阅者不应阻塞
+    boost::signals2::signal<void(int, const std::string&)> on_run_completed;
+    
     // 获取运行记录
     std::optional<TestRunRecord> get_run(int run_id);
     
     // 获取当前正在运行的测试
     std::optional<TestRunRecord> get_running_test();
     
+    // === 检查点 / 续跑 ===
+    
+    // 覆盖运行的检查点 (同时更新 current_step)
+    bool save_checkpoint(int run_id, int current_step, const std::string& checkpoint_json);
+    
+    // 启动时调用: 上次进程退出时仍为 running 的记录改为 interrupted, 返回条数
+    int mark_interrupted();
+    
+    // 有检查点的 interrupted 记录 (含 config_json 与 checkpoint), 新的在前; run_id 指定时只查这一条
+    std::vector<TestRunRecord> list_resumable(std::optional<int> run_id = std::nullopt, int limit = 20);
+    
     // 获取测试运行列表 (分页)
     std::vector<TestRunRecord> list_runs(int limit = 50, int offset = 0, 
                                           const std::string& state_filter = "");
@@ -94,12 +163,18 @@ public:
     // 获取测试结果
     std::vector<TestResultRecord> get_results(int run_id);
     
+    // 最近 limit 条测试结果的时长统计, 用于标定实验模拟器的进样 / 排废模型
+    std::optional<enose::workflows::SimulationCalibration> get_simulation_calibration(int limit = 200);
+    
     // === 称重样本管理 ===
     
-    // 批量插入称重样本 (高性能)
+    // 批量插入称重样本 (COPY)
     bool insert_weight_samples(const std::vector<WeightSampleRecord>& samples);
     
-    // 插入单个称重样本
+    // 在 txn 中以 COPY 写入一批称重样本 (seq 由数据库分配), 调用方负责提交
+    static void copy_weight_samples(pqxx::work& txn, const std::vector<WeightSampleRecord>& samples);
+    
+    // 插入单个称重样本; 设置了写入器时入队并立即返回 true
     bool insert_weight_sample(int run_id, int cycle, const std::string& phase,
                               float weight, bool is_stable, const std::string& trend);
     
@@ -110,12 +185,31 @@ public:
         std::optional<std::chrono::system_clock::time_point> end_time = std::nullopt,
         int limit = 10000);
     
+    // 按 (time, seq) keyset 读取一页称重样本, 最多 query.limit 条; 出错时返回空并写入 error
+    std::vector<WeightSampleRecord> get_weight_samples_page(const WeightSampleQuery& query,
+                                                            std::string* error = nullptr);
+    
+    // 降采样到至多 max_points 个点: SQL 中按 time_bucket 取每桶首/尾/最小/最大点,
+    // 再用 LTTB 选点. 样本数不超过 max_points 时返回原始样本 (忽略 after / limit).
+    // 启用聚合时从桶宽不超过所需分辨率的最粗聚合 (1s / 1min / 1h) 取桶, 跨越 start / end
+    // 的边界桶改用原始样本, 结果不含区间外的点
+    std::vector<WeightSampleRecord> get_weight_samples_downsampled(const WeightSampleQuery& query,
+                                                                   int max_points);
+    
     // 获取最近的称重样本 (用于实时图表)
     std::vector<WeightSampleRecord> get_recent_weight_samples(int run_id, int last_n = 100);
+    
+    // === 系统日志 ===
+    
+    // 按时间顺序读取一页 system_logs (同一时刻按 source, message 排序), 最多 query.limit 条
+    std::vector<SystemLogRecord> get_system_logs_page(const SystemLogQuery& query);
 
 private:
-    std::string format_timestamp(const std::chrono::system_clock::time_point& tp);
+    static std::string format_timestamp(const std::chrono::system_clock::time_point& tp);
     std::chrono::system_clock::time_point parse_timestamp(const std::string& ts);
+    
+    std::shared_ptr<WeightSampleWriter> sample_writer_;
+    std::atomic<bool> aggregates_enabled_{false};   // 连接池预热线程设置, 查询线程读取
 };
 
 } // namespace db
@@ -0,0 +1,142 @@
+#include "timeseries_storage.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string>
+
+namespace db {
+
+namespace {
+
+constexpr int64_t SECOND_US = 1000000;
+
+const TimeseriesStorage::TierInfo TIERS[] = {
+    {TimeseriesStorage::Tier::Raw, "weight_samples", 0},
+    {TimeseriesStorage::Tier::Second, "weight_samples_1s", SECOND_US},
+    {TimeseriesStorage::Tier::Minute, "weight_samples_1m", 60 * SECOND_US},
+    {TimeseriesStorage::Tier::Hour, "weight_samples_1h", 3600 * SECOND_US},
+};
+
+// 连续聚合的刷新窗口; start_offset 不得超过原始数据的保留期,
+// 否则刷新到已删除的区间时聚合中对应的行也会被清空
+struct RefreshPolicy {
+    const char* view;
+    const char* width;
+    int start_offset_days;
+    const char* end_offset;
+    const char* schedule;
+};
+
+const RefreshPolicy REFRESH_POLICIES[] = {
+    {"weight_samples_1s", "1 second", 2, "2 seconds", "30 seconds"},
+    {"weight_samples_1m", "1 minute", 7, "1 minute", "5 minutes"},
+    {"weight_samples_1h", "1 hour", 30, "1 hour", "1 hour"},
+};
+
+std::string days(int n) {
+    return "INTERVAL '" + std::to_string(n) + " days'";
+}
+
+std::string quoted(const char* name) {
+    return std::string("'") + name + "'";
+}
+
+std::string aggregate_sql(const RefreshPolicy& policy) {
+    return std::string("CREATE MATERIALIZED VIEW IF NOT EXISTS ") + policy.view + " "
+        "WITH (timescaledb.continuous, timescaledb.materialized_only = false) AS "
+        "SELECT time_bucket(INTERVAL '" + policy.width + "', time) AS bucket, run_id, cycle, "
+        "count(*) AS n, "
+        "min(time) AS first_time, first(weight, time) AS first_w, "
+        "max(time) AS last_time, last(weight, time) AS last_w, "
+        "min(weight) AS min_w, first(time, weight) AS min_time, "
+        "max(weight) AS max_w, last(time, weight) AS max_time, "
+        "last(phase, time) AS phase, bool_and(is_stable) AS is_stable, last(trend, time) AS trend "
+        "FROM weight_samples GROUP BY bucket, run_id, cycle "
+        "WITH NO DATA";
+}
+
+bool run(pqxx::connection& conn, const std::string& sql, const char* what) {
+    try {
+        pqxx::nontransaction txn(conn);
+        txn.exec(sql);
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::warn("TimeseriesStorage: Failed to {}: {}", what, e.what());
+        return false;
+    }
+}
+
+void set_compression(pqxx::connection& conn, const char* table, int after_days) {
+    run(conn, std::string("SELECT remove_compression_policy(") + quoted(table) + ", if_exists => TRUE)",
+        "remove compression policy");
+    if (after_days > 0) {
+        run(conn, std::string("SELECT add_compression_policy(") + quoted(table) + ", " + days(after_days) + ")",
+            "add compression policy");
+    }
+}
+
+void set_retention(pqxx::connection& conn, const char* relation, int retention_days) {
+    run(conn, std::string("SELECT remove_retention_policy(") + quoted(relation) + ", if_exists => TRUE)",
+        "remove retention policy");
+    if (retention_days > 0) {
+        run(conn, std::string("SELECT add_retention_policy(") + quoted(relation) + ", " + days(retention_days) + ")",
+            "add retention policy");
+    }
+}
+
+} // namespace
+
+bool TimeseriesStorage::apply(pqxx::connection& conn, const Options& options) {
+    bool aggregates_ready = true;
+    const int aggregate_retention[] = {
+        options.aggregate_1s_retention_days,
+        options.aggregate_1m_retention_days,
+        options.aggregate_1h_retention_days,
+    };
+
+    int index = 0;
+    for (const auto& policy : REFRESH_POLICIES) {
+        const int retention = aggregate_retention[index++];
+        if (!run(conn, aggregate_sql(policy), "create continuous aggregate")) {
+            aggregates_ready = false;
+            continue;
+        }
+
+        int start_days = policy.start_offset_days;
+        if (options.weight_retention_days > 0) {
+            start_days = std::max(1, std::min(start_days, options.weight_retention_days - 1));
+        }
+        run(conn, std::string("SELECT remove_continuous_aggregate_policy(") + quoted(policy.view) +
+                      ", if_exists => TRUE)",
+            "remove refresh policy");
+        run(conn, std::string("SELECT add_continuous_aggregate_policy(") + quoted(policy.view) +
+                      ", start_offset => " + days(start_days) +
+                      ", end_offset => INTERVAL '" + policy.end_offset + "'" +
+                      ", schedule_interval => INTERVAL '" + policy.schedule + "')",
+            "add refresh policy");
+        set_retention(conn, policy.view, retention);
+    }
+
+    set_compression(conn, "sensor_readings", options.sensor_compress_after_days);
+    set_retention(conn, "sensor_readings", options.sensor_retention_days);
+    set_compression(conn, "weight_samples", options.weight_compress_after_days);
+    set_retention(conn, "weight_samples", options.weight_retention_days);
+
+    spdlog::info("TimeseriesStorage: Policies applied (sensor retention={}d, weight retention={}d, aggregates {})",
+                 options.sensor_retention_days, options.weight_retention_days,
+                 aggregates_ready ? "ready" : "unavailable");
+    return aggregates_ready;
+}
+
+std::span<const TimeseriesStorage::TierInfo> TimeseriesStorage::tiers() {
+    return TIERS;
+}
+
+const TimeseriesStorage::TierInfo& TimeseriesStorage::coarsest_for(int64_t bucket_us) {
+    const TierInfo* best = &TIERS[0];
+    for (const auto& tier : TIERS) {
+        if (tier.width_us <= bucket_us) best = &tier;
+    }
+    return *best;
+}
+
+} // namespace db
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <cstdint>
+#include <span>
+
+namespace db {
+
+/**
+ * @brief 时序表的连续聚合、压缩和保留策略 (由控制服务管理)
+ *
+ * apply() 幂等: 每次启动按配置创建缺失的连续聚合, 并用 remove + add 重新设置所有策略,
+ * 修改配置后重启即生效, 不需要手工改库. 树莓派存储有限, 原始数据按保留天数删除,
+ * 长期曲线由更粗的聚合提供.
+ *
+ * weight_samples 的三级连续聚合 (weight_samples_1s / _1m / _1h) 按 (bucket, run_id, cycle)
+ * 保存每桶的首/尾/最小/最大点, 与 TestRunRepository 的降采样候选点一致, 因此降采样查询可以
+ * 直接在聚合上分桶. 聚合开启实时模式 (materialized_only = false), 尚未物化的最新数据从原始表补齐.
+ *
+ * sensor_readings 的 channels 是 BYTEA, 不做数值聚合, 只管理压缩和保留.
+ */
+class TimeseriesStorage {
+public:
+    struct Options {
+        int sensor_compress_after_days = 7;     // 0 = 不压缩
+        int sensor_retention_days = 0;          // 0 = 永久保留
+        int weight_compress_after_days = 3;
+        int weight_retention_days = 30;
+        int aggregate_1s_retention_days = 30;
+        int aggregate_1m_retention_days = 365;
+        int aggregate_1h_retention_days = 0;
+    };
+
+    enum class Tier { Raw, Second, Minute, Hour };
+
+    struct TierInfo {
+        Tier tier;
+        const char* view;       // 连续聚合名, Raw 为 weight_samples
+        int64_t width_us;       // 桶宽, Raw 为 0
+    };
+
+    /**
+     * @brief 创建聚合并设置策略; 单步失败记录警告后继续
+     * @return 三级聚合均可用时返回 true (调用方据此决定是否启用聚合查询)
+     */
+    static bool apply(pqxx::connection& conn, const Options& options);
+
+    /** @brief 从细到粗的所有级别 (含 Raw) */
+    static std::span<const TierInfo> tiers();
+
+    /**
+     * @brief 桶宽不超过 bucket_us 的最粗级别 (查询该级别不会损失所需分辨率)
+     */
+    static const TierInfo& coarsest_for(int64_t bucket_us);
+};
+
+} // namespace db
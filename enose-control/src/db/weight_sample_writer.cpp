@@ -0,0 +1,177 @@
+#include "weight_sample_writer.hpp"
+#include "recording_journal.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+namespace db {
+
+namespace {
+constexpr auto RETRY_DELAY = std::chrono::seconds(1);
+constexpr int ACQUIRE_TIMEOUT_MS = 1000;
+}
+
+WeightSampleWriter::WeightSampleWriter(Options options)
+    : options_(std::move(options)) {}
+
+WeightSampleWriter::~WeightSampleWriter() {
+    stop();
+}
+
+void WeightSampleWriter::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_.joinable()) return;
+    stopping_ = false;
+    writer_ = std::thread(&WeightSampleWriter::writer_loop, this);
+    spdlog::info("WeightSampleWriter: Writer started (batch={}, interval={}ms)",
+                 options_.batch_rows, options_.flush_interval.count());
+}
+
+void WeightSampleWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!writer_.joinable()) return;
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    auto s = stats();
+    spdlog::info("WeightSampleWriter: Writer stopped (written={}, journaled={}, dropped={}, high_water={}, max_flush={}ms)",
+                 s.rows_written, s.rows_journaled, s.rows_dropped, s.queue_high_water, s.max_flush_ms);
+}
+
+void WeightSampleWriter::enqueue(WeightSampleRecord record) {
+    // 数据库不可达时直接落盘, 不在内存里积压
+    if (journal_ && !ConnectionPool::instance().is_healthy()) {
+        journal_->append(record);
+        ++rows_journaled_;
+        return;
+    }
+
+    bool notify = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= options_.queue_capacity) {
+            spill(queue_.front());
+            queue_.pop_front();
+        }
+        queue_.push_back(std::move(record));
+        queue_high_water_ = std::max(queue_high_water_, queue_.size());
+        if (queue_.size() >= options_.warn_queued && !backlog_warned_) {
+            backlog_warned_ = true;
+            spdlog::warn("WeightSampleWriter: {} samples queued, database is falling behind", queue_.size());
+        }
+        notify = queue_.size() >= options_.batch_rows;
+    }
+    if (notify) {
+        cv_.notify_one();
+    }
+}
+
+WeightSampleWriter::Stats WeightSampleWriter::stats() const {
+    Stats s;
+    s.rows_written = rows_written_;
+    s.rows_dropped = rows_dropped_;
+    s.flushes = flushes_;
+    s.write_errors = write_errors_;
+    s.rows_journaled = rows_journaled_;
+    s.last_flush_ms = last_flush_ms_;
+    s.max_flush_ms = max_flush_ms_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    s.queued = queue_.size();
+    s.queue_high_water = queue_high_water_;
+    return s;
+}
+
+void WeightSampleWriter::spill(const WeightSampleRecord& record) {
+    if (journal_) {
+        journal_->append(record);
+        ++rows_journaled_;
+    } else {
+        ++rows_dropped_;
+    }
+}
+
+void WeightSampleWriter::record_flush(std::chrono::steady_clock::duration elapsed) {
+    auto ms = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+    last_flush_ms_ = ms;
+    uint32_t prev = max_flush_ms_;
+    while (ms > prev && !max_flush_ms_.compare_exchange_weak(prev, ms)) {}
+}
+
+void WeightSampleWriter::writer_loop() {
+    // 专用连接: 写线程存续期间一直占用, 故障时归还并重新获取
+    std::optional<ConnectionPool::ConnectionGuard> conn;
+    std::vector<WeightSampleRecord> batch;
+    bool stopping = false;
+
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, options_.flush_interval, [this] {
+                return stopping_ || queue_.size() >= options_.batch_rows;
+            });
+            stopping = stopping_;
+            if (queue_.empty()) continue;
+
+            batch.assign(std::make_move_iterator(queue_.begin()),
+                         std::make_move_iterator(queue_.end()));
+            queue_.clear();
+        }
+
+        bool ok = false;
+        auto started = std::chrono::steady_clock::now();
+        try {
+            if (!conn || !conn->valid()) {
+                conn.emplace(ConnectionPool::instance().acquire(ACQUIRE_TIMEOUT_MS));
+            }
+            if (conn->valid()) {
+                pqxx::work txn(conn->get());
+                TestRunRepository::copy_weight_samples(txn, batch);
+                txn.commit();
+                ok = true;
+            }
+        } catch (const std::exception& e) {
+            spdlog::error("WeightSampleWriter: COPY failed: {}", e.what());
+            conn.reset();
+        }
+
+        if (ok) {
+            record_flush(std::chrono::steady_clock::now() - started);
+            rows_written_ += batch.size();
+            ++flushes_;
+            batch.clear();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.size() < options_.warn_queued) backlog_warned_ = false;
+            continue;
+        }
+
+        ++write_errors_;
+        if (stopping) {
+            spdlog::warn("WeightSampleWriter: {} {} samples on shutdown",
+                         journal_ ? "Journaling" : "Dropping", batch.size());
+            for (const auto& record : batch) {
+                spill(record);
+            }
+            break;
+        }
+
+        // 放回队首, 保留时间顺序; 超出容量的最旧行丢弃
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            if (queue_.size() >= options_.queue_capacity) {
+                for (; it != batch.rend(); ++it) {
+                    spill(*it);
+                }
+                break;
+            }
+            queue_.push_front(std::move(*it));
+        }
+        batch.clear();
+        cv_.wait_for(lock, RETRY_DELAY, [this] { return stopping_; });
+    }
+}
+
+} // namespace db
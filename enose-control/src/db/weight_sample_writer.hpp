@@ -0,0 +1,99 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include "test_run_repository.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+class RecordingJournal;
+
+/**
+ * @brief weight_samples 超表的异步写入器
+ *
+ * enqueue() 只在内存队列中追加, 测试线程记录样本时不再等待数据库往返;
+ * 独立写线程持有一条专用连接, 按条数或时间水位用 COPY (pqxx::stream_to) 批量写入.
+ * 队列满时丢弃最旧的记录并计数, 数据库故障期间保留队列内容并重试.
+ * 与 SensorReadingRepository 的写线程结构相同, 同样可设置 RecordingJournal
+ * 接收连接池 unhealthy 期间的样本和本应丢弃的样本.
+ */
+class WeightSampleWriter {
+public:
+    struct Options {
+        std::size_t queue_capacity = 10000;             // 内存队列上限 (行)
+        std::size_t batch_rows = 256;                   // 达到该行数立即写入
+        std::chrono::milliseconds flush_interval{500};  // 最长缓存时间
+        std::size_t warn_queued = 2000;                 // 积压超过该行数时告警 (每次越线一次)
+    };
+
+    /**
+     * @brief 写入统计; queued / queue_high_water / last_flush_ms 反映数据库跟不上的程度
+     */
+    struct Stats {
+        uint64_t rows_written = 0;
+        uint64_t rows_dropped = 0;
+        uint64_t flushes = 0;
+        uint64_t write_errors = 0;
+        uint64_t rows_journaled = 0;        // 改写入本地记录日志
+        std::size_t queued = 0;
+        std::size_t queue_high_water = 0;   // 启动以来的最大积压
+        uint32_t last_flush_ms = 0;         // 最近一次 COPY 耗时
+        uint32_t max_flush_ms = 0;
+    };
+
+    explicit WeightSampleWriter(Options options);
+    ~WeightSampleWriter();
+
+    /**
+     * @brief 数据库不可用时的落盘去处 (须在 start / enqueue 之前设置)
+     */
+    void set_journal(std::shared_ptr<RecordingJournal> journal) { journal_ = std::move(journal); }
+
+    void start();
+
+    /**
+     * @brief 写出队列中剩余的记录后停止写线程 (须在 ConnectionPool::shutdown 之前调用)
+     */
+    void stop();
+
+    /**
+     * @brief 追加一行, 不阻塞
+     */
+    void enqueue(WeightSampleRecord record);
+
+    Stats stats() const;
+
+private:
+    void writer_loop();
+    void record_flush(std::chrono::steady_clock::duration elapsed);
+    void spill(const WeightSampleRecord& record);
+
+    Options options_;
+    std::shared_ptr<RecordingJournal> journal_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<WeightSampleRecord> queue_;
+    std::size_t queue_high_water_{0};
+    bool backlog_warned_{false};
+    bool stopping_{false};
+    std::thread writer_;
+
+    std::atomic<uint64_t> rows_written_{0};
+    std::atomic<uint64_t> rows_dropped_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> write_errors_{0};
+    std::atomic<uint64_t> rows_journaled_{0};
+    std::atomic<uint32_t> last_flush_ms_{0};
+    std::atomic<uint32_t> max_flush_ms_{0};
+};
+
+} // namespace db
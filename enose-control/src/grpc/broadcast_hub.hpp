@@ -0,0 +1,340 @@
+#pragma once
+
+#include "core/latency_tracer.hpp"
+#include "core/metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace enose_grpc {
+
+/**
+ * @brief 订阅队列满时的处理策略
+ */
+enum class OverflowPolicy {
+    DROP_OLDEST,    // 丢弃最旧的一条, 保留最新数据
+    DECIMATE        // 队列内隔条抽稀, 降低时间分辨率但不留整段空洞
+};
+
+/**
+ * @brief 单个订阅者的统计
+ */
+struct SubscriberStats {
+    std::string client;
+    std::size_t queued = 0;
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+};
+
+/**
+ * @brief 有界的消息对象池
+ *
+ * acquire() 返回的 shared_ptr 最后一个引用释放时把消息放回池中 (池满或池已销毁则删除).
+ * 复用的 protobuf 消息保留字符串和 repeated 字段已分配的容量, 再次赋值时不逐字段分配.
+ * 可从任意线程调用.
+ */
+template<typename T>
+class MessagePool {
+public:
+    explicit MessagePool(std::size_t capacity = 256)
+        : state_(std::make_shared<State>()) {
+        state_->capacity = capacity;
+    }
+
+    std::shared_ptr<T> acquire() {
+        std::unique_ptr<T> msg;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (!state_->idle.empty()) {
+                msg = std::move(state_->idle.back());
+                state_->idle.pop_back();
+            }
+        }
+        if (!msg) msg = std::make_unique<T>();
+        return std::shared_ptr<T>(msg.release(), Recycler{state_});
+    }
+
+    std::size_t idle() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->idle.size();
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<T>> idle;
+        std::size_t capacity = 0;
+    };
+
+    struct Recycler {
+        std::weak_ptr<State> state;     // 在途消息可以晚于池释放
+        void operator()(T* msg) const {
+            std::unique_ptr<T> owned(msg);
+            if (auto s = state.lock()) {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                if (s->idle.size() < s->capacity) s->idle.push_back(std::move(owned));
+            }
+        }
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+/**
+ * @brief 一对多广播: 每个订阅者独立的有界队列
+ *
+ * publish() 把每条消息复制一次到池中的对象, 以 shared_ptr<const T> 入队给所有订阅者
+ * (订阅者之间共享, 不再各复制一份), 从不阻塞在网络写上, 可在 io 线程调用;
+ * 入队后调用订阅者的 notify 回调, 由其 (通常是 HubWriteReactor) 取走并直接从共享对象写出,
+ * 最后一个订阅者写完后对象回到池中. 慢客户端只会丢自己的数据.
+ *
+ * 每条消息可附带来源时间戳 (publish 的 origin_ns); 设置了 set_latency_stage() 的 hub
+ * 在写出完成时 (Subscription::record_delivery) 把 origin 至今的耗时记入该阶段的直方图
+ */
+template<typename T>
+class BroadcastHub {
+public:
+    class Subscription {
+    public:
+        Subscription(std::string client, std::size_t capacity, OverflowPolicy policy,
+                     std::optional<core::LatencyStage> stage = std::nullopt)
+            : client_(std::move(client))
+            , capacity_(std::max<std::size_t>(capacity, 2))
+            , policy_(policy)
+            , stage_(stage) {}
+
+        /**
+         * @brief 非阻塞取出一条
+         * @return false 表示队列为空
+         */
+        bool try_pop(T& out) {
+            uint64_t origin_ns;
+            return try_pop(out, origin_ns);
+        }
+
+        bool try_pop(T& out, uint64_t& origin_ns) {
+            std::shared_ptr<const T> item;
+            if (!try_pop(item, origin_ns)) return false;
+            out = *item;
+            return true;
+        }
+
+        /**
+         * @brief 取出共享的消息 (不复制); 写出期间须持有该指针
+         */
+        bool try_pop(std::shared_ptr<const T>& out, uint64_t& origin_ns) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty()) return false;
+            out = std::move(queue_.front().item);
+            origin_ns = queue_.front().origin_ns;
+            queue_.pop_front();
+            ++delivered_;
+            return true;
+        }
+
+        /**
+         * @brief 一条消息已写出 (由写出方在写完成时调用)
+         */
+        void record_delivery(uint64_t origin_ns) const {
+            if (stage_) {
+                core::LatencyTracer::instance().record_since(*stage_, origin_ns);
+            }
+        }
+
+        /**
+         * @brief 设置有新数据或被关闭时的回调
+         *
+         * 在 publish() 线程上调用, 持有 hub 锁但不持有本订阅的锁;
+         * 须在 attach() 之前设置, unsubscribe() 返回后不会再被调用
+         */
+        void set_notify(std::function<void()> notify) {
+            notify_ = std::move(notify);
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+            }
+            if (notify_) notify_();
+        }
+
+        bool closed() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return closed_;
+        }
+
+        SubscriberStats stats() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return {client_, queue_.size(), delivered_, dropped_};
+        }
+
+        const std::string& client() const { return client_; }
+
+    private:
+        friend class BroadcastHub;
+
+        struct Entry {
+            std::shared_ptr<const T> item;
+            uint64_t origin_ns;
+        };
+
+        void push(std::span<const std::shared_ptr<const T>> items, uint64_t origin_ns) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (closed_) return;
+                for (const auto& item : items) {
+                    if (queue_.size() >= capacity_) {
+                        make_room();
+                    }
+                    queue_.push_back(Entry{item, origin_ns});
+                }
+            }
+            if (notify_) notify_();
+        }
+
+        void make_room() {
+            if (policy_ == OverflowPolicy::DROP_OLDEST) {
+                queue_.pop_front();
+                ++dropped_;
+                return;
+            }
+            // 保留偶数位, 队列减半
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < queue_.size(); i += 2) {
+                queue_[kept++] = std::move(queue_[i]);
+            }
+            dropped_ += queue_.size() - kept;
+            queue_.resize(kept);
+        }
+
+        std::string client_;
+        std::size_t capacity_;
+        OverflowPolicy policy_;
+        std::optional<core::LatencyStage> stage_;
+
+        mutable std::mutex mutex_;
+        std::function<void()> notify_;
+        std::deque<Entry> queue_;
+        bool closed_ = false;
+        uint64_t delivered_ = 0;
+        uint64_t dropped_ = 0;
+    };
+
+    using SubscriptionPtr = std::shared_ptr<Subscription>;
+
+    BroadcastHub(std::size_t capacity = 1024, OverflowPolicy policy = OverflowPolicy::DROP_OLDEST)
+        : capacity_(capacity), policy_(policy), pool_(capacity) {}
+
+    /**
+     * @brief 写出完成时记录延迟的阶段 (须在第一个订阅之前设置)
+     */
+    void set_latency_stage(core::LatencyStage stage) { stage_ = stage; }
+
+    /**
+     * @brief 创建订阅但暂不接收数据, 便于先设置 notify 再 attach()
+     */
+    SubscriptionPtr make_subscription(const std::string& client) const {
+        return std::make_shared<Subscription>(client, capacity_, policy_, stage_);
+    }
+
+    void attach(const SubscriptionPtr& sub) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.push_back(sub);
+    }
+
+    SubscriptionPtr subscribe(const std::string& client) {
+        auto sub = make_subscription(client);
+        attach(sub);
+        return sub;
+    }
+
+    void unsubscribe(const SubscriptionPtr& sub) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.erase(std::remove(subscribers_.begin(), subscribers_.end(), sub),
+                           subscribers_.end());
+    }
+
+    /**
+     * @param origin_ns 这批消息的来源时间 (core::mono_ns), 0 = 不统计延迟
+     */
+    void publish(std::span<const T> items, uint64_t origin_ns = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (subscribers_.empty() || items.empty()) return;
+        staged_.clear();
+        for (const auto& item : items) {
+            auto msg = pool_.acquire();
+            *msg = item;
+            staged_.push_back(std::move(msg));
+        }
+        for (auto& sub : subscribers_) {
+            sub->push(staged_, origin_ns);
+        }
+        staged_.clear();
+    }
+
+    void publish(const T& item, uint64_t origin_ns = 0) {
+        publish(std::span<const T>(&item, 1), origin_ns);
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscribers_.empty();
+    }
+
+    std::vector<SubscriberStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<SubscriberStats> out;
+        out.reserve(subscribers_.size());
+        for (const auto& sub : subscribers_) {
+            out.push_back(sub->stats());
+        }
+        return out;
+    }
+
+    /**
+     * @brief 关闭所有订阅 (服务停止时让各流结束)
+     */
+    void close_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& sub : subscribers_) {
+            sub->close();
+        }
+    }
+
+private:
+    std::size_t capacity_;
+    OverflowPolicy policy_;
+    std::optional<core::LatencyStage> stage_;
+    mutable std::mutex mutex_;
+    std::vector<SubscriptionPtr> subscribers_;
+    MessagePool<T> pool_;
+    std::vector<std::shared_ptr<const T>> staged_;     // publish() 的暂存, 保留容量
+};
+
+/**
+ * @brief 导出一个流当前订阅者的积压和丢弃, 按流名汇总 (不按客户端展开, 避免标签随连接增长)
+ */
+inline void write_subscriber_metrics(core::MetricWriter& writer, const std::string& stream,
+                                     const std::vector<SubscriberStats>& subscribers) {
+    std::size_t queued = 0;
+    uint64_t dropped = 0;
+    for (const auto& sub : subscribers) {
+        queued += sub.queued;
+        dropped += sub.dropped;
+    }
+    writer.gauge("grpc_stream_queued_messages", "Messages queued for connected stream subscribers",
+                 static_cast<double>(queued), {{"stream", stream}});
+    writer.gauge("grpc_stream_dropped_messages", "Messages dropped on overflow for connected stream subscribers",
+                 static_cast<double>(dropped), {{"stream", stream}});
+}
+
+} // namespace enose_grpc
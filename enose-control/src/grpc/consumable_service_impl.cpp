@@ -4,7 +4,8 @@
 
 namespace grpc_service {
 
-ConsumableServiceImpl::ConsumableServiceImpl() {
+ConsumableServiceImpl::ConsumableServiceImpl(std::shared_ptr<db::ConsumableCache> cache)
+    : cache_(std::move(cache)) {
     spdlog::info("ConsumableService 初始化完成");
 }
 
@@ -26,7 +27,32 @@ void ConsumableServiceImpl::fill_liquid(consumable::Liquid* proto, const db::Liq
         std::chrono::system_clock::to_time_t(record.updated_at));
 }
 
-void ConsumableServiceImpl::fill_consumable(consumable::Consumable* proto, const db::ConsumableRecord& record) {
+void ConsumableServiceImpl::fill_pump_assignment(consumable::PumpAssignment* proto,
+                                                 const db::PumpAssignmentRecord& stored,
+                                                 const db::ConsumableCache::Snapshot& snapshot) {
+    // 实验中的消耗先记入账本, 叠加后才是实时余量
+    const auto record = cache_->with_unflushed(stored);
+    proto->set_pump_index(record.pump_index);
+    if (record.liquid_id) {
+        proto->set_liquid_id(*record.liquid_id);
+        // 液体详情
+        if (const auto* liquid = snapshot.find_liquid(*record.liquid_id)) {
+            fill_liquid(proto->mutable_liquid(), *liquid);
+        }
+    }
+    proto->set_notes(record.notes);
+    *proto->mutable_updated_at() = google::protobuf::util::TimeUtil::TimeTToTimestamp(
+        std::chrono::system_clock::to_time_t(record.updated_at));
+    // 容量相关字段
+    proto->set_initial_volume_ml(record.initial_volume_ml);
+    proto->set_consumed_volume_ml(record.consumed_volume_ml);
+    proto->set_remaining_volume_ml(record.remaining_volume_ml());
+    proto->set_low_volume_threshold_ml(record.low_volume_threshold_ml);
+    proto->set_is_low_volume(record.is_low_volume());
+}
+
+void ConsumableServiceImpl::fill_consumable(consumable::Consumable* proto, const db::ConsumableRecord& stored) {
+    const auto record = cache_->with_unflushed(stored);
     proto->set_id(record.id);
     proto->set_name(record.name);
     
@@ -134,7 +160,8 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         type_filter = liquid_type_to_string(request->type_filter());
     }
     
-    auto records = repo_.list_liquids(
+    auto snapshot = cache_->snapshot();
+    auto records = snapshot->list_liquids(
         type_filter,
         request->include_inactive(),
         request->limit() > 0 ? request->limit() : 100,
@@ -144,7 +171,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         fill_liquid(response->add_liquids(), record);
     }
     
-    response->set_total_count(repo_.count_liquids(type_filter, request->include_inactive()));
+    response->set_total_count(snapshot->count_liquids(type_filter, request->include_inactive()));
     
     return ::grpc::Status::OK;
 }
@@ -154,7 +181,8 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::GetLiquidRequest* request,
     consumable::Liquid* response) {
     
-    auto record = repo_.get_liquid(request->id());
+    auto snapshot = cache_->snapshot();
+    const auto* record = snapshot->find_liquid(request->id());
     if (!record) {
         return ::grpc::Status(::grpc::NOT_FOUND, "Liquid not found");
     }
@@ -168,7 +196,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::CreateLiquidRequest* request,
     consumable::Liquid* response) {
     
-    auto id = repo_.create_liquid(
+    auto id = cache_->create_liquid(
         request->name(),
         liquid_type_to_string(request->type()),
         request->description(),
@@ -179,8 +207,8 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         return ::grpc::Status(::grpc::INTERNAL, "Failed to create liquid");
     }
     
-    auto record = repo_.get_liquid(*id);
-    if (record) {
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_liquid(*id)) {
         fill_liquid(response, *record);
     }
     
@@ -192,7 +220,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::UpdateLiquidRequest* request,
     consumable::Liquid* response) {
     
-    bool success = repo_.update_liquid(
+    bool success = cache_->update_liquid(
         request->id(),
         request->name(),
         liquid_type_to_string(request->type()),
@@ -205,8 +233,8 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         return ::grpc::Status(::grpc::INTERNAL, "Failed to update liquid");
     }
     
-    auto record = repo_.get_liquid(request->id());
-    if (record) {
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_liquid(request->id())) {
         fill_liquid(response, *record);
     }
     
@@ -218,7 +246,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::DeleteLiquidRequest* request,
     ::google::protobuf::Empty* response) {
     
-    bool success = repo_.delete_liquid(request->id());
+    bool success = cache_->delete_liquid(request->id());
     if (!success) {
         return ::grpc::Status(::grpc::INTERNAL, "Failed to delete liquid");
     }
@@ -235,28 +263,9 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const ::google::protobuf::Empty* request,
     consumable::PumpAssignmentsResponse* response) {
     
-    auto assignments = repo_.get_pump_assignments();
-    
-    for (const auto& a : assignments) {
-        auto* pa = response->add_assignments();
-        pa->set_pump_index(a.pump_index);
-        if (a.liquid_id) {
-            pa->set_liquid_id(*a.liquid_id);
-            // 获取液体详情
-            auto liquid = repo_.get_liquid(*a.liquid_id);
-            if (liquid) {
-                fill_liquid(pa->mutable_liquid(), *liquid);
-            }
-        }
-        pa->set_notes(a.notes);
-        *pa->mutable_updated_at() = google::protobuf::util::TimeUtil::TimeTToTimestamp(
-            std::chrono::system_clock::to_time_t(a.updated_at));
-        // 容量相关字段
-        pa->set_initial_volume_ml(a.initial_volume_ml);
-        pa->set_consumed_volume_ml(a.consumed_volume_ml);
-        pa->set_remaining_volume_ml(a.remaining_volume_ml());
-        pa->set_low_volume_threshold_ml(a.low_volume_threshold_ml);
-        pa->set_is_low_volume(a.is_low_volume());
+    auto snapshot = cache_->snapshot();
+    for (const auto& a : snapshot->catalog.pump_assignments) {
+        fill_pump_assignment(response->add_assignments(), a, *snapshot);
     }
     
     return ::grpc::Status::OK;
@@ -281,7 +290,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         low_volume_threshold_ml = request->low_volume_threshold_ml();
     }
     
-    bool success = repo_.set_pump_assignment(
+    bool success = cache_->set_pump_assignment(
         request->pump_index(),
         liquid_id,
         request->notes(),
@@ -292,23 +301,10 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         return ::grpc::Status(::grpc::INTERNAL, "Failed to set pump assignment");
     }
     
-    // 返回更新后的配置
-    auto record = repo_.get_pump_assignment(request->pump_index());
-    if (record) {
-        response->set_pump_index(record->pump_index);
-        if (record->liquid_id) {
-            response->set_liquid_id(*record->liquid_id);
-            auto liquid = repo_.get_liquid(*record->liquid_id);
-            if (liquid) {
-                fill_liquid(response->mutable_liquid(), *liquid);
-            }
-        }
-        response->set_notes(record->notes);
-        response->set_initial_volume_ml(record->initial_volume_ml);
-        response->set_consumed_volume_ml(record->consumed_volume_ml);
-        response->set_remaining_volume_ml(record->remaining_volume_ml());
-        response->set_low_volume_threshold_ml(record->low_volume_threshold_ml);
-        response->set_is_low_volume(record->is_low_volume());
+    // 返回更新后的配置 (写入已使缓存失效, 这里读到的是新快照)
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_pump_assignment(request->pump_index())) {
+        fill_pump_assignment(response, *record, *snapshot);
     }
     
     return ::grpc::Status::OK;
@@ -324,7 +320,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         threshold = request->low_volume_threshold_ml();
     }
     
-    bool success = repo_.set_pump_volume(
+    bool success = cache_->set_pump_volume(
         request->pump_index(),
         request->initial_volume_ml(),
         threshold,
@@ -334,23 +330,10 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         return ::grpc::Status(::grpc::INTERNAL, "Failed to set pump volume");
     }
     
-    // 返回更新后的配置
-    auto record = repo_.get_pump_assignment(request->pump_index());
-    if (record) {
-        response->set_pump_index(record->pump_index);
-        if (record->liquid_id) {
-            response->set_liquid_id(*record->liquid_id);
-            auto liquid = repo_.get_liquid(*record->liquid_id);
-            if (liquid) {
-                fill_liquid(response->mutable_liquid(), *liquid);
-            }
-        }
-        response->set_notes(record->notes);
-        response->set_initial_volume_ml(record->initial_volume_ml);
-        response->set_consumed_volume_ml(record->consumed_volume_ml);
-        response->set_remaining_volume_ml(record->remaining_volume_ml());
-        response->set_low_volume_threshold_ml(record->low_volume_threshold_ml);
-        response->set_is_low_volume(record->is_low_volume());
+    // 返回更新后的配置 (写入已使缓存失效, 这里读到的是新快照)
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_pump_assignment(request->pump_index())) {
+        fill_pump_assignment(response, *record, *snapshot);
     }
     
     return ::grpc::Status::OK;
@@ -366,7 +349,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         experiment_id = request->experiment_id();
     }
     
-    bool success = repo_.add_pump_consumption(
+    bool success = cache_->add_pump_consumption(
         request->pump_index(),
         request->volume_ml(),
         experiment_id);
@@ -375,23 +358,10 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
         return ::grpc::Status(::grpc::INTERNAL, "Failed to add pump consumption");
     }
     
-    // 返回更新后的配置
-    auto record = repo_.get_pump_assignment(request->pump_index());
-    if (record) {
-        response->set_pump_index(record->pump_index);
-        if (record->liquid_id) {
-            response->set_liquid_id(*record->liquid_id);
-            auto liquid = repo_.get_liquid(*record->liquid_id);
-            if (liquid) {
-                fill_liquid(response->mutable_liquid(), *liquid);
-            }
-        }
-        response->set_notes(record->notes);
-        response->set_initial_volume_ml(record->initial_volume_ml);
-        response->set_consumed_volume_ml(record->consumed_volume_ml);
-        response->set_remaining_volume_ml(record->remaining_volume_ml());
-        response->set_low_volume_threshold_ml(record->low_volume_threshold_ml);
-        response->set_is_low_volume(record->is_low_volume());
+    // 返回更新后的配置 (写入已使缓存失效, 这里读到的是新快照)
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_pump_assignment(request->pump_index())) {
+        fill_pump_assignment(response, *record, *snapshot);
     }
     
     return ::grpc::Status::OK;
@@ -406,12 +376,12 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const ::google::protobuf::Empty* request,
     consumable::ConsumableStatusResponse* response) {
     
-    auto consumables = repo_.get_all_consumables();
+    auto snapshot = cache_->snapshot();
     
     int warning_count = 0;
     int critical_count = 0;
     
-    for (const auto& c : consumables) {
+    for (const auto& c : snapshot->catalog.consumables) {
         fill_consumable(response->add_consumables(), c);
         
         int status = c.status();
@@ -430,13 +400,13 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::ResetConsumableRequest* request,
     consumable::Consumable* response) {
     
-    bool success = repo_.reset_consumable(request->consumable_id(), request->notes());
+    bool success = cache_->reset_consumable(request->consumable_id(), request->notes());
     if (!success) {
         return ::grpc::Status(::grpc::INTERNAL, "Failed to reset consumable");
     }
     
-    auto record = repo_.get_consumable(request->consumable_id());
-    if (record) {
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_consumable(request->consumable_id())) {
         fill_consumable(response, *record);
     }
     
@@ -448,13 +418,13 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::UpdateLifetimeRequest* request,
     consumable::Consumable* response) {
     
-    bool success = repo_.update_lifetime(request->consumable_id(), request->lifetime_seconds());
+    bool success = cache_->update_lifetime(request->consumable_id(), request->lifetime_seconds());
     if (!success) {
         return ::grpc::Status(::grpc::INTERNAL, "Failed to update consumable lifetime");
     }
     
-    auto record = repo_.get_consumable(request->consumable_id());
-    if (record) {
+    auto snapshot = cache_->snapshot();
+    if (const auto* record = snapshot->find_consumable(request->consumable_id())) {
         fill_consumable(response, *record);
     }
     
@@ -470,7 +440,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::ListMetadataFieldsRequest* request,
     consumable::MetadataFieldListResponse* response) {
     
-    auto fields = repo_.list_metadata_fields(
+    auto fields = cache_->repository().list_metadata_fields(
         request->entity_type(),
         request->include_inactive());
     
@@ -486,7 +456,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::CreateMetadataFieldRequest* request,
     consumable::MetadataField* response) {
     
-    auto id = repo_.create_metadata_field(
+    auto id = cache_->repository().create_metadata_field(
         request->entity_type(),
         request->field_key(),
         request->field_name(),
@@ -502,7 +472,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     }
     
     // 读取并返回创建的字段
-    auto fields = repo_.list_metadata_fields(request->entity_type(), true);
+    auto fields = cache_->repository().list_metadata_fields(request->entity_type(), true);
     for (const auto& f : fields) {
         if (f.id == *id) {
             fill_metadata_field(response, f);
@@ -518,7 +488,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::UpdateMetadataFieldRequest* request,
     consumable::MetadataField* response) {
     
-    bool success = repo_.update_metadata_field(
+    bool success = cache_->repository().update_metadata_field(
         request->id(),
         request->field_name(),
         request->description(),
@@ -540,7 +510,7 @@ std::string ConsumableServiceImpl::field_type_to_string(consumable::FieldType ty
     const consumable::DeleteMetadataFieldRequest* request,
     ::google::protobuf::Empty* response) {
     
-    bool success = repo_.delete_metadata_field(request->id());
+    bool success = cache_->repository().delete_metadata_field(request->id());
     if (!success) {
         return ::grpc::Status(::grpc::INTERNAL, "Failed to delete metadata field");
     }
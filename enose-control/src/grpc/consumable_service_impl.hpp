@@ -2,7 +2,7 @@
 
 #include <grpcpp/grpcpp.h>
 #include "enose_consumable.grpc.pb.h"
-#include "../db/consumable_repository.hpp"
+#include "../db/consumable_cache.hpp"
 #include <memory>
 
 namespace grpc_service {
@@ -11,7 +11,7 @@ namespace consumable = ::enose::consumable;
 
 class ConsumableServiceImpl final : public consumable::ConsumableService::Service {
 public:
-    ConsumableServiceImpl();
+    explicit ConsumableServiceImpl(std::shared_ptr<db::ConsumableCache> cache);
     ~ConsumableServiceImpl() = default;
 
     // 液体管理
@@ -99,10 +99,13 @@ public:
         ::google::protobuf::Empty* response) override;
 
 private:
-    db::ConsumableRepository repo_;
+    // 读取走缓存快照, 写入经缓存转发 (元数据字段直接访问仓库)
+    std::shared_ptr<db::ConsumableCache> cache_;
     
     // 辅助方法
     void fill_liquid(consumable::Liquid* proto, const db::LiquidRecord& record);
+    void fill_pump_assignment(consumable::PumpAssignment* proto, const db::PumpAssignmentRecord& record,
+                              const db::ConsumableCache::Snapshot& snapshot);
     void fill_consumable(consumable::Consumable* proto, const db::ConsumableRecord& record);
     void fill_metadata_field(consumable::MetadataField* proto, const db::MetadataFieldRecord& record);
     consumable::LiquidType string_to_liquid_type(const std::string& type);
@@ -1,28 +1,134 @@
 #include "grpc/control_service_impl.hpp"
 #include "hal/actuator_driver.hpp"
 #include "hal/load_cell_driver.hpp"
+#include "hal/klipper_dispenser.hpp"
+#include "core/health.hpp"
+#include "core/latency_tracer.hpp"
+#include <google/protobuf/util/time_util.h>
+#include <google/protobuf/util/field_mask_util.h>
+#include <algorithm>
+#include <future>
 #include <spdlog/spdlog.h>
 #include <format>
 
 namespace enose_grpc {
 
+namespace {
+
+// PeripheralStatus 字段名 (FieldMask 路径) 与 PeripheralState 成员的对应关系
+constexpr std::pair<const char*, float workflows::PeripheralState::*> FLOAT_FIELDS[] = {
+    {"valve_waste", &workflows::PeripheralState::valve_waste},
+    {"valve_pinch", &workflows::PeripheralState::valve_pinch},
+    {"valve_air", &workflows::PeripheralState::valve_air},
+    {"valve_outlet", &workflows::PeripheralState::valve_outlet},
+    {"air_pump_pwm", &workflows::PeripheralState::air_pump_pwm},
+    {"cleaning_pump", &workflows::PeripheralState::cleaning_pump},
+    {"heater_chamber", &workflows::PeripheralState::heater_chamber},
+};
+
+constexpr std::pair<const char*, workflows::PumpState workflows::PeripheralState::*> PUMP_FIELDS[] = {
+    {"pump_0", &workflows::PeripheralState::pump_0},
+    {"pump_1", &workflows::PeripheralState::pump_1},
+    {"pump_2", &workflows::PeripheralState::pump_2},
+    {"pump_3", &workflows::PeripheralState::pump_3},
+    {"pump_4", &workflows::PeripheralState::pump_4},
+    {"pump_5", &workflows::PeripheralState::pump_5},
+    {"pump_6", &workflows::PeripheralState::pump_6},
+    {"pump_7", &workflows::PeripheralState::pump_7},
+};
+
+void collect_changed_fields(const workflows::PeripheralState& prev,
+                            const workflows::PeripheralState& cur,
+                            google::protobuf::FieldMask* mask) {
+    for (const auto& [name, member] : FLOAT_FIELDS) {
+        if (prev.*member != cur.*member) mask->add_paths(name);
+    }
+    for (const auto& [name, member] : PUMP_FIELDS) {
+        if (prev.*member != cur.*member) mask->add_paths(name);
+    }
+}
+
+} // namespace
+
 ControlServiceImpl::ControlServiceImpl(
     std::shared_ptr<hal::ActuatorDriver> actuator,
     std::shared_ptr<workflows::SystemState> system_state,
-    std::shared_ptr<hal::LoadCellDriver> load_cell
+    std::shared_ptr<hal::LoadCellDriver> load_cell,
+    std::shared_ptr<SystemEventBus> events
 ) : actuator_(std::move(actuator))
   , system_state_(std::move(system_state))
-  , load_cell_(std::move(load_cell)) {}
+  , load_cell_(std::move(load_cell))
+  , events_(events ? std::move(events) : std::make_shared<SystemEventBus>()) {
+
+    event_connections_.emplace_back(actuator_->on_connection_changed.connect([this](bool connected) {
+        publish_system_event(*events_, ::enose::data::Event::DEVICE_STATUS,
+            connected ? ::enose::data::Event::INFO : ::enose::data::Event::WARNING,
+            connected ? "Moonraker connected" : "Moonraker disconnected",
+            {{"device", "moonraker"}, {"connected", connected ? "true" : "false"}});
+    }));
+    if (load_cell_) {
+        event_connections_.emplace_back(load_cell_->on_overflow_warning.connect([this]() {
+            publish_system_event(*events_, ::enose::data::Event::DEVICE_STATUS,
+                ::enose::data::Event::WARNING, "Waste bottle overflow warning",
+                {{"device", "load_cell"}});
+        }));
+    }
+    
+    // 定量进度转为系统事件: 状态变化时, 以及每前进目标的 10%; 结束时按结果定级
+    dispenser_ = std::make_shared<hal::KlipperDispenser>(actuator_, load_cell_);
+    event_connections_.emplace_back(dispenser_->on_progress.connect(
+        [this, last = hal::DispenseStatus{}](const hal::DispenseStatus& status) mutable {
+        if (status.state == hal::DispenseStatus::State::IDLE) return;
+        const bool step = status.dispensed_g - last.dispensed_g >= status.target_g * 0.1f;
+        if (status.id == last.id && status.state == last.state && !step) return;
+        last = status;
+        
+        auto severity = ::enose::data::Event::INFO;
+        if (status.state == hal::DispenseStatus::State::FAILED) {
+            severity = ::enose::data::Event::ERROR;
+        } else if (status.state == hal::DispenseStatus::State::CANCELLED) {
+            severity = ::enose::data::Event::WARNING;
+        }
+        publish_system_event(*events_, ::enose::data::Event::DEVICE_STATUS, severity,
+            status.finished() ? "Dispense " + std::string(hal::dispense_state_name(status.state)) : "Dispense progress",
+            {{"device", "dispenser"},
+             {"state", hal::dispense_state_name(status.state)},
+             {"id", std::to_string(status.id)},
+             {"pump", status.pump},
+             {"target_g", std::format("{:.2f}", status.target_g)},
+             {"dispensed_g", std::format("{:.2f}", status.dispensed_g)},
+             {"speed", std::format("{:.2f}", status.speed)},
+             {"message", status.message}});
+    }));
+    dispenser_->start();
+}
 
 ::grpc::Status ControlServiceImpl::GetStatus(
     ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
+    const ::enose::service::GetStatusRequest* request,
     ::enose::service::SystemStatus* response
 ) {
     spdlog::debug("gRPC: GetStatus called");
     
+    // 读取已发布的快照, 不等待进行中的切换; 长轮询时等到版本号超过客户端已见的值
+    auto snapshot = system_state_->snapshot();
+    if (request->after_version() > 0 && snapshot->version <= request->after_version()) {
+        const auto timeout = request->wait_timeout_ms() > 0
+            ? std::min(std::chrono::milliseconds(request->wait_timeout_ms()), STATUS_WAIT_MAX)
+            : STATUS_WAIT_DEFAULT;
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (snapshot->version <= request->after_version() && !context->IsCancelled()) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            if (remaining <= std::chrono::milliseconds::zero()) break;
+            snapshot = system_state_->wait_for_change(request->after_version(),
+                                                      std::min(remaining, STATUS_POLL_SLICE));
+        }
+    }
+    response->set_state_version(snapshot->version);
+    
     // 设置当前状态
-    auto state = system_state_->get_state();
+    auto state = snapshot->data.state;
     switch (state) {
         case workflows::SystemState::State::INITIAL:
             response->set_current_state(::enose::service::INITIAL);
@@ -44,10 +150,13 @@ ControlServiceImpl::ControlServiceImpl(
     }
     
     // 填充外设状态
-    fill_peripheral_status(response->mutable_peripheral_status());
+    fill_peripheral_status(response->mutable_peripheral_status(), snapshot->data.peripheral);
     
     // 设置连接状态
-    response->set_moonraker_connected(true);
+    auto link = actuator_->link_stats();
+    response->set_moonraker_connected(link.connected);
+    response->set_moonraker_reconnects(link.reconnects);
+    response->set_moonraker_reconnect_latency_ms(link.last_reconnect_latency_ms);
     response->set_sensor_connected(true);
     response->set_firmware_ready(actuator_->is_firmware_ready());
     
@@ -186,43 +295,54 @@ ControlServiceImpl::ControlServiceImpl(
     return ::grpc::Status::OK;
 }
 
-::grpc::Status ControlServiceImpl::SubscribeEvents(
-    ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
-    ::grpc::ServerWriter<::enose::data::Event>* writer
+::grpc::ServerWriteReactor<::enose::data::Event>* ControlServiceImpl::SubscribeEvents(
+    ::grpc::CallbackServerContext* context,
+    const ::enose::service::SubscribeEventsRequest* request
 ) {
-    spdlog::info("gRPC: SubscribeEvents - client connected");
-    
-    // 简化实现: 保持连接直到客户端断开
-    while (!context->IsCancelled()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-    
-    spdlog::info("gRPC: SubscribeEvents - client disconnected");
-    return ::grpc::Status::OK;
+    apply_stream_compression(context);
+    return new BusWriteReactor<::enose::data::Event>(
+        *events_, context->peer(), "SubscribeEvents", request->resume_after_seq());
 }
 
-::grpc::Status ControlServiceImpl::SubscribePeripheralStatus(
-    ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
-    ::grpc::ServerWriter<::enose::service::PeripheralStatus>* writer
+::grpc::ServerWriteReactor<::enose::service::PeripheralStatus>* ControlServiceImpl::SubscribePeripheralStatus(
+    ::grpc::CallbackServerContext* context,
+    const ::enose::service::SubscribePeripheralStatusRequest* request
 ) {
-    spdlog::info("gRPC: SubscribePeripheralStatus - client connected");
-    
-    // 定期发送状态更新
-    while (!context->IsCancelled()) {
-        ::enose::service::PeripheralStatus status;
-        fill_peripheral_status(&status);
-        
-        if (!writer->Write(status)) {
-            break;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    }
-    
-    spdlog::info("gRPC: SubscribePeripheralStatus - client disconnected");
-    return ::grpc::Status::OK;
+    apply_stream_compression(context);
+    auto keepalive = request->keepalive_ms() > 0
+        ? std::max(std::chrono::milliseconds(request->keepalive_ms()), PERIPHERAL_STATUS_MIN_KEEPALIVE)
+        : PERIPHERAL_STATUS_KEEPALIVE;
+    
+    // 每个流记住上次发出的状态: 只在确有变化时发送, delta 模式下只带变化的字段
+    struct StreamState {
+        bool delta;
+        bool sent = false;
+        workflows::PeripheralState last{};
+    };
+    auto stream = std::make_shared<StreamState>(StreamState{request->delta()});
+    
+    return new ChangeWriteReactor<::enose::service::PeripheralStatus>(
+        [system_state = system_state_](std::function<void()> notify) {
+            return system_state->on_peripheral_state_changed.connect(
+                [notify = std::move(notify)](const workflows::PeripheralState&) { notify(); });
+        },
+        [this, stream](::enose::service::PeripheralStatus* status, bool full) {
+            workflows::PeripheralState current = system_state_->get_peripheral_state();
+            if (!full && stream->sent && current == stream->last) return false;
+            
+            status->Clear();
+            fill_peripheral_status(status, current);
+            if (!full && stream->delta) {
+                google::protobuf::FieldMask mask;
+                collect_changed_fields(stream->last, current, &mask);
+                google::protobuf::util::FieldMaskUtil::TrimMessage(mask, status);
+                *status->mutable_changed_fields() = std::move(mask);
+            }
+            stream->last = current;
+            stream->sent = true;
+            return true;
+        },
+        keepalive, context->peer(), "SubscribePeripheralStatus");
 }
 
 ::grpc::Status ControlServiceImpl::StartInjection(
@@ -256,6 +376,13 @@ ControlServiceImpl::ControlServiceImpl(
         params.accel = request->accel();
     }
     
+    // 按 mm 指定的单泵进样同样参与在线泵标定
+    if (load_cell_) {
+        load_cell_->observe_injection({params.pump_0_volume, params.pump_1_volume,
+                                       params.pump_2_volume, params.pump_3_volume,
+                                       params.pump_4_volume, params.pump_5_volume,
+                                       params.pump_6_volume, params.pump_7_volume});
+    }
     system_state_->start_inject(params);
     
     response->set_success(true);
@@ -263,6 +390,59 @@ ControlServiceImpl::ControlServiceImpl(
     return ::grpc::Status::OK;
 }
 
+::grpc::Status ControlServiceImpl::DispenseByWeight(
+    ::grpc::ServerContext* context,
+    const ::enose::service::DispenseByWeightRequest* request,
+    ::enose::service::DispenseByWeightResponse* response) {
+    
+    const auto& pump = request->pump_name();
+    if (pump.size() != 6 || pump.rfind("pump_", 0) != 0 || pump[5] < '0' || pump[5] > '7') {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "pump_name must be pump_0 ~ pump_7");
+    }
+    if (request->target_weight() <= 0) {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "target_weight must be positive");
+    }
+    if (!actuator_->is_connected()) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "Moonraker not connected");
+    }
+    
+    hal::DispenseRequest dispense;
+    dispense.pump = pump;
+    dispense.target_g = request->target_weight();
+    if (request->has_coarse_speed()) dispense.coarse_speed = request->coarse_speed();
+    if (request->has_fine_speed()) dispense.fine_speed = request->fine_speed();
+    if (request->has_slowdown_weight()) dispense.slowdown_g = request->slowdown_weight();
+    if (request->has_tolerance()) dispense.tolerance_g = request->tolerance();
+    if (request->has_timeout()) dispense.timeout_s = request->timeout();
+    
+    // 插件检查参数、泵是否空闲后立即返回, 定量本身在 Klipper 内进行
+    auto result = dispenser_->dispense(dispense).get();
+    
+    publish_system_event(*events_, ::enose::data::Event::USER_INTERACTION,
+        result.ok ? ::enose::data::Event::INFO : ::enose::data::Event::WARNING,
+        result.ok ? "Dispense started" : "Dispense rejected",
+        {{"client", context->peer()}, {"pump", pump},
+         {"target_g", std::format("{:.2f}", dispense.target_g)}});
+    
+    response->set_success(result.ok);
+    response->set_message(result.ok ? std::format("Dispensing {:.2f}g with {}", dispense.target_g, pump)
+                                    : "Dispense rejected: " + result.error);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ControlServiceImpl::CancelDispense(
+    ::grpc::ServerContext* context,
+    const ::google::protobuf::Empty* request,
+    ::enose::service::DispenseByWeightResponse* response) {
+    
+    dispenser_->cancel();
+    spdlog::info("ControlServiceImpl: Dispense cancel requested by {}", context->peer());
+    
+    response->set_success(true);
+    response->set_message("Dispense cancel sent.");
+    return ::grpc::Status::OK;
+}
+
 ::grpc::Status ControlServiceImpl::StopInjection(
     ::grpc::ServerContext* context,
     const ::google::protobuf::Empty* request,
@@ -280,9 +460,8 @@ ControlServiceImpl::ControlServiceImpl(
     return ::grpc::Status::OK;
 }
 
-void ControlServiceImpl::fill_peripheral_status(::enose::service::PeripheralStatus* status) {
-    const auto& state = system_state_->get_peripheral_state();
-    
+void ControlServiceImpl::fill_peripheral_status(::enose::service::PeripheralStatus* status,
+                                                const workflows::PeripheralState& state) {
     status->set_valve_waste(state.valve_waste);
     status->set_valve_pinch(state.valve_pinch);
     status->set_valve_air(state.valve_air);
@@ -325,14 +504,37 @@ void ControlServiceImpl::fill_peripheral_status(::enose::service::PeripheralStat
     
     spdlog::warn("ControlServiceImpl: EMERGENCY STOP triggered!");
     
-    // 发送 M112 急停命令
-    actuator_->send_gcode("M112");
+    // 急停专用连接与主连接优先通道同时发出, 不经 G-code 队列; 等待第一条确认
+    auto promise = std::make_shared<std::promise<hal::EmergencyStopResult>>();
+    auto future = promise->get_future();
+    actuator_->emergency_stop([promise](const hal::EmergencyStopResult& result) {
+        promise->set_value(result);
+    });
     
     // 切换到 INITIAL 状态
     system_state_->transition_to(workflows::SystemState::State::INITIAL);
     
-    response->set_success(true);
-    response->set_message("Emergency stop triggered. Use FIRMWARE_RESTART to recover.");
+    hal::EmergencyStopResult result;
+    if (future.wait_for(EMERGENCY_STOP_ACK_WAIT) == std::future_status::ready) {
+        result = future.get();
+    } else {
+        result.error = "no acknowledgement";
+    }
+    
+    publish_system_event(*events_, ::enose::data::Event::USER_INTERACTION,
+        ::enose::data::Event::CRITICAL, "Emergency stop triggered",
+        {{"client", context->peer()},
+         {"lane", result.ok ? result.lane : std::string("none")},
+         {"latency_us", std::to_string(result.latency_us)}});
+    
+    response->set_success(result.ok);
+    response->set_latency_us(result.latency_us);
+    response->set_lane(result.lane);
+    if (result.ok) {
+        response->set_message("Emergency stop triggered. Use FIRMWARE_RESTART to recover.");
+    } else {
+        response->set_message("Emergency stop not acknowledged by Moonraker: " + result.error);
+    }
     
     return ::grpc::Status::OK;
 }
@@ -347,18 +549,90 @@ void ControlServiceImpl::fill_peripheral_status(::enose::service::PeripheralStat
     // 发送 FIRMWARE_RESTART 命令
     actuator_->send_gcode("FIRMWARE_RESTART");
     
+    publish_system_event(*events_, ::enose::data::Event::USER_INTERACTION,
+        ::enose::data::Event::WARNING, "Firmware restart requested",
+        {{"client", context->peer()}});
+    
     response->set_success(true);
     response->set_message("Firmware restart command sent.");
     
     return ::grpc::Status::OK;
 }
 
-float ControlServiceImpl::weight_to_mm(float weight_g) const {
+::grpc::Status ControlServiceImpl::GetLatencyStats(
+    ::grpc::ServerContext* context,
+    const ::enose::service::GetLatencyStatsRequest* request,
+    ::enose::service::LatencyStats* response) {
+    
+    auto& tracer = core::LatencyTracer::instance();
+    response->set_window_seconds(tracer.window_seconds());
+    for (const auto& s : tracer.stats()) {
+        auto* stage = response->add_stages();
+        stage->set_stage(s.stage);
+        stage->set_count(s.count);
+        stage->set_mean_us(s.mean_us);
+        stage->set_p50_us(s.p50_us);
+        stage->set_p90_us(s.p90_us);
+        stage->set_p99_us(s.p99_us);
+        stage->set_p999_us(s.p999_us);
+        stage->set_max_us(s.max_us);
+    }
+    if (request->reset()) {
+        tracer.reset();
+        spdlog::info("ControlServiceImpl: Latency statistics reset by {}", context->peer());
+    }
+    
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ControlServiceImpl::GetHealth(
+    ::grpc::ServerContext* context,
+    const ::google::protobuf::Empty* request,
+    ::enose::service::HealthStatus* response) {
+    (void)context;
+    (void)request;
+    
+    auto& health = core::HealthRegistry::instance();
+    bool ready = true;
+    for (const auto& s : health.report()) {
+        auto* subsystem = response->add_subsystems();
+        subsystem->set_name(s.name);
+        switch (s.state) {
+            case core::HealthRegistry::State::STARTING:
+                subsystem->set_state(::enose::service::SubsystemHealth::STARTING);
+                break;
+            case core::HealthRegistry::State::READY:
+                subsystem->set_state(::enose::service::SubsystemHealth::READY);
+                break;
+            case core::HealthRegistry::State::DEGRADED:
+                subsystem->set_state(::enose::service::SubsystemHealth::DEGRADED);
+                break;
+            case core::HealthRegistry::State::DISABLED:
+                subsystem->set_state(::enose::service::SubsystemHealth::DISABLED);
+                break;
+        }
+        subsystem->set_detail(s.detail);
+        subsystem->set_required(s.required);
+        *subsystem->mutable_since() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+            std::chrono::duration_cast<std::chrono::microseconds>(s.since.time_since_epoch()).count());
+        subsystem->set_ready_after_ms(s.ready_after_ms);
+        if (s.required && s.state != core::HealthRegistry::State::READY) {
+            ready = false;
+        }
+    }
+    response->set_ready(ready);
+    response->set_uptime_ms(health.uptime_ms());
+    
+    return ::grpc::Status::OK;
+}
+
+float ControlServiceImpl::weight_to_mm(int pump, float weight_g) const {
     // 两阶段线性转换 (逆向):
-    // 正向: measured_weight = mm * pump_mm_to_ml + pump_mm_offset
+    // 正向: measured_weight = mm * pump_mm_to_ml + pump_mm_offset (每个泵在线修正)
     //       real_weight = weight_scale * measured_weight + weight_offset
     // 逆向: measured_weight = (real_weight - weight_offset) / weight_scale
     //       mm = (measured_weight - pump_mm_offset) / pump_mm_to_ml
+    if (weight_g <= 0) return 0;
     
     if (!load_cell_) {
         // 无 load cell config时使用默认值
@@ -375,7 +649,7 @@ float ControlServiceImpl::weight_to_mm(float weight_g) const {
     // 第一阶段: 真实重量 -> 测量重量
     float measured_weight = (weight_g - config.weight_offset) / config.weight_scale;
     // 第二阶段: 测量重量 -> mm
-    return (measured_weight - config.pump_mm_offset) / config.pump_mm_to_ml;
+    return load_cell_->pump_mm_for(pump, measured_weight);
 }
 
 ::grpc::Status ControlServiceImpl::StartInjectionByWeight(
@@ -386,14 +660,14 @@ float ControlServiceImpl::weight_to_mm(float weight_g) const {
     (void)context;
     
     // 将重量 (g) 转换为距离 (mm)
-    float pump0_mm = weight_to_mm(request->pump_0_weight());
-    float pump1_mm = weight_to_mm(request->pump_1_weight());
-    float pump2_mm = weight_to_mm(request->pump_2_weight());
-    float pump3_mm = weight_to_mm(request->pump_3_weight());
-    float pump4_mm = weight_to_mm(request->pump_4_weight());
-    float pump5_mm = weight_to_mm(request->pump_5_weight());
-    float pump6_mm = weight_to_mm(request->pump_6_weight());
-    float pump7_mm = weight_to_mm(request->pump_7_weight());
+    float pump0_mm = weight_to_mm(0, request->pump_0_weight());
+    float pump1_mm = weight_to_mm(1, request->pump_1_weight());
+    float pump2_mm = weight_to_mm(2, request->pump_2_weight());
+    float pump3_mm = weight_to_mm(3, request->pump_3_weight());
+    float pump4_mm = weight_to_mm(4, request->pump_4_weight());
+    float pump5_mm = weight_to_mm(5, request->pump_5_weight());
+    float pump6_mm = weight_to_mm(6, request->pump_6_weight());
+    float pump7_mm = weight_to_mm(7, request->pump_7_weight());
     
     spdlog::info("gRPC: StartInjectionByWeight - input(g): pump0={:.3f}~pump7={:.3f}",
                  request->pump_0_weight(), request->pump_7_weight());
@@ -418,6 +692,11 @@ float ControlServiceImpl::weight_to_mm(float weight_g) const {
         params.accel = request->accel();
     }
     
+    // 单泵进样完成后以称得的重量变化修正该泵的标定
+    if (load_cell_) {
+        load_cell_->observe_injection({pump0_mm, pump1_mm, pump2_mm, pump3_mm,
+                                       pump4_mm, pump5_mm, pump6_mm, pump7_mm});
+    }
     system_state_->start_inject(params);
     
     response->set_success(true);
@@ -2,12 +2,17 @@
 
 #include <grpcpp/grpcpp.h>
 #include <memory>
+#include <vector>
 #include "enose_service.grpc.pb.h"
 #include "workflows/system_state.hpp"
+#include "grpc/stream_reactors.hpp"
+#include "grpc/system_events.hpp"
+#include <boost/signals2.hpp>
 
 namespace hal {
 class ActuatorDriver;
 class LoadCellDriver;
+class KlipperDispenser;
 }
 
 namespace enose_grpc {
@@ -20,19 +25,26 @@ namespace enose_grpc {
  * - 手动控制外设
  * - 泵控制
  * - 事件订阅
+ *
+ * 两个订阅方法走 callback API, 其余保持同步 API
  */
-class ControlServiceImpl final : public enose::service::ControlService::Service {
+using ControlServiceBase = enose::service::ControlService::WithCallbackMethod_SubscribeEvents<
+    enose::service::ControlService::WithCallbackMethod_SubscribePeripheralStatus<
+        enose::service::ControlService::Service>>;
+
+class ControlServiceImpl final : public ControlServiceBase {
 public:
     ControlServiceImpl(
         std::shared_ptr<hal::ActuatorDriver> actuator,
         std::shared_ptr<workflows::SystemState> system_state,
-        std::shared_ptr<hal::LoadCellDriver> load_cell = nullptr
+        std::shared_ptr<hal::LoadCellDriver> load_cell = nullptr,
+        std::shared_ptr<SystemEventBus> events = nullptr
     );
 
     // 获取系统状态
     ::grpc::Status GetStatus(
         ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
+        const ::enose::service::GetStatusRequest* request,
         ::enose::service::SystemStatus* response
     ) override;
 
@@ -78,6 +90,20 @@ public:
         ::enose::service::StartInjectionResponse* response
     ) override;
 
+    // 按重量闭环定量 (Klipper 插件内运行)
+    ::grpc::Status DispenseByWeight(
+        ::grpc::ServerContext* context,
+        const ::enose::service::DispenseByWeightRequest* request,
+        ::enose::service::DispenseByWeightResponse* response
+    ) override;
+
+    // 取消定量
+    ::grpc::Status CancelDispense(
+        ::grpc::ServerContext* context,
+        const ::google::protobuf::Empty* request,
+        ::enose::service::DispenseByWeightResponse* response
+    ) override;
+
     // 停止进样
     ::grpc::Status StopInjection(
         ::grpc::ServerContext* context,
@@ -99,31 +125,66 @@ public:
         ::enose::service::FirmwareRestartResponse* response
     ) override;
 
-    // 订阅事件流
-    ::grpc::Status SubscribeEvents(
+    // 热路径延迟分位数
+    ::grpc::Status GetLatencyStats(
         ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
-        ::grpc::ServerWriter<::enose::data::Event>* writer
+        const ::enose::service::GetLatencyStatsRequest* request,
+        ::enose::service::LatencyStats* response
     ) override;
 
-    // 订阅外设状态更新
-    ::grpc::Status SubscribePeripheralStatus(
+    // 子系统就绪状态
+    ::grpc::Status GetHealth(
         ::grpc::ServerContext* context,
         const ::google::protobuf::Empty* request,
-        ::grpc::ServerWriter<::enose::service::PeripheralStatus>* writer
+        ::enose::service::HealthStatus* response
     ) override;
 
+    // 订阅事件流 (resume_after_seq 非 0 时补发缓冲区中之后的事件)
+    ::grpc::ServerWriteReactor<::enose::data::Event>* SubscribeEvents(
+        ::grpc::CallbackServerContext* context,
+        const ::enose::service::SubscribeEventsRequest* request
+    ) override;
+
+    // 订阅外设状态更新 (状态变化时立即推送, 可选只发变化字段)
+    ::grpc::ServerWriteReactor<::enose::service::PeripheralStatus>* SubscribePeripheralStatus(
+        ::grpc::CallbackServerContext* context,
+        const ::enose::service::SubscribePeripheralStatusRequest* request
+    ) override;
+
+    /**
+     * @brief 向 SubscribeEvents 的所有客户端推送事件
+     */
+    void publish_event(const ::enose::data::Event& event) { events_->publish(event); }
+
 private:
     std::shared_ptr<hal::ActuatorDriver> actuator_;
     std::shared_ptr<workflows::SystemState> system_state_;
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
+    std::shared_ptr<hal::KlipperDispenser> dispenser_;
+    
+    // 系统事件总线 (与 GrpcServer 及其他服务共享)
+    std::shared_ptr<SystemEventBus> events_;
+    std::vector<boost::signals2::scoped_connection> event_connections_;
+    
+    // 外设状态无变化时的保活间隔 (客户端未指定时)
+    static constexpr auto PERIPHERAL_STATUS_KEEPALIVE = std::chrono::milliseconds(5000);
+    static constexpr auto PERIPHERAL_STATUS_MIN_KEEPALIVE = std::chrono::milliseconds(100);
+    
+    // GetStatus 长轮询的默认/最长等待, 等待期间按 STATUS_POLL_SLICE 检查客户端是否已取消
+    static constexpr auto STATUS_WAIT_DEFAULT = std::chrono::milliseconds(10000);
+    static constexpr auto STATUS_WAIT_MAX = std::chrono::milliseconds(30000);
+    static constexpr auto STATUS_POLL_SLICE = std::chrono::milliseconds(500);
+    
+    // EmergencyStop 等待 Moonraker 确认的上限 (两条通道各自 1s 超时, 另留扫描余量)
+    static constexpr auto EMERGENCY_STOP_ACK_WAIT = std::chrono::milliseconds(1500);
     
     // 将内部状态转换为 proto 消息
-    void fill_peripheral_status(::enose::service::PeripheralStatus* status);
+    static void fill_peripheral_status(::enose::service::PeripheralStatus* status,
+                                       const workflows::PeripheralState& state);
     
     // 将重量(g)转换为电机距离(mm)
-    // 公式: x = (y - weight_offset) / weight_scale, mm = x / pump_mm_to_ml
-    float weight_to_mm(float weight_g) const;
+    // 公式: x = (y - weight_offset) / weight_scale, mm 按该泵的 (在线) 标定由 x 求得
+    float weight_to_mm(int pump, float weight_g) const;
 };
 
 } // namespace enose_grpc
@@ -0,0 +1,622 @@
+#include "grpc/data_service_impl.hpp"
+#include "db/connection_pool.hpp"
+#include <google/protobuf/util/time_util.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <limits>
+#include <utility>
+
+namespace enose_grpc {
+
+namespace {
+
+std::string sensor_name(hal::SensorType type, uint8_t sensor_idx, uint8_t adc_channel) {
+    switch (type) {
+        case hal::SensorType::MOX_DIGITAL: return "bme_" + std::to_string(sensor_idx);
+        case hal::SensorType::MOX_ANALOG:  return "mox_a_" + std::to_string(adc_channel);
+        case hal::SensorType::PID:         return "pid_" + std::to_string(sensor_idx);
+        default:                           return "unknown_" + std::to_string(sensor_idx);
+    }
+}
+
+// 帧在最后一条读数到达后才可能结束, 延迟从该读数的接收时间起算
+uint64_t frame_origin_ns(const hal::StepFrame& frame) {
+    uint64_t origin = 0;
+    for (const auto& sample : frame.samples) {
+        origin = std::max(origin, sample.rx_ns);
+    }
+    return origin;
+}
+
+// 帧时间取第一条读数的采样时刻 (SensorDriver 已按设备时钟同步校正); 缺失时用当前时间
+std::chrono::system_clock::time_point frame_time(const hal::StepFrame& frame) {
+    if (frame.samples.empty() || frame.samples.front().host_time_us == 0) {
+        return std::chrono::system_clock::now();
+    }
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::microseconds(frame.samples.front().host_time_us)));
+}
+
+uint64_t frame_device_ms(const hal::StepFrame& frame) {
+    if (frame.samples.empty() || frame.samples.front().device_ms == 0) {
+        return frame.first_tick_ms;
+    }
+    return frame.samples.front().device_ms;
+}
+
+const char* value_unit(hal::SensorType type) {
+    switch (type) {
+        case hal::SensorType::MOX_DIGITAL: return "Ohm";
+        case hal::SensorType::MOX_ANALOG:  return "V";
+        case hal::SensorType::PID:         return "ppb";
+        default:                           return "";
+    }
+}
+
+// 质量标志位与 proto 枚举、建议操作的对应关系
+struct QualityMapping {
+    uint32_t bit;
+    ::enose::data::AnalysisResult::QualityFlag flag;
+    const char* recommendation;
+};
+
+constexpr QualityMapping QUALITY_MAPPINGS[] = {
+    {hal::QUALITY_BASELINE_UNSTABLE, ::enose::data::AnalysisResult::QF_BASELINE_UNSTABLE,
+     "基线仍在漂移, 延长基线/恢复阶段后再进样"},
+    {hal::QUALITY_SATURATION, ::enose::data::AnalysisResult::QF_SENSOR_SATURATION,
+     "读数超出量程, 检查传感器连接或降低样品浓度"},
+    {hal::QUALITY_EXCESS_NOISE, ::enose::data::AnalysisResult::QF_EXCESS_NOISE,
+     "噪声过大, 检查气路流量和传感器供电"},
+    {hal::QUALITY_HUMIDITY, ::enose::data::AnalysisResult::QF_HUMIDITY_OUT_OF_RANGE,
+     "湿度超出范围"},
+    {hal::QUALITY_TEMPERATURE, ::enose::data::AnalysisResult::QF_TEMP_OUT_OF_RANGE,
+     "温度超出范围"},
+};
+
+hal::SensorType sensor_type_from_name(const std::string& name) {
+    if (name == "mox_d") return hal::SensorType::MOX_DIGITAL;
+    if (name == "mox_a") return hal::SensorType::MOX_ANALOG;
+    if (name == "pid") return hal::SensorType::PID;
+    return hal::SensorType::UNKNOWN;
+}
+
+bool iequals(const std::string& a, const std::string& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+} // namespace
+
+DataServiceImpl::DataServiceImpl(std::shared_ptr<hal::SensorDriver> sensor,
+                                 std::string device_id,
+                                 ContextProvider context_provider,
+                                 std::shared_ptr<db::SensorReadingRepository> reading_repo,
+                                 AnalysisOptions analysis)
+    : sensor_(std::move(sensor))
+    , device_id_(std::move(device_id))
+    , context_provider_(std::move(context_provider))
+    , reading_repo_(std::move(reading_repo))
+    , assembler_([this](const hal::StepFrame& frame) { on_step_frame(frame); })
+    , extractor_(analysis.features)
+    , baseline_(analysis.baseline)
+    , baseline_phases_(std::move(analysis.baseline_phases))
+    , persist_interval_(analysis.persist_interval)
+    , next_persist_(std::chrono::steady_clock::now() + persist_interval_)
+    , baseline_repo_(std::move(analysis.baseline_repo))
+    , recovery_(std::move(analysis.recovery))
+    , fingerprint_defaults_(analysis.fingerprint)
+    , fingerprints_(analysis.fingerprint)
+    , events_(std::move(analysis.events))
+    , min_confidence_(analysis.min_confidence) {
+
+    frames_hub_.set_latency_stage(core::LatencyStage::GRPC_WRITE_FRAMES);
+
+    if (analysis.inference) {
+        inference_ = std::make_unique<hal::InferenceRunner>(
+            std::move(*analysis.inference),
+            [this](const hal::InferenceResult& result) { publish_inference(result); });
+        inference_->start();
+    }
+
+    load_baselines();
+
+    // 读数在 io 线程上归并, 没有订阅者时也要维持帧边界和序号
+    readings_connection_ = sensor_->on_readings.connect(
+        [this](std::span<const hal::SensorSample> samples) {
+            assembler_.push(samples);
+        }
+    );
+    // 断线时把半帧发出去, 重连后的读数从新帧开始; 设备时间可能已重置, 特征从头统计
+    link_connection_ = sensor_->on_connection_changed.connect(
+        [this](bool connected) {
+            if (!connected) {
+                assembler_.flush();
+                extractor_.reset();
+                fingerprints_.reset();
+            }
+        }
+    );
+}
+
+DataServiceImpl::~DataServiceImpl() {
+    readings_connection_.disconnect();
+    link_connection_.disconnect();
+    if (inference_) {
+        inference_->stop();
+    }
+    // 最后一次写回; 仓库的 stop() 会把它写完
+    persist_baselines();
+    frames_hub_.close_all();
+    analysis_hub_.close_all();
+    fingerprint_hub_.close_all();
+}
+
+void DataServiceImpl::fill_reading(const hal::SensorSample& sample,
+                                   ::enose::data::SensorReading* reading) {
+    reading->set_sensor_id(sensor_name(sample.type, sample.sensor_idx, sample.adc_channel));
+    switch (sample.type) {
+        case hal::SensorType::MOX_DIGITAL:
+            reading->set_gas_resistance(sample.value);
+            reading->set_heater_step(sample.heater_step);
+            break;
+        case hal::SensorType::MOX_ANALOG:
+            reading->set_voltage(sample.value);
+            break;
+        case hal::SensorType::PID:
+            reading->set_concentration(sample.value);
+            break;
+        default:
+            break;
+    }
+
+    if (sample.has_temperature()) {
+        reading->set_temperature(sample.temperature);
+    }
+    if (sample.has_humidity()) {
+        reading->set_humidity(sample.humidity);
+    }
+    if (sample.has_pressure()) {
+        reading->set_pressure(sample.pressure);
+    }
+}
+
+void DataServiceImpl::update_analysis(const AnalysisOptions& analysis) {
+    {
+        std::lock_guard<std::mutex> lock(pending_analysis_mutex_);
+        pending_analysis_ = PendingAnalysis{analysis.features, analysis.baseline,
+                                            analysis.baseline_phases, analysis.persist_interval};
+    }
+    analysis_pending_.store(true, std::memory_order_release);
+    min_confidence_ = analysis.min_confidence;
+    if (inference_ && analysis.inference) {
+        inference_->set_limits(analysis.inference->max_batch, analysis.inference->queue_capacity);
+    }
+}
+
+void DataServiceImpl::on_step_frame(const hal::StepFrame& frame) {
+    // 热加载的参数在帧之间替换, 一帧内各通道用同一组阈值
+    if (analysis_pending_.exchange(false, std::memory_order_acquire)) {
+        std::optional<PendingAnalysis> pending;
+        {
+            std::lock_guard<std::mutex> lock(pending_analysis_mutex_);
+            pending = std::exchange(pending_analysis_, std::nullopt);
+        }
+        if (pending) {
+            extractor_.set_config(pending->features);
+            baseline_.set_config(pending->baseline);
+            baseline_phases_ = std::move(pending->baseline_phases);
+            if (pending->persist_interval != persist_interval_) {
+                persist_interval_ = pending->persist_interval;
+                next_persist_ = std::chrono::steady_clock::now() + persist_interval_;
+            }
+            spdlog::info("DataService: Analysis options reloaded");
+        }
+    }
+
+    FrameContext ctx;
+    if (context_provider_) {
+        ctx = context_provider_();
+    }
+
+    if (is_baseline_phase(ctx.phase_name)) {
+        baseline_.learn(frame);
+    }
+    if (recovery_) {
+        recovery_->update(frame, baseline_);
+    }
+    corrected_.seq = frame.seq;
+    corrected_.heater_step = frame.heater_step;
+    corrected_.first_tick_ms = frame.first_tick_ms;
+    corrected_.samples.assign(frame.samples.begin(), frame.samples.end());
+    baseline_.correct(corrected_);
+    frame_corrected_ = false;
+    for (std::size_t i = 0; i < frame.samples.size(); ++i) {
+        if (corrected_.samples[i].value != frame.samples[i].value) {
+            frame_corrected_ = true;
+            break;
+        }
+    }
+
+    // 连接池在后台预热, 构造时可能还读不到持久化的基线; 读到之前不写回, 以免覆盖
+    if (baseline_repo_ && !baselines_loaded_) {
+        load_baselines();
+    }
+    if (baseline_repo_ && baselines_loaded_ && std::chrono::steady_clock::now() >= next_persist_) {
+        persist_baselines();
+        next_persist_ = std::chrono::steady_clock::now() + persist_interval_;
+    }
+
+    // 特征提取不论有无订阅者都运行, 订阅开始时基线已经就绪; 输入为漂移校正后的读数
+    const auto& features = extractor_.push(corrected_, ctx.gas_mode == ::enose::data::SensorFrame::CHAMBER);
+    if (!analysis_hub_.empty()) {
+        publish_analysis(features, ctx);
+    }
+
+    // 周期边界需要连续的帧, 同样不论有无订阅者都运行
+    fingerprints_.set_steps(sensor_->heater_cycles().profile_length(0));
+    if (const auto* matrix = fingerprints_.push(frame)) {
+        if (inference_) {
+            submit_inference(*matrix, ctx);
+        }
+        if (!fingerprint_hub_.empty()) {
+            ::enose::data::FingerprintMatrix msg;
+            *msg.mutable_ts() = google::protobuf::util::TimeUtil::GetCurrentTime();
+            fill_fingerprint(*matrix, &msg);
+            msg.set_run_id(ctx.run_id);
+            msg.set_phase_name(ctx.phase_name);
+            fingerprint_hub_.publish(msg);
+        }
+    }
+
+    if (reading_repo_) {
+        persist_frame(frame, ctx);
+    }
+    if (frames_hub_.empty()) return;
+
+    auto& msg = frame_msg_;
+    msg.Clear();
+    *msg.mutable_ts() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+        std::chrono::duration_cast<std::chrono::microseconds>(frame_time(frame).time_since_epoch()).count());
+    msg.set_seq(frame.seq);
+    msg.set_heater_step(frame.heater_step);
+    msg.set_device_id(device_id_);
+    msg.set_device_tick(frame_device_ms(frame));
+    msg.set_run_id(std::move(ctx.run_id));
+    msg.set_phase_name(std::move(ctx.phase_name));
+    msg.set_gas_mode(ctx.gas_mode);
+
+    for (std::size_t i = 0; i < frame.samples.size(); ++i) {
+        auto* reading = msg.add_readings();
+        fill_reading(frame.samples[i], reading);
+        if (corrected_.samples[i].value != frame.samples[i].value) {
+            reading->set_drift_corrected(corrected_.samples[i].value);
+        }
+    }
+
+    const uint64_t origin_ns = frame_origin_ns(frame);
+    frames_hub_.publish(msg, origin_ns);
+    core::LatencyTracer::instance().record_since(core::LatencyStage::FANOUT_FRAMES, origin_ns);
+}
+
+void DataServiceImpl::persist_frame(const hal::StepFrame& frame, const FrameContext& ctx) {
+    db::SensorReadingRecord record;
+    record.time = frame_time(frame);
+    record.run_id = ctx.db_run_id;
+    record.run_tag = ctx.run_id;
+    record.phase = ctx.phase_name;
+    record.heater_step = frame.heater_step;
+    record.frame_seq = frame.seq;
+    record.device_tick = frame.first_tick_ms;
+    record.rx_ns = frame_origin_ns(frame);
+    if (ctx.gas_mode == ::enose::data::SensorFrame::CHAMBER) {
+        record.gas_mode = "chamber";
+    } else if (ctx.gas_mode == ::enose::data::SensorFrame::BYPASS) {
+        record.gas_mode = "bypass";
+    }
+
+    record.channels.fill(std::numeric_limits<float>::quiet_NaN());
+    for (const auto& sample : frame.samples) {
+        if (sample.sensor_idx < record.channels.size()) {
+            record.channels[sample.sensor_idx] = sample.value;
+        }
+    }
+    if (frame_corrected_) {
+        auto& corrected = record.corrected.emplace();
+        corrected.fill(std::numeric_limits<float>::quiet_NaN());
+        for (const auto& sample : corrected_.samples) {
+            if (sample.sensor_idx < corrected.size()) {
+                corrected[sample.sensor_idx] = sample.value;
+            }
+        }
+    }
+
+    reading_repo_->enqueue(std::move(record));
+}
+
+bool DataServiceImpl::is_baseline_phase(const std::string& phase_name) const {
+    if (phase_name.empty()) return false;
+    return std::any_of(baseline_phases_.begin(), baseline_phases_.end(),
+                       [&](const std::string& p) { return iequals(p, phase_name); });
+}
+
+void DataServiceImpl::load_baselines() {
+    if (!baseline_repo_ || !db::ConnectionPool::instance().is_healthy()) return;
+    baselines_loaded_ = true;
+    const auto records = baseline_repo_->load();
+    std::vector<hal::BaselineTracker::Entry> entries;
+    entries.reserve(records.size());
+    for (const auto& r : records) {
+        hal::BaselineTracker::Entry entry;
+        entry.type = sensor_type_from_name(r.sensor_type);
+        entry.sensor_idx = static_cast<uint8_t>(r.sensor_idx);
+        entry.heater_step = static_cast<uint8_t>(r.heater_step);
+        entry.baseline = r.baseline;
+        entry.reference = r.reference;
+        entry.samples = static_cast<uint64_t>(std::max<int64_t>(r.samples, 0));
+        entries.push_back(entry);
+    }
+    baseline_.load(entries);
+    if (!entries.empty()) {
+        spdlog::info("DataService: Loaded {} sensor baselines", entries.size());
+    }
+}
+
+void DataServiceImpl::persist_baselines() {
+    if (!baseline_repo_) return;
+    auto entries = baseline_.take_dirty();
+    if (entries.empty()) return;
+
+    std::vector<db::SensorBaselineRecord> records;
+    records.reserve(entries.size());
+    for (const auto& entry : entries) {
+        hal::SensorSample probe;
+        probe.type = entry.type;
+        db::SensorBaselineRecord record;
+        record.sensor_type = probe.type_name();
+        record.sensor_idx = entry.sensor_idx;
+        record.heater_step = entry.heater_step;
+        record.baseline = entry.baseline;
+        record.reference = entry.reference;
+        record.samples = static_cast<int64_t>(entry.samples);
+        records.push_back(std::move(record));
+    }
+    baseline_repo_->enqueue(std::move(records));
+}
+
+void DataServiceImpl::submit_inference(const hal::FingerprintMatrix& matrix, const FrameContext& ctx) {
+    // 模型尚在加载时跳过 (不排队, 避免积压旧周期)
+    if (!inference_->ready()) return;
+
+    hal::InferenceRequest request;
+    request.device_id = device_id_;
+    request.run_id = ctx.run_id;
+    request.phase_name = ctx.phase_name;
+    request.cycle_seq = matrix.cycle_seq;
+    request.frame_seq = matrix.last_frame_seq;
+    const auto& input = inference_->normalized_input() ? matrix.normalized : matrix.resistance;
+    request.input.assign(input.begin(), input.end());
+    inference_->submit(std::move(request));
+}
+
+void DataServiceImpl::publish_inference(const hal::InferenceResult& result) {
+    const float confidence = result.scores.empty() ? 0.0f : result.scores[result.best];
+
+    if (!analysis_hub_.empty()) {
+        ::enose::data::AnalysisResult msg;
+        *msg.mutable_ts() = google::protobuf::util::TimeUtil::GetCurrentTime();
+        msg.set_sensor_seq(result.request.frame_seq);
+        msg.set_device_id(result.request.device_id);
+        msg.set_run_id(result.request.run_id);
+        msg.set_model(result.model);
+        msg.set_cycle_seq(result.request.cycle_seq);
+        for (std::size_t i = 0; i < result.scores.size(); ++i) {
+            auto* metric = msg.add_metrics();
+            metric->set_name("class." + result.labels[i]);
+            metric->set_value(result.scores[i]);
+        }
+        auto* inference_ms = msg.add_metrics();
+        inference_ms->set_name("inference_ms");
+        inference_ms->set_value(result.inference_ms);
+        inference_ms->set_unit("ms");
+        auto* latency_ms = msg.add_metrics();
+        latency_ms->set_name("latency_ms");
+        latency_ms->set_value(result.latency_ms);
+        latency_ms->set_unit("ms");
+        msg.add_flags(::enose::data::AnalysisResult::QF_OK);
+        analysis_hub_.publish(msg);
+    }
+
+    if (events_ && confidence >= min_confidence_) {
+        char score[16];
+        std::snprintf(score, sizeof(score), "%.3f", confidence);
+        publish_system_event(*events_, ::enose::data::Event::ODOR_CLASSIFIED, ::enose::data::Event::INFO,
+                             "识别结果: " + result.label + " (" + score + ")",
+                             {{"label", result.label},
+                              {"confidence", score},
+                              {"model", result.model},
+                              {"run_id", result.request.run_id},
+                              {"phase", result.request.phase_name},
+                              {"cycle_seq", std::to_string(result.request.cycle_seq)}});
+    }
+}
+
+void DataServiceImpl::fill_fingerprint(const hal::FingerprintMatrix& matrix,
+                                       ::enose::data::FingerprintMatrix* msg) const {
+    msg->set_device_id(device_id_);
+    msg->set_cycle_seq(matrix.cycle_seq);
+    msg->set_first_frame_seq(matrix.first_frame_seq);
+    msg->set_last_frame_seq(matrix.last_frame_seq);
+    msg->set_device_tick(matrix.first_tick_ms);
+    msg->set_steps(matrix.steps);
+    msg->set_sensors(matrix.sensors);
+    msg->set_missing(matrix.missing);
+    // 整块拷贝到 RepeatedField, 不逐元素 Add
+    msg->mutable_resistance()->Add(matrix.resistance.begin(), matrix.resistance.end());
+    msg->mutable_normalized()->Add(matrix.normalized.begin(), matrix.normalized.end());
+}
+
+void DataServiceImpl::publish_analysis(const hal::FrameFeatures& features, const FrameContext& ctx) {
+    ::enose::data::AnalysisResult msg;
+    *msg.mutable_ts() = google::protobuf::util::TimeUtil::GetCurrentTime();
+    msg.set_sensor_seq(features.seq);
+    msg.set_device_id(device_id_);
+    msg.set_heater_step(features.heater_step);
+    msg.set_run_id(ctx.run_id);
+    msg.set_exposure(features.exposure);
+
+    auto add_metric = [&msg](const std::string& prefix, const char* name, double value, const char* unit) {
+        auto* metric = msg.add_metrics();
+        metric->set_name(prefix + name);
+        metric->set_value(value);
+        metric->set_unit(unit);
+    };
+
+    msg.mutable_metrics()->Reserve(static_cast<int>(features.channels.size() * 7));
+    for (const auto& ch : features.channels) {
+        const std::string prefix = sensor_name(ch.type, ch.sensor_idx, ch.adc_channel) + ".";
+        add_metric(prefix, "r0", ch.baseline, value_unit(ch.type));
+        add_metric(prefix, "dr_r0", ch.response, "");
+        add_metric(prefix, "peak_dr_r0", ch.peak_response, "");
+        add_metric(prefix, "rise_time", ch.rise_time_s, "s");
+        add_metric(prefix, "area", ch.area_s, "s");
+        add_metric(prefix, "slope", ch.slope_per_s, "1/s");
+        add_metric(prefix, "noise", ch.noise, "");
+    }
+
+    if (features.quality == 0) {
+        msg.add_flags(::enose::data::AnalysisResult::QF_OK);
+    }
+    for (const auto& mapping : QUALITY_MAPPINGS) {
+        if (!(features.quality & mapping.bit)) continue;
+        msg.add_flags(mapping.flag);
+        std::string sensors;
+        for (const auto& ch : features.channels) {
+            if (!(ch.quality & mapping.bit)) continue;
+            if (!sensors.empty()) sensors += ", ";
+            sensors += sensor_name(ch.type, ch.sensor_idx, ch.adc_channel);
+        }
+        msg.add_recommendations(std::string(mapping.recommendation) + " (" + sensors + ")");
+    }
+
+    analysis_hub_.publish(msg);
+}
+
+void DataServiceImpl::collect_metrics(core::MetricWriter& writer) const {
+    write_subscriber_metrics(writer, "DataService.SubscribeSensorData", frames_hub_.stats());
+    write_subscriber_metrics(writer, "DataService.SubscribeAnalysisResults", analysis_hub_.stats());
+    write_subscriber_metrics(writer, "DataService.SubscribeFingerprints", fingerprint_hub_.stats());
+
+    if (inference_) {
+        auto stats = inference_->stats();
+        writer.counter("inference_submitted_total", "Fingerprints submitted to the inference runner",
+                       static_cast<double>(stats.submitted));
+        writer.counter("inference_completed_total", "Fingerprints classified", static_cast<double>(stats.completed));
+        writer.counter("inference_dropped_total", "Fingerprints dropped (queue full or shape mismatch)",
+                       static_cast<double>(stats.dropped));
+        writer.counter("inference_batches_total", "Inference batches run", static_cast<double>(stats.batches));
+        writer.gauge("inference_batch_seconds", "Moving average of per-batch inference time",
+                     stats.mean_inference_ms / 1000.0);
+    }
+}
+
+::grpc::ServerWriteReactor<::enose::data::SensorFrame>* DataServiceImpl::SubscribeSensorData(
+    ::grpc::CallbackServerContext* context,
+    const ::google::protobuf::Empty* request
+) {
+    apply_stream_compression(context);
+    return new HubWriteReactor<::enose::data::SensorFrame>(
+        frames_hub_, context->peer(), "DataService.SubscribeSensorData");
+}
+
+::grpc::ServerWriteReactor<::enose::data::AnalysisResult>* DataServiceImpl::SubscribeAnalysisResults(
+    ::grpc::CallbackServerContext* context,
+    const ::google::protobuf::Empty* request
+) {
+    apply_stream_compression(context);
+    return new HubWriteReactor<::enose::data::AnalysisResult>(
+        analysis_hub_, context->peer(), "DataService.SubscribeAnalysisResults");
+}
+
+::grpc::ServerWriteReactor<::enose::data::FingerprintMatrix>* DataServiceImpl::SubscribeFingerprints(
+    ::grpc::CallbackServerContext* context,
+    const ::google::protobuf::Empty* request
+) {
+    apply_stream_compression(context);
+    return new HubWriteReactor<::enose::data::FingerprintMatrix>(
+        fingerprint_hub_, context->peer(), "DataService.SubscribeFingerprints");
+}
+
+::grpc::Status DataServiceImpl::ExportFingerprints(
+    ::grpc::ServerContext* context,
+    const ::enose::service::ExportFingerprintsRequest* request,
+    ::grpc::ServerWriter<::enose::data::FingerprintMatrix>* writer)
+{
+    if (!reading_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "数据库未配置");
+    }
+
+    db::SensorReadingQuery query;
+    if (request->has_run_id()) query.run_id = request->run_id();
+    query.run_tag = request->run_tag();
+    if (request->has_start_time()) {
+        query.start_time = std::chrono::system_clock::time_point(std::chrono::microseconds(
+            google::protobuf::util::TimeUtil::TimestampToMicroseconds(request->start_time())));
+    }
+    if (request->has_end_time()) {
+        query.end_time = std::chrono::system_clock::time_point(std::chrono::microseconds(
+            google::protobuf::util::TimeUtil::TimestampToMicroseconds(request->end_time())));
+    }
+    if (!query.run_id && query.run_tag.empty() && !query.start_time && !query.end_time) {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "需要指定 run_id、run_tag 或时间段");
+    }
+    query.limit = EXPORT_PAGE_ROWS;
+
+    hal::FingerprintConfig config = fingerprint_defaults_;
+    if (request->steps() > 0) {
+        config.steps = static_cast<uint8_t>(std::min<uint32_t>(request->steps(), hal::FeatureExtractor::MAX_HEATER_STEPS));
+    }
+    if (request->sensors() > 0) {
+        config.sensors = static_cast<uint8_t>(std::min<uint32_t>(request->sensors(), db::SensorReadingRecord::MAX_CHANNELS));
+    }
+    config.max_missing = request->max_missing();
+    hal::FingerprintAssembler assembler(config);
+    const std::size_t sensors = assembler.config().sensors;
+
+    const uint64_t limit = request->limit() > 0 ? request->limit() : std::numeric_limits<uint64_t>::max();
+    uint64_t exported = 0;
+    for (;;) {
+        if (context->IsCancelled()) {
+            return ::grpc::Status::CANCELLED;
+        }
+
+        const auto rows = reading_repo_->read_page(query);
+        for (const auto& row : rows) {
+            const auto& channels = request->drift_corrected() && row.corrected ? *row.corrected : row.channels;
+            const auto* matrix = assembler.push_row(row.frame_seq, row.device_tick, row.heater_step,
+                                                    std::span<const float>(channels.data(), sensors));
+            if (!matrix) continue;
+
+            ::enose::data::FingerprintMatrix msg;
+            *msg.mutable_ts() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+                std::chrono::duration_cast<std::chrono::microseconds>(row.time.time_since_epoch()).count());
+            fill_fingerprint(*matrix, &msg);
+            msg.set_run_id(row.run_tag);
+            msg.set_phase_name(row.phase);
+            if (!writer->Write(msg) || ++exported >= limit) {
+                return ::grpc::Status::OK;
+            }
+        }
+        if (rows.size() < static_cast<std::size_t>(query.limit)) break;
+
+        query.after = db::SensorReadingCursor{
+            std::chrono::duration_cast<std::chrono::microseconds>(rows.back().time.time_since_epoch()).count(),
+            rows.back().frame_seq};
+    }
+
+    return ::grpc::Status::OK;
+}
+
+} // namespace enose_grpc
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include "enose_service.grpc.pb.h"
+#include "grpc/broadcast_hub.hpp"
+#include "grpc/stream_reactors.hpp"
+#include "grpc/system_events.hpp"
+#include "hal/sensor_driver.hpp"
+#include "hal/step_frame_assembler.hpp"
+#include "hal/feature_extractor.hpp"
+#include "hal/baseline_recovery.hpp"
+#include "hal/baseline_tracker.hpp"
+#include "hal/fingerprint_assembler.hpp"
+#include "hal/inference_runner.hpp"
+#include "db/sensor_reading_repository.hpp"
+#include "db/sensor_baseline_repository.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace enose_grpc {
+
+/**
+ * @brief gRPC DataService 实现
+ *
+ * SubscribeSensorData: 把同一加热步的所有传感器读数合成一个 SensorFrame 推送,
+ * 并打上当前运行 ID / 实验阶段 / 气路状态标签. 配置了 SensorReadingRepository 时,
+ * 每帧 (无论有无订阅者) 同时入队写入 sensor_readings.
+ * SubscribeAnalysisResults: 每帧经 FeatureExtractor 增量计算各通道响应特征和质量标志,
+ * 按 SensorFrame.seq 推送; 气路连通气室的帧视为暴露阶段. 特征提取始终运行, 以保持基线连续.
+ * 漂移校正: 基线阶段 (按阶段名) 的帧由 BaselineTracker 更新各通道基线, 之后每帧按
+ * 参考基线校正, 校正值用于特征提取、SensorReading.drift_corrected 和 channels_corrected 列.
+ * 配置了 SensorBaselineRepository 时启动载入基线, 并定期写回有变化的通道.
+ * SubscribeFingerprints: 每个完整加热周期推送一个 加热步 × 传感器 的原始/标准化电阻矩阵
+ * (FingerprintAssembler, 步数跟随 HeaterCycleTracker 的加热配置长度).
+ * ExportFingerprints: 从 sensor_readings 按同样的规则重建历史运行的指纹矩阵.
+ * 配置了推理模型时, 每个完整周期的指纹交给 InferenceRunner (独立线程) 分类, 结果作为
+ * AnalysisResult (model 非空) 推送, 置信度足够时同时发布 ODOR_CLASSIFIED 系统事件.
+ */
+using DataServiceBase = ::enose::service::DataService::WithCallbackMethod_SubscribeFingerprints<
+    ::enose::service::DataService::WithCallbackMethod_SubscribeAnalysisResults<
+        ::enose::service::DataService::WithCallbackMethod_SubscribeSensorData<
+            ::enose::service::DataService::Service>>>;
+
+class DataServiceImpl final : public DataServiceBase {
+public:
+    /**
+     * @brief 帧标签 (在 io 线程上获取, 实现需线程安全且不阻塞)
+     */
+    struct FrameContext {
+        std::string run_id;
+        std::optional<int> db_run_id;   // runs.id
+        std::string phase_name;
+        ::enose::data::SensorFrame::GasMode gas_mode = ::enose::data::SensorFrame::GAS_MODE_UNSPECIFIED;
+    };
+    using ContextProvider = std::function<FrameContext()>;
+
+    /**
+     * @brief 特征提取与漂移校正参数
+     */
+    struct AnalysisOptions {
+        hal::FeatureConfig features;
+        hal::BaselineConfig baseline;
+        hal::FingerprintConfig fingerprint;
+        std::vector<std::string> baseline_phases{"baseline"};  // 不区分大小写
+        std::chrono::seconds persist_interval{60};
+        std::shared_ptr<db::SensorBaselineRepository> baseline_repo;
+        std::optional<hal::InferenceOptions> inference;     // 空 = 不做设备端分类
+        double min_confidence = 0.6;                        // ODOR_CLASSIFIED 事件的得分下限
+        std::shared_ptr<SystemEventBus> events;
+        std::shared_ptr<hal::BaselineRecoveryMonitor> recovery;   // 每帧更新基线偏离 (自适应清洗)
+    };
+
+    DataServiceImpl(std::shared_ptr<hal::SensorDriver> sensor,
+                    std::string device_id,
+                    ContextProvider context_provider = {},
+                    std::shared_ptr<db::SensorReadingRepository> reading_repo = nullptr,
+                    AnalysisOptions analysis = {});
+    ~DataServiceImpl();
+
+    ::grpc::ServerWriteReactor<::enose::data::SensorFrame>* SubscribeSensorData(
+        ::grpc::CallbackServerContext* context,
+        const ::google::protobuf::Empty* request) override;
+
+    ::grpc::ServerWriteReactor<::enose::data::AnalysisResult>* SubscribeAnalysisResults(
+        ::grpc::CallbackServerContext* context,
+        const ::google::protobuf::Empty* request) override;
+
+    ::grpc::ServerWriteReactor<::enose::data::FingerprintMatrix>* SubscribeFingerprints(
+        ::grpc::CallbackServerContext* context,
+        const ::google::protobuf::Empty* request) override;
+
+    // 同步流式接口 (逐页查询数据库, 在 gRPC 同步线程池上运行)
+    ::grpc::Status ExportFingerprints(
+        ::grpc::ServerContext* context,
+        const ::enose::service::ExportFingerprintsRequest* request,
+        ::grpc::ServerWriter<::enose::data::FingerprintMatrix>* writer) override;
+
+    static constexpr int EXPORT_PAGE_ROWS = 2000;
+
+    /**
+     * @brief 配置热加载: 替换特征阈值、漂移校正参数、基线阶段、写回间隔、事件得分下限
+     *        和推理的批量 / 队列上限
+     *
+     * 任意线程调用; 特征与基线参数在下一帧处理前于 io 线程上替换, 通道状态和已学到的基线保留.
+     * fingerprint 与 inference (模型、开关) 不在此替换: 指纹矩阵形状与模型输入一致, 需要重启.
+     */
+    void update_analysis(const AnalysisOptions& analysis);
+
+    /** @brief 导出各数据流订阅者和推理队列的统计 (抓取线程调用) */
+    void collect_metrics(core::MetricWriter& writer) const;
+
+private:
+    void on_step_frame(const hal::StepFrame& frame);
+    void persist_frame(const hal::StepFrame& frame, const FrameContext& ctx);
+    bool is_baseline_phase(const std::string& phase_name) const;
+    void load_baselines();
+    void persist_baselines();
+    void publish_analysis(const hal::FrameFeatures& features, const FrameContext& ctx);
+    void submit_inference(const hal::FingerprintMatrix& matrix, const FrameContext& ctx);
+    void publish_inference(const hal::InferenceResult& result);
+    void fill_fingerprint(const hal::FingerprintMatrix& matrix, ::enose::data::FingerprintMatrix* msg) const;
+    static void fill_reading(const hal::SensorSample& sample, ::enose::data::SensorReading* reading);
+
+    std::shared_ptr<hal::SensorDriver> sensor_;
+    std::string device_id_;
+    ContextProvider context_provider_;
+    std::shared_ptr<db::SensorReadingRepository> reading_repo_;
+
+    hal::StepFrameAssembler assembler_;
+    BroadcastHub<::enose::data::SensorFrame> frames_hub_{256};
+    hal::FeatureExtractor extractor_;
+    hal::BaselineTracker baseline_;
+    hal::StepFrame corrected_;      // 当前帧的漂移校正副本 (复用缓冲)
+    ::enose::data::SensorFrame frame_msg_;  // 发布用的帧消息 (复用: Clear() 保留 readings 元素)
+    bool frame_corrected_ = false;  // corrected_ 中是否有读数被校正过
+    std::vector<std::string> baseline_phases_;
+    std::chrono::seconds persist_interval_;
+    std::chrono::steady_clock::time_point next_persist_;
+    bool baselines_loaded_ = false;             // 连接池可用后首帧加载
+    std::shared_ptr<db::SensorBaselineRepository> baseline_repo_;
+    std::shared_ptr<hal::BaselineRecoveryMonitor> recovery_;
+    BroadcastHub<::enose::data::AnalysisResult> analysis_hub_{256};
+    hal::FingerprintConfig fingerprint_defaults_;   // 导出时未指定的参数
+    hal::FingerprintAssembler fingerprints_;
+    BroadcastHub<::enose::data::FingerprintMatrix> fingerprint_hub_{64};
+    std::shared_ptr<SystemEventBus> events_;
+    std::atomic<double> min_confidence_;        // 推理线程读取
+    // update_analysis 暂存的参数, 由 io 线程在下一帧前取走
+    struct PendingAnalysis {
+        hal::FeatureConfig features;
+        hal::BaselineConfig baseline;
+        std::vector<std::string> baseline_phases;
+        std::chrono::seconds persist_interval;
+    };
+    std::mutex pending_analysis_mutex_;
+    std::optional<PendingAnalysis> pending_analysis_;
+    std::atomic<bool> analysis_pending_{false};
+    std::unique_ptr<hal::InferenceRunner> inference_;   // 最后构造, 最先停止 (回调访问上面的成员)
+
+    boost::signals2::connection readings_connection_;
+    boost::signals2::connection link_connection_;
+};
+
+} // namespace enose_grpc
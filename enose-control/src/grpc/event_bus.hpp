@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace enose_grpc {
+
+/**
+ * @brief 多读者环形事件总线
+ *
+ * 与 BroadcastHub 不同, 事件只在总线上存一份: publish() 给事件分配递增的 seq
+ * (写回 T::set_seq) 并放入环形缓冲区, 各订阅者只持有自己的读游标, 发布开销与订阅者
+ * 数量无关 (仅逐个调用 notify). 慢读者被覆盖时游标跳到最旧的可用事件,
+ * 客户端通过 seq 跳号感知丢失; 重连时可从任意仍在缓冲区中的 seq 续读.
+ *
+ * 锁顺序: subscribers_mutex_ → (订阅者自己的锁) → ring_mutex_.
+ * notify 在持有 subscribers_mutex_ 时调用, unsubscribe() 返回后不会再被调用.
+ */
+template<typename T>
+class EventBus {
+public:
+    using Notify = std::function<void()>;
+
+    explicit EventBus(std::size_t capacity = 1024)
+        : slots_(std::max<std::size_t>(capacity, 2)) {}
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    /**
+     * @brief 发布一条事件, 返回分配的 seq (从 1 开始)
+     */
+    uint64_t publish(T event) {
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(ring_mutex_);
+            seq = ++last_seq_;
+            event.set_seq(seq);
+            slots_[seq % slots_.size()] = std::move(event);
+        }
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        for (auto& sub : subscribers_) {
+            sub.notify();
+        }
+        return seq;
+    }
+
+    /**
+     * @brief 读取 seq >= cursor 的第一条事件并前移游标
+     * @param cursor  期望的下一个 seq; 已被覆盖时跳到最旧的可用事件
+     * @param skipped 可选, 累加因覆盖而跳过的事件数
+     * @return false 表示没有新事件
+     */
+    bool read(uint64_t& cursor, T& out, uint64_t* skipped = nullptr) const {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        if (cursor > last_seq_) return false;
+
+        uint64_t oldest = oldest_seq_locked();
+        if (cursor < oldest) {
+            if (skipped) *skipped += oldest - cursor;
+            cursor = oldest;
+        }
+        out = slots_[cursor % slots_.size()];
+        ++cursor;
+        return true;
+    }
+
+    /** @brief 最新事件的 seq (尚无事件时为 0) */
+    uint64_t last_seq() const {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        return last_seq_;
+    }
+
+    /**
+     * @brief 注册新事件 / 关闭通知, 返回订阅 ID
+     */
+    uint64_t subscribe(Notify notify) {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        uint64_t id = next_subscriber_id_++;
+        subscribers_.push_back({id, std::move(notify)});
+        return id;
+    }
+
+    void unsubscribe(uint64_t id) {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                          [id](const Subscriber& s) { return s.id == id; }),
+                           subscribers_.end());
+    }
+
+    std::size_t subscriber_count() const {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        return subscribers_.size();
+    }
+
+    /**
+     * @brief 关闭总线 (服务停止时让各流在读完后结束)
+     */
+    void close_all() {
+        std::lock_guard<std::mutex> lock(subscribers_mutex_);
+        {
+            std::lock_guard<std::mutex> ring_lock(ring_mutex_);
+            closed_ = true;
+        }
+        for (auto& sub : subscribers_) {
+            sub.notify();
+        }
+    }
+
+    bool closed() const {
+        std::lock_guard<std::mutex> lock(ring_mutex_);
+        return closed_;
+    }
+
+private:
+    struct Subscriber {
+        uint64_t id;
+        Notify notify;
+    };
+
+    uint64_t oldest_seq_locked() const {
+        return last_seq_ >= slots_.size() ? last_seq_ - slots_.size() + 1 : 1;
+    }
+
+    mutable std::mutex ring_mutex_;
+    std::vector<T> slots_;
+    uint64_t last_seq_ = 0;
+    bool closed_ = false;
+
+    mutable std::mutex subscribers_mutex_;
+    std::vector<Subscriber> subscribers_;
+    uint64_t next_subscriber_id_ = 1;
+};
+
+} // namespace enose_grpc
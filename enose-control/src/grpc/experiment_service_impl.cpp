@@ -3,37 +3,154 @@
 #include "../workflows/transaction_guard.hpp"
 #include "../workflows/executors/executors.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <google/protobuf/util/json_util.h>
 #include <google/protobuf/util/time_util.h>
 
 namespace grpc_service {
 
 namespace experiment = ::enose::experiment;
 
+namespace {
+constexpr auto MODEL_RECALIBRATE_INTERVAL = std::chrono::minutes(10);
+constexpr int QUEUE_RECENT_ENTRIES = 20;
+// 检查点最短间隔: 中断后最多重做这段时间内完成的步骤和中断的步骤
+// (进样 / 清洗开始前和排废完成后不受此限制, 见 execute_plan)
+constexpr auto CHECKPOINT_INTERVAL = std::chrono::seconds(10);
+
+bool changes_bottle(experiment::Step::ActionCase action) {
+    return action == experiment::Step::kInject || action == experiment::Step::kWash;
+}
+
+// LoadProgramRequest / EnqueueProgramRequest: YAML 字符串或结构化程序
+template <typename Request>
+bool read_program(const Request& request, experiment::ExperimentProgram& program, std::string& error) {
+    if (request.has_yaml_content()) {
+        // 直接解析进 (Arena 上的) 目标消息, 不经过中间结果再复制
+        std::string parse_error;
+        if (!enose::workflows::YamlParser::parse_into(request.yaml_content(), program, parse_error)) {
+            error = "YAML 解析失败: " + parse_error;
+            return false;
+        }
+        return true;
+    }
+    if (request.has_program()) {
+        // 请求由 gRPC 持有, 只能复制一次; 目标在 Arena 上时复制只做块内分配
+        program.CopyFrom(request.program());
+        return true;
+    }
+    error = "请求中没有程序数据";
+    return false;
+}
+
+experiment::QueueEntryState queue_entry_state(const std::string& state) {
+    if (state == "queued") return experiment::QUEUE_QUEUED;
+    if (state == "running") return experiment::QUEUE_RUNNING;
+    if (state == "completed") return experiment::QUEUE_COMPLETED;
+    if (state == "error") return experiment::QUEUE_ERROR;
+    if (state == "aborted") return experiment::QUEUE_ABORTED;
+    if (state == "cancelled") return experiment::QUEUE_CANCELLED;
+    if (state == "rejected") return experiment::QUEUE_REJECTED;
+    return experiment::QUEUE_ENTRY_STATE_UNSPECIFIED;
+}
+
+google::protobuf::Timestamp to_timestamp(std::chrono::system_clock::time_point tp) {
+    return google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+        std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count());
+}
+
+void fill_queue_entry(const db::QueueEntryRecord& record, experiment::QueueEntry* entry) {
+    entry->set_id(record.id);
+    entry->set_name(record.name);
+    entry->set_program_id(record.program_id);
+    entry->set_priority(record.priority);
+    entry->set_state(queue_entry_state(record.state));
+    *entry->mutable_created_at() = to_timestamp(record.created_at);
+    if (record.started_at) *entry->mutable_started_at() = to_timestamp(*record.started_at);
+    if (record.completed_at) *entry->mutable_completed_at() = to_timestamp(*record.completed_at);
+    entry->set_run_id(record.run_id.value_or(0));
+    entry->set_error_message(record.error_message);
+    entry->set_estimated_duration_s(record.estimated_duration_s);
+}
+} // namespace
+
 ExperimentServiceImpl::ExperimentServiceImpl(
     std::shared_ptr<workflows::SystemState> system_state,
     std::shared_ptr<hal::LoadCellDriver> load_cell,
     std::shared_ptr<hal::SensorDriver> sensor_driver,
-    std::shared_ptr<db::ConsumableRepository> consumable_repo)
+    std::shared_ptr<db::ConsumableCache> consumable_cache,
+    std::shared_ptr<db::TestRunRepository> run_repo,
+    std::shared_ptr<enose_grpc::SystemEventBus> system_events)
     : system_state_(std::move(system_state))
     , load_cell_(std::move(load_cell))
     , sensor_driver_(std::move(sensor_driver))
-    , consumable_repo_(std::move(consumable_repo)) {
+    , consumable_cache_(std::move(consumable_cache))
+    , run_repo_(std::move(run_repo))
+    , system_events_(std::move(system_events)) {
     
     // Phase 3: 初始化 Action Executors
     init_executors();
     
+    // 上次进程退出时仍在运行的实验: 有检查点的可通过 ResumeRun 续跑
+    if (run_repo_) {
+        run_repo_->mark_interrupted();
+        for (const auto& record : run_repo_->list_resumable()) {
+            spdlog::warn("可续跑的中断实验: run_id={}, 已完成 {}/{} 步",
+                         record.id, record.current_step, record.total_steps);
+        }
+    }
+    
+    // 实验队列与 runs 表在同一数据库
+    if (run_repo_) {
+        queue_repo_ = std::make_shared<db::ExperimentQueueRepository>();
+        queue_repo_->abort_stale();
+    }
+    
     spdlog::info("ExperimentService 初始化完成");
 }
 
 ExperimentServiceImpl::~ExperimentServiceImpl() {
-    // 停止执行线程
-    stop_requested_ = true;
-    pause_cv_.notify_all();
-    event_cv_.notify_all();
+    // 停止执行线程 (不再启动队列中的下一个实验)
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_running_ = false;
+    }
+    token_->request_stop();
+    events_bus_.close_all();
     
-    if (execution_thread_ && execution_thread_->joinable()) {
-        execution_thread_->join();
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        if (execution_thread_ && execution_thread_->joinable()) {
+            execution_thread_->join();
+        }
+    }
+    
+    // 预取任务用到执行器, 在成员析构前等它结束
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (prefetched_.valid()) prefetched_.wait();
+}
+
+ExperimentServiceImpl::RunContext ExperimentServiceImpl::run_context() const {
+    std::lock_guard<std::mutex> lock(context_mutex_);
+    return run_context_;
+}
+
+void ExperimentServiceImpl::collect_metrics(core::MetricWriter& writer) const {
+    if (scheduler_) {
+        auto stats = scheduler_->stats();
+        writer.counter("workflow_steps_total", "Execution plan steps issued", static_cast<double>(stats.steps_run));
+        writer.counter("workflow_steps_overlapped_total", "Steps issued while an earlier step was still running",
+                       static_cast<double>(stats.steps_overlapped));
     }
+
+    auto cache = program_cache_.stats();
+    writer.counter("workflow_program_cache_hits_total", "Compiled program cache hits", static_cast<double>(cache.hits));
+    writer.counter("workflow_program_cache_misses_total", "Compiled program cache misses", static_cast<double>(cache.misses));
+    writer.counter("workflow_program_cache_evictions_total", "Compiled program cache evictions",
+                   static_cast<double>(cache.evictions));
+    writer.gauge("workflow_program_cache_entries", "Compiled programs held in the cache", static_cast<double>(cache.size));
+
+    writer.counter("experiment_events_total", "Experiment events published", static_cast<double>(events_bus_.last_seq()));
 }
 
 ::grpc::Status ExperimentServiceImpl::ValidateProgram(
@@ -41,10 +158,20 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     const experiment::ValidateProgramRequest* request,
     experiment::ValidationResult* response) {
     
-    spdlog::info("收到验证请求: {}", request->program().id());
-    
-    auto result = validator_.validate(request->program());
-    *response = enose::workflows::ExperimentValidator::to_proto(result);
+    spdlog::debug("收到验证请求: {}", request->program().id());
+    
+    // 编辑器每次输入都会验证, 相同内容直接返回缓存的结果
+    std::string read_error;
+    auto entry = compile_program(*request, read_error);
+    if (!entry) {
+        enose::workflows::ValidationResultInfo result{};
+        result.valid = false;
+        result.errors.push_back({"", "PARSE_ERROR", read_error,
+                                 enose::workflows::ValidationErrorInfo::Severity::ERROR});
+        *response = enose::workflows::ExperimentValidator::to_proto(result);
+        return ::grpc::Status::OK;
+    }
+    *response = enose::workflows::ExperimentValidator::to_proto(entry->validation);
     
     return ::grpc::Status::OK;
 }
@@ -63,30 +190,18 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
         return ::grpc::Status::OK;
     }
     
-    // 获取程序 (支持 YAML 字符串或结构化程序)
-    experiment::ExperimentProgram program;
-    
-    if (request->has_yaml_content()) {
-        spdlog::info("从 YAML 加载实验程序");
-        auto parse_result = enose::workflows::YamlParser::parse(request->yaml_content());
-        if (!parse_result.success) {
-            response->set_success(false);
-            response->set_error_message("YAML 解析失败: " + parse_result.error_message);
-            return ::grpc::Status::OK;
-        }
-        program = std::move(parse_result.program);
-    } else if (request->has_program()) {
-        program = request->program();
-    } else {
+    // 获取程序 (支持 YAML 字符串或结构化程序), 解析 + 验证 + 编译, 相同内容命中缓存
+    std::string read_error;
+    auto entry = compile_program(*request, read_error);
+    if (!entry) {
         response->set_success(false);
-        response->set_error_message("请求中没有程序数据");
+        response->set_error_message(read_error);
         return ::grpc::Status::OK;
     }
     
-    spdlog::info("加载实验程序: {}", program.id());
+    spdlog::info("加载实验程序: {}", entry->program->id());
     
-    // 验证程序
-    validation_result_ = validator_.validate(program);
+    validation_result_ = entry->validation;
     *response->mutable_validation() = enose::workflows::ExperimentValidator::to_proto(validation_result_);
     
     if (!validation_result_.valid) {
@@ -96,8 +211,17 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
         return ::grpc::Status::OK;
     }
     
-    // 保存程序
-    loaded_program_ = std::make_unique<experiment::ExperimentProgram>(std::move(program));
+    if (!entry->compile_error.empty()) {
+        response->set_success(false);
+        response->set_error_message("执行计划编译失败: " + entry->compile_error);
+        state_ = experiment::EXP_IDLE;
+        return ::grpc::Status::OK;
+    }
+    
+    // 保存程序 (计划中的步骤指向共享的程序, 复制计划后仍然有效)
+    loaded_program_ = entry->program;
+    plan_ = entry->plan;
+    plan_pc_ = 0;
     state_ = experiment::EXP_LOADED;
     response->set_success(true);
     
@@ -113,7 +237,7 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     const google::protobuf::Empty* request,
     experiment::ExperimentStatusResponse* response) {
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
     
     if (state_ != experiment::EXP_LOADED) {
         fill_status_response(response);
@@ -123,26 +247,86 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     
     spdlog::info("启动实验: {}", loaded_program_->id());
     
+    const std::string run_config = begin_run_locked();
+    const std::size_t plan_steps = plan_.size();
+    
+    // 启动执行线程 (mutex_ 释放后: 等待上一个执行线程退出时不能持有 mutex_)
+    state_ = experiment::EXP_RUNNING;
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        ++active_threads_;
+    }
+    
+    emit_event(experiment::ExperimentEvent::EXPERIMENT_STARTED, "实验已启动");
+    
+    fill_status_response(response);
+    lock.unlock();
+    
+    // 执行线程启动前登记, 第一步的数据即可按 run_id 关联
+    register_run(run_config, plan_steps);
+    launch_execution_thread(false);
+    return ::grpc::Status::OK;
+}
+
+std::string ExperimentServiceImpl::begin_run_locked() {
     // 重置状态
-    stop_requested_ = false;
-    pause_requested_ = false;
+    token_->reset();
+    plan_pc_ = 0;
     current_step_index_ = 0;
     current_step_name_.clear();
     loop_iteration_ = 0;
     loop_total_ = 0;
-    logs_.clear();
+    logs_->clear();
     error_message_.clear();
+    run_consumed_ml_.fill(0);
+    started_ahead_.clear();
+    step_consumed_.clear();
+    prepared_inject_.reset();
     start_time_ = std::chrono::steady_clock::now();
+    last_checkpoint_ = start_time_;
     
-    // 启动执行线程
-    state_ = experiment::EXP_RUNNING;
-    execution_thread_ = std::make_unique<std::thread>(
-        &ExperimentServiceImpl::execution_thread_func, this);
+    auto epoch_s = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
     
-    emit_event(experiment::ExperimentEvent::EXPERIMENT_STARTED, "实验已启动");
+    {
+        std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+        run_context_.run_id = loaded_program_->id() + "_" + std::to_string(epoch_s);
+        run_context_.db_run_id.reset();
+        run_context_.phase_name.clear();
+        current_phase_.clear();
+    }
     
-    fill_status_response(response);
-    return ::grpc::Status::OK;
+    // runs 表登记的配置; 保存完整程序供中断后续跑
+    if (!run_repo_) return {};
+    nlohmann::json run_config = {
+        {"type", "experiment"},
+        {"program_id", loaded_program_->id()},
+        {"program_name", loaded_program_->name()},
+    };
+    std::string program_json;
+    if (google::protobuf::util::MessageToJsonString(*loaded_program_, &program_json).ok()) {
+        run_config["program"] = nlohmann::json::parse(program_json, nullptr, false);
+    }
+    return run_config.dump();
+}
+
+std::optional<int> ExperimentServiceImpl::register_run(const std::string& run_config, std::size_t plan_steps) {
+    // 在 runs 表登记, 使 sensor_readings 可按 run_id 关联
+    if (!run_repo_ || run_config.empty()) return std::nullopt;
+    auto db_run_id = run_repo_->create_run(run_config, static_cast<int>(plan_steps));
+    std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+    run_context_.db_run_id = db_run_id;
+    return db_run_id;
+}
+
+void ExperimentServiceImpl::launch_execution_thread(bool from_queue) {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    // 上一个执行线程已经 (或即将) 退出, 先回收
+    if (execution_thread_ && execution_thread_->joinable()) {
+        execution_thread_->join();
+    }
+    execution_thread_ = std::make_unique<std::thread>(
+        &ExperimentServiceImpl::execution_thread_func, this, from_queue);
 }
 
 ::grpc::Status ExperimentServiceImpl::StopExperiment(
@@ -158,22 +342,17 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
         state_ == experiment::EXP_ERROR ||
         state_ == experiment::EXP_ABORTED) {
         spdlog::info("卸载程序 (当前状态: {})", static_cast<int>(state_));
+        plan_.clear();
         loaded_program_.reset();
         state_ = experiment::EXP_IDLE;
         // 重置执行状态
+        plan_pc_ = 0;
         current_step_index_ = 0;
         current_step_name_.clear();
         loop_iteration_ = 0;
         loop_total_ = 0;
         error_message_.clear();
-        // 注意: 不能在持有 mutex_ 的情况下调用 add_log (会死锁)
-        // 直接添加日志
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        char buf[64];
-        std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time_t));
-        logs_.push_back(std::string(buf) + " 程序已卸载");
-        if (logs_.size() > 100) logs_.erase(logs_.begin());
+        add_log("程序已卸载");
         
         fill_status_response(response);
         return ::grpc::Status::OK;
@@ -188,8 +367,7 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     // 如果是运行中/暂停状态，请求停止
     if (state_ == experiment::EXP_RUNNING || state_ == experiment::EXP_PAUSED) {
         spdlog::info("停止实验");
-        stop_requested_ = true;
-        pause_cv_.notify_all();
+        token_->request_stop();
         state_ = experiment::EXP_ABORTING;
         emit_event(experiment::ExperimentEvent::EXPERIMENT_STOPPED, "实验已停止");
     }
@@ -212,7 +390,7 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     
     spdlog::info("暂停实验");
     
-    pause_requested_ = true;
+    token_->request_pause();
     state_ = experiment::EXP_PAUSED;
     
     emit_event(experiment::ExperimentEvent::EXPERIMENT_PAUSED, "实验已暂停");
@@ -235,9 +413,8 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
     
     spdlog::info("恢复实验");
     
-    pause_requested_ = false;
+    token_->resume();
     state_ = experiment::EXP_RUNNING;
-    pause_cv_.notify_all();
     
     emit_event(experiment::ExperimentEvent::EXPERIMENT_RESUMED, "实验已恢复");
     
@@ -247,71 +424,69 @@ ExperimentServiceImpl::~ExperimentServiceImpl() {
 
 ::grpc::Status ExperimentServiceImpl::GetExperimentStatus(
     ::grpc::ServerContext* context,
-    const google::protobuf::Empty* request,
+    const experiment::GetExperimentStatusRequest* request,
     experiment::ExperimentStatusResponse* response) {
     
     std::lock_guard<std::mutex> lock(mutex_);
-    fill_status_response(response);
+    fill_status_response(response, request->after_log_index());
     return ::grpc::Status::OK;
 }
 
-::grpc::Status ExperimentServiceImpl::SubscribeExperimentEvents(
-    ::grpc::ServerContext* context,
-    const google::protobuf::Empty* request,
-    ::grpc::ServerWriter<experiment::ExperimentEvent>* writer) {
-    
-    spdlog::info("新的事件订阅者");
-    subscriber_count_++;
+::grpc::ServerWriteReactor<experiment::ExperimentEvent>* ExperimentServiceImpl::SubscribeExperimentEvents(
+    ::grpc::CallbackServerContext* context,
+    const experiment::SubscribeExperimentEventsRequest* request) {
+    enose_grpc::apply_stream_compression(context);
+    
+    return new enose_grpc::BusWriteReactor<experiment::ExperimentEvent>(
+        events_bus_, context->peer(), "ExperimentService.SubscribeExperimentEvents",
+        request->resume_after_seq());
+}
+
+void ExperimentServiceImpl::execution_thread_func(bool from_queue) {
+    spdlog::info("实验执行线程启动");
     
-    while (!context->IsCancelled()) {
-        experiment::ExperimentEvent event;
-        {
-            std::unique_lock<std::mutex> lock(event_mutex_);
-            event_cv_.wait_for(lock, std::chrono::seconds(1), [this] {
-                return !event_queue_.empty() || stop_requested_;
-            });
-            
-            if (stop_requested_ && event_queue_.empty()) {
-                break;
-            }
-            
-            if (event_queue_.empty()) {
-                continue;
-            }
-            
-            event = std::move(event_queue_.front());
-            event_queue_.pop();
-        }
-        
-        if (!writer->Write(event)) {
-            break;
-        }
+    bool run = !from_queue || start_next_queued();
+    bool recover_baseline = false;
+    while (run) {
+        run_loaded_program(recover_baseline);
+        // 连续执行: 下一个实验已在本次执行期间验证并编译
+        run = start_next_queued();
+        recover_baseline = true;
     }
     
-    subscriber_count_--;
-    spdlog::info("事件订阅者断开");
-    return ::grpc::Status::OK;
+    spdlog::info("实验执行线程结束");
 }
 
-void ExperimentServiceImpl::execution_thread_func() {
-    spdlog::info("实验执行线程启动");
-    
+void ExperimentServiceImpl::run_loaded_program(bool recover_baseline) {
     try {
-        execute_steps(loaded_program_->steps());
+        // 两次连续实验之间只等待传感器基线恢复
+        if (recover_baseline) {
+            experiment::SetQueueRunningRequest settings;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                settings = queue_settings_;
+            }
+            if (settings.baseline_timeout_s() > 0) {
+                add_log("等待基线恢复");
+                wait_for_sensor_stability(settings.baseline_window_s(), settings.baseline_threshold_percent(),
+                                          settings.baseline_timeout_s());
+            }
+        }
+        
+        execute_plan();
         
         // 检查是否被中止
-        // 注意: 不能在持有 mutex_ 的情况下调用 add_log (会死锁)
         bool was_stopped = false;
         {
             std::lock_guard<std::mutex> lock(mutex_);
-            was_stopped = stop_requested_;
+            was_stopped = token_->stop_requested();
             if (was_stopped) {
                 state_ = experiment::EXP_ABORTED;
             } else {
                 state_ = experiment::EXP_COMPLETED;
             }
         }
-        // 在 mutex_ 释放后调用 add_log 和 emit_event
+        // 记录结果并发送事件
         if (was_stopped) {
             add_log("实验已中止");
         } else {
@@ -331,41 +506,144 @@ void ExperimentServiceImpl::execution_thread_func() {
         spdlog::error("实验执行错误: {}", err_msg);
     }
     
+    std::optional<int> finished_run_id;
+    {
+        std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+        finished_run_id = run_context_.db_run_id;
+        run_context_ = {};
+        current_phase_.clear();
+    }
+    std::string run_state;
+    std::string run_error;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        run_state = state_ == experiment::EXP_COMPLETED ? "completed"
+                  : state_ == experiment::EXP_ABORTED ? "aborted" : "error";
+        run_error = error_message_;
+    }
+    if (run_repo_ && finished_run_id) {
+        run_repo_->complete_run(*finished_run_id, run_state);
+    }
+    
+    // 队列项随实验结束; 中止或出错时停止连续执行, 等操作员处理后再 SetQueueRunning
+    std::optional<int64_t> finished_entry;
+    bool queue_stopped = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        finished_entry = std::exchange(current_queue_entry_, std::nullopt);
+        if (run_state != "completed" && queue_running_) {
+            queue_running_ = false;
+            queue_stopped = true;
+        }
+    }
+    if (queue_repo_ && finished_entry) {
+        queue_repo_->finish(*finished_entry, run_state, run_error);
+    }
+    if (queue_stopped) {
+        add_log("实验未正常完成, 队列已停止");
+    }
+    
     // 恢复系统状态
     system_state_->transition_to(workflows::SystemState::State::INITIAL);
-    
-    spdlog::info("实验执行线程结束");
 }
 
-void ExperimentServiceImpl::execute_steps(
-    const google::protobuf::RepeatedPtrField<experiment::Step>& steps) {
+void ExperimentServiceImpl::execute_plan() {
+    std::size_t begin;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        begin = plan_pc_;
+    }
     
-    for (int i = 0; i < steps.size(); ++i) {
-        if (check_stop_or_pause()) return;
-        
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            current_step_index_ = i;
-            current_step_name_ = steps[i].name();
-        }
-        
-        execute_step(steps[i]);
+    // 资源不相交的非屏障步骤可重叠执行; plan_pc_ 只推进到连续完成的前缀,
+    // 暂停 / 断点续跑从第一个未完成的步骤开始
+    scheduler_->run(
+        begin, plan_.size(),
+        [this](std::size_t pc) { return plan_.slot(pc); },
+        [this](std::size_t pc) {
+            publish_running_step(pc, true);
+            // 进样 / 清洗改变瓶中液体量: 开始前写入回退到排废步骤的检查点,
+            // 执行期间 (或之后未排废前) 中断时续跑不会在未排空的瓶中重复加液
+            if (changes_bottle(plan_.action(pc))) {
+                save_checkpoint(true);
+            }
+            try {
+                execute_plan_step(plan_[pc]);
+            } catch (...) {
+                publish_running_step(pc, false);
+                throw;
+            }
+            publish_running_step(pc, false);
+        },
+        [this] { return check_stop_or_pause(); },
+        [this](std::size_t completed) {
+            bool drained = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (std::size_t pc = plan_pc_; pc < completed; ++pc) {
+                    drained |= plan_.action(pc) == experiment::Step::kDrain;
+                }
+                plan_pc_ = completed;
+                started_ahead_.erase(started_ahead_.begin(), started_ahead_.lower_bound(completed));
+            }
+            // 排废完成后立即写入, 之后中断不必再回退到更早的排废
+            save_checkpoint(drained);
+            // 步骤边界: 账本中的消耗批量提交
+            if (consumable_cache_) consumable_cache_->flush_ledger();
+        });
+    
+    auto stats = scheduler_->stats();
+    spdlog::debug("执行计划调度: 累计 {} 步, 其中 {} 步与前序步骤重叠",
+                  stats.steps_run, stats.steps_overlapped);
+}
+
+void ExperimentServiceImpl::publish_running_step(std::size_t pc, bool started) {
+    // 重叠执行时 (如 SetGasPump 与进样 / 排液并行) 短步骤不能改写长步骤的标识:
+    // 始终发布最早的在执行步骤, 其结束后轮到下一个。
+    // 两把锁按 mutex_ -> context_mutex_ 的顺序一起持有, 发布不会交错
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started) {
+        running_pcs_.insert(pc);
+        started_ahead_.insert(pc);
+    } else {
+        running_pcs_.erase(pc);
     }
+    if (running_pcs_.empty()) return;
+    
+    const auto& step = plan_[*running_pcs_.begin()];
+    current_step_index_ = step.top_level_index;
+    current_step_name_ = step.step->name();
+    loop_iteration_ = step.loop_iteration;
+    loop_total_ = step.loop_total;
+    
+    std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+    run_context_.phase_name = current_phase_.empty() ? step.step->name() : current_phase_;
+    run_context_.step_id = step.id;
 }
 
-void ExperimentServiceImpl::execute_step(const experiment::Step& step) {
+void ExperimentServiceImpl::execute_plan_step(const enose::workflows::PlanStep& plan_step) {
+    const auto& step = *plan_step.step;
+    
+    for (const auto& loop : plan_step.loops_entered) {
+        if (loop.iteration == 1) {
+            add_log("循环开始: " + std::to_string(loop.total) + "次");
+        }
+        add_log("循环迭代: " + std::to_string(loop.iteration) + "/" + std::to_string(loop.total));
+        emit_event(experiment::ExperimentEvent::LOOP_ITERATION,
+                  "迭代 " + std::to_string(loop.iteration));
+    }
+    
     add_log("执行步骤: " + step.name());
     emit_event(experiment::ExperimentEvent::STEP_STARTED, step.name());
     
-    switch (step.action_case()) {
+    switch (plan_step.action) {
         case experiment::Step::kInject:
-            execute_inject(step.inject());
+            execute_inject(step.inject(), plan_step.inject, plan_step.index);
             break;
         case experiment::Step::kWait:
             execute_wait(step.wait());
             break;
         case experiment::Step::kDrain:
-            execute_drain(step.drain());
+            execute_drain(step.drain(), plan_step.index);
             break;
         case experiment::Step::kAcquire:
             execute_acquire(step.acquire());
@@ -376,9 +654,6 @@ void ExperimentServiceImpl::execute_step(const experiment::Step& step) {
         case experiment::Step::kSetGasPump:
             execute_set_gas_pump(step.set_gas_pump());
             break;
-        case experiment::Step::kLoop:
-            execute_loop(step.loop());
-            break;
         case experiment::Step::kPhaseMarker:
             execute_phase_marker(step.phase_marker());
             break;
@@ -386,6 +661,7 @@ void ExperimentServiceImpl::execute_step(const experiment::Step& step) {
             execute_wash(step.wash());
             break;
         default:
+            // 循环 / 扫描在编译时已展开
             spdlog::warn("未知的步骤动作类型");
             break;
     }
@@ -393,7 +669,9 @@ void ExperimentServiceImpl::execute_step(const experiment::Step& step) {
     emit_event(experiment::ExperimentEvent::STEP_COMPLETED, step.name());
 }
 
-void ExperimentServiceImpl::execute_inject(const experiment::InjectAction& action) {
+void ExperimentServiceImpl::execute_inject(const experiment::InjectAction& action,
+                                           const workflows::SystemState::InjectionParams& params,
+                                           std::size_t pc) {
     add_log("进样: 目标量=" + std::to_string(action.target_volume_ml()) + "ml");
     
     // 使用事务守卫保证状态一致性 (Phase 1.3)
@@ -403,82 +681,84 @@ void ExperimentServiceImpl::execute_inject(const experiment::InjectAction& actio
         "inject"
     );
     
-    // 计算每个泵的进样量
+    // 各泵行程与速度已在编译执行计划时按液体→泵映射换算
     double total_volume = action.target_volume_ml();
-    workflows::SystemState::InjectionParams params;
-    params.speed = action.flow_rate_ml_min() / 60.0 * 1000;  // 转换为 mm/s (假设 1ml ≈ 1000mm)
-    params.accel = params.speed * 2;  // 默认加速度
     
-    // 根据液体配方设置各泵进样量
-    for (const auto& comp : action.components()) {
-        double volume_mm = total_volume * comp.ratio() * 1000;  // ml to mm
-        
-        // 查找液体对应的泵
-        for (const auto& liquid : loaded_program_->hardware().liquids()) {
-            if (liquid.id() == comp.liquid_id()) {
-                switch (liquid.pump_index()) {
-                    case 2: params.pump_2_volume = volume_mm; break;
-                    case 3: params.pump_3_volume = volume_mm; break;
-                    case 4: params.pump_4_volume = volume_mm; break;
-                    case 5: params.pump_5_volume = volume_mm; break;
-                }
-                break;
+    // pump volume 单位是 mm，转换为 ml: 约 0.1 ml/mm，可根据实际泵管校准
+    constexpr double MM_TO_ML = 0.1;  // 1mm 进样距离 ≈ 0.1ml 液体
+    const std::array<float, 8> pump_volumes = {
+        params.pump_0_volume, params.pump_1_volume, params.pump_2_volume, params.pump_3_volume,
+        params.pump_4_volume, params.pump_5_volume, params.pump_6_volume, params.pump_7_volume,
+    };
+    
+    // 余量检查按账本叠加后的实时余量 (不访问数据库); 不足只告警, 程序级的充足性已在验证时检查
+    if (consumable_cache_) {
+        for (std::size_t i = 0; i < pump_volumes.size(); ++i) {
+            if (pump_volumes[i] <= 0) continue;
+            const auto available = consumable_cache_->available_ml(static_cast<int>(i));
+            if (available && *available < pump_volumes[i] * MM_TO_ML) {
+                add_log("泵 " + std::to_string(i) + " 余量不足: 需要 " +
+                        std::to_string(pump_volumes[i] * MM_TO_ML) + "ml, 剩余 " + std::to_string(*available) + "ml");
             }
         }
     }
     
-    // 启动进样
-    system_state_->start_inject(params);
+    // 启动进样 (前一步排废时预注册过泵则沿用)
+    uint64_t prepared = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (prepared_inject_ && prepared_inject_->first == pc) {
+            prepared = prepared_inject_->second;
+        }
+        prepared_inject_.reset();
+    }
+    // 单泵进样 (无论按 ml 还是按重量指定, 此时都已换算为行程 mm) 以称得的重量变化修正该泵的标定;
+    // 进样前重量不稳定或多泵混合时 observe_injection 自行放弃
+    load_cell_->observe_injection(pump_volumes);
+    system_state_->start_inject(params, prepared);
     
     // 等待进样完成 (通过称重反馈)
     double target_weight = action.has_target_weight_g() ? 
                           action.target_weight_g() : 
                           total_volume;  // 假设密度≈1
     double tolerance = action.tolerance();
-    auto timeout = std::chrono::seconds(static_cast<int>(action.stable_timeout_s()));
+    auto timeout = std::chrono::duration<double>(action.stable_timeout_s());
     auto start = std::chrono::steady_clock::now();
     
-    while (!check_stop_or_pause()) {
-        float current_weight = load_cell_->get_filtered_weight();
-        if (current_weight >= target_weight - tolerance) {
-            add_log("进样完成: " + std::to_string(current_weight) + "g");
-            break;
-        }
-        
-        if (std::chrono::steady_clock::now() - start > timeout) {
-            add_log("进样超时");
-            break;
+    auto status = workflows::WaitSet(token_)
+        .notify_on(load_cell_->on_status_update)
+        .wait_for(timeout, [&] {
+            return load_cell_->get_filtered_weight() >= target_weight - tolerance;
+        });
+    
+    if (status == workflows::WaitStatus::READY) {
+        add_log("进样完成: " + std::to_string(load_cell_->get_filtered_weight()) + "g");
+    } else if (status == workflows::WaitStatus::TIMEOUT) {
+        add_log("进样超时");
+    }
+    
+    {
+        // 本次运行的消耗量 (检查点); 按步骤另记一份, 检查点据此扣除续跑时会重做的进样
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& consumed = step_consumed_[pc];
+        for (std::size_t i = 0; i < run_consumed_ml_.size(); ++i) {
+            consumed[i] = pump_volumes[i] * MM_TO_ML;
+            run_consumed_ml_[i] += consumed[i];
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
     
     // 计算进样时间并更新耗材统计
     auto inject_duration = std::chrono::steady_clock::now() - start;
     int64_t inject_seconds = std::chrono::duration_cast<std::chrono::seconds>(inject_duration).count();
     
-    if (consumable_repo_ && inject_seconds > 0) {
-        // 记录每个使用的泵的运行时间
-        if (params.pump_0_volume > 0) consumable_repo_->add_runtime("pump_tube_0", inject_seconds);
-        if (params.pump_1_volume > 0) consumable_repo_->add_runtime("pump_tube_1", inject_seconds);
-        if (params.pump_2_volume > 0) consumable_repo_->add_runtime("pump_tube_2", inject_seconds);
-        if (params.pump_3_volume > 0) consumable_repo_->add_runtime("pump_tube_3", inject_seconds);
-        if (params.pump_4_volume > 0) consumable_repo_->add_runtime("pump_tube_4", inject_seconds);
-        if (params.pump_5_volume > 0) consumable_repo_->add_runtime("pump_tube_5", inject_seconds);
-        if (params.pump_6_volume > 0) consumable_repo_->add_runtime("pump_tube_6", inject_seconds);
-        if (params.pump_7_volume > 0) consumable_repo_->add_runtime("pump_tube_7", inject_seconds);
+    if (consumable_cache_ && inject_seconds > 0) {
+        // 只记入内存账本, 由账本线程在步骤边界批量提交, 不阻塞实验线程
+        for (std::size_t i = 0; i < pump_volumes.size(); ++i) {
+            if (pump_volumes[i] <= 0) continue;
+            consumable_cache_->record_runtime("pump_tube_" + std::to_string(i), inject_seconds);
+            consumable_cache_->record_pump_consumption(static_cast<int>(i), pump_volumes[i] * MM_TO_ML);
+        }
         spdlog::debug("记录泵运行时间: {}秒", inject_seconds);
-        
-        // 记录液体消耗量 (pump volume 单位是 mm，转换为 ml: 约 0.1 ml/mm，可根据实际泵管校准)
-        constexpr double MM_TO_ML = 0.1;  // 1mm 进样距离 ≈ 0.1ml 液体
-        if (params.pump_0_volume > 0) consumable_repo_->add_pump_consumption(0, params.pump_0_volume * MM_TO_ML);
-        if (params.pump_1_volume > 0) consumable_repo_->add_pump_consumption(1, params.pump_1_volume * MM_TO_ML);
-        if (params.pump_2_volume > 0) consumable_repo_->add_pump_consumption(2, params.pump_2_volume * MM_TO_ML);
-        if (params.pump_3_volume > 0) consumable_repo_->add_pump_consumption(3, params.pump_3_volume * MM_TO_ML);
-        if (params.pump_4_volume > 0) consumable_repo_->add_pump_consumption(4, params.pump_4_volume * MM_TO_ML);
-        if (params.pump_5_volume > 0) consumable_repo_->add_pump_consumption(5, params.pump_5_volume * MM_TO_ML);
-        if (params.pump_6_volume > 0) consumable_repo_->add_pump_consumption(6, params.pump_6_volume * MM_TO_ML);
-        if (params.pump_7_volume > 0) consumable_repo_->add_pump_consumption(7, params.pump_7_volume * MM_TO_ML);
     }
     
     // 提交事务并恢复到初始状态 (Phase 1.3)
@@ -489,38 +769,30 @@ void ExperimentServiceImpl::execute_wait(const experiment::WaitAction& action) {
     switch (action.condition_case()) {
         case experiment::WaitAction::kDurationS: {
             add_log("等待: " + std::to_string(action.duration_s()) + "秒");
-            auto end = std::chrono::steady_clock::now() + 
-                      std::chrono::milliseconds(static_cast<int>(action.duration_s() * 1000));
-            while (std::chrono::steady_clock::now() < end) {
-                if (check_stop_or_pause()) return;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
+            token_->sleep_for(std::chrono::duration<double>(action.duration_s()));
             break;
         }
         
         case experiment::WaitAction::kHeaterCycles: {
             add_log("等待加热器循环: " + std::to_string(action.heater_cycles()) + "次");
-            // TODO: 实现加热器循环等待
-            int cycles = action.heater_cycles();
-            int cycle_time_ms = 2500;  // 假设每个循环2.5秒
-            auto end = std::chrono::steady_clock::now() + 
-                      std::chrono::milliseconds(cycles * cycle_time_ms);
-            while (std::chrono::steady_clock::now() < end) {
-                if (check_stop_or_pause()) return;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
+            // 未指定超时时按估算的周期时长留一倍余量
+            double timeout_s = action.timeout_s() > 0 ? action.timeout_s()
+                                                       : action.heater_cycles() * heater_cycle_estimate_s() * 2;
+            wait_for_heater_cycles(action.heater_cycles(), timeout_s);
             break;
         }
         
         case experiment::WaitAction::kEmpty: {
             add_log("等待空瓶");
-            auto result = load_cell_->wait_for_empty_bottle(
+            auto result = workflows::wait_for_empty_bottle(
+                token_, *load_cell_,
                 action.empty().tolerance_g(),
                 action.timeout_s(),
                 action.empty().stability_window_s()
             );
-            if (result.success) {
-                add_log("空瓶检测完成: " + std::to_string(result.empty_weight) + "g");
+            if (!result) return;
+            if (result->success) {
+                add_log("空瓶检测完成: " + std::to_string(result->empty_weight) + "g");
             } else {
                 add_log("空瓶检测超时");
             }
@@ -533,7 +805,7 @@ void ExperimentServiceImpl::execute_wait(const experiment::WaitAction& action) {
     }
 }
 
-void ExperimentServiceImpl::execute_drain(const experiment::DrainAction& action) {
+void ExperimentServiceImpl::execute_drain(const experiment::DrainAction& action, std::size_t pc) {
     add_log("排废");
     
     // 使用事务守卫保证状态一致性 (Phase 1.3)
@@ -546,15 +818,39 @@ void ExperimentServiceImpl::execute_drain(const experiment::DrainAction& action)
     // 设置气泵PWM
     // TODO: 实现气泵PWM控制
     
+    // 排废模型给出预测时记录预计排空时间 (回调在称重 strand 上, 只写日志环)
+    boost::signals2::scoped_connection predicted = load_cell_->on_drain_predicted.connect(
+        [this](const hal::DrainPredictor::Prediction& p) {
+            add_log("预计 " + std::to_string(p.remaining_s) + "s 后排空 (" + std::to_string(p.asymptote_g) + "g)");
+        });
+    // 进入确认窗口后排空已成定局: 下一步是进样时先注册泵 (REGISTER_PUMPS_TO_AXIS), 宏在确认
+    // 窗口内执行完, 进样开始时只需切阀与 G1. 阀门不预切: 排废未结束前打开进样通路会混液
+    boost::signals2::scoped_connection confirmed;
+    if (pc + 1 < plan_.size() && plan_.action(pc + 1) == experiment::Step::kInject) {
+        confirmed = load_cell_->on_drain_confirmed.connect(
+            [this, next = pc + 1](const hal::DrainPredictor::Prediction&) {
+                const uint64_t token = system_state_->prepare_inject();
+                if (token == 0) return;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    prepared_inject_.emplace(next, token);
+                }
+                add_log("排废确认中, 已为下一步进样预注册泵");
+            });
+    }
+    
     // 等待空瓶
-    auto result = load_cell_->wait_for_empty_bottle(
+    auto result = workflows::wait_for_empty_bottle(
+        token_, *load_cell_,
         action.empty_tolerance_g(),
         action.timeout_s(),
         action.stability_window_s()
     );
+    if (!result) return;  // guard 析构时会自动回滚
     
-    if (result.success) {
-        add_log("排废完成: " + std::to_string(result.empty_weight) + "g");
+    if (result->success) {
+        add_log("排废完成: " + std::to_string(result->empty_weight) + "g" +
+                    (result->predicted ? " (排废模型确认)" : ""));
     } else {
         add_log("排废超时");
     }
@@ -580,11 +876,8 @@ void ExperimentServiceImpl::execute_acquire(const experiment::AcquireAction& act
         case experiment::AcquireAction::kDurationS: {
             // 1. 固定时间等待
             add_log("采集模式: 固定时间 " + std::to_string(action.duration_s()) + "s");
-            auto end = std::chrono::steady_clock::now() + 
-                      std::chrono::milliseconds(static_cast<int>(action.duration_s() * 1000));
-            while (std::chrono::steady_clock::now() < end) {
-                if (check_stop_or_pause()) return;  // guard 析构时会自动回滚
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (!token_->sleep_for(std::chrono::duration<double>(action.duration_s()))) {
+                return;  // guard 析构时会自动回滚
             }
             break;
         }
@@ -593,6 +886,7 @@ void ExperimentServiceImpl::execute_acquire(const experiment::AcquireAction& act
             // 2. 等待完整的加热配置周期 (通过传感器上报的 heater_step 判断)
             add_log("采集模式: 加热周期 x" + std::to_string(action.heater_cycles()));
             wait_for_heater_cycles(action.heater_cycles(), action.max_duration_s());
+            if (check_stop_or_pause()) return;  // guard 析构时会自动回滚
             break;
         }
         
@@ -604,17 +898,15 @@ void ExperimentServiceImpl::execute_acquire(const experiment::AcquireAction& act
                 action.stability().threshold_percent(),
                 action.max_duration_s()
             );
+            if (check_stop_or_pause()) return;  // guard 析构时会自动回滚
             break;
         }
         
         default: {
             // 默认: 使用最大时间
             add_log("采集模式: 默认最大时间 " + std::to_string(action.max_duration_s()) + "s");
-            auto end = std::chrono::steady_clock::now() + 
-                      std::chrono::milliseconds(static_cast<int>(action.max_duration_s() * 1000));
-            while (std::chrono::steady_clock::now() < end) {
-                if (check_stop_or_pause()) return;  // guard 析构时会自动回滚
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (!token_->sleep_for(std::chrono::duration<double>(action.max_duration_s()))) {
+                return;  // guard 析构时会自动回滚
             }
             break;
         }
@@ -646,10 +938,10 @@ void ExperimentServiceImpl::execute_set_gas_pump(const experiment::SetGasPumpAct
         auto duration = std::chrono::steady_clock::now() - gas_pump_start_time_;
         int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
         
-        if (consumable_repo_ && seconds > 0) {
+        if (consumable_cache_ && seconds > 0) {
             // 记录活性炭管和真空过滤器的运行时间
-            consumable_repo_->add_runtime("carbon_filter", seconds);
-            consumable_repo_->add_runtime("vacuum_filter", seconds);
+            consumable_cache_->record_runtime("carbon_filter", seconds);
+            consumable_cache_->record_runtime("vacuum_filter", seconds);
             spdlog::debug("记录气泵运行时间: {}秒 (活性炭管+真空过滤器)", seconds);
         }
         gas_pump_running_ = false;
@@ -658,40 +950,15 @@ void ExperimentServiceImpl::execute_set_gas_pump(const experiment::SetGasPumpAct
     // TODO: 实际发送 PWM 控制命令到硬件
 }
 
-void ExperimentServiceImpl::execute_loop(const experiment::LoopAction& action) {
-    int count = action.count();
-    add_log("循环开始: " + std::to_string(count) + "次");
-    
+void ExperimentServiceImpl::execute_phase_marker(const experiment::PhaseMarkerAction& action) {
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        loop_total_ = count;
-    }
-    
-    for (int i = 0; i < count; ++i) {
-        if (check_stop_or_pause()) return;
-        
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            loop_iteration_ = i + 1;
+        std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+        current_phase_ = action.is_start() ? action.phase_name() : "";
+        if (action.is_start()) {
+            run_context_.phase_name = current_phase_;
         }
-        
-        add_log("循环迭代: " + std::to_string(i + 1) + "/" + std::to_string(count));
-        emit_event(experiment::ExperimentEvent::LOOP_ITERATION, 
-                  "迭代 " + std::to_string(i + 1));
-        
-        execute_steps(action.steps());
     }
     
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        loop_iteration_ = 0;
-        loop_total_ = 0;
-    }
-    
-    add_log("循环结束");
-}
-
-void ExperimentServiceImpl::execute_phase_marker(const experiment::PhaseMarkerAction& action) {
     if (action.is_start()) {
         add_log("阶段开始: " + action.phase_name());
         emit_event(experiment::ExperimentEvent::PHASE_STARTED, action.phase_name());
@@ -701,9 +968,27 @@ void ExperimentServiceImpl::execute_phase_marker(const experiment::PhaseMarkerAc
     }
 }
 
+void ExperimentServiceImpl::set_baseline_recovery(std::shared_ptr<hal::BaselineRecoveryMonitor> monitor) {
+    baseline_recovery_ = monitor;
+    if (auto wash = std::dynamic_pointer_cast<workflows::WashExecutor>(executors_["wash"])) {
+        wash->set_baseline_recovery(std::move(monitor));
+    }
+}
+
 void ExperimentServiceImpl::execute_wash(const experiment::WashAction& action) {
-    add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) + 
-            "g, 重复" + std::to_string(action.repeat_count()) + "次");
+    const auto termination = workflows::wash_termination(
+        action, baseline_recovery_ && baseline_recovery_->has_baselines());
+    if (termination.until_baseline) {
+        add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) +
+                "g, " + std::to_string(termination.min_cycles) + "-" + std::to_string(termination.max_cycles) +
+                "次, 直到传感器回到基线");
+    } else {
+        if (action.mode() == enose::experiment::WASH_MODE_UNTIL_BASELINE) {
+            add_log("尚无已预热的传感器基线, 按固定次数清洗");
+        }
+        add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) +
+                "g, 重复" + std::to_string(termination.max_cycles) + "次");
+    }
     
     // 使用事务守卫保证状态一致性 (Phase 1.3)
     // 注意: wash 是复合操作，内部有多次状态转换，guard 只保证最终恢复到 INITIAL
@@ -713,22 +998,25 @@ void ExperimentServiceImpl::execute_wash(const experiment::WashAction& action) {
         "wash"
     );
     
-    for (int i = 0; i < action.repeat_count(); ++i) {
+    bool recovered = false;
+    for (int i = 0; i < termination.max_cycles; ++i) {
         if (check_stop_or_pause()) return;  // guard 析构时会自动回滚到 INITIAL
         
-        add_log("清洗循环 " + std::to_string(i + 1) + "/" + std::to_string(action.repeat_count()));
+        add_log("清洗循环 " + std::to_string(i + 1) + "/" + std::to_string(termination.max_cycles));
         
         // 1. 排废确认空瓶稳态 (baseline)
         add_log("排废确认空瓶...");
         system_state_->transition_to(workflows::SystemState::State::DRAIN);
         
-        auto empty_result = load_cell_->wait_for_empty_bottle(
+        auto empty_result = workflows::wait_for_empty_bottle(
+            token_, *load_cell_,
             action.empty_tolerance_g(),
             action.drain_timeout_s(),
             action.empty_stability_window_s()
         );
+        if (!empty_result) return;
         
-        if (!empty_result.success) {
+        if (!empty_result->success) {
             add_log("排废超时，继续清洗");
         }
         
@@ -741,27 +1029,18 @@ void ExperimentServiceImpl::execute_wash(const experiment::WashAction& action) {
         add_log("开始注入清洗液...");
         system_state_->transition_to(workflows::SystemState::State::CLEAN);
         
-        // 3. 监测重量变化，达到阈值立即切换到排废
-        auto fill_start = std::chrono::steady_clock::now();
-        auto fill_timeout = std::chrono::seconds(static_cast<int>(action.fill_timeout_s()));
-        bool target_reached = false;
+        // 3. 监测重量变化，达到阈值立即切换到排废 (每个称重读数到达时判定)
+        auto fill_status = workflows::WaitSet(token_)
+            .notify_on(load_cell_->on_status_update)
+            .wait_for(std::chrono::duration<double>(action.fill_timeout_s()), [&] {
+                return load_cell_->get_filtered_weight() - baseline_weight >= action.target_weight_g();
+            });
         
-        while (!check_stop_or_pause()) {
-            float current_weight = load_cell_->get_filtered_weight();
-            float weight_change = current_weight - baseline_weight;
-            
-            if (weight_change >= action.target_weight_g()) {
-                add_log("达到目标重量变化: " + std::to_string(weight_change) + "g");
-                target_reached = true;
-                break;
-            }
-            
-            if (std::chrono::steady_clock::now() - fill_start > fill_timeout) {
-                add_log("清洗注入超时，当前重量变化: " + std::to_string(weight_change) + "g");
-                break;
-            }
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        float weight_change = load_cell_->get_filtered_weight() - baseline_weight;
+        if (fill_status == workflows::WaitStatus::READY) {
+            add_log("达到目标重量变化: " + std::to_string(weight_change) + "g");
+        } else if (fill_status == workflows::WaitStatus::TIMEOUT) {
+            add_log("清洗注入超时，当前重量变化: " + std::to_string(weight_change) + "g");
         }
         
         if (check_stop_or_pause()) return;
@@ -770,17 +1049,41 @@ void ExperimentServiceImpl::execute_wash(const experiment::WashAction& action) {
         add_log("排废清洗液...");
         system_state_->transition_to(workflows::SystemState::State::DRAIN);
         
-        auto drain_result = load_cell_->wait_for_empty_bottle(
+        auto drain_result = workflows::wait_for_empty_bottle(
+            token_, *load_cell_,
             action.empty_tolerance_g(),
             action.drain_timeout_s(),
             action.empty_stability_window_s()
         );
+        if (!drain_result) return;
         
-        if (drain_result.success) {
-            add_log("排废完成: " + std::to_string(drain_result.empty_weight) + "g");
+        if (drain_result->success) {
+            add_log("排废完成: " + std::to_string(drain_result->empty_weight) + "g" +
+                    (drain_result->predicted ? " (排废模型确认)" : ""));
         } else {
             add_log("排废超时");
         }
+        
+        // 5. 自适应终止: 达到最少次数后, 传感器回到基线即结束
+        if (termination.until_baseline && i + 1 >= termination.min_cycles) {
+            hal::BaselineRecoveryMonitor::FrameDeviation latest;
+            auto status = workflows::wait_for_baseline_recovery(
+                token_, *baseline_recovery_, termination.tolerance, termination.frames,
+                termination.timeout_s, &latest);
+            if (status == workflows::WaitStatus::STOPPED) return;
+            
+            const std::string deviation = std::to_string(latest.max_deviation * 100) + "%";
+            if (status == workflows::WaitStatus::READY) {
+                add_log("传感器已回到基线 (最大偏离 " + deviation + "), 第" + std::to_string(i + 1) + "次循环后结束清洗");
+                recovered = true;
+                break;
+            }
+            add_log("传感器未回到基线 (最大偏离 " + deviation + ", 传感器 " +
+                    std::to_string(latest.worst_sensor) + ")");
+        }
+    }
+    if (termination.until_baseline && !recovered) {
+        add_log("已达最多清洗次数 " + std::to_string(termination.max_cycles) + ", 传感器仍未回到基线");
     }
     
     // 提交事务并恢复到初始状态 (Phase 1.3)
@@ -788,83 +1091,108 @@ void ExperimentServiceImpl::execute_wash(const experiment::WashAction& action) {
     add_log("清洗完成");
 }
 
-bool ExperimentServiceImpl::wait_for_heater_cycles(int count, double timeout_s) {
-    if (!sensor_driver_) {
-        add_log("警告: 无传感器驱动，使用估算时间");
-        // 降级: 无传感器时用估算时间 (假设每个周期约 26 秒，可根据实际配置调整)
-        double estimated_cycle_time = 26.0;
-        double total_time = count * estimated_cycle_time;
-        auto end = std::chrono::steady_clock::now() + 
-                  std::chrono::milliseconds(static_cast<int>(std::min(total_time, timeout_s) * 1000));
-        while (std::chrono::steady_clock::now() < end) {
-            if (check_stop_or_pause()) return false;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        return true;
-    }
+template <typename Request>
+std::shared_ptr<const enose::workflows::ProgramCache::Entry> ExperimentServiceImpl::compile_program(
+    const Request& request, std::string& error) {
     
-    add_log("等待 " + std::to_string(count) + " 个加热周期完成");
+    using enose::workflows::ProgramCache;
     
-    int completed_cycles = 0;
-    int last_heater_step = -1;
-    int max_heater_step = 0;  // 记录观察到的最大步数
-    bool seen_first_cycle = false;
+    std::string key;
+    if (request.has_yaml_content()) {
+        key = ProgramCache::key_for_yaml(request.yaml_content());
+    } else if (request.has_program()) {
+        key = ProgramCache::key_for_program(request.program());
+    } else {
+        error = "请求中没有程序数据";
+        return nullptr;
+    }
     
-    auto start = std::chrono::steady_clock::now();
-    auto timeout = std::chrono::seconds(static_cast<int>(timeout_s));
+    // 模型重新标定或液体库存变化后, 旧的验证结果不再可信
+    ProgramCache::Version version;
+    auto model = simulation_model(&version.model);
+    if (consumable_cache_) {
+        version.inventory = consumable_cache_->snapshot()->version;
+    }
+    if (auto cached = program_cache_.find(key, version)) {
+        return cached;
+    }
     
-    // 订阅传感器数据，监听 heater_step 变化
-    std::mutex cycle_mutex;
-    std::condition_variable cycle_cv;
+    // 解析失败不缓存 (编辑中的 YAML 很快会变)
+    auto program = enose::workflows::make_arena_program();
+    if (!read_program(request, *program, error)) {
+        return nullptr;
+    }
     
-    auto conn = sensor_driver_->on_packet.connect([&](const nlohmann::json& packet) {
-        if (!packet.contains("type") || packet["type"] != "reading") return;
-        if (!packet.contains("heater_step")) return;
-        
-        int current_step = packet["heater_step"].get<int>();
-        
-        std::lock_guard<std::mutex> lock(cycle_mutex);
-        
-        // 更新观察到的最大步数
-        if (current_step > max_heater_step) {
-            max_heater_step = current_step;
+    auto entry = std::make_shared<ProgramCache::Entry>();
+    enose::workflows::ExperimentValidator validator(model);
+    entry->validation = validator.validate(*program);
+    if (entry->validation.valid) {
+        auto compiled = entry->plan.compile(*program, executor_resolver());
+        if (!compiled.success) {
+            entry->compile_error = compiled.error_message;
         }
-        
-        // 检测周期完成: 从非0步回到0步
-        if (last_heater_step > 0 && current_step == 0 && seen_first_cycle) {
-            completed_cycles++;
-            add_log("完成加热周期 " + std::to_string(completed_cycles) + "/" + std::to_string(count));
-            cycle_cv.notify_all();
-        }
-        
-        // 第一次看到步数从大变小，标记为已见过第一个周期
-        if (last_heater_step > current_step && !seen_first_cycle) {
-            seen_first_cycle = true;
-        }
-        
-        last_heater_step = current_step;
-    });
+    }
+    entry->program = std::move(program);
     
-    // 等待完成指定数量的周期
-    {
-        std::unique_lock<std::mutex> lock(cycle_mutex);
-        while (completed_cycles < count) {
-            if (check_stop_or_pause()) {
-                conn.disconnect();
-                return false;
-            }
-            
-            if (std::chrono::steady_clock::now() - start > timeout) {
-                add_log("等待加热周期超时");
-                conn.disconnect();
-                return false;
-            }
-            
-            cycle_cv.wait_for(lock, std::chrono::milliseconds(100));
+    program_cache_.insert(key, version, entry);
+    return entry;
+}
+
+enose::workflows::SimulationModel ExperimentServiceImpl::simulation_model(uint64_t* version) {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    
+    const auto now = std::chrono::steady_clock::now();
+    if (model_calibrated_at_ && now - *model_calibrated_at_ < MODEL_RECALIBRATE_INTERVAL) {
+        if (version) *version = model_version_;
+        return simulation_model_;
+    }
+    model_calibrated_at_ = now;
+    
+    enose::workflows::SimulationModel model;
+    if (run_repo_) {
+        if (auto calibration = run_repo_->get_simulation_calibration()) {
+            model.apply(*calibration);
         }
     }
+    model.heater_cycle_s = heater_cycle_estimate_s();
+    if (!(model == simulation_model_)) {
+        ++model_version_;
+    }
+    simulation_model_ = model;
+    if (version) *version = model_version_;
     
-    conn.disconnect();
+    spdlog::info("资源预估模型: 加热周期 {:.1f}s, 进样系数 {:.2f}, 排废 {:.1f}g/s (样本 {})",
+                 model.heater_cycle_s, model.inject_time_scale, model.drain_rate_g_s,
+                 model.calibration_samples);
+    return simulation_model_;
+}
+
+double ExperimentServiceImpl::heater_cycle_estimate_s() const {
+    if (sensor_driver_) {
+        double measured = sensor_driver_->heater_cycles().mean_cycle_period_s();
+        if (measured > 0) return measured;
+    }
+    return enose::workflows::SimulationModel::DEFAULT_HEATER_CYCLE_S;
+}
+
+bool ExperimentServiceImpl::wait_for_heater_cycles(int count, double timeout_s) {
+    if (!sensor_driver_) {
+        add_log("警告: 无传感器驱动，使用估算时间");
+        // 降级: 无传感器时用估算时间
+        double estimated_cycle_time = heater_cycle_estimate_s();
+        double total_time = count * estimated_cycle_time;
+        return token_->sleep_for(std::chrono::duration<double>(std::min(total_time, timeout_s)));
+    }
+    
+    add_log("等待 " + std::to_string(count) + " 个加热周期完成");
+    
+    auto status = workflows::wait_for_heater_cycles(token_, *sensor_driver_, count, timeout_s);
+    
+    if (status == workflows::WaitStatus::STOPPED) return false;
+    if (status == workflows::WaitStatus::TIMEOUT) {
+        add_log("等待加热周期超时");
+        return false;
+    }
     add_log("加热周期等待完成");
     return true;
 }
@@ -872,95 +1200,27 @@ bool ExperimentServiceImpl::wait_for_heater_cycles(int count, double timeout_s)
 bool ExperimentServiceImpl::wait_for_sensor_stability(double window_s, double threshold_percent, double timeout_s) {
     if (!sensor_driver_) {
         add_log("警告: 无传感器驱动，使用最大时间");
-        auto end = std::chrono::steady_clock::now() + 
-                  std::chrono::milliseconds(static_cast<int>(timeout_s * 1000));
-        while (std::chrono::steady_clock::now() < end) {
-            if (check_stop_or_pause()) return false;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-        return true;
+        return token_->sleep_for(std::chrono::duration<double>(timeout_s));
     }
     
     add_log("等待传感器稳定 (窗口=" + std::to_string(window_s) + "s, 阈值=" + 
             std::to_string(threshold_percent) + "%)");
     
-    std::deque<double> readings;
-    auto window_duration = std::chrono::milliseconds(static_cast<int>(window_s * 1000));
-    auto start = std::chrono::steady_clock::now();
-    auto timeout = std::chrono::seconds(static_cast<int>(timeout_s));
-    
-    std::mutex readings_mutex;
-    bool stable = false;
+    auto status = workflows::wait_for_sensor_stability(
+        token_, *sensor_driver_, window_s, threshold_percent, timeout_s);
     
-    auto conn = sensor_driver_->on_packet.connect([&](const nlohmann::json& packet) {
-        if (!packet.contains("type") || packet["type"] != "reading") return;
-        if (!packet.contains("value")) return;
-        
-        double value = packet["value"].get<double>();
-        
-        std::lock_guard<std::mutex> lock(readings_mutex);
-        readings.push_back(value);
-        
-        // 只保留窗口内的数据
-        auto now = std::chrono::steady_clock::now();
-        while (readings.size() > 1 && 
-               (now - start) > window_duration && 
-               readings.size() > static_cast<size_t>(window_s * 10)) {  // 假设约 10Hz 采样
-            readings.pop_front();
-        }
-        
-        // 检查稳定性: 计算变化百分比
-        if (readings.size() >= 10) {
-            double min_val = *std::min_element(readings.begin(), readings.end());
-            double max_val = *std::max_element(readings.begin(), readings.end());
-            double mean_val = (min_val + max_val) / 2.0;
-            
-            if (mean_val > 0) {
-                double variation_percent = ((max_val - min_val) / mean_val) * 100.0;
-                if (variation_percent <= threshold_percent) {
-                    stable = true;
-                }
-            }
-        }
-    });
-    
-    while (!stable) {
-        if (check_stop_or_pause()) {
-            conn.disconnect();
-            return false;
-        }
-        
-        if (std::chrono::steady_clock::now() - start > timeout) {
-            add_log("等待稳定超时");
-            conn.disconnect();
-            return false;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (status == workflows::WaitStatus::STOPPED) return false;
+    if (status == workflows::WaitStatus::TIMEOUT) {
+        add_log("等待稳定超时");
+        return false;
     }
-    
-    conn.disconnect();
     add_log("传感器已稳定");
     return true;
 }
 
 void ExperimentServiceImpl::add_log(const std::string& message) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // 添加时间戳
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    char buf[64];
-    std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time_t));
-    
-    std::string log_entry = std::string(buf) + " " + message;
-    logs_.push_back(log_entry);
-    
-    // 只保留最近100条日志
-    if (logs_.size() > 100) {
-        logs_.erase(logs_.begin());
-    }
-    
+    // 日志环无锁, 持有 mutex_ 时也可调用
+    logs_->push(message);
     spdlog::info("[实验] {}", message);
 }
 
@@ -969,8 +1229,6 @@ void ExperimentServiceImpl::emit_event(
     const std::string& message,
     const std::map<std::string, std::string>& data) {
     
-    if (subscriber_count_ == 0) return;
-    
     experiment::ExperimentEvent event;
     *event.mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
     event.set_type(type);
@@ -981,14 +1239,46 @@ void ExperimentServiceImpl::emit_event(
         (*event.mutable_data())[key] = value;
     }
     
-    {
-        std::lock_guard<std::mutex> lock(event_mutex_);
-        event_queue_.push(std::move(event));
+    if (system_events_) {
+        forward_system_event(event);
     }
-    event_cv_.notify_all();
+    events_bus_.publish(std::move(event));
 }
 
-void ExperimentServiceImpl::fill_status_response(experiment::ExperimentStatusResponse* response) {
+void ExperimentServiceImpl::forward_system_event(const experiment::ExperimentEvent& event) {
+    using SystemEvent = ::enose::data::Event;
+    SystemEvent::EventType type;
+    SystemEvent::Severity severity = SystemEvent::INFO;
+    switch (event.type()) {
+        case experiment::ExperimentEvent::EXPERIMENT_STARTED:
+        case experiment::ExperimentEvent::EXPERIMENT_STOPPED:
+        case experiment::ExperimentEvent::EXPERIMENT_PAUSED:
+        case experiment::ExperimentEvent::EXPERIMENT_RESUMED:
+            type = SystemEvent::USER_INTERACTION;
+            break;
+        case experiment::ExperimentEvent::EXPERIMENT_COMPLETED:
+        case experiment::ExperimentEvent::PHASE_STARTED:
+        case experiment::ExperimentEvent::PHASE_ENDED:
+            type = SystemEvent::PHASE_CHANGED;
+            break;
+        case experiment::ExperimentEvent::EXPERIMENT_ERROR:
+            type = SystemEvent::ERROR_OCCURRED;
+            severity = SystemEvent::ERROR;
+            break;
+        default:
+            // 步骤 / 循环 / 读数事件只走实验事件流
+            return;
+    }
+    
+    enose_grpc::publish_system_event(*system_events_, type, severity, event.message(), {
+        {"source", "experiment"},
+        {"event", experiment::ExperimentEvent::EventType_Name(event.type())},
+        {"step", event.step_name()},
+    });
+}
+
+void ExperimentServiceImpl::fill_status_response(experiment::ExperimentStatusResponse* response,
+                                                 uint64_t after_log_index) {
     response->set_state(state_);
     
     if (loaded_program_) {
@@ -1000,10 +1290,12 @@ void ExperimentServiceImpl::fill_status_response(experiment::ExperimentStatusRes
     response->set_loop_iteration(loop_iteration_);
     response->set_loop_total(loop_total_);
     
-    // 计算进度
-    if (loaded_program_ && loaded_program_->steps_size() > 0) {
-        int progress = (current_step_index_ * 100) / loaded_program_->steps_size();
-        response->set_progress_percent(progress);
+    // 计算进度 (按展开后的计划步骤)
+    response->set_progress_percent(plan_.progress_percent(plan_pc_));
+    response->set_plan_step(static_cast<uint32_t>(plan_pc_));
+    response->set_plan_steps(static_cast<uint32_t>(plan_.size()));
+    if (plan_pc_ < plan_.size()) {
+        response->set_step_id(plan_[plan_pc_].id);
     }
     
     // 计算已运行时间
@@ -1020,10 +1312,12 @@ void ExperimentServiceImpl::fill_status_response(experiment::ExperimentStatusRes
         response->set_remaining_s(remaining);
     }
     
-    // 添加日志
-    for (const auto& log : logs_) {
-        response->add_logs(log);
+    // 只添加新增日志
+    auto batch = logs_->read_after(after_log_index);
+    for (auto& entry : batch.entries) {
+        response->add_logs(std::move(entry.text));
     }
+    response->set_last_log_index(batch.last_index);
     
     if (!error_message_.empty()) {
         response->set_error(error_message_);
@@ -1031,18 +1325,7 @@ void ExperimentServiceImpl::fill_status_response(experiment::ExperimentStatusRes
 }
 
 bool ExperimentServiceImpl::check_stop_or_pause() {
-    if (stop_requested_) return true;
-    if (pause_requested_) {
-        wait_if_paused();
-    }
-    return stop_requested_;
-}
-
-void ExperimentServiceImpl::wait_if_paused() {
-    std::unique_lock<std::mutex> lock(pause_mutex_);
-    pause_cv_.wait(lock, [this] {
-        return !pause_requested_ || stop_requested_;
-    });
+    return token_->check_stop_or_pause();
 }
 
 workflows::SystemState::State ExperimentServiceImpl::convert_state(experiment::SystemState state) {
@@ -1056,12 +1339,516 @@ workflows::SystemState::State ExperimentServiceImpl::convert_state(experiment::S
     }
 }
 
+// ============== 实验队列 ==============
+
+::grpc::Status ExperimentServiceImpl::EnqueueProgram(
+    ::grpc::ServerContext* context,
+    const experiment::EnqueueProgramRequest* request,
+    experiment::EnqueueProgramResponse* response) {
+    
+    if (!queue_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "实验队列需要数据库");
+    }
+    
+    std::string read_error;
+    auto entry = compile_program(*request, read_error);
+    if (!entry) {
+        response->set_success(false);
+        response->set_error_message(read_error);
+        return ::grpc::Status::OK;
+    }
+    const auto& program = *entry->program;
+    
+    // 入队时先验证一次, 出队执行前按当时的液体余量和模型再验证
+    const auto& validation = entry->validation;
+    *response->mutable_validation() = enose::workflows::ExperimentValidator::to_proto(validation);
+    if (!validation.valid) {
+        response->set_success(false);
+        response->set_error_message("程序验证失败");
+        return ::grpc::Status::OK;
+    }
+    
+    std::string program_json;
+    if (!google::protobuf::util::MessageToJsonString(program, &program_json).ok()) {
+        response->set_success(false);
+        response->set_error_message("程序序列化失败");
+        return ::grpc::Status::OK;
+    }
+    
+    const std::string& name = request->name().empty() ? program.name() : request->name();
+    auto record = queue_repo_->enqueue(name, request->priority(), program.id(), program_json,
+                                       validation.estimate.estimated_duration_s);
+    if (!record) {
+        response->set_success(false);
+        response->set_error_message("写入队列失败");
+        return ::grpc::Status::OK;
+    }
+    
+    response->set_success(true);
+    fill_queue_entry(*record, response->mutable_entry());
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExperimentServiceImpl::ListQueue(
+    ::grpc::ServerContext* context,
+    const google::protobuf::Empty* request,
+    experiment::QueueStatusResponse* response) {
+    
+    if (!queue_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "实验队列需要数据库");
+    }
+    fill_queue_status(response);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExperimentServiceImpl::ReorderQueue(
+    ::grpc::ServerContext* context,
+    const experiment::ReorderQueueRequest* request,
+    experiment::QueueEntry* response) {
+    
+    if (!queue_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "实验队列需要数据库");
+    }
+    auto record = queue_repo_->reorder(request->id(), request->priority());
+    if (!record) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "队列项不存在或已开始执行");
+    }
+    fill_queue_entry(*record, response);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExperimentServiceImpl::CancelQueued(
+    ::grpc::ServerContext* context,
+    const experiment::CancelQueuedRequest* request,
+    experiment::QueueEntry* response) {
+    
+    if (!queue_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "实验队列需要数据库");
+    }
+    // 正在执行的队列项用 StopExperiment 中止
+    auto record = queue_repo_->cancel(request->id());
+    if (!record) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "队列项不存在或已开始执行");
+    }
+    fill_queue_entry(*record, response);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExperimentServiceImpl::SetQueueRunning(
+    ::grpc::ServerContext* context,
+    const experiment::SetQueueRunningRequest* request,
+    experiment::QueueStatusResponse* response) {
+    
+    if (!queue_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "实验队列需要数据库");
+    }
+    
+    bool launch = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        queue_running_ = request->running();
+        queue_settings_ = *request;
+        
+        // 有实验在执行 (或已手动加载) 时由执行线程在它结束后接着取队列
+        const bool idle = state_ == experiment::EXP_IDLE || state_ == experiment::EXP_COMPLETED ||
+                          state_ == experiment::EXP_ERROR || state_ == experiment::EXP_ABORTED;
+        if (queue_running_ && idle && active_threads_ == 0) {
+            ++active_threads_;
+            launch = true;
+        }
+    }
+    spdlog::info("实验队列{}", request->running() ? "开始连续执行" : "停止 (当前实验继续)");
+    
+    if (launch) {
+        launch_execution_thread(true);
+    }
+    
+    fill_queue_status(response);
+    return ::grpc::Status::OK;
+}
+
+void ExperimentServiceImpl::fill_queue_status(experiment::QueueStatusResponse* response) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        response->set_running(queue_running_);
+        response->set_current_entry_id(current_queue_entry_.value_or(0));
+    }
+    
+    double queued_duration_s = 0;
+    for (const auto& record : queue_repo_->list_queued()) {
+        queued_duration_s += record.estimated_duration_s;
+        fill_queue_entry(record, response->add_queued());
+    }
+    response->set_queued_duration_s(queued_duration_s);
+    
+    for (const auto& record : queue_repo_->list_recent(QUEUE_RECENT_ENTRIES)) {
+        fill_queue_entry(record, response->add_recent());
+    }
+}
+
+ExperimentServiceImpl::PreparedRun ExperimentServiceImpl::prepare_run(const db::QueueEntryRecord& entry) {
+    PreparedRun run;
+    run.entry = entry;
+    
+    auto program = enose::workflows::make_arena_program();
+    if (!google::protobuf::util::JsonStringToMessage(entry.program_json, program.get()).ok()) {
+        run.error = "程序 JSON 解析失败";
+        return run;
+    }
+    
+    enose::workflows::ExperimentValidator validator(simulation_model());
+    run.validation = validator.validate(*program);
+    if (!run.validation.valid) {
+        run.error = "程序验证失败";
+        if (!run.validation.errors.empty()) {
+            run.error += ": " + run.validation.errors.front().message;
+        }
+        return run;
+    }
+    
+    // 计划指向 shared_ptr 持有的程序, 移交后地址不变
+    auto compiled = run.plan.compile(*program, executor_resolver());
+    if (!compiled.success) {
+        run.error = "执行计划编译失败: " + compiled.error_message;
+        return run;
+    }
+    run.program = std::move(program);
+    return run;
+}
+
+std::optional<ExperimentServiceImpl::PreparedRun> ExperimentServiceImpl::prepare_next_queued() {
+    auto head = queue_repo_->peek_next();
+    if (!head) return std::nullopt;
+    return prepare_run(*head);
+}
+
+bool ExperimentServiceImpl::start_next_queued() {
+    std::future<std::optional<PreparedRun>> prefetched;
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        if (!queue_repo_ || !queue_running_) {
+            --active_threads_;
+            return false;
+        }
+        prefetched = std::move(prefetched_);
+    }
+    
+    std::optional<PreparedRun> next;
+    if (prefetched.valid()) {
+        next = prefetched.get();
+    }
+    
+    while (auto head = queue_repo_->peek_next()) {
+        // 预取之后队列可能被重排 / 取消, 或液体余量已补充; 以当前队首为准
+        if (!next || next->entry.id != head->id || !next->error.empty()) {
+            next = prepare_run(*head);
+        }
+        if (!next->error.empty()) {
+            queue_repo_->finish(head->id, "rejected", next->error);
+            add_log("队列项 " + head->name + " 已拒绝: " + next->error);
+            next.reset();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        // 手动加载 / 启动的实验优先, 它结束后由执行线程接着取队列
+        if (state_ != experiment::EXP_IDLE && state_ != experiment::EXP_COMPLETED &&
+            state_ != experiment::EXP_ERROR && state_ != experiment::EXP_ABORTED) {
+            std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+            --active_threads_;
+            return false;
+        }
+        if (!queue_repo_->claim(head->id)) {
+            next.reset();   // 刚被取消
+            continue;
+        }
+        
+        loaded_program_ = std::move(next->program);
+        plan_ = std::move(next->plan);
+        validation_result_ = std::move(next->validation);
+        const std::string run_config = begin_run_locked();
+        const std::size_t plan_steps = plan_.size();
+        state_ = experiment::EXP_RUNNING;
+        {
+            // 下一项在本次执行期间预先验证和编译
+            std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+            current_queue_entry_ = head->id;
+            prefetched_ = std::async(std::launch::async, &ExperimentServiceImpl::prepare_next_queued, this);
+        }
+        
+        emit_event(experiment::ExperimentEvent::PROGRAM_LOADED, "程序已加载: " + loaded_program_->name());
+        emit_event(experiment::ExperimentEvent::EXPERIMENT_STARTED, "队列实验已启动: " + head->name);
+        lock.unlock();
+        
+        if (auto db_run_id = register_run(run_config, plan_steps)) {
+            queue_repo_->set_run_id(head->id, *db_run_id);
+        }
+        spdlog::info("从队列启动实验: id={} program={}", head->id, head->program_id);
+        return true;
+    }
+    
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        queue_running_ = false;
+        --active_threads_;
+    }
+    add_log("队列已全部执行");
+    return false;
+}
+
+enose::workflows::ExecutionPlan::ExecutorResolver ExperimentServiceImpl::executor_resolver() {
+    return [this](const std::string& name) -> workflows::IActionExecutor* {
+        auto it = executors_.find(name);
+        return it != executors_.end() ? it->second.get() : nullptr;
+    };
+}
+
+// ============== 检查点 / 中断续跑 ==============
+
+void ExperimentServiceImpl::save_checkpoint(bool force) {
+    if (!run_repo_) return;
+    
+    std::optional<int> db_run_id;
+    {
+        std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+        db_run_id = run_context_.db_run_id;
+    }
+    
+    // 执行线程和调度线程都会写入: 计算与写入一起串行, 后算出的检查点不会被先算出的覆盖
+    std::lock_guard<std::mutex> write_lock(checkpoint_mutex_);
+    enose::workflows::RunCheckpoint checkpoint;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::size_t completed = plan_pc_;
+        // 全部完成后不再需要检查点
+        if (completed >= plan_.size()) return;
+        
+        // 流水线重叠时 plan_pc_ 之后可能已有进样 / 清洗开始 (或已完成), 续跑须回退到排废
+        const bool disturbed = std::any_of(started_ahead_.begin(), started_ahead_.end(),
+            [this](std::size_t pc) { return changes_bottle(plan_.action(pc)); });
+        const std::size_t resume_pc = plan_.safe_resume_point(completed, disturbed);
+        // 之后的检查点最多回退到 completed 之前最近的排废, 更早的进样不会重做, 不再单独记录
+        step_consumed_.erase(step_consumed_.begin(),
+                             step_consumed_.lower_bound(plan_.safe_resume_point(completed, true)));
+        
+        if (!db_run_id || !db::ConnectionPool::instance().is_healthy()) return;
+        auto now = std::chrono::steady_clock::now();
+        if (!force && now - last_checkpoint_ < CHECKPOINT_INTERVAL) return;
+        last_checkpoint_ = now;
+        
+        const auto& next = plan_[completed];
+        checkpoint.plan_pc = completed;
+        checkpoint.resume_pc = resume_pc;
+        checkpoint.plan_steps = plan_.size();
+        checkpoint.step_id = next.id;
+        checkpoint.loop_iteration = next.loop_iteration;
+        checkpoint.loop_total = next.loop_total;
+        // 续跑时回退点及之后的进样会重做: 记录回退点处的累计消耗, 不重复计入
+        checkpoint.consumed_ml = run_consumed_ml_;
+        for (auto it = step_consumed_.lower_bound(resume_pc); it != step_consumed_.end(); ++it) {
+            for (std::size_t i = 0; i < it->second.size(); ++i) {
+                checkpoint.consumed_ml[i] -= it->second[i];
+            }
+        }
+        checkpoint.elapsed_s = std::chrono::duration<double>(now - start_time_).count();
+    }
+    if (load_cell_) {
+        checkpoint.empty_weight_g = load_cell_->get_dynamic_empty_weight();
+    }
+    
+    nlohmann::json j = checkpoint;
+    run_repo_->save_checkpoint(*db_run_id, static_cast<int>(checkpoint.plan_pc), j.dump());
+}
+
+std::optional<ExperimentServiceImpl::ResumeCandidate> ExperimentServiceImpl::prepare_resume(
+    const db::TestRunRecord& record, std::string& error) {
+    
+    auto config = nlohmann::json::parse(record.config_json, nullptr, false);
+    if (config.is_discarded() || !config.contains("program")) {
+        error = "运行记录中没有保存程序";
+        return std::nullopt;
+    }
+    auto program = enose::workflows::make_arena_program();
+    if (!google::protobuf::util::JsonStringToMessage(config["program"].dump(), program.get()).ok()) {
+        error = "程序 JSON 解析失败";
+        return std::nullopt;
+    }
+    
+    ResumeCandidate candidate;
+    try {
+        candidate.checkpoint = nlohmann::json::parse(record.checkpoint_json).get<enose::workflows::RunCheckpoint>();
+    } catch (const std::exception& e) {
+        error = std::string("检查点格式错误: ") + e.what();
+        return std::nullopt;
+    }
+    
+    auto compiled = candidate.plan.compile(*program, executor_resolver());
+    if (!compiled.success) {
+        error = "执行计划编译失败: " + compiled.error_message;
+        return std::nullopt;
+    }
+    
+    // 步骤数和中断位置的稳定 ID 都一致才说明是同一个计划
+    const auto& checkpoint = candidate.checkpoint;
+    if (checkpoint.plan_steps != candidate.plan.size() || checkpoint.plan_pc >= candidate.plan.size() ||
+        candidate.plan[checkpoint.plan_pc].id != checkpoint.step_id) {
+        error = "重新编译的执行计划与检查点不一致";
+        return std::nullopt;
+    }
+    
+    if (checkpoint.resume_pc) {
+        if (*checkpoint.resume_pc > checkpoint.plan_pc) {
+            error = "检查点的续跑位置无效";
+            return std::nullopt;
+        }
+        candidate.resume_pc = *checkpoint.resume_pc;
+    } else {
+        // 版本 1 的检查点没有记录超前执行的步骤: 按中断步骤本身判断
+        candidate.resume_pc = candidate.plan.safe_resume_point(
+            checkpoint.plan_pc, changes_bottle(candidate.plan.action(checkpoint.plan_pc)));
+    }
+    candidate.program = std::move(program);
+    return std::optional<ResumeCandidate>(std::move(candidate));
+}
+
+::grpc::Status ExperimentServiceImpl::ListResumableRuns(
+    ::grpc::ServerContext* context,
+    const google::protobuf::Empty* request,
+    experiment::ResumableRunsResponse* response) {
+    
+    if (!run_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "中断续跑需要数据库");
+    }
+    
+    for (const auto& record : run_repo_->list_resumable()) {
+        auto* run = response->add_runs();
+        run->set_run_id(record.id);
+        *run->mutable_created_at() = to_timestamp(record.created_at);
+        if (record.checkpoint_at) {
+            *run->mutable_checkpoint_at() = to_timestamp(*record.checkpoint_at);
+        }
+        auto config = nlohmann::json::parse(record.config_json, nullptr, false);
+        if (config.is_object()) {
+            run->set_program_id(config.value("program_id", ""));
+            run->set_program_name(config.value("program_name", ""));
+        }
+        
+        std::string error;
+        auto candidate = prepare_resume(record, error);
+        if (!candidate) {
+            run->set_error(error);
+            continue;
+        }
+        run->set_plan_step(static_cast<uint32_t>(candidate->checkpoint.plan_pc));
+        run->set_plan_steps(static_cast<uint32_t>(candidate->plan.size()));
+        run->set_resume_step(static_cast<uint32_t>(candidate->resume_pc));
+        run->set_resume_step_id(candidate->plan[candidate->resume_pc].id);
+        run->set_phase_name(candidate->plan.phase_at(candidate->resume_pc));
+        run->set_elapsed_s(candidate->checkpoint.elapsed_s);
+    }
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExperimentServiceImpl::ResumeRun(
+    ::grpc::ServerContext* context,
+    const experiment::ResumeRunRequest* request,
+    experiment::ExperimentStatusResponse* response) {
+    
+    if (!run_repo_) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "中断续跑需要数据库");
+    }
+    
+    auto records = run_repo_->list_resumable(request->run_id(), 1);
+    if (records.empty()) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "没有该运行的检查点");
+    }
+    std::string error;
+    auto candidate = prepare_resume(records.front(), error);
+    if (!candidate) {
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, error);
+    }
+    
+    // 重新估算时长 (剩余时间显示); 按整个程序验证偏保守, 液体余量不足只记警告不阻止续跑
+    enose::workflows::ExperimentValidator validator(simulation_model());
+    auto validation = validator.validate(*candidate->program);
+    if (!validation.valid) {
+        spdlog::warn("续跑 run_id={}: 按当前余量整个程序验证未通过, 仍从检查点继续", request->run_id());
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (state_ != experiment::EXP_IDLE && state_ != experiment::EXP_COMPLETED &&
+        state_ != experiment::EXP_ERROR && state_ != experiment::EXP_ABORTED) {
+        fill_status_response(response);
+        return ::grpc::Status(::grpc::StatusCode::FAILED_PRECONDITION, "有实验正在运行或已加载程序");
+    }
+    
+    const auto& checkpoint = candidate->checkpoint;
+    const std::size_t resume_pc = candidate->resume_pc;
+    spdlog::info("续跑实验 run_id={}: 从步骤 {}/{} ({}) 开始, 检查点位于 {}", request->run_id(),
+                 resume_pc, candidate->plan.size(), candidate->plan[resume_pc].id, checkpoint.plan_pc);
+    
+    loaded_program_ = std::move(candidate->program);
+    plan_ = std::move(candidate->plan);
+    validation_result_ = std::move(validation);
+    
+    token_->reset();
+    plan_pc_ = resume_pc;
+    current_step_index_ = plan_[resume_pc].top_level_index;
+    current_step_name_ = plan_[resume_pc].step->name();
+    loop_iteration_ = plan_[resume_pc].loop_iteration;
+    loop_total_ = plan_[resume_pc].loop_total;
+    logs_->clear();
+    error_message_.clear();
+    run_consumed_ml_ = checkpoint.consumed_ml;
+    started_ahead_.clear();
+    step_consumed_.clear();
+    prepared_inject_.reset();
+    start_time_ = std::chrono::steady_clock::now() -
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(checkpoint.elapsed_s));
+    last_checkpoint_ = std::chrono::steady_clock::now();
+    
+    // 动态空瓶值随检查点恢复, 后续的空瓶判定与中断前一致
+    if (load_cell_ && checkpoint.empty_weight_g) {
+        load_cell_->set_dynamic_empty_weight(*checkpoint.empty_weight_g);
+    }
+    
+    // 沿用原来的 runs 记录, 续跑前后的数据按同一 run_id 关联
+    run_repo_->update_run_state(request->run_id(), "running", static_cast<int>(resume_pc));
+    {
+        auto epoch_s = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        std::lock_guard<std::mutex> ctx_lock(context_mutex_);
+        run_context_.run_id = loaded_program_->id() + "_" + std::to_string(epoch_s);
+        run_context_.db_run_id = request->run_id();
+        current_phase_ = plan_.phase_at(resume_pc);
+        run_context_.phase_name = current_phase_;
+    }
+    
+    state_ = experiment::EXP_RUNNING;
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        ++active_threads_;
+    }
+    
+    emit_event(experiment::ExperimentEvent::EXPERIMENT_STARTED,
+               "实验从步骤 " + plan_[resume_pc].id + " 续跑");
+    
+    fill_status_response(response);
+    lock.unlock();
+    
+    launch_execution_thread(false);
+    return ::grpc::Status::OK;
+}
+
 // ============== Phase 3: Action Executor Integration ==============
 
 void ExperimentServiceImpl::init_executors() {
     // Phase 3 修复: 实例化 HardwareStateMachine (解决 Gemini 评估指出的"僵尸代码"问题)
     hardware_state_machine_ = std::make_shared<workflows::HardwareStateMachine>(system_state_);
     spdlog::info("HardwareStateMachine 初始化完成");
+    scheduler_ = std::make_unique<workflows::StepScheduler>(hardware_state_machine_, MAX_PARALLEL_STEPS);
     
     // 创建并注册各原语执行器，注入 HardwareStateMachine
     auto inject_exec = std::make_shared<workflows::InjectExecutor>(
@@ -1073,6 +1860,13 @@ void ExperimentServiceImpl::init_executors() {
     auto wash_exec = std::make_shared<workflows::WashExecutor>(
         system_state_, load_cell_, hardware_state_machine_);
     
+    // 共享停止/暂停令牌, StopExperiment / PauseExperiment 立即唤醒执行器中的等待
+    for (const auto& exec : std::initializer_list<std::shared_ptr<workflows::ActionExecutorBase>>{
+             inject_exec, drain_exec, acquire_exec, wash_exec}) {
+        exec->set_cancellation_token(token_);
+        exec->set_log_ring(logs_);
+    }
+    
     // 注册到 map
     executors_["inject"] = inject_exec;
     executors_["drain"] = drain_exec;
@@ -1082,23 +1876,13 @@ void ExperimentServiceImpl::init_executors() {
     spdlog::info("Action Executors 初始化完成: {} 个执行器 (已注入 HardwareStateMachine)", executors_.size());
 }
 
-bool ExperimentServiceImpl::try_execute_with_executor(const experiment::Step& step) {
-    std::string action_type;
-    
-    switch (step.action_case()) {
-        case experiment::Step::kInject: action_type = "inject"; break;
-        case experiment::Step::kDrain: action_type = "drain"; break;
-        case experiment::Step::kAcquire: action_type = "acquire"; break;
-        case experiment::Step::kWash: action_type = "wash"; break;
-        default: return false;  // 未支持的动作类型
-    }
-    
-    auto it = executors_.find(action_type);
-    if (it == executors_.end()) {
+bool ExperimentServiceImpl::try_execute_with_executor(const enose::workflows::PlanStep& plan_step) {
+    // 执行器在编译执行计划时已解析
+    auto* executor = plan_step.executor;
+    if (!executor) {
         return false;  // 没有对应的执行器
     }
-    
-    auto& executor = it->second;
+    const auto& step = *plan_step.step;
     
     // 检查前置条件
     auto precond = executor->check_preconditions(step);
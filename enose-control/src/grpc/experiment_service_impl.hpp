@@ -1,20 +1,34 @@
 #pragma once
 
+#include <array>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <atomic>
 #include <queue>
+#include <optional>
+#include <set>
 #include <condition_variable>
+#include <future>
+#include <utility>
 #include <grpcpp/grpcpp.h>
 #include "enose_experiment.grpc.pb.h"
 #include "../workflows/experiment_validator.hpp"
+#include "../workflows/execution_plan.hpp"
+#include "../workflows/program_cache.hpp"
 #include "../workflows/system_state.hpp"
 #include "../workflows/hardware_state_machine.hpp"
+#include "../workflows/log_ring.hpp"
 #include "../workflows/action_executor.hpp"
+#include "../workflows/step_scheduler.hpp"
 #include "../hal/load_cell_driver.hpp"
 #include "../hal/sensor_driver.hpp"
-#include "../db/consumable_repository.hpp"
+#include "../db/consumable_cache.hpp"
+#include "../db/test_run_repository.hpp"
+#include "../db/experiment_queue_repository.hpp"
+#include "stream_reactors.hpp"
+#include "system_events.hpp"
 
 namespace grpc_service {
 
@@ -22,17 +36,39 @@ namespace grpc_service {
  * 实验服务实现
  * 
  * 提供实验程序的验证、加载、执行功能
+ * SubscribeExperimentEvents 走 callback API, 其余方法保持同步 API
  */
-class ExperimentServiceImpl final : public ::enose::experiment::ExperimentService::Service {
+class ExperimentServiceImpl final
+    : public ::enose::experiment::ExperimentService::WithCallbackMethod_SubscribeExperimentEvents<
+          ::enose::experiment::ExperimentService::Service> {
 public:
     ExperimentServiceImpl(
         std::shared_ptr<workflows::SystemState> system_state,
         std::shared_ptr<hal::LoadCellDriver> load_cell,
         std::shared_ptr<hal::SensorDriver> sensor_driver = nullptr,
-        std::shared_ptr<db::ConsumableRepository> consumable_repo = nullptr);
+        std::shared_ptr<db::ConsumableCache> consumable_cache = nullptr,
+        std::shared_ptr<db::TestRunRepository> run_repo = nullptr,
+        std::shared_ptr<enose_grpc::SystemEventBus> system_events = nullptr);
     
     ~ExperimentServiceImpl();
     
+    /**
+     * @brief 当前运行上下文, 用于给实时数据打标签 (任意线程可调用)
+     */
+    struct RunContext {
+        std::string run_id;         // 运行中时为 "<program_id>_<启动时间戳>", 否则为空
+        std::optional<int> db_run_id;   // runs 表中的记录 id (有数据库时)
+        std::string phase_name;     // 最近的 PhaseMarker 阶段, 无则为当前步骤名
+        std::string step_id;        // 当前执行计划步骤的稳定 ID
+    };
+    RunContext run_context() const;
+
+    /** @brief 自适应清洗 (WASH_MODE_UNTIL_BASELINE) 的基线判据; 启动实验前设置 */
+    void set_baseline_recovery(std::shared_ptr<hal::BaselineRecoveryMonitor> monitor);
+
+    /** @brief 导出步骤调度、程序缓存和事件流的统计 (抓取线程调用) */
+    void collect_metrics(core::MetricWriter& writer) const;
+    
     // gRPC 方法实现
     ::grpc::Status ValidateProgram(
         ::grpc::ServerContext* context,
@@ -66,66 +102,183 @@ public:
     
     ::grpc::Status GetExperimentStatus(
         ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
+        const ::enose::experiment::GetExperimentStatusRequest* request,
         ::enose::experiment::ExperimentStatusResponse* response) override;
     
-    ::grpc::Status SubscribeExperimentEvents(
+    ::grpc::ServerWriteReactor<::enose::experiment::ExperimentEvent>* SubscribeExperimentEvents(
+        ::grpc::CallbackServerContext* context,
+        const ::enose::experiment::SubscribeExperimentEventsRequest* request) override;
+    
+    // 实验队列 (需要数据库)
+    ::grpc::Status EnqueueProgram(
+        ::grpc::ServerContext* context,
+        const ::enose::experiment::EnqueueProgramRequest* request,
+        ::enose::experiment::EnqueueProgramResponse* response) override;
+    
+    ::grpc::Status ListQueue(
         ::grpc::ServerContext* context,
         const ::google::protobuf::Empty* request,
-        ::grpc::ServerWriter<::enose::experiment::ExperimentEvent>* writer) override;
+        ::enose::experiment::QueueStatusResponse* response) override;
+    
+    ::grpc::Status ReorderQueue(
+        ::grpc::ServerContext* context,
+        const ::enose::experiment::ReorderQueueRequest* request,
+        ::enose::experiment::QueueEntry* response) override;
+    
+    ::grpc::Status CancelQueued(
+        ::grpc::ServerContext* context,
+        const ::enose::experiment::CancelQueuedRequest* request,
+        ::enose::experiment::QueueEntry* response) override;
+    
+    ::grpc::Status SetQueueRunning(
+        ::grpc::ServerContext* context,
+        const ::enose::experiment::SetQueueRunningRequest* request,
+        ::enose::experiment::QueueStatusResponse* response) override;
+    
+    // 中断续跑 (需要数据库)
+    ::grpc::Status ListResumableRuns(
+        ::grpc::ServerContext* context,
+        const ::google::protobuf::Empty* request,
+        ::enose::experiment::ResumableRunsResponse* response) override;
+    
+    ::grpc::Status ResumeRun(
+        ::grpc::ServerContext* context,
+        const ::enose::experiment::ResumeRunRequest* request,
+        ::enose::experiment::ExperimentStatusResponse* response) override;
 
 private:
     // 依赖
     std::shared_ptr<workflows::SystemState> system_state_;
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
     std::shared_ptr<hal::SensorDriver> sensor_driver_;
-    std::shared_ptr<db::ConsumableRepository> consumable_repo_;
-    enose::workflows::ExperimentValidator validator_;
+    std::shared_ptr<db::ConsumableCache> consumable_cache_;
+    std::shared_ptr<db::TestRunRepository> run_repo_;
+    
+    // 资源预估模型: 按历史测试结果和实测加热周期定期重新标定
+    std::mutex model_mutex_;
+    enose::workflows::SimulationModel simulation_model_;
+    std::optional<std::chrono::steady_clock::time_point> model_calibrated_at_;
+    uint64_t model_version_ = 0;    // 标定结果变化时递增 (程序缓存的版本之一)
+    
+    // 解析 / 验证 / 编译结果缓存 (ValidateProgram / LoadProgram / EnqueueProgram)
+    enose::workflows::ProgramCache program_cache_;
     
     // 状态
     std::mutex mutex_;
     ::enose::experiment::ExperimentState state_ = ::enose::experiment::EXP_IDLE;
-    std::unique_ptr<::enose::experiment::ExperimentProgram> loaded_program_;
+    std::shared_ptr<const ::enose::experiment::ExperimentProgram> loaded_program_;
     enose::workflows::ValidationResultInfo validation_result_;
+    // LoadProgram 时由 loaded_program_ 编译, 与其同生命周期
+    enose::workflows::ExecutionPlan plan_;
+    std::size_t plan_pc_ = 0;   // 下一个 (或正在执行的) 计划步骤
+    std::array<double, 8> run_consumed_ml_{};   // 本次运行各泵消耗的液体量 (写入检查点)
+    // plan_pc_ 及之后已开始 (在执行或已完成) 的步骤, plan_pc_ 推进时移除
+    std::set<std::size_t> started_ahead_;
+    // 续跑回退点及之后已完成的进样各自的消耗, 检查点据此算出回退点处的累计消耗
+    std::map<std::size_t, std::array<double, 8>> step_consumed_;
+    // 排废确认窗口内为紧随的进样预注册了泵: (进样的计划步骤, SystemState 令牌)
+    std::optional<std::pair<std::size_t, uint64_t>> prepared_inject_;
+    std::chrono::steady_clock::time_point last_checkpoint_;
+    std::mutex checkpoint_mutex_;   // 串行化 save_checkpoint; 持有时可再取 mutex_
     
-    // 执行线程
+    // 执行线程 (连续执行队列时一个线程依次执行多个实验); thread_mutex_ 保护句柄的替换与 join
+    std::mutex thread_mutex_;
     std::unique_ptr<std::thread> execution_thread_;
-    std::atomic<bool> stop_requested_{false};
-    std::atomic<bool> pause_requested_{false};
-    std::condition_variable pause_cv_;
-    std::mutex pause_mutex_;
+    // 停止/暂停令牌 (与各 Action Executor 共享), 等待中的步骤立即被唤醒
+    std::shared_ptr<workflows::CancellationToken> token_ = std::make_shared<workflows::CancellationToken>();
     
     // 执行状态
     int current_step_index_ = 0;
     std::string current_step_name_;
     int loop_iteration_ = 0;
     int loop_total_ = 0;
+    // 正在执行的计划步骤 (可重叠); 状态与运行上下文只发布其中最早的一个
+    std::set<std::size_t> running_pcs_;
     std::chrono::steady_clock::time_point start_time_;
-    std::vector<std::string> logs_;
+    // 实验日志 (无锁, 与执行器共享; 不需要持有 mutex_)
+    std::shared_ptr<workflows::LogRing> logs_ = std::make_shared<workflows::LogRing>();
     std::string error_message_;
     
-    // 事件队列 (用于订阅者)
-    std::mutex event_mutex_;
-    std::condition_variable event_cv_;
-    std::queue<::enose::experiment::ExperimentEvent> event_queue_;
-    std::atomic<int> subscriber_count_{0};
+    // 运行上下文 (供 run_context() 跨线程读取)
+    mutable std::mutex context_mutex_;
+    RunContext run_context_;
+    std::string current_phase_;
+    
+    // 事件总线 (只存一份, 各订阅者按 seq 游标读取, 可断线续读)
+    enose_grpc::EventBus<::enose::experiment::ExperimentEvent> events_bus_{256};
+    // 实验生命周期 / 阶段事件同时转发到系统事件总线 (可为空)
+    std::shared_ptr<enose_grpc::SystemEventBus> system_events_;
+    
+    // 实验队列: 当前实验执行期间预先取出、验证并编译下一项, 结束后直接切换, 不经过 Load/Start
+    struct PreparedRun {
+        db::QueueEntryRecord entry;
+        std::shared_ptr<const ::enose::experiment::ExperimentProgram> program;    // make_arena_program()
+        enose::workflows::ExecutionPlan plan;
+        enose::workflows::ValidationResultInfo validation;
+        std::string error;      // 非空表示验证 / 编译失败
+    };
+    std::shared_ptr<db::ExperimentQueueRepository> queue_repo_;
+    // 以下由 queue_mutex_ 保护; 与 mutex_ 同时持有时先 mutex_ 后 queue_mutex_
+    std::mutex queue_mutex_;
+    bool queue_running_ = false;
+    ::enose::experiment::SetQueueRunningRequest queue_settings_;
+    std::optional<int64_t> current_queue_entry_;
+    std::future<std::optional<PreparedRun>> prefetched_;
+    int active_threads_ = 0;    // 尚未退出的执行线程, 为 0 时 SetQueueRunning 需要启动线程
+    
+    PreparedRun prepare_run(const db::QueueEntryRecord& entry);
+    std::optional<PreparedRun> prepare_next_queued();
+    // 从队列启动下一个实验 (在执行线程中调用), 队列停止 / 为空 / 已手动加载程序时返回 false
+    bool start_next_queued();
+    void fill_queue_status(::enose::experiment::QueueStatusResponse* response);
     
     // 执行方法
-    void execution_thread_func();
-    void execute_steps(const ::google::protobuf::RepeatedPtrField<::enose::experiment::Step>& steps);
-    void execute_step(const ::enose::experiment::Step& step);
+    // 调用前 active_threads_ 已加一; from_queue 时先从队列取第一个实验
+    void launch_execution_thread(bool from_queue);
+    void execution_thread_func(bool from_queue);
+    void run_loaded_program(bool recover_baseline);
+    // 重置执行状态 (持有 mutex_ 调用); 返回 runs 表登记所需的配置, 无 run_repo_ 时为空
+    std::string begin_run_locked();
+    // 在 runs 表登记并写入 run_context_ (不持有 mutex_ 调用: 数据库慢时不阻塞状态查询)
+    std::optional<int> register_run(const std::string& run_config, std::size_t plan_steps);
+    enose::workflows::ExecutionPlan::ExecutorResolver executor_resolver();
+    
+    // 检查点: 步骤边界写入 runs.checkpoint (间隔 CHECKPOINT_INTERVAL, force 时不限; 数据库不健康时跳过)
+    void save_checkpoint(bool force);
+    struct ResumeCandidate {
+        std::shared_ptr<const ::enose::experiment::ExperimentProgram> program;    // make_arena_program()
+        enose::workflows::ExecutionPlan plan;
+        enose::workflows::RunCheckpoint checkpoint;
+        std::size_t resume_pc = 0;
+    };
+    // 由中断的运行记录重新编译程序并确认与检查点一致, 失败时返回 nullopt 并给出原因
+    std::optional<ResumeCandidate> prepare_resume(const db::TestRunRecord& record, std::string& error);
+    void execute_plan();
+    void execute_plan_step(const enose::workflows::PlanStep& step);
+    void publish_running_step(std::size_t pc, bool started);
     
     // 动作执行
-    void execute_inject(const ::enose::experiment::InjectAction& action);
+    void execute_inject(const ::enose::experiment::InjectAction& action,
+                        const workflows::SystemState::InjectionParams& params,
+                        std::size_t pc);
     void execute_wait(const ::enose::experiment::WaitAction& action);
-    void execute_drain(const ::enose::experiment::DrainAction& action);
+    void execute_drain(const ::enose::experiment::DrainAction& action, std::size_t pc);
     void execute_acquire(const ::enose::experiment::AcquireAction& action);
     void execute_set_state(const ::enose::experiment::SetStateAction& action);
     void execute_set_gas_pump(const ::enose::experiment::SetGasPumpAction& action);
-    void execute_loop(const ::enose::experiment::LoopAction& action);
     void execute_phase_marker(const ::enose::experiment::PhaseMarkerAction& action);
     void execute_wash(const ::enose::experiment::WashAction& action);
     
+    // 当前的资源预估模型 (距上次标定超过 MODEL_RECALIBRATE_INTERVAL 时重新标定), version 为其版本
+    enose::workflows::SimulationModel simulation_model(uint64_t* version = nullptr);
+    
+    // 读取请求中的程序 (YAML 或结构化) 并验证、编译; 命中缓存时不解析. 读取失败返回 nullptr
+    template <typename Request>
+    std::shared_ptr<const enose::workflows::ProgramCache::Entry> compile_program(const Request& request,
+                                                                                std::string& error);
+    // 实测的加热周期时长, 无传感器或尚未测得时为默认值
+    double heater_cycle_estimate_s() const;
+    
     // 等待辅助方法
     bool wait_for_heater_cycles(int count, double timeout_s);
     bool wait_for_sensor_stability(double window_s, double threshold_percent, double timeout_s);
@@ -135,9 +288,11 @@ private:
     void emit_event(::enose::experiment::ExperimentEvent::EventType type, 
                    const std::string& message = "",
                    const std::map<std::string, std::string>& data = {});
-    void fill_status_response(::enose::experiment::ExperimentStatusResponse* response);
+    void forward_system_event(const ::enose::experiment::ExperimentEvent& event);
+    // 只带序号大于 after_log_index 的日志
+    void fill_status_response(::enose::experiment::ExperimentStatusResponse* response,
+                              uint64_t after_log_index = 0);
     bool check_stop_or_pause();
-    void wait_if_paused();
     
     // 转换系统状态
     workflows::SystemState::State convert_state(::enose::experiment::SystemState state);
@@ -149,8 +304,13 @@ private:
     // Action Executors (Phase 3)
     std::shared_ptr<workflows::HardwareStateMachine> hardware_state_machine_;
     std::unordered_map<std::string, std::shared_ptr<workflows::IActionExecutor>> executors_;
+    std::shared_ptr<hal::BaselineRecoveryMonitor> baseline_recovery_;
+    // 计划步骤流水线调度 (同时执行的步骤上限). 目前所有硬件步骤都切换 SystemState,
+    // 资源两两相交, 没有可重叠的步骤对; 保持逐步执行, 出现不冲突的执行器后再放开
+    static constexpr std::size_t MAX_PARALLEL_STEPS = 1;
+    std::unique_ptr<workflows::StepScheduler> scheduler_;
     void init_executors();
-    bool try_execute_with_executor(const ::enose::experiment::Step& step);
+    bool try_execute_with_executor(const enose::workflows::PlanStep& step);
 };
 
 } // namespace grpc_service
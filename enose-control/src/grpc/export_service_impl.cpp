@@ -0,0 +1,307 @@
+#include "grpc/export_service_impl.hpp"
+#include "core/metrics.hpp"
+#include "hal/feature_extractor.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <optional>
+
+namespace enose_grpc {
+
+namespace {
+
+std::optional<db::ExportTable> from_proto(::enose::service::ExportTable table) {
+    switch (table) {
+        case ::enose::service::EXPORT_SENSOR_READINGS: return db::ExportTable::SENSOR_READINGS;
+        case ::enose::service::EXPORT_FINGERPRINTS: return db::ExportTable::FINGERPRINTS;
+        case ::enose::service::EXPORT_WEIGHT_SAMPLES: return db::ExportTable::WEIGHT_SAMPLES;
+        case ::enose::service::EXPORT_EVENTS: return db::ExportTable::EVENTS;
+        case ::enose::service::EXPORT_STEPS: return db::ExportTable::STEPS;
+        default: return std::nullopt;
+    }
+}
+
+::enose::service::ExportTable to_proto(db::ExportTable table) {
+    switch (table) {
+        case db::ExportTable::SENSOR_READINGS: return ::enose::service::EXPORT_SENSOR_READINGS;
+        case db::ExportTable::FINGERPRINTS: return ::enose::service::EXPORT_FINGERPRINTS;
+        case db::ExportTable::WEIGHT_SAMPLES: return ::enose::service::EXPORT_WEIGHT_SAMPLES;
+        case db::ExportTable::EVENTS: return ::enose::service::EXPORT_EVENTS;
+        case db::ExportTable::STEPS: return ::enose::service::EXPORT_STEPS;
+    }
+    return ::enose::service::EXPORT_TABLE_UNSPECIFIED;
+}
+
+const char* column_type_name(db::ArchiveColumnType type) {
+    switch (type) {
+        case db::ArchiveColumnType::I64: return "i64";
+        case db::ArchiveColumnType::U64: return "u64";
+        case db::ArchiveColumnType::I32: return "i32";
+        case db::ArchiveColumnType::U32: return "u32";
+        case db::ArchiveColumnType::U16: return "u16";
+        case db::ArchiveColumnType::U8: return "u8";
+        case db::ArchiveColumnType::F32: return "f32";
+    }
+    return "";
+}
+
+int64_t to_unix_us(const google::protobuf::Timestamp& ts) {
+    return ts.seconds() * 1000000 + ts.nanos() / 1000;
+}
+
+void set_timestamp(google::protobuf::Timestamp* ts, int64_t unix_us) {
+    ts->set_seconds(unix_us / 1000000);
+    ts->set_nanos(static_cast<int32_t>((unix_us % 1000000) * 1000));
+}
+
+core::Counter& archive_bytes_counter() {
+    static core::Counter& counter = core::MetricsRegistry::instance().counter(
+        "run_archive_read_bytes_total", "Bytes served from run archives by ExportService.ReadRunArchive");
+    return counter;
+}
+
+} // namespace
+
+ExportServiceImpl::ExportServiceImpl(std::shared_ptr<const db::RunExportSource> source, Options options,
+                                     std::shared_ptr<db::RunArchiver> archiver)
+    : source_(std::move(source)), options_(std::move(options)), archiver_(std::move(archiver)) {}
+
+::grpc::Status ExportServiceImpl::ExportRun(
+    ::grpc::ServerContext* context,
+    const ::enose::service::ExportRunRequest* request,
+    ::grpc::ServerWriter<::enose::service::ExportRunChunk>* writer)
+{
+    using Request = ::enose::service::ExportRunRequest;
+
+    if (!db::ColumnarExporter::available()) {
+        return ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, "未编译 Apache Arrow / Parquet 支持");
+    }
+    if (request->run_id() <= 0) {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "需要指定 run_id");
+    }
+
+    db::ColumnarExportOptions options;
+    for (int i = 0; i < request->tables_size(); ++i) {
+        auto table = from_proto(request->tables(i));
+        if (!table) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "未知的导出表");
+        }
+        options.tables.push_back(*table);
+    }
+
+    switch (request->source()) {
+        case Request::SOURCE_DATABASE: options.origin = db::RunExportSource::Origin::DATABASE; break;
+        case Request::SOURCE_JOURNAL: options.origin = db::RunExportSource::Origin::JOURNAL; break;
+        default: options.origin = source_->preferred_origin(); break;
+    }
+    if (!source_->has_origin(options.origin)) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE,
+            options.origin == db::RunExportSource::Origin::JOURNAL ? "本地记录日志未启用" : "数据库未配置");
+    }
+    const auto scope = source_->resolve(request->run_id(), options.origin);
+    if (!scope) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "运行不存在: " + std::to_string(request->run_id()));
+    }
+
+    const std::size_t batch_rows = request->batch_rows() > 0 ? request->batch_rows() : options_.batch_rows;
+    options.batch_rows = std::clamp<std::size_t>(batch_rows, 1, MAX_BATCH_ROWS);
+    options.channels = source_->channels();
+    options.fingerprint = options_.fingerprint;
+    if (request->steps() > 0) {
+        options.fingerprint.steps = static_cast<uint8_t>(std::min<uint32_t>(request->steps(), hal::FeatureExtractor::MAX_HEATER_STEPS));
+    }
+    if (request->sensors() > 0) {
+        options.fingerprint.sensors = static_cast<uint8_t>(std::min<uint32_t>(request->sensors(), db::SensorReadingRecord::MAX_CHANNELS));
+    }
+    options.fingerprint.max_missing = request->max_missing();
+    options.fingerprint_drift_corrected = request->drift_corrected();
+    options.parquet_compression = options_.parquet_compression;
+    options.parquet_row_group_rows = options_.parquet_row_group_rows;
+
+    static core::Counter& bytes_total = core::MetricsRegistry::instance().counter(
+        "export_bytes_total", "Arrow IPC bytes streamed by ExportService.ExportRun");
+    static core::Histogram& duration = core::MetricsRegistry::instance().histogram(
+        "export_run_duration_seconds", "Duration of ExportService.ExportRun calls",
+        {0.1, 0.5, 1, 5, 15, 60, 300, 1800});
+
+    const auto started = std::chrono::steady_clock::now();
+    db::ColumnarExporter exporter(source_, std::move(options));
+    auto cancelled = [context]() { return context->IsCancelled(); };
+
+    db::ColumnarExportResult result;
+    uint64_t streamed_bytes = 0;
+    if (request->format() == Request::PARQUET) {
+        result = exporter.write_parquet(*scope, options_.directory, cancelled);
+        if (result.ok) {
+            for (const auto& [table, path] : result.files) {
+                ::enose::service::ExportRunChunk chunk;
+                chunk.set_table(to_proto(table));
+                chunk.set_rows(result.rows[static_cast<std::size_t>(table)]);
+                chunk.set_end_of_table(true);
+                chunk.set_parquet_path(path);
+                if (!writer->Write(chunk)) break;
+            }
+        }
+    } else {
+        result = exporter.stream(*scope,
+            [writer, &streamed_bytes](db::ExportTable table, std::string_view bytes, uint64_t rows, bool last) {
+                ::enose::service::ExportRunChunk chunk;
+                chunk.set_table(to_proto(table));
+                chunk.set_arrow_ipc(bytes.data(), bytes.size());
+                chunk.set_rows(rows);
+                chunk.set_end_of_table(last);
+                streamed_bytes += bytes.size();
+                return writer->Write(chunk);
+            },
+            cancelled);
+        bytes_total.inc(streamed_bytes);
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    duration.observe(seconds);
+    if (result.cancelled) {
+        return ::grpc::Status::CANCELLED;
+    }
+    if (!result.ok) {
+        spdlog::error("ExportService: Export of run {} failed: {}", request->run_id(), result.error);
+        return ::grpc::Status(::grpc::StatusCode::INTERNAL, result.error);
+    }
+
+    spdlog::info("ExportService: Exported run {} ({} readings, {} fingerprints, {} weight samples, {} events, "
+                 "{} steps, {} bytes) in {:.1f}s",
+                 request->run_id(),
+                 result.rows[static_cast<std::size_t>(db::ExportTable::SENSOR_READINGS)],
+                 result.rows[static_cast<std::size_t>(db::ExportTable::FINGERPRINTS)],
+                 result.rows[static_cast<std::size_t>(db::ExportTable::WEIGHT_SAMPLES)],
+                 result.rows[static_cast<std::size_t>(db::ExportTable::EVENTS)],
+                 result.rows[static_cast<std::size_t>(db::ExportTable::STEPS)],
+                 streamed_bytes, seconds);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExportServiceImpl::open_archive(int run_id, std::shared_ptr<const db::RunArchive>& archive) {
+    if (!archiver_) {
+        return ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, "运行归档未启用");
+    }
+    if (run_id <= 0) {
+        return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "需要指定 run_id");
+    }
+    archive = archiver_->open(run_id);
+    if (!archive) {
+        archiver_->request(run_id);
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "归档尚未生成, 已排队: " + std::to_string(run_id));
+    }
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExportServiceImpl::GetRunArchive(
+    ::grpc::ServerContext* /*context*/,
+    const ::enose::service::GetRunArchiveRequest* request,
+    ::enose::service::RunArchiveInfo* response)
+{
+    std::shared_ptr<const db::RunArchive> archive;
+    auto status = open_archive(request->run_id(), archive);
+    if (!status.ok()) return status;
+
+    const auto& header = archive->header();
+    response->set_run_id(header.run_id);
+    response->set_path(archive->path());
+    response->set_file_bytes(header.file_bytes);
+    response->set_rows(header.rows);
+    response->set_weight_rows(header.weight_rows);
+    set_timestamp(response->mutable_start_time(), header.start_us);
+    set_timestamp(response->mutable_end_time(), header.end_us);
+    const auto json = archive->json();
+    response->set_header_json(json.data(), json.size());
+    response->set_index_stride(header.index_stride);
+    for (const auto& column : archive->columns()) {
+        auto* c = response->add_columns();
+        const auto name = column.column_name();
+        c->set_name(name.data(), name.size());
+        c->set_type(column_type_name(column.type));
+        c->set_width(column.width);
+        c->set_weight_table(column.table == 1);
+        c->set_offset(column.offset);
+        c->set_count(column.count);
+    }
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status ExportServiceImpl::ReadRunArchive(
+    ::grpc::ServerContext* context,
+    const ::enose::service::ReadRunArchiveRequest* request,
+    ::grpc::ServerWriter<::enose::service::RunArchiveChunk>* writer)
+{
+    std::shared_ptr<const db::RunArchive> archive;
+    auto status = open_archive(request->run_id(), archive);
+    if (!status.ok()) return status;
+
+    const auto bytes = archive->bytes();
+    uint64_t served = 0;
+
+    if (request->columns_size() == 0) {
+        // 字节范围 (整个文件下载)
+        if (request->offset() > bytes.size()) {
+            return ::grpc::Status(::grpc::StatusCode::OUT_OF_RANGE, "offset 超出文件大小");
+        }
+        const uint64_t available = bytes.size() - request->offset();
+        const uint64_t end = request->offset() +
+            (request->length() > 0 ? std::min<uint64_t>(request->length(), available) : available);
+        for (uint64_t offset = request->offset(); offset < end;) {
+            if (context->IsCancelled()) return ::grpc::Status::CANCELLED;
+            const auto n = static_cast<std::size_t>(std::min<uint64_t>(end - offset, ARCHIVE_CHUNK_BYTES));
+            ::enose::service::RunArchiveChunk chunk;
+            chunk.set_file_offset(offset);
+            chunk.set_data(bytes.data() + offset, n);
+            if (!writer->Write(chunk)) break;
+            offset += n;
+            served += n;
+        }
+        archive_bytes_counter().inc(served);
+        return ::grpc::Status::OK;
+    }
+
+    std::vector<const db::ArchiveColumn*> columns;
+    for (int i = 0; i < request->columns_size(); ++i) {
+        const auto* column = archive->find_column(request->columns(i));
+        if (!column) {
+            return ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "归档中没有列: " + request->columns(i));
+        }
+        columns.push_back(column);
+    }
+
+    const int64_t start_us = request->has_start_time() ? to_unix_us(request->start_time())
+                                                       : std::numeric_limits<int64_t>::min();
+    const int64_t end_us = request->has_end_time() ? to_unix_us(request->end_time())
+                                                   : std::numeric_limits<int64_t>::max();
+    const auto reading_rows = archive->row_range(start_us, end_us);
+    const auto weight_rows = archive->weight_row_range(start_us, end_us);
+
+    for (const auto* column : columns) {
+        const auto [first, last] = column->table == 1 ? weight_rows : reading_rows;
+        const uint64_t rows_per_chunk = std::max<uint64_t>(1, ARCHIVE_CHUNK_BYTES / column->width);
+        const auto name = column->column_name();
+        for (uint64_t row = first; row < last;) {
+            if (context->IsCancelled()) return ::grpc::Status::CANCELLED;
+            const uint64_t rows = std::min(last - row, rows_per_chunk);
+            const uint64_t offset = column->offset + row * column->width;
+            ::enose::service::RunArchiveChunk chunk;
+            chunk.set_column(name.data(), name.size());
+            chunk.set_first_row(row);
+            chunk.set_rows(rows);
+            chunk.set_file_offset(offset);
+            chunk.set_data(bytes.data() + offset, static_cast<std::size_t>(rows * column->width));
+            if (!writer->Write(chunk)) {
+                archive_bytes_counter().inc(served);
+                return ::grpc::Status::OK;
+            }
+            row += rows;
+            served += rows * column->width;
+        }
+    }
+    archive_bytes_counter().inc(served);
+    return ::grpc::Status::OK;
+}
+
+} // namespace enose_grpc
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include "enose_service.grpc.pb.h"
+#include "db/columnar_export.hpp"
+#include "db/run_archiver.hpp"
+#include "db/run_export.hpp"
+#include "hal/fingerprint_assembler.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace enose_grpc {
+
+/**
+ * @brief gRPC ExportService 实现
+ *
+ * ExportRun: 由 db::ColumnarExporter 把一次运行的读数、指纹、称重样本、系统日志和阶段边界
+ * 转成 Arrow 列式数据, 以 IPC stream 分段推送或在服务器上写成 Parquet 文件.
+ * 数据经 RunExportSource 的游标逐页读取 (数据库或本地记录日志), 在 gRPC 同步线程池上运行,
+ * 每页之间检查客户端取消.
+ *
+ * GetRunArchive / ReadRunArchive: 由 db::RunArchiver 生成的已结束运行归档, 整个文件 mmap,
+ * 按字节范围或按时间范围 (两级索引二分定位) 切出列数据, 不访问数据库.
+ */
+class ExportServiceImpl final : public ::enose::service::ExportService::Service {
+public:
+    struct Options {
+        std::string directory = "/var/lib/enose-control/exports";
+        std::size_t batch_rows = 4096;
+        std::string parquet_compression = "zstd";
+        std::size_t parquet_row_group_rows = 65536;
+        hal::FingerprintConfig fingerprint;     // 请求未指定的指纹参数
+    };
+
+    // ReadRunArchive 每条消息的数据上限
+    static constexpr std::size_t ARCHIVE_CHUNK_BYTES = 1 << 20;
+
+    // 32 通道时一个 batch 约 280 字节/行, 限制单条消息在 gRPC 默认 4MB 接收上限之内
+    static constexpr std::size_t MAX_BATCH_ROWS = 8192;
+
+    ExportServiceImpl(std::shared_ptr<const db::RunExportSource> source, Options options,
+                      std::shared_ptr<db::RunArchiver> archiver = nullptr);
+
+    ::grpc::Status ExportRun(
+        ::grpc::ServerContext* context,
+        const ::enose::service::ExportRunRequest* request,
+        ::grpc::ServerWriter<::enose::service::ExportRunChunk>* writer) override;
+
+    ::grpc::Status GetRunArchive(
+        ::grpc::ServerContext* context,
+        const ::enose::service::GetRunArchiveRequest* request,
+        ::enose::service::RunArchiveInfo* response) override;
+
+    ::grpc::Status ReadRunArchive(
+        ::grpc::ServerContext* context,
+        const ::enose::service::ReadRunArchiveRequest* request,
+        ::grpc::ServerWriter<::enose::service::RunArchiveChunk>* writer) override;
+
+private:
+    // 归档未启用 / 尚未生成时返回对应的错误状态
+    ::grpc::Status open_archive(int run_id, std::shared_ptr<const db::RunArchive>& archive);
+
+    std::shared_ptr<const db::RunExportSource> source_;
+    Options options_;
+    std::shared_ptr<db::RunArchiver> archiver_;
+};
+
+} // namespace enose_grpc
@@ -5,58 +5,237 @@
 #include "grpc/test_service_impl.hpp"
 #include "grpc/experiment_service_impl.hpp"
 #include "grpc/consumable_service_impl.hpp"
+#include "grpc/data_service_impl.hpp"
+#include "grpc/export_service_impl.hpp"
+#include "grpc/grpc_web_gateway.hpp"
 #include "hal/load_cell_driver.hpp"
-#include "db/consumable_repository.hpp"
+#include "hal/sensor_board_group.hpp"
+#include "hal/sensor_driver.hpp"
+#include "db/consumable_cache.hpp"
+#include "db/recording_journal.hpp"
+#include "db/run_export.hpp"
+#include "core/config.hpp"
+#include "core/metrics.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 
 namespace enose_grpc {
 
+namespace {
+
+// 实时指纹与导出共用的默认参数
+hal::FingerprintConfig fingerprint_config(const core::AnalysisConfig& analysis) {
+    hal::FingerprintConfig config;
+    config.steps = static_cast<uint8_t>(std::clamp(analysis.fingerprint_steps, 1,
+        static_cast<int>(hal::FeatureExtractor::MAX_HEATER_STEPS)));
+    config.sensors = static_cast<uint8_t>(std::clamp(analysis.fingerprint_sensors, 1,
+        static_cast<int>(db::SensorReadingRecord::MAX_CHANNELS)));
+    config.max_missing = static_cast<uint32_t>(std::max(analysis.fingerprint_max_missing, 0));
+    return config;
+}
+
+// 启动与热加载共用: 由配置生成 DataService 的分析参数 (不含仓库/事件等依赖)
+DataServiceImpl::AnalysisOptions analysis_options(const core::ConfigValues& config) {
+    const auto& analysis = config.analysis;
+    DataServiceImpl::AnalysisOptions options;
+    auto& features = options.features;
+    features.baseline_alpha = static_cast<float>(analysis.baseline_alpha);
+    features.noise_threshold = static_cast<float>(analysis.noise_threshold);
+    features.baseline_drift_threshold = static_cast<float>(analysis.baseline_drift_threshold);
+    features.min_value = static_cast<float>(analysis.saturation_min);
+    features.max_value = static_cast<float>(analysis.saturation_max);
+    features.humidity_min = static_cast<float>(analysis.humidity_min);
+    features.humidity_max = static_cast<float>(analysis.humidity_max);
+    features.temperature_min = static_cast<float>(analysis.temperature_min);
+    features.temperature_max = static_cast<float>(analysis.temperature_max);
+    options.baseline.alpha = static_cast<float>(analysis.drift_alpha);
+    options.baseline.clip = static_cast<float>(analysis.drift_clip);
+    options.baseline.warmup_samples = static_cast<uint32_t>(std::max(analysis.drift_warmup_samples, 1));
+    options.baseline_phases = analysis.baseline_phases;
+    options.persist_interval = std::chrono::seconds(std::max(analysis.baseline_persist_interval_sec, 1));
+    options.fingerprint = fingerprint_config(analysis);
+    const auto& inference = config.inference;
+    if (inference.enabled) {
+        // 相对路径按配置文件所在目录解析
+        std::filesystem::path model_path(inference.model_path);
+        if (model_path.is_relative()) {
+            model_path = std::filesystem::path(core::Config::instance().config_path()).parent_path() / model_path;
+        }
+        hal::InferenceOptions inference_opts;
+        inference_opts.model_path = model_path.string();
+        inference_opts.max_batch = static_cast<std::size_t>(std::max(inference.max_batch, 1));
+        inference_opts.queue_capacity = static_cast<std::size_t>(std::max(inference.queue_capacity, 1));
+        options.inference = std::move(inference_opts);
+        options.min_confidence = inference.min_confidence;
+    }
+    return options;
+}
+
+grpc_compression_level compression_level(const std::string& name) {
+    if (name == "low") return GRPC_COMPRESS_LEVEL_LOW;
+    if (name == "medium") return GRPC_COMPRESS_LEVEL_MED;
+    if (name == "high") return GRPC_COMPRESS_LEVEL_HIGH;
+    return GRPC_COMPRESS_LEVEL_NONE;
+}
+
+} // namespace
+
 GrpcServer::GrpcServer(
     std::shared_ptr<hal::ActuatorDriver> actuator,
     std::shared_ptr<workflows::SystemState> system_state,
     std::shared_ptr<hal::SensorDriver> sensor,
     std::shared_ptr<hal::LoadCellDriver> load_cell,
     std::shared_ptr<db::TestRunRepository> repository,
-    std::shared_ptr<db::ConsumableRepository> consumable_repo
+    std::shared_ptr<db::ConsumableCache> consumable_cache,
+    std::shared_ptr<db::SensorReadingRepository> sensor_reading_repo,
+    std::shared_ptr<db::SensorBaselineRepository> sensor_baseline_repo,
+    std::shared_ptr<hal::SensorBoardGroup> sensor_boards,
+    std::shared_ptr<db::RecordingJournal> journal,
+    std::shared_ptr<db::RunArchiver> run_archiver
 ) : actuator_(std::move(actuator))
   , system_state_(std::move(system_state))
   , sensor_(std::move(sensor))
   , load_cell_(std::move(load_cell))
   , repository_(std::move(repository))
-  , consumable_repo_(std::move(consumable_repo)) {}
+  , consumable_cache_(std::move(consumable_cache))
+  , sensor_reading_repo_(std::move(sensor_reading_repo))
+  , sensor_baseline_repo_(std::move(sensor_baseline_repo))
+  , sensor_boards_(std::move(sensor_boards))
+  , journal_(std::move(journal))
+  , run_archiver_(std::move(run_archiver))
+  , system_events_(std::make_shared<SystemEventBus>(SYSTEM_EVENT_CAPACITY)) {
+
+    auto watch_board = [this](const std::shared_ptr<hal::SensorDriver>& driver, std::string device_id) {
+        sensor_connections_.emplace_back(driver->on_connection_changed.connect(
+            [events = system_events_, device_id = std::move(device_id)](bool connected) {
+                auto severity = connected ? ::enose::data::Event::INFO : ::enose::data::Event::WARNING;
+                const char* text = connected ? "Sensor board connected" : "Sensor board disconnected";
+                const char* state = connected ? "true" : "false";
+                // 单板时 device_id 为空, 事件字段与以前一致
+                if (device_id.empty()) {
+                    publish_system_event(*events, ::enose::data::Event::DEVICE_STATUS, severity, text,
+                        {{"device", "sensor"}, {"connected", state}});
+                } else {
+                    publish_system_event(*events, ::enose::data::Event::DEVICE_STATUS, severity, text,
+                        {{"device", "sensor"}, {"connected", state}, {"device_id", device_id}});
+                }
+            }));
+    };
+    if (sensor_boards_) {
+        for (const auto& board : sensor_boards_->boards()) {
+            watch_board(board.driver, sensor_boards_->size() > 1 ? board.device_id : std::string());
+        }
+    } else if (sensor_) {
+        watch_board(sensor_, {});
+    }
+}
 
 GrpcServer::~GrpcServer() {
     stop();
 }
 
-void GrpcServer::start(const std::string& address) {
-    if (running_) {
+std::shared_future<bool> GrpcServer::start(const std::string& address) {
+    if (running_ || server_thread_.joinable()) {
         spdlog::warn("GrpcServer: Already running");
-        return;
+        std::promise<bool> already;
+        already.set_value(running_);
+        return already.get_future().share();
     }
+    auto started = started_.get_future().share();
 
     server_thread_ = std::thread([this, address]() {
         // 创建服务实现
-        ControlServiceImpl control_service(actuator_, system_state_, load_cell_);
+        ControlServiceImpl control_service(actuator_, system_state_, load_cell_, system_events_);
         std::unique_ptr<SensorServiceImpl> sensor_service;
         std::unique_ptr<LoadCellServiceImpl> load_cell_service;
         std::unique_ptr<grpc_service::TestServiceImpl> test_service;
         std::unique_ptr<grpc_service::ExperimentServiceImpl> experiment_service;
         std::unique_ptr<grpc_service::ConsumableServiceImpl> consumable_service;
+        std::unique_ptr<DataServiceImpl> data_service;
+        std::unique_ptr<ExportServiceImpl> export_service;
+        
+        stream_compression_level().store(compression_level(core::Config::instance().grpc.stream_compression));
         
         if (sensor_) {
-            sensor_service = std::make_unique<SensorServiceImpl>(sensor_);
+            const auto& grpc_config = core::Config::instance().grpc;
+            auto overflow = grpc_config.stream_overflow == "decimate"
+                ? OverflowPolicy::DECIMATE : OverflowPolicy::DROP_OLDEST;
+            sensor_service = std::make_unique<SensorServiceImpl>(
+                sensor_, static_cast<std::size_t>(grpc_config.stream_queue_size), overflow, sensor_boards_);
         }
+        // 自适应清洗的基线判据: DataService 每帧更新, ExperimentService 的清洗步骤等待
+        auto baseline_recovery = sensor_ ? std::make_shared<hal::BaselineRecoveryMonitor>() : nullptr;
+        
         if (load_cell_) {
             load_cell_service = std::make_unique<LoadCellServiceImpl>(load_cell_);
             // TestService 需要 system_state, load_cell 和 repository
             test_service = std::make_unique<grpc_service::TestServiceImpl>(system_state_, load_cell_, repository_);
-            // ExperimentService 需要 system_state, load_cell, sensor 和 consumable_repo
-            experiment_service = std::make_unique<grpc_service::ExperimentServiceImpl>(system_state_, load_cell_, sensor_, consumable_repo_);
+            // ExperimentService 需要 system_state, load_cell, sensor 和 consumable_cache
+            experiment_service = std::make_unique<grpc_service::ExperimentServiceImpl>(
+                system_state_, load_cell_, sensor_, consumable_cache_, repository_, system_events_);
+            experiment_service->set_baseline_recovery(baseline_recovery);
         }
         
-        // ConsumableService 不需要外部依赖
-        consumable_service = std::make_unique<grpc_service::ConsumableServiceImpl>();
+        // DataService 需要 sensor, 帧标签来自 experiment_service 和 system_state;
+        // 有 sensor_reading_repo 时同时负责把每帧写入 sensor_readings
+        if (sensor_) {
+            auto* experiment = experiment_service.get();
+            auto system_state = system_state_;
+            auto options = analysis_options(core::Config::instance());
+            options.baseline_repo = sensor_baseline_repo_;
+            options.events = system_events_;
+            options.recovery = baseline_recovery;
+            data_service = std::make_unique<DataServiceImpl>(
+                sensor_, core::Config::instance().sensor.device_id,
+                [experiment, system_state]() {
+                    DataServiceImpl::FrameContext ctx;
+                    if (experiment) {
+                        auto run = experiment->run_context();
+                        ctx.run_id = std::move(run.run_id);
+                        ctx.phase_name = std::move(run.phase_name);
+                        ctx.db_run_id = run.db_run_id;
+                    }
+                    // valve_air: 0 排气 (旁路), 1 气室
+                    ctx.gas_mode = system_state->get_peripheral_state().valve_air > 0.5f
+                        ? ::enose::data::SensorFrame::CHAMBER
+                        : ::enose::data::SensorFrame::BYPASS;
+                    return ctx;
+                },
+                sensor_reading_repo_, std::move(options));
+            std::lock_guard<std::mutex> lock(data_service_mutex_);
+            data_service_ = data_service.get();
+        }
+        
+        // ConsumableService 始终注册; 未启用数据库时用独立缓存, 读取返回空快照
+        if (!consumable_cache_) {
+            consumable_cache_ = std::make_shared<db::ConsumableCache>(std::make_shared<db::ConsumableRepository>());
+        }
+        consumable_service = std::make_unique<grpc_service::ConsumableServiceImpl>(consumable_cache_);
+        
+        // ExportService 需要数据库或本地记录日志之一
+        if (repository_ || journal_) {
+            const auto& exports = core::Config::instance().local.exports;
+            ExportServiceImpl::Options export_opts;
+            export_opts.directory = exports.directory;
+            export_opts.batch_rows = static_cast<std::size_t>(std::max(exports.batch_rows, 1));
+            export_opts.parquet_compression = exports.parquet_compression;
+            export_opts.parquet_row_group_rows = static_cast<std::size_t>(std::max(exports.parquet_row_group_rows, 1));
+            export_opts.fingerprint = fingerprint_config(core::Config::instance().analysis);
+            export_service = std::make_unique<ExportServiceImpl>(
+                std::make_shared<db::RunExportSource>(sensor_reading_repo_, repository_, journal_),
+                std::move(export_opts), run_archiver_);
+        }
+        
+        // 抓取时导出各服务的流积压和工作流统计; 先于上面的服务析构
+        auto metrics_registration = core::MetricsRegistry::instance().add_collector(
+            [&](core::MetricWriter& writer) {
+                if (sensor_service) sensor_service->collect_metrics(writer);
+                if (load_cell_service) load_cell_service->collect_metrics(writer);
+                if (experiment_service) experiment_service->collect_metrics(writer);
+                if (data_service) data_service->collect_metrics(writer);
+            });
         
         // 构建服务器
         ::grpc::ServerBuilder builder;
@@ -77,24 +256,78 @@ void GrpcServer::start(const std::string& address) {
         if (consumable_service) {
             builder.RegisterService(consumable_service.get());
         }
+        if (data_service) {
+            builder.RegisterService(data_service.get());
+        }
+        if (export_service) {
+            builder.RegisterService(export_service.get());
+        }
         
         server_ = builder.BuildAndStart();
         
         if (server_) {
             spdlog::info("GrpcServer: Listening on {}", address);
             running_ = true;
+            started_.set_value(true);
+            publish_system_event(*system_events_, ::enose::data::Event::SYSTEM_STARTUP,
+                ::enose::data::Event::INFO, "gRPC server started", {{"address", address}});
+            start_web_gateway();
             server_->Wait();
         } else {
             spdlog::error("GrpcServer: Failed to start on {}", address);
+            started_.set_value(false);
         }
         
         running_ = false;
+        std::lock_guard<std::mutex> lock(data_service_mutex_);
+        data_service_ = nullptr;
     });
+    return started;
+}
+
+void GrpcServer::apply_config(const core::ConfigValues& config) {
+    std::lock_guard<std::mutex> lock(data_service_mutex_);
+    if (data_service_) {
+        data_service_->update_analysis(analysis_options(config));
+    }
+}
+
+void GrpcServer::start_web_gateway() {
+    const auto& web = core::Config::instance().grpc.web;
+    if (!web.enabled) return;
+
+    GrpcWebGateway::Options options;
+    options.host = web.host;
+    options.port = static_cast<uint16_t>(web.port);
+    options.flush_interval = std::chrono::milliseconds(web.flush_interval_ms);
+    options.max_coalesce_bytes = static_cast<std::size_t>(web.max_coalesce_bytes);
+    options.allow_origin = web.allow_origin;
+
+    std::lock_guard<std::mutex> lock(web_gateway_mutex_);
+    try {
+        auto gateway = std::make_unique<GrpcWebGateway>(
+            server_->InProcessChannel(GrpcWebGateway::make_channel_arguments()), options);
+        gateway->start();
+        web_gateway_ = std::move(gateway);
+    } catch (const std::exception& e) {
+        // 网关不可用不影响原生 gRPC 客户端
+        spdlog::error("GrpcServer: Failed to start grpc-web gateway on {}:{}: {}", web.host, web.port, e.what());
+    }
 }
 
 void GrpcServer::stop() {
+    {
+        // 网关的调用经进程内通道进入 server_, 须在 Shutdown 之前结束
+        std::lock_guard<std::mutex> lock(web_gateway_mutex_);
+        if (web_gateway_) {
+            web_gateway_->stop();
+            web_gateway_.reset();
+        }
+    }
     if (server_) {
         spdlog::info("GrpcServer: Shutting down...");
+        // 先结束 SubscribeEvents 流, 否则 Shutdown 会等待这些长连接
+        system_events_->close_all();
         server_->Shutdown();
     }
     
@@ -1,13 +1,20 @@
 #pragma once
 
+#include "grpc/system_events.hpp"
+#include <boost/signals2.hpp>
 #include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace hal {
 class ActuatorDriver;
 class SensorDriver;
+class SensorBoardGroup;
 class LoadCellDriver;
 }
 
@@ -17,11 +24,22 @@ class SystemState;
 
 namespace db {
 class TestRunRepository;
-class ConsumableRepository;
+class ConsumableCache;
+class SensorReadingRepository;
+class SensorBaselineRepository;
+class RecordingJournal;
+class RunArchiver;
+}
+
+namespace core {
+struct ConfigValues;
 }
 
 namespace enose_grpc {
 
+class GrpcWebGateway;
+class DataServiceImpl;
+
 /**
  * @brief gRPC 服务器管理类
  * 
@@ -35,15 +53,21 @@ public:
         std::shared_ptr<hal::SensorDriver> sensor = nullptr,
         std::shared_ptr<hal::LoadCellDriver> load_cell = nullptr,
         std::shared_ptr<db::TestRunRepository> repository = nullptr,
-        std::shared_ptr<db::ConsumableRepository> consumable_repo = nullptr
+        std::shared_ptr<db::ConsumableCache> consumable_cache = nullptr,
+        std::shared_ptr<db::SensorReadingRepository> sensor_reading_repo = nullptr,
+        std::shared_ptr<db::SensorBaselineRepository> sensor_baseline_repo = nullptr,
+        std::shared_ptr<hal::SensorBoardGroup> sensor_boards = nullptr,
+        std::shared_ptr<db::RecordingJournal> journal = nullptr,
+        std::shared_ptr<db::RunArchiver> run_archiver = nullptr
     );
     ~GrpcServer();
 
     /**
-     * @brief 启动 gRPC 服务器
+     * @brief 启动 gRPC 服务器 (在独立线程上构建并监听, 立即返回)
      * @param address 监听地址 (e.g., "0.0.0.0:50051")
+     * @return 开始监听 (true) 或监听失败 (false) 时完成
      */
-    void start(const std::string& address = "0.0.0.0:50051");
+    std::shared_future<bool> start(const std::string& address = "0.0.0.0:50051");
 
     /**
      * @brief 停止 gRPC 服务器
@@ -55,16 +79,45 @@ public:
      */
     bool is_running() const { return running_; }
 
+    /**
+     * @brief 系统事件总线 (SubscribeEvents 的数据源), 供进程内其他模块发布事件
+     */
+    std::shared_ptr<SystemEventBus> system_events() const { return system_events_; }
+
+    /**
+     * @brief 配置热加载: 把 analysis 阈值与 inference 批量/队列参数交给运行中的 DataService
+     *
+     * 指纹矩阵形状、推理开关和模型路径仍只在启动时读取. 服务未运行时忽略.
+     */
+    void apply_config(const core::ConfigValues& config);
+
 private:
+    static constexpr std::size_t SYSTEM_EVENT_CAPACITY = 1024;
+
+    /** @brief 服务器线程: server_ 启动后按 grpc.web 配置启动 grpc-web 网关; 失败只记录日志 */
+    void start_web_gateway();
+
     std::shared_ptr<hal::ActuatorDriver> actuator_;
     std::shared_ptr<workflows::SystemState> system_state_;
     std::shared_ptr<hal::SensorDriver> sensor_;
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
     std::shared_ptr<db::TestRunRepository> repository_;
-    std::shared_ptr<db::ConsumableRepository> consumable_repo_;
+    std::shared_ptr<db::ConsumableCache> consumable_cache_;
+    std::shared_ptr<db::SensorReadingRepository> sensor_reading_repo_;
+    std::shared_ptr<db::SensorBaselineRepository> sensor_baseline_repo_;
+    std::shared_ptr<hal::SensorBoardGroup> sensor_boards_;     // 多板时非空, sensor_ 为其主板
+    std::shared_ptr<db::RecordingJournal> journal_;            // ExportRun 在数据库不可用时的数据源
+    std::shared_ptr<db::RunArchiver> run_archiver_;            // GetRunArchive / ReadRunArchive
+    std::shared_ptr<SystemEventBus> system_events_;
+    std::vector<boost::signals2::scoped_connection> sensor_connections_;
     std::unique_ptr<::grpc::Server> server_;
+    std::mutex web_gateway_mutex_;
+    std::unique_ptr<GrpcWebGateway> web_gateway_;              // grpc.web.enabled 时在 server_ 启动后创建
+    std::mutex data_service_mutex_;
+    DataServiceImpl* data_service_ = nullptr;                  // 服务器线程持有, 析构前清空
     std::thread server_thread_;
-    bool running_{false};
+    std::promise<bool> started_;
+    std::atomic<bool> running_{false};
 };
 
 } // namespace enose_grpc
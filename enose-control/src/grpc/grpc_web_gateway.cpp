@@ -0,0 +1,814 @@
+#include "grpc/grpc_web_gateway.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace enose_grpc {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace {
+
+constexpr uint8_t FRAME_DATA = 0x00;
+constexpr uint8_t FRAME_COMPRESSED = 0x01;
+constexpr uint8_t FRAME_TRAILER = 0x80;
+constexpr std::size_t FRAME_HEADER_SIZE = 5;
+
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds(60);     // keep-alive 连接等待下一个请求
+constexpr auto WRITE_TIMEOUT = std::chrono::seconds(30);    // 客户端停止接收超过该时间即放弃调用
+constexpr const char* CONTENT_TYPE = "application/grpc-web+proto";
+
+void put_frame_header(std::array<char, FRAME_HEADER_SIZE>& header, uint8_t flag, std::size_t length) {
+    header[0] = static_cast<char>(flag);
+    header[1] = static_cast<char>((length >> 24) & 0xFF);
+    header[2] = static_cast<char>((length >> 16) & 0xFF);
+    header[3] = static_cast<char>((length >> 8) & 0xFF);
+    header[4] = static_cast<char>(length & 0xFF);
+}
+
+// grpc-message 按 gRPC 规范百分号编码: 可打印 ASCII (除 '%') 原样保留, 其余 (如中文) 按 UTF-8 字节编码
+std::string percent_encode(std::string_view text) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(text.size());
+    for (unsigned char c : text) {
+        if (c >= 0x20 && c <= 0x7E && c != '%') {
+            out.push_back(static_cast<char>(c));
+        } else {
+            out.push_back('%');
+            out.push_back(HEX[c >> 4]);
+            out.push_back(HEX[c & 0x0F]);
+        }
+    }
+    return out;
+}
+
+std::string_view to_view(beast::string_view text) {
+    return {text.data(), text.size()};
+}
+
+bool is_grpc_web(std::string_view content_type) {
+    content_type = content_type.substr(0, content_type.find(';'));
+    return content_type == "application/grpc-web" || content_type == "application/grpc-web+proto";
+}
+
+/** @brief 请求路径 "/pkg.Service/Method" (去掉查询串); 格式不对时返回空 */
+std::string method_path(std::string_view target) {
+    target = target.substr(0, target.find('?'));
+    if (target.size() < 4 || target.front() != '/') return {};
+    const auto slash = target.find('/', 1);
+    if (slash == std::string_view::npos || slash == 1 || slash + 1 >= target.size() ||
+        target.find('/', slash + 1) != std::string_view::npos) {
+        return {};
+    }
+    return std::string(target);
+}
+
+/**
+ * @brief 取出请求中的数据帧 (grpc-web 请求只有一帧); 空请求体视为空消息
+ */
+bool parse_request_frame(std::string_view body, std::string_view& message, ::grpc::Status& error) {
+    if (body.empty()) {
+        message = {};
+        return true;
+    }
+    if (body.size() < FRAME_HEADER_SIZE) {
+        error = ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "truncated grpc-web frame");
+        return false;
+    }
+    const auto flag = static_cast<uint8_t>(body[0]);
+    const std::size_t length = (static_cast<std::size_t>(static_cast<uint8_t>(body[1])) << 24) |
+                               (static_cast<std::size_t>(static_cast<uint8_t>(body[2])) << 16) |
+                               (static_cast<std::size_t>(static_cast<uint8_t>(body[3])) << 8) |
+                               static_cast<std::size_t>(static_cast<uint8_t>(body[4]));
+    if (flag & FRAME_COMPRESSED) {
+        error = ::grpc::Status(::grpc::StatusCode::UNIMPLEMENTED, "compressed grpc-web frames are not supported");
+        return false;
+    }
+    if (flag != FRAME_DATA) {
+        error = ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "expected a grpc-web data frame");
+        return false;
+    }
+    if (length > body.size() - FRAME_HEADER_SIZE) {
+        error = ::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT, "truncated grpc-web frame");
+        return false;
+    }
+    message = body.substr(FRAME_HEADER_SIZE, length);
+    return true;
+}
+
+template<typename Message>
+void set_cors(Message& message, const std::string& allow_origin, bool preflight) {
+    if (allow_origin.empty()) return;
+    message.set(http::field::access_control_allow_origin, allow_origin);
+    message.set(http::field::access_control_expose_headers, "grpc-status, grpc-message");
+    if (preflight) {
+        message.set(http::field::access_control_allow_methods, "POST, OPTIONS");
+        message.set(http::field::access_control_allow_headers, "content-type, x-grpc-web, x-user-agent, grpc-timeout");
+        message.set(http::field::access_control_max_age, "86400");
+    }
+}
+
+} // namespace
+
+/**
+ * @brief 待写出的一帧: 数据帧引用 gRPC 的接收缓冲 (不复制), trailer 帧自带文本
+ */
+struct GrpcWebGateway::Frame {
+    std::array<char, FRAME_HEADER_SIZE> header{};
+    std::vector<::grpc::Slice> slices;
+    std::string text;
+    std::size_t size = FRAME_HEADER_SIZE;
+
+    static Frame trailer(const ::grpc::Status& status) {
+        Frame frame;
+        frame.text = "grpc-status:" + std::to_string(static_cast<int>(status.error_code())) + "\r\n";
+        if (!status.error_message().empty()) {
+            frame.text += "grpc-message:" + percent_encode(status.error_message()) + "\r\n";
+        }
+        put_frame_header(frame.header, FRAME_TRAILER, frame.text.size());
+        frame.size += frame.text.size();
+        return frame;
+    }
+
+    void append_buffers(std::vector<net::const_buffer>& out) const {
+        out.emplace_back(header.data(), header.size());
+        for (const auto& slice : slices) {
+            out.emplace_back(slice.begin(), slice.size());
+        }
+        if (!text.empty()) out.emplace_back(text.data(), text.size());
+    }
+};
+
+/**
+ * @brief 一个连接上调用的写出端 (HTTP 与 WebSocket 共用): 合并写出与读取节流
+ *
+ * 除构造外的成员只在连接的 strand 上访问, Call 的回调 post 过来.
+ */
+class GrpcWebGateway::Exchange : public std::enable_shared_from_this<Exchange> {
+public:
+    Exchange(GrpcWebGateway& gateway, net::any_io_executor executor)
+        : gateway_(gateway), executor_(std::move(executor)), flush_timer_(executor_) {}
+    virtual ~Exchange() = default;
+
+    const net::any_io_executor& executor() const { return executor_; }
+
+    void on_message(Frame frame);
+    void on_read_end();
+    void on_finish(const ::grpc::Status& status);
+
+    /** @brief 关闭传输 (网关停止或客户端已断开); 在途的写随之失败 */
+    virtual void close() = 0;
+
+protected:
+    /** @brief 开始一次调用; request 在返回前已复制 */
+    void begin_call(const std::string& method, std::string_view request);
+    /** @brief 不发起调用, 直接以 status 结束 (请求无效) */
+    void fail_call(const ::grpc::Status& status);
+    /** @brief 客户端已断开或写失败: 取消调用, 之后不再写出 */
+    void abort_call();
+
+    /** @brief 写出一批帧, 完成后调用 on_written; last 表示其中含 trailer */
+    virtual void write_frames(const std::vector<net::const_buffer>& buffers, bool last) = 0;
+    void on_written(beast::error_code ec, std::size_t bytes, bool last);
+    /** @brief trailer 已写出 */
+    virtual void on_complete() = 0;
+
+    GrpcWebGateway& gateway_;
+
+private:
+    void reset();
+    void read_next();
+    void release_call();
+    void schedule_flush();
+    void flush();
+
+    net::any_io_executor executor_;
+    net::steady_timer flush_timer_;
+    Call* call_ = nullptr;              // release_call() 之后不再访问
+    bool reading_ = false;              // 有读在途
+    bool read_ended_ = false;
+    bool finished_ = false;             // trailer 已入队
+    bool aborted_ = false;
+    bool writing_ = false;
+    bool timer_armed_ = false;
+    std::vector<Frame> pending_;
+    std::size_t pending_bytes_ = 0;
+    std::vector<Frame> writing_frames_; // 在途写引用的帧
+    std::vector<net::const_buffer> buffers_;
+};
+
+/**
+ * @brief 一次转发的通用调用 (callback API)
+ *
+ * 构造时写出请求并半关闭 (StartWriteLast), 发起第一次读; 之后的读由 Exchange 按写出进度
+ * 在其 strand 上发起. 构造时 AddHold, Exchange 不再读 (流结束或放弃) 时 release(), 此后才会
+ * OnDone, 因此 release() 之前 Exchange 可以随时调用 read_next(). 对象在 OnDone() 中自删除.
+ */
+class GrpcWebGateway::Call : public ::grpc::ClientBidiReactor<::grpc::ByteBuffer, ::grpc::ByteBuffer> {
+public:
+    Call(GrpcWebGateway& gateway, std::shared_ptr<Exchange> exchange, const std::string& method,
+         std::string_view request)
+        : gateway_(gateway), exchange_(std::move(exchange))
+        , context_(std::make_shared<::grpc::ClientContext>()) {
+        ::grpc::Slice slice(request.data(), request.size());
+        request_ = ::grpc::ByteBuffer(&slice, 1);
+        gateway_.stub_.PrepareBidiStreamingCall(context_.get(), method, ::grpc::StubOptions(), this);
+        StartWriteLast(&request_, ::grpc::WriteOptions());
+        StartRead(&response_);
+        AddHold();
+        const bool accepted = gateway_.register_call(context_);
+        StartCall();
+        if (!accepted) context_->TryCancel();
+    }
+
+    void read_next() { StartRead(&response_); }
+    void release() { RemoveHold(); }
+    void cancel() { context_->TryCancel(); }
+
+    void OnReadDone(bool ok) override {
+        auto exchange = exchange_;
+        if (!ok) {
+            net::post(exchange->executor(), [exchange]() { exchange->on_read_end(); });
+            return;
+        }
+        Frame frame;
+        if (!response_.Dump(&frame.slices).ok()) frame.slices.clear();
+        for (const auto& slice : frame.slices) frame.size += slice.size();
+        put_frame_header(frame.header, FRAME_DATA, frame.size - FRAME_HEADER_SIZE);
+        response_.Clear();
+        net::post(exchange->executor(), [exchange, frame = std::move(frame)]() mutable {
+            exchange->on_message(std::move(frame));
+        });
+    }
+
+    void OnDone(const ::grpc::Status& status) override {
+        auto executor = exchange_->executor();
+        net::post(executor, [exchange = std::move(exchange_), status]() { exchange->on_finish(status); });
+        gateway_.unregister_call(context_.get());
+        delete this;
+    }
+
+private:
+    GrpcWebGateway& gateway_;
+    std::shared_ptr<Exchange> exchange_;
+    std::shared_ptr<::grpc::ClientContext> context_;    // stop() 可能在调用结束后仍持有并取消
+    ::grpc::ByteBuffer request_;
+    ::grpc::ByteBuffer response_;
+};
+
+// ------------------------------------------------------------
+// Exchange
+// ------------------------------------------------------------
+
+void GrpcWebGateway::Exchange::reset() {
+    call_ = nullptr;
+    reading_ = false;
+    read_ended_ = false;
+    finished_ = false;
+    aborted_ = false;
+    pending_.clear();
+    pending_bytes_ = 0;
+}
+
+void GrpcWebGateway::Exchange::begin_call(const std::string& method, std::string_view request) {
+    reset();
+    ++gateway_.calls_total_;
+    reading_ = true;
+    call_ = new Call(gateway_, shared_from_this(), method, request);
+}
+
+void GrpcWebGateway::Exchange::fail_call(const ::grpc::Status& status) {
+    reset();
+    on_finish(status);
+}
+
+void GrpcWebGateway::Exchange::abort_call() {
+    if (aborted_) return;
+    aborted_ = true;
+    flush_timer_.cancel();
+    if (call_) {
+        call_->cancel();
+        // 有读在途时由其完成 (ok=false) 释放
+        if (!reading_) release_call();
+    }
+    close();
+}
+
+void GrpcWebGateway::Exchange::read_next() {
+    if (!call_ || read_ended_ || reading_) return;
+    reading_ = true;
+    call_->read_next();
+}
+
+void GrpcWebGateway::Exchange::release_call() {
+    if (!call_) return;
+    auto* call = call_;
+    call_ = nullptr;
+    call->release();
+}
+
+void GrpcWebGateway::Exchange::on_message(Frame frame) {
+    reading_ = false;
+    if (aborted_) {
+        release_call();
+        return;
+    }
+    pending_bytes_ += frame.size;
+    pending_.push_back(std::move(frame));
+    ++gateway_.messages_;
+    if (pending_bytes_ < 2 * gateway_.options_.max_coalesce_bytes) {
+        read_next();
+    } else {
+        ++gateway_.read_pauses_;
+    }
+    schedule_flush();
+}
+
+void GrpcWebGateway::Exchange::on_read_end() {
+    reading_ = false;
+    read_ended_ = true;
+    release_call();
+}
+
+void GrpcWebGateway::Exchange::on_finish(const ::grpc::Status& status) {
+    if (aborted_) return;
+    auto trailer = Frame::trailer(status);
+    pending_bytes_ += trailer.size;
+    pending_.push_back(std::move(trailer));
+    finished_ = true;
+    schedule_flush();
+}
+
+void GrpcWebGateway::Exchange::schedule_flush() {
+    if (writing_ || pending_.empty() || aborted_) return;
+    const auto interval = gateway_.options_.flush_interval;
+    if (finished_ || interval.count() <= 0 || pending_bytes_ >= gateway_.options_.max_coalesce_bytes) {
+        flush();
+        return;
+    }
+    if (timer_armed_) return;
+    timer_armed_ = true;
+    flush_timer_.expires_after(interval);
+    flush_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+        self->timer_armed_ = false;
+        if (!ec) self->flush();
+    });
+}
+
+void GrpcWebGateway::Exchange::flush() {
+    if (writing_ || pending_.empty() || aborted_) return;
+    writing_ = true;
+    writing_frames_.swap(pending_);
+    pending_bytes_ = 0;
+    buffers_.clear();
+    for (const auto& frame : writing_frames_) {
+        frame.append_buffers(buffers_);
+    }
+    ++gateway_.flushes_;
+    // trailer 是最后入队的帧: finished_ 时本次写出即包含它
+    write_frames(buffers_, finished_);
+}
+
+void GrpcWebGateway::Exchange::on_written(beast::error_code ec, std::size_t bytes, bool last) {
+    writing_ = false;
+    writing_frames_.clear();
+    if (ec) {
+        abort_call();
+        return;
+    }
+    gateway_.bytes_ += bytes;
+    if (last) {
+        on_complete();
+        return;
+    }
+    // 写出追上后恢复读取 (暂停时没有读在途)
+    if (pending_bytes_ < 2 * gateway_.options_.max_coalesce_bytes) {
+        read_next();
+    }
+    schedule_flush();
+}
+
+// ------------------------------------------------------------
+// WebSocket
+// ------------------------------------------------------------
+
+class GrpcWebGateway::WebSocketSession : public Exchange {
+public:
+    WebSocketSession(GrpcWebGateway& gateway, tcp::socket socket)
+        : Exchange(gateway, socket.get_executor()), ws_(std::move(socket)) {}
+
+    void run(http::request<http::string_body> request) {
+        request_ = std::move(request);
+        method_ = method_path(to_view(request_.target()));
+        const bool grpc_protocol =
+            request_[http::field::sec_websocket_protocol].find("grpc-web") != beast::string_view::npos;
+
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.set_option(websocket::stream_base::decorator([grpc_protocol](websocket::response_type& response) {
+            response.set(http::field::server, "enose-control");
+            if (grpc_protocol) response.set(http::field::sec_websocket_protocol, "grpc-web");
+        }));
+        ws_.read_message_max(gateway_.options_.max_request_bytes);
+        ws_.binary(true);
+        ws_.async_accept(request_, [self = shared()](beast::error_code ec) {
+            if (ec) {
+                self->close();
+                return;
+            }
+            self->do_read();
+        });
+    }
+
+    void close() override {
+        beast::error_code ignored;
+        beast::get_lowest_layer(ws_).socket().close(ignored);
+    }
+
+protected:
+    void write_frames(const std::vector<net::const_buffer>& buffers, bool last) override {
+        ws_.async_write(buffers, [self = shared(), last](beast::error_code ec, std::size_t bytes) {
+            self->on_written(ec, bytes, last);
+        });
+    }
+
+    void on_complete() override {
+        completed_ = true;
+        ws_.async_close(websocket::close_code::normal, [self = shared()](beast::error_code) {});
+    }
+
+private:
+    std::shared_ptr<WebSocketSession> shared() {
+        return std::static_pointer_cast<WebSocketSession>(shared_from_this());
+    }
+
+    void do_read() {
+        ws_.async_read(in_, [self = shared()](beast::error_code ec, std::size_t) {
+            self->on_read(ec);
+        });
+    }
+
+    void on_read(beast::error_code ec) {
+        if (ec) {
+            // 客户端关闭连接; 正常结束后的关闭握手也会到这里
+            if (!completed_) abort_call();
+            return;
+        }
+        if (!started_) {
+            started_ = true;
+            const auto body = beast::buffers_to_string(in_.data());
+            std::string_view message;
+            ::grpc::Status error;
+            if (method_.empty()) {
+                fail_call(::grpc::Status(::grpc::StatusCode::INVALID_ARGUMENT,
+                                         "expected /<package.Service>/<Method>"));
+            } else if (!parse_request_frame(body, message, error)) {
+                fail_call(error);
+            } else {
+                begin_call(method_, message);
+            }
+        }
+        // 只支持单请求, 之后的消息忽略
+        in_.consume(in_.size());
+        do_read();
+    }
+
+    websocket::stream<beast::tcp_stream> ws_;
+    http::request<http::string_body> request_;
+    beast::flat_buffer in_;
+    std::string method_;
+    bool started_ = false;
+    bool completed_ = false;
+};
+
+// ------------------------------------------------------------
+// HTTP/1.1 (grpc-web over chunked responses)
+// ------------------------------------------------------------
+
+class GrpcWebGateway::HttpSession : public Exchange {
+public:
+    HttpSession(GrpcWebGateway& gateway, tcp::socket socket)
+        : Exchange(gateway, socket.get_executor()), stream_(std::move(socket)) {}
+
+    void start() { do_read(); }
+
+    void close() override {
+        beast::error_code ignored;
+        stream_.socket().shutdown(tcp::socket::shutdown_both, ignored);
+        stream_.socket().close(ignored);
+    }
+
+protected:
+    void write_frames(const std::vector<net::const_buffer>& buffers, bool last) override {
+        auto handler = [self = shared(), last](beast::error_code ec, std::size_t bytes) {
+            self->on_written(ec, bytes, last);
+        };
+        stream_.expires_after(WRITE_TIMEOUT);
+        if (last) {
+            net::async_write(stream_, beast::buffers_cat(http::make_chunk(buffers), http::make_chunk_last()),
+                             std::move(handler));
+        } else {
+            net::async_write(stream_, http::make_chunk(buffers), std::move(handler));
+        }
+    }
+
+    void on_complete() override {
+        serializer_.reset();
+        if (keep_alive_) {
+            do_read();
+        } else {
+            close();
+        }
+    }
+
+private:
+    std::shared_ptr<HttpSession> shared() {
+        return std::static_pointer_cast<HttpSession>(shared_from_this());
+    }
+
+    void do_read() {
+        parser_.emplace();
+        parser_->body_limit(gateway_.options_.max_request_bytes);
+        stream_.expires_after(IDLE_TIMEOUT);
+        http::async_read(stream_, buffer_, *parser_, [self = shared()](beast::error_code ec, std::size_t) {
+            self->on_read(ec);
+        });
+    }
+
+    void on_read(beast::error_code ec) {
+        if (ec == http::error::body_limit) {
+            keep_alive_ = false;
+            respond(http::status::payload_too_large, "Request too large\n");
+            return;
+        }
+        if (ec) {
+            // 对端关闭 / 空闲超时
+            close();
+            return;
+        }
+        stream_.expires_never();
+        auto& request = parser_->get();
+
+        if (websocket::is_upgrade(request)) {
+            auto session = std::make_shared<WebSocketSession>(gateway_, stream_.release_socket());
+            gateway_.track(session);
+            session->run(parser_->release());
+            return;
+        }
+
+        keep_alive_ = request.keep_alive();
+        if (request.method() == http::verb::options) {
+            respond(http::status::no_content, {}, true);
+            return;
+        }
+        if (request.method() != http::verb::post) {
+            respond(http::status::method_not_allowed, "Use POST (grpc-web) or a WebSocket upgrade\n");
+            return;
+        }
+        if (!is_grpc_web(to_view(request[http::field::content_type]))) {
+            respond(http::status::unsupported_media_type, "Expected application/grpc-web+proto\n");
+            return;
+        }
+        auto method = method_path(to_view(request.target()));
+        if (method.empty()) {
+            respond(http::status::not_found, "Expected /<package.Service>/<Method>\n");
+            return;
+        }
+
+        // 请求体留在 parser_ 中, 直到下一次 do_read
+        std::string_view message;
+        ::grpc::Status error;
+        const bool parsed = parse_request_frame(request.body(), message, error);
+
+        header_ = {};
+        header_.version(request.version());
+        header_.result(http::status::ok);
+        header_.keep_alive(keep_alive_);
+        header_.set(http::field::server, "enose-control");
+        header_.set(http::field::content_type, CONTENT_TYPE);
+        set_cors(header_, gateway_.options_.allow_origin, false);
+        header_.chunked(true);
+        serializer_.emplace(header_);
+        stream_.expires_after(WRITE_TIMEOUT);
+        http::async_write_header(stream_, *serializer_,
+            [self = shared(), method = std::move(method), message, parsed, error](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    self->close();
+                    return;
+                }
+                self->watch_disconnect();
+                if (parsed) {
+                    self->begin_call(method, message);
+                } else {
+                    self->fail_call(error);
+                }
+            });
+    }
+
+    void respond(http::status status, std::string body, bool preflight = false) {
+        auto response = std::make_shared<http::response<http::string_body>>(status, parser_->get().version());
+        response->set(http::field::server, "enose-control");
+        response->keep_alive(keep_alive_);
+        set_cors(*response, gateway_.options_.allow_origin, preflight);
+        if (!body.empty()) {
+            response->set(http::field::content_type, "text/plain");
+            response->body() = std::move(body);
+        }
+        response->prepare_payload();
+        stream_.expires_after(WRITE_TIMEOUT);
+        http::async_write(stream_, *response, [self = shared(), response](beast::error_code ec, std::size_t) {
+            if (ec || !response->keep_alive()) {
+                self->close();
+                return;
+            }
+            self->do_read();
+        });
+    }
+
+    /**
+     * @brief 流式响应期间检测客户端断开 (长时间无消息的流否则要到下一次写才发现)
+     *
+     * 可读且无数据即对端已关闭; 有数据 (下一个请求) 时不处理, 调用结束后正常读取
+     */
+    void watch_disconnect() {
+        const uint64_t generation = ++generation_;
+        stream_.socket().async_wait(tcp::socket::wait_read,
+            [self = shared(), generation](beast::error_code ec) {
+                if (ec || generation != self->generation_ || self->serializer_ == std::nullopt) return;
+                beast::error_code available_ec;
+                if (self->stream_.socket().available(available_ec) == 0) {
+                    self->abort_call();
+                }
+            });
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    std::optional<http::request_parser<http::string_body>> parser_;
+    http::response<http::empty_body> header_;
+    std::optional<http::response_serializer<http::empty_body>> serializer_;    // 流式响应进行中
+    bool keep_alive_ = false;
+    uint64_t generation_ = 0;
+};
+
+// ------------------------------------------------------------
+// GrpcWebGateway
+// ------------------------------------------------------------
+
+GrpcWebGateway::GrpcWebGateway(std::shared_ptr<::grpc::Channel> channel, Options options)
+    : options_(std::move(options))
+    , channel_(std::move(channel))
+    , stub_(channel_)
+    , port_(options_.port)
+    , acceptor_(io_) {}
+
+GrpcWebGateway::~GrpcWebGateway() {
+    stop();
+}
+
+::grpc::ChannelArguments GrpcWebGateway::make_channel_arguments() {
+    ::grpc::ChannelArguments args;
+    args.SetInt(GRPC_COMPRESSION_CHANNEL_ENABLED_ALGORITHMS_BITSET, 1 << GRPC_COMPRESS_NONE);
+    return args;
+}
+
+void GrpcWebGateway::start() {
+    if (thread_.joinable()) return;
+
+    tcp::endpoint endpoint(net::ip::make_address(options_.host), port_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(net::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    port_ = acceptor_.local_endpoint().port();
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        stopping_ = false;
+    }
+    do_accept();
+
+    metrics_registration_ = core::MetricsRegistry::instance().add_collector(
+        [this](core::MetricWriter& writer) { collect_metrics(writer); });
+
+    io_.restart();
+    work_.emplace(io_.get_executor());
+    thread_ = std::thread([this] {
+        try {
+            io_.run();
+        } catch (const std::exception& e) {
+            spdlog::error("GrpcWebGateway: io thread terminated: {}", e.what());
+        }
+    });
+    spdlog::info("GrpcWebGateway: Serving grpc-web on http://{}:{} (flush {} ms / {} bytes)",
+                 options_.host, port_, options_.flush_interval.count(), options_.max_coalesce_bytes);
+}
+
+void GrpcWebGateway::stop() {
+    if (!thread_.joinable()) return;
+
+    std::vector<std::shared_ptr<::grpc::ClientContext>> calls;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        stopping_ = true;
+        calls = calls_;
+    }
+    for (auto& context : calls) {
+        context->TryCancel();
+    }
+    // 关闭监听和所有连接: 写在途 (含暂停读取) 的调用随写失败放弃, 解除 hold
+    net::post(io_, [this] {
+        beast::error_code ignored;
+        acceptor_.close(ignored);
+        for (auto& weak : sessions_) {
+            if (auto session = weak.lock()) session->close();
+        }
+        sessions_.clear();
+    });
+    {
+        std::unique_lock<std::mutex> lock(calls_mutex_);
+        if (!calls_cv_.wait_for(lock, STOP_TIMEOUT, [this] { return calls_.empty(); })) {
+            spdlog::warn("GrpcWebGateway: {} calls still active at shutdown", calls_.size());
+        }
+    }
+
+    metrics_registration_.reset();
+    work_.reset();
+    io_.stop();
+    thread_.join();
+}
+
+GrpcWebGateway::Stats GrpcWebGateway::stats() const {
+    Stats s;
+    s.calls = calls_total_;
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        s.active_calls = calls_.size();
+    }
+    s.messages = messages_;
+    s.flushes = flushes_;
+    s.bytes = bytes_;
+    s.read_pauses = read_pauses_;
+    return s;
+}
+
+void GrpcWebGateway::do_accept() {
+    acceptor_.async_accept(net::make_strand(io_), [this](beast::error_code ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != net::error::operation_aborted) {
+                spdlog::warn("GrpcWebGateway: Accept failed: {}", ec.message());
+                do_accept();
+            }
+            return;
+        }
+        socket.set_option(tcp::no_delay(true), ec);
+        auto session = std::make_shared<HttpSession>(*this, std::move(socket));
+        track(session);
+        session->start();
+        do_accept();
+    });
+}
+
+void GrpcWebGateway::track(const std::shared_ptr<Exchange>& session) {
+    std::erase_if(sessions_, [](const std::weak_ptr<Exchange>& weak) { return weak.expired(); });
+    sessions_.push_back(session);
+}
+
+bool GrpcWebGateway::register_call(const std::shared_ptr<::grpc::ClientContext>& context) {
+    std::lock_guard<std::mutex> lock(calls_mutex_);
+    calls_.push_back(context);
+    return !stopping_;
+}
+
+void GrpcWebGateway::unregister_call(const ::grpc::ClientContext* context) {
+    {
+        std::lock_guard<std::mutex> lock(calls_mutex_);
+        std::erase_if(calls_, [context](const auto& c) { return c.get() == context; });
+    }
+    calls_cv_.notify_all();
+}
+
+void GrpcWebGateway::collect_metrics(core::MetricWriter& writer) const {
+    const auto s = stats();
+    writer.counter("grpc_web_calls_total", "Calls forwarded by the grpc-web gateway",
+                   static_cast<double>(s.calls));
+    writer.gauge("grpc_web_active_calls", "Calls in progress through the grpc-web gateway",
+                 static_cast<double>(s.active_calls));
+    writer.counter("grpc_web_messages_total", "Messages written to grpc-web clients",
+                   static_cast<double>(s.messages));
+    writer.counter("grpc_web_flushes_total", "Coalesced writes to grpc-web clients",
+                   static_cast<double>(s.flushes));
+    writer.counter("grpc_web_bytes_total", "Bytes written to grpc-web clients",
+                   static_cast<double>(s.bytes));
+    writer.counter("grpc_web_read_pauses_total", "Stream reads paused behind a slow grpc-web client",
+                   static_cast<double>(s.read_pauses));
+}
+
+} // namespace enose_grpc
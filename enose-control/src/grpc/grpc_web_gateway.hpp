@@ -0,0 +1,128 @@
+#pragma once
+
+#include "core/metrics.hpp"
+#include <boost/asio.hpp>
+#include <grpcpp/generic/generic_stub.h>
+#include <grpcpp/grpcpp.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace enose_grpc {
+
+/**
+ * @brief 内置 grpc-web 网关: UI 以 HTTP/1.1 或 WebSocket 直接调用本进程的 gRPC 服务
+ *
+ * 路径 /<package.Service>/<Method> 的请求经进程内通道 (Server::InProcessChannel) 以通用调用
+ * 转发 (ByteBuffer, 不解析消息), 不经过外部代理进程和 TCP 回环.
+ *
+ * 帧格式同 grpc-web 二进制模式: 1 字节标志 + 4 字节大端长度 + 消息; 标志 0x80 的帧为
+ * trailer ("grpc-status:N\r\ngrpc-message:...\r\n"), 调用结果只在 trailer 中给出.
+ * - HTTP: POST, Content-Type application/grpc-web 或 application/grpc-web+proto,
+ *   请求体为一个消息帧; 响应以 chunked 编码流式返回, 支持 keep-alive 与 CORS 预检.
+ * - WebSocket: 同一路径 GET Upgrade; 客户端的第一条二进制消息为请求帧 (之后的消息忽略),
+ *   服务端每条二进制消息含一个或多个帧, 写出 trailer 后关闭.
+ * 只支持单请求的调用 (一元与服务端流), 不支持 grpc-web-text (base64) 和压缩帧.
+ *
+ * 合并写出: 流上的消息先追加到待写列表, 待写字节达到 max_coalesce_bytes 或首条等待满
+ * flush_interval 时一次写出 (一个 chunk / 一条 WebSocket 消息); flush_interval 为 0 时逐条写出.
+ * 待写超过 2 × max_coalesce_bytes 时暂停从 gRPC 读取, 积压留在服务端流的有界队列中
+ * (按其溢出策略丢弃), 慢客户端不会让网关无限缓存.
+ *
+ * 在独立线程和 io_context 上运行, 同 MetricsServer.
+ */
+class GrpcWebGateway {
+public:
+    struct Options {
+        std::string host = "0.0.0.0";
+        uint16_t port = 8080;
+        std::chrono::milliseconds flush_interval{20};
+        std::size_t max_coalesce_bytes = 64 * 1024;
+        std::size_t max_request_bytes = 4 * 1024 * 1024;
+        std::string allow_origin;               // CORS Access-Control-Allow-Origin, 空则不发送 (仅同源)
+    };
+
+    struct Stats {
+        uint64_t calls = 0;             // 已转发的调用
+        uint64_t active_calls = 0;
+        uint64_t messages = 0;          // 写往客户端的消息帧 (不含 trailer)
+        uint64_t flushes = 0;           // 写出次数; messages / flushes 即平均合并条数
+        uint64_t bytes = 0;
+        uint64_t read_pauses = 0;       // 写出落后而暂停读取的次数
+    };
+
+    /**
+     * @param channel 通常为 Server::InProcessChannel(), 须关闭压缩 (见 make_channel_arguments)
+     */
+    GrpcWebGateway(std::shared_ptr<::grpc::Channel> channel, Options options);
+    ~GrpcWebGateway();
+
+    GrpcWebGateway(const GrpcWebGateway&) = delete;
+    GrpcWebGateway& operator=(const GrpcWebGateway&) = delete;
+
+    /**
+     * @brief 进程内通道的参数: 只通告 identity, 服务端流不会为网关压缩后再解压
+     */
+    static ::grpc::ChannelArguments make_channel_arguments();
+
+    /** @brief 绑定并开始接受连接; 失败时抛出异常 */
+    void start();
+
+    /** @brief 停止接受连接, 取消进行中的调用并等待其结束 (须在 gRPC Server::Shutdown 之前) */
+    void stop();
+
+    /** @brief 实际监听端口 (配置为 0 时由系统分配) */
+    uint16_t port() const { return port_; }
+
+    Stats stats() const;
+
+private:
+    struct Frame;
+    class Call;
+    class Exchange;
+    class HttpSession;
+    class WebSocketSession;
+
+    static constexpr auto STOP_TIMEOUT = std::chrono::seconds(5);
+
+    void do_accept();
+    /** @brief io 线程: 记录连接, stop() 时逐个关闭 */
+    void track(const std::shared_ptr<Exchange>& session);
+    /** @brief 网关停止中返回 false, 调用应立即取消 */
+    bool register_call(const std::shared_ptr<::grpc::ClientContext>& context);
+    void unregister_call(const ::grpc::ClientContext* context);
+    void collect_metrics(core::MetricWriter& writer) const;
+
+    Options options_;
+    std::shared_ptr<::grpc::Channel> channel_;
+    ::grpc::GenericStub stub_;
+    uint16_t port_;
+
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::thread thread_;
+    std::vector<std::weak_ptr<Exchange>> sessions_;    // 只在 io 线程访问
+
+    mutable std::mutex calls_mutex_;
+    std::condition_variable calls_cv_;
+    std::vector<std::shared_ptr<::grpc::ClientContext>> calls_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> calls_total_{0};
+    std::atomic<uint64_t> messages_{0};
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> read_pauses_{0};
+    core::MetricsRegistry::Registration metrics_registration_;
+};
+
+} // namespace enose_grpc
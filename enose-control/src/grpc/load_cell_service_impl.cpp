@@ -1,7 +1,7 @@
 #include "grpc/load_cell_service_impl.hpp"
 #include "hal/load_cell_driver.hpp"
+#include <google/protobuf/util/time_util.h>
 #include <spdlog/spdlog.h>
-#include <thread>
 #include <chrono>
 
 namespace enose_grpc {
@@ -9,16 +9,35 @@ namespace enose_grpc {
 LoadCellServiceImpl::LoadCellServiceImpl(std::shared_ptr<hal::LoadCellDriver> load_cell)
     : load_cell_(std::move(load_cell))
 {
+    // 每次称重轮询更新后推送给流订阅者
+    status_connection_ = load_cell_->on_status_update.connect(
+        [this](const hal::LoadCellStatus& status) {
+            if (readings_hub_.empty() && decimated_hubs_.empty()) return;
+            ::enose::service::LoadCellReading reading;
+            fill_reading(status, &reading);
+            readings_hub_.publish(reading);
+            decimated_hubs_.publish(std::span<const ::enose::service::LoadCellReading>(&reading, 1));
+        });
     spdlog::info("LoadCellServiceImpl: Initialized");
 }
 
+LoadCellServiceImpl::~LoadCellServiceImpl() {
+    status_connection_.disconnect();
+    readings_hub_.close_all();
+    decimated_hubs_.close_all();
+}
+
 void LoadCellServiceImpl::fill_reading(::enose::service::LoadCellReading* reading) {
-    auto status = load_cell_->get_status();
-    
+    fill_reading(load_cell_->get_status(), reading);
+}
+
+void LoadCellServiceImpl::fill_reading(const hal::LoadCellStatus& status,
+                                       ::enose::service::LoadCellReading* reading) {
     reading->set_weight_grams(status.filtered_weight);
     reading->set_raw_percent(status.raw_percent);
     reading->set_is_calibrated(status.is_calibrated);
     reading->set_is_stable(status.is_stable);
+    *reading->mutable_timestamp() = google::protobuf::util::TimeUtil::GetCurrentTime();
     
     switch (status.trend) {
         case hal::WeightTrend::STABLE:
@@ -130,8 +149,8 @@ void LoadCellServiceImpl::fill_calibration_status(::enose::service::CalibrationS
 
 // === 业务配置 ===
 
-::grpc::Status LoadCellServiceImpl::WaitForEmptyBottle(
-    ::grpc::ServerContext* context,
+::grpc::ServerUnaryReactor* LoadCellServiceImpl::WaitForEmptyBottle(
+    ::grpc::CallbackServerContext* context,
     const ::enose::service::WaitForEmptyBottleRequest* request,
     ::enose::service::WaitForEmptyBottleResponse* response
 ) {
@@ -142,13 +161,15 @@ void LoadCellServiceImpl::fill_calibration_status(::enose::service::CalibrationS
     spdlog::info("LoadCellServiceImpl: WaitForEmptyBottle (tol={:.1f}g, timeout={:.1f}s, window={:.1f}s)",
                  tolerance, timeout_sec, stability_window_sec);
     
-    auto result = load_cell_->wait_for_empty_bottle(tolerance, timeout_sec, stability_window_sec);
-    
-    response->set_success(result.success);
-    response->set_empty_weight(result.empty_weight);
-    response->set_error_message(result.error_message);
-    
-    return ::grpc::Status::OK;
+    auto* reactor = context->DefaultReactor();
+    load_cell_->async_wait_for_empty_bottle(tolerance, timeout_sec, stability_window_sec,
+        [reactor, response](const hal::LoadCellDriver::WaitForEmptyResult& result) {
+            response->set_success(result.success);
+            response->set_empty_weight(result.empty_weight);
+            response->set_error_message(result.error_message);
+            reactor->Finish(::grpc::Status::OK);
+        });
+    return reactor;
 }
 
 ::grpc::Status LoadCellServiceImpl::ResetDynamicEmptyWeight(
@@ -277,26 +298,35 @@ void LoadCellServiceImpl::fill_calibration_status(::enose::service::CalibrationS
     return ::grpc::Status::OK;
 }
 
-::grpc::Status LoadCellServiceImpl::StreamReadings(
-    ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
-    ::grpc::ServerWriter<::enose::service::LoadCellReading>* writer
+void LoadCellServiceImpl::collect_metrics(core::MetricWriter& writer) const {
+    auto subscribers = readings_hub_.stats();
+    auto decimated = decimated_hubs_.stats();
+    subscribers.insert(subscribers.end(), decimated.begin(), decimated.end());
+    write_subscriber_metrics(writer, "LoadCellService.StreamReadings", subscribers);
+}
+
+::grpc::ServerWriteReactor<::enose::service::LoadCellReading>* LoadCellServiceImpl::StreamReadings(
+    ::grpc::CallbackServerContext* context,
+    const ::enose::service::StreamLoadCellReadingsRequest* request
 ) {
-    spdlog::info("LoadCellServiceImpl: StreamReadings started");
+    apply_stream_compression(context);
+    // 先推一次当前值, 不必等下一次轮询
+    ::enose::service::LoadCellReading reading;
+    fill_reading(&reading);
     
-    while (!context->IsCancelled()) {
-        ::enose::service::LoadCellReading reading;
-        fill_reading(&reading);
-        
-        if (!writer->Write(reading)) {
-            break;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    DecimationConfig config;
+    config.bucket_ms = DecimationConfig::bucket_for_rate(request->decimation().target_rate_hz());
+    config.envelope = request->decimation().envelope();
+    config.normalize();
+    if (config.passthrough()) {
+        return new HubWriteReactor<::enose::service::LoadCellReading>(
+            readings_hub_, context->peer(), "LoadCellService.StreamReadings", std::move(reading));
     }
     
-    spdlog::info("LoadCellServiceImpl: StreamReadings ended");
-    return ::grpc::Status::OK;
+    auto entry = decimated_hubs_.acquire(config);
+    auto& hub = entry->hub;
+    return new HubWriteReactor<::enose::service::LoadCellReading>(
+        hub, context->peer(), "LoadCellService.StreamReadings", std::move(reading), std::move(entry));
 }
 
 } // namespace enose_grpc
@@ -1,15 +1,37 @@
 #pragma once
 
 #include <grpcpp/grpcpp.h>
+#include <boost/signals2/connection.hpp>
 #include <memory>
 #include "enose_service.grpc.pb.h"
+#include "grpc/broadcast_hub.hpp"
+#include "grpc/stream_decimation.hpp"
+#include "grpc/stream_reactors.hpp"
 
 namespace hal {
 class LoadCellDriver;
+struct LoadCellStatus;
 }
 
 namespace enose_grpc {
 
+/**
+ * @brief LoadCellReading 的抽稀定义: 单通道, 按读数时间戳分桶
+ */
+struct LoadCellReadingDecimation {
+    static uint64_t channel(const ::enose::service::LoadCellReading&) { return 0; }
+    static uint64_t tick_ms(const ::enose::service::LoadCellReading& r) {
+        return static_cast<uint64_t>(r.timestamp().seconds()) * 1000 + r.timestamp().nanos() / 1000000;
+    }
+    static double value(const ::enose::service::LoadCellReading& r) { return r.weight_grams(); }
+    static bool accepts(const DecimationConfig&, const ::enose::service::LoadCellReading&) { return true; }
+    static void set_envelope(::enose::service::LoadCellReading& r, double min, double max, uint32_t count) {
+        r.set_min_weight_grams(static_cast<float>(min));
+        r.set_max_weight_grams(static_cast<float>(max));
+        r.set_sample_count(count);
+    }
+};
+
 /**
  * @brief gRPC LoadCellService 实现
  * 
@@ -17,10 +39,17 @@ namespace enose_grpc {
  * - 标定向导 (零点、参考重量、保存)
  * - 业务配置 (空瓶基准、溢出阈值)
  * - 实时读数和去皮
+ *
+ * StreamReadings 走 callback API, 由驱动的 on_status_update 推送;
+ * WaitForEmptyBottle 同样走 callback API, 等待期间不占用 gRPC 线程
  */
-class LoadCellServiceImpl final : public enose::service::LoadCellService::Service {
+class LoadCellServiceImpl final
+    : public enose::service::LoadCellService::WithCallbackMethod_StreamReadings<
+          enose::service::LoadCellService::WithCallbackMethod_WaitForEmptyBottle<
+              enose::service::LoadCellService::Service>> {
 public:
     explicit LoadCellServiceImpl(std::shared_ptr<hal::LoadCellDriver> load_cell);
+    ~LoadCellServiceImpl();
 
     // === 标定相关 ===
     ::grpc::Status StartCalibration(
@@ -54,8 +83,8 @@ public:
     ) override;
 
     // === 业务配置 ===
-    ::grpc::Status WaitForEmptyBottle(
-        ::grpc::ServerContext* context,
+    ::grpc::ServerUnaryReactor* WaitForEmptyBottle(
+        ::grpc::CallbackServerContext* context,
         const ::enose::service::WaitForEmptyBottleRequest* request,
         ::enose::service::WaitForEmptyBottleResponse* response
     ) override;
@@ -109,17 +138,27 @@ public:
         ::enose::service::LoadCellReading* response
     ) override;
 
-    ::grpc::Status StreamReadings(
-        ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
-        ::grpc::ServerWriter<::enose::service::LoadCellReading>* writer
+    ::grpc::ServerWriteReactor<::enose::service::LoadCellReading>* StreamReadings(
+        ::grpc::CallbackServerContext* context,
+        const ::enose::service::StreamLoadCellReadingsRequest* request
     ) override;
 
+    /** @brief 导出流订阅者的积压和丢弃 (抓取线程调用) */
+    void collect_metrics(core::MetricWriter& writer) const;
+
 private:
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
     
+    // 读数流订阅者
+    BroadcastHub<::enose::service::LoadCellReading> readings_hub_{64};
+    DecimatedHubSet<::enose::service::LoadCellReading, LoadCellReadingDecimation> decimated_hubs_{
+        64, OverflowPolicy::DROP_OLDEST};
+    boost::signals2::connection status_connection_;
+    
     // 填充 LoadCellReading proto
     void fill_reading(::enose::service::LoadCellReading* reading);
+    static void fill_reading(const hal::LoadCellStatus& status,
+                             ::enose::service::LoadCellReading* reading);
     
     // 填充 CalibrationStatus proto
     void fill_calibration_status(::enose::service::CalibrationStatus* status);
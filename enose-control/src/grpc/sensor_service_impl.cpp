@@ -4,73 +4,141 @@
 
 namespace enose_grpc {
 
-SensorServiceImpl::SensorServiceImpl(std::shared_ptr<hal::SensorDriver> sensor)
-    : sensor_(std::move(sensor)) {
+SensorServiceImpl::SensorServiceImpl(std::shared_ptr<hal::SensorDriver> sensor,
+                                     std::size_t stream_queue_size,
+                                     OverflowPolicy overflow,
+                                     std::shared_ptr<hal::SensorBoardGroup> boards)
+    : sensor_(std::move(sensor))
+    , group_(std::move(boards))
+    , readings_hub_(stream_queue_size, overflow)
+    , decimated_hubs_(stream_queue_size, overflow) {
     
+    readings_hub_.set_latency_stage(core::LatencyStage::GRPC_WRITE_READINGS);
+    decimated_hubs_.set_latency_stage(core::LatencyStage::GRPC_WRITE_READINGS);
+
+    if (group_) {
+        for (const auto& b : group_->boards()) {
+            auto board = std::make_unique<Board>();
+            board->device_id = b.device_id;
+            board->sensor = b.driver;
+            boards_.push_back(std::move(board));
+        }
+    } else {
+        auto board = std::make_unique<Board>();
+        board->device_id = sensor_->device_id();
+        board->sensor = sensor_;
+        boards_.push_back(std::move(board));
+    }
+
     // 连接传感器数据包回调
-    packet_connection_ = sensor_->on_packet.connect(
-        [this](const nlohmann::json& packet) {
-            on_sensor_packet(packet);
+    for (auto& board : boards_) {
+        board->packet_connection = board->sensor->on_packet.connect(
+            [this, b = board.get()](const nlohmann::json& packet) {
+                on_sensor_packet(*b, packet);
+            }
+        );
+        // 串口断开后不会再有样本结束未满的桶, 立即输出 (其他板的未满桶也随之提前输出)
+        board->link_connection = board->sensor->on_connection_changed.connect(
+            [this](bool connected) {
+                if (!connected) decimated_hubs_.flush();
+            }
+        );
+    }
+    auto& readings = group_ ? group_->merger().on_readings : sensor_->on_readings;
+    readings_connection_ = readings.connect(
+        [this](std::span<const hal::SensorSample> samples) {
+            on_sensor_readings(samples);
         }
     );
-    
-    connected_ = true;
 }
 
 SensorServiceImpl::~SensorServiceImpl() {
-    packet_connection_.disconnect();
+    for (auto& board : boards_) {
+        board->packet_connection.disconnect();
+        board->link_connection.disconnect();
+    }
+    readings_connection_.disconnect();
+    readings_hub_.close_all();
+    decimated_hubs_.close_all();
 }
 
-void SensorServiceImpl::on_sensor_packet(const nlohmann::json& packet) {
-    std::string msg_type = packet.value("type", "");
+SensorServiceImpl::Board* SensorServiceImpl::find_board(const std::string& device_id) {
+    if (device_id.empty()) return boards_.front().get();
+    for (auto& board : boards_) {
+        if (board->device_id == device_id) return board.get();
+    }
+    return nullptr;
+}
+
+void SensorServiceImpl::fill_reading(const hal::SensorSample& sample, ::enose::service::SensorReading* reading) {
+    reading->set_tick_ms(sample.device_ms != 0 ? sample.device_ms : sample.tick_ms);
+    reading->set_host_time_us(sample.host_time_us);
+    reading->set_sensor_idx(sample.sensor_idx);
+    reading->set_sensor_id(sample.sensor_id);
+    reading->set_value(sample.value);
+    reading->set_sensor_type(sample.type_name());
+    reading->set_heater_step(sample.heater_step);
+    reading->set_adc_channel(sample.adc_channel);
     
-    if (msg_type == "data") {
-        // 传感器数据 - 转发给所有订阅者
-        ::enose::service::SensorReading reading;
-        reading.set_tick_ms(packet.value("tick", 0ULL));
-        reading.set_sensor_idx(packet.value("s", 0U));
-        reading.set_sensor_id(packet.value("id", 0U));
-        reading.set_value(packet.value("v", packet.value("R", 0.0)));
-        reading.set_sensor_type(packet.value("st", "mox_d"));
-        reading.set_heater_step(packet.value("gi", 0U));
-        reading.set_adc_channel(packet.value("ch", 0U));
-        
-        if (packet.contains("T")) {
-            reading.set_temperature(packet["T"].get<double>());
-        }
-        if (packet.contains("H")) {
-            reading.set_humidity(packet["H"].get<double>());
-        }
-        if (packet.contains("P")) {
-            reading.set_pressure(packet["P"].get<double>());
-        }
-        
-        // 广播给所有订阅者
-        std::lock_guard<std::mutex> lock(subscribers_mutex_);
-        for (auto it = subscribers_.begin(); it != subscribers_.end(); ) {
-            if (!(*it)->Write(reading)) {
-                it = subscribers_.erase(it);
-            } else {
-                ++it;
-            }
+    if (sample.has_temperature()) {
+        reading->set_temperature(sample.temperature);
+    }
+    if (sample.has_humidity()) {
+        reading->set_humidity(sample.humidity);
+    }
+    if (sample.has_pressure()) {
+        reading->set_pressure(sample.pressure);
+    }
+}
+
+void SensorServiceImpl::on_sensor_readings(std::span<const hal::SensorSample> samples) {
+    // 运行在驱动 (多板时为合并器) 的 strand 上: 整帧 (可能是批量帧) 入队后立即返回, 不等待网络写
+    if (samples.empty() || (readings_hub_.empty() && decimated_hubs_.empty())) return;
+    
+    // 单板时不填 device_id, 热路径上省去字符串拷贝
+    const bool multi_board = boards_.size() > 1;
+    // 复用上一帧的消息: Clear() 保留字符串容量, 稳态下转换不再分配
+    if (readings_scratch_.size() < samples.size()) {
+        readings_scratch_.resize(samples.size());
+    }
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const auto& sample = samples[i];
+        auto& reading = readings_scratch_[i];
+        reading.Clear();
+        fill_reading(sample, &reading);
+        if (multi_board && sample.board < boards_.size()) {
+            reading.set_device_id(boards_[sample.board]->device_id);
         }
     }
-    else if (msg_type == "ready") {
+    const std::span<const ::enose::service::SensorReading> readings(readings_scratch_.data(), samples.size());
+    // 单板时同一次分发的读数来自同一串口数据块, rx_ns 相同; 合并流取最后一条
+    const uint64_t origin_ns = samples.back().rx_ns;
+    readings_hub_.publish(readings, origin_ns);
+    decimated_hubs_.publish(readings, origin_ns);
+    core::LatencyTracer::instance().record_since(core::LatencyStage::FANOUT_READINGS, origin_ns);
+}
+
+void SensorServiceImpl::on_sensor_packet(Board& board, const nlohmann::json& packet) {
+    std::string msg_type = packet.value("type", "");
+    
+    if (msg_type == "ready") {
         // 设备就绪消息
-        firmware_version_ = packet.value("version", "");
-        sensor_count_ = packet.value("sensors", 8U);
-        spdlog::info("SensorService: Device ready, firmware={}, sensors={}", 
-                     firmware_version_, sensor_count_.load());
+        std::string version = packet.value("version", "");
+        board.sensor_count = packet.value("sensors", 8U);
+        spdlog::info("SensorService: Device {} ready, firmware={}, sensors={}", 
+                     board.device_id, version, board.sensor_count.load());
+        std::lock_guard<std::mutex> lock(board.response_mutex);
+        board.firmware_version = std::move(version);
     }
     else if (msg_type == "ack" || msg_type == "error" || msg_type == "status") {
-        // 命令响应 - 放入响应队列
-        std::lock_guard<std::mutex> lock(response_mutex_);
-        response_queue_.push(packet);
-        response_cv_.notify_one();
+        // 命令响应 - 放入该板的响应队列
+        std::lock_guard<std::mutex> lock(board.response_mutex);
+        board.response_queue.push(packet);
+        board.response_cv.notify_one();
     }
 }
 
-nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd, const nlohmann::json& params) {
+nlohmann::json SensorServiceImpl::send_command_and_wait(Board& board, const std::string& cmd, const nlohmann::json& params) {
     int id = ++cmd_id_;
     
     nlohmann::json msg;
@@ -82,22 +150,22 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
     
     // 清空响应队列
     {
-        std::lock_guard<std::mutex> lock(response_mutex_);
-        while (!response_queue_.empty()) {
-            response_queue_.pop();
+        std::lock_guard<std::mutex> lock(board.response_mutex);
+        while (!board.response_queue.empty()) {
+            board.response_queue.pop();
         }
     }
     
     // 发送命令
-    sensor_->write(msg);
+    board.sensor->write(msg);
     
     // 等待响应 (3秒超时)
-    std::unique_lock<std::mutex> lock(response_mutex_);
-    if (response_cv_.wait_for(lock, std::chrono::seconds(3), [this]() {
-        return !response_queue_.empty();
+    std::unique_lock<std::mutex> lock(board.response_mutex);
+    if (board.response_cv.wait_for(lock, std::chrono::seconds(3), [&board]() {
+        return !board.response_queue.empty();
     })) {
-        nlohmann::json response = response_queue_.front();
-        response_queue_.pop();
+        nlohmann::json response = board.response_queue.front();
+        board.response_queue.pop();
         return response;
     }
     
@@ -112,13 +180,18 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
 ) {
     spdlog::info("gRPC: SensorService.SendCommand: {}", request->command());
     
+    Board* board = find_board(request->device_id());
+    if (!board) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Unknown sensor board: " + request->device_id());
+    }
+    
     try {
         nlohmann::json params;
         if (request->has_params_json()) {
             params = nlohmann::json::parse(request->params_json());
         }
         
-        nlohmann::json resp = send_command_and_wait(request->command(), params);
+        nlohmann::json resp = send_command_and_wait(*board, request->command(), params);
         
         // 检查是否超时
         if (resp.contains("error") && resp["error"] == "Timeout waiting for response") {
@@ -138,11 +211,11 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
             
             // 更新状态
             if (request->command() == "start") {
-                running_ = true;
+                board->running = true;
             } else if (request->command() == "stop") {
-                running_ = false;
+                board->running = false;
             } else if (request->command() == "init") {
-                sensor_count_ = resp.value("sensors", 8U);
+                board->sensor_count = resp.value("sensors", 8U);
             }
         } else {
             response->set_message(resp.value("error", resp.value("msg", "Command failed")));
@@ -158,35 +231,41 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
     return ::grpc::Status::OK;
 }
 
-::grpc::Status SensorServiceImpl::SubscribeSensorReadings(
-    ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
-    ::grpc::ServerWriter<::enose::service::SensorReading>* writer
+::grpc::ServerWriteReactor<::enose::service::SensorReading>* SensorServiceImpl::SubscribeSensorReadings(
+    ::grpc::CallbackServerContext* context,
+    const ::enose::service::SubscribeSensorReadingsRequest* request
 ) {
-    spdlog::info("gRPC: SensorService.SubscribeSensorReadings - client connected");
-    
-    // 添加到订阅者列表
-    {
-        std::lock_guard<std::mutex> lock(subscribers_mutex_);
-        subscribers_.push_back(writer);
+    apply_stream_compression(context);
+    DecimationConfig config;
+    config.bucket_ms = DecimationConfig::bucket_for_rate(request->decimation().target_rate_hz());
+    config.envelope = request->decimation().envelope();
+    config.sensors.assign(request->sensor_idx().begin(), request->sensor_idx().end());
+    config.heater_steps.assign(request->heater_step().begin(), request->heater_step().end());
+    for (const auto& device_id : request->device_ids()) {
+        if (!find_board(device_id)) {
+            return new FinishedWriteReactor<::enose::service::SensorReading>(
+                ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Unknown sensor board: " + device_id));
+        }
+        config.devices.push_back(device_id);
     }
-    
-    // 等待客户端断开
-    while (!context->IsCancelled()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // 单板时读数不带 device_id, 选中唯一的板即等于不过滤
+    if (boards_.size() == 1) {
+        config.devices.clear();
     }
+    config.normalize();
     
-    // 从订阅者列表移除
-    {
-        std::lock_guard<std::mutex> lock(subscribers_mutex_);
-        subscribers_.erase(
-            std::remove(subscribers_.begin(), subscribers_.end(), writer),
-            subscribers_.end()
-        );
+    if (config.passthrough()) {
+        return new HubWriteReactor<::enose::service::SensorReading>(
+            readings_hub_, context->peer(), "SensorService.SubscribeSensorReadings");
     }
     
-    spdlog::info("gRPC: SensorService.SubscribeSensorReadings - client disconnected");
-    return ::grpc::Status::OK;
+    spdlog::info("gRPC: SensorService.SubscribeSensorReadings - bucket={}ms envelope={} sensors={} steps={} boards={}",
+                 config.bucket_ms, config.envelope, config.sensors.size(), config.heater_steps.size(),
+                 config.devices.size());
+    auto entry = decimated_hubs_.acquire(config);
+    auto& hub = entry->hub;
+    return new HubWriteReactor<::enose::service::SensorReading>(
+        hub, context->peer(), "SensorService.SubscribeSensorReadings", std::nullopt, std::move(entry));
 }
 
 ::grpc::Status SensorServiceImpl::GetSensorStatus(
@@ -196,15 +275,70 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
 ) {
     spdlog::debug("gRPC: SensorService.GetSensorStatus");
     
-    response->set_connected(connected_);
-    response->set_running(running_);
-    response->set_sensor_count(sensor_count_);
-    response->set_firmware_version(firmware_version_);
-    response->set_port(port_);
+    fill_status(*boards_.front(), response);
+    if (group_) {
+        auto merge = group_->merger().stats();
+        response->set_merge_late(merge.late);
+        for (std::size_t i = 0; i < boards_.size(); ++i) {
+            auto* status = response->add_boards();
+            fill_status(*boards_[i], status);
+            if (i < merge.boards.size()) {
+                status->set_last_seq(merge.boards[i].last_seq);
+                status->set_seq_gaps(merge.boards[i].seq_gaps);
+                status->set_merge_queued(merge.boards[i].queued);
+            }
+        }
+        if (!merge.boards.empty()) {
+            response->set_last_seq(merge.boards[0].last_seq);
+            response->set_seq_gaps(merge.boards[0].seq_gaps);
+            response->set_merge_queued(merge.boards[0].queued);
+        }
+    }
+    
+    auto subscribers = readings_hub_.stats();
+    auto decimated = decimated_hubs_.stats();
+    subscribers.insert(subscribers.end(), decimated.begin(), decimated.end());
+    for (const auto& sub : subscribers) {
+        auto* s = response->add_subscribers();
+        s->set_client(sub.client);
+        s->set_queued(static_cast<uint32_t>(sub.queued));
+        s->set_delivered(sub.delivered);
+        s->set_dropped(sub.dropped);
+    }
     
     return ::grpc::Status::OK;
 }
 
+void SensorServiceImpl::fill_status(const Board& board, ::enose::service::SensorBoardStatus* status) const {
+    auto link = board.sensor->stats();
+    status->set_device_id(board.device_id);
+    status->set_connected(link.connected);
+    status->set_running(board.running);
+    status->set_sensor_count(board.sensor_count);
+    {
+        std::lock_guard<std::mutex> lock(board.response_mutex);
+        status->set_firmware_version(board.firmware_version);
+    }
+    status->set_port(link.device);
+    status->set_bytes_received(link.bytes_received);
+    status->set_frames_received(link.frames_received);
+    status->set_parse_errors(link.parse_errors);
+    status->set_reconnects(link.reconnects);
+
+    auto clock = board.sensor->clock_stats();
+    status->set_clock_synced(clock.synced);
+    status->set_clock_skew_ppm(clock.skew_ppm);
+    status->set_clock_residual_us(clock.residual_us);
+    status->set_clock_min_rtt_us(clock.min_rtt_us);
+}
+
+void SensorServiceImpl::collect_metrics(core::MetricWriter& writer) const {
+    auto subscribers = readings_hub_.stats();
+    auto decimated = decimated_hubs_.stats();
+    subscribers.insert(subscribers.end(), decimated.begin(), decimated.end());
+    write_subscriber_metrics(writer, "SensorService.SubscribeSensorReadings", subscribers);
+}
+
 ::grpc::Status SensorServiceImpl::ConfigureHeater(
     ::grpc::ServerContext* context,
     const ::enose::service::HeaterConfigRequest* request,
@@ -212,6 +346,11 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
 ) {
     spdlog::info("gRPC: SensorService.ConfigureHeater");
     
+    Board* board = find_board(request->device_id());
+    if (!board) {
+        return ::grpc::Status(::grpc::StatusCode::NOT_FOUND, "Unknown sensor board: " + request->device_id());
+    }
+    
     try {
         nlohmann::json params;
         
@@ -238,9 +377,21 @@ nlohmann::json SensorServiceImpl::send_command_and_wait(const std::string& cmd,
             params["sensors"] = sensors;
         }
         
-        nlohmann::json resp = send_command_and_wait("config", params);
+        nlohmann::json resp = send_command_and_wait(*board, "config", params);
         
         bool ok = resp.value("ok", false);
+        if (ok && request->temps_size() > 0) {
+            // 固件按 temps 长度设置加热配置, 在各传感器当前周期结束后切换, 周期计数随之更新
+            auto length = static_cast<uint8_t>(request->temps_size());
+            auto& tracker = board->sensor->heater_cycles();
+            if (request->sensors_size() > 0) {
+                for (auto s : request->sensors()) {
+                    tracker.set_profile_length_at_boundary(static_cast<uint8_t>(s), length);
+                }
+            } else {
+                tracker.set_profile_length_at_boundary_all(length);
+            }
+        }
         response->set_success(ok);
         response->set_message(ok ? "Heater configured" : resp.value("error", "Unknown error"));
         
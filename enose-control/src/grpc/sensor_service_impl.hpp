@@ -2,6 +2,10 @@
 
 #include <grpcpp/grpcpp.h>
 #include "enose_service.grpc.pb.h"
+#include "grpc/broadcast_hub.hpp"
+#include "grpc/stream_decimation.hpp"
+#include "grpc/stream_reactors.hpp"
+#include "hal/sensor_board_group.hpp"
 #include "hal/sensor_driver.hpp"
 #include <memory>
 #include <mutex>
@@ -11,9 +15,43 @@
 
 namespace enose_grpc {
 
-class SensorServiceImpl final : public ::enose::service::SensorService::Service {
+/**
+ * @brief SensorReading 的抽稀通道定义: 传感器板 × 传感器 × 加热步 × ADC 通道 × 类型
+ */
+struct SensorReadingDecimation {
+    static uint64_t channel(const ::enose::service::SensorReading& r) {
+        return (uint64_t{r.sensor_idx()} << 40) ^ (uint64_t{r.heater_step()} << 24) ^
+               (uint64_t{r.adc_channel()} << 8) ^ std::hash<std::string>{}(r.sensor_type()) ^
+               (std::hash<std::string>{}(r.device_id()) << 1);
+    }
+    static uint64_t tick_ms(const ::enose::service::SensorReading& r) { return r.tick_ms(); }
+    static double value(const ::enose::service::SensorReading& r) { return r.value(); }
+    static bool accepts(const DecimationConfig& config, const ::enose::service::SensorReading& r) {
+        return config.accepts(r.sensor_idx(), r.heater_step()) && config.accepts_device(r.device_id());
+    }
+    static void set_envelope(::enose::service::SensorReading& r, double min, double max, uint32_t count) {
+        r.set_min_value(min);
+        r.set_max_value(max);
+        r.set_sample_count(count);
+    }
+};
+
+// 流式方法走 callback API, 其余保持同步 API
+using SensorServiceBase = ::enose::service::SensorService::WithCallbackMethod_SubscribeSensorReadings<
+    ::enose::service::SensorService::Service>;
+
+class SensorServiceImpl final : public SensorServiceBase {
 public:
-    SensorServiceImpl(std::shared_ptr<hal::SensorDriver> sensor);
+    /**
+     * @param stream_queue_size 每个 SubscribeSensorReadings 客户端的队列上限
+     * @param overflow          队列满时的处理策略
+     * @param boards            可选, 多块传感器板: 读数流取自合并流, 命令按 device_id 路由;
+     *                          为空时只服务 sensor 一块板
+     */
+    SensorServiceImpl(std::shared_ptr<hal::SensorDriver> sensor,
+                      std::size_t stream_queue_size = 1024,
+                      OverflowPolicy overflow = OverflowPolicy::DROP_OLDEST,
+                      std::shared_ptr<hal::SensorBoardGroup> boards = nullptr);
     ~SensorServiceImpl();
 
     ::grpc::Status SendCommand(
@@ -21,10 +59,9 @@ public:
         const ::enose::service::SensorCommandRequest* request,
         ::enose::service::SensorCommandResponse* response) override;
 
-    ::grpc::Status SubscribeSensorReadings(
-        ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
-        ::grpc::ServerWriter<::enose::service::SensorReading>* writer) override;
+    ::grpc::ServerWriteReactor<::enose::service::SensorReading>* SubscribeSensorReadings(
+        ::grpc::CallbackServerContext* context,
+        const ::enose::service::SubscribeSensorReadingsRequest* request) override;
 
     ::grpc::Status GetSensorStatus(
         ::grpc::ServerContext* context,
@@ -36,31 +73,48 @@ public:
         const ::enose::service::HeaterConfigRequest* request,
         ::enose::service::HeaterConfigResponse* response) override;
 
+    /** @brief 导出流订阅者的积压和丢弃 (抓取线程调用) */
+    void collect_metrics(core::MetricWriter& writer) const;
+
 private:
-    void on_sensor_packet(const nlohmann::json& packet);
-    nlohmann::json send_command_and_wait(const std::string& cmd, const nlohmann::json& params = {});
+    // 每块传感器板的状态与命令应答队列
+    struct Board {
+        std::string device_id;
+        std::shared_ptr<hal::SensorDriver> sensor;
+        std::atomic<bool> running{false};
+        std::atomic<uint32_t> sensor_count{8};
+        std::string firmware_version;       // response_mutex 保护
+        
+        mutable std::mutex response_mutex;
+        std::condition_variable response_cv;
+        std::queue<nlohmann::json> response_queue;
+        boost::signals2::scoped_connection packet_connection;
+        boost::signals2::scoped_connection link_connection;
+    };
+
+    void on_sensor_packet(Board& board, const nlohmann::json& packet);
+    void on_sensor_readings(std::span<const hal::SensorSample> samples);
+    // 覆盖所有字段, 可复用已 Clear() 的消息 (保留字符串容量)
+    static void fill_reading(const hal::SensorSample& sample, ::enose::service::SensorReading* reading);
+    nlohmann::json send_command_and_wait(Board& board, const std::string& cmd, const nlohmann::json& params = {});
+    /** @brief device_id 为空时返回主板, 未知时返回 nullptr */
+    Board* find_board(const std::string& device_id);
+    void fill_status(const Board& board, ::enose::service::SensorBoardStatus* status) const;
 
     std::shared_ptr<hal::SensorDriver> sensor_;
-    
-    // 传感器板状态
-    std::atomic<bool> connected_{false};
-    std::atomic<bool> running_{false};
-    std::atomic<uint32_t> sensor_count_{8};
-    std::string firmware_version_;
-    std::string port_;
-    
-    // 命令响应队列
-    std::mutex response_mutex_;
-    std::condition_variable response_cv_;
-    std::queue<nlohmann::json> response_queue_;
+    std::shared_ptr<hal::SensorBoardGroup> group_;
+    std::vector<std::unique_ptr<Board>> boards_;    // [0] 为主板, 构造后不再变化
     std::atomic<int> cmd_id_{0};
     
-    // 数据流订阅者
-    std::mutex subscribers_mutex_;
-    std::vector<::grpc::ServerWriter<::enose::service::SensorReading>*> subscribers_;
+    // 数据流订阅者: io 线程只入队, 各客户端的 HubWriteReactor 负责写出
+    BroadcastHub<::enose::service::SensorReading> readings_hub_;
+    // 请求了抽稀/过滤的订阅者, 按配置分组共享
+    DecimatedHubSet<::enose::service::SensorReading, SensorReadingDecimation> decimated_hubs_;
+    // on_sensor_readings 的转换缓冲 (只在其 strand 上访问), 跨帧复用消息对象
+    std::vector<::enose::service::SensorReading> readings_scratch_;
     
     // 信号连接
-    boost::signals2::connection packet_connection_;
+    boost::signals2::connection readings_connection_;
 };
 
 } // namespace enose_grpc
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "grpc/broadcast_hub.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace enose_grpc {
+
+/**
+ * @brief 实时流的抽稀 / 过滤配置
+ *
+ * 同一配置的所有客户端共用一个 DecimatedHubSet 条目, 抽稀在服务端只做一次.
+ * 构造后调用 normalize() 使等价配置比较相等.
+ */
+struct DecimationConfig {
+    uint32_t bucket_ms = 0;                 // 每通道时间桶宽度, 0 = 不抽稀
+    bool envelope = false;                  // 输出附带桶内 min / max / count
+    std::vector<uint32_t> sensors;          // 只保留这些 sensor_idx, 空 = 全部
+    std::vector<uint32_t> heater_steps;     // 只保留这些加热步, 空 = 全部
+    std::vector<std::string> devices;       // 只保留这些传感器板 (device_id), 空 = 全部
+
+    /** @brief 由目标频率 (Hz) 计算桶宽, <= 0 表示不抽稀 */
+    static uint32_t bucket_for_rate(double rate_hz) {
+        if (!(rate_hz > 0.0)) return 0;
+        return static_cast<uint32_t>(std::max(1.0, std::round(1000.0 / rate_hz)));
+    }
+
+    void normalize() {
+        for (auto* list : {&sensors, &heater_steps}) {
+            std::sort(list->begin(), list->end());
+            list->erase(std::unique(list->begin(), list->end()), list->end());
+        }
+        std::sort(devices.begin(), devices.end());
+        devices.erase(std::unique(devices.begin(), devices.end()), devices.end());
+        if (bucket_ms == 0) envelope = false;
+    }
+
+    /** @brief 等价于不做任何处理 (直接使用原始流) */
+    bool passthrough() const {
+        return bucket_ms == 0 && sensors.empty() && heater_steps.empty() && devices.empty();
+    }
+
+    bool accepts(uint32_t sensor_idx, uint32_t heater_step) const {
+        return (sensors.empty() || std::binary_search(sensors.begin(), sensors.end(), sensor_idx)) &&
+               (heater_steps.empty() ||
+                std::binary_search(heater_steps.begin(), heater_steps.end(), heater_step));
+    }
+
+    bool accepts_device(const std::string& device_id) const {
+        return devices.empty() || std::binary_search(devices.begin(), devices.end(), device_id);
+    }
+
+    auto operator<=>(const DecimationConfig&) const = default;
+};
+
+/**
+ * @brief 按通道分时间桶抽稀
+ *
+ * 每个通道每个桶输出一条: 桶内最后一个样本作为代表值, envelope 时附带桶内
+ * min / max / count. 桶在该通道下一个桶的首个样本到达时输出; tick 回退 (设备重连)
+ * 时同样结束当前桶. 该通道不再有样本时, flush_stale 在主机时间超过两个桶宽后输出它
+ * (只要流中还有其他样本, 延迟至多约两个桶宽), 流停止时由 flush 输出全部未结束的桶.
+ *
+ * Traits 提供:
+ *   static uint64_t channel(const T&);
+ *   static uint64_t tick_ms(const T&);
+ *   static double value(const T&);
+ *   static bool accepts(const DecimationConfig&, const T&);
+ *   static void set_envelope(T&, double min, double max, uint32_t count);
+ */
+template<typename T, typename Traits>
+class StreamDecimator {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StreamDecimator(const DecimationConfig& config) : config_(config) {}
+
+    void push(const T& item, std::vector<T>& out, Clock::time_point now = Clock::now()) {
+        if (!Traits::accepts(config_, item)) return;
+        if (config_.bucket_ms == 0) {
+            out.push_back(item);
+            return;
+        }
+
+        const uint64_t index = Traits::tick_ms(item) / config_.bucket_ms;
+        const double value = Traits::value(item);
+        auto [it, inserted] = buckets_.try_emplace(Traits::channel(item));
+        auto& bucket = it->second;
+        if (!inserted && bucket.count > 0 && bucket.index != index) {
+            emit(bucket, out);
+        }
+        if (inserted || bucket.count == 0) {
+            bucket.index = index;
+            bucket.opened = now;
+            bucket.min = value;
+            bucket.max = value;
+        } else {
+            bucket.min = std::min(bucket.min, value);
+            bucket.max = std::max(bucket.max, value);
+        }
+        bucket.last = item;
+        ++bucket.count;
+    }
+
+    /** @brief 输出开桶后主机时间已超过两个桶宽的桶; 每半个桶宽最多扫描一次所有通道 */
+    void flush_stale(Clock::time_point now, std::vector<T>& out) {
+        if (config_.bucket_ms == 0 || now < next_scan_) return;
+        const auto width = std::chrono::milliseconds(config_.bucket_ms);
+        next_scan_ = now + width / 2;
+        for (auto& [channel, bucket] : buckets_) {
+            if (bucket.count > 0 && now - bucket.opened >= 2 * width) {
+                emit(bucket, out);
+            }
+        }
+    }
+
+    /** @brief 输出所有未结束的桶 */
+    void flush(std::vector<T>& out) {
+        for (auto& [channel, bucket] : buckets_) {
+            if (bucket.count > 0) {
+                emit(bucket, out);
+            }
+        }
+    }
+
+private:
+    struct Bucket {
+        uint64_t index = 0;
+        Clock::time_point opened;       // 首个样本到达的主机时间
+        T last;
+        double min = 0;
+        double max = 0;
+        uint32_t count = 0;
+    };
+
+    void emit(Bucket& bucket, std::vector<T>& out) {
+        if (config_.envelope) {
+            Traits::set_envelope(bucket.last, bucket.min, bucket.max, bucket.count);
+        }
+        out.push_back(std::move(bucket.last));
+        bucket.count = 0;
+    }
+
+    DecimationConfig config_;
+    std::unordered_map<uint64_t, Bucket> buckets_;
+    Clock::time_point next_scan_;
+};
+
+/**
+ * @brief 按配置共享的抽稀流集合
+ *
+ * 每个不同的 DecimationConfig 对应一个条目 (StreamDecimator + BroadcastHub),
+ * publish() 对每个条目只抽稀一次再广播给其所有订阅者. 客户端持有条目的 shared_ptr,
+ * 最后一个客户端断开后条目在下一次 publish() 时回收.
+ *
+ * publish() 须在同一线程 (io 线程) 调用; acquire() 可在任意线程调用.
+ */
+template<typename T, typename Traits>
+class DecimatedHubSet {
+public:
+    struct Entry {
+        Entry(const DecimationConfig& config, std::size_t capacity, OverflowPolicy policy)
+            : decimator(config), hub(capacity, policy) {}
+
+        StreamDecimator<T, Traits> decimator;
+        BroadcastHub<T> hub;
+    };
+
+    DecimatedHubSet(std::size_t capacity, OverflowPolicy policy)
+        : capacity_(capacity), policy_(policy) {}
+
+    /** @brief 各条目 hub 的延迟统计阶段, 见 BroadcastHub::set_latency_stage */
+    void set_latency_stage(core::LatencyStage stage) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stage_ = stage;
+    }
+
+    /**
+     * @brief 取得 (或创建) 该配置的条目; 调用方在流结束前须一直持有返回值
+     */
+    std::shared_ptr<Entry> acquire(const DecimationConfig& config) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = entries_[config];
+        if (!entry) {
+            entry = std::make_shared<Entry>(config, capacity_, policy_);
+            if (stage_) {
+                entry->hub.set_latency_stage(*stage_);
+            }
+        }
+        return entry;
+    }
+
+    void publish(std::span<const T> items, uint64_t origin_ns = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = StreamDecimator<T, Traits>::Clock::now();
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (it->second.use_count() == 1) {
+                it = entries_.erase(it);
+                continue;
+            }
+            scratch_.clear();
+            for (const auto& item : items) {
+                it->second->decimator.push(item, scratch_, now);
+            }
+            // 已停止上报的通道不等它的下一个样本
+            it->second->decimator.flush_stale(now, scratch_);
+            if (!scratch_.empty()) {
+                it->second->hub.publish(std::span<const T>(scratch_), origin_ns);
+            }
+            ++it;
+        }
+    }
+
+    /** @brief 输出并广播所有条目中未结束的桶 (数据源断开时调用) */
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [config, entry] : entries_) {
+            scratch_.clear();
+            entry->decimator.flush(scratch_);
+            if (!scratch_.empty()) {
+                entry->hub.publish(std::span<const T>(scratch_));
+            }
+        }
+    }
+
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.empty();
+    }
+
+    std::vector<SubscriberStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<SubscriberStats> out;
+        for (const auto& [config, entry] : entries_) {
+            auto entry_stats = entry->hub.stats();
+            out.insert(out.end(), entry_stats.begin(), entry_stats.end());
+        }
+        return out;
+    }
+
+    void close_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [config, entry] : entries_) {
+            entry->hub.close_all();
+        }
+    }
+
+private:
+    std::size_t capacity_;
+    OverflowPolicy policy_;
+    std::optional<core::LatencyStage> stage_;
+    mutable std::mutex mutex_;
+    std::map<DecimationConfig, std::shared_ptr<Entry>> entries_;
+    std::vector<T> scratch_;
+};
+
+} // namespace enose_grpc
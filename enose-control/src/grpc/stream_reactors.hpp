@@ -0,0 +1,499 @@
+#pragma once
+
+#include "grpc/broadcast_hub.hpp"
+#include "grpc/event_bus.hpp"
+#include "core/metrics.hpp"
+#include <boost/signals2.hpp>
+#include <grpcpp/alarm.h>
+#include <grpcpp/grpcpp.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace enose_grpc {
+
+/**
+ * @brief 各服务端流共用的指标: 按流名区分的已写出消息数和当前连接数
+ */
+struct StreamMetrics {
+    core::Counter& messages;
+    core::Gauge& clients;
+
+    explicit StreamMetrics(const std::string& stream)
+        : messages(core::MetricsRegistry::instance().counter(
+              "grpc_stream_messages_total", "Messages written to gRPC server streams", {{"stream", stream}}))
+        , clients(core::MetricsRegistry::instance().gauge(
+              "grpc_stream_clients", "Connected gRPC server stream clients", {{"stream", stream}})) {
+        clients.add(1);
+    }
+    ~StreamMetrics() { clients.add(-1); }
+
+    StreamMetrics(const StreamMetrics&) = delete;
+    StreamMetrics& operator=(const StreamMetrics&) = delete;
+};
+
+/**
+ * @brief 服务端流的消息压缩级别 (grpc.stream_compression, 服务器启动前设置)
+ *
+ * 按级别而不是具体算法设置: gRPC 在客户端 grpc-accept-encoding 通告的算法中选用,
+ * 客户端不支持压缩时退回不压缩. 一元调用不受影响.
+ */
+inline std::atomic<grpc_compression_level>& stream_compression_level() {
+    static std::atomic<grpc_compression_level> level{GRPC_COMPRESS_LEVEL_NONE};
+    return level;
+}
+
+/**
+ * @brief 在服务端流方法开头调用 (须在首次写出、即发送初始元数据之前)
+ */
+inline void apply_stream_compression(::grpc::CallbackServerContext* context) {
+    const auto level = stream_compression_level().load(std::memory_order_relaxed);
+    if (level != GRPC_COMPRESS_LEVEL_NONE) {
+        context->set_compression_level(level);
+    }
+}
+
+/**
+ * @brief 由 BroadcastHub 驱动的服务端流 (callback API)
+ *
+ * 数据到达时才发起写, 同一时刻最多一个写在途; 不占用 gRPC 同步线程池,
+ * 连接数只增加内存而不增加线程. 直接写出 hub 中共享的消息, 写完成前持有其引用.
+ * 客户端取消、写失败或 hub 关闭时结束流.
+ * 对象在 OnDone() 中自删除.
+ */
+template<typename T>
+class HubWriteReactor : public ::grpc::ServerWriteReactor<T> {
+public:
+    /**
+     * @param initial 可选的首条消息 (如当前快照), 只发给本客户端
+     * @param owner   可选, 持有 hub 所属对象直到流结束 (如 DecimatedHubSet 的条目)
+     */
+    HubWriteReactor(BroadcastHub<T>& hub, std::string client, std::string stream_name,
+                    std::optional<T> initial = std::nullopt,
+                    std::shared_ptr<void> owner = nullptr)
+        : hub_(hub), owner_(std::move(owner)), stream_name_(std::move(stream_name)), metrics_(stream_name_) {
+        spdlog::info("gRPC: {} - client {} connected", stream_name_, client);
+        sub_ = hub_.make_subscription(client);
+        sub_->set_notify([this]() { try_write(); });
+        hub_.attach(sub_);
+
+        if (initial) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!writing_) {
+                initial_ = std::move(*initial);
+                writing_ = true;
+                this->StartWrite(&initial_);
+            }
+        }
+    }
+
+    void OnWriteDone(bool ok) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_ = false;
+        if (!ok) {
+            finish_locked();
+            return;
+        }
+        sub_->record_delivery(current_origin_ns_);
+        metrics_.messages.inc();
+        current_.reset();
+        write_next_locked();
+    }
+
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finish_locked();
+    }
+
+    void OnDone() override {
+        hub_.unsubscribe(sub_);
+        auto stats = sub_->stats();
+        spdlog::info("gRPC: {} - client {} disconnected (delivered={}, dropped={})",
+                     stream_name_, stats.client, stats.delivered, stats.dropped);
+        delete this;
+    }
+
+private:
+    void try_write() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_next_locked();
+    }
+
+    void write_next_locked() {
+        if (writing_ || finished_) return;
+        if (sub_->try_pop(current_, current_origin_ns_)) {
+            writing_ = true;
+            this->StartWrite(current_.get());
+        } else if (sub_->closed()) {
+            finish_locked();
+        }
+    }
+
+    void finish_locked() {
+        if (finished_) return;
+        finished_ = true;
+        this->Finish(::grpc::Status::OK);
+    }
+
+    BroadcastHub<T>& hub_;
+    std::shared_ptr<void> owner_;
+    typename BroadcastHub<T>::SubscriptionPtr sub_;
+    std::string stream_name_;
+    StreamMetrics metrics_;
+
+    std::mutex mutex_;
+    T initial_;
+    std::shared_ptr<const T> current_;  // 在途的写; 写完成后释放 (最后一个引用回到 hub 的池)
+    uint64_t current_origin_ns_ = 0;    // 首条快照消息为 0, 不计入延迟
+    bool writing_ = false;
+    bool finished_ = false;
+};
+
+/**
+ * @brief 立即以给定状态结束的服务端流, 用于请求参数无效等情况. 对象在 OnDone() 中自删除.
+ */
+template<typename T>
+class FinishedWriteReactor : public ::grpc::ServerWriteReactor<T> {
+public:
+    explicit FinishedWriteReactor(::grpc::Status status) {
+        this->Finish(std::move(status));
+    }
+
+    void OnDone() override {
+        delete this;
+    }
+};
+
+/**
+ * @brief 由 EventBus 驱动的服务端流 (callback API)
+ *
+ * 只持有读游标, 按 seq 顺序写出总线上的事件. resume_after_seq 非 0 时
+ * 先补发缓冲区中该 seq 之后的事件, 否则从订阅时刻开始. resume_after_seq 大于总线的
+ * last_seq 说明客户端的 seq 来自重启前的进程, 按新订阅处理. 总线关闭且已读完时结束流.
+ * 对象在 OnDone() 中自删除.
+ */
+template<typename T>
+class BusWriteReactor : public ::grpc::ServerWriteReactor<T> {
+public:
+    BusWriteReactor(EventBus<T>& bus, std::string client, std::string stream_name,
+                    uint64_t resume_after_seq = 0)
+        : bus_(bus), client_(std::move(client)), stream_name_(std::move(stream_name)), metrics_(stream_name_) {
+        const uint64_t last_seq = bus_.last_seq();
+        if (resume_after_seq > last_seq) {
+            spdlog::info("gRPC: {} - client {} resumes after seq {} but the bus is at {} (server restarted), "
+                         "subscribing from now", stream_name_, client_, resume_after_seq, last_seq);
+            resume_after_seq = 0;
+        }
+        cursor_ = (resume_after_seq > 0 ? resume_after_seq : last_seq) + 1;
+        spdlog::info("gRPC: {} - client {} connected (from seq {})", stream_name_, client_, cursor_);
+        subscriber_id_ = bus_.subscribe([this]() { try_write(); });
+        try_write();
+    }
+
+    void OnWriteDone(bool ok) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_ = false;
+        if (!ok) {
+            finish_locked();
+            return;
+        }
+        ++delivered_;
+        metrics_.messages.inc();
+        write_next_locked();
+    }
+
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finish_locked();
+    }
+
+    void OnDone() override {
+        bus_.unsubscribe(subscriber_id_);
+        spdlog::info("gRPC: {} - client {} disconnected (delivered={}, skipped={})",
+                     stream_name_, client_, delivered_, skipped_);
+        delete this;
+    }
+
+private:
+    void try_write() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_next_locked();
+    }
+
+    void write_next_locked() {
+        if (writing_ || finished_) return;
+        if (bus_.read(cursor_, current_, &skipped_)) {
+            writing_ = true;
+            this->StartWrite(&current_);
+        } else if (bus_.closed()) {
+            finish_locked();
+        }
+    }
+
+    void finish_locked() {
+        if (finished_) return;
+        finished_ = true;
+        this->Finish(::grpc::Status::OK);
+    }
+
+    EventBus<T>& bus_;
+    std::string client_;
+    std::string stream_name_;
+    StreamMetrics metrics_;
+    uint64_t subscriber_id_ = 0;
+
+    std::mutex mutex_;
+    T current_;
+    uint64_t cursor_ = 1;
+    uint64_t delivered_ = 0;
+    uint64_t skipped_ = 0;
+    bool writing_ = false;
+    bool finished_ = false;
+};
+
+/**
+ * @brief 由变更通知驱动的服务端流 (callback API)
+ *
+ * connect 把 notify 接到变更信号上 (可在任意线程触发). 空闲时收到通知立即调用
+ * build 写出, 写在途期间的多次通知合并为一次; 超过 keepalive 未写出时由 grpc::Alarm
+ * 触发一次 build(full=true). 首条消息同样以 full=true 构建. build 返回 false 表示无需发送.
+ * 对象在 OnDone() 与挂起的 Alarm 都结束后自删除.
+ */
+template<typename T>
+class ChangeWriteReactor : public ::grpc::ServerWriteReactor<T> {
+public:
+    using BuildFn = std::function<bool(T*, bool full)>;
+    using ConnectFn = std::function<boost::signals2::connection(std::function<void()>)>;
+
+    ChangeWriteReactor(ConnectFn connect, BuildFn build, std::chrono::milliseconds keepalive,
+                       std::string client, std::string stream_name)
+        : build_(std::move(build)), keepalive_(keepalive)
+        , client_(std::move(client)), stream_name_(std::move(stream_name)), metrics_(stream_name_)
+        , notifier_(std::make_shared<Notifier>()) {
+        spdlog::info("gRPC: {} - client {} connected", stream_name_, client_);
+        notifier_->reactor = this;
+        connection_ = connect([notifier = notifier_]() {
+            std::lock_guard<std::mutex> lock(notifier->mutex);
+            if (notifier->reactor) notifier->reactor->notify();
+        });
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_locked(true);
+        arm_keepalive_locked(std::chrono::steady_clock::now() + keepalive_);
+    }
+
+    void OnWriteDone(bool ok) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_ = false;
+        if (!ok) {
+            finish_locked();
+            return;
+        }
+        ++delivered_;
+        metrics_.messages.inc();
+        if (dirty_) write_locked(false);
+    }
+
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finish_locked();
+    }
+
+    void OnDone() override {
+        // 先切断通知: 之后槽函数即使仍在其他线程执行也不会再访问本对象
+        connection_.disconnect();
+        {
+            std::lock_guard<std::mutex> lock(notifier_->mutex);
+            notifier_->reactor = nullptr;
+        }
+        spdlog::info("gRPC: {} - client {} disconnected (delivered={})",
+                     stream_name_, client_, delivered_);
+        bool destroy = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            if (alarm_pending_) {
+                // Alarm 回调 (fired=false) 负责删除
+                alarm_.Cancel();
+            } else {
+                destroy = true;
+            }
+        }
+        if (destroy) delete this;
+    }
+
+private:
+    struct Notifier {
+        std::mutex mutex;
+        ChangeWriteReactor* reactor = nullptr;
+    };
+
+    void notify() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirty_ = true;
+        write_locked(false);
+    }
+
+    void write_locked(bool full) {
+        if (writing_ || finished_) return;
+        dirty_ = false;
+        if (!build_(&current_, full)) return;
+        writing_ = true;
+        last_write_ = std::chrono::steady_clock::now();
+        this->StartWrite(&current_);
+    }
+
+    void arm_keepalive_locked(std::chrono::steady_clock::time_point deadline) {
+        if (keepalive_.count() <= 0 || alarm_pending_ || done_) return;
+        alarm_pending_ = true;
+        auto delay = std::max(deadline - std::chrono::steady_clock::now(),
+                              std::chrono::steady_clock::duration::zero());
+        alarm_.Set(std::chrono::system_clock::now() +
+                       std::chrono::duration_cast<std::chrono::system_clock::duration>(delay),
+                   [this](bool fired) {
+            bool destroy = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                alarm_pending_ = false;
+                if (done_) {
+                    destroy = true;
+                } else if (fired && !finished_) {
+                    auto now = std::chrono::steady_clock::now();
+                    if (writing_) {
+                        // 慢客户端: 等这次写完后再计时
+                        arm_keepalive_locked(now + keepalive_);
+                    } else if (now - last_write_ >= keepalive_) {
+                        write_locked(true);
+                        arm_keepalive_locked(now + keepalive_);
+                    } else {
+                        arm_keepalive_locked(last_write_ + keepalive_);
+                    }
+                }
+            }
+            if (destroy) delete this;
+        });
+    }
+
+    void finish_locked() {
+        if (finished_) return;
+        finished_ = true;
+        this->Finish(::grpc::Status::OK);
+    }
+
+    BuildFn build_;
+    std::chrono::milliseconds keepalive_;
+    std::string client_;
+    std::string stream_name_;
+    StreamMetrics metrics_;
+    std::shared_ptr<Notifier> notifier_;
+    boost::signals2::scoped_connection connection_;
+
+    std::mutex mutex_;
+    ::grpc::Alarm alarm_;
+    T current_;
+    std::chrono::steady_clock::time_point last_write_{};
+    uint64_t delivered_ = 0;
+    bool dirty_ = false;
+    bool writing_ = false;
+    bool finished_ = false;
+    bool alarm_pending_ = false;
+    bool done_ = false;
+};
+
+/**
+ * @brief 定时推送快照的服务端流 (callback API)
+ *
+ * 用于尚无变更通知的状态: 每个周期由 grpc::Alarm 触发一次 fill 并写出,
+ * 两次写之间不占用任何线程. 对象在 OnDone() 与挂起的 Alarm 都结束后自删除.
+ */
+template<typename T>
+class PeriodicWriteReactor : public ::grpc::ServerWriteReactor<T> {
+public:
+    using FillFn = std::function<void(T*)>;
+
+    PeriodicWriteReactor(std::chrono::milliseconds period, FillFn fill, std::string stream_name)
+        : period_(period), fill_(std::move(fill)), stream_name_(std::move(stream_name)), metrics_(stream_name_) {
+        spdlog::info("gRPC: {} - client connected", stream_name_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_locked();
+    }
+
+    void OnWriteDone(bool ok) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) {
+            finish_locked();
+            return;
+        }
+        metrics_.messages.inc();
+        if (finished_) return;
+
+        alarm_pending_ = true;
+        alarm_.Set(std::chrono::system_clock::now() + period_, [this](bool fired) {
+            bool destroy = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                alarm_pending_ = false;
+                if (done_) {
+                    destroy = true;
+                } else if (fired) {
+                    write_locked();
+                }
+            }
+            if (destroy) delete this;
+        });
+    }
+
+    void OnCancel() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finish_locked();
+    }
+
+    void OnDone() override {
+        spdlog::info("gRPC: {} - client disconnected", stream_name_);
+        bool destroy = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            if (alarm_pending_) {
+                // Alarm 回调 (fired=false) 负责删除
+                alarm_.Cancel();
+            } else {
+                destroy = true;
+            }
+        }
+        if (destroy) delete this;
+    }
+
+private:
+    void write_locked() {
+        if (finished_) return;
+        fill_(&current_);
+        this->StartWrite(&current_);
+    }
+
+    void finish_locked() {
+        if (finished_) return;
+        finished_ = true;
+        this->Finish(::grpc::Status::OK);
+    }
+
+    std::chrono::milliseconds period_;
+    FillFn fill_;
+    std::string stream_name_;
+    StreamMetrics metrics_;
+
+    std::mutex mutex_;
+    ::grpc::Alarm alarm_;
+    T current_;
+    bool finished_ = false;
+    bool alarm_pending_ = false;
+    bool done_ = false;
+};
+
+} // namespace enose_grpc
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "enose_data.pb.h"
+#include "grpc/event_bus.hpp"
+#include <google/protobuf/util/time_util.h>
+#include <initializer_list>
+#include <string>
+#include <utility>
+
+namespace enose_grpc {
+
+/**
+ * @brief 进程级系统事件总线 (ControlService.SubscribeEvents 的数据源)
+ *
+ * 由 GrpcServer 创建, 各服务和驱动回调向其发布; 所有客户端看到同一条 seq 序列.
+ */
+using SystemEventBus = EventBus<::enose::data::Event>;
+
+inline uint64_t publish_system_event(
+    SystemEventBus& bus,
+    ::enose::data::Event::EventType type,
+    ::enose::data::Event::Severity severity,
+    std::string text,
+    std::initializer_list<std::pair<const char*, std::string>> fields = {}) {
+
+    ::enose::data::Event event;
+    *event.mutable_ts() = google::protobuf::util::TimeUtil::GetCurrentTime();
+    event.set_type(type);
+    event.set_severity(severity);
+    event.set_text(std::move(text));
+    for (const auto& [key, value] : fields) {
+        auto* kv = event.add_fields();
+        kv->set_key(key);
+        kv->set_value(value);
+    }
+    return bus.publish(std::move(event));
+}
+
+} // namespace enose_grpc
@@ -3,6 +3,8 @@
 #include <spdlog/spdlog.h>
 #include <google/protobuf/timestamp.pb.h>
 #include <google/protobuf/util/time_util.h>
+#include <algorithm>
+#include <limits>
 
 namespace grpc_service {
 
@@ -64,6 +66,15 @@ TestServiceImpl::TestServiceImpl(
             load_cell_->reset_dynamic_empty_weight();
         });
     
+    // 线性度测试的单泵循环同样用于在线泵标定
+    test_controller_->set_result_callback(
+        [this](const workflows::TestResult& result) {
+            load_cell_->record_pump_injection(
+                {result.pump0_volume, result.pump1_volume, result.pump2_volume, result.pump3_volume,
+                 result.pump4_volume, result.pump5_volume, result.pump6_volume, result.pump7_volume},
+                result.injected_weight);
+        });
+    
     spdlog::info("TestServiceImpl: Initialized");
 }
 
@@ -126,10 +137,10 @@ TestServiceImpl::TestServiceImpl(
 
 ::grpc::Status TestServiceImpl::GetTestStatus(
     ::grpc::ServerContext* context,
-    const ::google::protobuf::Empty* request,
+    const ::enose::service::GetTestStatusRequest* request,
     ::enose::service::TestStatusResponse* response)
 {
-    fill_status_response(response);
+    fill_status_response(response, request->after_log_index());
     return ::grpc::Status::OK;
 }
 
@@ -183,8 +194,9 @@ TestServiceImpl::TestServiceImpl(
     return ::grpc::Status::OK;
 }
 
-void TestServiceImpl::fill_status_response(::enose::service::TestStatusResponse* response) {
-    auto status = test_controller_->get_status();
+void TestServiceImpl::fill_status_response(::enose::service::TestStatusResponse* response,
+                                           uint64_t after_log_index) {
+    auto status = test_controller_->get_status(after_log_index);
     
     response->set_state(convert_state(status.state));
     response->set_run_id(status.run_id);
@@ -197,9 +209,10 @@ void TestServiceImpl::fill_status_response(::enose::service::TestStatusResponse*
     response->set_current_param_name(status.current_param_name);
     response->set_message(status.message);
     
-    for (const auto& log : status.logs) {
-        response->add_logs(log);
+    for (auto& log : status.logs) {
+        response->add_logs(std::move(log));
     }
+    response->set_last_log_index(status.last_log_index);
     
     if (status.dynamic_empty_weight.has_value()) {
         response->set_has_dynamic_empty_weight(true);
@@ -378,6 +391,62 @@ void TestServiceImpl::fill_status_response(::enose::service::TestStatusResponse*
     return ::grpc::Status::OK;
 }
 
+db::WeightSampleQuery TestServiceImpl::to_weight_sample_query(
+    const ::enose::service::GetWeightSamplesRequest& request)
+{
+    using google::protobuf::util::TimeUtil;
+    
+    db::WeightSampleQuery query;
+    query.run_id = request.run_id();
+    if (request.has_cycle()) {
+        query.cycle = request.cycle();
+    }
+    if (request.has_start_time()) {
+        query.start_time = std::chrono::system_clock::time_point(
+            std::chrono::microseconds(TimeUtil::TimestampToMicroseconds(request.start_time())));
+    }
+    if (request.has_end_time()) {
+        query.end_time = std::chrono::system_clock::time_point(
+            std::chrono::microseconds(TimeUtil::TimestampToMicroseconds(request.end_time())));
+    }
+    if (request.has_after()) {
+        query.after = db::WeightSampleCursor{
+            TimeUtil::TimestampToMicroseconds(request.after().time()), request.after().seq()};
+    }
+    query.limit = request.limit() > 0 ? request.limit() : DEFAULT_WEIGHT_SAMPLE_LIMIT;
+    return query;
+}
+
+void TestServiceImpl::fill_weight_samples(
+    const std::vector<db::WeightSampleRecord>& samples, std::size_t requested,
+    ::enose::service::WeightSamplesResponse* response)
+{
+    using google::protobuf::util::TimeUtil;
+    
+    response->mutable_samples()->Reserve(static_cast<int>(samples.size()));
+    for (const auto& s : samples) {
+        auto* sample = response->add_samples();
+        
+        *sample->mutable_time() = TimeUtil::MicrosecondsToTimestamp(
+            std::chrono::duration_cast<std::chrono::microseconds>(s.time.time_since_epoch()).count());
+        sample->set_seq(s.seq);
+        sample->set_run_id(s.run_id);
+        sample->set_cycle(s.cycle);
+        sample->set_phase(s.phase);
+        sample->set_weight(s.weight);
+        sample->set_is_stable(s.is_stable);
+        sample->set_trend(s.trend);
+    }
+    
+    response->set_total_count(static_cast<int>(samples.size()));
+    if (!samples.empty()) {
+        auto* cursor = response->mutable_next_cursor();
+        *cursor->mutable_time() = response->samples(response->samples_size() - 1).time();
+        cursor->set_seq(samples.back().seq);
+    }
+    response->set_has_more(samples.size() >= requested);
+}
+
 ::grpc::Status TestServiceImpl::GetWeightSamples(
     ::grpc::ServerContext* context,
     const ::enose::service::GetWeightSamplesRequest* request,
@@ -387,31 +456,65 @@ void TestServiceImpl::fill_status_response(::enose::service::TestStatusResponse*
         return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "数据库未配置");
     }
     
-    int run_id = request->run_id();
-    int limit = request->limit() > 0 ? request->limit() : 10000;
+    auto query = to_weight_sample_query(*request);
     
-    std::optional<int> cycle;
-    if (request->has_cycle()) {
-        cycle = request->cycle();
+    if (request->max_points() > 0) {
+        auto samples = repository_->get_weight_samples_downsampled(query, request->max_points());
+        fill_weight_samples(samples, std::numeric_limits<std::size_t>::max(), response);
+        response->set_downsampled(true);
+        return ::grpc::Status::OK;
     }
     
-    auto samples = repository_->get_weight_samples(run_id, cycle, std::nullopt, std::nullopt, limit);
+    auto samples = repository_->get_weight_samples_page(query);
+    fill_weight_samples(samples, static_cast<std::size_t>(query.limit), response);
+    return ::grpc::Status::OK;
+}
+
+::grpc::Status TestServiceImpl::StreamWeightSamples(
+    ::grpc::ServerContext* context,
+    const ::enose::service::GetWeightSamplesRequest* request,
+    ::grpc::ServerWriter<::enose::service::WeightSamplesResponse>* writer)
+{
+    if (!repository_) {
+        return ::grpc::Status(::grpc::StatusCode::UNAVAILABLE, "数据库未配置");
+    }
     
-    for (const auto& s : samples) {
-        auto* sample = response->add_samples();
+    auto query = to_weight_sample_query(*request);
+    
+    if (request->max_points() > 0) {
+        ::enose::service::WeightSamplesResponse response;
+        auto samples = repository_->get_weight_samples_downsampled(query, request->max_points());
+        fill_weight_samples(samples, std::numeric_limits<std::size_t>::max(), &response);
+        response.set_downsampled(true);
+        writer->Write(response);
+        return ::grpc::Status::OK;
+    }
+    
+    // 逐页查询并立即写出, 每页都从上一页最后一条的 (time, seq) 之后开始
+    const int page_size = request->page_size() > 0 ? request->page_size() : DEFAULT_WEIGHT_SAMPLE_PAGE;
+    int64_t remaining = request->limit() > 0 ? request->limit() : std::numeric_limits<int64_t>::max();
+    while (remaining > 0) {
+        if (context->IsCancelled()) {
+            return ::grpc::Status::CANCELLED;
+        }
         
-        auto time_t = std::chrono::system_clock::to_time_t(s.time);
-        sample->mutable_time()->set_seconds(time_t);
+        query.limit = static_cast<int>(std::min<int64_t>(page_size, remaining));
+        auto samples = repository_->get_weight_samples_page(query);
         
-        sample->set_run_id(s.run_id);
-        sample->set_cycle(s.cycle);
-        sample->set_phase(s.phase);
-        sample->set_weight(s.weight);
-        sample->set_is_stable(s.is_stable);
-        sample->set_trend(s.trend);
+        ::enose::service::WeightSamplesResponse response;
+        fill_weight_samples(samples, static_cast<std::size_t>(query.limit), &response);
+        remaining -= static_cast<int64_t>(samples.size());
+        if (!writer->Write(response)) {
+            break;
+        }
+        if (!response.has_more()) {
+            break;
+        }
+        query.after = db::WeightSampleCursor{
+            std::chrono::duration_cast<std::chrono::microseconds>(samples.back().time.time_since_epoch()).count(),
+            samples.back().seq};
     }
     
-    response->set_total_count(static_cast<int>(samples.size()));
     return ::grpc::Status::OK;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <grpcpp/grpcpp.h>
 #include "enose_service.grpc.pb.h"
 #include "../workflows/test_controller.hpp"
@@ -9,6 +10,8 @@
 
 namespace db {
     class TestRunRepository;
+    struct WeightSampleQuery;
+    struct WeightSampleRecord;
 }
 
 namespace grpc_service {
@@ -34,7 +37,7 @@ public:
 
     ::grpc::Status GetTestStatus(
         ::grpc::ServerContext* context,
-        const ::google::protobuf::Empty* request,
+        const ::enose::service::GetTestStatusRequest* request,
         ::enose::service::TestStatusResponse* response) override;
 
     ::grpc::Status GetTestResults(
@@ -69,8 +72,21 @@ public:
         const ::enose::service::GetWeightSamplesRequest* request,
         ::enose::service::WeightSamplesResponse* response) override;
 
+    ::grpc::Status StreamWeightSamples(
+        ::grpc::ServerContext* context,
+        const ::enose::service::GetWeightSamplesRequest* request,
+        ::grpc::ServerWriter<::enose::service::WeightSamplesResponse>* writer) override;
+
 private:
-    void fill_status_response(::enose::service::TestStatusResponse* response);
+    static constexpr int DEFAULT_WEIGHT_SAMPLE_LIMIT = 10000;
+    static constexpr int DEFAULT_WEIGHT_SAMPLE_PAGE = 2000;
+
+    static db::WeightSampleQuery to_weight_sample_query(const ::enose::service::GetWeightSamplesRequest& request);
+    // 填充一页样本, 并据 requested 条数设置 next_cursor / has_more
+    static void fill_weight_samples(const std::vector<db::WeightSampleRecord>& samples, std::size_t requested,
+                                    ::enose::service::WeightSamplesResponse* response);
+
+    void fill_status_response(::enose::service::TestStatusResponse* response, uint64_t after_log_index = 0);
     ::enose::service::TestState convert_state(workflows::TestState state);
 
     std::shared_ptr<workflows::SystemState> system_state_;
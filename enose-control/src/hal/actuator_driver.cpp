@@ -1,13 +1,47 @@
 #include "hal/actuator_driver.hpp"
+#include "hal/emergency_stop_link.hpp"
+#include "core/latency_tracer.hpp"
+#include "core/metrics.hpp"
 #include <spdlog/spdlog.h>
 #include <iostream>
 #include <format>
 #include <cmath>
+#include <algorithm>
+#include <string_view>
 
 namespace hal {
 
+namespace {
+
+// 通知帧的 "method" 值; Moonraker 总把它放在帧首附近, 只扫描前 64 字节.
+// 响应帧 (没有 method) 返回空
+std::string_view peek_method(std::string_view frame) {
+    constexpr std::string_view key = "\"method\"";
+    auto head = frame.substr(0, 64);
+    auto pos = head.find(key);
+    if (pos == std::string_view::npos) return {};
+
+    pos += key.size();
+    while (pos < frame.size() && (frame[pos] == ' ' || frame[pos] == ':')) ++pos;
+    if (pos >= frame.size() || frame[pos] != '"') return {};
+    auto end = frame.find('"', pos + 1);
+    if (end == std::string_view::npos) return {};
+    return frame.substr(pos + 1, end - pos - 1);
+}
+
+// "SET_PIN PIN=<name> VALUE=..." 的引脚名, 其他命令返回空
+std::string_view set_pin_name(std::string_view script) {
+    constexpr std::string_view prefix = "SET_PIN PIN=";
+    if (script.substr(0, prefix.size()) != prefix) return {};
+    auto name = script.substr(prefix.size());
+    return name.substr(0, name.find(' '));
+}
+
+} // namespace
+
 ActuatorDriver::ActuatorDriver(net::io_context& io)
-    : io_(io), ws_(io), resolver_(io), printer_info_timer_(io) {}
+    : io_(io), strand_(net::make_strand(io)), resolver_(strand_),
+      reconnect_timer_(strand_), printer_info_timer_(strand_), rpc_sweep_timer_(strand_) {}
 
 ActuatorDriver::~ActuatorDriver() {
     if (connected_) {
@@ -18,35 +52,89 @@ ActuatorDriver::~ActuatorDriver() {
 
 void ActuatorDriver::connect(const std::string& host, const std::string& port) {
     host_ = host;
+    port_ = port;
     spdlog::info("ActuatorDriver: Connecting to {}:{}", host, port);
-    resolver_.async_resolve(host, port,
-        beast::bind_front_handler(&ActuatorDriver::on_resolve, shared_from_this()));
+    net::post(strand_, [this, self = shared_from_this()]() { start_connect(); });
+    if (emergency_link_) {
+        emergency_link_->connect(host, port);
+    }
 }
 
-void ActuatorDriver::on_resolve(beast::error_code ec, tcp::resolver::results_type results) {
+void ActuatorDriver::set_emergency_link(std::shared_ptr<EmergencyStopLink> link) {
+    emergency_link_ = std::move(link);
+}
+
+ActuatorDriver::LinkStats ActuatorDriver::link_stats() const {
+    LinkStats stats;
+    stats.connected = connected_;
+    stats.reconnects = reconnects_;
+    stats.last_reconnect_latency_ms = last_reconnect_latency_ms_;
+    stats.connect_attempts = connect_attempts_;
+    stats.send_queue = send_queue_size_;
+    stats.pending_rpcs = pending_count_;
+    stats.emergency_link_connected = emergency_link_ && emergency_link_->is_connected();
+    stats.emergency_stops = emergency_stops_;
+    stats.emergency_stop_failures = emergency_stop_failures_;
+    stats.last_emergency_stop_latency_us = last_emergency_stop_latency_us_;
+    return stats;
+}
+
+void ActuatorDriver::start_connect() {
+    // 新建 stream; 旧 stream 上未完成的操作以 operation_aborted 结束, 由 gen 过滤
+    uint64_t gen = ++gen_;
+    ws_.emplace(strand_);
+    buffer_.consume(buffer_.size());
+    ++connect_attempts_;
+    
+    resolver_.async_resolve(host_, port_,
+        [this, self = shared_from_this(), gen](beast::error_code ec, tcp::resolver::results_type results) {
+            on_resolve(gen, ec, results);
+        });
+}
+
+void ActuatorDriver::schedule_reconnect() {
+    auto delay = reconnect_delay_;
+    reconnect_delay_ = std::min(reconnect_delay_ * 2, RECONNECT_DELAY_MAX);
+    spdlog::info("ActuatorDriver: Reconnecting in {}ms", delay.count());
+    
+    reconnect_timer_.expires_after(delay);
+    reconnect_timer_.async_wait([this, self = shared_from_this()](beast::error_code ec) {
+        if (!ec) {
+            start_connect();
+        }
+    });
+}
+
+void ActuatorDriver::on_resolve(uint64_t gen, beast::error_code ec, tcp::resolver::results_type results) {
+    if (gen != gen_) return;
     if (ec) {
         spdlog::error("ActuatorDriver: Resolve failed: {}", ec.message());
+        schedule_reconnect();
         return;
     }
 
-    beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
-    beast::get_lowest_layer(ws_).async_connect(results,
-        beast::bind_front_handler(&ActuatorDriver::on_connect, shared_from_this()));
+    beast::get_lowest_layer(*ws_).expires_after(std::chrono::seconds(30));
+    beast::get_lowest_layer(*ws_).async_connect(results,
+        [this, self = shared_from_this(), gen](beast::error_code ec, tcp::resolver::results_type::endpoint_type ep) {
+            on_connect(gen, ec, ep);
+        });
 }
 
-void ActuatorDriver::on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type ep) {
+void ActuatorDriver::on_connect(uint64_t gen, beast::error_code ec, tcp::resolver::results_type::endpoint_type) {
+    if (gen != gen_) return;
     if (ec) {
         spdlog::error("ActuatorDriver: Connect failed: {}", ec.message());
+        schedule_reconnect();
         return;
     }
 
-    beast::get_lowest_layer(ws_).expires_never();
+    beast::get_lowest_layer(*ws_).expires_never();
     
     // Set suggested timeout settings for the websocket
-    ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
+    ws_->set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
 
     // Set a decorator to change the User-Agent of the handshake
-    ws_.set_option(websocket::stream_base::decorator(
+    ws_->set_option(websocket::stream_base::decorator(
         [](websocket::request_type& req)
         {
             req.set(http::field::user_agent,
@@ -54,18 +142,37 @@ void ActuatorDriver::on_connect(beast::error_code ec, tcp::resolver::results_typ
                 " websocket-client-coro");
         }));
 
-    ws_.async_handshake(host_, "/websocket",
-        beast::bind_front_handler(&ActuatorDriver::on_handshake, shared_from_this()));
+    ws_->async_handshake(host_, "/websocket",
+        [this, self = shared_from_this(), gen](beast::error_code ec) {
+            on_handshake(gen, ec);
+        });
 }
 
-void ActuatorDriver::on_handshake(beast::error_code ec) {
+void ActuatorDriver::on_handshake(uint64_t gen, beast::error_code ec) {
+    if (gen != gen_) return;
     if (ec) {
         spdlog::error("ActuatorDriver: Handshake failed: {}", ec.message());
+        schedule_reconnect();
         return;
     }
 
-    spdlog::info("ActuatorDriver: Connected!");
+    // 旧连接残留的写队列不再有效
+    send_queue_.clear();
+    send_queue_size_ = 0;
+    write_in_flight_ = false;
+    reconnect_delay_ = RECONNECT_DELAY_MIN;
     connected_ = true;
+    
+    if (disconnected_at_) {
+        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - *disconnected_at_);
+        last_reconnect_latency_ms_ = static_cast<uint32_t>(latency.count());
+        ++reconnects_;
+        disconnected_at_.reset();
+        spdlog::info("ActuatorDriver: Reconnected after {}ms", latency.count());
+    } else {
+        spdlog::info("ActuatorDriver: Connected!");
+    }
 
     // Start reading
     do_read();
@@ -76,147 +183,461 @@ void ActuatorDriver::on_handshake(beast::error_code ec) {
     // 开始定时查询 printer.info
     query_printer_info();
     
-    // 启动呼吸灯 (急停指示灯)
+    // 启动呼吸灯 (急停指示灯); 重连时原来的 tick 已因断线停止, 重新启动
+    breathing_led_running_ = false;
     start_breathing_led();
+    
+    on_connection_changed(true);
 }
 
 void ActuatorDriver::do_read() {
-    ws_.async_read(buffer_,
-        beast::bind_front_handler(&ActuatorDriver::on_read, shared_from_this()));
+    ws_->async_read(buffer_,
+        [this, self = shared_from_this(), gen = gen_](beast::error_code ec, std::size_t bytes) {
+            on_read(gen, ec, bytes);
+        });
 }
 
-void ActuatorDriver::on_read(beast::error_code ec, std::size_t bytes_transferred) {
+void ActuatorDriver::on_read(uint64_t gen, beast::error_code ec, std::size_t) {
+    if (gen != gen_) return;
     if (ec) {
         spdlog::error("ActuatorDriver: Read failed: {}", ec.message());
-        connected_ = false;
+        on_disconnected("连接断开: " + ec.message());
         return;
     }
 
-    // Parse JSON
-    std::string data = beast::buffers_to_string(buffer_.data());
-    buffer_.consume(buffer_.size()); // Clear buffer
+    // flat_buffer 是连续内存, 直接在原地解析, 不复制为 std::string
+    auto frame = buffer_.data();
+    std::string_view data(static_cast<const char*>(frame.data()), frame.size());
 
     try {
-        auto j = nlohmann::json::parse(data);
-        
-        // Check if it's a notification
-        if (j.contains("method") && j["method"] == "notify_status_update") {
-            if (j.contains("params") && j["params"].is_array() && !j["params"].empty()) {
-                on_status_update(j["params"][0]);
+        // 先按方法名分发: 不关心的通知 (proc_stat, gcode_response 等) 不构建 DOM
+        auto method = peek_method(data);
+        if (method == "notify_status_update") {
+            auto j = nlohmann::json::parse(data.begin(), data.end());
+            auto& params = j["params"];
+            if (params.is_array() && !params.empty()) {
+                on_status_update(params[0]);
             }
         }
         // 检测 Klipper shutdown 状态
-        else if (j.contains("method") && j["method"] == "notify_klippy_shutdown") {
+        else if (method == "notify_klippy_shutdown") {
             spdlog::warn("ActuatorDriver: Klipper shutdown detected!");
             firmware_ready_ = false;
         }
-        else if (j.contains("method") && j["method"] == "notify_klippy_ready") {
+        else if (method == "notify_klippy_ready") {
             spdlog::info("ActuatorDriver: Klipper ready!");
             firmware_ready_ = true;
+            // Klipper 重启 (FIRMWARE_RESTART 等) 时 WebSocket 不断开, 但对象订阅和
+            // 引脚状态都已丢失, 与重连一样重新订阅并让上层重放外设状态
+            subscribe_objects();
+            on_firmware_ready();
         }
-        // 处理 printer.info 响应
-        else if (j.contains("id") && j["id"].get<int>() == printer_info_rpc_id_ && j.contains("result")) {
-            auto& result = j["result"];
-            if (result.contains("state")) {
-                std::string state = result["state"].get<std::string>();
-                bool was_ready = firmware_ready_;
-                firmware_ready_ = (state == "ready");
-                if (was_ready != firmware_ready_) {
-                    spdlog::info("ActuatorDriver: Klipper state changed to '{}', firmware_ready={}", state, firmware_ready_);
-                }
+        // RPC 响应 (result 或 error)
+        else if (method.empty()) {
+            auto j = nlohmann::json::parse(data.begin(), data.end());
+            if (j.contains("id") && j["id"].is_number_integer()) {
+                handle_response(j);
             }
-            // 安排下一次查询
-            schedule_printer_info_query();
-        }
-        // G-code 命令响应 (包括 query_object 回调)
-        else if (j.contains("id") && j.contains("result")) {
-            int id = j["id"].get<int>();
-            // RPC 响应日志已禁用 (高频轮询会产生大量日志)
-            // pdlog::debug("ActuatorDriver: RPC[{}] response: {}", id, j["result"].dump());
-            
-            // 检查是否有注册的回调
-            auto it = rpc_callbacks_.find(id);
-            if (it != rpc_callbacks_.end()) {
-                it->second(j);
-                rpc_callbacks_.erase(it);
-            }
-        }
-        // G-code 命令错误
-        else if (j.contains("id") && j.contains("error")) {
-            int id = j["id"].get<int>();
-            spdlog::error("ActuatorDriver: RPC[{}] error: {}", id, j["error"].dump());
-            
-            // 移除失败的回调
-            rpc_callbacks_.erase(id);
         }
 
     } catch (const std::exception& e) {
         spdlog::warn("ActuatorDriver: JSON parse error: {}", e.what());
     }
 
+    buffer_.consume(buffer_.size()); // Clear buffer
     do_read();
 }
 
-void ActuatorDriver::send_gcode(const std::string& gcode, bool silent) {
-    if (!connected_) return;
+void ActuatorDriver::handle_response(const nlohmann::json& j) {
+    int id = j["id"].get<int>();
+    auto it = pending_rpcs_.find(id);
+    if (it == pending_rpcs_.end()) {
+        // 已超时或断线时清理掉的请求, 晚到的响应直接丢弃
+        return;
+    }
+    
+    PendingRpc pending = std::move(it->second);
+    pending_rpcs_.erase(it);
+    pending_count_ = pending_rpcs_.size();
+    
+    RpcResult result;
+    if (j.contains("result")) {
+        result.ok = true;
+        result.result = j["result"];
+    } else {
+        result.error = j.contains("error") ? j["error"].dump() : "invalid response";
+        spdlog::error("ActuatorDriver: RPC[{}] {} error: {}", id, pending.method, result.error);
+    }
+    
+    if (pending.callback) {
+        pending.callback(result);
+    }
+}
 
-    // 使用 post 确保在 io_context 线程中执行，实现线程安全和非阻塞
-    net::post(io_, [this, self = shared_from_this(), gcode, silent]() {
+void ActuatorDriver::call(const std::string& method, nlohmann::json params, RpcCallback callback,
+                          std::chrono::milliseconds timeout) {
+    // 在 strand 上分配 id 和登记回调, 调用方可来自任意线程
+    net::post(strand_, [this, self = shared_from_this(), method, params = std::move(params),
+                    callback = std::move(callback), timeout]() mutable {
+        if (!connected_) {
+            if (callback) {
+                RpcResult result;
+                result.error = "not connected";
+                callback(result);
+            }
+            return;
+        }
+        
         nlohmann::json req;
         req["jsonrpc"] = "2.0";
-        req["method"] = "printer.gcode.script";
-        req["params"] = {{"script", gcode}};
+        req["method"] = method;
+        if (!params.is_null()) {
+            req["params"] = std::move(params);
+        }
         int id = rpc_id_++;
         req["id"] = id;
         
-        if (!silent) {
-            spdlog::info("ActuatorDriver: RPC[{}] send: {}", id, gcode);
+        pending_rpcs_[id] = PendingRpc{method, std::move(callback),
+                                       std::chrono::steady_clock::now() + timeout};
+        pending_count_ = pending_rpcs_.size();
+        schedule_rpc_sweep();
+        
+        enqueue_message(req.dump());
+    });
+}
+
+void ActuatorDriver::enqueue_message(std::string msg) {
+    // websocket 同一时刻只允许一个 async_write; 请求依次写出, 但不等待前一个响应
+    send_queue_.push_back(std::move(msg));
+    send_queue_size_ = send_queue_.size();
+    if (send_queue_.size() == 1) {
+        do_write();
+    }
+}
+
+void ActuatorDriver::enqueue_urgent_message(std::string msg) {
+    // 正在写出的队首不能打断, 插在它之后
+    auto pos = write_in_flight_ ? std::next(send_queue_.begin()) : send_queue_.begin();
+    send_queue_.insert(pos, std::move(msg));
+    send_queue_size_ = send_queue_.size();
+    if (!write_in_flight_) {
+        do_write();
+    }
+}
+
+void ActuatorDriver::emergency_stop(EmergencyStopCallback callback) {
+    static core::Histogram& stop_latency = core::MetricsRegistry::instance().histogram(
+        "emergency_stop_latency_seconds",
+        "Time from an emergency stop request to the first Moonraker acknowledgement");
+    
+    ++emergency_stops_;
+    
+    // 两条通道共享; 第一条确认完成回调, 两条都失败才报告失败
+    struct Attempt {
+        uint64_t start_ns = core::mono_ns();
+        std::atomic<bool> done{false};
+        std::atomic<int> outstanding{2};
+        EmergencyStopCallback callback;
+    };
+    auto attempt = std::make_shared<Attempt>();
+    attempt->callback = std::move(callback);
+    
+    auto on_lane_result = [this, self = shared_from_this(), attempt](const char* lane, const RpcResult& rpc) {
+        if (rpc.ok) {
+            if (attempt->done.exchange(true)) return;
+            EmergencyStopResult result;
+            result.ok = true;
+            result.lane = lane;
+            result.latency_us = (core::mono_ns() - attempt->start_ns) / 1000;
+            last_emergency_stop_latency_us_ = result.latency_us;
+            stop_latency.observe(static_cast<double>(result.latency_us) / 1e6);
+            spdlog::warn("ActuatorDriver: Emergency stop acknowledged via {} after {}us",
+                         lane, result.latency_us);
+            if (attempt->callback) attempt->callback(result);
+            return;
+        }
+        // 另一条通道已确认后, 这条的失败 (例如 Klipper 已处于 shutdown) 无关紧要
+        if (!attempt->done) {
+            spdlog::error("ActuatorDriver: Emergency stop via {} failed: {}", lane, rpc.error);
+        }
+        if (attempt->outstanding.fetch_sub(1) != 1 || attempt->done.exchange(true)) return;
+        ++emergency_stop_failures_;
+        EmergencyStopResult result;
+        result.error = rpc.error;
+        if (attempt->callback) attempt->callback(result);
+    };
+    
+    if (emergency_link_) {
+        emergency_link_->trigger([on_lane_result](const RpcResult& rpc) {
+            on_lane_result("emergency_link", rpc);
+        });
+    } else {
+        RpcResult missing;
+        missing.error = "no emergency link";
+        on_lane_result("emergency_link", missing);
+    }
+    
+    // 主连接: 不进入 G-code 合并批次, 直接插到写队列最前
+    net::post(strand_, [this, self = shared_from_this(), on_lane_result]() {
+        if (!connected_) {
+            RpcResult result;
+            result.error = "not connected";
+            on_lane_result("primary", result);
+            return;
         }
+        int id = rpc_id_++;
+        nlohmann::json req;
+        req["jsonrpc"] = "2.0";
+        req["method"] = "printer.emergency_stop";
+        req["id"] = id;
+        pending_rpcs_[id] = PendingRpc{"printer.emergency_stop",
+            [on_lane_result](const RpcResult& result) { on_lane_result("primary", result); },
+            std::chrono::steady_clock::now() + EMERGENCY_STOP_TIMEOUT};
+        pending_count_ = pending_rpcs_.size();
+        schedule_rpc_sweep();
+        enqueue_urgent_message(req.dump());
+    });
+}
 
-        std::string msg = req.dump();
-        
-        send_queue_.push(msg);
-        if (send_queue_.size() == 1) {
-            do_write();
+void ActuatorDriver::schedule_rpc_sweep() {
+    if (rpc_sweep_scheduled_ || pending_rpcs_.empty()) return;
+    rpc_sweep_scheduled_ = true;
+    
+    // 一个共享定时器扫描截止时间, 避免每个请求单独分配定时器
+    rpc_sweep_timer_.expires_after(std::chrono::milliseconds(250));
+    rpc_sweep_timer_.async_wait([this, self = shared_from_this()](beast::error_code ec) {
+        rpc_sweep_scheduled_ = false;
+        if (ec) return;
+        sweep_expired_rpcs();
+        schedule_rpc_sweep();
+    });
+}
+
+void ActuatorDriver::sweep_expired_rpcs() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::pair<int, PendingRpc>> expired;
+    for (auto it = pending_rpcs_.begin(); it != pending_rpcs_.end();) {
+        if (it->second.deadline <= now) {
+            expired.emplace_back(it->first, std::move(it->second));
+            it = pending_rpcs_.erase(it);
+        } else {
+            ++it;
         }
+    }
+    pending_count_ = pending_rpcs_.size();
+    
+    for (auto& [id, pending] : expired) {
+        spdlog::warn("ActuatorDriver: RPC[{}] {} timed out", id, pending.method);
+        if (pending.callback) {
+            RpcResult result;
+            result.error = "timeout";
+            pending.callback(result);
+        }
+    }
+}
+
+void ActuatorDriver::fail_pending_rpcs(const std::string& reason) {
+    auto pending = std::move(pending_rpcs_);
+    pending_rpcs_.clear();
+    pending_count_ = 0;
+    rpc_sweep_timer_.cancel();
+    
+    if (!pending.empty()) {
+        spdlog::warn("ActuatorDriver: Cancelling {} pending RPCs: {}", pending.size(), reason);
+    }
+    for (auto& [id, rpc] : pending) {
+        if (rpc.callback) {
+            RpcResult result;
+            result.error = reason;
+            rpc.callback(result);
+        }
+    }
+}
+
+void ActuatorDriver::on_disconnected(const std::string& reason) {
+    if (!connected_) return;
+    connected_ = false;
+    disconnected_at_ = std::chrono::steady_clock::now();
+    printer_info_timer_.cancel();
+    beast::error_code ignored;
+    beast::get_lowest_layer(*ws_).socket().close(ignored);
+    
+    // 未写出的请求和在途请求都不会再有响应; 正在写出的那条由写回调负责弹出
+    if (write_in_flight_ && !send_queue_.empty()) {
+        send_queue_.erase(std::next(send_queue_.begin()), send_queue_.end());
+    } else {
+        send_queue_.clear();
+    }
+    send_queue_size_ = send_queue_.size();
+    fail_pending_rpcs(reason);
+    
+    on_connection_changed(false);
+    schedule_reconnect();
+}
+
+void ActuatorDriver::send_gcode(const std::string& gcode, bool silent) {
+    if (!connected_) return;
+
+    if (!silent) {
+        spdlog::info("ActuatorDriver: send: {}", gcode);
+    }
+    // 不关心结果, 错误和超时仍由 handle_response / sweep 记录
+    net::post(strand_, [this, self = shared_from_this(), gcode]() {
+        enqueue_gcode(gcode, nullptr, DEFAULT_GCODE_TIMEOUT);
     });
 }
 
-void ActuatorDriver::subscribe_objects() {
-    // Subscribe to heater_bed (simulated weight sensor sometimes attached here or sensors), 
-    // and potentially other objects
-    nlohmann::json req;
-    req["jsonrpc"] = "2.0";
-    req["method"] = "printer.objects.subscribe";
+void ActuatorDriver::send_gcode_batch(std::vector<std::string> lines, bool silent) {
+    if (!connected_ || lines.empty()) return;
+
+    if (!silent) {
+        for (const auto& line : lines) {
+            spdlog::info("ActuatorDriver: send: {}", line);
+        }
+    }
+    net::post(strand_, [this, self = shared_from_this(), lines = std::move(lines)]() mutable {
+        for (auto& line : lines) {
+            enqueue_gcode(std::move(line), nullptr, DEFAULT_GCODE_TIMEOUT);
+        }
+    });
+}
+
+std::future<RpcResult> ActuatorDriver::send_gcode_async(const std::string& gcode,
+                                                        std::chrono::milliseconds timeout,
+                                                        bool silent) {
+    auto promise = std::make_shared<std::promise<RpcResult>>();
+    auto future = promise->get_future();
     
-    // Subscribe to everything relevant
-    nlohmann::json objects;
-    objects["heaters"] = nullptr;
-    objects["display_status"] = nullptr;
-    objects["load_cell my_hx711"] = nullptr;  // 称重传感器 
+    if (!silent) {
+        spdlog::info("ActuatorDriver: send (await): {}", gcode);
+    }
+    net::post(strand_, [this, self = shared_from_this(), gcode, promise, timeout]() {
+        enqueue_gcode(gcode, [promise](const RpcResult& result) { promise->set_value(result); }, timeout);
+    });
+    return future;
+}
+
+void ActuatorDriver::enqueue_gcode(std::string script, RpcCallback callback,
+                                   std::chrono::milliseconds timeout) {
+    // 被覆盖的 SET_PIN: 仅在中间没有其他命令时合并, 不改变与运动等命令的先后关系
+    auto pin = set_pin_name(script);
+    if (!pin.empty()) {
+        for (auto it = gcode_batch_.rbegin(); it != gcode_batch_.rend(); ++it) {
+            auto other = set_pin_name(it->script);
+            if (other.empty()) break;
+            if (other == pin && !it->callback) {
+                gcode_batch_.erase(std::next(it).base());
+                break;
+            }
+        }
+    }
     
-    req["params"] = {{"objects", objects}};
-    req["id"] = rpc_id_++;
+    gcode_batch_.push_back(GcodeEntry{std::move(script), std::move(callback), timeout});
+    
+    // 本轮已投递的 send_gcode 都会先于 flush 入队
+    if (!gcode_flush_scheduled_) {
+        gcode_flush_scheduled_ = true;
+        net::post(strand_, [this, self = shared_from_this()]() { flush_gcode_batch(); });
+    }
+}
 
-    std::string msg = req.dump();
-    send_queue_.push(msg);
-    if (send_queue_.size() == 1) {
-        do_write();
+void ActuatorDriver::flush_gcode_batch() {
+    gcode_flush_scheduled_ = false;
+    if (gcode_batch_.empty()) return;
+    
+    auto batch = std::move(gcode_batch_);
+    gcode_batch_.clear();
+    
+    std::string script;
+    std::chrono::milliseconds timeout{0};
+    std::vector<RpcCallback> callbacks;
+    for (auto& entry : batch) {
+        if (!script.empty()) script += '\n';
+        script += entry.script;
+        timeout = std::max(timeout, entry.timeout);
+        if (entry.callback) callbacks.push_back(std::move(entry.callback));
+    }
+    if (batch.size() > 1) {
+        spdlog::debug("ActuatorDriver: Batched {} G-code lines into one script", batch.size());
     }
+    
+    RpcCallback done = nullptr;
+    if (!callbacks.empty()) {
+        done = [callbacks = std::move(callbacks)](const RpcResult& result) {
+            for (const auto& cb : callbacks) cb(result);
+        };
+    }
+    call("printer.gcode.script", {{"script", std::move(script)}}, std::move(done), timeout);
+}
+
+void ActuatorDriver::send_background_gcode(const std::string& gcode) {
+    if (!connected_) return;
+    
+    net::post(strand_, [this, self = shared_from_this(), gcode]() {
+        background_gcode_ = gcode;
+        if (!background_in_flight_) {
+            send_background_next();
+        }
+    });
+}
+
+void ActuatorDriver::send_background_next() {
+    if (!background_gcode_ || !connected_) {
+        background_in_flight_ = false;
+        return;
+    }
+    
+    background_in_flight_ = true;
+    std::string script = std::move(*background_gcode_);
+    background_gcode_.reset();
+    call("printer.gcode.script", {{"script", std::move(script)}},
+        [this](const RpcResult&) { send_background_next(); },
+        DEFAULT_RPC_TIMEOUT);
+}
+
+void ActuatorDriver::subscribe_objects() {
+    nlohmann::json objects = nlohmann::json::object();
+    for (const auto& name : subscribed_objects_) {
+        objects[name] = nullptr;
+    }
+    
+    // 订阅响应携带当前完整状态, 之后只推送变化的字段
+    call("printer.objects.subscribe", {{"objects", objects}},
+        [this](const RpcResult& result) {
+            if (result.ok && result.result.contains("status")) {
+                on_status_update(result.result["status"]);
+            }
+        });
+}
+
+void ActuatorDriver::add_subscription(const std::string& object_name) {
+    net::post(strand_, [this, self = shared_from_this(), object_name]() {
+        if (!subscribed_objects_.insert(object_name).second) return;
+        spdlog::info("ActuatorDriver: Subscribing to '{}'", object_name);
+        if (connected_) {
+            subscribe_objects();
+        }
+    });
 }
 
 void ActuatorDriver::do_write() {
     if (send_queue_.empty()) return;
 
-    ws_.async_write(net::buffer(send_queue_.front()),
-        [this, self = shared_from_this()](beast::error_code ec, std::size_t /*bytes*/) {
+    write_in_flight_ = true;
+    ws_->async_write(net::buffer(send_queue_.front()),
+        [this, self = shared_from_this(), gen = gen_](beast::error_code ec, std::size_t /*bytes*/) {
+            // 旧连接的写回调: 队列已在重连握手时清空
+            if (gen != gen_) return;
+            write_in_flight_ = false;
+            send_queue_.pop_front();
+            send_queue_size_ = send_queue_.size();
             if (ec) {
                 spdlog::error("ActuatorDriver: Write failed: {}", ec.message());
+                on_disconnected("写入失败: " + ec.message());
                 return;
             }
             
-            send_queue_.pop();
-            if (!send_queue_.empty()) {
+            if (connected_ && !send_queue_.empty()) {
                 do_write();
             }
         });
@@ -229,41 +650,33 @@ void ActuatorDriver::query_object(const std::string& object_name,
         return;
     }
     
-    nlohmann::json req;
-    req["jsonrpc"] = "2.0";
-    req["method"] = "printer.objects.query";
-    
     nlohmann::json objects;
     objects[object_name] = nullptr;
     
-    req["params"] = {{"objects", objects}};
-    int id = rpc_id_++;
-    req["id"] = id;
-    
-    // 注册回调
-    rpc_callbacks_[id] = std::move(callback);
-    
-    std::string msg = req.dump();
-    send_queue_.push(msg);
-    if (send_queue_.size() == 1) {
-        do_write();
-    }
+    // 回调沿用原始响应格式 ({"result": {...}}), 失败时不回调
+    call("printer.objects.query", {{"objects", objects}},
+        [callback = std::move(callback)](const RpcResult& result) {
+            if (result.ok && callback) {
+                callback(nlohmann::json{{"result", result.result}});
+            }
+        });
 }
 
 void ActuatorDriver::query_printer_info() {
     if (!connected_) return;
     
-    nlohmann::json req;
-    req["jsonrpc"] = "2.0";
-    req["method"] = "printer.info";
-    printer_info_rpc_id_ = rpc_id_++;
-    req["id"] = printer_info_rpc_id_;
-    
-    std::string msg = req.dump();
-    send_queue_.push(msg);
-    if (send_queue_.size() == 1) {
-        do_write();
-    }
+    call("printer.info", nullptr, [this](const RpcResult& result) {
+        if (result.ok && result.result.contains("state")) {
+            std::string state = result.result["state"].get<std::string>();
+            bool ready = (state == "ready");
+            bool was_ready = firmware_ready_.exchange(ready);
+            if (was_ready != ready) {
+                spdlog::info("ActuatorDriver: Klipper state changed to '{}', firmware_ready={}", state, ready);
+            }
+        }
+        // 成功或超时都安排下一次查询 (断线时 connected_ 为 false, 不再继续)
+        schedule_printer_info_query();
+    }, std::chrono::seconds(5));
 }
 
 void ActuatorDriver::schedule_printer_info_query() {
@@ -280,7 +693,7 @@ void ActuatorDriver::start_breathing_led() {
     
     breathing_led_running_ = true;
     breathing_led_phase_ = 0.0f;
-    breathing_led_timer_ = std::make_unique<net::steady_timer>(io_);
+    breathing_led_timer_ = std::make_unique<net::steady_timer>(strand_);
     
     spdlog::info("ActuatorDriver: Starting breathing LED");
     breathing_led_tick();
@@ -307,9 +720,9 @@ void ActuatorDriver::breathing_led_tick() {
     // 最小亮度 0.1，避免完全熄灭
     value = 0.1f + value * 0.9f;
     
-    // 发送 G-code 设置 LED 亮度 (静默模式，不输出日志)
+    // 发送 G-code 设置 LED 亮度 (低优先级，不进入合并批次，不输出日志)
     std::string gcode = std::format("SET_PIN PIN=estop_led VALUE={:.2f}", value);
-    send_gcode(gcode, true);
+    send_background_gcode(gcode);
     
     // 更新相位 (每次增加约 0.157 弧度，约 40 步完成一个周期)
     breathing_led_phase_ += 0.157f;
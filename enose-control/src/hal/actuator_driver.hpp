@@ -4,13 +4,20 @@
 #include <boost/beast/websocket.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/signals2.hpp>
 #include <nlohmann/json.hpp>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
-#include <queue>
+#include <deque>
 #include <functional>
 #include <unordered_map>
+#include <set>
+#include <optional>
+#include <vector>
+#include <atomic>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -20,30 +27,131 @@ using tcp = net::ip::tcp;
 
 namespace hal {
 
+/**
+ * @brief JSON-RPC 调用结果
+ */
+struct RpcResult {
+    bool ok = false;
+    nlohmann::json result;          // 成功时为响应中的 "result"
+    std::string error;              // 失败原因 (Moonraker error / 超时 / 断线)
+};
+
+class EmergencyStopLink;
+
+/**
+ * @brief 急停结果: 第一条确认到达的通道
+ */
+struct EmergencyStopResult {
+    bool ok = false;
+    std::string lane;               // "emergency_link" / "primary"
+    uint64_t latency_us = 0;        // emergency_stop() 调用到 Moonraker 确认
+    std::string error;              // 两条通道都失败时的原因
+};
+
 class ActuatorDriver : public std::enable_shared_from_this<ActuatorDriver> {
 public:
+    using RpcCallback = std::function<void(const RpcResult&)>;
+    static constexpr std::chrono::milliseconds DEFAULT_RPC_TIMEOUT{10000};
+    static constexpr std::chrono::milliseconds DEFAULT_GCODE_TIMEOUT{60000};
+
     ActuatorDriver(net::io_context& io);
     ~ActuatorDriver();
 
+    /**
+     * @brief 连接状态统计
+     */
+    struct LinkStats {
+        bool connected = false;
+        uint32_t reconnects = 0;                // 断线后成功重连的次数
+        uint32_t last_reconnect_latency_ms = 0; // 最近一次断线到重新握手完成的时间
+        uint32_t connect_attempts = 0;
+        std::size_t send_queue = 0;             // 待写出的 websocket 消息数
+        std::size_t pending_rpcs = 0;           // 已发出未收到响应的 RPC
+        bool emergency_link_connected = false;  // 急停专用连接
+        uint64_t emergency_stops = 0;
+        uint64_t emergency_stop_failures = 0;   // 两条通道都未确认
+        uint64_t last_emergency_stop_latency_us = 0;
+    };
+
     /**
      * @brief Connect to Moonraker WebSocket
+     *
+     * 连接失败或断开后按退避 (250ms 起, 翻倍至 10s) 自动重连; 重连后重新订阅对象,
+     * 并通过 on_connection_changed(true) 让上层重放期望状态.
      * @param host IP address (e.g. "127.0.0.1")
      * @param port Port (e.g. "7125")
      */
     void connect(const std::string& host, const std::string& port);
 
+    /**
+     * @brief 急停专用连接, 须在 connect() 之前设置; connect() 时一并连接
+     */
+    void set_emergency_link(std::shared_ptr<EmergencyStopLink> link);
+
+    using EmergencyStopCallback = std::function<void(const EmergencyStopResult&)>;
+
+    /**
+     * @brief 急停 (printer.emergency_stop, Klipper 立即进入 shutdown, 不经 G-code 队列)
+     *
+     * 同时走两条通道, 以先确认的为准:
+     * - 急停专用连接: 与主连接的写队列和 strand 完全独立;
+     * - 主连接的优先通道: 插到写队列最前 (只排在正在写出的一条之后).
+     * 可从任意线程调用; 回调只调用一次, 在确认到达的连接的 strand 上执行.
+     */
+    void emergency_stop(EmergencyStopCallback callback = nullptr);
+
     /**
      * @brief Send G-code command via JSON-RPC
+     *
+     * 同一 io 轮次内提交的命令合并为一条多行 printer.gcode.script; 相邻的同一引脚
+     * SET_PIN 只保留最后一次. 注意 Klipper 遇到出错的行会跳过脚本剩余部分.
      * @param silent If true, don't log the command (for high-frequency commands like breathing LED)
      */
     void send_gcode(const std::string& gcode, bool silent = false);
 
+    /**
+     * @brief 一组命令保证进入同一批次 (例如一次状态切换的全部阀门/泵命令)
+     */
+    void send_gcode_batch(std::vector<std::string> lines, bool silent = false);
+
+    /**
+     * @brief 低优先级 G-code (呼吸灯等动画)
+     *
+     * 不进入合并批次, 同一时刻最多一条在途; 在途期间的新命令只保留最新一条.
+     */
+    void send_background_gcode(const std::string& gcode);
+
+    /**
+     * @brief 发送 G-code 并等待 Moonraker 确认 (Klipper 执行完该脚本后才响应)
+     * @param timeout 超时后 future 以 ok=false 完成
+     */
+    std::future<RpcResult> send_gcode_async(const std::string& gcode,
+                                            std::chrono::milliseconds timeout = DEFAULT_GCODE_TIMEOUT,
+                                            bool silent = false);
+
+    /**
+     * @brief 通用 JSON-RPC 调用 (线程安全)
+     *
+     * 请求不等待前一个响应即可发出, 多个请求同时在途; 每个请求有独立截止时间,
+     * 超时或断线时回调以 ok=false 完成. 回调在驱动的 strand 上执行.
+     */
+    void call(const std::string& method, nlohmann::json params, RpcCallback callback,
+              std::chrono::milliseconds timeout = DEFAULT_RPC_TIMEOUT);
+
     /**
      * @brief Subscribe to object model updates
-     * @param objects List of objects to subscribe to (e.g., "heater_bed", "toolhead")
+     *
+     * 订阅集合包含默认对象和 add_subscription() 注册的对象. Moonraker 的订阅按连接整体替换,
+     * 因此每次都发送完整集合; 响应中的初始快照同样通过 on_status_update 发出.
      */
     void subscribe_objects();
 
+    /**
+     * @brief 将对象加入推送订阅 (已连接时立即重新订阅)
+     * @param object_name Object name (e.g., "load_cell my_hx711")
+     */
+    void add_subscription(const std::string& object_name);
+
     /**
      * @brief Query a specific Klipper object
      * @param object_name Object name (e.g., "load_cell my_hx711")
@@ -52,11 +160,18 @@ public:
     void query_object(const std::string& object_name, 
                       std::function<void(const nlohmann::json&)> callback);
 
+    /** @brief 在途 RPC 数量 */
+    std::size_t pending_rpc_count() const { return pending_count_; }
+
     /**
      * @brief Check if Klipper firmware is ready (not in shutdown state)
      */
     bool is_firmware_ready() const { return firmware_ready_; }
 
+    bool is_connected() const { return connected_; }
+
+    LinkStats link_stats() const;
+
     /**
      * @brief Start breathing LED effect on estop_led pin
      */
@@ -72,33 +187,103 @@ public:
      */
     boost::signals2::signal<void(const nlohmann::json&)> on_status_update;
 
+    /**
+     * @brief 连接建立/断开 (驱动的 strand). 重连成功时上层应重放外设状态
+     */
+    boost::signals2::signal<void(bool)> on_connection_changed;
+
+    /**
+     * @brief 连接未断开时 Klipper 重新进入 ready (notify_klippy_ready, 驱动的 strand).
+     *        引脚已回到 printer.cfg 初始值, 上层应与重连时一样重放外设状态
+     */
+    boost::signals2::signal<void()> on_firmware_ready;
+
 private:
     void breathing_led_tick();
-    void on_resolve(beast::error_code ec, tcp::resolver::results_type results);
-    void on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type ep);
-    void on_handshake(beast::error_code ec);
+    void start_connect();
+    void schedule_reconnect();
+    void on_resolve(uint64_t gen, beast::error_code ec, tcp::resolver::results_type results);
+    void on_connect(uint64_t gen, beast::error_code ec, tcp::resolver::results_type::endpoint_type ep);
+    void on_handshake(uint64_t gen, beast::error_code ec);
     void do_read();
-    void on_read(beast::error_code ec, std::size_t bytes_transferred);
+    void on_read(uint64_t gen, beast::error_code ec, std::size_t bytes_transferred);
     void send_next();
     void do_write();
+    void enqueue_message(std::string msg);
+    void enqueue_urgent_message(std::string msg);
+    void enqueue_gcode(std::string script, RpcCallback callback, std::chrono::milliseconds timeout);
+    void flush_gcode_batch();
+    void send_background_next();
+    void handle_response(const nlohmann::json& j);
+    void fail_pending_rpcs(const std::string& reason);
+    void schedule_rpc_sweep();
+    void sweep_expired_rpcs();
+    void on_disconnected(const std::string& reason);
     void query_printer_info();
     void schedule_printer_info_query();
 
     net::io_context& io_;
-    websocket::stream<beast::tcp_stream> ws_;
+    // 连接、定时器与全部内部状态都在这个 strand 上, 与其他驱动共用 io 线程池
+    net::strand<net::io_context::executor_type> strand_;
+    // 每次连接重新创建 stream; gen_ 区分旧连接遗留的回调
+    std::optional<websocket::stream<beast::tcp_stream>> ws_;
+    uint64_t gen_{0};
     tcp::resolver resolver_;
     std::string host_;
+    std::string port_;
+    
+    // 重连
+    net::steady_timer reconnect_timer_;
+    std::chrono::milliseconds reconnect_delay_{250};
+    static constexpr std::chrono::milliseconds RECONNECT_DELAY_MIN{250};
+    static constexpr std::chrono::milliseconds RECONNECT_DELAY_MAX{10000};
+    std::optional<std::chrono::steady_clock::time_point> disconnected_at_;
+    std::atomic<uint32_t> reconnects_{0};
+    std::atomic<uint32_t> last_reconnect_latency_ms_{0};
+    std::atomic<uint32_t> connect_attempts_{0};
     beast::flat_buffer buffer_;
     
-    std::queue<std::string> send_queue_;
+    std::deque<std::string> send_queue_;
+    std::atomic<std::size_t> send_queue_size_{0};  // send_queue_ 长度的镜像, 供其他线程读取
+    
+    // 急停
+    static constexpr std::chrono::milliseconds EMERGENCY_STOP_TIMEOUT{1000};
+    std::shared_ptr<EmergencyStopLink> emergency_link_;
+    std::atomic<uint64_t> emergency_stops_{0};
+    std::atomic<uint64_t> emergency_stop_failures_{0};
+    std::atomic<uint64_t> last_emergency_stop_latency_us_{0};
     net::steady_timer printer_info_timer_;
     int rpc_id_{1};
-    int printer_info_rpc_id_{-1};  // 用于识别 printer.info 响应
-    bool connected_{false};
-    bool firmware_ready_{true};  // Klipper 固件状态 (shutdown 后为 false)
+    std::atomic<bool> connected_{false};
+    bool write_in_flight_{false};
+    std::atomic<bool> firmware_ready_{true};  // Klipper 固件状态 (shutdown 后为 false)
+    
+    // 推送订阅的对象集合
+    std::set<std::string> subscribed_objects_{"heaters", "display_status"};
+    
+    // 在途 RPC: id -> 回调和截止时间 (只在 strand 上访问)
+    struct PendingRpc {
+        std::string method;
+        RpcCallback callback;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::unordered_map<int, PendingRpc> pending_rpcs_;
+    std::atomic<std::size_t> pending_count_{0};
+    net::steady_timer rpc_sweep_timer_;
+    bool rpc_sweep_scheduled_{false};
+    
+    // G-code 合并批次 (只在 strand 上访问)
+    struct GcodeEntry {
+        std::string script;
+        RpcCallback callback;
+        std::chrono::milliseconds timeout;
+    };
+    std::vector<GcodeEntry> gcode_batch_;
+    bool gcode_flush_scheduled_{false};
     
-    // RPC 回调存储
-    std::unordered_map<int, std::function<void(const nlohmann::json&)>> rpc_callbacks_;
+    // 低优先级命令: 最多一条在途, 其余只保留最新
+    std::optional<std::string> background_gcode_;
+    bool background_in_flight_{false};
     
     // 呼吸灯控制
     std::unique_ptr<net::steady_timer> breathing_led_timer_;
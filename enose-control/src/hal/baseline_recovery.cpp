@@ -0,0 +1,59 @@
+#include "hal/baseline_recovery.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hal {
+
+void BaselineRecoveryMonitor::update(const StepFrame& frame, const BaselineTracker& tracker) {
+    FrameDeviation d;
+    d.seq = frame.seq;
+    float worst = -1.0f;
+    for (const auto& sample : frame.samples) {
+        const float deviation = tracker.deviation(sample);
+        if (!std::isfinite(deviation)) continue;
+        ++d.channels;
+        if (deviation > worst) {
+            worst = deviation;
+            d.worst_type = sample.type;
+            d.worst_sensor = sample.sensor_idx;
+        }
+    }
+    d.max_deviation = d.channels > 0 ? worst : std::numeric_limits<float>::quiet_NaN();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        history_[count_ % HISTORY] = d;
+        ++count_;
+        if (d.channels > 0) has_baselines_ = true;
+    }
+    on_update();
+}
+
+uint64_t BaselineRecoveryMonitor::last_seq() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_ == 0 ? 0 : history_[(count_ - 1) % HISTORY].seq;
+}
+
+bool BaselineRecoveryMonitor::recovered_since(uint64_t after_seq, float tolerance, std::size_t frames,
+                                              FrameDeviation* latest) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ == 0) return false;
+    if (latest) *latest = history_[(count_ - 1) % HISTORY];
+
+    frames = std::max<std::size_t>(1, std::min(frames, HISTORY));
+    if (count_ < frames) return false;
+    for (std::size_t i = 1; i <= frames; ++i) {
+        const auto& d = history_[(count_ - i) % HISTORY];
+        // NaN 比较为 false: 无已预热通道的帧不算恢复
+        if (d.seq <= after_seq || !(d.max_deviation <= tolerance)) return false;
+    }
+    return true;
+}
+
+bool BaselineRecoveryMonitor::has_baselines() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return has_baselines_;
+}
+
+} // namespace hal
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "hal/baseline_tracker.hpp"
+#include "hal/step_frame_assembler.hpp"
+#include <boost/signals2.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace hal {
+
+/**
+ * @brief 各传感器读数是否已回到存储的基线 (清洗自适应终止的判据)
+ *
+ * 每个加热步帧在 io 线程上调用 update(): 对帧内每个已预热的通道按
+ * BaselineTracker::deviation() 求相对偏离, 记录该帧的最大偏离 (偏离最大的传感器一并记录).
+ * 最近 HISTORY 帧保存在环形缓冲中; 等待方 (实验线程) 在 on_update 唤醒时调用
+ * recovered_since() 判断某一时刻之后是否已有连续 frames 帧全部在容差内.
+ *
+ * 没有已预热通道的帧最大偏离为 NaN, 视为未恢复.
+ */
+class BaselineRecoveryMonitor {
+public:
+    static constexpr std::size_t HISTORY = 64;
+
+    struct FrameDeviation {
+        uint64_t seq = 0;               // StepFrame.seq
+        float max_deviation = 0.0f;
+        uint16_t channels = 0;          // 参与判定的通道数
+        SensorType worst_type = SensorType::UNKNOWN;
+        uint8_t worst_sensor = 0;
+    };
+
+    /** @brief 用一帧原始读数和当前基线更新 (io 线程) */
+    void update(const StepFrame& frame, const BaselineTracker& tracker);
+
+    /** @brief 最近一帧的 seq (尚无帧时为 0); 等待开始时记下, 之后的帧才计入 */
+    uint64_t last_seq() const;
+
+    /**
+     * @brief seq 大于 after_seq 的帧中, 最近的 frames 帧是否全部在容差内
+     * @param latest 可选: 最近一帧的偏离 (用于日志)
+     */
+    bool recovered_since(uint64_t after_seq, float tolerance, std::size_t frames,
+                         FrameDeviation* latest = nullptr) const;
+
+    /** @brief 曾经见过已预热的通道 (否则无法判定, 调用方应退回固定次数) */
+    bool has_baselines() const;
+
+    /** @brief 每帧 update 之后发出 (io 线程) */
+    boost::signals2::signal<void()> on_update;
+
+private:
+    mutable std::mutex mutex_;
+    std::array<FrameDeviation, HISTORY> history_{};
+    std::size_t count_ = 0;             // 已写入的帧数 (环形缓冲下标 = count_ % HISTORY)
+    bool has_baselines_ = false;
+};
+
+} // namespace hal
@@ -0,0 +1,115 @@
+#include "hal/baseline_tracker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hal {
+
+BaselineTracker::BaselineTracker(BaselineConfig config)
+    : config_(config)
+    , channels_(std::make_unique<std::array<Channel, SLOTS>>()) {}
+
+BaselineTracker::~BaselineTracker() = default;
+
+int BaselineTracker::slot_of(SensorType type, uint8_t sensor_idx, uint8_t heater_step) {
+    if (type == SensorType::UNKNOWN || sensor_idx >= MAX_SENSORS) return -1;
+    // 只有 MOX_DIGITAL 的读数按加热步区分, 其余类型 heater_step 恒为 0
+    const std::size_t step = type == SensorType::MOX_DIGITAL ? heater_step : 0;
+    if (step >= MAX_HEATER_STEPS) return -1;
+    return static_cast<int>(static_cast<std::size_t>(type) * SLOTS_PER_TYPE +
+                            sensor_idx * MAX_HEATER_STEPS + step);
+}
+
+int BaselineTracker::slot_of(const SensorSample& sample) {
+    return slot_of(sample.type, sample.sensor_idx, sample.heater_step);
+}
+
+BaselineTracker::Entry BaselineTracker::entry_at(std::size_t slot, const Channel& channel) {
+    Entry entry;
+    entry.type = static_cast<SensorType>(slot / SLOTS_PER_TYPE);
+    entry.sensor_idx = static_cast<uint8_t>((slot % SLOTS_PER_TYPE) / MAX_HEATER_STEPS);
+    entry.heater_step = static_cast<uint8_t>(slot % MAX_HEATER_STEPS);
+    entry.baseline = channel.baseline;
+    entry.reference = channel.reference;
+    entry.samples = channel.samples;
+    return entry;
+}
+
+void BaselineTracker::load(std::span<const Entry> entries) {
+    auto& channels = *channels_;
+    for (const auto& entry : entries) {
+        const int s = slot_of(entry.type, entry.sensor_idx, entry.heater_step);
+        if (s < 0 || !std::isfinite(entry.baseline) || entry.baseline == 0.0) continue;
+        auto& ch = channels[s];
+        ch.baseline = static_cast<float>(entry.baseline);
+        ch.reference = static_cast<float>(entry.reference);
+        ch.samples = entry.samples;
+        ch.dirty = false;
+    }
+}
+
+void BaselineTracker::learn(const StepFrame& frame) {
+    auto& channels = *channels_;
+    for (const auto& sample : frame.samples) {
+        const int s = slot_of(sample);
+        if (s < 0 || !std::isfinite(sample.value)) continue;
+        auto& ch = channels[s];
+
+        if (ch.samples == 0) {
+            ch.baseline = sample.value;
+        } else {
+            const float limit = config_.clip * std::fabs(ch.baseline);
+            const float innovation = std::clamp(sample.value - ch.baseline, -limit, limit);
+            ch.baseline += config_.alpha * innovation;
+        }
+        ++ch.samples;
+        if (ch.reference == 0.0f && ch.samples >= config_.warmup_samples) {
+            ch.reference = ch.baseline;
+        }
+        ch.dirty = true;
+    }
+}
+
+float BaselineTracker::correct(const SensorSample& sample) const {
+    const int s = slot_of(sample);
+    if (s < 0) return sample.value;
+    const auto& ch = (*channels_)[s];
+    if (ch.reference == 0.0f || ch.baseline == 0.0f) return sample.value;
+
+    if (sample.type == SensorType::PID) {
+        return sample.value - (ch.baseline - ch.reference);
+    }
+    return sample.value * (ch.reference / ch.baseline);
+}
+
+void BaselineTracker::correct(StepFrame& frame) const {
+    for (auto& sample : frame.samples) {
+        sample.value = correct(sample);
+    }
+}
+
+float BaselineTracker::deviation(const SensorSample& sample) const {
+    const int s = slot_of(sample);
+    if (s < 0 || !std::isfinite(sample.value)) return std::numeric_limits<float>::quiet_NaN();
+    const auto& ch = (*channels_)[s];
+    if (ch.reference == 0.0f || ch.baseline == 0.0f) return std::numeric_limits<float>::quiet_NaN();
+
+    float scale = std::fabs(ch.baseline);
+    if (sample.type == SensorType::PID) {
+        scale = std::max(scale, PID_DEVIATION_FLOOR);
+    }
+    return std::fabs(sample.value - ch.baseline) / scale;
+}
+
+std::vector<BaselineTracker::Entry> BaselineTracker::take_dirty() {
+    std::vector<Entry> out;
+    auto& channels = *channels_;
+    for (std::size_t s = 0; s < SLOTS; ++s) {
+        if (!channels[s].dirty) continue;
+        channels[s].dirty = false;
+        out.push_back(entry_at(s, channels[s]));
+    }
+    return out;
+}
+
+} // namespace hal
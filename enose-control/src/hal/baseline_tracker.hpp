@@ -0,0 +1,102 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include "hal/step_frame_assembler.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 基线跟踪参数
+ */
+struct BaselineConfig {
+    float alpha = 0.02f;            // EWMA 系数 (每个通道每条基线读数)
+    float clip = 0.05f;             // 单条读数对基线的修正上限 (相对当前基线), 抑制尖峰
+    uint32_t warmup_samples = 10;   // 达到后才锁定参考基线并开始校正
+};
+
+/**
+ * @brief 按 (传感器, 加热步) 跟踪基线并做漂移校正
+ *
+ * 只在基线阶段 (由调用方按 PhaseMarker 阶段名判定) 用读数更新基线: 受限幅的 EWMA,
+ * 单条读数最多把基线拉动 clip 比例, 进样残留等尖峰不会带偏基线.
+ * 每个通道首次完成预热时把当时的基线记为参考基线; 之后任意时刻的读数按
+ * 参考基线 / 当前基线 等比校正 (MOX 电阻与电压), PID 读数按零点差值平移.
+ * 基线和参考基线可导出/导入, 由服务层持久化, 进程重启后校正保持连续.
+ *
+ * 非线程安全, 应在同一线程 (SensorDriver 的 io 线程) 调用
+ */
+class BaselineTracker {
+public:
+    static constexpr std::size_t MAX_SENSORS = 64;
+    static constexpr std::size_t MAX_HEATER_STEPS = 16;
+
+    /**
+     * @brief 一个通道的持久化状态
+     */
+    struct Entry {
+        SensorType type = SensorType::UNKNOWN;
+        uint8_t sensor_idx = 0;
+        uint8_t heater_step = 0;
+        double baseline = 0.0;
+        double reference = 0.0;     // 0 表示尚未预热完成
+        uint64_t samples = 0;
+    };
+
+    explicit BaselineTracker(BaselineConfig config = {});
+    ~BaselineTracker();
+
+    /** @brief 替换跟踪参数 (配置热加载), 已学到的基线和参考基线保留 */
+    void set_config(const BaselineConfig& config) { config_ = config; }
+
+    /** @brief 导入持久化的状态 (启动时, 在第一帧之前) */
+    void load(std::span<const Entry> entries);
+
+    /** @brief 用基线阶段的一帧更新基线 */
+    void learn(const StepFrame& frame);
+
+    /**
+     * @brief 校正后的读数值; 通道未预热完成时原样返回
+     */
+    float correct(const SensorSample& sample) const;
+
+    /** @brief 把帧内所有读数替换为校正值 */
+    void correct(StepFrame& frame) const;
+
+    /**
+     * @brief 读数相对当前基线的偏离 |value - baseline| / |baseline|; 通道未预热完成时为 NaN
+     *
+     * PID 的洁净基线接近 0, 分母至少取 PID_DEVIATION_FLOOR (ppb)
+     */
+    float deviation(const SensorSample& sample) const;
+
+    static constexpr float PID_DEVIATION_FLOOR = 1000.0f;
+
+    /** @brief 上次调用以来有变化的通道 (调用后清除变化标记) */
+    std::vector<Entry> take_dirty();
+
+private:
+    static constexpr std::size_t SLOTS_PER_TYPE = MAX_SENSORS * MAX_HEATER_STEPS;
+    static constexpr std::size_t SLOTS = SLOTS_PER_TYPE * 3;
+
+    struct Channel {
+        float baseline = 0.0f;
+        float reference = 0.0f;
+        uint64_t samples = 0;
+        bool dirty = false;
+    };
+
+    static int slot_of(SensorType type, uint8_t sensor_idx, uint8_t heater_step);
+    static int slot_of(const SensorSample& sample);
+    static Entry entry_at(std::size_t slot, const Channel& channel);
+
+    BaselineConfig config_;
+    std::unique_ptr<std::array<Channel, SLOTS>> channels_;
+};
+
+} // namespace hal
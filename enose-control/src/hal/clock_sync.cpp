@@ -0,0 +1,148 @@
+#include "hal/clock_sync.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+namespace {
+
+constexpr uint64_t TICK_WRAP = uint64_t{1} << 32;
+constexpr uint64_t TICK_HALF = uint64_t{1} << 31;
+
+} // namespace
+
+bool ClockSync::add_exchange(int64_t host_send_us, uint64_t device_us, int64_t host_recv_us) {
+    const int64_t rtt = host_recv_us - host_send_us;
+    if (rtt <= 0 || rtt > MAX_RTT_US) {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        ++stats_.rejected;
+        return false;
+    }
+
+    // 设备时间倒退: 板子重启过, 旧样本与新时钟无关
+    if (count_ > 0 && device_us < last_device_us_) {
+        reset();
+    }
+    last_device_us_ = device_us;
+    note_reference_ms(device_us / 1000);
+
+    window_[next_] = {host_send_us + rtt / 2, device_us, rtt};
+    next_ = (next_ + 1) % WINDOW;
+    count_ = std::min(count_ + 1, WINDOW);
+    fit();
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    ++stats_.exchanges;
+    return true;
+}
+
+void ClockSync::fit() {
+    // RTT 最小的一半 (至少 MIN_FIT_SAMPLES 条) 参与拟合
+    std::array<const Exchange*, WINDOW> sorted{};
+    for (std::size_t i = 0; i < count_; ++i) {
+        sorted[i] = &window_[i];
+    }
+    std::sort(sorted.begin(), sorted.begin() + count_,
+              [](const Exchange* a, const Exchange* b) { return a->rtt_us < b->rtt_us; });
+    const std::size_t n = std::min(count_, std::max(MIN_FIT_SAMPLES, count_ / 2));
+
+    // 以最新样本为原点, 差值在 double 中保持微秒精度
+    const Exchange& newest = window_[(next_ + WINDOW - 1) % WINDOW];
+    anchor_device_us_ = newest.device_us;
+    anchor_host_us_ = newest.host_mid_us;
+
+    double mean_x = 0.0, mean_y = 0.0;
+    int64_t min_x = 0, max_x = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const int64_t x = static_cast<int64_t>(sorted[i]->device_us - anchor_device_us_);
+        mean_x += static_cast<double>(x);
+        mean_y += static_cast<double>(sorted[i]->host_mid_us - anchor_host_us_);
+        min_x = i == 0 ? x : std::min(min_x, x);
+        max_x = i == 0 ? x : std::max(max_x, x);
+    }
+    mean_x /= static_cast<double>(n);
+    mean_y /= static_cast<double>(n);
+
+    double slope = 1.0;
+    if (n >= MIN_FIT_SAMPLES && max_x - min_x >= MIN_FIT_SPAN_US) {
+        double sxx = 0.0, sxy = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double dx = static_cast<double>(static_cast<int64_t>(sorted[i]->device_us - anchor_device_us_)) - mean_x;
+            const double dy = static_cast<double>(sorted[i]->host_mid_us - anchor_host_us_) - mean_y;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if (sxx > 0.0 && std::abs(sxy / sxx - 1.0) <= MAX_SKEW) {
+            slope = sxy / sxx;
+        }
+    }
+    slope_ = slope;
+    intercept_us_ = mean_y - slope * mean_x;
+
+    double sq = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double x = static_cast<double>(static_cast<int64_t>(sorted[i]->device_us - anchor_device_us_));
+        const double r = static_cast<double>(sorted[i]->host_mid_us - anchor_host_us_) - (intercept_us_ + slope * x);
+        sq += r * r;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.synced = true;
+    stats_.offset_us = static_cast<double>(anchor_host_us_) + intercept_us_ - static_cast<double>(anchor_device_us_);
+    stats_.skew_ppm = (slope - 1.0) * 1e6;
+    stats_.residual_us = std::sqrt(sq / static_cast<double>(n));
+    stats_.min_rtt_us = static_cast<double>(sorted[0]->rtt_us);
+}
+
+std::optional<int64_t> ClockSync::to_host_us(uint64_t device_us) const {
+    if (count_ == 0) return std::nullopt;
+    const double dx = static_cast<double>(static_cast<int64_t>(device_us - anchor_device_us_));
+    return anchor_host_us_ + static_cast<int64_t>(std::llround(intercept_us_ + slope_ * dx));
+}
+
+uint64_t ClockSync::extend_tick_ms(uint32_t tick_ms) {
+    if (!has_reference_) {
+        note_reference_ms(tick_ms);
+        return tick_ms;
+    }
+    uint64_t candidate = (reference_ms_ & ~(TICK_WRAP - 1)) | tick_ms;
+    if (candidate + TICK_HALF < reference_ms_) {
+        candidate += TICK_WRAP;
+    } else if (candidate > reference_ms_ + TICK_HALF && candidate >= TICK_WRAP) {
+        candidate -= TICK_WRAP;
+    }
+    note_reference_ms(candidate);
+    return candidate;
+}
+
+void ClockSync::note_reference_ms(uint64_t device_ms) {
+    // 补发的旧读数不会把参考拉回去
+    if (!has_reference_ || device_ms > reference_ms_) {
+        reference_ms_ = device_ms;
+        has_reference_ = true;
+    }
+}
+
+void ClockSync::reset() {
+    count_ = 0;
+    next_ = 0;
+    last_device_us_ = 0;
+    slope_ = 1.0;
+    intercept_us_ = 0.0;
+    has_reference_ = false;
+    reference_ms_ = 0;
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats fresh;
+    fresh.exchanges = stats_.exchanges;
+    fresh.rejected = stats_.rejected;
+    fresh.resets = stats_.resets + 1;
+    stats_ = fresh;
+}
+
+ClockSync::Stats ClockSync::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+} // namespace hal
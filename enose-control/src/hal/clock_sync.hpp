@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace hal {
+
+/**
+ * @brief 主机-设备时钟同步: NTP 式往返测量 + 线性回归
+ *
+ * 每次往返主机在 t0 发出 sync, 设备回复自己的 64 位时间 dev_us, 主机在 t3 收到.
+ * 假设上下行延迟对称, dev_us 对应主机单调时间 (t0 + t3) / 2, 误差不超过 RTT / 2.
+ * 保留最近 WINDOW 次往返, 取 RTT 最小的一半做最小二乘拟合 host = a + b·dev:
+ * 串口排队造成的大 RTT 样本不参与拟合, b - 1 即设备晶振相对主机的频偏.
+ *
+ * 读数只带 32 位毫秒 (约 49 天回绕), extend_tick_ms() 以最近的 dev_us 为参考还原高位.
+ * 除 stats() 外非线程安全, 应在 SensorDriver 的 io 线程调用
+ */
+class ClockSync {
+public:
+    static constexpr std::size_t WINDOW = 32;
+    static constexpr std::size_t MIN_FIT_SAMPLES = 4;
+    static constexpr int64_t MIN_FIT_SPAN_US = 2'000'000;  // 设备时间跨度不足时只估计偏移
+    static constexpr int64_t MAX_RTT_US = 1'000'000;        // 更慢的应答视为过期
+    static constexpr double MAX_SKEW = 1e-3;                // 拟合斜率偏离 1 超过 1000 ppm 时不采用
+
+    struct Stats {
+        bool synced = false;
+        uint64_t exchanges = 0;         // 已接受的往返
+        uint64_t rejected = 0;          // RTT 非正或过大
+        uint64_t resets = 0;            // 设备时钟回退 (重启) 或断线重置
+        double offset_us = 0.0;         // 当前时刻 主机单调时间 - 设备时间
+        double skew_ppm = 0.0;          // 设备时钟相对主机的频偏 (正 = 设备偏慢)
+        double residual_us = 0.0;       // 参与拟合样本的残差 RMS
+        double min_rtt_us = 0.0;        // 窗口内最小 RTT
+    };
+
+    /**
+     * @param host_send_us 发出 sync 时的主机单调时间 (µs)
+     * @param device_us    应答中的设备时间 (µs)
+     * @param host_recv_us 收到应答所在数据块的主机单调时间 (µs)
+     * @return false 表示样本被拒绝
+     */
+    bool add_exchange(int64_t host_send_us, uint64_t device_us, int64_t host_recv_us);
+
+    bool synced() const { return count_ > 0; }
+
+    /** @brief 设备时间 → 主机单调时间 (µs); 尚无样本时返回 nullopt */
+    std::optional<int64_t> to_host_us(uint64_t device_us) const;
+
+    /** @brief 把读数中的 32 位设备毫秒数还原为 64 位 (取离参考时刻最近的一圈) */
+    uint64_t extend_tick_ms(uint32_t tick_ms);
+
+    /** @brief 设备重启或链路重建: 丢弃全部样本和回绕参考 */
+    void reset();
+
+    Stats stats() const;
+
+private:
+    struct Exchange {
+        int64_t host_mid_us;
+        uint64_t device_us;
+        int64_t rtt_us;
+    };
+
+    void fit();
+    void note_reference_ms(uint64_t device_ms);
+
+    std::array<Exchange, WINDOW> window_{};
+    std::size_t count_ = 0;
+    std::size_t next_ = 0;
+    uint64_t last_device_us_ = 0;
+
+    // 模型: host = anchor_host_us_ + intercept_us_ + slope_ · (dev - anchor_device_us_)
+    uint64_t anchor_device_us_ = 0;
+    int64_t anchor_host_us_ = 0;
+    double intercept_us_ = 0.0;
+    double slope_ = 1.0;
+
+    uint64_t reference_ms_ = 0;
+    bool has_reference_ = false;
+
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
+};
+
+} // namespace hal
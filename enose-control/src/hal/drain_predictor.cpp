@@ -0,0 +1,85 @@
+#include "hal/drain_predictor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+void DrainPredictor::reset(std::optional<float> reference) {
+    count_ = 0;
+    reference_ = reference;
+}
+
+void DrainPredictor::push(double t_s, float weight) {
+    if (count_ > 0 && t_s - samples_[(count_ - 1) % WINDOW].t < MIN_INTERVAL_S) return;
+    samples_[count_ % WINDOW] = {t_s, weight};
+    ++count_;
+}
+
+DrainPredictor::Prediction DrainPredictor::predict(float settle_g) const {
+    Prediction p;
+    const std::size_t n = size();
+    if (n < MIN_SAMPLES) return p;
+
+    // 相邻样本差分: (中点重量, dw/dt), 按时间顺序从最旧样本开始
+    const std::size_t first = count_ - n;
+    double sum_w = 0, sum_d = 0, sum_ww = 0, sum_wd = 0;
+    std::size_t pairs = 0;
+    for (std::size_t i = first; i + 1 < count_; ++i) {
+        const auto& a = samples_[i % WINDOW];
+        const auto& b = samples_[(i + 1) % WINDOW];
+        const double dt = b.t - a.t;
+        if (dt <= 0) continue;
+        const double w = 0.5 * (static_cast<double>(a.w) + b.w);
+        const double d = (static_cast<double>(b.w) - a.w) / dt;
+        sum_w += w;
+        sum_d += d;
+        sum_ww += w * w;
+        sum_wd += w * d;
+        ++pairs;
+    }
+    if (pairs + 1 < MIN_SAMPLES) return p;
+
+    const double mean_w = sum_w / pairs;
+    const double mean_d = sum_d / pairs;
+    const double s_ww = sum_ww - pairs * mean_w * mean_w;
+    const double s_wd = sum_wd - pairs * mean_w * mean_d;
+    const auto& latest = samples_[(count_ - 1) % WINDOW];
+    const double now_w = latest.w;
+    const double settle = std::max(settle_g, 0.1f);
+
+    // 窗口内重量跨度太小时斜率没有意义 (已排空或尚未开始)
+    if (s_ww / pairs > 0.25 * settle * settle) {
+        const double b = s_wd / s_ww;
+        const double a = mean_d - b * mean_w;
+        if (b < 0 && -1.0 / b <= MAX_TAU_S) {
+            const double tau = -1.0 / b;
+            const double asymptote = -a / b;
+            // 有参考值时渐近重量须与之一致, 否则拟合的是别的过程 (如仍在注入)
+            // 从下方趋近 (注入尾段) 不是排废
+            const double excess = now_w - asymptote;
+            if ((!reference_ || std::abs(asymptote - *reference_) <= 4 * settle) && excess > -settle) {
+                p.valid = true;
+                p.exponential = true;
+                p.asymptote_g = static_cast<float>(asymptote);
+                p.tau_s = static_cast<float>(tau);
+                p.rate_g_s = static_cast<float>(a + b * now_w);
+                p.remaining_s = excess > settle ? tau * std::log(excess / settle) : 0.0;
+                p.completes_at_s = latest.t + p.remaining_s;
+                return p;
+            }
+        }
+    }
+
+    // 匀速下降: 只有知道空瓶重量才能估计剩余时间
+    if (reference_ && mean_d < 0) {
+        const double excess = now_w - *reference_;
+        p.valid = true;
+        p.asymptote_g = *reference_;
+        p.rate_g_s = static_cast<float>(mean_d);
+        p.remaining_s = excess > settle ? (excess - settle) / -mean_d : 0.0;
+        p.completes_at_s = latest.t + p.remaining_s;
+    }
+    return p;
+}
+
+} // namespace hal
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+
+namespace hal {
+
+/**
+ * @brief 排废过程的重量衰减模型 (预测排空时刻)
+ *
+ * 排废时瓶内液位下降, 重量近似按 w(t) = w∞ + A·e^(-t/τ) 衰减 (气泵抽吸受液位影响),
+ * 管路受限时退化为匀速下降. 对相邻样本的差分做 dw/dt = a + b·w 的最小二乘拟合:
+ *   b < 0 时为指数模型, τ = -1/b, 渐近重量 w∞ = -a/b;
+ *   否则按匀速下降 (速率 = 平均 dw/dt), 需要已知的空瓶参考值估计剩余时间.
+ * 最近 WINDOW 个样本保存在环形缓冲中, predict() 每次重算 (O(WINDOW)).
+ */
+class DrainPredictor {
+public:
+    static constexpr std::size_t WINDOW = 32;
+    static constexpr std::size_t MIN_SAMPLES = 8;
+    static constexpr double MIN_INTERVAL_S = 0.05;  // 更密的样本抽掉 (差分噪声)
+    static constexpr float MAX_TAU_S = 120.0f;
+
+    struct Prediction {
+        bool valid = false;
+        bool exponential = false;
+        float asymptote_g = 0.0f;       // 预测的空瓶重量
+        float tau_s = 0.0f;             // 时间常数 (匀速模型为 0)
+        float rate_g_s = 0.0f;          // 当前速率 (下降为负)
+        double remaining_s = 0.0;       // 距离进入 settle_g 范围还需的时间 (已进入为 0)
+        double completes_at_s = 0.0;    // 预测排空的时刻 (与 push 的 t_s 同一时基)
+    };
+
+    /** @brief 开始新的排废; reference 为已知的空瓶重量 (动态空瓶值) */
+    void reset(std::optional<float> reference = std::nullopt);
+
+    /** @brief t_s: 单调时间 (秒) */
+    void push(double t_s, float weight);
+
+    /**
+     * @brief 按当前窗口拟合
+     * @param settle_g 与空瓶重量相差不超过该值视为排空
+     */
+    Prediction predict(float settle_g) const;
+
+    std::size_t size() const { return count_ < WINDOW ? count_ : WINDOW; }
+
+private:
+    struct Sample {
+        double t = 0.0;
+        float w = 0.0f;
+    };
+    std::array<Sample, WINDOW> samples_{};
+    std::size_t count_ = 0;
+    std::optional<float> reference_;
+};
+
+} // namespace hal
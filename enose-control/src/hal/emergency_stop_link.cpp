@@ -0,0 +1,236 @@
+#include "hal/emergency_stop_link.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <string_view>
+
+namespace hal {
+
+EmergencyStopLink::EmergencyStopLink(net::io_context& io)
+    : strand_(net::make_strand(io)), resolver_(strand_), reconnect_timer_(strand_) {}
+
+void EmergencyStopLink::connect(const std::string& host, const std::string& port) {
+    host_ = host;
+    port_ = port;
+    running_ = true;
+    net::post(strand_, [this, self = shared_from_this()]() { start_connect(); });
+}
+
+void EmergencyStopLink::stop() {
+    running_ = false;
+    net::post(strand_, [this, self = shared_from_this()]() {
+        reconnect_timer_.cancel();
+        ++gen_;
+        connected_ = false;
+        if (ws_) {
+            beast::error_code ignored;
+            beast::get_lowest_layer(*ws_).socket().close(ignored);
+        }
+        while (!pending_.empty()) {
+            RpcResult result;
+            result.error = "emergency link stopped";
+            finish(pending_.begin()->first, std::move(result));
+        }
+    });
+}
+
+EmergencyStopLink::Stats EmergencyStopLink::stats() const {
+    Stats stats;
+    stats.connected = connected_;
+    stats.reconnects = reconnects_;
+    stats.sent = sent_;
+    stats.acked = acked_;
+    return stats;
+}
+
+void EmergencyStopLink::start_connect() {
+    if (!running_) return;
+    uint64_t gen = ++gen_;
+    ws_.emplace(strand_);
+    buffer_.consume(buffer_.size());
+
+    resolver_.async_resolve(host_, port_,
+        [this, self = shared_from_this(), gen](beast::error_code ec, tcp::resolver::results_type results) {
+            if (gen != gen_) return;
+            if (ec) {
+                schedule_reconnect();
+                return;
+            }
+            beast::get_lowest_layer(*ws_).expires_after(std::chrono::seconds(10));
+            beast::get_lowest_layer(*ws_).async_connect(results,
+                [this, self, gen](beast::error_code ec, tcp::resolver::results_type::endpoint_type) {
+                    if (gen != gen_) return;
+                    if (ec) {
+                        schedule_reconnect();
+                        return;
+                    }
+                    beast::get_lowest_layer(*ws_).expires_never();
+                    beast::get_lowest_layer(*ws_).socket().set_option(tcp::no_delay(true));
+
+                    // 平时没有流量: 空闲 2.5s 发 ping, 5s 无响应视为断线
+                    auto timeouts = websocket::stream_base::timeout::suggested(beast::role_type::client);
+                    timeouts.idle_timeout = std::chrono::seconds(5);
+                    timeouts.keep_alive_pings = true;
+                    ws_->set_option(timeouts);
+                    ws_->async_handshake(host_, "/websocket",
+                        [this, self, gen](beast::error_code ec) { on_handshake(gen, ec); });
+                });
+        });
+}
+
+void EmergencyStopLink::schedule_reconnect() {
+    if (!running_) return;
+    auto delay = reconnect_delay_;
+    reconnect_delay_ = std::min(reconnect_delay_ * 2, RECONNECT_DELAY_MAX);
+
+    reconnect_timer_.expires_after(delay);
+    reconnect_timer_.async_wait([this, self = shared_from_this()](beast::error_code ec) {
+        if (!ec) {
+            start_connect();
+        }
+    });
+}
+
+void EmergencyStopLink::on_handshake(uint64_t gen, beast::error_code ec) {
+    if (gen != gen_) return;
+    if (ec) {
+        spdlog::warn("EmergencyStopLink: Handshake failed: {}", ec.message());
+        schedule_reconnect();
+        return;
+    }
+
+    send_queue_.clear();
+    reconnect_delay_ = RECONNECT_DELAY_MIN;
+    connected_ = true;
+    if (ever_connected_) {
+        ++reconnects_;
+    }
+    ever_connected_ = true;
+    spdlog::info("EmergencyStopLink: Connected to {}:{}", host_, port_);
+    do_read();
+}
+
+void EmergencyStopLink::do_read() {
+    ws_->async_read(buffer_,
+        [this, self = shared_from_this(), gen = gen_](beast::error_code ec, std::size_t) {
+            on_read(gen, ec);
+        });
+}
+
+void EmergencyStopLink::on_read(uint64_t gen, beast::error_code ec) {
+    if (gen != gen_) return;
+    if (ec) {
+        on_disconnected(ec.message());
+        return;
+    }
+
+    // 未订阅对象, 到达的通知 (proc_stat 等) 直接丢弃, 只解析 RPC 响应
+    auto frame = buffer_.data();
+    std::string_view data(static_cast<const char*>(frame.data()), frame.size());
+    if (!pending_.empty() && data.substr(0, 64).find("\"method\"") == std::string_view::npos) {
+        try {
+            auto j = nlohmann::json::parse(data.begin(), data.end());
+            if (j.contains("id") && j["id"].is_number_integer()) {
+                RpcResult result;
+                if (j.contains("result")) {
+                    result.ok = true;
+                    result.result = j["result"];
+                } else {
+                    result.error = j.contains("error") ? j["error"].dump() : "invalid response";
+                }
+                finish(j["id"].get<int>(), std::move(result));
+            }
+        } catch (const std::exception& e) {
+            spdlog::warn("EmergencyStopLink: JSON parse error: {}", e.what());
+        }
+    }
+
+    buffer_.consume(buffer_.size());
+    do_read();
+}
+
+void EmergencyStopLink::trigger(Callback callback) {
+    net::post(strand_, [this, self = shared_from_this(), callback = std::move(callback)]() mutable {
+        if (!connected_) {
+            if (callback) {
+                RpcResult result;
+                result.error = "emergency link not connected";
+                callback(result);
+            }
+            return;
+        }
+
+        int id = rpc_id_++;
+        nlohmann::json req;
+        req["jsonrpc"] = "2.0";
+        req["method"] = "printer.emergency_stop";
+        req["id"] = id;
+
+        auto timer = std::make_unique<net::steady_timer>(strand_, ACK_TIMEOUT);
+        timer->async_wait([this, self, id](beast::error_code ec) {
+            if (ec) return;
+            RpcResult result;
+            result.error = "timeout";
+            finish(id, std::move(result));
+        });
+        pending_[id] = Pending{std::move(callback), std::move(timer)};
+
+        ++sent_;
+        send_queue_.push_back(req.dump());
+        if (send_queue_.size() == 1) {
+            do_write();
+        }
+    });
+}
+
+void EmergencyStopLink::do_write() {
+    if (send_queue_.empty()) return;
+    ws_->async_write(net::buffer(send_queue_.front()),
+        [this, self = shared_from_this(), gen = gen_](beast::error_code ec, std::size_t) {
+            if (gen != gen_) return;
+            send_queue_.pop_front();
+            if (ec) {
+                on_disconnected(ec.message());
+                return;
+            }
+            if (!send_queue_.empty()) {
+                do_write();
+            }
+        });
+}
+
+void EmergencyStopLink::finish(int id, RpcResult result) {
+    auto it = pending_.find(id);
+    if (it == pending_.end()) return;
+    Pending pending = std::move(it->second);
+    pending_.erase(it);
+    pending.timeout_timer->cancel();
+
+    if (result.ok) {
+        ++acked_;
+    } else {
+        spdlog::error("EmergencyStopLink: Emergency stop request {} failed: {}", id, result.error);
+    }
+    if (pending.callback) {
+        pending.callback(result);
+    }
+}
+
+void EmergencyStopLink::on_disconnected(const std::string& reason) {
+    bool was_connected = connected_.exchange(false);
+    if (was_connected) {
+        spdlog::warn("EmergencyStopLink: Disconnected: {}", reason);
+    }
+    // 旧连接的回调由 gen 过滤
+    ++gen_;
+    beast::error_code ignored;
+    beast::get_lowest_layer(*ws_).socket().close(ignored);
+    send_queue_.clear();
+    while (!pending_.empty()) {
+        RpcResult result;
+        result.error = "emergency link disconnected: " + reason;
+        finish(pending_.begin()->first, std::move(result));
+    }
+    schedule_reconnect();
+}
+
+} // namespace hal
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "hal/actuator_driver.hpp"
+#include <boost/asio/strand.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace hal {
+
+/**
+ * @brief 专用于急停的第二条 Moonraker WebSocket 连接
+ *
+ * 启动时预先建立并常驻, 不订阅对象, 只发送 printer.emergency_stop. Moonraker 把它直接
+ * 转给 Klipper 的 emergency_stop 端点, 不经 G-code 队列; 因此急停既不排在主连接写队列里
+ * 的呼吸灯、批量 G-code 之后, 也不等待主连接 strand 上积压的处理.
+ * 断线按退避自动重连, 空闲时发送 WebSocket ping 以便及时发现半开连接.
+ * trigger() 可在任意线程调用; 回调在本连接的 strand 上执行.
+ */
+class EmergencyStopLink : public std::enable_shared_from_this<EmergencyStopLink> {
+public:
+    using Callback = std::function<void(const RpcResult&)>;
+    static constexpr std::chrono::milliseconds ACK_TIMEOUT{1000};
+
+    struct Stats {
+        bool connected = false;
+        uint32_t reconnects = 0;
+        uint64_t sent = 0;          // 发出的急停请求
+        uint64_t acked = 0;         // Moonraker 确认的急停请求
+    };
+
+    explicit EmergencyStopLink(net::io_context& io);
+
+    void connect(const std::string& host, const std::string& port);
+    void stop();
+
+    /**
+     * @brief 发送 printer.emergency_stop; 未连接、出错或 ACK_TIMEOUT 内无响应时以 ok=false 回调
+     */
+    void trigger(Callback callback);
+
+    bool is_connected() const { return connected_; }
+    Stats stats() const;
+
+private:
+    void start_connect();
+    void schedule_reconnect();
+    void on_handshake(uint64_t gen, beast::error_code ec);
+    void do_read();
+    void on_read(uint64_t gen, beast::error_code ec);
+    void do_write();
+    void on_disconnected(const std::string& reason);
+    void finish(int id, RpcResult result);
+
+    net::strand<net::io_context::executor_type> strand_;
+    std::optional<websocket::stream<beast::tcp_stream>> ws_;
+    uint64_t gen_{0};
+    tcp::resolver resolver_;
+    net::steady_timer reconnect_timer_;
+    std::chrono::milliseconds reconnect_delay_{250};
+    static constexpr std::chrono::milliseconds RECONNECT_DELAY_MIN{250};
+    static constexpr std::chrono::milliseconds RECONNECT_DELAY_MAX{10000};
+    std::string host_;
+    std::string port_;
+    beast::flat_buffer buffer_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> connected_{false};
+    bool ever_connected_{false};
+
+    // 只在 strand 上访问
+    std::deque<std::string> send_queue_;
+    struct Pending {
+        Callback callback;
+        std::unique_ptr<net::steady_timer> timeout_timer;
+    };
+    std::map<int, Pending> pending_;
+    int rpc_id_{1};
+
+    std::atomic<uint32_t> reconnects_{0};
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> acked_{0};
+};
+
+} // namespace hal
@@ -0,0 +1,206 @@
+#include "hal/feature_extractor.hpp"
+#include <array>
+#include <cmath>
+
+namespace hal {
+
+struct FeatureExtractor::Channels {
+    std::array<float, SLOTS> baseline{};
+    std::array<float, SLOTS> r0{};
+    std::array<float, SLOTS> last_value{};
+    std::array<float, SLOTS> prev_value{};          // 上上条读数
+    std::array<float, SLOTS> last_response{};
+    std::array<float, SLOTS> noise_var{};
+    std::array<float, SLOTS> slope{};
+    std::array<float, SLOTS> area{};
+    std::array<float, SLOTS> peak{};
+    std::array<float, SLOTS> rise{};
+    std::array<uint32_t, SLOTS> last_tick{};
+    std::array<uint32_t, SLOTS> exposure_tick{};
+    std::array<uint32_t, SLOTS> count{};
+    std::array<uint32_t, SLOTS> epoch{};
+    std::array<uint8_t, SLOTS> baseline_unstable{};     // 暴露开始时基线是否仍在漂移
+};
+
+void FeatureExtractor::Lanes::resize(std::size_t n) {
+    for (auto* v : {&slot, &sample}) v->resize(n);
+    for (auto* v : {&tick, &count}) v->resize(n);
+    for (auto* v : {&value, &dt, &reference, &last_value, &prev_value, &last_response, &baseline,
+                    &noise_var, &noise, &slope, &area, &peak, &rise, &since_exposure}) {
+        v->resize(n);
+    }
+}
+
+FeatureExtractor::FeatureExtractor(FeatureConfig config)
+    : config_(config)
+    , channels_(std::make_unique<Channels>()) {}
+
+FeatureExtractor::~FeatureExtractor() = default;
+
+void FeatureExtractor::reset() {
+    channels_ = std::make_unique<Channels>();
+    features_ = FrameFeatures{};
+    epoch_ = 0;
+    exposing_ = false;
+}
+
+int FeatureExtractor::slot_of(const SensorSample& sample) {
+    if (sample.type == SensorType::UNKNOWN || sample.sensor_idx >= MAX_SENSORS) return -1;
+    // 只有 MOX_DIGITAL 的读数按加热步区分, 其余类型 heater_step 恒为 0
+    const std::size_t step = sample.type == SensorType::MOX_DIGITAL ? sample.heater_step : 0;
+    if (step >= MAX_HEATER_STEPS) return -1;
+    return static_cast<int>(static_cast<std::size_t>(sample.type) * SLOTS_PER_TYPE +
+                            sample.sensor_idx * MAX_HEATER_STEPS + step);
+}
+
+const FrameFeatures& FeatureExtractor::push(const StepFrame& frame, bool exposure) {
+    features_.seq = frame.seq;
+    features_.heater_step = frame.heater_step;
+    features_.exposure = exposure;
+    features_.quality = 0;
+    features_.channels.clear();
+
+    if (exposure && !exposing_) ++epoch_;
+    exposing_ = exposure;
+
+    auto& ch = *channels_;
+    auto& L = lanes_;
+    L.resize(frame.samples.size());
+
+    // 1. 收集: 本帧涉及的通道状态拷到连续数组, 顺带处理新通道和新一次暴露的初始化
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < frame.samples.size(); ++i) {
+        const auto& sample = frame.samples[i];
+        const int s = slot_of(sample);
+        if (s < 0 || !std::isfinite(sample.value)) continue;
+
+        if (ch.count[s] == 0) {
+            ch.baseline[s] = sample.value;
+            ch.last_value[s] = sample.value;
+            ch.prev_value[s] = sample.value;
+            ch.last_response[s] = 0.0f;
+            ch.last_tick[s] = sample.tick_ms;
+        }
+        if (exposure && ch.epoch[s] != epoch_) {
+            ch.epoch[s] = epoch_;
+            ch.r0[s] = ch.baseline[s];
+            ch.exposure_tick[s] = sample.tick_ms;
+            ch.area[s] = 0.0f;
+            ch.peak[s] = 0.0f;
+            ch.rise[s] = 0.0f;
+            ch.last_response[s] = ch.r0[s] != 0.0f ? (ch.last_value[s] - ch.r0[s]) / ch.r0[s] : 0.0f;
+            ch.baseline_unstable[s] = ch.count[s] >= MIN_SAMPLES &&
+                                      std::fabs(ch.slope[s]) > config_.baseline_drift_threshold;
+        }
+
+        L.slot[n] = static_cast<uint16_t>(s);
+        L.sample[n] = static_cast<uint16_t>(i);
+        L.tick[n] = sample.tick_ms;
+        L.count[n] = ch.count[s];
+        L.value[n] = sample.value;
+        // 无符号差值, tick 回绕时同样成立
+        L.dt[n] = static_cast<float>(sample.tick_ms - ch.last_tick[s]) / 1000.0f;
+        L.reference[n] = exposure ? ch.r0[s] : ch.baseline[s];
+        L.last_value[n] = ch.last_value[s];
+        L.prev_value[n] = ch.prev_value[s];
+        L.last_response[n] = ch.last_response[s];
+        L.baseline[n] = ch.baseline[s];
+        L.noise_var[n] = ch.noise_var[s];
+        L.slope[n] = ch.slope[s];
+        L.area[n] = ch.area[s];
+        L.peak[n] = ch.peak[s];
+        L.rise[n] = ch.rise[s];
+        L.since_exposure[n] = exposure
+            ? static_cast<float>(sample.tick_ms - ch.exposure_tick[s]) / 1000.0f : 0.0f;
+        ++n;
+    }
+
+    // 2. 更新: 各数组逐元素运算, 条件都写成选择
+    const float in_exposure = exposure ? 1.0f : 0.0f;
+    const float a_base = config_.baseline_alpha * (1.0f - in_exposure);
+    const float a_noise = config_.noise_alpha;
+    const float a_slope = config_.slope_alpha;
+    for (std::size_t k = 0; k < n; ++k) {
+        const float ref = L.reference[k];
+        const float inv = ref != 0.0f ? 1.0f / ref : 0.0f;
+        const float response = (L.value[k] - ref) * inv;
+        const float dt = L.dt[k];
+        const bool has_dt = dt > 0.0f;
+
+        // 二阶差分抵消线性趋势; 白噪声下其方差为 6σ²
+        const float diff2 = L.value[k] - 2.0f * L.last_value[k] + L.prev_value[k];
+        const float sq = L.count[k] >= MIN_SAMPLES
+            ? std::fmin(diff2 * diff2, NOISE_CLIP * L.noise_var[k]) : diff2 * diff2;
+        L.noise_var[k] = L.count[k] >= 2 ? L.noise_var[k] + a_noise * (sq - L.noise_var[k]) : 0.0f;
+
+        const float instant = (response - L.last_response[k]) / (has_dt ? dt : 1.0f);
+        L.slope[k] = has_dt ? L.slope[k] + a_slope * (instant - L.slope[k]) : L.slope[k];
+
+        L.area[k] += in_exposure * 0.5f * (response + L.last_response[k]) * dt;
+
+        const bool is_peak = exposure && std::fabs(response) > std::fabs(L.peak[k]);
+        L.peak[k] = is_peak ? response : L.peak[k];
+        L.rise[k] = is_peak ? L.since_exposure[k] : L.rise[k];
+
+        L.baseline[k] += a_base * (L.value[k] - L.baseline[k]);
+        L.last_response[k] = response;
+        L.noise[k] = std::sqrt(L.noise_var[k] / 6.0f) * std::fabs(inv);
+    }
+
+    // 3. 写回并生成输出
+    features_.channels.reserve(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        const std::size_t s = L.slot[k];
+        const auto& sample = frame.samples[L.sample[k]];
+        ch.baseline[s] = L.baseline[k];
+        ch.prev_value[s] = L.last_value[k];
+        ch.last_value[s] = L.value[k];
+        ch.last_response[s] = L.last_response[k];
+        ch.noise_var[s] = L.noise_var[k];
+        ch.slope[s] = L.slope[k];
+        ch.area[s] = L.area[k];
+        ch.peak[s] = L.peak[k];
+        ch.rise[s] = L.rise[k];
+        ch.last_tick[s] = L.tick[k];
+        const uint32_t count = ++ch.count[s];
+
+        ChannelFeatures f;
+        f.type = sample.type;
+        f.sensor_idx = sample.sensor_idx;
+        f.adc_channel = sample.adc_channel;
+        f.heater_step = sample.type == SensorType::MOX_DIGITAL ? sample.heater_step : 0;
+        f.value = L.value[k];
+        f.baseline = exposure ? ch.r0[s] : L.baseline[k];
+        f.response = L.last_response[k];
+        f.peak_response = exposure ? L.peak[k] : 0.0f;
+        f.rise_time_s = exposure ? L.rise[k] : 0.0f;
+        f.area_s = exposure ? L.area[k] : 0.0f;
+        f.slope_per_s = L.slope[k];
+        f.noise = L.noise[k];
+
+        if (f.value <= config_.min_value || f.value >= config_.max_value) {
+            f.quality |= QUALITY_SATURATION;
+        }
+        if (count >= MIN_SAMPLES) {
+            if (f.noise > config_.noise_threshold) f.quality |= QUALITY_EXCESS_NOISE;
+            const bool drifting = exposure
+                ? ch.baseline_unstable[s] != 0
+                : std::fabs(f.slope_per_s) > config_.baseline_drift_threshold;
+            if (drifting) f.quality |= QUALITY_BASELINE_UNSTABLE;
+        }
+        if (sample.has_humidity() &&
+            (sample.humidity < config_.humidity_min || sample.humidity > config_.humidity_max)) {
+            f.quality |= QUALITY_HUMIDITY;
+        }
+        if (sample.has_temperature() &&
+            (sample.temperature < config_.temperature_min || sample.temperature > config_.temperature_max)) {
+            f.quality |= QUALITY_TEMPERATURE;
+        }
+
+        features_.quality |= f.quality;
+        features_.channels.push_back(f);
+    }
+    return features_;
+}
+
+} // namespace hal
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include "hal/step_frame_assembler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 特征提取参数
+ */
+struct FeatureConfig {
+    float baseline_alpha = 0.05f;           // 基线阶段 EWMA 系数 (每个通道每条读数)
+    float noise_alpha = 0.1f;               // 噪声方差 EWMA 系数
+    float slope_alpha = 0.3f;               // 斜率 EWMA 系数
+    float min_value = 1.0f;                 // 不大于此值视为饱和 (Ω / V / ppb)
+    float max_value = 1.0e8f;               // 不小于此值视为饱和
+    float noise_threshold = 0.02f;          // 相对噪声 σ 上限
+    float baseline_drift_threshold = 0.005f;// 基线阶段相对斜率上限 (1/s)
+    float humidity_min = 5.0f;              // %RH
+    float humidity_max = 90.0f;
+    float temperature_min = 0.0f;           // °C
+    float temperature_max = 60.0f;
+};
+
+/**
+ * @brief 质量标志位 (与 AnalysisResult.QualityFlag 对应, 由服务层转换)
+ */
+enum QualityBits : uint32_t {
+    QUALITY_BASELINE_UNSTABLE = 1u << 0,
+    QUALITY_SATURATION        = 1u << 1,
+    QUALITY_EXCESS_NOISE      = 1u << 2,
+    QUALITY_HUMIDITY          = 1u << 3,
+    QUALITY_TEMPERATURE       = 1u << 4,
+};
+
+/**
+ * @brief 单个通道 (传感器 × 加热步) 在当前帧上的响应特征
+ */
+struct ChannelFeatures {
+    SensorType type = SensorType::UNKNOWN;
+    uint8_t sensor_idx = 0;
+    uint8_t adc_channel = 0;
+    uint8_t heater_step = 0;
+    float value = 0.0f;
+    float baseline = 0.0f;          // R0: 暴露期间锁定为暴露开始时的基线, 其余时间为跟踪中的基线
+    float response = 0.0f;          // ΔR/R0
+    float peak_response = 0.0f;     // 本次暴露中绝对值最大的 ΔR/R0
+    float rise_time_s = 0.0f;       // 暴露开始到峰值的时间
+    float area_s = 0.0f;            // 本次暴露的 ∫ΔR/R0 dt (梯形积分)
+    float slope_per_s = 0.0f;       // d(ΔR/R0)/dt (EWMA)
+    float noise = 0.0f;             // 相对噪声 σ (二阶差分估计, 不受平滑响应曲线影响)
+    uint32_t quality = 0;           // QualityBits
+};
+
+/**
+ * @brief 一帧的特征 (与 StepFrame.seq 对应)
+ */
+struct FrameFeatures {
+    uint64_t seq = 0;
+    uint8_t heater_step = 0;
+    bool exposure = false;
+    uint32_t quality = 0;           // 各通道标志按位或
+    std::vector<ChannelFeatures> channels;
+};
+
+/**
+ * @brief 流式响应特征提取
+ *
+ * 按 (传感器类型, sensor_idx, heater_step) 分通道增量计算: 非暴露阶段跟踪基线,
+ * 暴露阶段 (气路连通气室) 以开始时的基线为 R0 计算 ΔR/R0、峰值与上升时间、面积和斜率,
+ * 噪声在两个阶段都持续估计. 每条读数 O(1), 不保存历史.
+ *
+ * 通道状态按结构数组 (SoA) 存放; 每帧先把涉及的通道收集到连续的临时数组,
+ * 在无分支的循环里统一更新后再写回, 便于编译器向量化.
+ *
+ * 非线程安全, 应在同一线程 (SensorDriver 的 io 线程) 调用
+ */
+class FeatureExtractor {
+public:
+    explicit FeatureExtractor(FeatureConfig config = {});
+    ~FeatureExtractor();
+
+    /**
+     * @brief 处理一帧
+     * @param exposure 该帧是否处于暴露阶段; 由 false 变为 true 时开始新的一次暴露
+     * @return 本帧特征, 下次 push()/reset() 前有效
+     */
+    const FrameFeatures& push(const StepFrame& frame, bool exposure);
+
+    /** @brief 清空所有通道 (重连或配置变化时) */
+    void reset();
+
+    const FeatureConfig& config() const { return config_; }
+
+    /** @brief 替换阈值与 EWMA 系数 (配置热加载), 各通道状态保留 */
+    void set_config(const FeatureConfig& config) { config_ = config; }
+
+    static constexpr std::size_t MAX_HEATER_STEPS = 16;
+
+private:
+    static constexpr std::size_t MAX_SENSORS = 64;
+    static constexpr std::size_t SLOTS_PER_TYPE = MAX_SENSORS * MAX_HEATER_STEPS;
+    static constexpr std::size_t SLOTS = SLOTS_PER_TYPE * 3;
+    static constexpr uint32_t MIN_SAMPLES = 5;     // 噪声/漂移判定前需要的读数条数
+    static constexpr float NOISE_CLIP = 9.0f;      // 单条二阶差分平方的上限 (× 当前方差), 阶跃不至于抬高噪声
+
+    // 通道状态 (SoA, 按槽位索引)
+    struct Channels;
+
+    // 每帧的连续工作区 (按本帧读数顺序)
+    struct Lanes {
+        std::vector<uint16_t> slot, sample;
+        std::vector<uint32_t> tick, count;
+        std::vector<float> value, dt, reference, last_value, prev_value, last_response, baseline;
+        std::vector<float> noise_var, noise, slope, area, peak, rise, since_exposure;
+
+        void resize(std::size_t n);
+    };
+
+    static int slot_of(const SensorSample& sample);
+
+    FeatureConfig config_;
+    std::unique_ptr<Channels> channels_;
+    Lanes lanes_;
+    FrameFeatures features_;
+    uint32_t epoch_ = 0;            // 每次暴露开始递增
+    bool exposing_ = false;
+};
+
+} // namespace hal
@@ -0,0 +1,161 @@
+#include "hal/fingerprint_assembler.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace hal {
+
+namespace {
+
+constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+constexpr float MIN_VARIANCE = 1e-12f;     // ln(R) 方差低于此值 (各步读数相同) 时整列输出 0
+
+} // namespace
+
+FingerprintAssembler::FingerprintAssembler(FingerprintConfig config)
+    : config_(config) {
+    config_.steps = std::max<uint8_t>(config_.steps, 1);
+    config_.sensors = std::max<uint8_t>(config_.sensors, 1);
+    row_.resize(config_.sensors);
+}
+
+void FingerprintAssembler::set_steps(uint8_t steps) {
+    steps = std::max<uint8_t>(steps, 1);
+    if (steps == config_.steps) return;
+    config_.steps = steps;
+    in_cycle_ = false;
+    last_step_ = -1;
+}
+
+void FingerprintAssembler::reset() {
+    in_cycle_ = false;
+    last_step_ = -1;
+    cycles_ = 0;
+}
+
+const FingerprintMatrix* FingerprintAssembler::push(const StepFrame& frame) {
+    std::fill(row_.begin(), row_.end(), NaN);
+    for (const auto& sample : frame.samples) {
+        if (sample.type == SensorType::MOX_DIGITAL && sample.sensor_idx < row_.size()) {
+            row_[sample.sensor_idx] = sample.value;
+        }
+    }
+    return push_row(frame.seq, frame.first_tick_ms, frame.heater_step, row_);
+}
+
+const FingerprintMatrix* FingerprintAssembler::push_row(uint64_t frame_seq, uint32_t tick_ms,
+                                                        uint8_t heater_step,
+                                                        std::span<const float> by_sensor) {
+    if (heater_step >= config_.steps) return nullptr;   // 与当前加热配置不符
+
+    const FingerprintMatrix* completed = nullptr;
+    if (in_cycle_ && static_cast<int>(heater_step) <= last_step_) {
+        // 回绕: 最后几步丢失, 按已有内容完成
+        completed = finish();
+    }
+    if (heater_step == 0) {
+        begin(frame_seq, tick_ms);
+    }
+    if (!in_cycle_) return completed;
+
+    const std::size_t sensors = current_.sensors;
+    const std::size_t n = std::min(sensors, by_sensor.size());
+    float* row = current_.resistance.data() + static_cast<std::size_t>(heater_step) * sensors;
+    std::copy_n(by_sensor.begin(), n, row);
+    current_.last_frame_seq = frame_seq;
+    last_step_ = heater_step;
+
+    if (heater_step + 1u == current_.steps) {
+        completed = finish();
+    }
+    return completed;
+}
+
+void FingerprintAssembler::begin(uint64_t frame_seq, uint32_t tick_ms) {
+    current_.steps = config_.steps;
+    current_.sensors = config_.sensors;
+    current_.first_frame_seq = frame_seq;
+    current_.last_frame_seq = frame_seq;
+    current_.first_tick_ms = tick_ms;
+    current_.resistance.assign(static_cast<std::size_t>(current_.steps) * current_.sensors, NaN);
+    in_cycle_ = true;
+    last_step_ = -1;
+}
+
+const FingerprintMatrix* FingerprintAssembler::finish() {
+    in_cycle_ = false;
+    last_step_ = -1;
+
+    uint32_t missing = 0;
+    for (float r : current_.resistance) {
+        missing += !(r == r);
+    }
+    if (missing > config_.max_missing) {
+        ++dropped_;
+        return nullptr;
+    }
+
+    current_.missing = missing;
+    current_.cycle_seq = ++cycles_;
+    current_.normalized.resize(current_.resistance.size());
+    normalize(current_.resistance.data(), current_.normalized.data(),
+              current_.steps, current_.sensors, config_.min_resistance);
+
+    // 交换缓冲区, 下一周期复用 done_ 原来的内存
+    std::swap(current_, done_);
+    return &done_;
+}
+
+void FingerprintAssembler::normalize(const float* resistance, float* out, std::size_t steps,
+                                     std::size_t sensors, float min_resistance) {
+    // sensors 不超过 uint8_t 范围
+    std::array<float, 256> mean{};
+    std::array<float, 256> scale{};
+    std::array<float, 256> count{};
+    const std::size_t n = steps * sensors;
+
+    // 1. ln(R), 缺失单元记 0 且不计数; 同时累加每列的和
+    for (std::size_t i = 0; i < n; ++i) {
+        const float r = resistance[i];
+        const float valid = r == r ? 1.0f : 0.0f;
+        out[i] = valid * std::log(std::max(r == r ? r : min_resistance, min_resistance));
+    }
+    for (std::size_t step = 0; step < steps; ++step) {
+        const float* x = out + step * sensors;
+        const float* r = resistance + step * sensors;
+        for (std::size_t s = 0; s < sensors; ++s) {
+            mean[s] += x[s];
+            count[s] += r[s] == r[s] ? 1.0f : 0.0f;
+        }
+    }
+    for (std::size_t s = 0; s < sensors; ++s) {
+        mean[s] = count[s] > 0.0f ? mean[s] / count[s] : 0.0f;
+    }
+
+    // 2. 两遍法求方差 (ln(R) 约 10~15, 平方和相减在 float 下误差过大)
+    for (std::size_t step = 0; step < steps; ++step) {
+        const float* x = out + step * sensors;
+        const float* r = resistance + step * sensors;
+        for (std::size_t s = 0; s < sensors; ++s) {
+            const float d = (r[s] == r[s]) ? x[s] - mean[s] : 0.0f;
+            scale[s] += d * d;
+        }
+    }
+    for (std::size_t s = 0; s < sensors; ++s) {
+        const float var = count[s] > 0.0f ? scale[s] / count[s] : 0.0f;
+        scale[s] = var > MIN_VARIANCE ? 1.0f / std::sqrt(var) : 0.0f;
+    }
+
+    // 3. z-score, 缺失单元为 0 (即该列均值)
+    for (std::size_t step = 0; step < steps; ++step) {
+        float* x = out + step * sensors;
+        const float* r = resistance + step * sensors;
+        for (std::size_t s = 0; s < sensors; ++s) {
+            const float valid = r[s] == r[s] ? 1.0f : 0.0f;
+            x[s] = valid * (x[s] - mean[s]) * scale[s];
+        }
+    }
+}
+
+} // namespace hal
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include "hal/step_frame_assembler.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 按 ALIGNMENT 字节对齐分配的 std::allocator 替代品 (矩阵缓冲区按缓存行对齐)
+ */
+template <typename T, std::size_t ALIGNMENT>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, ALIGNMENT>; };
+
+    AlignedAllocator() noexcept = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{ALIGNMENT}));
+    }
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t{ALIGNMENT});
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, ALIGNMENT>&) const noexcept { return true; }
+};
+
+/**
+ * @brief 指纹矩阵参数
+ */
+struct FingerprintConfig {
+    uint8_t steps = 10;             // 加热步数 (行), 与 HeaterCycleTracker::DEFAULT_PROFILE_LENGTH 一致
+    uint8_t sensors = 8;            // BME688 传感器数 (列), sensor_idx 0..sensors-1
+    uint32_t max_missing = 0;       // 允许缺失的单元数, 超过则丢弃该周期
+    float min_resistance = 1.0f;    // 取对数前的下限 (Ω)
+};
+
+/**
+ * @brief 一个完整加热周期的指纹 (steps × sensors, 行主序: 第 step 行第 sensor 列)
+ */
+struct FingerprintMatrix {
+    static constexpr std::size_t ALIGNMENT = 64;
+    using Buffer = std::vector<float, AlignedAllocator<float, ALIGNMENT>>;
+
+    uint64_t cycle_seq = 0;         // 本次连接中的周期序号, 从 1 开始
+    uint64_t first_frame_seq = 0;   // 第 0 步所在 StepFrame.seq
+    uint64_t last_frame_seq = 0;
+    uint32_t first_tick_ms = 0;
+    uint8_t steps = 0;
+    uint8_t sensors = 0;
+    uint32_t missing = 0;           // 缺失的单元数
+    Buffer resistance;              // 原始电阻 (Ω), 缺失为 NaN
+    Buffer normalized;              // ln(R) 按传感器 (列) 跨加热步 z-score, 缺失为 0
+
+    float at(std::size_t step, std::size_t sensor) const { return resistance[step * sensors + sensor]; }
+};
+
+/**
+ * @brief 把逐帧到达的 BME688 读数拼成每个加热周期一个的连续指纹矩阵
+ *
+ * 每个 StepFrame 是一个加热步, 其中 MOX_DIGITAL 读数按 sensor_idx 填入该步对应的行.
+ * 周期从第 0 步开始, 最后一步到达时完成; 步号回绕 (最后几步丢失) 时按已有内容提前完成,
+ * 缺失单元计数超过 max_missing 的周期丢弃. 连接建立后的第一个不完整周期不计.
+ *
+ * 完成时做对数变换和逐列 z-score: 电阻跨数量级变化, ln(R) 后同一传感器各加热步的
+ * 相对形状才是气味特征, 逐列标准化去掉了传感器之间的整体增益差异.
+ * 三遍循环都在对齐的连续数组上按行遍历、内层沿传感器方向且无分支, 便于编译器向量化.
+ *
+ * 非线程安全, 应在同一线程调用 (实时路径为 SensorDriver 的 io 线程)
+ */
+class FingerprintAssembler {
+public:
+    explicit FingerprintAssembler(FingerprintConfig config = {});
+
+    /**
+     * @brief 处理一帧
+     * @return 本帧完成的周期, 下次 push()/reset() 前有效; 未完成时为 nullptr
+     */
+    const FingerprintMatrix* push(const StepFrame& frame);
+
+    /**
+     * @brief 处理一行已按 sensor_idx 排好的电阻 (数据库导出用, 缺失为 NaN)
+     */
+    const FingerprintMatrix* push_row(uint64_t frame_seq, uint32_t tick_ms, uint8_t heater_step,
+                                      std::span<const float> by_sensor);
+
+    /** @brief 更新加热步数; 变化时作废进行中的周期 */
+    void set_steps(uint8_t steps);
+
+    /** @brief 丢弃进行中的周期 (断线时), 周期序号从头开始 */
+    void reset();
+
+    const FingerprintConfig& config() const { return config_; }
+    uint64_t cycles() const { return cycles_; }
+    uint64_t dropped() const { return dropped_; }
+
+    /**
+     * @brief 对数变换 + 逐列 z-score (steps × sensors, 行主序), 缺失 (NaN) 单元输出 0
+     */
+    static void normalize(const float* resistance, float* out, std::size_t steps, std::size_t sensors,
+                          float min_resistance);
+
+private:
+    void begin(uint64_t frame_seq, uint32_t tick_ms);
+    const FingerprintMatrix* finish();
+
+    FingerprintConfig config_;
+    FingerprintMatrix current_;     // 填充中
+    FingerprintMatrix done_;        // 最近完成的周期
+    std::vector<float> row_;        // push() 的整行收集区
+    int last_step_ = -1;
+    bool in_cycle_ = false;
+    uint64_t cycles_ = 0;
+    uint64_t dropped_ = 0;
+};
+
+} // namespace hal
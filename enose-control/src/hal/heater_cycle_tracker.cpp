@@ -0,0 +1,137 @@
+#include "hal/heater_cycle_tracker.hpp"
+#include <spdlog/spdlog.h>
+
+namespace hal {
+
+HeaterCycleTracker::HeaterCycleTracker() {
+    for (auto& length : profile_length_) length = DEFAULT_PROFILE_LENGTH;
+    for (auto& length : pending_length_) length = 0;
+    for (auto& count : cycles_) count = 0;
+    for (auto& count : started_) count = 0;
+}
+
+void HeaterCycleTracker::set_profile_length(uint8_t sensor_idx, uint8_t length) {
+    if (sensor_idx >= MAX_SENSORS || length == 0) return;
+    profile_length_[sensor_idx] = length;
+    pending_length_[sensor_idx] = 0;
+    restart_mask_ |= (uint64_t{1} << sensor_idx);
+    mean_period_ms_ = 0;
+}
+
+void HeaterCycleTracker::set_profile_length_all(uint8_t length) {
+    if (length == 0) return;
+    for (auto& l : profile_length_) l = length;
+    for (auto& l : pending_length_) l = 0;
+    restart_mask_ = ~uint64_t{0};
+    mean_period_ms_ = 0;
+}
+
+void HeaterCycleTracker::set_profile_length_at_boundary(uint8_t sensor_idx, uint8_t length) {
+    if (sensor_idx >= MAX_SENSORS || length == 0) return;
+    pending_length_[sensor_idx] = length;
+}
+
+void HeaterCycleTracker::set_profile_length_at_boundary_all(uint8_t length) {
+    if (length == 0) return;
+    for (auto& l : pending_length_) l = length;
+}
+
+uint8_t HeaterCycleTracker::profile_length(uint8_t sensor_idx) const {
+    if (sensor_idx >= MAX_SENSORS) return DEFAULT_PROFILE_LENGTH;
+    return profile_length_[sensor_idx];
+}
+
+uint64_t HeaterCycleTracker::cycles(uint8_t sensor_idx) const {
+    if (sensor_idx >= MAX_SENSORS) return 0;
+    return cycles_[sensor_idx];
+}
+
+uint64_t HeaterCycleTracker::cycles_started(uint8_t sensor_idx) const {
+    if (sensor_idx >= MAX_SENSORS) return 0;
+    return started_[sensor_idx];
+}
+
+void HeaterCycleTracker::reset() {
+    state_.fill(SensorState{});
+    // 作废的周期不再计为已开始
+    for (std::size_t i = 0; i < MAX_SENSORS; ++i) started_[i] = cycles_[i].load();
+    active_mask_ = 0;
+    last_seq_ = 0;
+}
+
+void HeaterCycleTracker::push(std::span<const SensorSample> samples) {
+    for (const auto& sample : samples) {
+        push(sample);
+    }
+}
+
+void HeaterCycleTracker::push(const SensorSample& sample) {
+    if (sample.type != SensorType::MOX_DIGITAL || sample.sensor_idx >= MAX_SENSORS) return;
+
+    // 补发的旧读数不参与步进判定
+    if (sample.seq != 0) {
+        if (last_seq_ != 0 && sample.seq <= last_seq_) return;
+        last_seq_ = sample.seq;
+    }
+
+    const uint8_t idx = sample.sensor_idx;
+    const int step = sample.heater_step;
+    const uint64_t bit = uint64_t{1} << idx;
+    auto& st = state_[idx];
+    active_mask_ |= bit;
+    if (restart_mask_.load() & bit) {
+        restart_mask_ &= ~bit;
+        st = SensorState{};
+        started_[idx] = cycles_[idx].load();
+    }
+
+    // 步号超出已知配置长度: 配置在本机之外被修改, 按观察值修正
+    if (step >= profile_length_[idx]) {
+        spdlog::warn("HeaterCycleTracker: sensor {} reported step {} beyond profile length {}, adjusting",
+                     idx, step, profile_length_[idx].load());
+        profile_length_[idx] = static_cast<uint8_t>(step + 1);
+    }
+
+    // 回绕但未见到最后一步 (读数丢失): 补记进行中的周期
+    if (st.last_step >= 0 && step <= st.last_step && st.in_cycle) {
+        complete(idx, sample.tick_ms);
+    }
+
+    if (step == 0) {
+        // 周期边界: 换上暂存的配置长度, 周期时长重新统计
+        if (const uint8_t pending = pending_length_[idx].exchange(0); pending != 0) {
+            profile_length_[idx] = pending;
+            mean_period_ms_ = 0;
+        }
+        st.in_cycle = true;
+        ++started_[idx];
+    }
+    if (st.in_cycle && step == profile_length_[idx] - 1) {
+        complete(idx, sample.tick_ms);
+    }
+
+    st.last_step = step;
+}
+
+void HeaterCycleTracker::complete(uint8_t sensor_idx, uint32_t tick_ms) {
+    auto& st = state_[sensor_idx];
+    st.in_cycle = false;
+
+    // 周期时长: 相邻两次完成的设备时间差 (无符号减法跨越 tick 回绕)
+    if (st.has_completed && tick_ms != 0) {
+        const uint32_t period = tick_ms - st.last_complete_tick;
+        const uint32_t mean = mean_period_ms_.load();
+        if (mean == 0) {
+            mean_period_ms_ = period;
+        } else if (period <= mean * 2) {
+            mean_period_ms_ = static_cast<uint32_t>(mean + (static_cast<double>(period) - mean) * 0.1);
+        }
+    }
+    st.has_completed = tick_ms != 0;
+    st.last_complete_tick = tick_ms;
+
+    uint64_t count = ++cycles_[sensor_idx];
+    on_cycle_complete(sensor_idx, count);
+}
+
+} // namespace hal
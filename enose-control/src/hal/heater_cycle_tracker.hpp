@@ -0,0 +1,97 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <boost/signals2.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace hal {
+
+/**
+ * @brief 按传感器统计 BME688 加热周期
+ *
+ * 每个 MOX_DIGITAL 传感器按自己的加热配置长度 (默认 10 步, 与固件
+ * BME688Array::setDefaultHeaterProfile 一致; ConfigureHeater 成功后由 set_profile_length 更新)
+ * (周期边界生效时由 set_profile_length_at_boundary 更新) 依次上报 heater_step. 从第 0 步开始的周期在最后一步到达时即完成并发出 on_cycle_complete,
+ * 不必等下一周期的第 0 步; 若最后一步丢失, 在步号回绕时补记. 连接建立后的第一个不完整周期不计.
+ *
+ * push() / reset() 只在 SensorDriver 的 io 线程调用; 配置与计数可从任意线程读写.
+ */
+class HeaterCycleTracker {
+public:
+    static constexpr std::size_t MAX_SENSORS = 64;
+    static constexpr uint8_t DEFAULT_PROFILE_LENGTH = 10;
+
+    HeaterCycleTracker();
+
+    void push(std::span<const SensorSample> samples);
+
+    /** @brief 丢弃进行中的周期 (断线时), 累计计数保留 */
+    void reset();
+
+    /**
+     * @brief 更新加热配置长度; 固件重新配置时从第 0 步重新开始, 进行中的周期作废
+     */
+    void set_profile_length(uint8_t sensor_idx, uint8_t length);
+    void set_profile_length_all(uint8_t length);
+
+    /**
+     * @brief 固件在周期边界切换加热配置时使用: 当前周期按原长度计完, 下一次第 0 步起按新长度
+     */
+    void set_profile_length_at_boundary(uint8_t sensor_idx, uint8_t length);
+    void set_profile_length_at_boundary_all(uint8_t length);
+    uint8_t profile_length(uint8_t sensor_idx) const;
+
+    /** @brief 该传感器累计完成的周期数 */
+    uint64_t cycles(uint8_t sensor_idx) const;
+
+    /**
+     * @brief 该传感器累计开始 (见到第 0 步) 的周期数
+     *
+     * 等待 "今后 N 个完整周期" 时以 cycles_started() + N 作为 cycles() 的目标,
+     * 可排除等待开始时正在进行的周期.
+     */
+    uint64_t cycles_started(uint8_t sensor_idx) const;
+
+    /**
+     * @brief 实测的加热周期时长 (秒), 尚无完整的相邻周期时返回 0
+     *
+     * 按设备时间戳 (tick_ms) 计算同一传感器相邻两次周期完成的间隔, 所有传感器共用一个
+     * 指数滑动平均; 间隔超过当前均值两倍 (中间丢了周期) 的样本不计. 修改加热配置后重新统计.
+     */
+    double mean_cycle_period_s() const { return mean_period_ms_.load() / 1000.0; }
+
+    /** @brief 本次连接中上报过读数的传感器位图 (bit i = sensor_idx i) */
+    uint64_t active_sensors() const { return active_mask_.load(); }
+
+    /**
+     * @brief 周期完成 (sensor_idx, 该传感器的累计周期数), 在 io 线程上发出
+     */
+    boost::signals2::signal<void(uint8_t, uint64_t)> on_cycle_complete;
+
+private:
+    struct SensorState {
+        int last_step = -1;
+        bool in_cycle = false;      // 已见到本周期的第 0 步且尚未计数
+        bool has_completed = false; // last_complete_tick 有效
+        uint32_t last_complete_tick = 0;
+    };
+
+    void push(const SensorSample& sample);
+    void complete(uint8_t sensor_idx, uint32_t tick_ms);
+
+    std::array<std::atomic<uint8_t>, MAX_SENSORS> profile_length_;
+    std::array<std::atomic<uint8_t>, MAX_SENSORS> pending_length_;  // 下一次第 0 步生效, 0 = 无
+    std::array<std::atomic<uint64_t>, MAX_SENSORS> cycles_;
+    std::array<std::atomic<uint64_t>, MAX_SENSORS> started_;
+    std::array<SensorState, MAX_SENSORS> state_{};  // 仅 io 线程
+    std::atomic<uint64_t> active_mask_{0};
+    std::atomic<uint64_t> restart_mask_{0};         // 待作废进行中周期的传感器
+    std::atomic<uint32_t> mean_period_ms_{0};       // 仅 io 线程写
+    uint32_t last_seq_ = 0;
+};
+
+} // namespace hal
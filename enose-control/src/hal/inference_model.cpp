@@ -0,0 +1,155 @@
+#include "hal/inference_model.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace hal {
+
+namespace {
+
+std::mutex& backends_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::map<std::string, InferenceBackendFactory>& backends() {
+    static std::map<std::string, InferenceBackendFactory> registry = {
+        {".json", [](const std::string& path) -> std::unique_ptr<InferenceModel> { return DenseModel::load(path); }},
+    };
+    return registry;
+}
+
+} // namespace
+
+void register_inference_backend(const std::string& extension, InferenceBackendFactory factory) {
+    std::lock_guard<std::mutex> lock(backends_mutex());
+    backends()[extension] = std::move(factory);
+}
+
+std::unique_ptr<InferenceModel> load_inference_model(const std::string& path) {
+    const std::string extension = std::filesystem::path(path).extension().string();
+    InferenceBackendFactory factory;
+    {
+        std::lock_guard<std::mutex> lock(backends_mutex());
+        auto it = backends().find(extension);
+        if (it == backends().end()) {
+            throw std::runtime_error("no inference backend for '" + extension + "' (" + path + ")");
+        }
+        factory = it->second;
+    }
+    auto model = factory(path);
+    if (!model || model->input_size() == 0 || model->labels().empty()) {
+        throw std::runtime_error("invalid model: " + path);
+    }
+    return model;
+}
+
+std::unique_ptr<DenseModel> DenseModel::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("cannot open model file: " + path);
+    }
+    const auto j = nlohmann::json::parse(file);
+
+    auto model = std::make_unique<DenseModel>();
+    model->name_ = j.value("name", std::filesystem::path(path).stem().string());
+    model->steps_ = j.value("steps", std::size_t{0});
+    model->sensors_ = j.value("sensors", std::size_t{0});
+    model->normalized_ = j.value("input", std::string("normalized")) != "resistance";
+    j.at("labels").get_to(model->labels_);
+
+    for (const auto& jl : j.at("layers")) {
+        Layer layer;
+        const auto& rows = jl.at("weights");
+        layer.outputs = rows.size();
+        layer.inputs = layer.outputs > 0 ? rows.at(0).size() : 0;
+        if (layer.outputs == 0 || layer.inputs == 0) {
+            throw std::runtime_error("empty layer in " + path);
+        }
+        if (!model->layers_.empty() && model->layers_.back().outputs != layer.inputs) {
+            throw std::runtime_error("layer shape mismatch in " + path);
+        }
+        layer.weights.reserve(layer.outputs * layer.inputs);
+        for (const auto& row : rows) {
+            if (row.size() != layer.inputs) {
+                throw std::runtime_error("ragged weights in " + path);
+            }
+            for (const auto& w : row) layer.weights.push_back(w.get<float>());
+        }
+        layer.bias.assign(layer.outputs, 0.0f);
+        if (jl.contains("bias")) {
+            jl.at("bias").get_to(layer.bias);
+            if (layer.bias.size() != layer.outputs) {
+                throw std::runtime_error("bias size mismatch in " + path);
+            }
+        }
+        const std::string activation = jl.value("activation", std::string("none"));
+        if (activation == "relu") layer.activation = Activation::RELU;
+        else if (activation == "sigmoid") layer.activation = Activation::SIGMOID;
+        else if (activation == "softmax") layer.activation = Activation::SOFTMAX;
+        else if (activation != "none") throw std::runtime_error("unknown activation '" + activation + "'");
+        model->layers_.push_back(std::move(layer));
+    }
+    if (model->layers_.empty() || model->layers_.back().outputs != model->labels_.size()) {
+        throw std::runtime_error("output size does not match labels in " + path);
+    }
+    if (model->steps_ * model->sensors_ != 0 && model->steps_ * model->sensors_ != model->input_size()) {
+        throw std::runtime_error("steps × sensors does not match input size in " + path);
+    }
+    return model;
+}
+
+void DenseModel::run(std::span<const float> inputs, std::size_t batch, std::span<float> scores) {
+    if (batch == 0) return;
+    std::size_t widest = 0;
+    for (const auto& layer : layers_) widest = std::max(widest, layer.outputs);
+    buffer_a_.resize(batch * widest);
+    buffer_b_.resize(batch * widest);
+
+    const float* in = inputs.data();
+    for (std::size_t l = 0; l < layers_.size(); ++l) {
+        const auto& layer = layers_[l];
+        float* out = (l % 2 == 0) ? buffer_a_.data() : buffer_b_.data();
+        for (std::size_t b = 0; b < batch; ++b) {
+            const float* x = in + b * layer.inputs;
+            float* y = out + b * layer.outputs;
+            for (std::size_t o = 0; o < layer.outputs; ++o) {
+                const float* w = layer.weights.data() + o * layer.inputs;
+                float acc = layer.bias[o];
+                for (std::size_t i = 0; i < layer.inputs; ++i) {
+                    acc += w[i] * x[i];
+                }
+                y[o] = acc;
+            }
+            switch (layer.activation) {
+                case Activation::RELU:
+                    for (std::size_t o = 0; o < layer.outputs; ++o) y[o] = std::max(y[o], 0.0f);
+                    break;
+                case Activation::SIGMOID:
+                    for (std::size_t o = 0; o < layer.outputs; ++o) y[o] = 1.0f / (1.0f + std::exp(-y[o]));
+                    break;
+                case Activation::SOFTMAX: {
+                    const float peak = *std::max_element(y, y + layer.outputs);
+                    float sum = 0.0f;
+                    for (std::size_t o = 0; o < layer.outputs; ++o) {
+                        y[o] = std::exp(y[o] - peak);
+                        sum += y[o];
+                    }
+                    for (std::size_t o = 0; o < layer.outputs; ++o) y[o] /= sum;
+                    break;
+                }
+                case Activation::NONE:
+                    break;
+            }
+        }
+        in = out;
+    }
+    std::copy_n(in, std::min(scores.size(), batch * labels_.size()), scores.begin());
+}
+
+} // namespace hal
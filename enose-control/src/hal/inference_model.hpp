@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 设备端推理模型接口 (输入为展平的指纹矩阵, 输出为各类别得分)
+ *
+ * run() 一次处理 batch 个样本: inputs 为 batch × input_size 的行主序数组,
+ * scores 为 batch × labels().size(). 实现只需保证同一对象在单线程上调用.
+ */
+class InferenceModel {
+public:
+    virtual ~InferenceModel() = default;
+
+    virtual const std::string& name() const = 0;
+    virtual std::size_t input_size() const = 0;
+    virtual const std::vector<std::string>& labels() const = 0;
+
+    /** @brief 模型对指纹的要求 (0 = 不限), 与 FingerprintMatrix 的形状对照 */
+    virtual std::size_t steps() const { return 0; }
+    virtual std::size_t sensors() const { return 0; }
+    virtual bool normalized_input() const { return true; }  // false: 输入原始电阻
+
+    virtual void run(std::span<const float> inputs, std::size_t batch, std::span<float> scores) = 0;
+};
+
+/**
+ * @brief 按文件扩展名选择后端加载模型, 失败时抛出 std::runtime_error
+ *
+ * 内置 ".json" 全连接网络后端 (DenseModel), 不依赖外部推理库;
+ * ONNX Runtime / TFLite 等后端通过 register_inference_backend() 按扩展名接入.
+ */
+std::unique_ptr<InferenceModel> load_inference_model(const std::string& path);
+
+using InferenceBackendFactory = std::function<std::unique_ptr<InferenceModel>(const std::string& path)>;
+
+/** @brief 注册扩展名 (如 ".onnx") 对应的后端, 同名覆盖 */
+void register_inference_backend(const std::string& extension, InferenceBackendFactory factory);
+
+/**
+ * @brief JSON 描述的全连接网络
+ *
+ * @code
+ * {"name": "...", "steps": 10, "sensors": 8, "input": "normalized",
+ *  "labels": ["apple", "banana"],
+ *  "layers": [{"weights": [[...], ...], "bias": [...], "activation": "relu"},
+ *             {"weights": [[...], ...], "bias": [...], "activation": "softmax"}]}
+ * @endcode
+ * weights 为 输出 × 输入, activation 可为 none / relu / sigmoid / softmax; 最后一层输出数须等于类别数.
+ * 权重按层展平为连续数组, 整批样本逐层计算, 内层循环沿输入维度连续访问.
+ */
+class DenseModel final : public InferenceModel {
+public:
+    static std::unique_ptr<DenseModel> load(const std::string& path);
+
+    const std::string& name() const override { return name_; }
+    std::size_t input_size() const override { return layers_.empty() ? 0 : layers_.front().inputs; }
+    const std::vector<std::string>& labels() const override { return labels_; }
+    std::size_t steps() const override { return steps_; }
+    std::size_t sensors() const override { return sensors_; }
+    bool normalized_input() const override { return normalized_; }
+
+    void run(std::span<const float> inputs, std::size_t batch, std::span<float> scores) override;
+
+private:
+    enum class Activation { NONE, RELU, SIGMOID, SOFTMAX };
+
+    struct Layer {
+        std::size_t inputs = 0;
+        std::size_t outputs = 0;
+        std::vector<float> weights;     // outputs × inputs
+        std::vector<float> bias;
+        Activation activation = Activation::NONE;
+    };
+
+    std::string name_;
+    std::vector<std::string> labels_;
+    std::vector<Layer> layers_;
+    std::size_t steps_ = 0;
+    std::size_t sensors_ = 0;
+    bool normalized_ = true;
+    std::vector<float> buffer_a_, buffer_b_;  // 层间激活 (batch × 最宽层)
+};
+
+} // namespace hal
@@ -0,0 +1,206 @@
+#include "hal/inference_runner.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace hal {
+
+namespace {
+
+constexpr double LATENCY_EWMA_ALPHA = 0.1;
+
+double elapsed_ms(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+} // namespace
+
+InferenceRunner::InferenceRunner(InferenceOptions options, ResultCallback on_result)
+    : options_(std::move(options))
+    , on_result_(std::move(on_result)) {
+    options_.max_batch = std::max<std::size_t>(options_.max_batch, 1);
+    options_.queue_capacity = std::max(options_.queue_capacity, options_.max_batch);
+}
+
+InferenceRunner::~InferenceRunner() {
+    stop();
+}
+
+void InferenceRunner::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (worker_.joinable()) return;
+    stopping_ = false;
+    worker_ = std::thread(&InferenceRunner::worker_loop, this);
+}
+
+void InferenceRunner::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool InferenceRunner::submit(InferenceRequest request) {
+    if (failed_.load(std::memory_order_acquire)) return false;
+    request.submitted = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return false;
+        if (queue_.size() >= options_.queue_capacity) {
+            queue_.pop_front();
+            ++stats_.dropped;
+        }
+        queue_.push_back(std::move(request));
+        ++stats_.submitted;
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void InferenceRunner::set_limits(std::size_t max_batch, std::size_t queue_capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_.max_batch = std::max<std::size_t>(max_batch, 1);
+    options_.queue_capacity = std::max(queue_capacity, options_.max_batch);
+    while (queue_.size() > options_.queue_capacity) {
+        queue_.pop_front();
+        ++stats_.dropped;
+    }
+}
+
+InferenceRunner::Stats InferenceRunner::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool InferenceRunner::load_model() {
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        model_ = load_inference_model(options_.model_path);
+    } catch (const std::exception& e) {
+        spdlog::error("InferenceRunner: Failed to load model {}: {}", options_.model_path, e.what());
+        return false;
+    }
+
+    // 预热: 按最大批量跑一次, 之后的推理不再触发缓冲区分配
+    std::size_t max_batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_batch = options_.max_batch;
+    }
+    const std::size_t inputs = model_->input_size();
+    inputs_.assign(max_batch * inputs, 0.0f);
+    scores_.assign(max_batch * model_->labels().size(), 0.0f);
+    try {
+        model_->run(inputs_, max_batch, scores_);
+    } catch (const std::exception& e) {
+        spdlog::error("InferenceRunner: Warm-up of {} failed: {}", model_->name(), e.what());
+        return false;
+    }
+
+    input_size_.store(inputs, std::memory_order_release);
+    normalized_input_.store(model_->normalized_input(), std::memory_order_release);
+    spdlog::info("InferenceRunner: Model {} ready ({} inputs, {} labels, loaded in {:.1f} ms)",
+                 model_->name(), inputs, model_->labels().size(),
+                 elapsed_ms(start, std::chrono::steady_clock::now()));
+    return true;
+}
+
+void InferenceRunner::worker_loop() {
+    if (!load_model()) {
+        failed_.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.dropped += queue_.size();
+        queue_.clear();
+        return;
+    }
+    ready_.store(true, std::memory_order_release);
+
+    std::vector<InferenceRequest> batch;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            while (!queue_.empty() && batch.size() < options_.max_batch) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        run_batch(batch);
+        batch.clear();
+    }
+}
+
+void InferenceRunner::run_batch(std::vector<InferenceRequest>& batch) {
+    const std::size_t inputs = model_->input_size();
+    const std::size_t labels = model_->labels().size();
+
+    // 尺寸不符的请求 (加热配置与模型不一致) 不进入本批
+    auto end = std::remove_if(batch.begin(), batch.end(), [&](const InferenceRequest& r) {
+        return r.input.size() != inputs;
+    });
+    const std::size_t dropped = static_cast<std::size_t>(batch.end() - end);
+    batch.erase(end, batch.end());
+    if (dropped > 0) {
+        spdlog::warn("InferenceRunner: Dropped {} requests with input size != {}", dropped, inputs);
+    }
+    if (batch.empty()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.dropped += dropped;
+        return;
+    }
+
+    // set_limits 调大批量后首次用到时扩容
+    if (inputs_.size() < batch.size() * inputs) {
+        inputs_.resize(batch.size() * inputs);
+        scores_.resize(batch.size() * labels);
+    }
+    for (std::size_t b = 0; b < batch.size(); ++b) {
+        std::copy(batch[b].input.begin(), batch[b].input.end(), inputs_.begin() + b * inputs);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    try {
+        model_->run(std::span<const float>(inputs_.data(), batch.size() * inputs), batch.size(),
+                    std::span<float>(scores_.data(), batch.size() * labels));
+    } catch (const std::exception& e) {
+        spdlog::error("InferenceRunner: Inference failed: {}", e.what());
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.dropped += dropped + batch.size();
+        return;
+    }
+    const auto finished = std::chrono::steady_clock::now();
+    const double inference_ms = elapsed_ms(started, finished);
+
+    double last_latency_ms = 0.0;
+    for (std::size_t b = 0; b < batch.size(); ++b) {
+        InferenceResult result;
+        result.request = std::move(batch[b]);
+        result.request.input.clear();
+        result.model = model_->name();
+        result.labels = model_->labels();
+        result.scores.assign(scores_.begin() + b * labels, scores_.begin() + (b + 1) * labels);
+        result.best = static_cast<std::size_t>(
+            std::max_element(result.scores.begin(), result.scores.end()) - result.scores.begin());
+        result.label = model_->labels()[result.best];
+        result.batch_size = batch.size();
+        result.inference_ms = inference_ms;
+        result.latency_ms = elapsed_ms(result.request.submitted, finished);
+        last_latency_ms = result.latency_ms;
+        if (on_result_) on_result_(result);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.dropped += dropped;
+    stats_.completed += batch.size();
+    ++stats_.batches;
+    stats_.mean_inference_ms = stats_.batches == 1
+        ? inference_ms
+        : stats_.mean_inference_ms + LATENCY_EWMA_ALPHA * (inference_ms - stats_.mean_inference_ms);
+    stats_.last_latency_ms = last_latency_ms;
+}
+
+} // namespace hal
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "hal/inference_model.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 推理运行参数
+ */
+struct InferenceOptions {
+    std::string model_path;
+    std::size_t max_batch = 8;          // 一次 run() 合并的最多请求数
+    std::size_t queue_capacity = 32;    // 满时丢弃最旧的请求
+};
+
+/**
+ * @brief 一次推理请求 (一个完整加热周期)
+ */
+struct InferenceRequest {
+    std::string device_id;
+    std::string run_id;
+    std::string phase_name;
+    uint64_t cycle_seq = 0;
+    uint64_t frame_seq = 0;                 // 完成该周期的 StepFrame.seq
+    std::vector<float> input;               // 展平的指纹矩阵 (按模型要求为标准化值或原始电阻)
+    std::chrono::steady_clock::time_point submitted{};
+};
+
+/**
+ * @brief 一次推理结果
+ */
+struct InferenceResult {
+    InferenceRequest request;               // input 已清空
+    std::string model;                      // InferenceModel::name()
+    std::vector<std::string> labels;
+    std::vector<float> scores;              // 按 labels 顺序
+    std::size_t best = 0;
+    std::string label;                      // labels[best]
+    std::size_t batch_size = 0;             // 与本请求一起推理的请求数
+    double inference_ms = 0.0;              // 整批 run() 的耗时
+    double latency_ms = 0.0;                // 提交到得到结果的总耗时 (含排队)
+};
+
+/**
+ * @brief 在独立线程上加载模型并批量推理
+ *
+ * start() 立即返回, 模型在工作线程上加载并用一批零输入预热 (摊掉首次分配和冷缓存),
+ * 不占用 io 线程. submit() 只入队; 工作线程每次取出队列中已有的请求 (至多 max_batch 个)
+ * 拼成一批调用 InferenceModel::run(), 多块传感器板同时完成周期时即合并推理.
+ * 结果回调在工作线程上调用, 实现需线程安全.
+ */
+class InferenceRunner {
+public:
+    using ResultCallback = std::function<void(const InferenceResult&)>;
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t dropped = 0;               // 队列满或输入尺寸不符
+        uint64_t batches = 0;
+        double mean_inference_ms = 0.0;     // 每批耗时的指数滑动平均
+        double last_latency_ms = 0.0;
+    };
+
+    InferenceRunner(InferenceOptions options, ResultCallback on_result);
+    ~InferenceRunner();
+
+    InferenceRunner(const InferenceRunner&) = delete;
+    InferenceRunner& operator=(const InferenceRunner&) = delete;
+
+    void start();
+    void stop();
+
+    /** @brief 调整批量与队列上限 (配置热加载); 队列超出新上限时丢弃最旧的 */
+    void set_limits(std::size_t max_batch, std::size_t queue_capacity);
+
+    /** @brief 入队, 不阻塞; 模型加载失败时返回 false */
+    bool submit(InferenceRequest request);
+
+    /** @brief 模型已加载并完成预热 */
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+    /** @brief 模型对输入的要求, ready() 之后有效 */
+    std::size_t input_size() const { return input_size_.load(std::memory_order_acquire); }
+    bool normalized_input() const { return normalized_input_.load(std::memory_order_acquire); }
+
+    Stats stats() const;
+
+private:
+    void worker_loop();
+    bool load_model();
+    void run_batch(std::vector<InferenceRequest>& batch);
+
+    InferenceOptions options_;                  // max_batch / queue_capacity 由 mutex_ 保护
+    ResultCallback on_result_;
+    std::unique_ptr<InferenceModel> model_;     // 仅工作线程
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<InferenceRequest> queue_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    std::atomic<bool> ready_{false};
+    std::atomic<bool> failed_{false};
+    std::atomic<std::size_t> input_size_{0};
+    std::atomic<bool> normalized_input_{true};
+
+    Stats stats_;                               // mutex_ 保护
+    std::vector<float> inputs_, scores_;        // 仅工作线程
+};
+
+} // namespace hal
@@ -0,0 +1,115 @@
+#include "hal/klipper_dispenser.hpp"
+#include "hal/load_cell_driver.hpp"
+#include <spdlog/spdlog.h>
+#include <format>
+
+namespace hal {
+
+namespace {
+
+DispenseStatus::State parse_state(const std::string& state) {
+    if (state == "running") return DispenseStatus::State::RUNNING;
+    if (state == "settling") return DispenseStatus::State::SETTLING;
+    if (state == "done") return DispenseStatus::State::DONE;
+    if (state == "failed") return DispenseStatus::State::FAILED;
+    if (state == "cancelled") return DispenseStatus::State::CANCELLED;
+    return DispenseStatus::State::IDLE;
+}
+
+} // namespace
+
+const char* dispense_state_name(DispenseStatus::State state) {
+    switch (state) {
+        case DispenseStatus::State::IDLE: return "idle";
+        case DispenseStatus::State::RUNNING: return "running";
+        case DispenseStatus::State::SETTLING: return "settling";
+        case DispenseStatus::State::DONE: return "done";
+        case DispenseStatus::State::FAILED: return "failed";
+        case DispenseStatus::State::CANCELLED: return "cancelled";
+    }
+    return "unknown";
+}
+
+KlipperDispenser::KlipperDispenser(std::shared_ptr<ActuatorDriver> actuator,
+                                   std::shared_ptr<LoadCellDriver> load_cell)
+    : actuator_(std::move(actuator)), load_cell_(std::move(load_cell)) {}
+
+void KlipperDispenser::start() {
+    status_connection_ = actuator_->on_status_update.connect(
+        [this](const nlohmann::json& status) { on_status_update(status); });
+    actuator_->add_subscription(OBJECT_NAME);
+}
+
+std::string KlipperDispenser::build_command(const DispenseRequest& request) const {
+    std::string cmd = std::format("ENOSE_DISPENSE PUMP={} TARGET={:.3f}", request.pump, request.target_g);
+    if (request.coarse_speed) cmd += std::format(" COARSE_SPEED={:.3f}", *request.coarse_speed);
+    if (request.fine_speed) cmd += std::format(" FINE_SPEED={:.3f}", *request.fine_speed);
+    if (request.slowdown_g) cmd += std::format(" SLOWDOWN={:.3f}", *request.slowdown_g);
+    if (request.tolerance_g) cmd += std::format(" TOLERANCE={:.3f}", *request.tolerance_g);
+    if (request.timeout_s) cmd += std::format(" TIMEOUT={:.1f}", *request.timeout_s);
+
+    // 插件读取未校准的 force_g: 真实重量变化 = weight_scale × 读数变化,
+    // 泵行程 mm 对应的真实重量 = weight_scale × 该泵的 (在线) 标定斜率
+    if (load_cell_) {
+        const auto& config = load_cell_->get_config();
+        const int pump = request.pump.size() == 6 ? request.pump[5] - '0' : -1;
+        const float g_per_mm = config.weight_scale * load_cell_->pump_g_per_mm(pump);
+        if (config.weight_scale > 0 && g_per_mm > 0) {
+            cmd += std::format(" WEIGHT_SCALE={:.5f} MM_PER_G={:.4f}", config.weight_scale, 1.0f / g_per_mm);
+        }
+    }
+    return cmd;
+}
+
+std::future<RpcResult> KlipperDispenser::dispense(const DispenseRequest& request) {
+    auto cmd = build_command(request);
+    spdlog::info("KlipperDispenser: {}", cmd);
+    // 命令只登记 reactor 定时器即返回, 不等待定量完成
+    return actuator_->send_gcode_async(cmd, ActuatorDriver::DEFAULT_RPC_TIMEOUT, true);
+}
+
+void KlipperDispenser::cancel() {
+    actuator_->send_gcode("ENOSE_DISPENSE_CANCEL");
+}
+
+DispenseStatus KlipperDispenser::status() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+void KlipperDispenser::on_status_update(const nlohmann::json& status) {
+    auto object = status.find(OBJECT_NAME);
+    if (object == status.end() || !object->contains("dispense")) return;
+    const auto& d = (*object)["dispense"];
+    if (!d.is_object()) return;
+
+    DispenseStatus next;
+    try {
+        next.state = parse_state(d.value("state", std::string()));
+        next.id = d.value("id", 0);
+        next.pump = d.value("pump", std::string());
+        next.target_g = d.value("target_g", 0.0f);
+        next.dispensed_g = d.value("dispensed_g", 0.0f);
+        next.speed = d.value("speed", 0.0f);
+        next.message = d.value("message", std::string());
+    } catch (const std::exception& e) {
+        spdlog::warn("KlipperDispenser: Invalid dispense status: {}", e.what());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (next.state == status_.state && next.id == status_.id &&
+            next.dispensed_g == status_.dispensed_g && next.speed == status_.speed) {
+            return;
+        }
+        status_ = next;
+    }
+    if (next.finished()) {
+        spdlog::info("KlipperDispenser: Dispense {} on {} {}: {}", next.id, next.pump,
+                     dispense_state_name(next.state), next.message);
+    }
+    on_progress(next);
+}
+
+} // namespace hal
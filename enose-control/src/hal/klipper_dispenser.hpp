@@ -0,0 +1,91 @@
+#pragma once
+
+#include "hal/actuator_driver.hpp"
+#include <boost/signals2.hpp>
+#include <nlohmann/json.hpp>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace hal {
+
+class LoadCellDriver;
+
+/**
+ * @brief 按重量定量请求 (未设置的参数使用插件 [enose_control] 的配置)
+ */
+struct DispenseRequest {
+    std::string pump;                   // pump_0 ~ pump_7
+    float target_g = 0.0f;              // 真实重量 (g)
+    std::optional<float> coarse_speed;  // 快速段速度 (mm/s)
+    std::optional<float> fine_speed;    // 末段速度 (mm/s)
+    std::optional<float> slowdown_g;    // 剩余量低于该值开始减速 (g)
+    std::optional<float> tolerance_g;   // 允许误差 (g)
+    std::optional<float> timeout_s;
+};
+
+/**
+ * @brief 插件上报的定量进度 ("enose_control" 对象的 dispense 字段)
+ */
+struct DispenseStatus {
+    enum class State { IDLE, RUNNING, SETTLING, DONE, FAILED, CANCELLED };
+
+    State state = State::IDLE;
+    int id = 0;                         // 插件分配, 每次 ENOSE_DISPENSE 递增
+    std::string pump;
+    float target_g = 0.0f;
+    float dispensed_g = 0.0f;
+    float speed = 0.0f;                 // 当前泵速 (mm/s)
+    std::string message;
+
+    bool finished() const {
+        return state == State::DONE || state == State::FAILED || state == State::CANCELLED;
+    }
+};
+
+const char* dispense_state_name(DispenseStatus::State state);
+
+/**
+ * @brief 按重量闭环定量, 控制环在 Klipper 插件 (ENOSE_DISPENSE) 内运行
+ *
+ * 插件在 reactor 里直接读取 load_cell, 先快后慢地推进泵; 主机只发一条命令, 之后经
+ * Moonraker 订阅接收进度和结果, 不再每个控制周期往返两次 WebSocket.
+ * 泵速重量换算取自 LoadCellDriver 的泵校准和重量校准系数.
+ * on_progress 在 ActuatorDriver 的 strand 上发出, 相同内容不重复发出.
+ */
+class KlipperDispenser {
+public:
+    static constexpr const char* OBJECT_NAME = "enose_control";
+
+    KlipperDispenser(std::shared_ptr<ActuatorDriver> actuator, std::shared_ptr<LoadCellDriver> load_cell = nullptr);
+
+    /** @brief 订阅插件对象 */
+    void start();
+
+    /**
+     * @brief 开始定量; future 在插件接受 (或拒绝) 命令时完成, 之后的进度见 on_progress
+     */
+    std::future<RpcResult> dispense(const DispenseRequest& request);
+
+    /** @brief 取消进行中的定量 (队列中至多 0.2s 的运动仍会执行) */
+    void cancel();
+
+    DispenseStatus status() const;
+
+    boost::signals2::signal<void(const DispenseStatus&)> on_progress;
+
+private:
+    std::string build_command(const DispenseRequest& request) const;
+    void on_status_update(const nlohmann::json& status);
+
+    std::shared_ptr<ActuatorDriver> actuator_;
+    std::shared_ptr<LoadCellDriver> load_cell_;
+    boost::signals2::scoped_connection status_connection_;
+
+    mutable std::mutex mutex_;
+    DispenseStatus status_;
+};
+
+} // namespace hal
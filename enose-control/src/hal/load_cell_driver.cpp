@@ -1,19 +1,75 @@
 #include "hal/load_cell_driver.hpp"
 #include "hal/actuator_driver.hpp"
+#include "core/latency_tracer.hpp"
+#include "core/metrics.hpp"
 #include <spdlog/spdlog.h>
-#include <numeric>
 #include <cmath>
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <unistd.h>
+#include <boost/asio/post.hpp>
 
 namespace hal {
 
+namespace {
+
+// 先写 <path>.tmp 并 fsync, 再改名覆盖: 写到一半断电时旧文件仍完整
+bool write_file_atomic(const std::filesystem::path& path, const std::string& content) {
+    auto parent = path.parent_path();
+    if (!parent.empty() && !std::filesystem::exists(parent)) {
+        std::filesystem::create_directories(parent);
+    }
+    
+    const std::string temp = path.string() + ".tmp";
+    std::FILE* out = std::fopen(temp.c_str(), "wb");
+    if (!out) {
+        spdlog::error("LoadCellDriver: Failed to open {} for writing: {}", temp, std::strerror(errno));
+        return false;
+    }
+    bool ok = std::fwrite(content.data(), 1, content.size(), out) == content.size();
+    ok = ok && std::fflush(out) == 0 && ::fsync(fileno(out)) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp, path, ec);
+    }
+    if (!ok || ec) {
+        std::filesystem::remove(temp, ec);
+        spdlog::error("LoadCellDriver: Failed to write config file {}", path.string());
+        return false;
+    }
+    return true;
+}
+
+// 在 strand 上执行 f 并等待结果 (已在 strand 上时直接执行)
+template <typename Strand, typename F>
+auto run_on_strand(const Strand& strand, F&& f) -> decltype(f()) {
+    if (strand.running_in_this_thread()) {
+        return f();
+    }
+    std::packaged_task<decltype(f())()> task(std::forward<F>(f));
+    auto result = task.get_future();
+    boost::asio::post(strand, [&task]() { task(); });
+    return result.get();
+}
+
+} // namespace
+
 LoadCellDriver::LoadCellDriver(boost::asio::io_context& io,
                                std::shared_ptr<ActuatorDriver> actuator,
                                const LoadCellConfig& config)
     : io_(io)
+    , strand_(boost::asio::make_strand(io))
     , actuator_(std::move(actuator))
     , config_(config)
+    , window_(config.filter_window_size)
+    , kalman_(config.kalman_process_noise, config.kalman_measurement_noise)
+    , pump_calibrator_(config.pump_mm_to_ml, config.pump_mm_offset)
 {
     spdlog::info("LoadCellDriver: Initialized for sensor '{}'", config_.name);
 }
@@ -26,54 +82,104 @@ void LoadCellDriver::start() {
     if (running_) return;
     running_ = true;
     
+    std::string object_name = "load_cell " + config_.name;
+    // 在 ActuatorDriver 的 strand 上只拷出 load_cell 对象, 其余处理投递到本驱动的 strand
     status_connection_ = actuator_->on_status_update.connect(
-        [this](const nlohmann::json& status) {
-            on_klipper_status(status);
+        [this, object_name](const nlohmann::json& status) {
+            auto it = status.find(object_name);
+            if (it == status.end()) return;
+            boost::asio::post(strand_, [this, load_cell = *it, received_ns = core::mono_ns()]() {
+                if (!running_) return;
+                last_push_ = std::chrono::steady_clock::now();
+                if (polling_fallback_) {
+                    polling_fallback_ = false;
+                    spdlog::info("LoadCellDriver: Push updates resumed, polling stopped");
+                }
+                on_klipper_status(load_cell, received_ns);
+            });
         });
     
-    // 启动定时轮询 (WebSocket 订阅只在值变化时推送，需要主动查询)
-    poll_timer_ = std::make_unique<boost::asio::steady_timer>(io_);
-    start_polling();
+    // 由 notify_status_update 推送驱动; 看门狗只在订阅静默时发起查询
+    actuator_->add_subscription(object_name);
+    last_push_ = std::chrono::steady_clock::now();
+    watchdog_timer_ = std::make_unique<boost::asio::steady_timer>(strand_);
+    schedule_watchdog(last_push_ + std::chrono::milliseconds(config_.push_silence_timeout_ms));
     
-    spdlog::info("LoadCellDriver: Started monitoring with polling");
+    spdlog::info("LoadCellDriver: Started monitoring via subscription '{}'", object_name);
 }
 
 void LoadCellDriver::stop() {
     if (!running_) return;
     running_ = false;
     status_connection_.disconnect();
-    if (poll_timer_) {
-        poll_timer_->cancel();
-    }
+    
+    // 结束所有进行中的等待, 阻塞调用方不会永远挂起
+    // (析构时 weak_from_this 已失效, 不再投递)
+    boost::asio::post(strand_, [weak = weak_from_this()]() {
+        auto self = weak.lock();
+        if (!self) return;
+        if (self->watchdog_timer_) {
+            self->watchdog_timer_->cancel();
+        }
+        while (!self->empty_waiters_.empty()) {
+            WaitForEmptyResult result;
+            result.error_message = "称重传感器已停止";
+            self->finish_empty_waiter(self->empty_waiters_.begin()->first, std::move(result));
+        }
+    });
     spdlog::info("LoadCellDriver: Stopped monitoring");
 }
 
-void LoadCellDriver::start_polling() {
-    if (!running_) return;
-    
-    // 查询 load_cell 对象状态
-    std::string object_name = "load_cell " + config_.name;
-    actuator_->query_object(object_name, [this](const nlohmann::json& response) {
-        on_poll_response(response);
-    });
-    
-    // 每 200ms 轮询一次
-    poll_timer_->expires_after(std::chrono::milliseconds(200));
-    poll_timer_->async_wait([this](const boost::system::error_code& ec) {
+void LoadCellDriver::schedule_watchdog(std::chrono::steady_clock::time_point deadline) {
+    watchdog_timer_->expires_at(deadline);
+    watchdog_timer_->async_wait([this](const boost::system::error_code& ec) {
         if (!ec && running_) {
-            start_polling();
+            schedule_watchdog(on_watchdog());
         }
     });
 }
 
-void LoadCellDriver::on_poll_response(const nlohmann::json& response) {
+std::chrono::steady_clock::time_point LoadCellDriver::on_watchdog() {
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = std::chrono::milliseconds(config_.push_silence_timeout_ms);
+    auto silence = now - last_push_;
+    // 超时前收到过推送: 不轮询, 顺延到新的超时时刻
+    if (silence < timeout) return last_push_ + timeout;
+    const auto next_poll = now + std::chrono::milliseconds(config_.fallback_poll_interval_ms);
+    
+    // 读数不变时 Klipper 不推送, 轮询一次确认传感器仍在线
+    if (!polling_fallback_) {
+        polling_fallback_ = true;
+        spdlog::debug("LoadCellDriver: No push update for {}ms, falling back to polling",
+                      std::chrono::duration_cast<std::chrono::milliseconds>(silence).count());
+    }
+    // 出错的 RPC 不会回调, 超时后视为丢失
+    if (poll_in_flight_ && now - poll_sent_ < timeout) return next_poll;
+    if (!actuator_->is_connected()) return next_poll;
+    
+    poll_in_flight_ = true;
+    poll_sent_ = now;
+    actuator_->query_object("load_cell " + config_.name, [this](const nlohmann::json& response) {
+        boost::asio::post(strand_, [this, response, received_ns = core::mono_ns()]() {
+            poll_in_flight_ = false;
+            if (running_) {
+                on_poll_response(response, received_ns);
+            }
+        });
+    });
+    return next_poll;
+}
+
+void LoadCellDriver::on_poll_response(const nlohmann::json& response, uint64_t received_ns) {
     try {
         if (!response.contains("result") || !response["result"].contains("status")) {
             return;
         }
         
         const auto& status = response["result"]["status"];
-        on_klipper_status(status);
+        auto it = status.find("load_cell " + config_.name);
+        if (it == status.end()) return;
+        on_klipper_status(*it, received_ns);
     } catch (const std::exception& e) {
         spdlog::warn("LoadCellDriver: Failed to parse poll response: {}", e.what());
     }
@@ -87,13 +193,12 @@ void LoadCellDriver::tare() {
     spdlog::info("LoadCellDriver: Tare executed, offset = {:.2f}g", tare_offset_);
 }
 
-void LoadCellDriver::on_klipper_status(const nlohmann::json& status) {
+void LoadCellDriver::on_klipper_status(const nlohmann::json& lc, uint64_t received_ns) {
+    // 整个进程共用一个直方图, 第一次调用时注册
+    static core::Histogram& check_latency = core::MetricsRegistry::instance().histogram(
+        "load_cell_overflow_check_latency_seconds",
+        "Time from a Moonraker load cell update to the completed overflow check");
     try {
-        std::string key = "load_cell " + config_.name;
-        if (!status.contains(key)) return;
-        
-        const auto& lc = status[key];
-        
         // 读取原始百分比
         if (lc.contains("raw_sample")) {
             // raw_sample 是 -1.0 到 1.0 的范围，转换为百分比
@@ -115,7 +220,10 @@ void LoadCellDriver::on_klipper_status(const nlohmann::json& status) {
             update_filter(force_g);
             compute_statistics();
             check_overflow();
+            check_latency.observe(static_cast<double>(core::mono_ns() - received_ns) / 1e9);
             check_drain_complete();
+            evaluate_empty_waiters();
+            evaluate_injection_observer();
         } else {
             status_.is_calibrated = false;
         }
@@ -130,56 +238,49 @@ void LoadCellDriver::on_klipper_status(const nlohmann::json& status) {
     }
 }
 
-void LoadCellDriver::update_filter(float new_sample) {
-    samples_.push_back(new_sample);
-    
-    while (samples_.size() > config_.filter_window_size) {
-        samples_.pop_front();
+void LoadCellDriver::set_config(const LoadCellConfig& config) {
+    config_ = config;
+    if (window_.capacity() != config_.filter_window_size) {
+        window_.set_capacity(config_.filter_window_size);
     }
+    kalman_.set_noise(config_.kalman_process_noise, config_.kalman_measurement_noise);
     
-    if (!samples_.empty()) {
-        float sum = std::accumulate(samples_.begin(), samples_.end(), 0.0f);
-        float raw_filtered = sum / static_cast<float>(samples_.size());
-        
-        // 直接使用原始测量值，不应用校准
-        // weight_scale/weight_offset 仅用于进样时的 mm->g 转换补偿
-        status_.filtered_weight = raw_filtered;
-        status_.tared_weight = status_.filtered_weight - tare_offset_;
+    PumpCalibrator::Options options;
+    options.forgetting = config_.pump_calibration_forgetting;
+    options.outlier_sigmas = config_.pump_outlier_sigmas;
+    pump_calibrator_.set_options(options);
+    pump_calibrator_.set_prior(config_.pump_mm_to_ml, config_.pump_mm_offset);
+}
+
+void LoadCellDriver::update_filter(float new_sample) {
+    window_.push(new_sample);
+    
+    // 直接使用原始测量值，不应用校准
+    // weight_scale/weight_offset 仅用于进样时的 mm->g 转换补偿
+    if (config_.filter_mode == WeightFilterMode::KALMAN) {
+        status_.filtered_weight = static_cast<float>(kalman_.update(new_sample));
+    } else {
+        status_.filtered_weight = static_cast<float>(window_.mean());
     }
+    status_.tared_weight = status_.filtered_weight - tare_offset_;
 }
 
 void LoadCellDriver::compute_statistics() {
-    if (samples_.size() < 3) {
+    if (window_.size() < 3) {
         status_.stddev = 0.0f;
         status_.is_stable = false;
         status_.trend = WeightTrend::STABLE;
         return;
     }
     
-    float mean = status_.filtered_weight;
-    float variance = 0.0f;
-    for (const auto& s : samples_) {
-        float diff = s - mean;
-        variance += diff * diff;
-    }
-    status_.stddev = std::sqrt(variance / static_cast<float>(samples_.size()));
-    
+    status_.stddev = static_cast<float>(window_.stddev());
     status_.is_stable = (status_.stddev < config_.stable_stddev_threshold);
     
-    if (samples_.size() >= config_.filter_window_size) {
-        size_t half = samples_.size() / 2;
-        float recent_sum = 0.0f, older_sum = 0.0f;
-        
-        for (size_t i = 0; i < half; ++i) {
-            older_sum += samples_[i];
-        }
-        for (size_t i = half; i < samples_.size(); ++i) {
-            recent_sum += samples_[i];
-        }
-        
-        float recent_avg = recent_sum / static_cast<float>(samples_.size() - half);
-        float older_avg = older_sum / static_cast<float>(half);
-        float delta = recent_avg - older_avg;
+    if (window_.full()) {
+        // 趋势: 窗口内回归斜率折算为前后半窗均值之差, 与 trend_threshold 的含义保持一致
+        double rate = config_.filter_mode == WeightFilterMode::KALMAN
+            ? kalman_.rate() : window_.slope();
+        float delta = static_cast<float>(rate * static_cast<double>(window_.size()) / 2.0);
         
         if (delta > config_.trend_threshold) {
             status_.trend = WeightTrend::INCREASING;
@@ -325,106 +426,279 @@ void LoadCellDriver::set_overflow_threshold(float threshold) {
 void LoadCellDriver::set_pump_calibration(float slope, float offset) {
     config_.pump_mm_to_ml = slope;
     config_.pump_mm_offset = offset;
+    // 手动标定 (线性度测试) 取代之前的在线结果
+    pump_calibrator_.set_prior(slope, offset, true);
     spdlog::info("LoadCellDriver: Pump calibration set: slope={:.4f} g/mm, offset={:.2f} g", slope, offset);
     
     // 自动保存到配置文件
-    if (save_config()) {
-        spdlog::info("LoadCellDriver: Pump calibration saved to config file");
+    persist_config();
+}
+
+// ============================================================
+// 在线泵标定
+// ============================================================
+
+float LoadCellDriver::pump_mm_for(int pump, float measured_g) const {
+    if (config_.pump_online_calibration) {
+        return pump_calibrator_.mm_for(pump, measured_g);
+    }
+    return (measured_g - config_.pump_mm_offset) / config_.pump_mm_to_ml;
+}
+
+float LoadCellDriver::pump_g_per_mm(int pump) const {
+    return config_.pump_online_calibration ? pump_calibrator_.model(pump).slope : config_.pump_mm_to_ml;
+}
+
+PumpCalibrator::Update LoadCellDriver::record_pump_injection(const std::array<float, 8>& pump_mm, float measured_g) {
+    if (!config_.pump_online_calibration) return PumpCalibrator::Update::IGNORED;
+    
+    int pump = -1;
+    for (int i = 0; i < static_cast<int>(pump_mm.size()); ++i) {
+        if (pump_mm[i] <= 0) continue;
+        if (pump >= 0) return PumpCalibrator::Update::IGNORED;  // 多泵进样无法分摊到各泵
+        pump = i;
+    }
+    if (pump < 0) return PumpCalibrator::Update::IGNORED;
+    
+    auto update = pump_calibrator_.observe(pump, pump_mm[pump], measured_g);
+    if (update == PumpCalibrator::Update::ACCEPTED) {
+        persist_config();
+    }
+    return update;
+}
+
+void LoadCellDriver::persist_config() {
+    if (config_path_.empty()) return;
+    // config_ 只在 strand 上读取; 后台任务只做文件 I/O
+    boost::asio::post(strand_, [this, self = shared_from_this()]() {
+        stage_config_save();
+        if (background_) {
+            boost::asio::post(*background_, [self]() { self->write_pending_config(); });
+        } else {
+            write_pending_config();
+        }
+    });
+}
+
+void LoadCellDriver::observe_injection(const std::array<float, 8>& pump_mm) {
+    if (!config_.pump_online_calibration) return;
+    boost::asio::post(strand_, [this, self = shared_from_this(), pump_mm]() {
+        int pumps = 0;
+        int pump = 0;
+        for (int i = 0; i < static_cast<int>(pump_mm.size()); ++i) {
+            if (pump_mm[i] > 0) {
+                ++pumps;
+                pump = i;
+            }
+        }
+        injection_observer_.reset();
+        if (pumps != 1) return;
+        if (!status_.is_stable) {
+            spdlog::debug("LoadCellDriver: Weight not stable before injection, skipping pump calibration sample");
+            return;
+        }
+        InjectionObserver observer;
+        observer.pump_mm = pump_mm;
+        observer.before_weight = status_.filtered_weight;
+        const auto model = pump_calibrator_.model(pump);
+        observer.expected_g = model.slope * pump_mm[pump] + model.offset;
+        observer.deadline = std::chrono::steady_clock::now() + INJECTION_OBSERVE_TIMEOUT;
+        injection_observer_ = observer;
+    });
+}
+
+void LoadCellDriver::evaluate_injection_observer() {
+    if (!injection_observer_) return;
+    auto& o = *injection_observer_;
+    auto now = std::chrono::steady_clock::now();
+    if (now > o.deadline) {
+        spdlog::info("LoadCellDriver: Injection did not settle in time, skipping pump calibration sample");
+        injection_observer_.reset();
+        return;
+    }
+    
+    // 重量须已上升到预期的一半以上 (泵已动作), 之后稳定 drain_stable_duration 才取值
+    const float delta = status_.filtered_weight - o.before_weight;
+    const bool rising_done = delta >= std::max(0.5f * o.expected_g, config_.stable_stddev_threshold);
+    if (!rising_done || !status_.is_stable || status_.trend != WeightTrend::STABLE) {
+        o.settled_since.reset();
+        return;
+    }
+    if (!o.settled_since) {
+        o.settled_since = now;
+        return;
     }
+    if (std::chrono::duration<float>(now - *o.settled_since).count() < config_.drain_stable_duration) return;
+    
+    const auto pump_mm = o.pump_mm;
+    injection_observer_.reset();
+    record_pump_injection(pump_mm, delta);
 }
 
 // ============================================================
 // 动态空瓶值方法实现
 // ============================================================
 
+uint64_t LoadCellDriver::async_wait_for_empty_bottle(
+    float tolerance, float timeout_sec, float stability_window_sec, WaitForEmptyCallback callback) {
+    
+    uint64_t wait_id = next_wait_id_++;
+    boost::asio::post(strand_, [this, wait_id, tolerance, timeout_sec, stability_window_sec,
+                            callback = std::move(callback)]() mutable {
+        if (!running_) {
+            WaitForEmptyResult result;
+            result.error_message = "称重传感器未运行";
+            callback(result);
+            return;
+        }
+        
+        EmptyWaiter waiter;
+        // 获取参考空瓶值：优先使用动态值
+        waiter.reference_weight = dynamic_empty_weight_.value_or(0.0f);
+        waiter.tolerance = tolerance;
+        waiter.stability_window_sec = stability_window_sec;
+        waiter.last_weight = status_.filtered_weight;
+        waiter.started = std::chrono::steady_clock::now();
+        waiter.predictor.reset(dynamic_empty_weight_);
+        waiter.callback = std::move(callback);
+        waiter.timeout_timer = std::make_unique<boost::asio::steady_timer>(strand_);
+        waiter.timeout_timer->expires_after(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(timeout_sec)));
+        waiter.timeout_timer->async_wait([this, wait_id](const boost::system::error_code& ec) {
+            if (ec) return;
+            spdlog::warn("LoadCellDriver: Wait for empty bottle timeout");
+            WaitForEmptyResult result;
+            result.error_message = "等待空瓶稳定超时";
+            finish_empty_waiter(wait_id, std::move(result));
+        });
+        
+        spdlog::info("LoadCellDriver: Waiting for empty bottle #{} (ref={:.1f}g, tol={:.1f}g, timeout={:.1f}s, window={:.1f}s)",
+                     wait_id, waiter.reference_weight, tolerance, timeout_sec, stability_window_sec);
+        empty_waiters_.emplace(wait_id, std::move(waiter));
+    });
+    return wait_id;
+}
+
+void LoadCellDriver::cancel_wait_for_empty(uint64_t wait_id) {
+    boost::asio::post(strand_, [this, wait_id]() {
+        WaitForEmptyResult result;
+        result.error_message = "等待已取消";
+        finish_empty_waiter(wait_id, std::move(result));
+    });
+}
+
 LoadCellDriver::WaitForEmptyResult LoadCellDriver::wait_for_empty_bottle(
     float tolerance, float timeout_sec, float stability_window_sec) {
     
-    WaitForEmptyResult result;
-    
-    // 获取参考空瓶值：优先使用动态值
-    float reference_weight = dynamic_empty_weight_.value_or(0.0f);
-    
-    spdlog::info("LoadCellDriver: Waiting for empty bottle (ref={:.1f}g, tol={:.1f}g, timeout={:.1f}s, window={:.1f}s)",
-                 reference_weight, tolerance, timeout_sec, stability_window_sec);
-    
-    auto start_time = std::chrono::steady_clock::now();
-    int stable_count = 0;
-    float last_weight = 0.0f;
-    std::optional<std::chrono::steady_clock::time_point> window_start_time;
-    float stable_weight = 0.0f;
+    auto promise = std::make_shared<std::promise<WaitForEmptyResult>>();
+    auto future = promise->get_future();
+    async_wait_for_empty_bottle(tolerance, timeout_sec, stability_window_sec,
+        [promise](const WaitForEmptyResult& result) {
+            promise->set_value(result);
+        });
+    return future.get();
+}
+
+void LoadCellDriver::finish_empty_waiter(uint64_t wait_id, WaitForEmptyResult result) {
+    auto it = empty_waiters_.find(wait_id);
+    if (it == empty_waiters_.end()) return;
+    
+    auto callback = std::move(it->second.callback);
+    it->second.timeout_timer->cancel();
+    empty_waiters_.erase(it);
+    if (callback) {
+        callback(result);
+    }
+}
+
+void LoadCellDriver::evaluate_empty_waiters() {
+    for (auto it = empty_waiters_.begin(); it != empty_waiters_.end();) {
+        auto current = it++;
+        if (evaluate_empty_waiter(current->second)) {
+            WaitForEmptyResult result;
+            result.success = true;
+            result.empty_weight = status_.filtered_weight;
+            result.predicted = current->second.predicted_done;
+            if (current->second.prediction) {
+                result.predicted_tau_s = current->second.prediction->tau_s;
+            }
+            dynamic_empty_weight_ = status_.filtered_weight;
+            finish_empty_waiter(current->first, std::move(result));
+        }
+    }
+}
+
+bool LoadCellDriver::evaluate_empty_waiter(EmptyWaiter& w) {
+    float current_weight = status_.filtered_weight;
+    auto now = std::chrono::steady_clock::now();
     
-    while (true) {
-        auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
-        if (elapsed >= timeout_sec) {
-            result.success = false;
-            result.error_message = "等待空瓶稳定超时";
-            spdlog::warn("LoadCellDriver: Wait for empty bottle timeout");
-            return result;
+    // 排废模型: 到达预测排空时刻且重量已落在渐近值附近时, 只需短的确认窗口
+    float window_sec = w.stability_window_sec;
+    if (config_.drain_prediction) {
+        const double t = std::chrono::duration<double>(now - w.started).count();
+        w.predictor.push(t, current_weight);
+        auto p = w.predictor.predict(config_.drain_settle_band);
+        if (p.valid) {
+            if (!w.prediction) {
+                spdlog::info("LoadCellDriver: Drain predicted to settle at {:.1f}g in {:.1f}s (tau={:.2f}s)",
+                             p.asymptote_g, p.remaining_s, p.tau_s);
+                on_drain_predicted(p);
+            }
+            w.prediction = p;
         }
-        
-        float current_weight = status_.filtered_weight;
-        bool is_stable = status_.is_stable;
-        
-        // 对于第一次使用（没有参考值），只需要等待稳定
-        bool is_near_reference = (reference_weight == 0.0f) || 
-                                  (std::abs(current_weight - reference_weight) <= tolerance);
-        
-        if (is_near_reference && is_stable) {
-            if (std::abs(current_weight - last_weight) < 1.0f) {
-                stable_count++;
-                if (stable_count >= 3) {
-                    // 达到稳态
-                    if (stability_window_sec <= 0) {
-                        // 不使用稳定窗口，直接更新空瓶值并返回
-                        dynamic_empty_weight_ = current_weight;
-                        result.success = true;
-                        result.empty_weight = current_weight;
-                        spdlog::info("LoadCellDriver: Empty bottle detected: {:.1f}g", current_weight);
-                        return result;
-                    }
-                    
-                    if (!window_start_time.has_value()) {
-                        window_start_time = std::chrono::steady_clock::now();
-                        stable_weight = current_weight;
-                        spdlog::info("LoadCellDriver: Stability window started ({:.1f}g)", current_weight);
-                    } else {
-                        if (std::abs(current_weight - stable_weight) >= 0.5f) {
-                            // 重量变化，刷新窗口
-                            window_start_time = std::chrono::steady_clock::now();
-                            stable_weight = current_weight;
-                            spdlog::info("LoadCellDriver: New stable state ({:.1f}g), reset window", current_weight);
-                        } else {
-                            auto window_elapsed = std::chrono::duration<float>(
-                                std::chrono::steady_clock::now() - *window_start_time).count();
-                            if (window_elapsed >= stability_window_sec) {
-                                // 窗口完成，更新空瓶值并返回
-                                dynamic_empty_weight_ = current_weight;
-                                result.success = true;
-                                result.empty_weight = current_weight;
-                                spdlog::info("LoadCellDriver: Stability window complete, empty weight: {:.1f}g", current_weight);
-                                return result;
-                            }
-                        }
-                    }
-                }
-            } else {
-                stable_count = 0;
-                if (window_start_time.has_value()) {
-                    spdlog::debug("LoadCellDriver: Weight change, reset window");
-                    window_start_time.reset();
+        if (w.prediction && t >= w.prediction->completes_at_s &&
+            std::abs(current_weight - w.prediction->asymptote_g) <= config_.drain_settle_band) {
+            window_sec = std::min(window_sec, config_.drain_verify_window);
+            if (!w.confirmed) {
+                w.confirmed = true;
+                on_drain_confirmed(*w.prediction);
+            }
+        }
+    }
+    
+    // 对于第一次使用（没有参考值），只需要等待稳定
+    bool is_near_reference = (w.reference_weight == 0.0f) ||
+                             (std::abs(current_weight - w.reference_weight) <= w.tolerance);
+    
+    bool done = false;
+    if (is_near_reference && status_.is_stable) {
+        if (std::abs(current_weight - w.last_weight) < 1.0f) {
+            w.stable_count++;
+            if (w.stable_count >= 3) {
+                // 达到稳态; 不使用稳定窗口时直接完成
+                if (w.stability_window_sec <= 0) {
+                    spdlog::info("LoadCellDriver: Empty bottle detected: {:.1f}g", current_weight);
+                    done = true;
+                } else if (!w.window_start_time.has_value()) {
+                    w.window_start_time = now;
+                    w.stable_weight = current_weight;
+                    spdlog::info("LoadCellDriver: Stability window started ({:.1f}g)", current_weight);
+                } else if (std::abs(current_weight - w.stable_weight) >= 0.5f) {
+                    // 重量变化，刷新窗口
+                    w.window_start_time = now;
+                    w.stable_weight = current_weight;
+                    spdlog::info("LoadCellDriver: New stable state ({:.1f}g), reset window", current_weight);
+                } else if (std::chrono::duration<float>(now - *w.window_start_time).count() >= window_sec) {
+                    w.predicted_done = window_sec < w.stability_window_sec;
+                    spdlog::info("LoadCellDriver: Stability window complete{}, empty weight: {:.1f}g",
+                                 w.predicted_done ? " (drain model)" : "", current_weight);
+                    done = true;
                 }
             }
         } else {
-            stable_count = 0;
-            if (window_start_time.has_value()) {
-                window_start_time.reset();
+            w.stable_count = 0;
+            if (w.window_start_time.has_value()) {
+                spdlog::debug("LoadCellDriver: Weight change, reset window");
+                w.window_start_time.reset();
             }
         }
-        
-        last_weight = current_weight;
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    } else {
+        w.stable_count = 0;
+        w.window_start_time.reset();
     }
+    
+    w.last_weight = current_weight;
+    return done;
 }
 
 void LoadCellDriver::reset_dynamic_empty_weight() {
@@ -436,10 +710,132 @@ std::optional<float> LoadCellDriver::get_dynamic_empty_weight() const {
     return dynamic_empty_weight_;
 }
 
+void LoadCellDriver::set_dynamic_empty_weight(float weight) {
+    dynamic_empty_weight_ = weight;
+    spdlog::info("LoadCellDriver: Dynamic empty weight restored to {:.2f}g", weight);
+}
+
 // ============================================================
 // 配置持久化方法实现
 // ============================================================
 
+LoadCellConfig LoadCellDriver::config_from_json(LoadCellConfig config, const nlohmann::json& j) {
+    // 加载业务配置参数
+    if (j.contains("overflow_threshold")) {
+        config.overflow_threshold = j["overflow_threshold"].get<float>();
+    }
+    if (j.contains("drain_complete_margin")) {
+        config.drain_complete_margin = j["drain_complete_margin"].get<float>();
+    }
+    if (j.contains("stable_stddev_threshold")) {
+        config.stable_stddev_threshold = j["stable_stddev_threshold"].get<float>();
+    }
+    if (j.contains("drain_prediction")) {
+        config.drain_prediction = j["drain_prediction"].get<bool>();
+    }
+    if (j.contains("drain_settle_band")) {
+        config.drain_settle_band = j["drain_settle_band"].get<float>();
+    }
+    if (j.contains("drain_verify_window")) {
+        config.drain_verify_window = j["drain_verify_window"].get<float>();
+    }
+    // 可选: 加载其他配置
+    if (j.contains("invert_reading")) {
+        config.invert_reading = j["invert_reading"].get<bool>();
+    }
+    if (j.contains("filter_window_size")) {
+        config.filter_window_size = std::max<size_t>(j["filter_window_size"].get<size_t>(), 1);
+    }
+    if (j.contains("filter_mode")) {
+        config.filter_mode = j["filter_mode"].get<std::string>() == "kalman"
+            ? WeightFilterMode::KALMAN : WeightFilterMode::MOVING_AVERAGE;
+    }
+    if (j.contains("kalman_process_noise")) {
+        config.kalman_process_noise = j["kalman_process_noise"].get<float>();
+    }
+    if (j.contains("kalman_measurement_noise")) {
+        config.kalman_measurement_noise = j["kalman_measurement_noise"].get<float>();
+    }
+    if (j.contains("pump_mm_to_ml")) {
+        config.pump_mm_to_ml = j["pump_mm_to_ml"].get<float>();
+    }
+    if (j.contains("pump_mm_offset")) {
+        config.pump_mm_offset = j["pump_mm_offset"].get<float>();
+    }
+    if (j.contains("pump_online_calibration")) {
+        config.pump_online_calibration = j["pump_online_calibration"].get<bool>();
+    }
+    if (j.contains("pump_calibration_forgetting")) {
+        config.pump_calibration_forgetting = j["pump_calibration_forgetting"].get<float>();
+    }
+    if (j.contains("pump_outlier_sigmas")) {
+        config.pump_outlier_sigmas = j["pump_outlier_sigmas"].get<float>();
+    }
+    if (j.contains("weight_scale")) {
+        config.weight_scale = j["weight_scale"].get<float>();
+    }
+    if (j.contains("weight_offset")) {
+        config.weight_offset = j["weight_offset"].get<float>();
+    }
+    return config;
+}
+
+std::vector<std::string> LoadCellDriver::validate_config_json(const nlohmann::json& j) {
+    std::vector<std::string> errors;
+    if (j.is_null()) return errors;
+    LoadCellConfig config;
+    try {
+        config = config_from_json(config, j);
+    } catch (const std::exception& e) {
+        errors.push_back(std::string("load_cell.json: ") + e.what());
+        return errors;
+    }
+    if (config.overflow_threshold <= 0.0f) errors.push_back("load_cell.json: overflow_threshold must be positive");
+    if (config.drain_complete_margin < 0.0f) errors.push_back("load_cell.json: drain_complete_margin must not be negative");
+    if (config.stable_stddev_threshold <= 0.0f) errors.push_back("load_cell.json: stable_stddev_threshold must be positive");
+    if (config.drain_settle_band <= 0.0f) errors.push_back("load_cell.json: drain_settle_band must be positive");
+    if (config.drain_verify_window < 0.0f) errors.push_back("load_cell.json: drain_verify_window must not be negative");
+    if (config.kalman_process_noise <= 0.0f || config.kalman_measurement_noise <= 0.0f) {
+        errors.push_back("load_cell.json: kalman noise must be positive");
+    }
+    if (config.pump_mm_to_ml <= 0.0f) errors.push_back("load_cell.json: pump_mm_to_ml must be positive");
+    if (config.pump_calibration_forgetting < 0.5f || config.pump_calibration_forgetting > 1.0f) {
+        errors.push_back("load_cell.json: pump_calibration_forgetting must be in [0.5, 1]");
+    }
+    if (config.pump_outlier_sigmas <= 0.0f) errors.push_back("load_cell.json: pump_outlier_sigmas must be positive");
+    if (j.contains("pump_calibration") && !j["pump_calibration"].is_array()) {
+        errors.push_back("load_cell.json: pump_calibration must be an array");
+    }
+    if (config.weight_scale <= 0.0f) errors.push_back("load_cell.json: weight_scale must be positive");
+    return errors;
+}
+
+void LoadCellDriver::apply_config_json(const nlohmann::json& j) {
+    boost::asio::post(strand_, [this, self = shared_from_this(), j]() {
+        // 驱动自己保存后文件监视触发的重新读取: 内容就是当前状态, 再加载只会回退其后的更新
+        if (j == written_config_) {
+            spdlog::debug("LoadCellDriver: Reloaded config matches last save, ignored");
+            return;
+        }
+        try {
+            set_config(config_from_json(config_, j));
+            // 标定由驱动在线更新并写回; 只有文件里的标定被改过才加载
+            if (j.contains("pump_calibration") &&
+                (!written_config_.contains("pump_calibration") ||
+                 j["pump_calibration"] != written_config_["pump_calibration"])) {
+                pump_calibrator_.load(j["pump_calibration"]);
+            }
+            written_config_ = j;
+            spdlog::info("LoadCellDriver: Config reloaded (overflow_threshold={:.1f}g, filter={}, window={})",
+                         config_.overflow_threshold,
+                         config_.filter_mode == WeightFilterMode::KALMAN ? "kalman" : "moving_average",
+                         config_.filter_window_size);
+        } catch (const std::exception& e) {
+            spdlog::error("LoadCellDriver: Failed to apply reloaded config: {}", e.what());
+        }
+    });
+}
+
 bool LoadCellDriver::load_config_from_file(const std::filesystem::path& path) {
     try {
         if (!std::filesystem::exists(path)) {
@@ -455,42 +851,20 @@ bool LoadCellDriver::load_config_from_file(const std::filesystem::path& path) {
         
         nlohmann::json j;
         file >> j;
-        
-        // 加载业务配置参数
-        if (j.contains("overflow_threshold")) {
-            config_.overflow_threshold = j["overflow_threshold"].get<float>();
-        }
-        if (j.contains("drain_complete_margin")) {
-            config_.drain_complete_margin = j["drain_complete_margin"].get<float>();
-        }
-        if (j.contains("stable_stddev_threshold")) {
-            config_.stable_stddev_threshold = j["stable_stddev_threshold"].get<float>();
-        }
-        // 可选: 加载其他配置
-        if (j.contains("invert_reading")) {
-            config_.invert_reading = j["invert_reading"].get<bool>();
-        }
-        if (j.contains("filter_window_size")) {
-            config_.filter_window_size = j["filter_window_size"].get<size_t>();
-        }
-        if (j.contains("pump_mm_to_ml")) {
-            config_.pump_mm_to_ml = j["pump_mm_to_ml"].get<float>();
-        }
-        if (j.contains("pump_mm_offset")) {
-            config_.pump_mm_offset = j["pump_mm_offset"].get<float>();
-        }
-        if (j.contains("weight_scale")) {
-            config_.weight_scale = j["weight_scale"].get<float>();
-        }
-        if (j.contains("weight_offset")) {
-            config_.weight_offset = j["weight_offset"].get<float>();
+        set_config(config_from_json(config_, j));
+        if (j.contains("pump_calibration")) {
+            pump_calibrator_.load(j["pump_calibration"]);
         }
+        written_config_ = j;
         
         config_path_ = path;
         spdlog::info("LoadCellDriver: Config loaded from {}", path.string());
         spdlog::info("  overflow_threshold: {:.1f}g", config_.overflow_threshold);
         spdlog::info("  drain_complete_margin: {:.1f}g", config_.drain_complete_margin);
         spdlog::info("  stable_stddev_threshold: {:.1f}g", config_.stable_stddev_threshold);
+        spdlog::info("  filter: {} (window={})",
+                     config_.filter_mode == WeightFilterMode::KALMAN ? "kalman" : "moving_average",
+                     config_.filter_window_size);
         spdlog::info("  pump_mm_to_ml: {:.4f} g/mm, pump_mm_offset: {:.2f} g", config_.pump_mm_to_ml, config_.pump_mm_offset);
         spdlog::info("  weight_scale: {:.4f}, weight_offset: {:.4f}g", config_.weight_scale, config_.weight_offset);
         
@@ -501,32 +875,36 @@ bool LoadCellDriver::load_config_from_file(const std::filesystem::path& path) {
     }
 }
 
+nlohmann::json LoadCellDriver::config_json() const {
+    nlohmann::json j;
+    j["overflow_threshold"] = config_.overflow_threshold;
+    j["drain_complete_margin"] = config_.drain_complete_margin;
+    j["stable_stddev_threshold"] = config_.stable_stddev_threshold;
+    j["drain_prediction"] = config_.drain_prediction;
+    j["drain_settle_band"] = config_.drain_settle_band;
+    j["drain_verify_window"] = config_.drain_verify_window;
+    j["invert_reading"] = config_.invert_reading;
+    j["filter_window_size"] = config_.filter_window_size;
+    j["filter_mode"] = config_.filter_mode == WeightFilterMode::KALMAN ? "kalman" : "moving_average";
+    j["kalman_process_noise"] = config_.kalman_process_noise;
+    j["kalman_measurement_noise"] = config_.kalman_measurement_noise;
+    j["pump_mm_to_ml"] = config_.pump_mm_to_ml;
+    j["pump_mm_offset"] = config_.pump_mm_offset;
+    j["pump_online_calibration"] = config_.pump_online_calibration;
+    j["pump_calibration_forgetting"] = config_.pump_calibration_forgetting;
+    j["pump_outlier_sigmas"] = config_.pump_outlier_sigmas;
+    j["pump_calibration"] = pump_calibrator_.to_json();
+    j["weight_scale"] = config_.weight_scale;
+    j["weight_offset"] = config_.weight_offset;
+    return j;
+}
+
 bool LoadCellDriver::save_config_to_file(const std::filesystem::path& path) const {
     try {
-        // 确保目录存在
-        auto parent = path.parent_path();
-        if (!parent.empty() && !std::filesystem::exists(parent)) {
-            std::filesystem::create_directories(parent);
-        }
-        
-        nlohmann::json j;
-        j["overflow_threshold"] = config_.overflow_threshold;
-        j["drain_complete_margin"] = config_.drain_complete_margin;
-        j["stable_stddev_threshold"] = config_.stable_stddev_threshold;
-        j["invert_reading"] = config_.invert_reading;
-        j["filter_window_size"] = config_.filter_window_size;
-        j["pump_mm_to_ml"] = config_.pump_mm_to_ml;
-        j["pump_mm_offset"] = config_.pump_mm_offset;
-        j["weight_scale"] = config_.weight_scale;
-        j["weight_offset"] = config_.weight_offset;
-        
-        std::ofstream file(path);
-        if (!file.is_open()) {
-            spdlog::error("LoadCellDriver: Failed to open config file for writing: {}", path.string());
+        auto content = run_on_strand(strand_, [this]() { return config_json().dump(2); });
+        if (!write_file_atomic(path, content)) {
             return false;
         }
-        
-        file << j.dump(2);
         spdlog::info("LoadCellDriver: Config saved to {}", path.string());
         return true;
     } catch (const std::exception& e) {
@@ -535,12 +913,38 @@ bool LoadCellDriver::save_config_to_file(const std::filesystem::path& path) cons
     }
 }
 
+void LoadCellDriver::stage_config_save() {
+    written_config_ = config_json();
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    pending_save_ = written_config_.dump(2);
+}
+
+bool LoadCellDriver::write_pending_config() {
+    // 多个保存请求串行写入, 后到的直接写最新快照; 已被别人写出时返回那次的结果
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    if (!pending_save_) {
+        return last_save_ok_;
+    }
+    try {
+        last_save_ok_ = write_file_atomic(config_path_, *pending_save_);
+    } catch (const std::exception& e) {
+        spdlog::error("LoadCellDriver: Failed to save config: {}", e.what());
+        last_save_ok_ = false;
+    }
+    pending_save_.reset();
+    if (last_save_ok_) {
+        spdlog::info("LoadCellDriver: Config saved to {}", config_path_.string());
+    }
+    return last_save_ok_;
+}
+
 bool LoadCellDriver::save_config() {
     if (config_path_.empty()) {
         spdlog::warn("LoadCellDriver: No config path set, cannot save");
         return false;
     }
-    return save_config_to_file(config_path_);
+    run_on_strand(strand_, [this]() { stage_config_save(); });
+    return write_pending_config();
 }
 
 } // namespace hal
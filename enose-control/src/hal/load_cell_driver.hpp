@@ -1,16 +1,24 @@
 #pragma once
 
+#include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/signals2.hpp>
 #include <nlohmann/json.hpp>
-#include <deque>
+#include "hal/drain_predictor.hpp"
+#include "hal/pump_calibrator.hpp"
+#include "hal/weight_filter.hpp"
 #include <chrono>
 #include <memory>
 #include <string>
+#include <array>
 #include <atomic>
 #include <filesystem>
 #include <optional>
+#include <functional>
+#include <map>
+#include <vector>
 
 namespace hal {
 
@@ -18,6 +26,9 @@ class ActuatorDriver;
 
 enum class WeightTrend { STABLE, INCREASING, DECREASING };
 
+// 滤波模式: 滑动平均 (默认) 或卡尔曼 (跟随斜坡无半窗口滞后)
+enum class WeightFilterMode { MOVING_AVERAGE, KALMAN };
+
 enum class CalibrationStep {
     IDLE,
     ZERO_POINT,
@@ -33,7 +44,10 @@ struct LoadCellConfig {
     bool invert_reading = true;
     
     // 滤波参数
-    size_t filter_window_size = 10;
+    size_t filter_window_size = 10;        // 统计窗口 (样本数)
+    WeightFilterMode filter_mode = WeightFilterMode::MOVING_AVERAGE;
+    float kalman_process_noise = 0.05f;    // g² / 样本²
+    float kalman_measurement_noise = 4.0f; // g²
     
     // 稳定检测
     float stable_stddev_threshold = 2.0f;  // g
@@ -46,9 +60,19 @@ struct LoadCellConfig {
     // 排废检测
     float drain_stable_duration = 2.0f;    // s
     
+    // 排废预测: 拟合重量衰减, 到达预测排空时刻且重量在 drain_settle_band 内时
+    // 空瓶等待只需 drain_verify_window 的确认窗口 (代替调用方的 stability_window)
+    bool drain_prediction = true;
+    float drain_settle_band = 1.0f;        // g
+    float drain_verify_window = 1.0f;      // s
+    
     // 异常跳变检测
     float jump_threshold = 50.0f;          // g
     
+    // 推送订阅静默超过该时间后回退到轮询 (ms)
+    int push_silence_timeout_ms = 1000;
+    int fallback_poll_interval_ms = 200;
+    
     // 业务参数
     float overflow_threshold = 400.0f;     // g (溢出阈值)
     float drain_complete_margin = 10.0f;   // g (排空余量)
@@ -59,6 +83,11 @@ struct LoadCellConfig {
     float pump_mm_to_ml = 0.0314f;         // g/mm (斜率)
     float pump_mm_offset = -7.34f;         // g (截距)
     
+    // 在线泵标定: 以上为先验, 每次单泵进样后按称得的重量变化逐泵修正 (PumpCalibrator)
+    bool pump_online_calibration = true;
+    float pump_calibration_forgetting = 0.98f;
+    float pump_outlier_sigmas = 4.0f;
+    
     // 重量校准系数 (测量值 -> 真实值)
     // 公式: real_weight = weight_scale * measured_weight + weight_offset
     // 由校准数据拟合得出: y = 1.2865x - 6.2513
@@ -80,6 +109,13 @@ struct LoadCellStatus {
     std::chrono::steady_clock::time_point last_update;
 };
 
+/**
+ * @brief 称重传感器 (Klipper load_cell 对象)
+ *
+ * 滤波、溢出判定、排废检测都在构造时传入的 io_context 上的 strand 里运行. 溢出判定是
+ * 安全路径: main 传入 core::PriorityExecutor 的 context, Moonraker 推送只在 ActuatorDriver
+ * 的 strand 上取出 load_cell 对象后投递过来, 主 io 线程池繁忙时判定延迟仍有界.
+ */
 class LoadCellDriver : public std::enable_shared_from_this<LoadCellDriver> {
 public:
     LoadCellDriver(boost::asio::io_context& io, 
@@ -104,7 +140,7 @@ public:
     const LoadCellConfig& get_config() const { return config_; }
     
     void set_max_bottle_weight(float weight) { config_.max_bottle_weight = weight; }
-    void set_config(const LoadCellConfig& config) { config_ = config; }
+    void set_config(const LoadCellConfig& config);
     
     // 标定相关
     void start_calibration();
@@ -118,18 +154,78 @@ public:
     void set_overflow_threshold(float threshold);
     void set_pump_calibration(float slope, float offset);  // 设置泵校准系数 (斜率, 截距)
     
+    // 在线泵标定
+    const PumpCalibrator& pump_calibrator() const { return pump_calibrator_; }
+    
+    /** @brief 目标测量重量 (未经 weight_scale) 对应的泵行程 mm: 在线标定开启时按该泵的参数 */
+    float pump_mm_for(int pump, float measured_g) const;
+    
+    /** @brief 泵每 mm 的测量重量 (g/mm) */
+    float pump_g_per_mm(int pump) const;
+    
+    /**
+     * @brief 记录一次进样 (各泵行程 mm, 称得的测量重量变化 g); 只有单泵进样参与标定
+     *
+     * 采纳后在后台执行器上保存 load_cell.json (未设置时在调用线程保存). 任意线程可调用.
+     */
+    PumpCalibrator::Update record_pump_injection(const std::array<float, 8>& pump_mm, float measured_g);
+    
+    /**
+     * @brief 观测一次即将开始的进样 (在 start_inject 之前调用)
+     *
+     * 记下当前稳定重量, 之后重量上升并稳定 drain_stable_duration 时以重量变化调用
+     * record_pump_injection; 起始不稳定、多泵或 INJECTION_OBSERVE_TIMEOUT 内未稳定时放弃.
+     * 新的观测替换进行中的观测.
+     */
+    void observe_injection(const std::array<float, 8>& pump_mm);
+    static constexpr auto INJECTION_OBSERVE_TIMEOUT = std::chrono::seconds(120);
+    
+    /** @brief 配置文件写入等阻塞操作投递到这里, 不占用驱动所在的安全线程 */
+    void set_background_executor(boost::asio::any_io_executor executor) { background_ = std::move(executor); }
+    
     // 动态空瓶值
     struct WaitForEmptyResult {
         bool success = false;
         float empty_weight = 0.0f;
         std::string error_message;
+        bool predicted = false;             // 由排废模型确认 (缩短了稳定窗口)
+        float predicted_tau_s = 0.0f;       // 指数模型的时间常数 (匀速模型为 0)
     };
+    using WaitForEmptyCallback = std::function<void(const WaitForEmptyResult&)>;
+    
+    /**
+     * @brief 异步等待空瓶稳定
+     *
+     * 在每个读数到达时判定, 满足稳定窗口立即完成; 超时由定时器触发.
+     * 回调在驱动的 strand 上执行, 不得阻塞. 可从任意线程调用.
+     * @return 等待 ID, 可用于 cancel_wait_for_empty()
+     */
+    uint64_t async_wait_for_empty_bottle(float tolerance, float timeout_sec, float stability_window_sec,
+                                         WaitForEmptyCallback callback);
+    void cancel_wait_for_empty(uint64_t wait_id);
+    
+    /**
+     * @brief 阻塞等待 (async_wait_for_empty_bottle 的同步封装, 不可在驱动的 strand 上调用)
+     */
     WaitForEmptyResult wait_for_empty_bottle(float tolerance = 30.0f, float timeout_sec = 60.0f, float stability_window_sec = 5.0f);
     void reset_dynamic_empty_weight();
     std::optional<float> get_dynamic_empty_weight() const;
+    // 从检查点恢复 (续跑中断的实验)
+    void set_dynamic_empty_weight(float weight);
     
     // 配置持久化
     bool load_config_from_file(const std::filesystem::path& path);
+    
+    /**
+     * @brief 热加载 load_cell.json: 字段覆盖到当前配置上, 投递到驱动的 strand 上替换
+     *
+     * 内容应先经 validate_config_json 检查 (由 core::Config 发布快照前调用).
+     * 与驱动最近一次写入的内容相同 (自身保存触发的重新读取) 时忽略;
+     * pump_calibration 与最近写入的相同时不重新加载, 不覆盖其后的在线标定.
+     */
+    void apply_config_json(const nlohmann::json& j);
+    static std::vector<std::string> validate_config_json(const nlohmann::json& j);
+    // 快照在 strand 上生成, 调用方线程写文件 (临时文件 + fsync + rename); 不可在热路径调用
     bool save_config_to_file(const std::filesystem::path& path) const;
     void set_config_path(const std::filesystem::path& path) { config_path_ = path; }
     bool save_config();  // 保存到默认路径
@@ -138,22 +234,45 @@ public:
     boost::signals2::signal<void(CalibrationStep, const std::string&)> on_calibration_update;
     boost::signals2::signal<void()> on_overflow_warning;
     boost::signals2::signal<void()> on_drain_complete;
+    // 空瓶等待中排废模型首次给出有效预测时 (strand 上), 用于提前准备下一步骤
+    boost::signals2::signal<void(const DrainPredictor::Prediction&)> on_drain_predicted;
+    // 到达预测排空时刻且重量落在渐近值附近, 进入短确认窗口时 (strand 上, 每次等待一次);
+    // 此后只剩 drain_verify_window 的确认, 订阅方可预先执行下一步骤的准备动作
+    boost::signals2::signal<void(const DrainPredictor::Prediction&)> on_drain_confirmed;
 
 private:
-    void on_klipper_status(const nlohmann::json& status);
+    // load_cell.json 中出现的字段覆盖到 config 上; 类型不符时抛出
+    static LoadCellConfig config_from_json(LoadCellConfig config, const nlohmann::json& j);
+    
+    // received_ns: 推送 / 查询结果到达 ActuatorDriver 的时间 (core::mono_ns), 用于统计判定延迟
+    void on_klipper_status(const nlohmann::json& load_cell, uint64_t received_ns);
     void update_filter(float new_sample);
     void compute_statistics();
     void check_overflow();
     void check_drain_complete();
-    void start_polling();
-    void on_poll_response(const nlohmann::json& response);
+    
+    struct EmptyWaiter;
+    bool evaluate_empty_waiter(EmptyWaiter& waiter);
+    void evaluate_empty_waiters();
+    void finish_empty_waiter(uint64_t wait_id, WaitForEmptyResult result);
+    void evaluate_injection_observer();
+    nlohmann::json config_json() const;     // 只在 strand 上调用
+    void stage_config_save();               // strand 上: 生成快照, 交给 write_pending_config
+    bool write_pending_config();
+    void persist_config();                  // 异步保存: 快照在 strand 上, 写文件在后台执行器
+    void schedule_watchdog(std::chrono::steady_clock::time_point deadline);
+    // 返回下一次检查的时刻: 推送正常时为最后一次推送 + 静默超时, 静默时为下一次轮询
+    std::chrono::steady_clock::time_point on_watchdog();
+    void on_poll_response(const nlohmann::json& response, uint64_t received_ns);
 
     boost::asio::io_context& io_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     std::shared_ptr<ActuatorDriver> actuator_;
     LoadCellConfig config_;
     LoadCellStatus status_;
     
-    std::deque<float> samples_;
+    RollingStats window_;
+    WeightKalmanFilter kalman_;
     float tare_offset_ = 0.0f;
     
     std::chrono::steady_clock::time_point stable_since_;
@@ -164,8 +283,13 @@ private:
     boost::signals2::connection status_connection_;
     std::atomic<bool> running_{false};
     
-    // 定时轮询
-    std::unique_ptr<boost::asio::steady_timer> poll_timer_;
+    // 推送看门狗: 定时到最后一次推送 + push_silence_timeout_ms, 期间有推送则顺延;
+    // 只有超时未收到推送时才按 fallback_poll_interval_ms 轮询
+    std::unique_ptr<boost::asio::steady_timer> watchdog_timer_;
+    std::chrono::steady_clock::time_point last_push_;
+    std::chrono::steady_clock::time_point poll_sent_;
+    bool poll_in_flight_ = false;
+    bool polling_fallback_ = false;
     
     // 标定状态
     CalibrationStep calibration_step_ = CalibrationStep::IDLE;
@@ -176,6 +300,47 @@ private:
     
     // 动态空瓶值
     std::optional<float> dynamic_empty_weight_;
+    
+    // 进行中的空瓶等待 (只在 strand 上访问)
+    struct EmptyWaiter {
+        float reference_weight = 0.0f;
+        float tolerance = 0.0f;
+        float stability_window_sec = 0.0f;
+        int stable_count = 0;
+        float last_weight = 0.0f;
+        float stable_weight = 0.0f;
+        std::optional<std::chrono::steady_clock::time_point> window_start_time;
+        std::chrono::steady_clock::time_point started;
+        DrainPredictor predictor;
+        std::optional<DrainPredictor::Prediction> prediction;  // 最近的有效拟合 (排空后窗口变平时保留)
+        bool predicted_done = false;
+        bool confirmed = false;        // 已进入短确认窗口 (on_drain_confirmed 已发出)
+        std::unique_ptr<boost::asio::steady_timer> timeout_timer;
+        WaitForEmptyCallback callback;
+    };
+    std::map<uint64_t, EmptyWaiter> empty_waiters_;
+    std::atomic<uint64_t> next_wait_id_{1};
+    
+    // 在线泵标定 (自带锁)
+    PumpCalibrator pump_calibrator_;
+    std::optional<boost::asio::any_io_executor> background_;
+    
+    // 最近一次写入 (或启动时读出) 的 load_cell.json 内容, 用于识别自身保存触发的热加载 (只在 strand 上访问)
+    nlohmann::json written_config_;
+    // 待写入的快照; 写入串行进行, 总是写最新的一份 (由 save_mutex_ 保护)
+    std::mutex save_mutex_;
+    std::optional<std::string> pending_save_;
+    bool last_save_ok_ = false;
+    
+    // 进行中的进样观测 (只在 strand 上访问)
+    struct InjectionObserver {
+        std::array<float, 8> pump_mm{};
+        float before_weight = 0.0f;
+        float expected_g = 0.0f;
+        std::chrono::steady_clock::time_point deadline;
+        std::optional<std::chrono::steady_clock::time_point> settled_since;
+    };
+    std::optional<InjectionObserver> injection_observer_;
 };
 
 } // namespace hal
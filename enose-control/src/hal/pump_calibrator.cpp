@@ -0,0 +1,142 @@
+#include "hal/pump_calibrator.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+PumpCalibrator::PumpCalibrator(float slope, float offset, Options options)
+    : options_(options), prior_slope_(slope), prior_offset_(offset) {
+    for (auto& s : pumps_) reset_locked(s);
+}
+
+void PumpCalibrator::reset_locked(State& s) const {
+    s.model = Model{};
+    s.model.slope = prior_slope_;
+    s.model.offset = prior_offset_;
+    s.p = {options_.initial_slope_var, 0.0, options_.initial_offset_var};
+    s.residual_var = 0.0;
+}
+
+void PumpCalibrator::set_prior(float slope, float offset, bool reset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prior_slope_ = slope;
+    prior_offset_ = offset;
+    for (auto& s : pumps_) {
+        if (reset || s.model.samples == 0) reset_locked(s);
+    }
+}
+
+void PumpCalibrator::set_options(const Options& options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_ = options;
+}
+
+PumpCalibrator::Update PumpCalibrator::observe(int pump, float mm, float measured_g) {
+    if (pump < 0 || pump >= PUMP_COUNT || !(mm > 0) || !(measured_g > 0)) return Update::IGNORED;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& s = pumps_[pump];
+    const double x0 = mm, x1 = 1.0;
+    const double residual = measured_g - (s.model.slope * x0 + s.model.offset);
+
+    // 离群剔除: 残差标准差有了估计之后才判定
+    const double sigma = std::max<double>(std::sqrt(s.residual_var), options_.min_sigma_g);
+    if (s.model.samples >= MIN_SAMPLES_FOR_REJECTION && std::abs(residual) > options_.outlier_sigmas * sigma) {
+        ++s.model.rejected;
+        spdlog::warn("PumpCalibrator: pump_{} rejected {:.1f}mm -> {:.2f}g (residual {:.2f}g > {:.1f} sigma)",
+                     pump, mm, measured_g, residual, options_.outlier_sigmas);
+        return Update::REJECTED;
+    }
+
+    // RLS: K = P·x / (λ + xᵀ·P·x), θ += K·r, P = (P - K·xᵀ·P) / λ
+    const double lambda = std::clamp(options_.forgetting, 0.5, 1.0);
+    auto& p = s.p;
+    const double px0 = p[0] * x0 + p[1] * x1;
+    const double px1 = p[1] * x0 + p[2] * x1;
+    const double denom = lambda + x0 * px0 + x1 * px1;
+    const double k0 = px0 / denom;
+    const double k1 = px1 / denom;
+
+    const double slope = s.model.slope + k0 * residual;
+    if (!(slope > 0)) {
+        // 拟合斜率非正说明数据不可信 (例如称重读数反向), 保留原参数
+        ++s.model.rejected;
+        spdlog::warn("PumpCalibrator: pump_{} update would make slope {:.5f}, ignored", pump, slope);
+        return Update::REJECTED;
+    }
+    s.model.slope = static_cast<float>(slope);
+    s.model.offset = static_cast<float>(s.model.offset + k1 * residual);
+    p = {(p[0] - k0 * px0) / lambda, (p[1] - k0 * px1) / lambda, (p[2] - k1 * px1) / lambda};
+
+    // 残差方差: 样本少时取均值, 之后与 RLS 同样按 λ 指数遗忘
+    ++s.model.samples;
+    const double w = std::max(1.0 / s.model.samples, 1.0 - lambda);
+    s.residual_var += w * (residual * residual - s.residual_var);
+    s.model.residual_sigma = static_cast<float>(std::sqrt(s.residual_var));
+
+    spdlog::info("PumpCalibrator: pump_{} {:.1f}mm -> {:.2f}g, model {:.5f} g/mm {:+.2f}g (n={}, sigma={:.2f}g)",
+                 pump, mm, measured_g, s.model.slope, s.model.offset, s.model.samples, s.model.residual_sigma);
+    return Update::ACCEPTED;
+}
+
+PumpCalibrator::Model PumpCalibrator::model(int pump) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pump < 0 || pump >= PUMP_COUNT) {
+        Model m;
+        m.slope = prior_slope_;
+        m.offset = prior_offset_;
+        return m;
+    }
+    return pumps_[pump].model;
+}
+
+float PumpCalibrator::mm_for(int pump, float measured_g) const {
+    const auto m = model(pump);
+    return (measured_g - m.offset) / m.slope;
+}
+
+nlohmann::json PumpCalibrator::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto out = nlohmann::json::array();
+    for (int i = 0; i < PUMP_COUNT; ++i) {
+        const auto& s = pumps_[i];
+        if (s.model.samples == 0 && s.model.rejected == 0) continue;
+        out.push_back({
+            {"pump", i},
+            {"slope", s.model.slope},
+            {"offset", s.model.offset},
+            {"samples", s.model.samples},
+            {"rejected", s.model.rejected},
+            {"residual_var", s.residual_var},
+            {"covariance", s.p},
+        });
+    }
+    return out;
+}
+
+void PumpCalibrator::load(const nlohmann::json& j) {
+    if (!j.is_array()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : j) {
+        try {
+            const int pump = entry.at("pump").get<int>();
+            if (pump < 0 || pump >= PUMP_COUNT) continue;
+            State s;
+            reset_locked(s);
+            s.model.slope = entry.at("slope").get<float>();
+            s.model.offset = entry.at("offset").get<float>();
+            s.model.samples = entry.value("samples", 0u);
+            s.model.rejected = entry.value("rejected", 0u);
+            s.residual_var = entry.value("residual_var", 0.0);
+            s.model.residual_sigma = static_cast<float>(std::sqrt(s.residual_var));
+            if (entry.contains("covariance")) s.p = entry["covariance"].get<std::array<double, 3>>();
+            if (!(s.model.slope > 0)) continue;
+            pumps_[pump] = s;
+        } catch (const std::exception& e) {
+            spdlog::warn("PumpCalibrator: Skipping invalid entry: {}", e.what());
+        }
+    }
+}
+
+} // namespace hal
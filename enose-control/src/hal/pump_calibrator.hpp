@@ -0,0 +1,78 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+namespace hal {
+
+/**
+ * @brief 每个蠕动泵的在线线性标定 (递推最小二乘)
+ *
+ * 模型与 LoadCellConfig 的全局泵标定相同: measured_weight = slope · mm + offset
+ * (measured_weight 为未经 weight_scale 校准的称重读数变化). 每次单泵进样后以
+ * (行程 mm, 称得重量变化) 更新该泵的参数, 带遗忘因子以跟随泵管老化.
+ *
+ * 离群剔除: 已有 MIN_SAMPLES_FOR_REJECTION 个样本后, 残差超过 outlier_sigmas 倍残差标准差
+ * (不低于 min_sigma_g) 的观测不参与更新 (气泡、漏液、称重受扰等).
+ * 尚无样本的泵使用全局参数 (prior). 可从任意线程调用.
+ */
+class PumpCalibrator {
+public:
+    static constexpr int PUMP_COUNT = 8;
+    static constexpr uint32_t MIN_SAMPLES_FOR_REJECTION = 3;
+
+    struct Options {
+        double forgetting = 0.98;           // 遗忘因子 λ (1 = 不遗忘)
+        float outlier_sigmas = 4.0f;
+        float min_sigma_g = 1.0f;           // 残差标准差下限 (称重噪声)
+        double initial_slope_var = 1e-5;    // 先验协方差 (g/mm)²
+        double initial_offset_var = 25.0;   // 先验协方差 g²
+    };
+
+    struct Model {
+        float slope = 0.0f;                 // g/mm
+        float offset = 0.0f;                // g
+        uint32_t samples = 0;               // 已采纳的观测
+        uint32_t rejected = 0;              // 被剔除的观测
+        float residual_sigma = 0.0f;        // 残差标准差估计 (g)
+    };
+
+    enum class Update { ACCEPTED, REJECTED, IGNORED };
+
+    PumpCalibrator(float slope, float offset) : PumpCalibrator(slope, offset, Options{}) {}
+    PumpCalibrator(float slope, float offset, Options options);
+
+    /** @brief 全局参数变化 (手动标定 / 配置加载): 尚无样本的泵跟随; reset 时清空全部在线结果 */
+    void set_prior(float slope, float offset, bool reset = false);
+    void set_options(const Options& options);
+
+    /** @brief 一次单泵进样的观测; 参数不合理 (行程/重量非正) 时忽略 */
+    Update observe(int pump, float mm, float measured_g);
+
+    Model model(int pump) const;
+
+    /** @brief 目标测量重量对应的行程 (mm), 按该泵的当前参数 */
+    float mm_for(int pump, float measured_g) const;
+
+    nlohmann::json to_json() const;
+    /** @brief 读回 to_json() 的结果; 格式错误的条目跳过 */
+    void load(const nlohmann::json& j);
+
+private:
+    struct State {
+        Model model;
+        std::array<double, 3> p{};          // 协方差 [p00, p01, p11]
+        double residual_var = 0.0;
+    };
+    void reset_locked(State& s) const;
+
+    mutable std::mutex mutex_;
+    Options options_;
+    float prior_slope_;
+    float prior_offset_;
+    std::array<State, PUMP_COUNT> pumps_;
+};
+
+} // namespace hal
@@ -0,0 +1,53 @@
+#include "hal/sensor_board_group.hpp"
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace hal {
+
+SensorBoardGroup::SensorBoardGroup(boost::asio::io_context& io, std::vector<Board> boards,
+                                   std::chrono::milliseconds merge_window)
+    : boards_(std::move(boards)), merger_(io, boards_.size(), merge_window) {
+    if (boards_.empty()) {
+        throw std::invalid_argument("SensorBoardGroup: no boards");
+    }
+
+    for (std::size_t i = 0; i < boards_.size(); ++i) {
+        auto& board = boards_[i];
+        for (std::size_t k = 0; k < i; ++k) {
+            if (boards_[k].device_id == board.device_id) {
+                throw std::invalid_argument("SensorBoardGroup: duplicate device_id " + board.device_id);
+            }
+        }
+
+        const auto index = static_cast<uint8_t>(i);
+        board.driver->set_board(index, board.device_id);
+        connections_.emplace_back(board.driver->on_readings.connect(
+            [this](std::span<const SensorSample> samples) { merger_.push(samples); }));
+        connections_.emplace_back(board.driver->on_connection_changed.connect(
+            [this, index](bool connected) { merger_.set_active(index, connected); }));
+    }
+
+    merger_.start();
+    spdlog::info("SensorBoardGroup: {} board(s), merge window {} ms", boards_.size(), merge_window.count());
+}
+
+SensorBoardGroup::~SensorBoardGroup() {
+    connections_.clear();
+}
+
+std::shared_ptr<SensorDriver> SensorBoardGroup::find(const std::string& device_id) const {
+    if (device_id.empty()) return primary();
+    for (const auto& board : boards_) {
+        if (board.device_id == device_id) return board.driver;
+    }
+    return nullptr;
+}
+
+void SensorBoardGroup::stop() {
+    merger_.stop();
+    for (auto& board : boards_) {
+        board.driver->stop();
+    }
+}
+
+} // namespace hal
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "hal/sensor_driver.hpp"
+#include "hal/sensor_merger.hpp"
+#include <boost/asio.hpp>
+#include <boost/signals2.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 同时接入的多块传感器板
+ *
+ * 每块板一个 SensorDriver (各自的 strand、重连、序号跟踪与时钟同步),
+ * 读数经 SensorMerger 合并为按采样时间排序的一条流. 板按构造顺序编号,
+ * 第 0 块为主板: 只认识单个驱动的组件 (数据分析、入库、实验流程) 继续使用 primary().
+ * 驱动的 start() / start_replay() 由调用方负责.
+ */
+class SensorBoardGroup {
+public:
+    struct Board {
+        std::string device_id;
+        std::shared_ptr<SensorDriver> driver;
+    };
+
+    SensorBoardGroup(boost::asio::io_context& io, std::vector<Board> boards,
+                     std::chrono::milliseconds merge_window);
+    ~SensorBoardGroup();
+
+    SensorBoardGroup(const SensorBoardGroup&) = delete;
+    SensorBoardGroup& operator=(const SensorBoardGroup&) = delete;
+
+    const std::vector<Board>& boards() const { return boards_; }
+    std::size_t size() const { return boards_.size(); }
+
+    const std::shared_ptr<SensorDriver>& primary() const { return boards_.front().driver; }
+
+    /** @brief 按 device_id 查找, 空字符串表示主板; 未找到返回 nullptr */
+    std::shared_ptr<SensorDriver> find(const std::string& device_id) const;
+
+    /** @brief 合并后的读数流 (SensorMerger::on_readings) */
+    SensorMerger& merger() { return merger_; }
+    const SensorMerger& merger() const { return merger_; }
+
+    /** @brief 停止合并与所有驱动 */
+    void stop();
+
+private:
+    std::vector<Board> boards_;
+    SensorMerger merger_;
+    std::vector<boost::signals2::scoped_connection> connections_;
+};
+
+} // namespace hal
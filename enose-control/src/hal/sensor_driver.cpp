@@ -1,51 +1,204 @@
 #include "hal/sensor_driver.hpp"
+#include "core/latency_tracer.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 
 namespace hal {
 
 SensorDriver::SensorDriver(boost::asio::io_context& io)
-    : io_(io), serial_(io) {}
+    : io_(io), strand_(boost::asio::make_strand(io)), serial_(strand_),
+      reconnect_timer_(strand_), clock_sync_timer_(strand_) {}
 
 SensorDriver::~SensorDriver() {
-    stop();
+    // 析构时 io_context 已不再运行处理函数, 直接关闭
+    running_ = false;
+    connected_ = false;
+    replay_ = false;
+    close_link();
 }
 
 void SensorDriver::start(const std::string& device, unsigned int baud_rate) {
+    device_ = device;
+    baud_rate_ = baud_rate;
+    running_ = true;
+    reconnect_delay_ = RECONNECT_DELAY_MIN;
+
+    // 首次打开失败不抛出, 交给重连状态机; 板子稍后插上即可恢复
+    if (!try_connect()) {
+        schedule_reconnect();
+    }
+}
+
+void SensorDriver::set_board(uint8_t index, std::string device_id) {
+    board_ = index;
+    device_id_ = std::move(device_id);
+}
+
+void SensorDriver::set_usb_serial(const std::string& usb_serial) {
+    usb_serial_ = usb_serial;
+}
+
+std::string SensorDriver::resolve_device() const {
+    if (usb_serial_.empty()) {
+        return device_;
+    }
+
+    // /dev/serial/by-id/usb-<厂商>_<产品>_<序列号>-if00-port0 ,
+    // 重新枚举后 ttyUSBn 编号可能变化, 按序列号找当前节点
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(SERIAL_BY_ID_DIR, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.find(usb_serial_) == std::string::npos) continue;
+
+        auto target = std::filesystem::canonical(entry.path(), ec);
+        if (!ec) {
+            return target.string();
+        }
+    }
+    return device_;
+}
+
+bool SensorDriver::try_connect() {
+    std::string device = resolve_device();
     try {
         serial_.open(device);
-        serial_.set_option(boost::asio::serial_port_base::baud_rate(baud_rate));
+        serial_.set_option(boost::asio::serial_port_base::baud_rate(baud_rate_));
         serial_.set_option(boost::asio::serial_port_base::character_size(8));
         serial_.set_option(boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::none));
         serial_.set_option(boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one));
         serial_.set_option(boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none));
-
-        running_ = true;
-        spdlog::info("SensorDriver: Opened {} @ {}", device, baud_rate);
-        
-        do_read();
     } catch (const std::exception& e) {
-        spdlog::error("SensorDriver: Failed to open {}: {}", device, e.what());
-        throw;
+        boost::system::error_code ignored;
+        serial_.close(ignored);
+        spdlog::warn("SensorDriver: Failed to open {}: {} (retry in {} ms)",
+                     device, e.what(), reconnect_delay_.count());
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        active_device_ = device;
+    }
+    rx_mode_ = RxMode::IDLE;
+    rx_delimited_ = false;
+    write_queue_.clear();
+    write_queue_size_ = 0;
+    reconnect_delay_ = RECONNECT_DELAY_MIN;
+    connected_ = true;
+    spdlog::info("SensorDriver: Opened {} @ {}", device, baud_rate_);
+
+    do_read();
+
+    // 重新握手: 板子在断开期间可能已重启, 格式回到 JSON;
+    // 断开期间的读数由下一条实时读数的跳号触发补发。
+    // 重启时 ready 可能在串口打开之前就已发出, 由 status 的序号范围判断
+    send_format_request();
+    write({{"cmd", "status"}, {"id", SEQ_PROBE_CMD_ID}});
+    restart_clock_sync();
+    on_connection_changed(true);
+    return true;
+}
+
+void SensorDriver::handle_disconnect(const boost::system::error_code& ec) {
+    spdlog::error("SensorDriver: Read error: {}, reconnecting", ec.message());
+    boost::system::error_code ignored;
+    serial_.close(ignored);
+    connected_ = false;
+    clock_sync_timer_.cancel();
+    heater_cycles_.reset();
+    on_connection_changed(false);
+    schedule_reconnect();
+}
+
+void SensorDriver::schedule_reconnect() {
+    if (!running_) return;
+
+    reconnect_timer_.expires_after(reconnect_delay_);
+    reconnect_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec || !running_) return;
+
+        ++reconnects_;
+        if (!try_connect()) {
+            reconnect_delay_ = std::min(reconnect_delay_ * 2, RECONNECT_DELAY_MAX);
+            schedule_reconnect();
+        }
+    });
+}
+
+void SensorDriver::start_replay(const std::string& name) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        active_device_ = "replay:" + name;
+    }
+    replay_ = true;
+    running_ = true;
+    last_seq_ = 0;
+    gaps_.clear();
+    heater_cycles_.reset();
+    clock_.reset();
+    connected_ = true;
+    spdlog::info("SensorDriver: Replaying {}", name);
+    on_connection_changed(true);
+}
+
+void SensorDriver::inject(std::span<const SensorSample> samples) {
+    if (!replay_ || !connected_) return;
+    rx_ns_ = core::mono_ns();
+    while (!samples.empty()) {
+        const std::size_t count = std::min(samples.size(), samples_.size());
+        std::copy_n(samples.begin(), count, samples_.begin());
+        frames_received_ += count;
+        dispatch_samples(count);
+        samples = samples.subspan(count);
     }
 }
 
 void SensorDriver::stop() {
     running_ = false;
+    connected_ = false;
+    replay_ = false;
+    // 定时器与串口只在 strand 上操作, io_context 多线程运行时不能在调用方线程关闭
+    boost::asio::dispatch(strand_, [this]() { close_link(); });
+}
+
+void SensorDriver::close_link() {
+    reconnect_timer_.cancel();
+    clock_sync_timer_.cancel();
     if (serial_.is_open()) {
-        serial_.close();
+        boost::system::error_code ignored;
+        serial_.close(ignored);
         spdlog::info("SensorDriver: Closed");
     }
 }
 
+SensorDriver::LinkStats SensorDriver::stats() const {
+    LinkStats s;
+    s.connected = connected_;
+    s.bytes_received = bytes_received_;
+    s.frames_received = frames_received_;
+    s.parse_errors = parse_errors_;
+    s.reconnects = reconnects_;
+    s.write_queue = write_queue_size_;
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    s.device = active_device_.empty() ? device_ : active_device_;
+    return s;
+}
+
 void SensorDriver::write(const nlohmann::json& cmd) {
-    if (!running_) return;
+    if (!connected_) return;
+    if (replay_) {
+        spdlog::debug("SensorDriver: Replay mode, dropping command {}", cmd.dump());
+        return;
+    }
 
     std::string data = cmd.dump() + "\n";
     
-    boost::asio::post(io_, [this, data]() {
+    boost::asio::post(strand_, [this, data]() {
         bool write_in_progress = !write_queue_.empty();
         write_queue_.push_back(data);
+        write_queue_size_ = write_queue_.size();
         if (!write_in_progress) {
             do_write();
         }
@@ -53,13 +206,14 @@ void SensorDriver::write(const nlohmann::json& cmd) {
 }
 
 void SensorDriver::do_write() {
-    if (!running_) return;
+    if (!connected_) return;
 
     boost::asio::async_write(serial_,
         boost::asio::buffer(write_queue_.front()),
         [this](boost::system::error_code ec, std::size_t /*length*/) {
             if (!ec) {
                 write_queue_.pop_front();
+                write_queue_size_ = write_queue_.size();
                 if (!write_queue_.empty()) {
                     do_write();
                 }
@@ -69,37 +223,364 @@ void SensorDriver::do_write() {
         });
 }
 
+void SensorDriver::set_binary_protocol(bool enable, int batch_size) {
+    binary_requested_ = enable;
+    batch_size_ = batch_size;
+    if (connected_) {
+        send_format_request();
+    }
+}
+
+void SensorDriver::send_format_request() {
+    nlohmann::json params = {{"format", binary_requested_ ? "bin" : "json"}};
+    if (binary_requested_) {
+        params["batch"] = batch_size_.load();
+    }
+    write({{"cmd", "sync"}, {"id", INTERNAL_CMD_ID}, {"params", params}});
+}
+
+void SensorDriver::set_clock_sync_interval(std::chrono::milliseconds interval) {
+    clock_sync_interval_ = interval;
+}
+
+void SensorDriver::restart_clock_sync() {
+    // 设备时钟可能已随板子重启归零, 旧模型作废
+    clock_.reset();
+    clock_sync_sent_us_ = 0;
+    clock_sync_timer_.cancel();
+    if (clock_sync_interval_.count() <= 0) return;
+    clock_sync_burst_left_ = CLOCK_SYNC_BURST;
+    schedule_clock_sync(CLOCK_SYNC_BURST_INTERVAL);
+}
+
+void SensorDriver::schedule_clock_sync(std::chrono::milliseconds delay) {
+    clock_sync_timer_.expires_after(delay);
+    clock_sync_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec || !connected_ || replay_) return;
+        send_clock_sync();
+    });
+}
+
+void SensorDriver::send_clock_sync() {
+    // 写队列非空时 t0 会包含排队时间, 稍后再发
+    if (!write_queue_.empty()) {
+        schedule_clock_sync(CLOCK_SYNC_BUSY_RETRY);
+        return;
+    }
+
+    // 未收到应答的上一次 sync 直接作废, 不等待
+    clock_sync_sent_us_ = static_cast<int64_t>(core::mono_ns() / 1000);
+    nlohmann::json cmd = {{"cmd", "sync"}, {"id", CLOCK_SYNC_CMD_ID},
+                          {"params", {{"t", clock_sync_sent_us_}}}};
+    write_queue_.push_back(cmd.dump() + "\n");
+    write_queue_size_ = write_queue_.size();
+    do_write();
+
+    if (clock_sync_burst_left_ > 0) {
+        --clock_sync_burst_left_;
+        schedule_clock_sync(CLOCK_SYNC_BURST_INTERVAL);
+    } else {
+        schedule_clock_sync(clock_sync_interval_);
+    }
+}
+
+void SensorDriver::handle_clock_sync_reply(const nlohmann::json& reply) {
+    const int64_t sent_us = clock_sync_sent_us_;
+    clock_sync_sent_us_ = 0;
+    // 固件回显 t; 与在途请求不符的是过期应答
+    if (sent_us == 0 || reply.value("t", sent_us) != sent_us) return;
+
+    uint64_t device_us = 0;
+    if (reply.contains("dev_us")) {
+        device_us = reply["dev_us"].get<uint64_t>();
+    } else if (reply.contains("tick_ms")) {
+        // 旧固件只有 32 位毫秒: 取该毫秒的中点
+        device_us = clock_.extend_tick_ms(reply["tick_ms"].get<uint32_t>()) * 1000 + 500;
+    } else {
+        return;
+    }
+
+    const int64_t recv_us = static_cast<int64_t>(rx_ns_ / 1000);
+    if (clock_.add_exchange(sent_us, device_us, recv_us)) {
+        spdlog::trace("SensorDriver: Clock sync rtt={}us", recv_us - sent_us);
+    }
+}
+
+void SensorDriver::handle_seq_probe_reply(const nlohmann::json& reply) {
+    // 旧固件的 status 不带序号
+    if (!reply.contains("seq") || last_seq_ == 0) return;
+
+    const uint32_t latest = reply["seq"].get<uint32_t>();
+    if (latest >= last_seq_) return;
+
+    // 板子最新序号比已收到的还小: 断开期间重启过, 序号从 1 重新开始。
+    // 此前到达的新读数都被当作重复丢弃了, 按历史范围整段补发
+    const uint32_t oldest = reply.value("oldest_seq", 0u);
+    spdlog::warn("SensorDriver: Board restarted while disconnected (seq {} -> {}), resetting sequence",
+                 last_seq_, latest);
+    gaps_.clear();
+    last_seq_ = latest;
+    heater_cycles_.reset();
+    heater_cycles_.set_profile_length_all(HeaterCycleTracker::DEFAULT_PROFILE_LENGTH);
+    if (oldest != 0 && oldest <= latest) {
+        gaps_.emplace_back(oldest, latest);
+        request_replay(oldest, latest);
+    }
+}
+
+void SensorDriver::request_replay(uint32_t from_seq, uint32_t to_seq) {
+    spdlog::warn("SensorDriver: Missing readings seq {}..{}, requesting replay", from_seq, to_seq);
+    write({{"cmd", "replay"}, {"id", INTERNAL_CMD_ID},
+           {"params", {{"from_seq", from_seq}, {"to_seq", to_seq}}}});
+}
+
 void SensorDriver::do_read() {
-    if (!running_) return;
+    if (!connected_) return;
 
-    boost::asio::async_read_until(serial_, read_buffer_, '\n',
+    serial_.async_read_some(boost::asio::buffer(read_buffer_),
         [this](boost::system::error_code ec, std::size_t bytes_transferred) {
             if (!ec) {
-                std::istream is(&read_buffer_);
-                std::string line;
-                std::getline(is, line);
-                
-                // Trim CR/LF
-                while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
-                    line.pop_back();
-                }
-
-                if (!line.empty()) {
-                    try {
-                        auto j = nlohmann::json::parse(line);
-                        on_packet(j);
-                    } catch (const std::exception& e) {
-                        spdlog::warn("SensorDriver: JSON parse error: '{}' -> {}", line, e.what());
-                    }
-                }
-                
+                rx_ns_ = core::mono_ns();
+                bytes_received_ += bytes_transferred;
+                process_buffer(bytes_transferred);
                 do_read();
             } else if (ec != boost::asio::error::operation_aborted) {
-                spdlog::error("SensorDriver: Read error: {}", ec.message());
-                // Simple retry mechanism or close
-                // stop(); 
+                // USB 拔出 / 板子复位: 关闭后按退避间隔重连
+                handle_disconnect(ec);
             }
         });
 }
 
+void SensorDriver::process_buffer(std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i) {
+        uint8_t c = read_buffer_[i];
+
+        switch (rx_mode_) {
+            case RxMode::IDLE:
+                if (c == '{') {
+                    rx_mode_ = RxMode::JSON_LINE;
+                    line_buffer_.assign(1, static_cast<char>(c));
+                } else if (c == 0x00) {
+                    // Frame delimiter (two in a row: empty frame)
+                    rx_delimited_ = true;
+                } else if (c == '\n' || c == '\r') {
+                    rx_delimited_ = false;
+                } else if (rx_delimited_) {
+                    rx_mode_ = RxMode::BINARY_FRAME;
+                    frame_buffer_.assign(1, c);
+                } else {
+                    // Not preceded by 0x00: text (boot log etc.), not a frame
+                    ++parse_errors_;
+                    rx_mode_ = RxMode::DISCARD;
+                }
+                break;
+
+            case RxMode::JSON_LINE:
+                if (c == '\n') {
+                    handle_line();
+                    rx_mode_ = RxMode::IDLE;
+                    rx_delimited_ = false;
+                } else if (c == 0x00 || line_buffer_.size() >= MAX_LINE_LENGTH) {
+                    spdlog::warn("SensorDriver: Dropping malformed line");
+                    ++parse_errors_;
+                    rx_mode_ = (c == 0x00) ? RxMode::IDLE : RxMode::DISCARD;
+                    rx_delimited_ = (c == 0x00);
+                } else {
+                    line_buffer_.push_back(static_cast<char>(c));
+                }
+                break;
+
+            case RxMode::BINARY_FRAME:
+                if (c == 0x00) {
+                    handle_frame();
+                    rx_mode_ = RxMode::IDLE;
+                    rx_delimited_ = true;
+                } else if (frame_buffer_.size() >= sensor_frame::MAX_ENCODED_FRAME) {
+                    // Not a frame (boot noise etc.), resync on the next delimiter
+                    spdlog::warn("SensorDriver: Dropping oversized binary frame");
+                    ++parse_errors_;
+                    rx_mode_ = (c == '\n') ? RxMode::IDLE : RxMode::DISCARD;
+                    rx_delimited_ = false;
+                } else {
+                    frame_buffer_.push_back(c);
+                }
+                break;
+
+            case RxMode::DISCARD:
+                if (c == '\n' || c == 0x00) {
+                    rx_mode_ = RxMode::IDLE;
+                    rx_delimited_ = (c == 0x00);
+                }
+                break;
+        }
+    }
+}
+
+void SensorDriver::handle_line() {
+    // Trim CR
+    while (!line_buffer_.empty() && line_buffer_.back() == '\r') {
+        line_buffer_.pop_back();
+    }
+
+    // 数据行走无分配的快速路径, 其余消息才构建 JSON DOM
+    switch (sensor_frame::parse_data_line(line_buffer_, samples_[0])) {
+        case sensor_frame::LineKind::DATA:
+            ++frames_received_;
+            dispatch_samples(1);
+            return;
+        case sensor_frame::LineKind::MALFORMED:
+            spdlog::warn("SensorDriver: Malformed data line: '{}'", line_buffer_);
+            ++parse_errors_;
+            return;
+        case sensor_frame::LineKind::OTHER:
+            break;
+    }
+
+    try {
+        auto j = nlohmann::json::parse(line_buffer_);
+        ++frames_received_;
+
+        std::string type = j.value("type", "");
+
+        // 板子重启后会回到 JSON 格式且序号从 1 重新开始, 历史已丢失;
+        // 加热配置也回到固件默认值
+        if (type == "ready") {
+            last_seq_ = 0;
+            gaps_.clear();
+            heater_cycles_.reset();
+            heater_cycles_.set_profile_length_all(HeaterCycleTracker::DEFAULT_PROFILE_LENGTH);
+            send_format_request();
+            restart_clock_sync();
+        }
+
+        if (j.value("id", 0) == SEQ_PROBE_CMD_ID) {
+            if (type == "status") {
+                handle_seq_probe_reply(j);
+            }
+            return;
+        }
+
+        if ((type == "ack" || type == "error") && j.value("id", 0) == CLOCK_SYNC_CMD_ID) {
+            if (type == "ack") {
+                handle_clock_sync_reply(j);
+            }
+            return;
+        }
+
+        // 驱动自身发出的 sync / replay 的应答不转发
+        if ((type == "ack" || type == "error") && j.value("id", 0) == INTERNAL_CMD_ID) {
+            if (type == "error") {
+                spdlog::warn("SensorDriver: Internal command failed: {}", line_buffer_);
+            }
+            // 读数帧布局在 MIN_FRAME_VERSION..FRAME_VERSION 间相同; 其他版本的板改用 JSON 数据行
+            const int frame_ver = j.value("frame_ver", sensor_frame::FRAME_VERSION);
+            if (type == "ack" && j.value("format", std::string()) == "bin" &&
+                (frame_ver < sensor_frame::MIN_FRAME_VERSION || frame_ver > sensor_frame::FRAME_VERSION)) {
+                spdlog::warn("SensorDriver: Board frame_ver {} outside supported {}..{}, using JSON lines",
+                             frame_ver, sensor_frame::MIN_FRAME_VERSION, sensor_frame::FRAME_VERSION);
+                write({{"cmd", "sync"}, {"id", INTERNAL_CMD_ID}, {"params", {{"format", "json"}}}});
+            }
+            return;
+        }
+
+        on_packet(j);
+    } catch (const std::exception& e) {
+        spdlog::warn("SensorDriver: JSON parse error: '{}' -> {}", line_buffer_, e.what());
+        ++parse_errors_;
+    }
+}
+
+void SensorDriver::handle_frame() {
+    std::size_t count = sensor_frame::decode_frame(frame_buffer_.data(), frame_buffer_.size(),
+                                                   samples_.data());
+    if (count == 0) {
+        spdlog::warn("SensorDriver: Dropping corrupt binary frame ({} bytes)", frame_buffer_.size());
+        ++parse_errors_;
+        return;
+    }
+    ++frames_received_;
+    dispatch_samples(count);
+}
+
+bool SensorDriver::accept_seq(uint32_t seq) {
+    // 旧固件不带序号
+    if (seq == 0) return true;
+
+    if (last_seq_ == 0 || seq == last_seq_ + 1) {
+        last_seq_ = seq;
+        return true;
+    }
+
+    if (seq > last_seq_) {
+        gaps_.emplace_back(last_seq_ + 1, seq - 1);
+        if (gaps_.size() > MAX_PENDING_GAPS) {
+            gaps_.pop_front();
+        }
+        request_replay(last_seq_ + 1, seq - 1);
+        last_seq_ = seq;
+        return true;
+    }
+
+    // 旧序号: 只接受落在缺口内的补发读数, 其余为重复
+    for (auto it = gaps_.begin(); it != gaps_.end(); ++it) {
+        auto [lo, hi] = *it;
+        if (seq < lo || seq > hi) continue;
+
+        if (lo == hi) {
+            gaps_.erase(it);
+        } else if (seq == lo) {
+            it->first = lo + 1;
+        } else if (seq == hi) {
+            it->second = hi - 1;
+        } else {
+            it->second = seq - 1;
+            gaps_.emplace(std::next(it), seq + 1, hi);
+        }
+        return true;
+    }
+    return false;
+}
+
+std::size_t SensorDriver::filter_sequence(std::size_t count) {
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (accept_seq(samples_[i].seq)) {
+            if (kept != i) samples_[kept] = samples_[i];
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+void SensorDriver::dispatch_samples(std::size_t count) {
+    count = filter_sequence(count);
+    if (count == 0) return;
+
+    // 设备采样时刻映射到主机 system_clock; 尚未同步时退回到达时间.
+    // 模型建立在单调时钟上, 每批重新取 system_clock 与单调时钟的差, 系统时间被校时也不影响
+    const int64_t mono_us = static_cast<int64_t>(core::mono_ns() / 1000);
+    const int64_t system_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const int64_t system_minus_mono_us = system_us - mono_us;
+    const int64_t arrival_us = static_cast<int64_t>(rx_ns_ / 1000);
+
+    // 同一数据块里靠后的读数要等前面的分发完, 这段排队也计入解码延迟
+    for (std::size_t i = 0; i < count; ++i) {
+        auto& sample = samples_[i];
+        sample.rx_ns = rx_ns_;
+        sample.board = board_;
+        sample.device_ms = clock_.extend_tick_ms(sample.tick_ms);
+        // 读数只有毫秒分辨率, 取该毫秒的中点
+        const auto host_us = clock_.to_host_us(sample.device_ms * 1000 + 500);
+        sample.host_time_us = (host_us ? *host_us : arrival_us) + system_minus_mono_us;
+    }
+    core::LatencyTracer::instance().record_since(core::LatencyStage::DECODE, rx_ns_);
+
+    heater_cycles_.push(std::span<const SensorSample>(samples_.data(), count));
+    for (std::size_t i = 0; i < count; ++i) {
+        on_reading(samples_[i]);
+    }
+    on_readings(std::span<const SensorSample>(samples_.data(), count));
+}
+
 } // namespace hal
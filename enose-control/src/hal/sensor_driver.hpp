@@ -1,12 +1,22 @@
 #pragma once
 
+#include "hal/clock_sync.hpp"
+#include "hal/heater_cycle_tracker.hpp"
+#include "hal/sensor_frame.hpp"
+#include "hal/sensor_sample.hpp"
 #include <boost/asio.hpp>
 #include <boost/signals2.hpp>
 #include <nlohmann/json.hpp>
+#include <span>
 #include <string>
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <deque>
+#include <array>
+#include <chrono>
+#include <utility>
+#include <vector>
 
 namespace hal {
 
@@ -15,13 +25,75 @@ public:
     SensorDriver(boost::asio::io_context& io);
     ~SensorDriver();
 
+    /**
+     * @brief Link counters, readable from any thread
+     */
+    struct LinkStats {
+        bool connected = false;
+        std::string device;             // 当前 (或最后一次) 打开的设备节点
+        uint64_t bytes_received = 0;
+        uint64_t frames_received = 0;   // JSON 行 + 二进制帧
+        uint64_t parse_errors = 0;      // 畸形行 / CRC 错误 / 超长帧
+        uint64_t reconnects = 0;        // 重连尝试次数
+        uint64_t write_queue = 0;       // 待写出的命令数
+    };
+
     /**
      * @brief Start the serial communication
-     * @param device Device path (e.g., /dev/ttyUSB0)
+     *
+     * If the port cannot be opened (or is lost later), the driver keeps
+     * retrying with exponential backoff (100 ms .. 5 s) and re-runs the
+     * "sync" handshake after each successful reopen.
+     *
+     * @param device Device path (e.g., /dev/ttyUSB0), fallback when no USB serial is set
      * @param baud_rate Baud rate (e.g., 115200)
      */
     void start(const std::string& device, unsigned int baud_rate);
 
+    /**
+     * @brief Locate the board by USB serial number under /dev/serial/by-id
+     *        on every (re)connect instead of using the fixed device path.
+     *        Must be called before start().
+     */
+    void set_usb_serial(const std::string& usb_serial);
+
+    /**
+     * @brief Switch to replay mode instead of opening the serial port
+     *
+     * Marks the link as connected (device "replay:<name>") and emits
+     * on_connection_changed(true); readings then arrive only through inject().
+     * Commands passed to write() are dropped. stop() leaves replay mode.
+     */
+    void start_replay(const std::string& name);
+
+    /**
+     * @brief Feed readings as if they had been received in one frame
+     *        (replay mode only, on executor()). Runs the same sequence filter,
+     *        heater cycle tracking and signals as live data.
+     */
+    void inject(std::span<const SensorSample> samples);
+
+    bool is_replay() const { return replay_; }
+
+    LinkStats stats() const;
+
+    bool is_connected() const { return connected_; }
+
+    /**
+     * @brief Tag this driver as one board of a multi-board setup.
+     *        Every reading carries SensorSample::board = index. Call before start().
+     */
+    void set_board(uint8_t index, std::string device_id);
+    uint8_t board_index() const { return board_; }
+    const std::string& device_id() const { return device_id_; }
+
+    /**
+     * @brief Strand all handlers of this driver run on (serial I/O, timers,
+     *        signals). Other components touching driver state post here,
+     *        so several drivers can share a multi-threaded io_context.
+     */
+    boost::asio::strand<boost::asio::io_context::executor_type> executor() const { return strand_; }
+
     /**
      * @brief Stop communication
      */
@@ -33,22 +105,160 @@ public:
     void write(const nlohmann::json& cmd);
 
     /**
-     * @brief Signal emitted when a valid JSON packet is received
+     * @brief Request the compact binary data format via the "sync" command.
+     *
+     * Re-sent automatically when the board reports "ready" (e.g. after reset).
+     * Old firmware ignores the request and keeps sending JSON, which is
+     * always accepted.
+     *
+     * @param batch_size Readings per batch frame (0 = one frame per reading)
+     */
+    void set_binary_protocol(bool enable, int batch_size = 0);
+
+    /**
+     * @brief Period of the two-way clock sync over the "sync" command
+     *
+     * After every (re)connect or board reset a short burst of exchanges
+     * establishes the offset, then one exchange per interval tracks drift.
+     * Readings are stamped with SensorSample::host_time_us mapped through the
+     * fitted model; until the first exchange they fall back to arrival time.
+     * Zero disables the exchanges. Must be called before start().
+     */
+    void set_clock_sync_interval(std::chrono::milliseconds interval);
+
+    ClockSync::Stats clock_stats() const { return clock_.stats(); }
+
+    /**
+     * @brief Signal emitted for every non-data JSON message
+     *        (ack / error / status / ready)
      */
     boost::signals2::signal<void(const nlohmann::json&)> on_packet;
 
+    /**
+     * @brief Signal emitted for every sensor reading, JSON or binary
+     */
+    boost::signals2::signal<void(const SensorSample&)> on_reading;
+
+    /**
+     * @brief Signal emitted once per received frame with all of its readings
+     *
+     * A batch frame yields a single call; a JSON line or single-reading frame
+     * yields a span of one. Emitted after the per-reading on_reading calls.
+     */
+    boost::signals2::signal<void(std::span<const SensorSample>)> on_readings;
+
+    /**
+     * @brief Per-sensor heater cycle counter, fed before on_reading is emitted.
+     *        Subscribe to heater_cycles().on_cycle_complete instead of
+     *        tracking heater_step in every consumer.
+     */
+    HeaterCycleTracker& heater_cycles() { return heater_cycles_; }
+
+    /**
+     * @brief Id used for commands the driver sends on its own (sync / replay).
+     *        Their ack/error replies are consumed here, not forwarded to on_packet.
+     */
+    static constexpr int INTERNAL_CMD_ID = -1;
+
+    /**
+     * @brief Id of the clock sync exchanges (replies consumed here as well)
+     */
+    static constexpr int CLOCK_SYNC_CMD_ID = -2;
+
+    /**
+     * @brief Id of the status query sent after each reconnect to read the
+     *        board's history seq range (reply consumed here as well)
+     */
+    static constexpr int SEQ_PROBE_CMD_ID = -3;
+
+    /**
+     * @brief Signal emitted when the serial link goes up (true) or down (false)
+     */
+    boost::signals2::signal<void(bool)> on_connection_changed;
+
 private:
+    // Framing state between messages: JSON lines start with '{' and end with
+    // '\n', binary frames are COBS-encoded with a 0x00 before and after them.
+    // A binary frame only starts right after a 0x00 (rx_delimited_), so boot
+    // text or line noise is never glued onto the next frame. DISCARD drops
+    // bytes up to the next delimiter after garbage so we resync on a boundary.
+    enum class RxMode { IDLE, JSON_LINE, BINARY_FRAME, DISCARD };
+
+    std::string resolve_device() const;
+    bool try_connect();
+    void handle_disconnect(const boost::system::error_code& ec);
+    void schedule_reconnect();
     void do_read();
-    void process_buffer();
+    void process_buffer(std::size_t length);
+    void handle_line();
+    void handle_frame();
+    void dispatch_samples(std::size_t count);
+    void send_format_request();
+    void restart_clock_sync();
+    void schedule_clock_sync(std::chrono::milliseconds delay);
+    void send_clock_sync();
+    void handle_clock_sync_reply(const nlohmann::json& reply);
+    void handle_seq_probe_reply(const nlohmann::json& reply);
+    void close_link();
+    std::size_t filter_sequence(std::size_t count);
+    bool accept_seq(uint32_t seq);
+    void request_replay(uint32_t from_seq, uint32_t to_seq);
     void do_write();
 
+    static constexpr std::size_t MAX_LINE_LENGTH = 4096;
+    static constexpr std::size_t MAX_PENDING_GAPS = 16;
+    static constexpr auto RECONNECT_DELAY_MIN = std::chrono::milliseconds(100);
+    static constexpr auto RECONNECT_DELAY_MAX = std::chrono::milliseconds(5000);
+    static constexpr int CLOCK_SYNC_BURST = 8;
+    static constexpr auto CLOCK_SYNC_BURST_INTERVAL = std::chrono::milliseconds(250);
+    static constexpr auto CLOCK_SYNC_BUSY_RETRY = std::chrono::milliseconds(20);
+    static constexpr const char* SERIAL_BY_ID_DIR = "/dev/serial/by-id";
+
     boost::asio::io_context& io_;
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     boost::asio::serial_port serial_;
-    boost::asio::streambuf read_buffer_;
+    boost::asio::steady_timer reconnect_timer_;
+    boost::asio::steady_timer clock_sync_timer_;
+    std::chrono::milliseconds reconnect_delay_{RECONNECT_DELAY_MIN};
+    std::string device_;
+    std::string usb_serial_;
+    unsigned int baud_rate_ = 0;
+    uint8_t board_ = 0;
+    std::string device_id_;
+    std::array<uint8_t, 512> read_buffer_;
+    RxMode rx_mode_ = RxMode::IDLE;
+    bool rx_delimited_ = false;  // last delimiter seen was 0x00 (not '\n')
     std::string line_buffer_;
+    std::vector<uint8_t> frame_buffer_;
+    std::array<SensorSample, sensor_frame::MAX_FRAME_SAMPLES> samples_;
+    uint64_t rx_ns_ = 0;                    // 当前数据块的接收时间, 打到解码出的读数上
+    std::atomic<bool> binary_requested_{false};
+    std::atomic<int> batch_size_{0};
+
+    // 序号跟踪 (仅 strand 上访问): 检测到跳号时请求板子补发,
+    // gaps_ 记录尚未补齐的闭区间, 补发或重复的读数据此去重
+    uint32_t last_seq_ = 0;
+    std::deque<std::pair<uint32_t, uint32_t>> gaps_;
+    HeaterCycleTracker heater_cycles_;
+
+    // 时钟同步 (仅 strand 上访问, clock_.stats() 除外)
+    ClockSync clock_;
+    std::chrono::milliseconds clock_sync_interval_{5000};
+    int clock_sync_burst_left_ = 0;
+    int64_t clock_sync_sent_us_ = 0;        // 在途 sync 的发出时间, 0 = 无
     
     std::deque<std::string> write_queue_;
-    std::atomic<bool> running_{false};
+    std::atomic<bool> running_{false};      // start() 之后, stop() 之前
+    std::atomic<bool> connected_{false};    // 串口当前已打开
+    std::atomic<bool> replay_{false};       // 回放模式, 不使用串口
+
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> frames_received_{0};
+    std::atomic<uint64_t> parse_errors_{0};
+    std::atomic<uint64_t> reconnects_{0};
+    std::atomic<uint64_t> write_queue_size_{0};    // write_queue_ 长度的镜像, 供其他线程读取
+    mutable std::mutex stats_mutex_;
+    std::string active_device_;
 };
 
 } // namespace hal
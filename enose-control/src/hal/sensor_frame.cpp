@@ -0,0 +1,366 @@
+#include "hal/sensor_frame.hpp"
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+namespace hal {
+namespace sensor_frame {
+
+uint16_t crc16(const uint8_t* data, std::size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (std::size_t i = 0; i < len; ++i) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int b = 0; b < 8; ++b) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                 : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+std::optional<std::size_t> cobs_decode(const uint8_t* in, std::size_t len, uint8_t* out) {
+    std::size_t in_idx = 0;
+    std::size_t out_idx = 0;
+
+    while (in_idx < len) {
+        uint8_t code = in[in_idx++];
+        if (code == 0 || in_idx + code - 1 > len) {
+            return std::nullopt;
+        }
+        for (uint8_t i = 1; i < code; ++i) {
+            out[out_idx++] = in[in_idx++];
+        }
+        // code == 0xFF 表示无隐含的 0x00; 最后一组也不追加
+        if (code != 0xFF && in_idx < len) {
+            out[out_idx++] = 0x00;
+        }
+    }
+    return out_idx;
+}
+
+void cobs_encode(const uint8_t* in, std::size_t len, std::string& out) {
+    const std::size_t base = out.size();
+    out.push_back(0);
+    std::size_t code_idx = base;
+    uint8_t code = 1;
+    for (std::size_t i = 0; i < len; ++i) {
+        if (in[i] == 0) {
+            out[code_idx] = static_cast<char>(code);
+            code_idx = out.size();
+            out.push_back(0);
+            code = 1;
+        } else {
+            out.push_back(static_cast<char>(in[i]));
+            if (++code == 0xFF) {
+                out[code_idx] = static_cast<char>(code);
+                code_idx = out.size();
+                out.push_back(0);
+                code = 1;
+            }
+        }
+    }
+    out[code_idx] = static_cast<char>(code);
+    out.push_back(0);
+}
+
+namespace {
+
+SensorSample make_sample(uint32_t seq, uint32_t tick, uint8_t sensor_idx, uint32_t sensor_id,
+                         float value, float temperature, float humidity, float pressure,
+                         uint8_t heater_step, uint8_t adc_channel, uint8_t type) {
+    SensorSample sample;
+    sample.seq = seq;
+    sample.tick_ms = tick;
+    sample.sensor_idx = sensor_idx;
+    sample.sensor_id = sensor_id;
+    sample.value = value;
+    sample.temperature = temperature;
+    sample.humidity = humidity;
+    sample.pressure = pressure;
+    sample.heater_step = heater_step;
+    sample.adc_channel = adc_channel;
+    sample.type = static_cast<SensorType>(type);
+    return sample;
+}
+
+SensorType type_from_name(std::string_view name) {
+    if (name == "mox_d") return SensorType::MOX_DIGITAL;
+    if (name == "mox_a") return SensorType::MOX_ANALOG;
+    if (name == "pid") return SensorType::PID;
+    return SensorType::UNKNOWN;
+}
+
+/**
+ * @brief 扁平 JSON 对象的游标式扫描器
+ */
+class FlatJsonScanner {
+public:
+    explicit FlatJsonScanner(std::string_view s) : s_(s) {}
+
+    void skip_ws() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' ||
+                                    s_[pos_] == '\r' || s_[pos_] == '\n')) {
+            ++pos_;
+        }
+    }
+
+    bool consume(char c) {
+        skip_ws();
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    char peek() {
+        skip_ws();
+        return pos_ < s_.size() ? s_[pos_] : '\0';
+    }
+
+    // 无转义字符串, 遇到反斜杠返回 false
+    bool read_string(std::string_view& out) {
+        if (!consume('"')) return false;
+        std::size_t start = pos_;
+        while (pos_ < s_.size() && s_[pos_] != '"') {
+            if (s_[pos_] == '\\') return false;
+            ++pos_;
+        }
+        if (pos_ >= s_.size()) return false;
+        out = s_.substr(start, pos_ - start);
+        ++pos_;
+        return true;
+    }
+
+    // 数字或 true/false/null 字面量
+    bool read_scalar(std::string_view& out) {
+        skip_ws();
+        std::size_t start = pos_;
+        while (pos_ < s_.size() && s_[pos_] != ',' && s_[pos_] != '}' &&
+               s_[pos_] != ' ' && s_[pos_] != '\t') {
+            ++pos_;
+        }
+        out = s_.substr(start, pos_ - start);
+        return !out.empty();
+    }
+
+    bool at_end() {
+        skip_ws();
+        return pos_ == s_.size();
+    }
+
+private:
+    std::string_view s_;
+    std::size_t pos_ = 0;
+};
+
+bool to_double(std::string_view token, double& out) {
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), out);
+    return ec == std::errc() && ptr == token.data() + token.size();
+}
+
+} // namespace
+
+std::size_t decode_frame(const uint8_t* encoded, std::size_t len, SensorSample* out) {
+    if (len == 0 || len > MAX_ENCODED_FRAME) {
+        return 0;
+    }
+
+    uint8_t raw[MAX_ENCODED_FRAME];
+    auto decoded = cobs_decode(encoded, len, raw);
+    if (!decoded || *decoded < 3) {
+        return 0;
+    }
+
+    std::size_t raw_len = *decoded;
+    uint16_t expected = static_cast<uint16_t>(raw[raw_len - 2] | (raw[raw_len - 1] << 8));
+    if (crc16(raw, raw_len - 2) != expected) {
+        return 0;
+    }
+
+    const uint8_t* payload = raw + 1;
+    std::size_t payload_len = raw_len - 3;
+
+    // 帧内为小端, 树莓派 (aarch64) 同为小端, 直接拷贝
+    if (raw[0] == FRAME_TYPE_READING) {
+        if (payload_len != sizeof(SensorReadingWire)) {
+            return 0;
+        }
+        SensorReadingWire w;
+        std::memcpy(&w, payload, sizeof(w));
+        out[0] = make_sample(w.seq, w.tick_ms, w.sensor_idx, w.sensor_id, w.primary_value,
+                             w.temperature, w.humidity, w.pressure,
+                             w.heater_step, w.adc_channel, w.type);
+        return 1;
+    }
+
+    if (raw[0] == FRAME_TYPE_BATCH) {
+        if (payload_len < BATCH_HEADER_SIZE) {
+            return 0;
+        }
+        std::size_t count = payload[1];
+        uint32_t base_tick;
+        uint32_t base_seq;
+        std::memcpy(&base_tick, payload + 2, sizeof(base_tick));
+        std::memcpy(&base_seq, payload + 6, sizeof(base_seq));
+        if (count > MAX_FRAME_SAMPLES ||
+            payload_len != BATCH_HEADER_SIZE + count * sizeof(SensorBatchItemWire)) {
+            return 0;
+        }
+
+        const uint8_t* p = payload + BATCH_HEADER_SIZE;
+        for (std::size_t i = 0; i < count; ++i, p += sizeof(SensorBatchItemWire)) {
+            SensorBatchItemWire w;
+            std::memcpy(&w, p, sizeof(w));
+            out[i] = make_sample(base_seq + static_cast<uint32_t>(i),
+                                 base_tick + w.tick_delta_ms, w.sensor_idx, w.sensor_id,
+                                 w.primary_value, w.temperature, w.humidity, w.pressure,
+                                 w.heater_step, w.adc_channel, w.type);
+        }
+        return count;
+    }
+
+    return 0;
+}
+
+std::string encode_frame(const SensorSample* samples, std::size_t count, bool batch) {
+    std::vector<uint8_t> raw;
+    if (!batch) {
+        SensorReadingWire wire{};
+        wire.seq = samples[0].seq;
+        wire.tick_ms = samples[0].tick_ms;
+        wire.sensor_idx = samples[0].sensor_idx;
+        wire.sensor_id = samples[0].sensor_id;
+        wire.primary_value = samples[0].value;
+        wire.temperature = samples[0].temperature;
+        wire.humidity = samples[0].humidity;
+        wire.pressure = samples[0].pressure;
+        wire.heater_step = samples[0].heater_step;
+        wire.adc_channel = samples[0].adc_channel;
+        wire.type = static_cast<uint8_t>(samples[0].type);
+        raw.resize(1 + sizeof(wire));
+        raw[0] = FRAME_TYPE_READING;
+        std::memcpy(raw.data() + 1, &wire, sizeof(wire));
+    } else {
+        const uint32_t base_tick = samples[0].tick_ms;
+        const uint32_t base_seq = samples[0].seq;
+        raw.resize(1 + BATCH_HEADER_SIZE + count * sizeof(SensorBatchItemWire));
+        raw[0] = FRAME_TYPE_BATCH;
+        raw[1] = 0;
+        raw[2] = static_cast<uint8_t>(count);
+        std::memcpy(raw.data() + 3, &base_tick, sizeof(base_tick));
+        std::memcpy(raw.data() + 7, &base_seq, sizeof(base_seq));
+        for (std::size_t i = 0; i < count; ++i) {
+            SensorBatchItemWire item{};
+            item.tick_delta_ms = static_cast<uint16_t>(samples[i].tick_ms - base_tick);
+            item.sensor_idx = samples[i].sensor_idx;
+            item.sensor_id = samples[i].sensor_id;
+            item.primary_value = samples[i].value;
+            item.temperature = samples[i].temperature;
+            item.humidity = samples[i].humidity;
+            item.pressure = samples[i].pressure;
+            item.heater_step = samples[i].heater_step;
+            item.adc_channel = samples[i].adc_channel;
+            item.type = static_cast<uint8_t>(samples[i].type);
+            std::memcpy(raw.data() + 1 + BATCH_HEADER_SIZE + i * sizeof(item), &item, sizeof(item));
+        }
+    }
+    const uint16_t crc = crc16(raw.data(), raw.size());
+    raw.push_back(static_cast<uint8_t>(crc & 0xFF));
+    raw.push_back(static_cast<uint8_t>(crc >> 8));
+
+    std::string out;
+    out.reserve(raw.size() + raw.size() / 254 + 3);
+    out.push_back('\0');
+    cobs_encode(raw.data(), raw.size(), out);
+    return out;
+}
+
+LineKind parse_data_line(std::string_view line, SensorSample& out) {
+    FlatJsonScanner scan(line);
+    out = SensorSample{};
+
+    bool is_data = false;
+    bool has_type_name = false;
+    bool ok = scan.consume('{');
+
+    while (ok && !scan.consume('}')) {
+        std::string_view key;
+        std::string_view token;
+        if (!scan.read_string(key) || !scan.consume(':')) {
+            ok = false;
+            break;
+        }
+
+        char c = scan.peek();
+        if (c == '{' || c == '[') {
+            return LineKind::OTHER;     // 嵌套结构, 不是 data 消息
+        }
+
+        if (c == '"') {
+            if (!scan.read_string(token)) {
+                ok = false;
+                break;
+            }
+            if (key == "type") {
+                if (token != "data") return LineKind::OTHER;
+                is_data = true;
+            } else if (key == "st") {
+                out.type = type_from_name(token);
+                has_type_name = true;
+            }
+        } else {
+            double v = 0;
+            if (!scan.read_scalar(token)) {
+                ok = false;
+                break;
+            }
+            if (!to_double(token, v)) {
+                // true/false/null 等字面量, data 消息中不使用
+                if (token != "true" && token != "false" && token != "null") {
+                    ok = false;
+                    break;
+                }
+            } else if (key == "seq") {
+                out.seq = static_cast<uint32_t>(v);
+            } else if (key == "tick") {
+                out.tick_ms = static_cast<uint32_t>(v);
+            } else if (key == "s") {
+                out.sensor_idx = static_cast<uint8_t>(v);
+            } else if (key == "id") {
+                out.sensor_id = static_cast<uint32_t>(v);
+            } else if (key == "v" || key == "R") {
+                out.value = static_cast<float>(v);
+            } else if (key == "gi") {
+                out.heater_step = static_cast<uint8_t>(v);
+            } else if (key == "ch") {
+                out.adc_channel = static_cast<uint8_t>(v);
+            } else if (key == "T") {
+                out.temperature = static_cast<float>(v);
+            } else if (key == "H") {
+                out.humidity = static_cast<float>(v);
+            } else if (key == "P") {
+                out.pressure = static_cast<float>(v);
+            }
+        }
+
+        if (!scan.consume(',')) {
+            if (scan.peek() != '}') ok = false;
+        }
+    }
+
+    if (!ok || !scan.at_end()) {
+        return is_data ? LineKind::MALFORMED : LineKind::OTHER;
+    }
+    if (!is_data) {
+        return LineKind::OTHER;
+    }
+    // 旧固件不带 st 字段时默认为数字 MOX
+    if (!has_type_name) {
+        out.type = SensorType::MOX_DIGITAL;
+    }
+    return LineKind::DATA;
+}
+
+} // namespace sensor_frame
+} // namespace hal
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hal {
+
+/**
+ * @brief 传感器板二进制帧 (见 enose-sensor-firmware/docs/PROTOCOL.md 4.5)
+ *
+ * COBS( [frame_type:1][payload][crc16:2] ) 0x00
+ * 布局需与固件 core/sensor_types.h / frame_codec.h 中的定义保持一致
+ */
+namespace sensor_frame {
+
+constexpr uint8_t FRAME_TYPE_READING = 0x01;
+constexpr uint8_t FRAME_TYPE_BATCH = 0x02;
+constexpr uint8_t FRAME_TYPE_CMD_HEATER = 0x10;     // 上位机 → 板: 加热曲线 (PROTOCOL.md 3.9)
+
+// 协议版本 (sync 应答的 frame_ver), 与固件 frame_codec.h 一致.
+// 3 只增加了上位机 → 板的二进制命令帧, 读数帧 / 批量帧布局与 2 相同, 两者都接受
+constexpr int FRAME_VERSION = 3;
+constexpr int MIN_FRAME_VERSION = 2;
+
+// 命令帧的 reserved 字节恒为 0, COBS 编码后首字节因此固定为 0x02
+constexpr uint8_t CMD_FRAME_LEAD = 0x02;
+constexpr std::size_t HEATER_PROFILE_MAX = 10;
+
+#pragma pack(push, 1)
+struct SensorReadingWire {
+    uint32_t seq;
+    uint32_t tick_ms;
+    uint8_t  sensor_idx;
+    uint32_t sensor_id;
+    float    primary_value;
+    float    temperature;       // NaN 表示无效
+    float    humidity;
+    float    pressure;
+    uint8_t  heater_step;
+    uint8_t  adc_channel;
+    uint8_t  type;
+};
+
+// 批量帧: [reserved:1][count:1][base_tick:4][base_seq:4][SensorBatchItemWire × count]
+// 批内序号连续, 第 i 条为 base_seq + i
+struct SensorBatchItemWire {
+    uint16_t tick_delta_ms;     // 相对 base_tick
+    uint8_t  sensor_idx;
+    uint32_t sensor_id;
+    float    primary_value;
+    float    temperature;
+    float    humidity;
+    float    pressure;
+    uint8_t  heater_step;
+    uint8_t  adc_channel;
+    uint8_t  type;
+};
+
+// FRAME_TYPE_CMD_HEATER 的帧体; sensor_mask 为 0 表示全部通道, flags bit 0 = 立即生效
+struct HeaterConfigCmdWire {
+    uint8_t  reserved;          // 恒为 0
+    int32_t  id;                // 命令 ID, 原样回显在应答中
+    uint32_t sensor_mask;
+    uint8_t  length;
+    uint8_t  flags;
+    uint16_t temps[HEATER_PROFILE_MAX];
+    uint16_t durs[HEATER_PROFILE_MAX];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SensorReadingWire) == 32, "SensorReadingWire must match firmware layout");
+static_assert(sizeof(SensorBatchItemWire) == 26, "SensorBatchItemWire must match firmware layout");
+static_assert(sizeof(HeaterConfigCmdWire) == 51, "HeaterConfigCmdWire must match firmware layout");
+
+constexpr std::size_t BATCH_HEADER_SIZE = 10;
+
+// COBS 编码后的最大帧长度 (不含 0x00 结束符), 超过则视为噪声丢弃
+constexpr std::size_t MAX_ENCODED_FRAME = 256;
+
+// 单帧可容纳的最大读数条数
+constexpr std::size_t MAX_FRAME_SAMPLES =
+    (MAX_ENCODED_FRAME - 3 - BATCH_HEADER_SIZE) / sizeof(SensorBatchItemWire);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ */
+uint16_t crc16(const uint8_t* data, std::size_t len);
+
+/**
+ * @brief COBS 解码 (输入不含 0x00 结束符)
+ * @return 解码后的长度, 格式错误返回 nullopt
+ */
+std::optional<std::size_t> cobs_decode(const uint8_t* in, std::size_t len, uint8_t* out);
+
+/**
+ * @brief 解码一帧 (单条读数或批量帧)
+ * @param encoded COBS 编码的帧 (不含 0x00 结束符)
+ * @param out     输出数组, 至少 MAX_FRAME_SAMPLES 个元素
+ * @return 解码出的读数条数, CRC/长度/类型校验失败返回 0
+ */
+std::size_t decode_frame(const uint8_t* encoded, std::size_t len, SensorSample* out);
+
+/**
+ * @brief COBS 编码并追加到 out, 末尾带 0x00 结束符 (同固件 FrameCodec::cobsEncode)
+ */
+void cobs_encode(const uint8_t* in, std::size_t len, std::string& out);
+
+/**
+ * @brief 按固件格式编码一帧, 用于模拟传感器板与基准测试
+ * @param batch false 时只编码 samples[0] 为单条读数帧; true 时编码 count 条
+ *              (不超过 MAX_FRAME_SAMPLES, 序号须连续) 为批量帧
+ * @return 0x00 + COBS 编码的帧 + 0x00 结束符 (同固件 FrameCodec::encodeReading / encodeBatch)
+ */
+std::string encode_frame(const SensorSample* samples, std::size_t count, bool batch);
+
+/**
+ * @brief JSON 行快速解析结果
+ */
+enum class LineKind {
+    DATA,       // "data" 消息, 已填充 SensorSample
+    OTHER,      // 其他消息 (ack/error/status/ready), 交给通用 JSON 解析
+    MALFORMED   // 看起来是 "data" 但字段无法解析
+};
+
+/**
+ * @brief 不分配内存地解析一行扁平 JSON, 识别 "data" 消息
+ *
+ * 只支持固件 "data" 消息的形状 (扁平对象, 值为数字或无转义字符串);
+ * 遇到嵌套对象/数组等返回 OTHER, 由调用方回退到 nlohmann::json
+ */
+LineKind parse_data_line(std::string_view line, SensorSample& out);
+
+} // namespace sensor_frame
+} // namespace hal
@@ -0,0 +1,182 @@
+#include "hal/sensor_merger.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <limits>
+
+namespace hal {
+
+SensorMerger::SensorMerger(boost::asio::io_context& io, std::size_t boards, std::chrono::milliseconds window)
+    : strand_(boost::asio::make_strand(io)), flush_timer_(strand_),
+      window_(std::max(window, std::chrono::milliseconds(1))),
+      boards_(std::max<std::size_t>(boards, 1)) {}
+
+SensorMerger::~SensorMerger() {
+    // io 已停止后析构, 定时器随之销毁; 不再向 strand 投递
+    running_ = false;
+}
+
+void SensorMerger::start() {
+    if (boards_.size() < 2) return;
+    boost::asio::post(strand_, [this] {
+        running_ = true;
+        schedule_flush();
+    });
+}
+
+void SensorMerger::stop() {
+    running_ = false;
+    boost::asio::post(strand_, [this] { flush_timer_.cancel(); });
+}
+
+int64_t SensorMerger::now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void SensorMerger::push(std::span<const SensorSample> samples) {
+    if (samples.empty()) return;
+
+    if (boards_.size() == 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& board = boards_.front();
+            board.received += samples.size();
+            board.last_seq = samples.back().seq;
+            merged_ += samples.size();
+        }
+        on_readings(samples);
+        return;
+    }
+
+    // 驱动复用自己的解码缓冲, 跨 strand 前必须拷贝
+    boost::asio::post(strand_, [this, copy = std::vector<SensorSample>(samples.begin(), samples.end())] {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& sample : copy) {
+                enqueue(sample);
+            }
+        }
+        drain();
+    });
+}
+
+void SensorMerger::enqueue(const SensorSample& sample) {
+    if (sample.board >= boards_.size()) {
+        spdlog::warn("SensorMerger: Reading from unknown board {}", sample.board);
+        return;
+    }
+    auto& board = boards_[sample.board];
+    ++board.received;
+    if (sample.seq != 0) {
+        if (board.last_seq != 0 && sample.seq != board.last_seq + 1) {
+            ++board.seq_gaps;
+        }
+        board.last_seq = sample.seq;
+    }
+
+    // 已经发出过更晚的读数, 保序已不可能
+    if (sample.host_time_us < last_emitted_us_) {
+        ++late_;
+        out_.push_back(sample);
+        return;
+    }
+
+    board.watermark_us = std::max(board.watermark_us, sample.host_time_us);
+    // 同一板内基本有序, 从队尾找插入点
+    auto pos = std::upper_bound(board.queue.rbegin(), board.queue.rend(), sample.host_time_us,
+        [](int64_t t, const SensorSample& s) { return t >= s.host_time_us; });
+    board.queue.insert(pos.base(), sample);
+}
+
+void SensorMerger::drain() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const int64_t deadline_us = now_us() - std::chrono::duration_cast<std::chrono::microseconds>(window_).count();
+
+        while (true) {
+            // 各板队首中最早的一条
+            std::size_t next = boards_.size();
+            int64_t next_us = std::numeric_limits<int64_t>::max();
+            for (std::size_t i = 0; i < boards_.size(); ++i) {
+                const auto& queue = boards_[i].queue;
+                if (!queue.empty() && queue.front().host_time_us < next_us) {
+                    next = i;
+                    next_us = queue.front().host_time_us;
+                }
+            }
+            if (next == boards_.size()) break;
+
+            // 其它在线板都已越过它才能确定没有更早的读数
+            bool ready = true;
+            for (std::size_t i = 0; i < boards_.size() && ready; ++i) {
+                if (i == next || !boards_[i].active) continue;
+                ready = boards_[i].watermark_us >= next_us;
+            }
+            const bool expired = next_us <= deadline_us;
+            const bool overfull = boards_[next].queue.size() > MAX_QUEUED_PER_BOARD;
+            if (!ready && !expired && !overfull) break;
+            if (!ready) ++timed_out_;
+
+            out_.push_back(boards_[next].queue.front());
+            boards_[next].queue.pop_front();
+            last_emitted_us_ = next_us;
+            ++merged_;
+        }
+    }
+
+    if (!out_.empty()) {
+        on_readings(std::span<const SensorSample>(out_));
+        out_.clear();
+    }
+}
+
+void SensorMerger::set_active(uint8_t board, bool active) {
+    if (board >= boards_.size()) return;
+    if (boards_.size() == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        boards_.front().active = active;
+        return;
+    }
+    boost::asio::post(strand_, [this, board, active] {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto& b = boards_[board];
+            b.active = active;
+            // 重连后设备时钟重新同步, 旧水位不再可信
+            b.watermark_us = 0;
+        }
+        drain();
+    });
+}
+
+void SensorMerger::schedule_flush() {
+    if (!running_) return;
+    flush_timer_.expires_after(std::max(window_ / 2, std::chrono::milliseconds(1)));
+    flush_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec || !running_) return;
+        drain();
+        schedule_flush();
+    });
+}
+
+SensorMerger::Stats SensorMerger::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.merged = merged_;
+    s.late = late_;
+    s.timed_out = timed_out_;
+    s.boards.reserve(boards_.size());
+    for (const auto& board : boards_) {
+        BoardStats b;
+        b.active = board.active;
+        b.received = board.received;
+        b.queued = board.queue.size();
+        b.last_seq = board.last_seq;
+        b.seq_gaps = board.seq_gaps;
+        b.watermark_us = board.watermark_us;
+        s.boards.push_back(b);
+    }
+    return s;
+}
+
+} // namespace hal
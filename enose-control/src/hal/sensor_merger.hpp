@@ -0,0 +1,100 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <boost/asio.hpp>
+#include <boost/signals2.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 多块传感器板的读数按校正后的采样时间 (SensorSample::host_time_us) 合并成一条流
+ *
+ * 每块板的读数各自按时间入队, 队首最早的读数在其余所有在线板的水位 (已收到的最新时间)
+ * 都越过它之后发出, 这是一个 k 路归并. 慢板或停发的板最多拖住 window: 早于
+ * now - window 的读数不再等待直接发出. 比已发出时间更早才到的读数 (补发、超出窗口)
+ * 不丢弃, 直接透传并计入 late.
+ *
+ * 只有一块板时不排队, push() 在调用线程上直接转发.
+ * push() / set_active() 可在任意线程调用; on_readings 在内部 strand 上发出.
+ */
+class SensorMerger {
+public:
+    struct BoardStats {
+        bool active = false;
+        uint64_t received = 0;
+        uint64_t queued = 0;            // 等待其它板的读数
+        uint32_t last_seq = 0;          // 最近一条读数的设备序号
+        uint64_t seq_gaps = 0;          // 序号不连续次数 (驱动已请求补发, 补发读数通常计入 late)
+        int64_t watermark_us = 0;
+    };
+
+    struct Stats {
+        uint64_t merged = 0;            // 按序发出
+        uint64_t late = 0;              // 早于已发出时间, 乱序透传
+        uint64_t timed_out = 0;         // 等满 window 仍有板未跟上, 提前发出
+        std::vector<BoardStats> boards;
+    };
+
+    SensorMerger(boost::asio::io_context& io, std::size_t boards, std::chrono::milliseconds window);
+    ~SensorMerger();
+
+    /** @brief 启动 window / 2 周期的超时冲刷; stop() 须在 io_context 停止前调用 */
+    void start();
+    void stop();
+
+    /** @brief 一块板的一帧读数 (SensorDriver::on_readings), sample.board 选择队列 */
+    void push(std::span<const SensorSample> samples);
+
+    /**
+     * @brief 板上线 / 掉线. 掉线的板不再拖住合并, 其队列中的读数照常发出
+     */
+    void set_active(uint8_t board, bool active);
+
+    Stats stats() const;
+
+    std::size_t board_count() const { return boards_.size(); }
+
+    /** @brief 合并后的读数, 一次调用内按 host_time_us 升序 (late 除外) */
+    boost::signals2::signal<void(std::span<const SensorSample>)> on_readings;
+
+    static constexpr std::size_t MAX_QUEUED_PER_BOARD = 4096;   // 超过时不再等待, 强制发出队首
+
+private:
+    struct Board {
+        std::deque<SensorSample> queue;
+        bool active = false;
+        int64_t watermark_us = 0;
+        uint64_t received = 0;
+        uint32_t last_seq = 0;
+        uint64_t seq_gaps = 0;
+    };
+
+    void enqueue(const SensorSample& sample);
+    void drain();
+    void schedule_flush();
+    static int64_t now_us();
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    boost::asio::steady_timer flush_timer_;
+    std::chrono::milliseconds window_;
+    std::atomic<bool> running_{false};
+
+    // 仅在 strand 上访问 (stats() 加锁读取)
+    mutable std::mutex mutex_;
+    std::vector<Board> boards_;
+    int64_t last_emitted_us_ = 0;
+    std::vector<SensorSample> out_;
+    uint64_t merged_ = 0;
+    uint64_t late_ = 0;
+    uint64_t timed_out_ = 0;
+};
+
+} // namespace hal
@@ -0,0 +1,334 @@
+#include "hal/sensor_replay.hpp"
+#include "hal/sensor_frame.hpp"
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace hal {
+
+namespace {
+
+// AI-Studio 导出的 bmespecimen 在数组/对象末尾带多余逗号, nlohmann::json 不接受; 字符串外的这类逗号去掉
+std::string strip_trailing_commas(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    bool in_string = false;
+    bool escaped = false;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (in_string) {
+            out.push_back(c);
+            if (escaped) escaped = false;
+            else if (c == '\\') escaped = true;
+            else if (c == '"') in_string = false;
+            continue;
+        }
+        if (c == '"') {
+            in_string = true;
+        } else if (c == ',') {
+            std::size_t j = i + 1;
+            while (j < text.size() && std::isspace(static_cast<unsigned char>(text[j]))) ++j;
+            if (j < text.size() && (text[j] == ']' || text[j] == '}')) continue;
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+// dataColumns 中 key -> 列下标
+std::map<std::string, std::size_t> column_index(const nlohmann::json& columns) {
+    std::map<std::string, std::size_t> index;
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        index[columns[i].value("key", std::string())] = i;
+    }
+    return index;
+}
+
+std::size_t require_column(const std::map<std::string, std::size_t>& index, const char* key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        throw std::runtime_error(std::string("missing data column '") + key + "'");
+    }
+    return it->second;
+}
+
+float column_or_nan(const nlohmann::json& row, const std::map<std::string, std::size_t>& index, const char* key) {
+    auto it = index.find(key);
+    if (it == index.end() || it->second >= row.size() || !row[it->second].is_number()) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+    return row[it->second].get<float>();
+}
+
+SensorSample bme_sample(uint8_t sensor_idx, uint32_t tick_ms, float resistance, uint8_t heater_step) {
+    SensorSample sample;
+    sample.type = SensorType::MOX_DIGITAL;
+    sample.sensor_idx = sensor_idx;
+    sample.tick_ms = tick_ms;
+    sample.value = resistance;
+    sample.heater_step = heater_step;
+    return sample;
+}
+
+void load_bmerawdata(const nlohmann::json& j, ReplayRecording& rec) {
+    const auto& profiles = j.at("configBody").value("heaterProfiles", nlohmann::json::array());
+    if (!profiles.empty()) {
+        rec.heater_steps = static_cast<uint8_t>(profiles[0].value("temperatureTimeVectors", nlohmann::json::array()).size());
+    }
+
+    const auto& body = j.at("rawDataBody");
+    const auto index = column_index(body.at("dataColumns"));
+    const std::size_t sensor_col = require_column(index, "sensor_index");
+    const std::size_t time_col = require_column(index, "timestamp_since_poweron");
+    const std::size_t value_col = require_column(index, "resistance_gassensor");
+    const std::size_t step_col = require_column(index, "heater_profile_step_index");
+
+    for (const auto& row : body.at("dataBlock")) {
+        auto sample = bme_sample(row.at(sensor_col).get<uint8_t>(), row.at(time_col).get<uint32_t>(),
+                                 row.at(value_col).get<float>(), row.at(step_col).get<uint8_t>());
+        sample.temperature = column_or_nan(row, index, "temperature");
+        sample.humidity = column_or_nan(row, index, "relative_humidity");
+        sample.pressure = column_or_nan(row, index, "pressure");
+        rec.samples.push_back(sample);
+    }
+}
+
+void load_bmespecimen(const nlohmann::json& j, ReplayRecording& rec) {
+    const auto& data = j.at("data");
+    const auto& profiles = data.value("heaterProfiles", nlohmann::json::array());
+    if (!profiles.empty()) {
+        rec.heater_steps = static_cast<uint8_t>(profiles[0].value("steps", nlohmann::json::array()).size());
+    }
+
+    // 读数只带 cycle_id: cycle -> sensorId -> 板上索引
+    std::map<int64_t, uint8_t> sensor_index;
+    for (const auto& sensor : data.value("sensors", nlohmann::json::array())) {
+        sensor_index[sensor.at("id").get<int64_t>()] = sensor.at("index").get<uint8_t>();
+    }
+    std::map<int64_t, uint8_t> cycle_sensor;
+    for (const auto& cycle : data.value("cycles", nlohmann::json::array())) {
+        auto it = sensor_index.find(cycle.at("sensorId").get<int64_t>());
+        if (it != sensor_index.end()) {
+            cycle_sensor[cycle.at("id").get<int64_t>()] = it->second;
+        }
+    }
+
+    const auto index = column_index(data.at("dataColumns"));
+    const std::size_t time_col = require_column(index, "timestamp_since_poweron");
+    const std::size_t value_col = require_column(index, "resistance_gassensor");
+    const std::size_t step_col = require_column(index, "cycle_step_index");
+    const std::size_t cycle_col = require_column(index, "cycle_id");
+
+    for (const auto& row : data.at("specimenDataPoints")) {
+        auto it = cycle_sensor.find(row.at(cycle_col).get<int64_t>());
+        if (it == cycle_sensor.end()) continue;
+        auto sample = bme_sample(it->second, row.at(time_col).get<uint32_t>(),
+                                 row.at(value_col).get<float>(), row.at(step_col).get<uint8_t>());
+        sample.temperature = column_or_nan(row, index, "temperature");
+        sample.humidity = column_or_nan(row, index, "relative_humidity");
+        sample.pressure = column_or_nan(row, index, "pressure");
+        rec.samples.push_back(sample);
+    }
+}
+
+void load_capture(const std::string& text, ReplayRecording& rec) {
+    std::istringstream lines(text);
+    std::string line;
+    SensorSample sample;
+    while (std::getline(lines, line)) {
+        while (!line.empty() && line.back() == '\r') line.pop_back();
+        sample = SensorSample{};
+        if (sensor_frame::parse_data_line(line, sample) == sensor_frame::LineKind::DATA) {
+            rec.samples.push_back(sample);
+        }
+    }
+}
+
+double elapsed_s(int64_t from_ns, int64_t to_ns) {
+    return static_cast<double>(to_ns - from_ns) / 1e9;
+}
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ReplayRecording ReplayRecording::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+
+    ReplayRecording rec;
+    rec.name = std::filesystem::path(path).filename().string();
+
+    auto j = nlohmann::json::parse(text, nullptr, false);
+    if (j.is_discarded()) {
+        j = nlohmann::json::parse(strip_trailing_commas(text), nullptr, false);
+    }
+
+    try {
+        if (j.is_object() && j.contains("rawDataBody")) {
+            rec.format = "bmerawdata";
+            load_bmerawdata(j, rec);
+        } else if (j.is_object() && j.contains("data") && j["data"].contains("specimenDataPoints")) {
+            rec.format = "bmespecimen";
+            load_bmespecimen(j, rec);
+        } else if (j.is_object() && j.contains("configBody")) {
+            throw std::runtime_error("AI-Studio configuration file without recorded data");
+        } else {
+            rec.format = "capture";
+            load_capture(text, rec);
+        }
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error(rec.name + ": " + e.what());
+    }
+    if (rec.samples.empty()) {
+        throw std::runtime_error(rec.name + ": no sensor readings");
+    }
+
+    std::stable_sort(rec.samples.begin(), rec.samples.end(),
+                     [](const SensorSample& a, const SensorSample& b) { return a.tick_ms < b.tick_ms; });
+    for (std::size_t i = 0; i < rec.samples.size(); ++i) {
+        rec.samples[i].seq = static_cast<uint32_t>(i + 1);
+    }
+    return rec;
+}
+
+SensorReplay::SensorReplay(boost::asio::io_context& io, std::shared_ptr<SensorDriver> driver)
+    : io_(io), driver_(std::move(driver)), timer_(driver_->executor()) {
+    batch_.reserve(MAX_BATCH);
+}
+
+SensorReplay::~SensorReplay() {
+    stop();
+}
+
+void SensorReplay::start(ReplayRecording recording, Options options) {
+    stop();
+    recording_ = std::move(recording);
+    options_ = options;
+    if (recording_.samples.empty()) return;
+
+    first_tick_ = recording_.samples.front().tick_ms;
+    const uint32_t last_tick = recording_.samples.back().tick_ms;
+    const uint32_t mean_gap = recording_.samples.size() > 1
+        ? (last_tick - first_tick_) / static_cast<uint32_t>(recording_.samples.size() - 1)
+        : 1;
+    span_ms_ = last_tick - first_tick_ + std::max<uint32_t>(mean_gap, 1);
+    next_ = 0;
+    seq_base_ = 0;
+    tick_base_ = 0;
+    samples_ = 0;
+    loops_ = 0;
+
+    driver_->start_replay(recording_.name);
+    if (recording_.heater_steps > 0) {
+        driver_->heater_cycles().set_profile_length_all(recording_.heater_steps);
+    }
+
+    started_ = pass_started_ = std::chrono::steady_clock::now();
+    started_ns_ = now_ns();
+    finished_ns_ = 0;
+    running_ = true;
+    spdlog::info("SensorReplay: {} ({}, {} readings, {} heater steps) at {}",
+                 recording_.name, recording_.format, recording_.samples.size(), recording_.heater_steps,
+                 options_.speed > 0 ? fmt::format("{:g}x", options_.speed) : std::string("max speed"));
+    schedule();
+}
+
+void SensorReplay::stop() {
+    if (!running_) return;
+    running_ = false;
+    finished_ns_ = now_ns();
+    timer_.cancel();
+}
+
+SensorReplay::Stats SensorReplay::stats() const {
+    Stats s;
+    s.samples = samples_;
+    s.loops = loops_;
+    s.running = running_;
+    const int64_t started = started_ns_;
+    if (started != 0) {
+        const int64_t finished = finished_ns_;
+        s.elapsed_s = elapsed_s(started, finished != 0 ? finished : now_ns());
+        s.samples_per_s = s.elapsed_s > 0 ? static_cast<double>(s.samples) / s.elapsed_s : 0.0;
+    }
+    return s;
+}
+
+void SensorReplay::schedule() {
+    if (!running_) return;
+
+    if (options_.speed <= 0) {
+        // 不限速: 每批之间让 io 线程处理其他事件 (gRPC 回调投递、定时器等)
+        boost::asio::post(timer_.get_executor(), [this] { emit_due(); });
+        return;
+    }
+    const uint32_t offset_ms = recording_.samples[next_].tick_ms - first_tick_;
+    const auto due = pass_started_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(offset_ms / options_.speed));
+    timer_.expires_at(due);
+    timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        emit_due();
+    });
+}
+
+void SensorReplay::emit_due() {
+    if (!running_) return;
+
+    // 定时模式发出同一设备时刻的所有读数 (一帧); 不限速时发出至多 MAX_BATCH 条
+    batch_.clear();
+    const uint32_t tick = recording_.samples[next_].tick_ms;
+    while (next_ < recording_.samples.size() && batch_.size() < MAX_BATCH) {
+        const auto& source = recording_.samples[next_];
+        if (options_.speed > 0 && source.tick_ms != tick) break;
+        SensorSample sample = source;
+        sample.seq += seq_base_;
+        sample.tick_ms += tick_base_;
+        batch_.push_back(sample);
+        ++next_;
+    }
+    driver_->inject(batch_);
+    samples_ += batch_.size();
+
+    if (next_ >= recording_.samples.size()) {
+        ++loops_;
+        if (!options_.loop) {
+            finish();
+            return;
+        }
+        seq_base_ += static_cast<uint32_t>(recording_.samples.size());
+        tick_base_ += span_ms_;
+        next_ = 0;
+        pass_started_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(span_ms_ / std::max(options_.speed, 1e-9)));
+        if (options_.speed <= 0) pass_started_ = std::chrono::steady_clock::now();
+    }
+    schedule();
+}
+
+void SensorReplay::finish() {
+    running_ = false;
+    finished_ns_ = now_ns();
+    const auto s = stats();
+    spdlog::info("SensorReplay: Finished {} - {} readings in {:.3f} s ({:.0f} readings/s)",
+                 recording_.name, s.samples, s.elapsed_s, s.samples_per_s);
+    on_finished(s);
+}
+
+} // namespace hal
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "hal/sensor_driver.hpp"
+#include "hal/sensor_sample.hpp"
+#include <boost/asio.hpp>
+#include <boost/signals2.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 一份可回放的读数记录
+ *
+ * 支持的格式 (按内容识别):
+ * - Bosch BME AI-Studio 原始数据 (*.bmerawdata.json, rawDataBody.dataBlock)
+ * - Bosch BME AI-Studio 样本导出 (*.bmespecimen.json, data.specimenDataPoints; 容忍结尾多余逗号)
+ * - 串口抓包: 每行一条固件 "data" 消息 (与 SensorDriver 的 JSON 行同一解析器), 其余行忽略
+ */
+struct ReplayRecording {
+    std::string name;                   // 文件名
+    std::string format;                 // bmerawdata / bmespecimen / capture
+    uint8_t heater_steps = 0;           // 记录中的加热配置步数, 0 = 未知
+    std::vector<SensorSample> samples;  // 按 tick_ms 升序, seq 从 1 连续编号
+
+    /** @brief 读取并解析, 失败 (无法识别或没有读数) 时抛出 std::runtime_error */
+    static ReplayRecording load(const std::string& path);
+};
+
+/**
+ * @brief 把记录按设备时间戳重新注入 SensorDriver, 驱动整条主机侧管线
+ *
+ * SensorDriver 切到回放模式后不打开串口, 服务层拿到的仍是同一个驱动对象, 看到的
+ * 连接状态、on_reading / on_readings 信号和加热周期统计与实时采集相同.
+ * speed > 0 时按记录中相邻读数的时间间隔 / speed 定时发出; speed == 0 时不限速,
+ * 每次在 io 线程上注入一批后让出, 用于测主机侧管线的吞吐.
+ *
+ * 定时器跑在驱动的 strand 上; 所有方法在该 strand (或 io 线程启动前) 调用 (stats() 除外)
+ */
+class SensorReplay {
+public:
+    struct Options {
+        double speed = 1.0;             // 回放倍速, 0 = 尽快
+        bool loop = false;              // 结束后从头重放 (设备时间与序号继续递增)
+    };
+
+    struct Stats {
+        uint64_t samples = 0;           // 已注入的读数
+        uint64_t loops = 0;             // 已完成的完整遍数
+        double elapsed_s = 0.0;         // 从 start() 起的墙钟时间
+        double samples_per_s = 0.0;
+        bool running = false;
+    };
+
+    SensorReplay(boost::asio::io_context& io, std::shared_ptr<SensorDriver> driver);
+    ~SensorReplay();
+
+    /**
+     * @brief 开始回放 (替代 SensorDriver::start)
+     */
+    void start(ReplayRecording recording, Options options);
+    void stop();
+
+    Stats stats() const;
+
+    /** @brief 回放结束 (非循环模式下放完最后一条), 在驱动的 strand 上发出 */
+    boost::signals2::signal<void(const Stats&)> on_finished;
+
+    static constexpr std::size_t MAX_BATCH = 256;   // 不限速时每次注入的读数上限
+
+private:
+    void schedule();
+    void emit_due();
+    void finish();
+
+    boost::asio::io_context& io_;
+    std::shared_ptr<SensorDriver> driver_;
+    boost::asio::steady_timer timer_;
+    ReplayRecording recording_;
+    Options options_;
+
+    std::size_t next_ = 0;              // 下一条待发的下标
+    uint32_t seq_base_ = 0;             // 循环时累加到 seq / tick_ms 上的偏移
+    uint32_t tick_base_ = 0;
+    uint32_t first_tick_ = 0;
+    uint32_t span_ms_ = 0;              // 一遍记录的设备时间跨度 (含一个平均间隔)
+    std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point pass_started_;
+    std::vector<SensorSample> batch_;
+
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> loops_{0};
+    std::atomic<bool> running_{false};
+    std::atomic<int64_t> started_ns_{0};
+    std::atomic<int64_t> finished_ns_{0};
+};
+
+} // namespace hal
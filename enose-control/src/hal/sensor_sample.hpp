@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace hal {
+
+// 固件 SensorType 枚举 (enose-sensor-firmware core/sensor_types.h)
+enum class SensorType : uint8_t {
+    MOX_DIGITAL = 0,
+    MOX_ANALOG  = 1,
+    PID         = 2,
+    UNKNOWN     = 0xFF
+};
+
+/**
+ * @brief 解码后的单条传感器读数
+ *
+ * 由 SensorDriver 从 JSON "data" 行或二进制帧解码一次, 通过 on_reading 分发,
+ * 不含堆分配, 可按值拷贝
+ */
+struct SensorSample {
+    uint32_t seq{0};                // 设备端序号, 从 1 开始递增; 0 表示旧固件未提供
+    uint32_t tick_ms{0};            // 设备时间戳 (ms), 64 位设备时钟的低 32 位
+    uint8_t  sensor_idx{0};
+    uint32_t sensor_id{0};
+    float    value{0.0f};           // MOX: 电阻(Ω), Analog: 电压(V), PID: ppb
+    float    temperature{std::numeric_limits<float>::quiet_NaN()};
+    float    humidity{std::numeric_limits<float>::quiet_NaN()};
+    float    pressure{std::numeric_limits<float>::quiet_NaN()};
+    uint8_t  heater_step{0};        // 仅 MOX_DIGITAL
+    uint8_t  adc_channel{0};        // 仅 MOX_ANALOG
+    SensorType type{SensorType::UNKNOWN};
+    uint64_t rx_ns{0};              // 主机收到所在串口数据块的单调时间 (core::mono_ns), 0 = 未知
+    uint64_t device_ms{0};          // 还原回绕后的 64 位设备时间 (ms)
+    int64_t  host_time_us{0};       // 采样时刻的主机 system_clock 时间 (µs since epoch), 经时钟同步校正; 0 = 未知
+    uint8_t  board{0};              // 来源传感器板 (SensorDriver::board_index), 单板时为 0
+
+    bool has_temperature() const { return !std::isnan(temperature); }
+    bool has_humidity() const { return !std::isnan(humidity); }
+    bool has_pressure() const { return !std::isnan(pressure); }
+
+    /**
+     * @brief 协议中的类型标识 ("mox_d" / "mox_a" / "pid" / "unknown")
+     */
+    const char* type_name() const {
+        switch (type) {
+            case SensorType::MOX_DIGITAL: return "mox_d";
+            case SensorType::MOX_ANALOG:  return "mox_a";
+            case SensorType::PID:         return "pid";
+            default:                      return "unknown";
+        }
+    }
+};
+
+} // namespace hal
@@ -0,0 +1,107 @@
+#include "hal/stability_detector.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+StabilityDetector::StabilityDetector(uint32_t window_ms, double threshold_percent)
+    : window_ms_(std::max<uint32_t>(window_ms, 1))
+    , threshold_percent_(threshold_percent) {}
+
+void StabilityDetector::reset() {
+    channels_.clear();
+    unstable_count_ = 0;
+    last_expire_ms_ = 0;
+}
+
+uint32_t StabilityDetector::key(const SensorSample& sample) {
+    // 只有 MOX_DIGITAL 的读数按加热步区分, 其余类型 heater_step 恒为 0
+    uint8_t step = sample.type == SensorType::MOX_DIGITAL ? sample.heater_step : 0;
+    return (static_cast<uint32_t>(sample.type) << 16) |
+           (static_cast<uint32_t>(sample.sensor_idx) << 8) |
+           step;
+}
+
+void StabilityDetector::push(std::span<const SensorSample> samples) {
+    for (const auto& sample : samples) {
+        push(sample);
+    }
+}
+
+void StabilityDetector::push(const SensorSample& sample) {
+    if (!std::isfinite(sample.value)) return;
+
+    auto [it, inserted] = channels_.try_emplace(key(sample));
+    if (inserted) {
+        ++unstable_count_;
+    }
+    update(it->second, sample);
+
+    // 设备时间每前进半个窗口, 清理一次不再上报的通道 (如被移除的传感器)
+    if (sample.tick_ms - last_expire_ms_ >= window_ms_ / 2) {
+        expire_inactive(sample.tick_ms);
+    }
+}
+
+void StabilityDetector::update(Channel& ch, const SensorSample& sample) {
+    const uint32_t now = sample.tick_ms;
+    const Point point{ch.next_index++, now, static_cast<double>(sample.value)};
+
+    ch.window.push_back(point);
+    ch.sum += point.value;
+    ch.last_tick_ms = now;
+
+    while (!ch.min_queue.empty() && ch.min_queue.back().value >= point.value) ch.min_queue.pop_back();
+    ch.min_queue.push_back(point);
+    while (!ch.max_queue.empty() && ch.max_queue.back().value <= point.value) ch.max_queue.pop_back();
+    ch.max_queue.push_back(point);
+
+    // 保留窗口内的点, 以及恰好跨过窗口起点的最后一个点, 用于判定窗口已覆盖
+    while (ch.window.size() > 1 && now - ch.window[1].tick_ms >= window_ms_) {
+        const Point& oldest = ch.window.front();
+        ch.sum -= oldest.value;
+        if (ch.min_queue.front().index == oldest.index) ch.min_queue.pop_front();
+        if (ch.max_queue.front().index == oldest.index) ch.max_queue.pop_front();
+        ch.window.pop_front();
+    }
+    bool covered = now - ch.window.front().tick_ms >= window_ms_;
+
+    bool stable = covered &&
+                  ch.window.size() >= MIN_SAMPLES &&
+                  ch.variation_percent() <= threshold_percent_;
+    if (stable != ch.stable) {
+        ch.stable = stable;
+        if (stable) --unstable_count_;
+        else ++unstable_count_;
+    }
+}
+
+void StabilityDetector::expire_inactive(uint32_t now_ms) {
+    last_expire_ms_ = now_ms;
+    for (auto it = channels_.begin(); it != channels_.end();) {
+        if (now_ms - it->second.last_tick_ms > window_ms_) {
+            if (!it->second.stable) --unstable_count_;
+            it = channels_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+double StabilityDetector::Channel::variation_percent() const {
+    if (window.empty()) return 0.0;
+    double mean = sum / static_cast<double>(window.size());
+    if (mean == 0.0) return 0.0;
+    double range = max_queue.front().value - min_queue.front().value;
+    return range / std::abs(mean) * 100.0;
+}
+
+double StabilityDetector::worst_variation_percent() const {
+    double worst = 0.0;
+    for (const auto& [k, ch] : channels_) {
+        worst = std::max(worst, ch.variation_percent());
+    }
+    return worst;
+}
+
+} // namespace hal
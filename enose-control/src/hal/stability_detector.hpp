@@ -0,0 +1,71 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <unordered_map>
+
+namespace hal {
+
+/**
+ * @brief 流式传感器稳定性检测
+ *
+ * 按 (传感器类型, sensor_idx, heater_step) 分通道维护设备时间窗口, 窗口内用单调队列
+ * 维护最小/最大值、用累加和维护均值, 每条读数为摊还 O(1). 通道的波动定义为
+ * (max - min) / |mean| × 100%; 当窗口已覆盖 window_ms 且波动不超过阈值时该通道稳定.
+ * 所有活跃通道 (最近一个窗口内有读数) 都稳定时整体稳定.
+ *
+ * 非线程安全, 应在同一线程 (SensorDriver 的 io 线程) 调用
+ */
+class StabilityDetector {
+public:
+    StabilityDetector(uint32_t window_ms, double threshold_percent);
+
+    void push(const SensorSample& sample);
+    void push(std::span<const SensorSample> samples);
+    void reset();
+
+    /** @brief 至少有一个活跃通道且全部稳定 */
+    bool stable() const { return !channels_.empty() && unstable_count_ == 0; }
+
+    std::size_t active_channels() const { return channels_.size(); }
+    std::size_t unstable_channels() const { return unstable_count_; }
+
+    /** @brief 各活跃通道中最大的波动百分比 (O(通道数), 用于日志) */
+    double worst_variation_percent() const;
+
+private:
+    struct Point {
+        uint64_t index;                 // 通道内序号, 出队时用于匹配单调队列队首
+        uint32_t tick_ms;
+        double value;
+    };
+
+    struct Channel {
+        std::deque<Point> window;
+        std::deque<Point> min_queue;    // 值单调递增
+        std::deque<Point> max_queue;    // 值单调递减
+        double sum = 0.0;
+        uint64_t next_index = 0;
+        uint32_t last_tick_ms = 0;
+        bool stable = false;
+
+        double variation_percent() const;
+    };
+
+    static constexpr std::size_t MIN_SAMPLES = 3;
+
+    static uint32_t key(const SensorSample& sample);
+    void update(Channel& channel, const SensorSample& sample);
+    void expire_inactive(uint32_t now_ms);
+
+    uint32_t window_ms_;
+    double threshold_percent_;
+    std::unordered_map<uint32_t, Channel> channels_;
+    std::size_t unstable_count_ = 0;
+    uint32_t last_expire_ms_ = 0;
+};
+
+} // namespace hal
@@ -0,0 +1,73 @@
+#include "hal/step_frame_assembler.hpp"
+
+namespace hal {
+
+StepFrameAssembler::StepFrameAssembler(FrameCallback on_frame, uint32_t max_span_ms)
+    : on_frame_(std::move(on_frame)), max_span_ms_(max_span_ms) {}
+
+std::size_t StepFrameAssembler::slot(const SensorSample& sample) {
+    std::size_t type = sample.type == SensorType::UNKNOWN
+        ? 3 : static_cast<std::size_t>(sample.type);
+    return type * SLOTS_PER_TYPE + (sample.sensor_idx % SLOTS_PER_TYPE);
+}
+
+bool StepFrameAssembler::should_close(const SensorSample& sample) const {
+    if (current_.samples.empty()) return false;
+
+    if (sample.type == SensorType::MOX_DIGITAL && has_mox_ &&
+        sample.heater_step != current_.heater_step) {
+        return true;
+    }
+    if (present_.test(slot(sample))) {
+        return true;
+    }
+    // 无符号差值, tick 回绕时同样成立
+    return sample.tick_ms - current_.first_tick_ms > max_span_ms_;
+}
+
+void StepFrameAssembler::push(const SensorSample& sample) {
+    if (should_close(sample)) {
+        flush();
+    }
+
+    if (current_.samples.empty()) {
+        current_.first_tick_ms = sample.tick_ms;
+    }
+    if (sample.type == SensorType::MOX_DIGITAL && !has_mox_) {
+        current_.heater_step = sample.heater_step;
+        has_mox_ = true;
+    }
+    present_.set(slot(sample));
+    current_.samples.push_back(sample);
+}
+
+void StepFrameAssembler::push(std::span<const SensorSample> samples) {
+    for (const auto& sample : samples) {
+        push(sample);
+    }
+}
+
+void StepFrameAssembler::flush() {
+    if (current_.samples.empty()) return;
+
+    current_.seq = next_seq_++;
+    if (on_frame_) {
+        on_frame_(current_);
+    }
+
+    // 保留 vector 容量, 稳态下不再分配
+    current_.samples.clear();
+    current_.heater_step = 0;
+    has_mox_ = false;
+    present_.reset();
+}
+
+void StepFrameAssembler::reset() {
+    current_.samples.clear();
+    current_.heater_step = 0;
+    has_mox_ = false;
+    present_.reset();
+    next_seq_ = 1;
+}
+
+} // namespace hal
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "hal/sensor_sample.hpp"
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 同一加热步的一组读数
+ */
+struct StepFrame {
+    uint64_t seq = 0;               // 帧序号, 从 1 开始
+    uint8_t heater_step = 0;        // 帧内 MOX_DIGITAL 读数的加热步
+    uint32_t first_tick_ms = 0;     // 第一条读数的设备时间戳
+    std::vector<SensorSample> samples;
+};
+
+/**
+ * @brief 把逐条到达的读数按加热步归并成帧
+ *
+ * 固件按加热步轮询所有传感器, 同一步的读数连续到达. 出现以下情况时当前帧结束:
+ * - MOX_DIGITAL 读数的加热步与当前帧不同
+ * - 同一传感器 (类型 + 索引) 在帧内再次出现
+ * - 与帧内第一条读数的设备时间差超过 max_span_ms
+ *
+ * 非线程安全, 应在同一线程 (SensorDriver 的 io 线程) 调用
+ */
+class StepFrameAssembler {
+public:
+    using FrameCallback = std::function<void(const StepFrame&)>;
+
+    explicit StepFrameAssembler(FrameCallback on_frame, uint32_t max_span_ms = 2000);
+
+    void push(const SensorSample& sample);
+    void push(std::span<const SensorSample> samples);
+
+    /**
+     * @brief 输出未完成的当前帧 (如断线时)
+     */
+    void flush();
+
+    /**
+     * @brief 丢弃当前帧并重置序号
+     */
+    void reset();
+
+private:
+    static std::size_t slot(const SensorSample& sample);
+    bool should_close(const SensorSample& sample) const;
+
+    static constexpr std::size_t SLOTS_PER_TYPE = 64;
+
+    FrameCallback on_frame_;
+    uint32_t max_span_ms_;
+    StepFrame current_;
+    bool has_mox_ = false;
+    std::bitset<SLOTS_PER_TYPE * 4> present_;
+    uint64_t next_seq_ = 1;
+};
+
+} // namespace hal
@@ -0,0 +1,158 @@
+#include "hal/weight_filter.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace hal {
+
+// ============================================================
+// RollingStats
+// ============================================================
+
+RollingStats::RollingStats(std::size_t capacity)
+    : buffer_(std::max<std::size_t>(capacity, 1), 0.0) {}
+
+void RollingStats::set_capacity(std::size_t capacity) {
+    buffer_.assign(std::max<std::size_t>(capacity, 1), 0.0);
+    reset();
+}
+
+void RollingStats::reset() {
+    head_ = 0;
+    count_ = 0;
+    since_recompute_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    sum_ = 0.0;
+    weighted_sum_ = 0.0;
+}
+
+void RollingStats::push(double sample) {
+    const std::size_t cap = buffer_.size();
+
+    if (count_ < cap) {
+        // 窗口未满: 标准 Welford
+        buffer_[(head_ + count_) % cap] = sample;
+        weighted_sum_ += static_cast<double>(count_) * sample;
+        sum_ += sample;
+        ++count_;
+
+        double delta = sample - mean_;
+        mean_ += delta / static_cast<double>(count_);
+        m2_ += delta * (sample - mean_);
+        return;
+    }
+
+    // 窗口已满: 用新样本替换最旧样本
+    double oldest = buffer_[head_];
+    buffer_[head_] = sample;
+    head_ = (head_ + 1) % cap;
+
+    // 去掉序号 0 的样本后其余序号减 1, 新样本序号为 n-1
+    weighted_sum_ -= sum_ - oldest;
+    weighted_sum_ += static_cast<double>(cap - 1) * sample;
+    sum_ += sample - oldest;
+
+    double old_mean = mean_;
+    mean_ += (sample - oldest) / static_cast<double>(cap);
+    m2_ += (sample - oldest) * (sample - mean_ + oldest - old_mean);
+
+    if (++since_recompute_ >= cap) {
+        recompute();
+    }
+}
+
+void RollingStats::recompute() {
+    since_recompute_ = 0;
+    if (count_ == 0) return;
+
+    const std::size_t cap = buffer_.size();
+    double sum = 0.0, weighted = 0.0;
+    for (std::size_t i = 0; i < count_; ++i) {
+        double y = buffer_[(head_ + i) % cap];
+        sum += y;
+        weighted += static_cast<double>(i) * y;
+    }
+    double mean = sum / static_cast<double>(count_);
+    double m2 = 0.0;
+    for (std::size_t i = 0; i < count_; ++i) {
+        double d = buffer_[(head_ + i) % cap] - mean;
+        m2 += d * d;
+    }
+
+    sum_ = sum;
+    weighted_sum_ = weighted;
+    mean_ = mean;
+    m2_ = m2;
+}
+
+double RollingStats::variance() const {
+    if (count_ == 0) return 0.0;
+    return std::max(m2_, 0.0) / static_cast<double>(count_);
+}
+
+double RollingStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+double RollingStats::slope() const {
+    if (count_ < 2) return 0.0;
+    // 序号 0..n-1: Σi = n(n-1)/2, Σi² = (n-1)n(2n-1)/6
+    double n = static_cast<double>(count_);
+    double sum_i = n * (n - 1.0) / 2.0;
+    double sum_ii = (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+    double denom = n * sum_ii - sum_i * sum_i;
+    return (n * weighted_sum_ - sum_i * sum_) / denom;
+}
+
+// ============================================================
+// WeightKalmanFilter
+// ============================================================
+
+WeightKalmanFilter::WeightKalmanFilter(double process_noise, double measurement_noise)
+    : q_(process_noise), r_(measurement_noise) {}
+
+void WeightKalmanFilter::set_noise(double process_noise, double measurement_noise) {
+    q_ = process_noise;
+    r_ = measurement_noise;
+}
+
+void WeightKalmanFilter::reset() {
+    initialized_ = false;
+    x_ = v_ = 0.0;
+    p00_ = p01_ = p11_ = 0.0;
+}
+
+double WeightKalmanFilter::update(double z) {
+    if (!initialized_) {
+        x_ = z;
+        v_ = 0.0;
+        p00_ = r_;
+        p01_ = 0.0;
+        p11_ = r_;
+        initialized_ = true;
+        return x_;
+    }
+
+    // 预测 (dt = 1 个样本), 离散白噪声加速度模型
+    x_ += v_;
+    p00_ += 2.0 * p01_ + p11_ + q_ / 4.0;
+    p01_ += p11_ + q_ / 2.0;
+    p11_ += q_;
+
+    // 更新
+    double s = p00_ + r_;
+    double k0 = p00_ / s;
+    double k1 = p01_ / s;
+    double innovation = z - x_;
+    x_ += k0 * innovation;
+    v_ += k1 * innovation;
+
+    double p00 = p00_, p01 = p01_;
+    p00_ = (1.0 - k0) * p00;
+    p01_ = (1.0 - k0) * p01;
+    p11_ -= k1 * p01;
+
+    return x_;
+}
+
+} // namespace hal
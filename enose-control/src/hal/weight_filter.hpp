@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace hal {
+
+/**
+ * @brief 定长滑动窗口统计 (环形缓冲)
+ *
+ * 每次 push 为 O(1): 均值/方差用滑动 Welford 更新, 趋势为窗口内对样本序号的
+ * 最小二乘斜率, 通过 Σy 和 Σi·y 增量维护. 每滑过 capacity 个样本按缓冲区重算一次,
+ * 抵消浮点累积误差.
+ */
+class RollingStats {
+public:
+    explicit RollingStats(std::size_t capacity = 10);
+
+    void push(double sample);
+    void reset();
+
+    /** @brief 改变窗口大小 (清空已有样本) */
+    void set_capacity(std::size_t capacity);
+
+    std::size_t size() const { return count_; }
+    std::size_t capacity() const { return buffer_.size(); }
+    bool full() const { return count_ == buffer_.size(); }
+
+    double mean() const { return mean_; }
+    double variance() const;            // 总体方差
+    double stddev() const;
+
+    /** @brief 斜率 (每样本的变化量), 样本数 < 2 时为 0 */
+    double slope() const;
+
+private:
+    void recompute();
+
+    std::vector<double> buffer_;
+    std::size_t head_ = 0;              // 最旧样本位置 (窗口满时)
+    std::size_t count_ = 0;
+    std::size_t since_recompute_ = 0;
+
+    double mean_ = 0.0;
+    double m2_ = 0.0;                   // Σ(x - mean)^2
+    double sum_ = 0.0;                  // Σy
+    double weighted_sum_ = 0.0;         // Σ i·y, i 为窗口内序号 (0 = 最旧)
+};
+
+/**
+ * @brief 一维常速度卡尔曼滤波 (状态: 重量, 每样本变化率)
+ *
+ * 稳态下等价于 alpha-beta 滤波: 进样/排废的斜坡由速度状态跟踪, 没有滑动平均的
+ * 半窗口滞后. process_noise 越大跟随越快, measurement_noise 越大输出越平滑.
+ */
+class WeightKalmanFilter {
+public:
+    WeightKalmanFilter(double process_noise = 0.05, double measurement_noise = 4.0);
+
+    double update(double measurement);
+    void reset();
+    void set_noise(double process_noise, double measurement_noise);
+
+    bool initialized() const { return initialized_; }
+    double value() const { return x_; }
+    double rate() const { return v_; }
+
+private:
+    double q_;
+    double r_;
+    bool initialized_ = false;
+    double x_ = 0.0;
+    double v_ = 0.0;
+    double p00_ = 0.0, p01_ = 0.0, p11_ = 0.0;
+};
+
+} // namespace hal
@@ -4,17 +4,40 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <systemd/sd-daemon.h>
+#include <filesystem>
+#include <future>
 #include <iostream>
+#include <map>
+#include <set>
 #include <thread>
+#include <vector>
 #include "core/config.hpp"
+#include "core/config_watcher.hpp"
+#include "core/health.hpp"
+#include "core/metrics.hpp"
+#include "core/metrics_server.hpp"
+#include "core/priority_executor.hpp"
+#include "hal/sensor_board_group.hpp"
 #include "hal/sensor_driver.hpp"
+#include "hal/sensor_replay.hpp"
 #include "hal/actuator_driver.hpp"
+#include "hal/emergency_stop_link.hpp"
 #include "hal/load_cell_driver.hpp"
+#include "sim/simulator.hpp"
 #include "workflows/system_state.hpp"
 #include "grpc/grpc_server.hpp"
+#include "grpc/system_events.hpp"
 #include "db/connection_pool.hpp"
 #include "db/test_run_repository.hpp"
-#include "db/consumable_repository.hpp"
+#include "db/consumable_cache.hpp"
+#include "db/sensor_reading_repository.hpp"
+#include "db/sensor_baseline_repository.hpp"
+#include "db/weight_sample_writer.hpp"
+#include "db/recording_journal.hpp"
+#include "db/journal_uploader.hpp"
+#include "db/run_archiver.hpp"
+#include "db/consumable_ledger.hpp"
+#include "db/timeseries_storage.hpp"
 
 // Global io_context to allow signal handling
 boost::asio::io_context io_context;
@@ -22,6 +45,183 @@ boost::asio::io_context io_context;
 // 默认配置文件路径
 const std::string DEFAULT_CONFIG_PATH = "/home/user/rpi_odor/enose-control/config/config.json";
 
+namespace {
+
+void apply_log_level(const std::string& level) {
+    if (level == "debug") {
+        spdlog::set_level(spdlog::level::debug);
+    } else if (level == "info") {
+        spdlog::set_level(spdlog::level::info);
+    } else if (level == "warn") {
+        spdlog::set_level(spdlog::level::warn);
+    } else if (level == "error") {
+        spdlog::set_level(spdlog::level::err);
+    }
+}
+
+std::string join_names(const std::vector<std::string>& names) {
+    std::string joined;
+    for (const auto& name : names) {
+        if (!joined.empty()) joined += ", ";
+        joined += name;
+    }
+    return joined;
+}
+
+// section 在 live_fields (JSON pointer) 之外是否有变化; 用于部分字段可在线生效的节
+bool changed_besides(const core::ConfigSnapshot& previous, const core::ConfigSnapshot& current,
+                     const std::string& section, const std::vector<nlohmann::json::json_pointer>& live_fields) {
+    auto strip = [&](const nlohmann::json& document) {
+        auto it = document.find(section);
+        nlohmann::json value = it == document.end() ? nlohmann::json() : *it;
+        for (const auto& field : live_fields) {
+            if (!value.contains(field)) continue;
+            auto& parent = value[field.parent_pointer()];
+            if (parent.is_object()) parent.erase(field.back());
+        }
+        return value;
+    };
+    return strip(previous.document) != strip(current.document);
+}
+
+void write_sensor_link_metrics(core::MetricWriter& w, const hal::SensorDriver& sensor, const core::MetricLabels& labels) {
+    auto link = sensor.stats();
+    w.gauge("sensor_link_up", "Sensor board serial port open", link.connected ? 1 : 0, labels);
+    w.counter("sensor_bytes_received_total", "Bytes received from the sensor board", static_cast<double>(link.bytes_received), labels);
+    w.counter("sensor_frames_received_total", "JSON lines and binary frames received", static_cast<double>(link.frames_received), labels);
+    w.counter("sensor_parse_errors_total", "Malformed lines, CRC errors and oversized frames", static_cast<double>(link.parse_errors), labels);
+    w.counter("sensor_reconnects_total", "Sensor serial reconnect attempts", static_cast<double>(link.reconnects), labels);
+    w.gauge("sensor_write_queue", "Commands waiting to be written to the sensor board", static_cast<double>(link.write_queue), labels);
+
+    auto clock = sensor.clock_stats();
+    w.gauge("sensor_clock_synced", "Device clock model established", clock.synced ? 1 : 0, labels);
+    w.counter("sensor_clock_exchanges_total", "Accepted clock sync round trips", static_cast<double>(clock.exchanges), labels);
+    w.gauge("sensor_clock_skew_ppm", "Device clock frequency error relative to the host", clock.skew_ppm, labels);
+    w.gauge("sensor_clock_residual_seconds", "RMS residual of the clock model fit", clock.residual_us / 1e6, labels);
+    w.gauge("sensor_clock_min_rtt_seconds", "Smallest clock sync round trip in the window", clock.min_rtt_us / 1e6, labels);
+}
+
+void write_link_metrics(core::MetricWriter& w, const hal::SensorBoardGroup& sensors, const hal::ActuatorDriver& actuator) {
+    // 单板时不加 device 标签, 与以前的序列保持一致
+    if (sensors.size() == 1) {
+        write_sensor_link_metrics(w, *sensors.primary(), {});
+    } else {
+        auto merge = sensors.merger().stats();
+        w.counter("sensor_merge_readings_total", "Readings emitted in timestamp order by the multi-board merger",
+                  static_cast<double>(merge.merged));
+        w.counter("sensor_merge_late_total", "Readings that arrived after the merge window and were passed through out of order",
+                  static_cast<double>(merge.late));
+        w.counter("sensor_merge_timeouts_total", "Readings emitted before every board caught up",
+                  static_cast<double>(merge.timed_out));
+        for (std::size_t i = 0; i < sensors.size(); ++i) {
+            const auto& board = sensors.boards()[i];
+            core::MetricLabels labels = {{"device", board.device_id}};
+            write_sensor_link_metrics(w, *board.driver, labels);
+            if (i < merge.boards.size()) {
+                w.gauge("sensor_merge_queued", "Readings waiting in the merger for other boards",
+                        static_cast<double>(merge.boards[i].queued), labels);
+                w.counter("sensor_seq_gaps_total", "Device sequence discontinuities seen by the merger",
+                          static_cast<double>(merge.boards[i].seq_gaps), labels);
+            }
+        }
+    }
+
+    auto moonraker = actuator.link_stats();
+    w.gauge("moonraker_link_up", "Moonraker websocket connected", moonraker.connected ? 1 : 0);
+    w.counter("moonraker_reconnects_total", "Successful Moonraker reconnects", moonraker.reconnects);
+    w.counter("moonraker_connect_attempts_total", "Moonraker connection attempts", moonraker.connect_attempts);
+    w.gauge("moonraker_last_reconnect_seconds", "Time from the last disconnect to handshake completion",
+            moonraker.last_reconnect_latency_ms / 1000.0);
+    w.gauge("moonraker_send_queue", "Websocket messages waiting to be written", static_cast<double>(moonraker.send_queue));
+    w.gauge("moonraker_pending_rpcs", "JSON-RPC requests awaiting a response", static_cast<double>(moonraker.pending_rpcs));
+    w.gauge("moonraker_emergency_link_up", "Dedicated emergency stop connection established",
+            moonraker.emergency_link_connected ? 1 : 0);
+    w.counter("emergency_stops_total", "Emergency stop requests", static_cast<double>(moonraker.emergency_stops));
+    w.counter("emergency_stop_failures_total", "Emergency stops not acknowledged on any lane",
+              static_cast<double>(moonraker.emergency_stop_failures));
+    w.gauge("emergency_stop_last_latency_seconds", "Latency of the last acknowledged emergency stop",
+            moonraker.last_emergency_stop_latency_us / 1e6);
+}
+
+void write_db_metrics(core::MetricWriter& w, const db::SensorReadingRepository* readings,
+                      const db::WeightSampleWriter* weights, const db::RecordingJournal* journal,
+                      const db::JournalUploader* uploader, const db::ConsumableCache* consumables,
+                      const db::ConsumableLedger* ledger, const db::RunArchiver* archiver) {
+    auto pool = db::ConnectionPool::instance().stats();
+    w.gauge("db_pool_connections", "Open database connections", static_cast<double>(pool.idle), {{"state", "idle"}});
+    w.gauge("db_pool_connections", "Open database connections", static_cast<double>(pool.in_use), {{"state", "in_use"}});
+    w.gauge("db_pool_max_connections", "Connection pool size limit", static_cast<double>(pool.max_size));
+    w.gauge("db_pool_healthy", "Database reachable", pool.healthy ? 1 : 0);
+    w.counter("db_pool_acquired_total", "Connections handed out", static_cast<double>(pool.acquired));
+    w.counter("db_pool_timeouts_total", "Acquires that timed out or failed fast while unhealthy", static_cast<double>(pool.timeouts));
+    w.counter("db_pool_created_total", "Connections opened", static_cast<double>(pool.created));
+    w.counter("db_pool_discarded_total", "Connections closed as broken or idle", static_cast<double>(pool.discarded));
+    w.counter("db_pool_wait_seconds_total", "Total time spent waiting for a connection", pool.total_wait_us / 1e6);
+    w.gauge("db_pool_max_wait_seconds", "Longest wait for a connection", pool.max_wait_us / 1e6);
+
+    auto writer_metrics = [&w](const char* table, uint64_t written, uint64_t dropped, uint64_t flushes,
+                               uint64_t errors, uint64_t journaled, std::size_t queued) {
+        w.counter("db_rows_written_total", "Rows committed by the batch writers", static_cast<double>(written), {{"table", table}});
+        w.counter("db_rows_dropped_total", "Rows dropped on a full writer queue", static_cast<double>(dropped), {{"table", table}});
+        w.counter("db_flushes_total", "Batch writer transactions", static_cast<double>(flushes), {{"table", table}});
+        w.counter("db_write_errors_total", "Failed batch writes", static_cast<double>(errors), {{"table", table}});
+        w.counter("db_rows_journaled_total", "Rows diverted to the local journal", static_cast<double>(journaled), {{"table", table}});
+        w.gauge("db_writer_queue", "Rows waiting in the batch writer queue", static_cast<double>(queued), {{"table", table}});
+    };
+    if (readings) {
+        auto s = readings->stats();
+        writer_metrics("sensor_readings", s.rows_written, s.rows_dropped, s.flushes, s.write_errors, s.rows_journaled, s.queued);
+    }
+    if (weights) {
+        auto s = weights->stats();
+        writer_metrics("weight_samples", s.rows_written, s.rows_dropped, s.flushes, s.write_errors, s.rows_journaled, s.queued);
+        w.gauge("db_last_flush_seconds", "Duration of the last batch write", s.last_flush_ms / 1000.0, {{"table", "weight_samples"}});
+    }
+
+    if (journal) {
+        auto s = journal->stats();
+        w.counter("journal_records_appended_total", "Records appended to the local journal", static_cast<double>(s.records_appended));
+        w.counter("journal_records_dropped_total", "Records dropped because no segment could be opened", static_cast<double>(s.records_dropped));
+        w.counter("journal_segments_evicted_total", "Segments deleted before upload to stay under the disk limit", static_cast<double>(s.segments_evicted));
+        w.gauge("journal_pending_segments", "Sealed segments waiting for upload", static_cast<double>(s.sealed_segments));
+        w.gauge("journal_disk_bytes", "Disk space used by the local journal", static_cast<double>(s.disk_bytes));
+    }
+    if (uploader) {
+        auto s = uploader->stats();
+        w.counter("journal_rows_uploaded_total", "Journal rows uploaded to the database", static_cast<double>(s.rows_uploaded));
+        w.counter("journal_upload_failures_total", "Failed journal segment uploads", static_cast<double>(s.failures));
+        w.counter("journal_segments_quarantined_total", "Journal segments rejected by the database and set aside", static_cast<double>(s.segments_quarantined));
+    }
+
+    if (ledger) {
+        auto s = ledger->stats();
+        w.counter("consumable_ledger_entries_total", "Pump consumption / runtime entries recorded in the ledger", static_cast<double>(s.entries_recorded));
+        w.counter("consumable_ledger_commits_total", "Ledger batches committed to the database", static_cast<double>(s.batches_committed));
+        w.counter("consumable_ledger_commit_failures_total", "Ledger batch commits that failed and will be retried", static_cast<double>(s.commit_failures));
+        w.gauge("consumable_ledger_commit_pending", "1 while a sealed ledger batch waits for a retry", s.commit_pending ? 1 : 0);
+        w.gauge("consumable_ledger_last_commit_seconds", "Duration of the last ledger commit", s.last_commit_ms / 1000.0);
+    }
+
+    if (archiver) {
+        auto s = archiver->stats();
+        w.counter("run_archives_built_total", "Run archives written by the archiver", static_cast<double>(s.built));
+        w.counter("run_archive_failures_total", "Run archive builds that failed and were rescheduled", static_cast<double>(s.failures));
+        w.counter("run_archive_bytes_total", "Bytes of run archives written", static_cast<double>(s.bytes));
+        w.gauge("run_archive_last_build_seconds", "Duration of the last run archive build", s.last_build_ms / 1000.0);
+        w.gauge("run_archive_pending", "Runs waiting to be archived", static_cast<double>(s.pending));
+        w.gauge("run_archive_open", "Run archives currently mapped", static_cast<double>(s.open_archives));
+    }
+
+    if (consumables) {
+        auto s = consumables->stats();
+        w.counter("consumable_cache_hits_total", "Consumable snapshot reads served from the cache", static_cast<double>(s.hits));
+        w.counter("consumable_cache_loads_total", "Consumable snapshot reloads from the database", static_cast<double>(s.loads));
+        w.counter("consumable_cache_load_failures_total", "Failed consumable snapshot reloads", static_cast<double>(s.load_failures));
+    }
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     try {
         // Initialize logger
@@ -29,6 +229,7 @@ int main(int argc, char* argv[]) {
         spdlog::set_default_logger(console);
         spdlog::set_level(spdlog::level::debug);
         spdlog::info("Starting Enose Control Service...");
+        core::HealthRegistry::instance();  // 启动计时起点
 
         // 加载配置文件
         std::string config_path = DEFAULT_CONFIG_PATH;
@@ -49,72 +250,279 @@ int main(int argc, char* argv[]) {
         std::string grpc_address = config.grpc.address();
         
         // 设置日志级别
-        if (config.logging.level == "debug") {
-            spdlog::set_level(spdlog::level::debug);
-        } else if (config.logging.level == "info") {
-            spdlog::set_level(spdlog::level::info);
-        } else if (config.logging.level == "warn") {
-            spdlog::set_level(spdlog::level::warn);
-        } else if (config.logging.level == "error") {
-            spdlog::set_level(spdlog::level::err);
-        }
+        apply_log_level(config.logging.level);
         
         spdlog::info("Config loaded: gRPC={}, sensor={}, actuator={}:{}", 
                      grpc_address, sensor_port, moonraker_host, moonraker_port);
 
+        // 硬件在环模拟器: 用 pty 上的模拟传感器板和本地模拟 Moonraker 替代真实硬件
+        std::unique_ptr<sim::Simulator> simulator;
+        if (config.simulator.enabled) {
+            try {
+                simulator = std::make_unique<sim::Simulator>(config.simulator);
+                simulator->start();
+                sensor_port = simulator->sensor_device();
+                moonraker_host = simulator->moonraker_host();
+                moonraker_port = simulator->moonraker_port();
+            } catch (const std::exception& e) {
+                spdlog::error("Could not start simulator: {}", e.what());
+                simulator.reset();
+            }
+        }
+
         // 初始化数据库连接池
         std::shared_ptr<db::TestRunRepository> repository;
-        std::shared_ptr<db::ConsumableRepository> consumable_repo;
+        std::shared_ptr<db::ConsumableCache> consumable_cache;
+        std::shared_ptr<db::SensorReadingRepository> sensor_reading_repo;
+        std::shared_ptr<db::SensorBaselineRepository> sensor_baseline_repo;
+        std::shared_ptr<db::WeightSampleWriter> weight_sample_writer;
+        std::shared_ptr<db::RecordingJournal> journal;
+        std::unique_ptr<db::JournalUploader> journal_uploader;
+        std::shared_ptr<db::RunArchiver> run_archiver;
+        std::shared_ptr<db::ConsumableLedger> consumable_ledger;
+        boost::signals2::scoped_connection run_completed_connection;
         if (config.local.timescaledb.enabled) {
             std::string conn_str = config.local.timescaledb.connection_string();
-            spdlog::info("Initializing database connection pool: host={}, db={}",
+
+            // 本地记录日志: 数据库不可达期间的传感器读数 / 称重样本 / 事件落盘, 恢复后补传
+            if (config.local.journal.enabled) {
+                db::RecordingJournal::Options journal_opts;
+                journal_opts.directory = config.local.journal.directory;
+                journal_opts.device_id = config.sensor.device_id;
+                journal_opts.channels = static_cast<std::size_t>(config.sensor.channels);
+                journal_opts.segment_bytes = static_cast<std::size_t>(std::max(config.local.journal.segment_size_mb, 1)) << 20;
+                journal_opts.max_total_bytes = static_cast<std::size_t>(std::max(config.local.journal.max_total_mb, 1)) << 20;
+                journal = std::make_shared<db::RecordingJournal>(journal_opts);
+                if (journal->start()) {
+                    db::JournalUploader::Options upload_opts;
+                    upload_opts.retry_interval = std::chrono::seconds(std::max(config.local.journal.upload_interval_sec, 1));
+                    journal_uploader = std::make_unique<db::JournalUploader>(journal, conn_str, upload_opts);
+                    journal_uploader->start();
+                } else {
+                    journal.reset();
+                }
+            }
+
+            db::SensorReadingRepository::Options reading_opts;
+            reading_opts.device_id = config.sensor.device_id;
+            reading_opts.channels = static_cast<std::size_t>(config.sensor.channels);
+            reading_opts.queue_capacity = static_cast<std::size_t>(config.data_pipeline.buffer_size);
+            reading_opts.batch_rows = static_cast<std::size_t>(config.data_pipeline.batch_rows);
+            reading_opts.flush_interval = std::chrono::milliseconds(config.data_pipeline.batch_write_interval_ms);
+
+            // 连接池在后台预热, 不阻塞启动: 预热完成前 acquire 快速失败, 读数进入记录日志,
+            // 各写线程照常启动, 连接可用后自动恢复写库
+            repository = std::make_shared<db::TestRunRepository>();
+            db::ConnectionPool::Bootstrap bootstrap;
+            // 连续聚合和保留策略; 在首条连接上、预处理语句之前执行, 预处理聚合查询时视图已存在
+            if (config.local.storage.manage) {
+                const auto& storage = config.local.storage;
+                db::TimeseriesStorage::Options storage_opts;
+                storage_opts.sensor_compress_after_days = storage.sensor_compress_after_days;
+                storage_opts.sensor_retention_days = storage.sensor_retention_days;
+                storage_opts.weight_compress_after_days = storage.weight_compress_after_days;
+                storage_opts.weight_retention_days = storage.weight_retention_days;
+                storage_opts.aggregate_1s_retention_days = storage.aggregate_1s_retention_days;
+                storage_opts.aggregate_1m_retention_days = storage.aggregate_1m_retention_days;
+                storage_opts.aggregate_1h_retention_days = storage.aggregate_1h_retention_days;
+                bootstrap = [storage_opts, repository](pqxx::connection& conn) {
+                    try {
+                        repository->set_aggregates_enabled(db::TimeseriesStorage::apply(conn, storage_opts));
+                    } catch (const std::exception& e) {
+                        spdlog::warn("Could not apply storage policies: {}", e.what());
+                    }
+                };
+            }
+
+            spdlog::info("Starting database connection pool: host={}, db={}",
                          config.local.timescaledb.host, config.local.timescaledb.database);
             
-            if (db::ConnectionPool::instance().initialize(conn_str, config.local.timescaledb.pool_size)) {
-                repository = std::make_shared<db::TestRunRepository>();
-                consumable_repo = std::make_shared<db::ConsumableRepository>();
-                spdlog::info("Database connection pool initialized successfully");
-            } else {
-                spdlog::warn("Failed to initialize database connection pool, test persistence disabled");
+            db::ConnectionPool::Options pool_opts;
+            pool_opts.max_size = static_cast<size_t>(std::max(config.local.timescaledb.pool_size, 1));
+            pool_opts.min_size = static_cast<size_t>(std::max(config.local.timescaledb.min_pool_size, 0));
+            db::ConnectionPool::instance().start(conn_str, pool_opts, std::move(bootstrap));
+
+            weight_sample_writer = std::make_shared<db::WeightSampleWriter>(db::WeightSampleWriter::Options{});
+            weight_sample_writer->set_journal(journal);
+            weight_sample_writer->start();
+            repository->set_sample_writer(weight_sample_writer);
+            auto consumable_repo = std::make_shared<db::ConsumableRepository>();
+            consumable_cache = std::make_shared<db::ConsumableCache>(consumable_repo);
+            consumable_cache->start_listener(conn_str);
+            // 实验线程上的泵消耗 / 运行时间只记入账本, 由后台线程批量提交
+            if (config.local.ledger.enabled) {
+                db::ConsumableLedger::Options ledger_opts;
+                ledger_opts.directory = config.local.ledger.directory;
+                ledger_opts.flush_interval = std::chrono::milliseconds(std::max(config.local.ledger.flush_interval_ms, 100));
+                consumable_ledger = std::make_shared<db::ConsumableLedger>(consumable_repo, ledger_opts);
+                if (consumable_ledger->start()) {
+                    consumable_cache->set_ledger(consumable_ledger);
+                } else {
+                    consumable_ledger.reset();
+                }
+            }
+            
+            sensor_reading_repo = std::make_shared<db::SensorReadingRepository>(reading_opts);
+            sensor_reading_repo->set_journal(journal);
+            sensor_reading_repo->start();
+            sensor_baseline_repo = std::make_shared<db::SensorBaselineRepository>(config.sensor.device_id);
+            sensor_baseline_repo->start();
+
+            // 已结束运行的 mmap 归档: 运行结束时生成, 之后读取不再经过数据库
+            if (config.local.archive.enabled) {
+                const auto& archive = config.local.archive;
+                db::RunArchiver::Options archive_opts;
+                archive_opts.directory = archive.directory;
+                archive_opts.settle_delay = std::chrono::seconds(std::max(archive.settle_sec, 0));
+                archive_opts.retry_interval = std::chrono::seconds(std::max(archive.retry_interval_sec, 1));
+                archive_opts.backfill_runs = archive.backfill_runs;
+                archive_opts.max_open = static_cast<std::size_t>(std::max(archive.max_open, 1));
+                run_archiver = std::make_shared<db::RunArchiver>(
+                    std::make_shared<db::RunExportSource>(sensor_reading_repo, repository, journal),
+                    repository, archive_opts);
+                run_completed_connection = repository->on_run_completed.connect(
+                    [archiver = run_archiver.get()](int run_id, const std::string&) { archiver->request(run_id); });
+                run_archiver->start();
             }
         } else {
             spdlog::info("Database not enabled in config, test persistence disabled");
         }
 
         // Drivers
+        // 主板沿用 sensor 顶层配置, additional_boards 各自一个驱动, 读数合并为一条流
         auto sensor_driver = std::make_shared<hal::SensorDriver>(io_context);
+        std::vector<hal::SensorBoardGroup::Board> sensor_boards{{config.sensor.device_id, sensor_driver}};
+        if (!simulator) {
+            for (const auto& board : config.sensor.additional_boards) {
+                sensor_boards.push_back({board.device_id, std::make_shared<hal::SensorDriver>(io_context)});
+            }
+        } else if (!config.sensor.additional_boards.empty()) {
+            spdlog::warn("Simulator provides a single sensor board, ignoring additional_boards");
+        }
+        auto sensor_group = std::make_shared<hal::SensorBoardGroup>(
+            io_context, std::move(sensor_boards),
+            std::chrono::milliseconds(std::max(config.sensor.merge_window_ms, 1)));
         auto actuator_driver = std::make_shared<hal::ActuatorDriver>(io_context);
         
+        // 安全线程: 称重溢出判定不与主 io 线程池争用, 尽量以 SCHED_FIFO 运行
+        core::PriorityExecutor safety_executor({"enose-safety", config.runtime.safety_priority,
+                                                config.runtime.safety_cpu});
+        safety_executor.start();
+
         // Load Cell Driver (称重传感器)
-        auto load_cell_driver = std::make_shared<hal::LoadCellDriver>(io_context, actuator_driver);
+        auto load_cell_driver = std::make_shared<hal::LoadCellDriver>(safety_executor.context(), actuator_driver);
+
+        // 急停专用 Moonraker 连接, 同样在安全线程上, 不受主 io 线程池与主连接写队列影响
+        auto emergency_link = std::make_shared<hal::EmergencyStopLink>(safety_executor.context());
+        actuator_driver->set_emergency_link(emergency_link);
         
         // 加载 Load Cell 配置 (持久化)
-        std::string load_cell_config_path = "/home/user/rpi_odor/enose-control/config/load_cell.json";
+        auto load_cell_config_path = config.load_cell_path();
         load_cell_driver->load_config_from_file(load_cell_config_path);
         load_cell_driver->set_config_path(load_cell_config_path);
+        // 在线泵标定更新后的配置保存不占用安全线程
+        load_cell_driver->set_background_executor(io_context.get_executor());
 
         // System State Machine
         auto system_state = std::make_shared<workflows::SystemState>(actuator_driver);
 
         // gRPC Server (包含传感器服务和称重服务)
-        enose_grpc::GrpcServer grpc_srv(actuator_driver, system_state, sensor_driver, load_cell_driver, repository, consumable_repo);
-        grpc_srv.start(grpc_address);
+        enose_grpc::GrpcServer grpc_srv(actuator_driver, system_state, sensor_driver, load_cell_driver, repository, consumable_cache, sensor_reading_repo, sensor_baseline_repo, sensor_group, journal, run_archiver);
+        // 尽早监听: 构造到这里为止不做阻塞 I/O, 串口 / Moonraker / 数据库在之后并行初始化
+        auto grpc_started = grpc_srv.start(grpc_address);
+
+        // 数据库不可达期间的系统事件写入记录日志, 补传到 system_logs
+        uint64_t journal_subscription = 0;
+        if (journal) {
+            auto events = grpc_srv.system_events();
+            auto cursor = std::make_shared<uint64_t>(events->last_seq() + 1);
+            // notify 在 EventBus 的订阅者锁内调用, 各发布者之间已串行
+            journal_subscription = events->subscribe([events, cursor, journal]() {
+                ::enose::data::Event event;
+                while (events->read(*cursor, event)) {
+                    if (db::ConnectionPool::instance().is_healthy()) continue;
+                    db::JournalEvent record;
+                    record.time = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(
+                            google::protobuf::util::TimeUtil::TimestampToMicroseconds(event.ts()))));
+                    record.level = event.severity() >= ::enose::data::Event::ERROR ? "error"
+                        : event.severity() == ::enose::data::Event::WARNING ? "warning" : "info";
+                    record.source = ::enose::data::Event::EventType_Name(event.type());
+                    record.message = event.text();
+                    journal->append(record);
+                }
+            });
+        }
 
         // Sensor Signals (调试用)
+        // dump() 在参数求值时就会执行, 日志级别关闭时必须跳过
         sensor_driver->on_packet.connect([](const nlohmann::json& j) {
-            spdlog::debug("Sensor Data: {}", j.dump());
+            if (spdlog::should_log(spdlog::level::debug)) {
+                spdlog::debug("Sensor Message: {}", j.dump());
+            }
+        });
+        sensor_driver->on_reading.connect([](const hal::SensorSample& s) {
+            spdlog::trace("Sensor Data: tick={} s={} st={} gi={} v={}",
+                          s.tick_ms, s.sensor_idx, s.type_name(), s.heater_step, s.value);
         });
 
         // Actuator Signals
         actuator_driver->on_status_update.connect([](const nlohmann::json& j) {
-            spdlog::debug("Actuator Status: {}", j.dump());
+            if (spdlog::should_log(spdlog::level::debug)) {
+                spdlog::debug("Actuator Status: {}", j.dump());
+            }
         });
 
         // Start Drivers
-        try {
-            sensor_driver->start(sensor_port, sensor_baud);
-        } catch (const std::exception& e) {
-            spdlog::warn("Could not start sensor driver on {}: {}", sensor_port, e.what());
+        // 各传感器板的串口打开 (含按 USB 序列号查找) 和回放记录加载互不依赖, 并行执行;
+        // Moonraker 连接和数据库预热本身是异步的
+        std::vector<std::future<void>> startup_tasks;
+        // 配置了 replay_file 时用记录代替串口 (记录无法读取时仍回退到串口)
+        std::shared_ptr<hal::SensorReplay> sensor_replay;
+        if (!config.sensor.replay_file.empty()) {
+            std::filesystem::path replay_path(config.sensor.replay_file);
+            if (replay_path.is_relative()) {
+                replay_path = std::filesystem::path(config.config_path()).parent_path() / replay_path;
+            }
+            try {
+                auto recording = hal::ReplayRecording::load(replay_path.string());
+                sensor_replay = std::make_shared<hal::SensorReplay>(io_context, sensor_driver);
+                sensor_replay->start(std::move(recording), {config.sensor.replay_speed, config.sensor.replay_loop});
+            } catch (const std::exception& e) {
+                spdlog::error("Could not load sensor replay {}: {}", replay_path.string(), e.what());
+                sensor_replay.reset();
+            }
+        }
+        if (!sensor_replay) {
+            startup_tasks.push_back(std::async(std::launch::async, [&, sensor_driver] {
+                try {
+                    sensor_driver->set_binary_protocol(config.sensor.binary_protocol, config.sensor.batch_size);
+                    sensor_driver->set_clock_sync_interval(
+                        std::chrono::milliseconds(std::max(config.sensor.clock_sync_interval_ms, 0)));
+                    sensor_driver->set_usb_serial(simulator ? std::string() : config.sensor.usb_serial);
+                    sensor_driver->start(sensor_port, sensor_baud);
+                } catch (const std::exception& e) {
+                    spdlog::warn("Could not start sensor driver on {}: {}", sensor_port, e.what());
+                }
+            }));
+        }
+        // 额外的板不参与回放, 始终走串口
+        for (std::size_t i = 1; i < sensor_group->size(); ++i) {
+            startup_tasks.push_back(std::async(std::launch::async, [&, i] {
+                const auto& board_config = config.sensor.additional_boards[i - 1];
+                const auto& driver = sensor_group->boards()[i].driver;
+                try {
+                    driver->set_binary_protocol(config.sensor.binary_protocol, config.sensor.batch_size);
+                    driver->set_clock_sync_interval(
+                        std::chrono::milliseconds(std::max(config.sensor.clock_sync_interval_ms, 0)));
+                    driver->set_usb_serial(board_config.usb_serial);
+                    driver->start(board_config.serial_port,
+                                  board_config.baud_rate > 0 ? static_cast<unsigned int>(board_config.baud_rate) : sensor_baud);
+                } catch (const std::exception& e) {
+                    spdlog::warn("Could not start sensor driver {} on {}: {}",
+                                 board_config.device_id, board_config.serial_port, e.what());
+                }
+            }));
         }
 
         actuator_driver->connect(moonraker_host, moonraker_port);
@@ -122,13 +530,206 @@ int main(int argc, char* argv[]) {
         // Start Load Cell Driver
         load_cell_driver->start();
 
+        // 子系统就绪状态 (GetHealth / systemd STATUS); 探测函数只读原子状态
+        auto& health = core::HealthRegistry::instance();
+        health.add("grpc", [&grpc_srv, grpc_address]() -> core::HealthRegistry::Probe {
+            return {grpc_srv.is_running(), grpc_address};
+        });
+        if (config.local.timescaledb.enabled) {
+            health.add("database", []() -> core::HealthRegistry::Probe {
+                auto& pool = db::ConnectionPool::instance();
+                auto stats = pool.stats();
+                std::string detail = std::to_string(stats.total) + "/" + std::to_string(stats.max_size) + " connections";
+                if (!pool.is_warm()) detail = "connecting";
+                return {stats.healthy, std::move(detail)};
+            }, false);
+        } else {
+            health.add_disabled("database", "local.timescaledb.enabled = false");
+        }
+        if (sensor_replay) {
+            health.add("sensor", []() -> core::HealthRegistry::Probe { return {true, "replay"}; });
+        }
+        for (std::size_t i = sensor_replay ? 1 : 0; i < sensor_group->size(); ++i) {
+            const auto& board = sensor_group->boards()[i];
+            auto name = sensor_group->size() > 1 ? "sensor:" + board.device_id : std::string("sensor");
+            health.add(name, [driver = board.driver]() -> core::HealthRegistry::Probe {
+                bool connected = driver->stats().connected;
+                return {connected, connected ? "connected" : "serial port not open"};
+            });
+        }
+        health.add("moonraker", [actuator_driver]() -> core::HealthRegistry::Probe {
+            if (!actuator_driver->is_connected()) return {false, "not connected"};
+            if (!actuator_driver->is_firmware_ready()) return {false, "klipper shutdown"};
+            return {true, "connected"};
+        });
+        health.add("load_cell", [load_cell_driver]() -> core::HealthRegistry::Probe {
+            bool ok = load_cell_driver->get_status().sensor_ok;
+            return {ok, ok ? "reading" : "no readings"};
+        });
+
+        // 配置热加载: 文件变化后重新读取全部配置, 校验通过才发布新快照.
+        // 可在线生效的: 日志级别、load_cell.json、analysis 阈值与基线参数、inference 批量/队列/置信度、
+        // 数据库连接池大小; 其余字段 (监听端口、设备、指纹形状、模型、数据库地址等) 提示需要重启.
+        // YAML 变化经快照和 CONFIG_RELOADED 事件交给订阅者.
+        config.add_validator([](const core::ConfigSnapshot& snapshot) {
+            return hal::LoadCellDriver::validate_config_json(snapshot.load_cell);
+        });
+        boost::signals2::scoped_connection config_subscription = config.on_reloaded.connect(
+            [load_cell_driver, &grpc_srv, events = grpc_srv.system_events()](const core::ConfigSnapshot& previous,
+                                                                              const core::ConfigSnapshot& current) {
+                using pointer = nlohmann::json::json_pointer;
+                static const std::set<std::string> live_sections = {"logging", "hot_reload"};
+                // 部分字段在线生效的节: 列出的字段之外有变化才需要重启
+                static const std::map<std::string, std::vector<pointer>> partly_live = {
+                    {"analysis", {pointer("/baseline_alpha"), pointer("/noise_threshold"),
+                                  pointer("/baseline_drift_threshold"), pointer("/saturation_min"),
+                                  pointer("/saturation_max"), pointer("/humidity_min"), pointer("/humidity_max"),
+                                  pointer("/temperature_min"), pointer("/temperature_max"),
+                                  pointer("/baseline_phases"), pointer("/drift_alpha"), pointer("/drift_clip"),
+                                  pointer("/drift_warmup_samples"), pointer("/baseline_persist_interval_sec")}},
+                    {"inference", {pointer("/max_batch"), pointer("/queue_capacity"), pointer("/min_confidence")}},
+                    {"local", {pointer("/timescaledb/pool_size"), pointer("/timescaledb/min_pool_size")}},
+                };
+                std::vector<std::string> requires_restart;
+                for (const auto& name : current.changed) {
+                    if (name == "load_cell.json") {
+                        load_cell_driver->apply_config_json(current.load_cell);
+                    } else if (current.document.contains(name) || previous.document.contains(name)) {
+                        if (live_sections.contains(name)) continue;
+                        auto partly = partly_live.find(name);
+                        if (partly == partly_live.end() || changed_besides(previous, current, name, partly->second)) {
+                            requires_restart.push_back(name);
+                        }
+                    }
+                }
+                if (current.section_changed(previous, "logging")) {
+                    apply_log_level(current.values.logging.level);
+                    spdlog::info("Config: Log level set to {}", current.values.logging.level);
+                }
+                if (current.section_changed(previous, "analysis") || current.section_changed(previous, "inference")) {
+                    // 推理开关以启动时为准, 否则新快照会给未加载模型的服务传入 inference 参数
+                    auto values = current.values;
+                    values.inference.enabled = previous.values.inference.enabled;
+                    values.inference.model_path = previous.values.inference.model_path;
+                    grpc_srv.apply_config(values);
+                }
+                const auto& db_now = current.values.local.timescaledb;
+                const auto& db_before = previous.values.local.timescaledb;
+                if (db_now.pool_size != db_before.pool_size || db_now.min_pool_size != db_before.min_pool_size) {
+                    auto& pool = db::ConnectionPool::instance();
+                    if (pool.is_initialized()) {
+                        pool.resize(static_cast<size_t>(db_now.min_pool_size), static_cast<size_t>(db_now.pool_size));
+                        spdlog::info("Config: Database pool resized to {}..{}", db_now.min_pool_size, db_now.pool_size);
+                    }
+                }
+                if (!requires_restart.empty()) {
+                    spdlog::warn("Config: Changes to [{}] take effect after restart", join_names(requires_restart));
+                }
+                enose_grpc::publish_system_event(*events, ::enose::data::Event::CONFIG_RELOADED,
+                    requires_restart.empty() ? ::enose::data::Event::INFO : ::enose::data::Event::WARNING,
+                    "Configuration version " + std::to_string(current.version) + " loaded",
+                    {{"version", std::to_string(current.version)},
+                     {"changed", join_names(current.changed)},
+                     {"requires_restart", join_names(requires_restart)}});
+            });
+        std::shared_ptr<core::ConfigWatcher> config_watcher;
+        if (config.hot_reload.enabled) {
+            config_watcher = std::make_shared<core::ConfigWatcher>(
+                io_context, std::chrono::milliseconds(std::max(config.hot_reload.debounce_ms, 0)));
+            config_watcher->watch(std::filesystem::path(config.config_path()).parent_path());
+            config_watcher->watch(config.yaml_directory());
+            // 一批变化只触发一次完整重新读取; 内容未变 (如 save_config 写回相同值) 时不发布
+            config_watcher->on_changed.connect([](const std::vector<std::filesystem::path>&) {
+                core::Config::instance().reload_snapshot();
+            });
+            config_watcher->start();
+        }
+
+        // Prometheus 抓取端点; collector 在抓取时读取各组件已有的 stats()
+        auto metrics_registration = core::MetricsRegistry::instance().add_collector(
+            [=, &safety_executor, uploader = journal_uploader.get()](core::MetricWriter& w) {
+                write_link_metrics(w, *sensor_group, *actuator_driver);
+                w.gauge("safety_executor_realtime", "1 when the load cell safety thread runs under SCHED_FIFO",
+                        safety_executor.is_realtime() ? 1 : 0);
+                for (const auto& subsystem : core::HealthRegistry::instance().report()) {
+                    if (subsystem.state == core::HealthRegistry::State::DISABLED) continue;
+                    w.gauge("subsystem_ready", "1 when the subsystem reports READY",
+                            subsystem.state == core::HealthRegistry::State::READY ? 1 : 0,
+                            {{"subsystem", subsystem.name}});
+                }
+                auto config_stats = core::Config::instance().stats();
+                w.gauge("config_version", "Version of the published configuration snapshot",
+                        static_cast<double>(config_stats.version));
+                w.counter("config_reloads_total", "Configuration snapshots published by hot reload",
+                          static_cast<double>(config_stats.reloads));
+                w.counter("config_reload_rejected_total", "Hot reloads rejected by parsing or validation",
+                          static_cast<double>(config_stats.rejected));
+                write_db_metrics(w, sensor_reading_repo.get(), weight_sample_writer.get(), journal.get(),
+                                 uploader, consumable_cache.get(), consumable_ledger.get(), run_archiver.get());
+            });
+        std::unique_ptr<core::MetricsServer> metrics_server;
+        if (config.metrics.enabled) {
+            try {
+                metrics_server = std::make_unique<core::MetricsServer>(
+                    config.metrics.host, static_cast<uint16_t>(config.metrics.port));
+                metrics_server->start();
+            } catch (const std::exception& e) {
+                spdlog::warn("Could not start metrics endpoint on {}:{}: {}",
+                             config.metrics.host, config.metrics.port, e.what());
+                metrics_server.reset();
+            }
+        }
+
         // Signal Handling (Ctrl+C)
         boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
         signals.async_wait([&](const boost::system::error_code&, int) {
             spdlog::info("Shutting down...");
+            if (metrics_server) {
+                metrics_server->stop();
+            }
+            if (config_watcher) {
+                config_watcher->stop();
+            }
+            config_subscription.disconnect();
             grpc_srv.stop();
-            sensor_driver->stop();
+            if (sensor_replay) {
+                sensor_replay->stop();
+            }
+            sensor_group->stop();
+            load_cell_driver->stop();
+            emergency_link->stop();
+            if (sensor_reading_repo) {
+                sensor_reading_repo->stop();
+            }
+            if (sensor_baseline_repo) {
+                sensor_baseline_repo->stop();
+            }
+            if (weight_sample_writer) {
+                weight_sample_writer->stop();
+            }
+            if (journal_subscription) {
+                grpc_srv.system_events()->unsubscribe(journal_subscription);
+            }
+            if (journal_uploader) {
+                journal_uploader->stop();
+            }
+            run_completed_connection.disconnect();
+            if (run_archiver) {
+                run_archiver->stop();
+            }
+            if (journal) {
+                journal->stop();
+            }
+            if (consumable_ledger) {
+                consumable_ledger->stop();
+            }
+            if (consumable_cache) {
+                consumable_cache->stop_listener();
+            }
             db::ConnectionPool::instance().shutdown();
+            if (simulator) {
+                simulator->stop();
+            }
             io_context.stop();
         });
 
@@ -138,6 +739,7 @@ int main(int argc, char* argv[]) {
         watchdog_handler = [&](const boost::system::error_code& ec) {
             if (!ec) {
                 sd_notify(0, "WATCHDOG=1");
+                sd_notify(0, ("STATUS=" + core::HealthRegistry::instance().summary()).c_str());
                 watchdog_timer.expires_after(std::chrono::milliseconds(2500));
                 watchdog_timer.async_wait(watchdog_handler);
             }
@@ -145,13 +747,34 @@ int main(int argc, char* argv[]) {
         watchdog_timer.expires_after(std::chrono::milliseconds(2500));
         watchdog_timer.async_wait(watchdog_handler);
         
-        // 通知 systemd 服务已就绪
-        sd_notify(0, "READY=1");
-        spdlog::info("Systemd notified: READY=1");
+        // 串口打开有界 (失败后由驱动自行重连), 在此汇合; 数据库与 Moonraker 不等待
+        for (auto& task : startup_tasks) {
+            task.get();
+        }
+
+        // 通知 systemd 服务已就绪: 只要求 gRPC 已监听, 其余子系统的状态见 GetHealth
+        if (grpc_started.get()) {
+            sd_notify(0, ("READY=1\nSTATUS=" + health.summary()).c_str());
+            spdlog::info("Systemd notified: READY=1 after {}ms ({})", health.uptime_ms(), health.summary());
+        } else {
+            spdlog::error("gRPC server failed to start on {}", grpc_address);
+        }
 
-        // Run loop
-        spdlog::info("Service running. gRPC on {}, Press Ctrl+C to exit.", grpc_address);
+        // Run loop: 主线程加 runtime.io_threads - 1 个线程共同运行 io_context,
+        // 各驱动在自己的 strand 上串行, 互不阻塞
+        const int io_threads = std::max(config.runtime.io_threads, 1);
+        spdlog::info("Service running with {} io thread(s). gRPC on {}, Press Ctrl+C to exit.",
+                     io_threads, grpc_address);
+        std::vector<std::thread> io_pool;
+        io_pool.reserve(static_cast<std::size_t>(io_threads - 1));
+        for (int i = 1; i < io_threads; ++i) {
+            io_pool.emplace_back([] { io_context.run(); });
+        }
         io_context.run();
+        for (auto& thread : io_pool) {
+            thread.join();
+        }
+        safety_executor.stop();
 
     } catch (const std::exception& e) {
         spdlog::error("Unhandled exception: {}", e.what());
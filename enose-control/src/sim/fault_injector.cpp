@@ -0,0 +1,84 @@
+#include "sim/fault_injector.hpp"
+#include <algorithm>
+
+namespace sim {
+
+FaultInjector::FaultInjector(const core::SimFaultConfig& config, uint32_t seed)
+    : config_(config)
+    , rng_(seed != 0 ? seed : std::random_device{}()) {}
+
+std::chrono::microseconds FaultInjector::delay() {
+    double ms = std::max(config_.latency_ms, 0.0);
+    if (config_.jitter_ms > 0) {
+        ms += std::uniform_real_distribution<double>(0.0, config_.jitter_ms)(rng_);
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(ms * 1000.0));
+}
+
+bool FaultInjector::chance(double p) {
+    if (p <= 0) return false;
+    if (p >= 1) return true;
+    return std::bernoulli_distribution(p)(rng_);
+}
+
+bool FaultInjector::drop() {
+    return chance(config_.drop_rate);
+}
+
+bool FaultInjector::corrupt(std::string& data) {
+    if (data.empty() || !chance(config_.corrupt_rate)) return false;
+    // 不动结尾的换行 / 帧结束符, 否则损坏会蔓延到下一条消息
+    const std::size_t span = data.size() > 1 ? data.size() - 1 : 1;
+    const std::size_t pos = std::uniform_int_distribution<std::size_t>(0, span - 1)(rng_);
+    const int bit = std::uniform_int_distribution<int>(0, 6)(rng_);
+    data[pos] = static_cast<char>(data[pos] ^ (1 << bit));
+    if (data[pos] == '\n' || data[pos] == '\0') {
+        data[pos] = static_cast<char>(data[pos] ^ 0x40);
+    }
+    return true;
+}
+
+double FaultInjector::gaussian(double sigma) {
+    if (sigma <= 0) return 0.0;
+    return std::normal_distribution<double>(0.0, sigma)(rng_);
+}
+
+DelayLine::DelayLine(boost::asio::io_context& io, Sink sink)
+    : timer_(io), sink_(std::move(sink)) {}
+
+void DelayLine::push(std::string data, std::chrono::microseconds delay) {
+    if (delay.count() <= 0 && queue_.empty()) {
+        sink_(std::move(data));
+        return;
+    }
+    const auto due = std::max(last_due_, std::chrono::steady_clock::now() + delay);
+    last_due_ = due;
+    queue_.emplace_back(due, std::move(data));
+    arm();
+}
+
+void DelayLine::clear() {
+    queue_.clear();
+    timer_.cancel();
+    armed_ = false;
+}
+
+void DelayLine::arm() {
+    if (armed_ || queue_.empty()) return;
+    armed_ = true;
+    timer_.expires_at(queue_.front().first);
+    timer_.async_wait([this](boost::system::error_code ec) {
+        // 被 clear() 取消时 armed_ 已复位, 不能再动它 (可能已有新的等待)
+        if (ec) return;
+        armed_ = false;
+        const auto now = std::chrono::steady_clock::now();
+        while (!queue_.empty() && queue_.front().first <= now) {
+            auto data = std::move(queue_.front().second);
+            queue_.pop_front();
+            sink_(std::move(data));
+        }
+        arm();
+    });
+}
+
+} // namespace sim
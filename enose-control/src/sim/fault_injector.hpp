@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core/config.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+
+namespace sim {
+
+/**
+ * @brief 按 SimFaultConfig 做随机决策 (延迟 / 丢弃 / 损坏)
+ *
+ * 每条模拟链路持有一个实例, 只在模拟器 io 线程上使用
+ */
+class FaultInjector {
+public:
+    FaultInjector(const core::SimFaultConfig& config, uint32_t seed);
+
+    /** @brief 本条消息的发送延迟 (latency + [0, jitter)) */
+    std::chrono::microseconds delay();
+
+    bool drop();
+
+    /** @brief 按 corrupt_rate 翻转 data 中的一个字节, 返回是否损坏 */
+    bool corrupt(std::string& data);
+
+    /** @brief 正态噪声, 供物理模型使用 (与故障决策共用随机源以保证可复现) */
+    double gaussian(double sigma);
+
+    const core::SimFaultConfig& config() const { return config_; }
+
+private:
+    bool chance(double p);
+
+    core::SimFaultConfig config_;
+    std::mt19937 rng_;
+};
+
+/**
+ * @brief 保序的延迟发送队列
+ *
+ * 每条消息的到期时间 = max(上一条到期时间, now + delay), 模拟串口 / TCP 的 FIFO 行为:
+ * 抖动只拉长间隔, 不会让消息乱序. 到期后交给 sink 写出
+ */
+class DelayLine {
+public:
+    using Sink = std::function<void(std::string)>;
+
+    DelayLine(boost::asio::io_context& io, Sink sink);
+
+    void push(std::string data, std::chrono::microseconds delay);
+
+    /** @brief 丢弃所有未发出的消息 (链路断开) */
+    void clear();
+
+    std::size_t size() const { return queue_.size(); }
+
+private:
+    void arm();
+
+    boost::asio::steady_timer timer_;
+    Sink sink_;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::string>> queue_;
+    std::chrono::steady_clock::time_point last_due_{};
+    bool armed_ = false;
+};
+
+} // namespace sim
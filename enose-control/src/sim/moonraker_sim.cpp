@@ -0,0 +1,660 @@
+#include "sim/moonraker_sim.hpp"
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <format>
+#include <set>
+#include <sstream>
+
+namespace sim {
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// G1 轴字母 -> 泵编号 (与 SystemState::start_inject 一致, 跳过 E/F/G)
+constexpr std::array<char, MoonrakerSim::PUMP_COUNT> PUMP_AXES = {'A', 'B', 'C', 'D', 'H', 'I', 'J', 'K'};
+
+constexpr double LOAD_CELL_FULL_SCALE_G = 2000.0;   // raw_sample = force / 满量程
+
+std::string upper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::toupper(c); });
+    return s;
+}
+
+// Klipper 扩展命令参数 KEY=VALUE (键不区分大小写)
+std::map<std::string, std::string> parse_params(std::istringstream& in) {
+    std::map<std::string, std::string> params;
+    std::string token;
+    while (in >> token) {
+        auto eq = token.find('=');
+        if (eq == std::string::npos) continue;
+        params[upper(token.substr(0, eq))] = token.substr(eq + 1);
+    }
+    return params;
+}
+
+double param_or(const std::map<std::string, std::string>& params, const char* key, double fallback) {
+    auto it = params.find(key);
+    if (it == params.end()) return fallback;
+    try {
+        return std::stod(it->second);
+    } catch (const std::exception&) {
+        return fallback;
+    }
+}
+
+int pump_index(const std::string& stepper) {
+    // "pump_N"
+    constexpr std::string_view prefix = "pump_";
+    if (stepper.compare(0, prefix.size(), prefix) != 0) return -1;
+    try {
+        const int idx = std::stoi(stepper.substr(prefix.size()));
+        return idx >= 0 && idx < static_cast<int>(MoonrakerSim::PUMP_COUNT) ? idx : -1;
+    } catch (const std::exception&) {
+        return -1;
+    }
+}
+
+nlohmann::json rpc_error(const nlohmann::json& id, int code, const std::string& message) {
+    return {{"jsonrpc", "2.0"}, {"error", {{"code", code}, {"message", message}}}, {"id", id}};
+}
+
+} // namespace
+
+/**
+ * @brief 一个 WebSocket 客户端连接
+ */
+class MoonrakerSim::Session : public std::enable_shared_from_this<MoonrakerSim::Session> {
+public:
+    Session(MoonrakerSim& owner, tcp::socket socket)
+        : owner_(owner)
+        , ws_(std::move(socket))
+        , out_(owner.io_, [this](std::string data) {
+              queue_.push_back(std::move(data));
+              write_next();
+          }) {}
+
+    void start() {
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        ws_.async_accept([self = shared_from_this()](beast::error_code ec) {
+            if (ec) {
+                spdlog::debug("MoonrakerSim: Handshake failed: {}", ec.message());
+                return;
+            }
+            self->open_ = true;
+            self->do_read();
+        });
+    }
+
+    void send(std::string message, std::chrono::microseconds delay) {
+        if (!open_) return;
+        out_.push(std::move(message), delay);
+    }
+
+    void close() {
+        if (!open_) return;
+        open_ = false;
+        out_.clear();
+        queue_.clear();
+        beast::error_code ignored;
+        beast::get_lowest_layer(ws_).socket().shutdown(tcp::socket::shutdown_both, ignored);
+        beast::get_lowest_layer(ws_).socket().close(ignored);
+    }
+
+    bool open() const { return open_; }
+
+    std::set<std::string> subscriptions;
+    nlohmann::json last_sent = nlohmann::json::object();   // 已推送的对象状态, 用于计算增量
+
+private:
+    void do_read() {
+        ws_.async_read(buffer_, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec) {
+                self->open_ = false;
+                return;
+            }
+            auto data = beast::buffers_to_string(self->buffer_.data());
+            self->buffer_.consume(self->buffer_.size());
+            auto request = nlohmann::json::parse(data, nullptr, false);
+            if (!request.is_discarded() && request.is_object()) {
+                self->owner_.handle_request(self, request);
+            }
+            if (self->open_) self->do_read();
+        });
+    }
+
+    void write_next() {
+        if (writing_ || queue_.empty() || !open_) return;
+        writing_ = true;
+        ws_.text(true);
+        ws_.async_write(boost::asio::buffer(queue_.front()),
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                self->writing_ = false;
+                if (ec) {
+                    self->open_ = false;
+                    return;
+                }
+                if (!self->queue_.empty()) self->queue_.pop_front();
+                self->write_next();
+            });
+    }
+
+    MoonrakerSim& owner_;
+    websocket::stream<beast::tcp_stream> ws_;
+    beast::flat_buffer buffer_;
+    DelayLine out_;
+    std::deque<std::string> queue_;
+    bool writing_ = false;
+    bool open_ = false;
+};
+
+MoonrakerSim::MoonrakerSim(boost::asio::io_context& io, const core::SimMoonrakerConfig& config, uint32_t seed)
+    : io_(io)
+    , config_(config)
+    , faults_(config.faults, seed)
+    , acceptor_(io)
+    , tick_timer_(io)
+    , restart_timer_(io)
+    , disconnect_timer_(io) {
+    config_.status_interval_ms = std::max(config_.status_interval_ms, 10);
+}
+
+MoonrakerSim::~MoonrakerSim() {
+    stop();
+}
+
+void MoonrakerSim::start() {
+    tcp::endpoint endpoint(boost::asio::ip::make_address(config_.host), static_cast<uint16_t>(config_.port));
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+    port_ = acceptor_.local_endpoint().port();
+
+    started_ = last_tick_ = std::chrono::steady_clock::now();
+    tare_g_ = 0.0;
+    spdlog::info("MoonrakerSim: Listening on ws://{}:{}/websocket", config_.host, port_);
+    do_accept();
+    schedule_tick();
+    schedule_disconnect();
+}
+
+void MoonrakerSim::stop() {
+    boost::system::error_code ignored;
+    acceptor_.close(ignored);
+    tick_timer_.cancel();
+    restart_timer_.cancel();
+    disconnect_timer_.cancel();
+    for (auto& weak : sessions_) {
+        if (auto session = weak.lock()) session->close();
+    }
+    sessions_.clear();
+}
+
+MoonrakerSim::Stats MoonrakerSim::stats() const {
+    Stats s;
+    s.connections = connections_;
+    s.requests = requests_;
+    s.gcode_lines = gcode_lines_;
+    s.dropped_responses = dropped_responses_;
+    s.disconnects = disconnects_;
+    return s;
+}
+
+void MoonrakerSim::do_accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != boost::asio::error::operation_aborted) {
+                spdlog::warn("MoonrakerSim: Accept failed: {}", ec.message());
+            }
+            return;
+        }
+        ++connections_;
+        auto session = std::make_shared<Session>(*this, std::move(socket));
+        std::erase_if(sessions_, [](const std::weak_ptr<Session>& w) { return w.expired(); });
+        sessions_.push_back(session);
+        session->start();
+        do_accept();
+    });
+}
+
+void MoonrakerSim::handle_request(const std::shared_ptr<Session>& session, const nlohmann::json& request) {
+    ++requests_;
+    const auto id = request.value("id", nlohmann::json());
+    const std::string method = request.value("method", std::string());
+    const auto params = request.contains("params") && request["params"].is_object()
+        ? request["params"] : nlohmann::json::object();
+
+    nlohmann::json response;
+    if (method == "printer.info") {
+        response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", {
+            {"state", klippy_state_}, {"state_message", state_message_},
+            {"hostname", "enose-sim"}, {"software_version", "v0.12.0-sim"},
+            {"cpu_info", "simulated"}, {"klipper_path", ""}, {"python_path", ""},
+            {"log_file", ""}, {"config_file", ""}}}};
+    } else if (method == "server.info") {
+        response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", {
+            {"klippy_connected", true}, {"klippy_state", klippy_state_},
+            {"components", nlohmann::json::array()}, {"moonraker_version", "v0.8.0-sim"}}}};
+    } else if (method == "printer.objects.list") {
+        response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", {{"objects", object_names()}}}};
+    } else if (method == "printer.objects.query" || method == "printer.objects.subscribe") {
+        const auto objects = params.value("objects", nlohmann::json::object());
+        for (auto it = objects.begin(); it != objects.end(); ++it) {
+            if (it.key().rfind("load_cell ", 0) == 0) load_cell_object_ = it.key();
+        }
+        auto status = query_status(objects);
+        if (method == "printer.objects.subscribe") {
+            // Moonraker 的订阅按连接整体替换
+            session->subscriptions.clear();
+            for (auto it = objects.begin(); it != objects.end(); ++it) {
+                session->subscriptions.insert(it.key());
+            }
+            session->last_sent = status;
+        }
+        response = {{"jsonrpc", "2.0"}, {"id", id},
+                    {"result", {{"eventtime", eventtime()}, {"status", std::move(status)}}}};
+    } else if (method == "printer.gcode.script") {
+        std::string error;
+        if (run_gcode(params.value("script", std::string()), error)) {
+            response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", "ok"}};
+        } else {
+            response = rpc_error(id, 400, error);
+        }
+    } else if (method == "printer.emergency_stop") {
+        emergency_stop("Shutdown due to webhooks request");
+        response = {{"jsonrpc", "2.0"}, {"id", id}, {"result", "ok"}};
+    } else {
+        response = rpc_error(id, -32601, "Method not found");
+    }
+
+    if (id.is_null()) return;   // 通知, 不回复
+    if (faults_.drop()) {
+        ++dropped_responses_;
+        return;
+    }
+    session->send(response.dump(), faults_.delay());
+}
+
+bool MoonrakerSim::run_gcode(const std::string& script, std::string& error) {
+    std::istringstream lines(script);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (auto comment = line.find(';'); comment != std::string::npos) line.erase(comment);
+        const auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        line = line.substr(first);
+        ++gcode_lines_;
+
+        const std::string command = upper(line.substr(0, line.find_first_of(" \t")));
+        // shutdown 状态下 Klipper 只接受重启命令, 并跳过脚本的剩余部分
+        if (klippy_state_ != "ready" && command != "FIRMWARE_RESTART" && command != "RESTART") {
+            error = klippy_state_ == "shutdown" ? "Printer is shutdown" : "Printer is not ready";
+            return false;
+        }
+        run_gcode_line(line);
+    }
+    return true;
+}
+
+void MoonrakerSim::run_gcode_line(const std::string& line) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+    command = upper(command);
+
+    if (command == "SET_PIN") {
+        auto params = parse_params(in);
+        auto it = params.find("PIN");
+        if (it != params.end()) set_pin(it->second, param_or(params, "VALUE", 0.0));
+    } else if (command == "G1" || command == "G0") {
+        std::array<double, PUMP_COUNT> distance{};
+        double longest = 0.0;
+        std::string word;
+        while (in >> word) {
+            if (word.size() < 2) continue;
+            const char axis = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+            double value = 0.0;
+            try {
+                value = std::stod(word.substr(1));
+            } catch (const std::exception&) {
+                continue;
+            }
+            if (axis == 'F') {
+                if (value > 0) feedrate_mm_min_ = value;
+                continue;
+            }
+            auto pos = std::find(PUMP_AXES.begin(), PUMP_AXES.end(), axis);
+            if (pos == PUMP_AXES.end()) continue;
+            const auto pump = static_cast<std::size_t>(pos - PUMP_AXES.begin());
+            distance[pump] = absolute_ ? value - axis_position_[pump] : value;
+            axis_position_[pump] += distance[pump];
+            longest = std::max(longest, std::abs(distance[pump]));
+        }
+        if (longest <= 0) return;
+        Move move;
+        move.remaining_s = longest / (feedrate_mm_min_ / 60.0);
+        for (std::size_t p = 0; p < PUMP_COUNT; ++p) {
+            move.rate_g_s[p] = distance[p] * config_.grams_per_mm / move.remaining_s;
+        }
+        motion_queue_.push_back(move);
+    } else if (command == "G90") {
+        absolute_ = true;
+    } else if (command == "G91") {
+        absolute_ = false;
+    } else if (command == "G92" || command == "REGISTER_PUMPS_TO_AXIS") {
+        axis_position_.fill(0.0);
+    } else if (command == "MANUAL_STEPPER") {
+        auto params = parse_params(in);
+        const int pump = pump_index(params.count("STEPPER") ? params["STEPPER"] : std::string());
+        if (pump < 0) return;
+        if (params.count("ENABLE") && param_or(params, "ENABLE", 1.0) == 0.0) {
+            manual_moves_[pump] = Move{};
+        }
+        if (params.count("SET_POSITION")) {
+            manual_position_[pump] = param_or(params, "SET_POSITION", 0.0);
+        }
+        if (params.count("MOVE")) {
+            const double target = param_or(params, "MOVE", manual_position_[pump]);
+            const double speed = std::max(param_or(params, "SPEED", 10.0), 1e-3);
+            const double distance = target - manual_position_[pump];
+            manual_position_[pump] = target;
+            Move move;
+            move.remaining_s = std::abs(distance) / speed;
+            if (move.remaining_s > 0) {
+                move.rate_g_s[pump] = distance * config_.grams_per_mm / move.remaining_s;
+            }
+            manual_moves_[pump] = move;
+        }
+    } else if (command == "ENOSE_ASYNC_STOP" || command == "STOP_ALL_PUMPS") {
+        motion_queue_.clear();
+        manual_moves_.fill(Move{});
+        finish_dispense("cancelled", "Stopped by " + command);
+    } else if (command == "ENOSE_DISPENSE") {
+        start_dispense(parse_params(in));
+    } else if (command == "ENOSE_DISPENSE_CANCEL") {
+        finish_dispense("cancelled", "Cancelled");
+    } else if (command == "LOAD_CELL_TARE") {
+        tare_g_ = config_.empty_bottle_g + sample_g_ + water_g_;
+    } else if (command == "M112") {
+        emergency_stop("Shutdown due to M112 command");
+    } else if (command == "FIRMWARE_RESTART" || command == "RESTART") {
+        firmware_restart();
+    }
+    // 其余命令 (宏、M400 等) 视为立即成功
+}
+
+void MoonrakerSim::start_dispense(const std::map<std::string, std::string>& params) {
+    const auto pump = params.find("PUMP");
+    const int index = pump_index(pump != params.end() ? pump->second : std::string());
+    const double target = param_or(params, "TARGET", 0.0);
+    if (dispense_.active || index < 0 || target <= 0) {
+        spdlog::warn("MoonrakerSim: ENOSE_DISPENSE rejected");
+        return;
+    }
+    dispense_.active = true;
+    ++dispense_.id;
+    dispense_.pump = index;
+    dispense_.target_g = target;
+    dispense_.coarse_speed = param_or(params, "COARSE_SPEED", 20.0);
+    dispense_.fine_speed = std::min(param_or(params, "FINE_SPEED", 2.0), dispense_.coarse_speed);
+    dispense_.slowdown_g = param_or(params, "SLOWDOWN", 5.0);
+    dispense_.remaining_s = param_or(params, "TIMEOUT", 120.0);
+    dispense_.start_g = sample_g_;
+    dispense_.dispensed_g = 0.0;
+    dispense_.speed = 0.0;
+    dispense_.state = "running";
+    dispense_.message.clear();
+}
+
+void MoonrakerSim::finish_dispense(const std::string& state, const std::string& message) {
+    if (!dispense_.active) return;
+    dispense_.active = false;
+    dispense_.speed = 0.0;
+    dispense_.state = state;
+    dispense_.message = message;
+    manual_moves_[dispense_.pump] = Move{};
+}
+
+void MoonrakerSim::update_dispense(double dt) {
+    if (!dispense_.active) return;
+    dispense_.dispensed_g = sample_g_ - dispense_.start_g;
+    const double remaining = dispense_.target_g - dispense_.dispensed_g;
+    dispense_.remaining_s -= dt;
+    if (remaining <= 1e-3) {
+        finish_dispense("done", std::format("Dispensed {:.2f}g", dispense_.dispensed_g));
+        return;
+    }
+    if (dispense_.remaining_s <= 0) {
+        finish_dispense("failed", "Timeout");
+        return;
+    }
+    // 先快后慢, 与插件相同的线性减速
+    double speed = dispense_.coarse_speed;
+    if (dispense_.slowdown_g > 0 && remaining < dispense_.slowdown_g) {
+        speed = dispense_.fine_speed + (dispense_.coarse_speed - dispense_.fine_speed) * remaining / dispense_.slowdown_g;
+    }
+    dispense_.speed = speed;
+    // 下一个 tick 内的运动, 最后一段截到目标为止
+    Move move;
+    const double rate = speed * config_.grams_per_mm;
+    move.remaining_s = std::min(dt > 0 ? dt : config_.status_interval_ms / 1000.0, remaining / rate);
+    move.rate_g_s[dispense_.pump] = rate;
+    manual_moves_[dispense_.pump] = move;
+}
+
+void MoonrakerSim::emergency_stop(const std::string& message) {
+    motion_queue_.clear();
+    manual_moves_.fill(Move{});
+    finish_dispense("cancelled", message);
+    // Klipper shutdown 后所有输出回到 shutdown_value (0)
+    for (auto& [name, value] : pins_) value = 0.0;
+    klippy_state_ = "shutdown";
+    state_message_ = message;
+    spdlog::warn("MoonrakerSim: {}", message);
+    broadcast("notify_klippy_shutdown");
+}
+
+void MoonrakerSim::firmware_restart() {
+    motion_queue_.clear();
+    manual_moves_.fill(Move{});
+    klippy_state_ = "startup";
+    state_message_ = "Printer is restarting";
+    broadcast("notify_klippy_disconnected");
+    restart_timer_.expires_after(std::chrono::milliseconds(std::max(config_.restart_ms, 0)));
+    restart_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        pins_.clear();
+        axis_position_.fill(0.0);
+        klippy_state_ = "ready";
+        state_message_ = "Printer is ready";
+        spdlog::info("MoonrakerSim: Klipper ready");
+        broadcast("notify_klippy_ready");
+    });
+}
+
+void MoonrakerSim::set_pin(const std::string& name, double value) {
+    pins_[name] = value;
+}
+
+double MoonrakerSim::pin(const std::string& name) const {
+    auto it = pins_.find(name);
+    return it == pins_.end() ? 0.0 : it->second;
+}
+
+void MoonrakerSim::schedule_tick() {
+    tick_timer_.expires_after(std::chrono::milliseconds(config_.status_interval_ms));
+    tick_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        tick();
+        schedule_tick();
+    });
+}
+
+void MoonrakerSim::tick() {
+    const auto now = std::chrono::steady_clock::now();
+    const double dt = std::chrono::duration<double>(now - last_tick_).count();
+    advance(dt);
+    update_dispense(dt);
+    last_tick_ = now;
+
+    const double gross = config_.empty_bottle_g + sample_g_ + water_g_;
+    force_g_ = gross - tare_g_ + faults_.gaussian(config_.noise_g);
+
+    FluidState fluid;
+    fluid.sample_g = sample_g_;
+    fluid.water_g = water_g_;
+    fluid.air_pump = pin("air_pump_pwm");
+    fluid.chamber_open = pin("valve_air") >= 0.5;
+    fluid.draining = pin("valve_waste") >= 0.5 && fluid.air_pump > 0;
+    on_fluid_state(fluid);
+
+    // 与 Moonraker 相同: 只推送订阅对象中变化了的字段
+    const double t = eventtime();
+    for (auto& weak : sessions_) {
+        auto session = weak.lock();
+        if (!session || !session->open() || session->subscriptions.empty()) continue;
+        nlohmann::json diff = nlohmann::json::object();
+        for (const auto& name : session->subscriptions) {
+            auto status = object_status(name);
+            if (status.is_null()) continue;
+            auto& previous = session->last_sent[name];
+            nlohmann::json changed = nlohmann::json::object();
+            for (auto it = status.begin(); it != status.end(); ++it) {
+                if (!previous.is_object() || !previous.contains(it.key()) || previous[it.key()] != it.value()) {
+                    changed[it.key()] = it.value();
+                }
+            }
+            if (!changed.empty()) {
+                diff[name] = changed;
+                previous = std::move(status);
+            }
+        }
+        if (diff.empty()) continue;
+        nlohmann::json notify = {{"jsonrpc", "2.0"}, {"method", "notify_status_update"},
+                                 {"params", nlohmann::json::array({diff, t})}};
+        session->send(notify.dump(), faults_.delay());
+    }
+}
+
+void MoonrakerSim::advance(double dt) {
+    if (dt <= 0) return;
+
+    // G1 按队列顺序执行, 一个 tick 内可能跨越多段
+    double budget = dt;
+    while (budget > 0 && !motion_queue_.empty()) {
+        auto& move = motion_queue_.front();
+        const double step = std::min(budget, move.remaining_s);
+        for (double rate : move.rate_g_s) sample_g_ += rate * step;
+        move.remaining_s -= step;
+        budget -= step;
+        if (move.remaining_s <= 1e-9) motion_queue_.pop_front();
+    }
+    for (auto& move : manual_moves_) {
+        if (move.remaining_s <= 0) continue;
+        const double step = std::min(dt, move.remaining_s);
+        for (double rate : move.rate_g_s) sample_g_ += rate * step;
+        move.remaining_s -= step;
+    }
+    sample_g_ = std::max(sample_g_, 0.0);
+
+    water_g_ += std::clamp(pin("cleaning_pump"), 0.0, 1.0) * config_.clean_rate_g_s * dt;
+
+    if (pin("valve_waste") >= 0.5 && pin("air_pump_pwm") > 0) {
+        const double total = sample_g_ + water_g_;
+        if (total > 0) {
+            const double removed = std::min(total, config_.drain_rate_g_s * dt);
+            const double keep = (total - removed) / total;
+            sample_g_ *= keep;
+            water_g_ *= keep;
+        }
+    }
+}
+
+nlohmann::json MoonrakerSim::object_status(const std::string& name) const {
+    if (name == load_cell_object_ || name.rfind("load_cell ", 0) == 0) {
+        const double force = config_.invert_reading ? -force_g_ : force_g_;
+        return {{"force_g", force},
+                {"raw_sample", std::clamp(force / LOAD_CELL_FULL_SCALE_G, -1.0, 1.0)},
+                {"is_calibrated", true}};
+    }
+    if (name.rfind("output_pin ", 0) == 0) {
+        return {{"value", pin(name.substr(std::string("output_pin ").size()))}};
+    }
+    if (name.rfind("manual_stepper ", 0) == 0) {
+        const int pump = pump_index(name.substr(std::string("manual_stepper ").size()));
+        if (pump < 0) return nullptr;
+        return {{"position", manual_position_[pump]}, {"enabled", manual_moves_[pump].remaining_s > 0}};
+    }
+    if (name == "enose_control") {
+        return {{"dispense", {{"state", dispense_.state}, {"id", dispense_.id},
+                              {"pump", dispense_.pump >= 0 ? "pump_" + std::to_string(dispense_.pump) : ""},
+                              {"target_g", dispense_.target_g}, {"dispensed_g", dispense_.dispensed_g},
+                              {"speed", dispense_.speed}, {"message", dispense_.message}}}};
+    }
+    if (name == "heaters") {
+        return {{"available_heaters", nlohmann::json::array()}, {"available_sensors", nlohmann::json::array()}};
+    }
+    if (name == "display_status") {
+        return {{"progress", 0.0}, {"message", nullptr}};
+    }
+    if (name == "webhooks") {
+        return {{"state", klippy_state_}, {"state_message", state_message_}};
+    }
+    if (name == "toolhead") {
+        return {{"homed_axes", ""}, {"status", motion_queue_.empty() ? "Ready" : "Printing"}};
+    }
+    return nullptr;
+}
+
+nlohmann::json MoonrakerSim::query_status(const nlohmann::json& objects) const {
+    nlohmann::json status = nlohmann::json::object();
+    for (auto it = objects.begin(); it != objects.end(); ++it) {
+        auto value = object_status(it.key());
+        if (!value.is_null()) status[it.key()] = std::move(value);
+    }
+    return status;
+}
+
+std::vector<std::string> MoonrakerSim::object_names() const {
+    std::vector<std::string> names = {load_cell_object_, "heaters", "display_status", "webhooks", "toolhead",
+                                      "enose_control"};
+    for (const auto& [name, value] : pins_) names.push_back("output_pin " + name);
+    for (std::size_t p = 0; p < PUMP_COUNT; ++p) names.push_back("manual_stepper pump_" + std::to_string(p));
+    return names;
+}
+
+void MoonrakerSim::broadcast(const std::string& method, nlohmann::json params) {
+    const std::string message = nlohmann::json{{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}}.dump();
+    for (auto& weak : sessions_) {
+        if (auto session = weak.lock()) session->send(message, faults_.delay());
+    }
+}
+
+void MoonrakerSim::schedule_disconnect() {
+    if (config_.faults.disconnect_interval_sec <= 0) return;
+    disconnect_timer_.expires_after(std::chrono::milliseconds(
+        static_cast<int64_t>(config_.faults.disconnect_interval_sec * 1000.0)));
+    disconnect_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        ++disconnects_;
+        spdlog::warn("MoonrakerSim: Injected disconnect of {} clients", sessions_.size());
+        for (auto& weak : sessions_) {
+            if (auto session = weak.lock()) session->close();
+        }
+        sessions_.clear();
+        schedule_disconnect();
+    });
+}
+
+double MoonrakerSim::eventtime() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+}
+
+} // namespace sim
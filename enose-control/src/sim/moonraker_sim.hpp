@@ -0,0 +1,165 @@
+#pragma once
+
+#include "core/config.hpp"
+#include "sim/fault_injector.hpp"
+#include <boost/asio.hpp>
+#include <boost/signals2.hpp>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+/**
+ * @brief 模拟流体状态 (每次物理步进后通过 MoonrakerSim::on_fluid_state 发出)
+ */
+struct FluidState {
+    double sample_g = 0.0;              // 蠕动泵注入的样品液
+    double water_g = 0.0;               // 清洗泵注入的清水
+    double air_pump = 0.0;              // air_pump_pwm
+    bool chamber_open = false;          // valve_air = 1: 气泵从样品瓶顶空抽气送往传感器气室
+    bool draining = false;
+};
+
+/**
+ * @brief 模拟 Moonraker WebSocket JSON-RPC 服务与 Klipper 上的外设
+ *
+ * 支持 ActuatorDriver / LoadCellDriver 用到的方法: printer.info, server.info,
+ * printer.objects.list / query / subscribe (按连接记录订阅, 定时推送字段增量的
+ * notify_status_update), printer.gcode.script; 以及 notify_klippy_shutdown / ready.
+ *
+ * G-code 驱动一个简单的物理模型:
+ * - G1 A/B/C/D/H/I/J/K (REGISTER_PUMPS_TO_AXIS 后的蠕动泵轴) 按 F 进给依次执行,
+ *   MANUAL_STEPPER ... MOVE= SPEED= 独立执行; 行程 × grams_per_mm 进入样品瓶
+ * - SET_PIN cleaning_pump 注入清水, valve_waste + air_pump_pwm 排废
+ * - ENOSE_ASYNC_STOP / STOP_ALL_PUMPS 停泵, M112 进入 shutdown, FIRMWARE_RESTART 恢复
+ * - ENOSE_DISPENSE 按样品瓶增重闭环定量 (速度曲线与插件相同, 无管路延迟),
+ *   进度见 "enose_control" 对象的 dispense 字段
+ * - "load_cell <name>" 对象的 force_g = 空瓶 + 液体 - 去皮 + 噪声
+ *
+ * 所有方法在模拟器 io 线程调用
+ */
+class MoonrakerSim {
+public:
+    static constexpr std::size_t PUMP_COUNT = 8;
+
+    struct Stats {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t gcode_lines = 0;
+        uint64_t dropped_responses = 0;
+        uint64_t disconnects = 0;
+    };
+
+    MoonrakerSim(boost::asio::io_context& io, const core::SimMoonrakerConfig& config, uint32_t seed);
+    ~MoonrakerSim();
+
+    /** @brief 绑定并开始接受连接; 失败时抛出异常 */
+    void start();
+    void stop();
+
+    const std::string& host() const { return config_.host; }
+    /** @brief 实际监听端口 (配置为 0 时由系统分配) */
+    uint16_t port() const { return port_; }
+
+    Stats stats() const;
+
+    boost::signals2::signal<void(const FluidState&)> on_fluid_state;
+
+private:
+    class Session;
+    friend class Session;
+
+    struct Move {
+        double remaining_s = 0.0;
+        std::array<double, PUMP_COUNT> rate_g_s{};  // 负值 = 反转回抽
+    };
+
+    void do_accept();
+    void handle_request(const std::shared_ptr<Session>& session, const nlohmann::json& request);
+    bool run_gcode(const std::string& script, std::string& error);
+    void run_gcode_line(const std::string& line);
+    void emergency_stop(const std::string& message);
+    void firmware_restart();
+    void start_dispense(const std::map<std::string, std::string>& params);
+    void finish_dispense(const std::string& state, const std::string& message);
+    void update_dispense(double dt);
+    void set_pin(const std::string& pin, double value);
+    double pin(const std::string& pin) const;
+
+    void schedule_tick();
+    void tick();
+    void advance(double dt);
+    nlohmann::json object_status(const std::string& name) const;
+    nlohmann::json query_status(const nlohmann::json& objects) const;
+    std::vector<std::string> object_names() const;
+    void broadcast(const std::string& method, nlohmann::json params = nlohmann::json::array());
+    void schedule_disconnect();
+    double eventtime() const;
+
+    boost::asio::io_context& io_;
+    core::SimMoonrakerConfig config_;
+    FaultInjector faults_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    uint16_t port_ = 0;
+    std::vector<std::weak_ptr<Session>> sessions_;
+
+    boost::asio::steady_timer tick_timer_;
+    boost::asio::steady_timer restart_timer_;
+    boost::asio::steady_timer disconnect_timer_;
+    std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point last_tick_;
+
+    // Klipper 状态
+    std::string klippy_state_ = "ready";
+    std::string state_message_ = "Printer is ready";
+    std::map<std::string, double> pins_;
+    std::string load_cell_object_ = "load_cell my_hx711";   // 以客户端实际订阅/查询的名字为准
+
+    // 运动: G1 依次执行; MANUAL_STEPPER SYNC=0 每个泵独立
+    bool absolute_ = true;
+    double feedrate_mm_min_ = 600.0;
+    std::array<double, PUMP_COUNT> axis_position_{};
+    std::deque<Move> motion_queue_;
+    std::array<double, PUMP_COUNT> manual_position_{};
+    std::array<Move, PUMP_COUNT> manual_moves_{};
+
+    // ENOSE_DISPENSE (Klipper 插件) 的模拟
+    struct Dispense {
+        bool active = false;
+        int id = 0;
+        int pump = -1;
+        double target_g = 0.0;
+        double coarse_speed = 20.0;
+        double fine_speed = 2.0;
+        double slowdown_g = 5.0;
+        double start_g = 0.0;
+        double dispensed_g = 0.0;
+        double remaining_s = 0.0;       // 超时前剩余时间
+        double speed = 0.0;
+        std::string state = "idle";
+        std::string message;
+    };
+    Dispense dispense_;
+
+    // 流体与称重
+    double sample_g_ = 0.0;
+    double water_g_ = 0.0;
+    double tare_g_ = 0.0;
+    double force_g_ = 0.0;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> gcode_lines_{0};
+    std::atomic<uint64_t> dropped_responses_{0};
+    std::atomic<uint64_t> disconnects_{0};
+};
+
+} // namespace sim
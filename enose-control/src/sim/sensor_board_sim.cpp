@@ -0,0 +1,558 @@
+#include "sim/sensor_board_sim.hpp"
+#include "hal/sensor_frame.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace sim {
+
+namespace {
+
+constexpr const char* FIRMWARE_VERSION = "2.1.0-sim";
+constexpr uint8_t DATA_BATCH_MAX = 8;               // 固件 config.h
+constexpr std::size_t MAX_COMMAND_LENGTH = 1024;    // 固件 CmdHandler 的行缓冲上限
+constexpr auto RESET_DELAY = std::chrono::milliseconds(100);
+constexpr auto REPLUG_DELAY = std::chrono::milliseconds(500);
+
+// 加热温度对 MOX 电阻的影响 (温度越高电阻越低), 只需形状合理
+double heater_factor(uint16_t temp_c) {
+    return std::exp(-(static_cast<double>(temp_c) - 200.0) / 120.0);
+}
+
+} // namespace
+
+SensorBoardSim::SensorBoardSim(boost::asio::io_context& io, const core::SimSensorBoardConfig& config, uint32_t seed)
+    : io_(io)
+    , config_(config)
+    , faults_(config.faults, seed)
+    , master_(io)
+    , out_(io, [this](std::string data) {
+          if (!running_link_) return;
+          if (write_queue_.size() >= MAX_PENDING_WRITES) write_queue_.pop_front();
+          write_queue_.push_back(std::move(data));
+          write_next();
+      })
+    , step_timer_(io)
+    , disconnect_timer_(io)
+    , reset_timer_(io) {
+    config_.sensors = std::clamp(config_.sensors, 1, static_cast<int>(MAX_SENSORS));
+    config_.heater_time_base_ms = std::max(config_.heater_time_base_ms, 1);
+    for (uint8_t i = 0; i < MAX_SENSORS; ++i) {
+        sensor_ids_[i] = 0x5E110000u + i;
+        r0_[i] = 40e3 * (1.0 + 0.35 * i);
+        sensitivity_[i] = 0.4 + 0.2 * ((i * 5) % MAX_SENSORS) / MAX_SENSORS;
+    }
+    batch_.reserve(DATA_BATCH_MAX);
+}
+
+SensorBoardSim::~SensorBoardSim() {
+    stop();
+}
+
+void SensorBoardSim::start() {
+    boot_ = exposure_updated_ = std::chrono::steady_clock::now();
+    open_pty();
+    spdlog::info("SensorBoardSim: {} sensors on {}", config_.sensors, config_.link);
+    send_ready();
+
+    if (config_.autostart) {
+        running_ = true;
+        active_mask_ = (1u << config_.sensors) - 1;
+        step_ = 0;
+        step_timer_.expires_after(std::chrono::milliseconds(durs_[step_] * config_.heater_time_base_ms));
+        schedule_step();
+    }
+    schedule_disconnect();
+}
+
+void SensorBoardSim::stop() {
+    running_ = false;
+    step_timer_.cancel();
+    disconnect_timer_.cancel();
+    reset_timer_.cancel();
+    if (running_link_ || slave_fd_ >= 0) {
+        close_pty();
+        std::error_code ec;
+        if (std::filesystem::is_symlink(config_.link, ec)) {
+            std::filesystem::remove(config_.link, ec);
+        }
+    }
+}
+
+void SensorBoardSim::set_exposure(double target) {
+    // 先按旧目标积分到当前时刻, 再切换目标
+    const auto now = std::chrono::steady_clock::now();
+    const double dt = std::chrono::duration<double>(now - exposure_updated_).count();
+    const double tau = std::max(config_.response_tau_sec, 1e-3);
+    exposure_ += (exposure_target_ - exposure_) * (1.0 - std::exp(-dt / tau));
+    exposure_updated_ = now;
+    exposure_target_ = std::clamp(target, 0.0, 1.0);
+}
+
+SensorBoardSim::Stats SensorBoardSim::stats() const {
+    Stats s;
+    s.readings = readings_;
+    s.dropped = dropped_;
+    s.corrupted = corrupted_;
+    s.replayed = replayed_;
+    s.commands = commands_;
+    s.disconnects = disconnects_;
+    return s;
+}
+
+void SensorBoardSim::open_pty() {
+    int fd = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || ::grantpt(fd) != 0 || ::unlockpt(fd) != 0) {
+        if (fd >= 0) ::close(fd);
+        throw std::runtime_error(std::string("posix_openpt: ") + std::strerror(errno));
+    }
+    char name[128];
+    if (::ptsname_r(fd, name, sizeof(name)) != 0) {
+        ::close(fd);
+        throw std::runtime_error(std::string("ptsname: ") + std::strerror(errno));
+    }
+
+    slave_fd_ = ::open(name, O_RDWR | O_NOCTTY);
+    if (slave_fd_ < 0) {
+        ::close(fd);
+        throw std::runtime_error(std::string("open ") + name + ": " + std::strerror(errno));
+    }
+    termios tio{};
+    if (::tcgetattr(slave_fd_, &tio) == 0) {
+        ::cfmakeraw(&tio);
+        ::tcsetattr(slave_fd_, TCSANOW, &tio);
+    }
+
+    // 只替换符号链接, 不覆盖同名的普通文件或真实设备
+    std::error_code ec;
+    const auto status = std::filesystem::symlink_status(config_.link, ec);
+    if (std::filesystem::exists(status) && !std::filesystem::is_symlink(status)) {
+        ::close(fd);
+        ::close(slave_fd_);
+        slave_fd_ = -1;
+        throw std::runtime_error(config_.link + " exists and is not a symlink");
+    }
+    std::filesystem::remove(config_.link, ec);
+    std::filesystem::create_symlink(name, config_.link, ec);
+    if (ec) {
+        ::close(fd);
+        ::close(slave_fd_);
+        slave_fd_ = -1;
+        throw std::runtime_error("symlink " + config_.link + ": " + ec.message());
+    }
+
+    master_.assign(fd);
+    ++link_gen_;
+    line_.clear();
+    running_link_ = true;
+    spdlog::debug("SensorBoardSim: pty {} -> {}", config_.link, name);
+    do_read();
+}
+
+void SensorBoardSim::close_pty() {
+    running_link_ = false;
+    out_.clear();
+    write_queue_.clear();
+    writing_ = false;
+    boost::system::error_code ignored;
+    master_.close(ignored);
+    if (slave_fd_ >= 0) {
+        ::close(slave_fd_);
+        slave_fd_ = -1;
+    }
+}
+
+void SensorBoardSim::do_read() {
+    master_.async_read_some(boost::asio::buffer(read_buf_),
+        [this, gen = link_gen_](boost::system::error_code ec, std::size_t n) {
+            if (gen != link_gen_) return;
+            if (ec) {
+                if (ec != boost::asio::error::operation_aborted) {
+                    spdlog::warn("SensorBoardSim: pty read failed: {}", ec.message());
+                }
+                return;
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                const char c = read_buf_[i];
+                // 行首的 CMD_FRAME_LEAD 开始一个二进制命令帧, 直到 0x00
+                if (!cmd_frame_.empty() ||
+                    (line_.empty() && static_cast<uint8_t>(c) == hal::sensor_frame::CMD_FRAME_LEAD)) {
+                    if (c == '\0') {
+                        handle_command_frame(cmd_frame_);
+                        cmd_frame_.clear();
+                    } else if (cmd_frame_.size() < hal::sensor_frame::MAX_ENCODED_FRAME) {
+                        cmd_frame_.push_back(static_cast<uint8_t>(c));
+                    } else {
+                        cmd_frame_.clear();
+                        send_json({{"type", "error"}, {"id", 0}, {"code", -13}, {"msg", "FRAME_ERROR"}});
+                    }
+                    continue;
+                }
+                if (c == '\n') {
+                    if (!line_.empty()) handle_line(line_);
+                    line_.clear();
+                } else if (c != '\r') {
+                    line_.push_back(c);
+                    if (line_.size() > MAX_COMMAND_LENGTH) {
+                        line_.clear();
+                        send_json({{"type", "error"}, {"id", 0}, {"code", -2}, {"msg", "BUFFER_OVERFLOW"}});
+                    }
+                }
+            }
+            if (running_link_) do_read();
+        });
+}
+
+void SensorBoardSim::handle_line(const std::string& line) {
+    auto cmd = nlohmann::json::parse(line, nullptr, false);
+    if (cmd.is_discarded() || !cmd.is_object()) {
+        send_json({{"type", "error"}, {"id", 0}, {"code", -1}, {"msg", "JSON_PARSE_ERROR"}});
+        return;
+    }
+    ++commands_;
+    handle_command(cmd);
+}
+
+void SensorBoardSim::handle_command_frame(const std::vector<uint8_t>& encoded) {
+    namespace frame = hal::sensor_frame;
+    uint8_t raw[frame::MAX_ENCODED_FRAME];
+    auto decoded = frame::cobs_decode(encoded.data(), encoded.size(), raw);
+    if (!decoded || *decoded < 3 ||
+        frame::crc16(raw, *decoded - 2) != static_cast<uint16_t>(raw[*decoded - 2] | (raw[*decoded - 1] << 8))) {
+        send_json({{"type", "error"}, {"id", 0}, {"code", -13}, {"msg", "FRAME_ERROR"}});
+        return;
+    }
+    const std::size_t payload_len = *decoded - 3;
+    if (raw[0] != frame::FRAME_TYPE_CMD_HEATER) {
+        send_json({{"type", "error"}, {"id", 0}, {"code", -4}, {"msg", "UNKNOWN_CMD"}});
+        return;
+    }
+    frame::HeaterConfigCmdWire w;
+    if (payload_len != sizeof(w)) {
+        send_json({{"type", "error"}, {"id", 0}, {"code", -13}, {"msg", "FRAME_ERROR"}});
+        return;
+    }
+    std::memcpy(&w, raw + 1, sizeof(w));
+    
+    // 与 JSON config 等价; 模拟板所有传感器共用一套曲线, sensor_mask 不区分
+    const std::size_t length = std::min<std::size_t>(w.length, frame::HEATER_PROFILE_MAX);
+    nlohmann::json temps = nlohmann::json::array();
+    nlohmann::json durs = nlohmann::json::array();
+    for (std::size_t i = 0; i < length; ++i) {
+        temps.push_back(w.temps[i]);
+        durs.push_back(w.durs[i]);
+    }
+    ++commands_;
+    handle_command({{"cmd", "config"}, {"id", w.id},
+                    {"params", {{"temps", temps}, {"durs", durs}, {"apply", (w.flags & 1) ? "now" : "cycle"}}}});
+}
+
+void SensorBoardSim::handle_command(const nlohmann::json& doc) {
+    const int id = doc.value("id", 0);
+    const auto& params = doc.contains("params") && doc["params"].is_object() ? doc["params"] : nlohmann::json::object();
+    auto ack = [&](nlohmann::json extra = nlohmann::json::object()) {
+        nlohmann::json resp = {{"type", "ack"}, {"id", id}, {"ok", true}};
+        resp.update(extra);
+        send_json(resp);
+    };
+    auto error = [&](int code, const char* msg) {
+        send_json({{"type", "error"}, {"id", id}, {"code", code}, {"msg", msg}});
+    };
+
+    if (!doc.contains("cmd") || !doc["cmd"].is_string()) {
+        error(-3, "MISSING_CMD");
+        return;
+    }
+    const std::string cmd = doc["cmd"].get<std::string>();
+
+    if (cmd == "sync") {
+        if (params.contains("format")) {
+            const std::string format = params.value("format", std::string());
+            if (format != "bin" && format != "json") {
+                error(-11, "UNKNOWN_FORMAT");
+                return;
+            }
+            flush_batch();
+            format_ = format == "bin" ? Format::BINARY : Format::JSON;
+        }
+        if (params.contains("batch") && params["batch"].is_number()) {
+            flush_batch();
+            batch_size_ = static_cast<uint8_t>(std::clamp(params["batch"].get<int>(), 0, static_cast<int>(DATA_BATCH_MAX)));
+        }
+        nlohmann::json extra = {{"tick_ms", now_tick()}, {"dev_us", now_us()},
+                                {"format", format_ == Format::BINARY ? "bin" : "json"},
+                                {"batch", batch_size_}, {"frame_ver", hal::sensor_frame::FRAME_VERSION}};
+        if (params.contains("t")) {
+            extra["t"] = params["t"];
+        }
+        ack(extra);
+    } else if (cmd == "init") {
+        ack({{"sensors", config_.sensors}});
+    } else if (cmd == "config") {
+        const auto temps = params.value("temps", nlohmann::json::array());
+        const auto durs = params.value("durs", nlohmann::json::array());
+        const std::string apply = params.value("apply", std::string("cycle"));
+        if (temps.empty() || temps.size() > PROFILE_LENGTH || durs.size() != temps.size() ||
+            (apply != "cycle" && apply != "now")) {
+            error(-6, "CONFIG_FAILED");
+            return;
+        }
+        // 模拟板所有传感器共用一套加热配置
+        for (std::size_t i = 0; i < temps.size(); ++i) {
+            pending_temps_[i] = temps[i].get<uint16_t>();
+            pending_durs_[i] = std::max<uint16_t>(durs[i].get<uint16_t>(), 1);
+        }
+        pending_length_ = static_cast<uint8_t>(temps.size());
+        if (!running_ || apply == "now") {
+            apply_pending_profile();
+            step_ = 0;
+        }
+        ack();
+    } else if (cmd == "start") {
+        if (running_) {
+            error(-6, "ALREADY_RUNNING");
+            return;
+        }
+        active_mask_ = 0;
+        if (params.contains("sensors") && params["sensors"].is_array()) {
+            for (const auto& v : params["sensors"]) {
+                const int idx = v.get<int>();
+                if (idx >= 0 && idx < config_.sensors) active_mask_ |= 1u << idx;
+            }
+        } else {
+            active_mask_ = (1u << config_.sensors) - 1;
+        }
+        running_ = true;
+        step_ = 0;
+        step_timer_.expires_after(std::chrono::milliseconds(durs_[step_] * config_.heater_time_base_ms));
+        schedule_step();
+        ack();
+    } else if (cmd == "stop") {
+        running_ = false;
+        step_timer_.cancel();
+        flush_batch();
+        active_mask_ = 0;
+        ack();
+    } else if (cmd == "status") {
+        nlohmann::json sensors = nlohmann::json::array();
+        for (int i = 0; i < config_.sensors; ++i) {
+            sensors.push_back({{"idx", i}, {"id", sensor_ids_[i]}, {"ok", true}});
+        }
+        send_json({{"type", "status"}, {"id", id}, {"tick_ms", now_tick()}, {"running", running_},
+                   {"sensors", sensors}, {"dropped", dropped_.load()}, {"history", history_.size()},
+                   {"simulated", true}});
+    } else if (cmd == "reset") {
+        ack();
+        // 固件 ESP.restart(): 格式、批量、序号与历史全部丢失
+        reset_timer_.expires_after(RESET_DELAY);
+        reset_timer_.async_wait([this](boost::system::error_code ec) {
+            if (ec) return;
+            running_ = false;
+            step_timer_.cancel();
+            batch_.clear();
+            format_ = Format::JSON;
+            batch_size_ = 0;
+            seq_ = 0;
+            history_.clear();
+            boot_ = std::chrono::steady_clock::now();
+            send_ready();
+        });
+    } else if (cmd == "replay") {
+        const uint32_t from_seq = params.value("from_seq", 1u);
+        const uint32_t to_seq = params.value("to_seq", 0u);
+        uint32_t first = 0, last = 0;
+        if (!history_.empty()) {
+            const uint32_t oldest = history_.front().seq;
+            first = std::max(from_seq, oldest);
+            last = history_.back().seq;
+            if (to_seq != 0 && to_seq < last) last = to_seq;
+        }
+        if (history_.empty() || first > last) {
+            first = last + 1;
+        }
+        ack({{"from_seq", first}, {"to_seq", last}});
+        // 补发的读数随后以普通 data 消息 / 单条帧发出
+        if (first <= last) {
+            const uint32_t oldest = history_.front().seq;
+            for (uint32_t seq = first; seq <= last; ++seq) {
+                report(history_[seq - oldest], false);
+                ++replayed_;
+            }
+        }
+    } else {
+        error(-4, "UNKNOWN_CMD");
+    }
+}
+
+void SensorBoardSim::schedule_step() {
+    step_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec || !running_) return;
+        on_step();
+        // 按上一次到期时间累加, 不随处理耗时漂移
+        step_timer_.expires_at(step_timer_.expiry() +
+                               std::chrono::milliseconds(durs_[step_] * config_.heater_time_base_ms));
+        schedule_step();
+    });
+}
+
+void SensorBoardSim::on_step() {
+    set_exposure(exposure_target_);
+    const double factor = heater_factor(temps_[step_]);
+    const uint32_t tick = now_tick();
+
+    for (uint8_t i = 0; i < config_.sensors; ++i) {
+        if (!(active_mask_ & (1u << i))) continue;
+        hal::SensorSample sample;
+        sample.seq = ++seq_;
+        sample.tick_ms = tick;
+        sample.sensor_idx = i;
+        sample.sensor_id = sensor_ids_[i];
+        sample.type = hal::SensorType::MOX_DIGITAL;
+        sample.heater_step = step_;
+        const double response = 1.0 + config_.odor_response * sensitivity_[i] * exposure_;
+        sample.value = static_cast<float>(r0_[i] * factor / response * (1.0 + faults_.gaussian(config_.noise)));
+        sample.temperature = static_cast<float>(27.5 + faults_.gaussian(0.05));
+        sample.humidity = static_cast<float>(41.0 + 3.0 * exposure_ + faults_.gaussian(0.2));
+        sample.pressure = static_cast<float>(1008.2 + faults_.gaussian(0.02));
+
+        history_.push_back(sample);
+        if (history_.size() > HISTORY_CAPACITY) history_.pop_front();
+        ++readings_;
+        report(sample, true);
+    }
+    flush_batch();
+    step_ = static_cast<uint8_t>((step_ + 1) % profile_length_);
+    if (step_ == 0) apply_pending_profile();
+}
+
+void SensorBoardSim::apply_pending_profile() {
+    if (pending_length_ == 0) return;
+    temps_ = pending_temps_;
+    durs_ = pending_durs_;
+    profile_length_ = pending_length_;
+    pending_length_ = 0;
+}
+
+void SensorBoardSim::report(const hal::SensorSample& sample, bool live) {
+    // 丢弃的实时读数已进入历史, 主机看到跳号后可以 replay 取回
+    if (live && faults_.drop()) {
+        ++dropped_;
+        return;
+    }
+
+    if (format_ == Format::JSON) {
+        std::string line = fmt::format(
+            R"({{"type":"data","seq":{},"tick":{},"s":{},"id":{},"v":{:.1f},"st":"mox_d","gi":{},"T":{:.2f},"H":{:.2f},"P":{:.2f}}})",
+            sample.seq, sample.tick_ms, sample.sensor_idx, sample.sensor_id, sample.value, sample.heater_step,
+            sample.temperature, sample.humidity, sample.pressure);
+        line.push_back('\n');
+        send_raw(std::move(line), true);
+        return;
+    }
+
+    // 与 DataReporter 相同: 补发走单条帧; 批量模式下遇到加热步切换 / 跳号 / tick 溢出先发出当前批次
+    if (!live || batch_size_ <= 1) {
+        send_raw(encode(&sample, 1, false), true);
+        return;
+    }
+    if (!batch_.empty()) {
+        const auto& first = batch_.front();
+        const auto& last = batch_.back();
+        if (sample.heater_step != last.heater_step || sample.seq != last.seq + 1 ||
+            sample.tick_ms - first.tick_ms > 0xFFFF) {
+            flush_batch();
+        }
+    }
+    batch_.push_back(sample);
+    if (batch_.size() >= batch_size_) {
+        flush_batch();
+    }
+}
+
+void SensorBoardSim::flush_batch() {
+    if (batch_.empty()) return;
+    send_raw(encode(batch_.data(), batch_.size(), true), true);
+    batch_.clear();
+}
+
+std::string SensorBoardSim::encode(const hal::SensorSample* samples, std::size_t count, bool batch) const {
+    return hal::sensor_frame::encode_frame(samples, count, batch);
+}
+
+void SensorBoardSim::send_json(const nlohmann::json& j) {
+    send_raw(j.dump() + "\n", true);
+}
+
+void SensorBoardSim::send_raw(std::string data, bool faults) {
+    if (!running_link_) return;
+    if (faults && faults_.corrupt(data)) {
+        ++corrupted_;
+    }
+    out_.push(std::move(data), faults ? faults_.delay() : std::chrono::microseconds(0));
+}
+
+void SensorBoardSim::write_next() {
+    if (writing_ || write_queue_.empty() || !running_link_) return;
+    writing_ = true;
+    boost::asio::async_write(master_, boost::asio::buffer(write_queue_.front()),
+        [this, gen = link_gen_](boost::system::error_code ec, std::size_t) {
+            if (gen != link_gen_) return;
+            writing_ = false;
+            if (ec) {
+                if (ec != boost::asio::error::operation_aborted) {
+                    spdlog::warn("SensorBoardSim: pty write failed: {}", ec.message());
+                }
+                return;
+            }
+            if (!write_queue_.empty()) write_queue_.pop_front();
+            write_next();
+        });
+}
+
+void SensorBoardSim::send_ready() {
+    send_json({{"type", "ready"}, {"version", FIRMWARE_VERSION}, {"sensors", config_.sensors}});
+}
+
+void SensorBoardSim::schedule_disconnect() {
+    if (config_.faults.disconnect_interval_sec <= 0) return;
+    disconnect_timer_.expires_after(std::chrono::milliseconds(
+        static_cast<int64_t>(config_.faults.disconnect_interval_sec * 1000.0)));
+    disconnect_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        // 模拟 USB 线缆松动: 板子继续采集, 断开期间的读数只进历史
+        ++disconnects_;
+        spdlog::warn("SensorBoardSim: Injected disconnect");
+        close_pty();
+        disconnect_timer_.expires_after(REPLUG_DELAY);
+        disconnect_timer_.async_wait([this](boost::system::error_code ec) {
+            if (ec) return;
+            try {
+                open_pty();
+            } catch (const std::exception& e) {
+                spdlog::error("SensorBoardSim: Failed to recreate pty: {}", e.what());
+                return;
+            }
+            schedule_disconnect();
+        });
+    });
+}
+
+uint64_t SensorBoardSim::now_us() const {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - boot_).count();
+    return static_cast<uint64_t>(static_cast<double>(elapsed) * (1.0 + config_.clock_skew_ppm * 1e-6));
+}
+
+uint32_t SensorBoardSim::now_tick() const {
+    return static_cast<uint32_t>(now_us() / 1000);
+}
+
+} // namespace sim
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "core/config.hpp"
+#include "hal/sensor_sample.hpp"
+#include "sim/fault_injector.hpp"
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+/**
+ * @brief pty 上的模拟 BME688 传感器板
+ *
+ * 打开一对伪终端, 在 SimSensorBoardConfig::link 处建立指向从端的符号链接, 主机侧
+ * SensorDriver 像打开真实串口一样打开它. 协议与固件 CmdHandler / DataReporter 一致:
+ * sync (含 bin 格式与批量协商) / init / config / start / stop / status / reset / replay,
+ * 以及 frame_ver 3 的二进制加热曲线命令帧; 数据以 "data" 行或 COBS 二进制帧上报,
+ * 并保留历史供 replay 补发.
+ *
+ * 电阻模型: R = R0(sensor) · f(加热温度) / (1 + k · c), c 为气室浓度, 以一阶惯性
+ * 跟随 set_exposure() 给出的目标值 (由 Simulator 按模拟阀门/气泵状态设置).
+ *
+ * 所有方法在模拟器 io 线程调用
+ */
+class SensorBoardSim {
+public:
+    static constexpr uint8_t MAX_SENSORS = 8;
+    static constexpr uint8_t PROFILE_LENGTH = 10;                 // 加热曲线容量 (BME688 并行模式)
+    static constexpr std::size_t HISTORY_CAPACITY = 2048;   // 与无 PSRAM 的固件相同
+    static constexpr std::size_t MAX_PENDING_WRITES = 4096; // 主机不读时, 超出丢弃最旧 (固件 FIFO 溢出)
+
+    struct Stats {
+        uint64_t readings = 0;          // 生成的读数
+        uint64_t dropped = 0;           // 故障注入丢弃 (仍可 replay)
+        uint64_t corrupted = 0;
+        uint64_t replayed = 0;
+        uint64_t commands = 0;
+        uint64_t disconnects = 0;
+    };
+
+    SensorBoardSim(boost::asio::io_context& io, const core::SimSensorBoardConfig& config, uint32_t seed);
+    ~SensorBoardSim();
+
+    /** @brief 创建 pty 与符号链接并开始处理命令; 失败时抛出 std::runtime_error */
+    void start();
+    void stop();
+
+    /** @brief 主机应打开的设备路径 (符号链接) */
+    const std::string& device() const { return config_.link; }
+
+    /** @brief 气室目标浓度, 0 = 洁净空气, 1 = 满浓度样品顶空气 */
+    void set_exposure(double target);
+
+    Stats stats() const;
+
+private:
+    enum class Format { JSON, BINARY };
+
+    void open_pty();
+    void close_pty();
+    void do_read();
+    void handle_line(const std::string& line);
+    void handle_command_frame(const std::vector<uint8_t>& encoded);
+    void handle_command(const nlohmann::json& cmd);
+    void schedule_step();
+    void on_step();
+    void apply_pending_profile();
+    void schedule_disconnect();
+
+    void send_json(const nlohmann::json& j);
+    void send_raw(std::string data, bool faults);
+    void report(const hal::SensorSample& sample, bool live);
+    void flush_batch();
+    std::string encode(const hal::SensorSample* samples, std::size_t count, bool batch) const;
+    void write_next();
+    void send_ready();
+
+    uint64_t now_us() const;            // 模拟板的 64 位设备时钟 (含 clock_skew_ppm)
+    uint32_t now_tick() const;
+
+    boost::asio::io_context& io_;
+    core::SimSensorBoardConfig config_;
+    FaultInjector faults_;
+    boost::asio::posix::stream_descriptor master_;
+    int slave_fd_ = -1;                 // 保持从端打开: 主机关闭串口时主端读不会 EIO
+    std::array<char, 512> read_buf_{};
+    std::string line_;
+    std::vector<uint8_t> cmd_frame_;    // 正在接收的二进制命令帧 (以 CMD_FRAME_LEAD 开头, 0x00 结束)
+    DelayLine out_;
+    std::deque<std::string> write_queue_;
+    bool writing_ = false;
+    bool running_link_ = false;
+    uint64_t link_gen_ = 0;             // 每次重建 pty 递增, 区分旧连接遗留的回调
+
+    boost::asio::steady_timer step_timer_;
+    boost::asio::steady_timer disconnect_timer_;
+    boost::asio::steady_timer reset_timer_;
+    std::chrono::steady_clock::time_point boot_;
+
+    // 固件状态
+    bool running_ = false;
+    Format format_ = Format::JSON;
+    uint8_t batch_size_ = 0;
+    uint32_t active_mask_ = 0;
+    std::array<uint16_t, PROFILE_LENGTH> temps_{320, 100, 100, 100, 200, 200, 200, 320, 320, 320};
+    std::array<uint16_t, PROFILE_LENGTH> durs_{5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
+    uint8_t profile_length_ = PROFILE_LENGTH;
+    // 与固件相同的双缓冲: 采集中收到的配置在周期回到第 0 步时生效
+    std::array<uint16_t, PROFILE_LENGTH> pending_temps_{};
+    std::array<uint16_t, PROFILE_LENGTH> pending_durs_{};
+    uint8_t pending_length_ = 0;        // 0 = 无暂存配置
+    uint8_t step_ = 0;
+    uint32_t seq_ = 0;
+    std::array<uint32_t, MAX_SENSORS> sensor_ids_{};
+    std::array<double, MAX_SENSORS> r0_{};
+    std::array<double, MAX_SENSORS> sensitivity_{};
+    std::deque<hal::SensorSample> history_;
+    std::vector<hal::SensorSample> batch_;
+
+    // 气室浓度
+    double exposure_target_ = 0.0;
+    double exposure_ = 0.0;
+    std::chrono::steady_clock::time_point exposure_updated_;
+
+    std::atomic<uint64_t> readings_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> corrupted_{0};
+    std::atomic<uint64_t> replayed_{0};
+    std::atomic<uint64_t> commands_{0};
+    std::atomic<uint64_t> disconnects_{0};
+};
+
+} // namespace sim
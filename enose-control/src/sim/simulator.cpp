@@ -0,0 +1,94 @@
+#include "sim/simulator.hpp"
+#include <spdlog/spdlog.h>
+#include <future>
+
+namespace sim {
+
+namespace {
+
+constexpr double MIN_LIQUID_G = 0.5;    // 瓶中液体少于此值时没有顶空气
+
+} // namespace
+
+Simulator::Simulator(const core::SimulatorConfig& config)
+    : config_(config) {}
+
+Simulator::~Simulator() {
+    stop();
+}
+
+void Simulator::start() {
+    if (thread_.joinable()) return;
+
+    // 两条链路用不同的随机流, 同一 seed 下整次运行可复现
+    const uint32_t seed = config_.seed;
+    sensor_board_ = std::make_unique<SensorBoardSim>(io_, config_.sensor_board, seed);
+    moonraker_ = std::make_unique<MoonrakerSim>(io_, config_.moonraker, seed != 0 ? seed + 1 : 0);
+
+    fluid_connection_ = moonraker_->on_fluid_state.connect([this](const FluidState& fluid) {
+        const double total = fluid.sample_g + fluid.water_g;
+        const bool sampling = fluid.air_pump > 0 && fluid.chamber_open && total > MIN_LIQUID_G;
+        sensor_board_->set_exposure(sampling ? fluid.sample_g / total : 0.0);
+    });
+
+    // io 线程尚未运行, 在调用线程上同步完成 pty / 端口绑定, 失败直接抛给调用方
+    moonraker_->start();
+    try {
+        sensor_board_->start();
+    } catch (...) {
+        moonraker_->stop();
+        throw;
+    }
+
+    io_.restart();
+    work_.emplace(io_.get_executor());
+    thread_ = std::thread([this] {
+        try {
+            io_.run();
+        } catch (const std::exception& e) {
+            spdlog::error("Simulator: io thread terminated: {}", e.what());
+        }
+    });
+    spdlog::warn("Simulator: Running without hardware (sensor={}, moonraker={}:{})",
+                 sensor_device(), moonraker_host(), moonraker_port());
+}
+
+void Simulator::stop() {
+    if (!thread_.joinable()) {
+        if (sensor_board_) sensor_board_->stop();
+        if (moonraker_) moonraker_->stop();
+        return;
+    }
+    // 关闭 pty / 连接必须在模拟线程上进行
+    std::promise<void> stopped;
+    boost::asio::post(io_, [this, &stopped] {
+        sensor_board_->stop();
+        moonraker_->stop();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    work_.reset();
+    io_.stop();
+    thread_.join();
+}
+
+std::string Simulator::sensor_device() const {
+    return config_.sensor_board.link;
+}
+
+std::string Simulator::moonraker_host() const {
+    return config_.moonraker.host;
+}
+
+std::string Simulator::moonraker_port() const {
+    return std::to_string(moonraker_ ? moonraker_->port() : config_.moonraker.port);
+}
+
+Simulator::Stats Simulator::stats() const {
+    Stats s;
+    if (sensor_board_) s.sensor_board = sensor_board_->stats();
+    if (moonraker_) s.moonraker = moonraker_->stats();
+    return s;
+}
+
+} // namespace sim
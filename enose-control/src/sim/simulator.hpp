@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/config.hpp"
+#include "sim/moonraker_sim.hpp"
+#include "sim/sensor_board_sim.hpp"
+#include <boost/asio.hpp>
+#include <boost/signals2.hpp>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace sim {
+
+/**
+ * @brief 硬件在环模拟器: 模拟传感器板 + 模拟 Moonraker/Klipper/称重
+ *
+ * 在独立线程和 io_context 上运行, 对控制服务而言与真实硬件一样是外部进程:
+ * SensorDriver 打开 sensor_device(), ActuatorDriver 连接 moonraker_host():moonraker_port().
+ * 两者之间通过流体模型耦合: 采样状态 (气泵运行且三通阀指向气室) 下,
+ * 气室目标浓度 = 样品瓶中样品液所占比例, 清洗进水会稀释, 排废会清空.
+ */
+class Simulator {
+public:
+    struct Stats {
+        SensorBoardSim::Stats sensor_board;
+        MoonrakerSim::Stats moonraker;
+    };
+
+    explicit Simulator(const core::SimulatorConfig& config);
+    ~Simulator();
+
+    Simulator(const Simulator&) = delete;
+    Simulator& operator=(const Simulator&) = delete;
+
+    /** @brief 建立 pty 与监听端口并启动模拟线程; 失败时抛出异常 */
+    void start();
+    void stop();
+
+    std::string sensor_device() const;
+    std::string moonraker_host() const;
+    std::string moonraker_port() const;
+
+    Stats stats() const;
+
+private:
+    core::SimulatorConfig config_;
+    boost::asio::io_context io_;
+    std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_;
+    std::thread thread_;
+    std::unique_ptr<SensorBoardSim> sensor_board_;
+    std::unique_ptr<MoonrakerSim> moonraker_;
+    boost::signals2::scoped_connection fluid_connection_;
+};
+
+} // namespace sim
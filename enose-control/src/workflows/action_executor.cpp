@@ -1,5 +1,8 @@
 #include "workflows/action_executor.hpp"
+#include "hal/stability_detector.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
 
 namespace workflows {
 
@@ -8,16 +11,135 @@ namespace workflows {
 void ActionExecutorBase::add_log(const std::string& message) {
     if (log_callback_) {
         log_callback_(message);
-    } else {
-        spdlog::info("[{}] {}", name(), message);
+        return;
     }
+    // 日志环无锁, 等待循环中调用不会与状态查询争用
+    if (log_ring_) {
+        log_ring_->push(message);
+    }
+    spdlog::info("[{}] {}", name(), message);
 }
 
 bool ActionExecutorBase::check_stop_or_pause() {
-    if (stop_check_callback_) {
-        return stop_check_callback_();
+    return token_->check_stop_or_pause();
+}
+
+std::optional<hal::LoadCellDriver::WaitForEmptyResult> wait_for_empty_bottle(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::LoadCellDriver& load_cell,
+    float tolerance, float timeout_sec, float stability_window_sec)
+{
+    // 回调在 io 线程上执行, 可能晚于本函数返回 (停止后取消), 状态须共享持有
+    struct Pending {
+        std::mutex mutex;
+        std::optional<hal::LoadCellDriver::WaitForEmptyResult> result;
+    };
+    auto pending = std::make_shared<Pending>();
+    
+    uint64_t wait_id = load_cell.async_wait_for_empty_bottle(
+        tolerance, timeout_sec, stability_window_sec,
+        [pending, token](const hal::LoadCellDriver::WaitForEmptyResult& result) {
+            {
+                std::lock_guard<std::mutex> lock(pending->mutex);
+                pending->result = result;
+            }
+            token->notify();
+        });
+    
+    // 称重侧自带超时, 这里只等结果或停止
+    auto status = token->wait_for(std::chrono::hours(24), [&pending] {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        return pending->result.has_value();
+    });
+    
+    if (status != WaitStatus::READY) {
+        load_cell.cancel_wait_for_empty(wait_id);
+        return std::nullopt;
+    }
+    std::lock_guard<std::mutex> lock(pending->mutex);
+    return pending->result;
+}
+
+WaitStatus wait_for_heater_cycles(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::SensorDriver& sensor,
+    int count, double timeout_s)
+{
+    auto& tracker = sensor.heater_cycles();
+    
+    // 每个传感器的目标: 已开始的周期之后再完成 count 个
+    std::array<uint64_t, hal::HeaterCycleTracker::MAX_SENSORS> target{};
+    for (std::size_t i = 0; i < target.size(); ++i) {
+        target[i] = tracker.cycles_started(static_cast<uint8_t>(i)) + static_cast<uint64_t>(count);
     }
-    return false;
+    
+    return WaitSet(token)
+        .notify_on(tracker.on_cycle_complete)
+        .wait_for(std::chrono::duration<double>(timeout_s), [&] {
+            uint64_t active = tracker.active_sensors();
+            if (active == 0) return false;
+            for (std::size_t i = 0; i < target.size(); ++i) {
+                if ((active >> i) & 1) {
+                    if (tracker.cycles(static_cast<uint8_t>(i)) < target[i]) return false;
+                }
+            }
+            return true;
+        });
+}
+
+WaitStatus wait_for_baseline_recovery(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::BaselineRecoveryMonitor& monitor,
+    float tolerance, std::size_t frames, double timeout_s,
+    hal::BaselineRecoveryMonitor::FrameDeviation* latest)
+{
+    // 排废期间的帧不计入: 只看等待开始之后到达的帧
+    const uint64_t start_seq = monitor.last_seq();
+    return WaitSet(token)
+        .notify_on(monitor.on_update)
+        .wait_for(std::chrono::duration<double>(timeout_s), [&] {
+            return monitor.recovered_since(start_seq, tolerance, frames, latest);
+        });
+}
+
+WashTermination wash_termination(const enose::experiment::WashAction& action, bool baselines_available)
+{
+    WashTermination t;
+    t.min_cycles = std::max(action.repeat_count(), 1);
+    t.max_cycles = t.min_cycles;
+    if (action.mode() != enose::experiment::WASH_MODE_UNTIL_BASELINE) return t;
+    if (!baselines_available) return t;
+    t.until_baseline = true;
+    t.max_cycles = std::max(action.max_cycles() > 0 ? action.max_cycles() : 10, t.min_cycles);
+    if (action.baseline_tolerance() > 0) t.tolerance = static_cast<float>(action.baseline_tolerance());
+    if (action.recovery_frames() > 0) t.frames = static_cast<std::size_t>(action.recovery_frames());
+    if (action.recovery_timeout_s() > 0) t.timeout_s = action.recovery_timeout_s();
+    return t;
+}
+
+WaitStatus wait_for_sensor_stability(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::SensorDriver& sensor,
+    double window_s, double threshold_percent, double timeout_s)
+{
+    // 检测器只在 io 线程上访问, 等待线程只读原子标志
+    auto detector = std::make_shared<hal::StabilityDetector>(
+        static_cast<uint32_t>(window_s * 1000), threshold_percent);
+    auto stable = std::make_shared<std::atomic<bool>>(false);
+    
+    boost::signals2::scoped_connection conn = sensor.on_readings.connect(
+        [detector, stable, token](std::span<const hal::SensorSample> samples) {
+            detector->push(samples);
+            if (detector->stable() && !stable->exchange(true)) {
+                spdlog::debug("传感器稳定: {} 个通道, 最大波动 {:.2f}%",
+                              detector->active_channels(), detector->worst_variation_percent());
+                token->notify();
+            }
+        });
+    
+    return token->wait_for(std::chrono::duration<double>(timeout_s), [&stable] {
+        return stable->load();
+    });
 }
 
 // ActionExecutorFactory 实现
@@ -2,6 +2,11 @@
 
 #include "workflows/hardware_state_machine.hpp"
 #include "workflows/transaction_guard.hpp"
+#include "workflows/cancellation_token.hpp"
+#include "workflows/log_ring.hpp"
+#include "hal/load_cell_driver.hpp"
+#include "hal/sensor_driver.hpp"
+#include "hal/baseline_recovery.hpp"
 #include "enose_experiment.pb.h"
 #include <memory>
 #include <string>
@@ -98,7 +103,10 @@ public:
     virtual bool is_idempotent() const = 0;
     
     /**
-     * @brief 获取资源需求
+     * @brief 获取资源需求 (StepScheduler 的资源名)
+     *
+     * 须包含执行期间写入的全部执行机构. 切换 SystemState 会按目标状态重设所有阀门、
+     * 气泵和清洗泵 PWM 并停止运行中的蠕动泵, 切换状态的步骤因此占用这些资源.
      */
     virtual std::vector<std::string> required_resources() const = 0;
 };
@@ -117,6 +125,20 @@ public:
         , hardware_state_(std::move(hardware_state))
     {}
     
+    /**
+     * @brief 注入共享的停止/暂停令牌 (默认持有独立令牌)
+     */
+    void set_cancellation_token(std::shared_ptr<CancellationToken> token) {
+        token_ = std::move(token);
+    }
+    
+    /**
+     * @brief 执行日志同时写入共享的日志环 (随实验状态返回)
+     */
+    void set_log_ring(std::shared_ptr<LogRing> ring) {
+        log_ring_ = std::move(ring);
+    }
+    
 protected:
     /**
      * @brief 创建事务守卫
@@ -151,21 +173,93 @@ protected:
     void add_log(const std::string& message);
     
     /**
-     * @brief 检查停止/暂停请求
+     * @brief 检查停止/暂停请求 (暂停时阻塞到恢复)
      */
     bool check_stop_or_pause();
     
+    /**
+     * @brief 创建以本执行器令牌为基础的等待集合
+     */
+    WaitSet make_wait_set() { return WaitSet(token_); }
+    
     std::shared_ptr<SystemState> system_state_;
     std::shared_ptr<HardwareStateMachine> hardware_state_;
+    std::shared_ptr<CancellationToken> token_ = std::make_shared<CancellationToken>();
     
-    // 日志和控制回调 (由外部设置)
+    // 日志回调 (由外部设置)
     std::function<void(const std::string&)> log_callback_;
-    std::function<bool()> stop_check_callback_;
+    std::shared_ptr<LogRing> log_ring_;
     
 private:
     static inline std::atomic<uint64_t> execution_counter_{0};
 };
 
+/**
+ * @brief 可被停止打断的空瓶等待
+ *
+ * 基于 LoadCellDriver::async_wait_for_empty_bottle, 结果到达时通过令牌唤醒;
+ * 收到停止请求时取消称重侧的等待.
+ * @return 被停止时返回 std::nullopt
+ */
+std::optional<hal::LoadCellDriver::WaitForEmptyResult> wait_for_empty_bottle(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::LoadCellDriver& load_cell,
+    float tolerance, float timeout_sec, float stability_window_sec);
+
+/**
+ * @brief 等待每个活跃 MOX 传感器再完成 count 个完整加热周期
+ *
+ * 由 SensorDriver::heater_cycles() 的 on_cycle_complete 唤醒, 等待开始时正在进行的
+ * 周期不计入. 返回 READY / TIMEOUT / STOPPED.
+ */
+WaitStatus wait_for_heater_cycles(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::SensorDriver& sensor,
+    int count, double timeout_s);
+
+/**
+ * @brief 等待所有活跃传感器通道稳定
+ *
+ * 在 io 线程上把读数送入 hal::StabilityDetector (按传感器 + 加热步分通道),
+ * 整体稳定时立即唤醒; 返回 READY / TIMEOUT / STOPPED.
+ */
+WaitStatus wait_for_sensor_stability(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::SensorDriver& sensor,
+    double window_s, double threshold_percent, double timeout_s);
+
+/**
+ * @brief 等待传感器读数回到存储的基线
+ *
+ * 等待开始之后连续 frames 帧的最大相对偏离都不超过 tolerance 时返回 READY;
+ * 由 BaselineRecoveryMonitor::on_update (每帧) 唤醒. latest 返回最近一帧的偏离 (日志用).
+ */
+WaitStatus wait_for_baseline_recovery(
+    const std::shared_ptr<CancellationToken>& token,
+    hal::BaselineRecoveryMonitor& monitor,
+    float tolerance, std::size_t frames, double timeout_s,
+    hal::BaselineRecoveryMonitor::FrameDeviation* latest = nullptr);
+
+/**
+ * @brief WashAction 自适应终止参数 (0 值取默认)
+ */
+struct WashTermination {
+    bool until_baseline = false;
+    int min_cycles = 1;
+    int max_cycles = 1;
+    float tolerance = 0.05f;
+    std::size_t frames = 10;
+    double timeout_s = 30.0;
+};
+
+/**
+ * @brief 解析 WashAction 的终止方式
+ *
+ * UNTIL_BASELINE 需要已见过预热的基线 (baselines_available), 否则退回固定 repeat_count 次;
+ * 资源预估传 true 取上界.
+ */
+WashTermination wash_termination(const enose::experiment::WashAction& action, bool baselines_available);
+
 /**
  * @brief 原语执行器工厂
  */
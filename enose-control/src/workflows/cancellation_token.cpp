@@ -0,0 +1,59 @@
+#include "workflows/cancellation_token.hpp"
+
+namespace workflows {
+
+void CancellationToken::request_stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
+
+void CancellationToken::request_pause() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pause_ = true;
+    }
+    cv_.notify_all();
+}
+
+void CancellationToken::resume() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pause_ = false;
+    }
+    cv_.notify_all();
+}
+
+void CancellationToken::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = false;
+    pause_ = false;
+}
+
+bool CancellationToken::stop_requested() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stop_;
+}
+
+bool CancellationToken::pause_requested() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pause_;
+}
+
+void CancellationToken::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    cv_.notify_all();
+}
+
+bool CancellationToken::check_stop_or_pause() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !pause_ || stop_; });
+    return stop_;
+}
+
+} // namespace workflows
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <boost/signals2.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace workflows {
+
+/**
+ * @brief 等待结果
+ */
+enum class WaitStatus {
+    READY,      // 谓词满足
+    TIMEOUT,    // 超时 (不含暂停时间)
+    STOPPED     // 收到停止请求
+};
+
+/**
+ * @brief 实验执行的停止/暂停令牌
+ *
+ * 执行线程在 wait_for() 中阻塞于条件变量, 停止、暂停、恢复以及 notify()
+ * (传感器/称重读数到达) 都会立即唤醒等待者, 不再依赖固定间隔轮询.
+ * 暂停期间超时计时冻结, 恢复后继续剩余时间, 使步骤时长与暂停无关.
+ */
+class CancellationToken {
+public:
+    void request_stop();
+    void request_pause();
+    void resume();
+
+    /** @brief 清除停止/暂停标志 (新运行开始前调用) */
+    void reset();
+
+    bool stop_requested() const;
+    bool pause_requested() const;
+
+    /** @brief 条件可能已变化, 唤醒所有等待者重新求值谓词 (任意线程, 不阻塞) */
+    void notify();
+
+    /**
+     * @brief 暂停时阻塞到恢复或停止
+     * @return 是否已请求停止
+     */
+    bool check_stop_or_pause();
+
+    /**
+     * @brief 等待谓词满足 / 超时 / 停止
+     *
+     * 谓词在不持有令牌锁的情况下求值, 可以访问带锁的驱动状态.
+     * 仅在初次进入、每次 notify() 以及暂停恢复后求值.
+     */
+    template<typename Rep, typename Period, typename Predicate>
+    WaitStatus wait_for(std::chrono::duration<Rep, Period> timeout, Predicate pred) {
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            if (stop_) return WaitStatus::STOPPED;
+            if (pause_) {
+                auto paused_at = std::chrono::steady_clock::now();
+                cv_.wait(lock, [this] { return !pause_ || stop_; });
+                deadline += std::chrono::steady_clock::now() - paused_at;
+                continue;
+            }
+
+            uint64_t seen = generation_;
+            lock.unlock();
+            bool ready = pred();
+            lock.lock();
+            if (ready) return WaitStatus::READY;
+
+            bool woken = cv_.wait_until(lock, deadline, [this, seen] {
+                return stop_ || pause_ || generation_ != seen;
+            });
+            if (!woken) {
+                // 到期前最后求值一次, 避免恰好在截止时刻满足的条件被判为超时
+                lock.unlock();
+                ready = pred();
+                lock.lock();
+                if (stop_) return WaitStatus::STOPPED;
+                return ready ? WaitStatus::READY : WaitStatus::TIMEOUT;
+            }
+        }
+    }
+
+    /** @brief 可被停止打断的定时等待, 返回 false 表示被停止 */
+    template<typename Rep, typename Period>
+    bool sleep_for(std::chrono::duration<Rep, Period> duration) {
+        return wait_for(duration, [] { return false; }) != WaitStatus::STOPPED;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    bool pause_ = false;
+    uint64_t generation_ = 0;   // 每次 notify() 递增
+};
+
+/**
+ * @brief 一次等待的事件源集合
+ *
+ * 在作用域内把若干 signals2 信号连接到令牌的 notify(), 析构时自动断开.
+ * 例: WaitSet(token).notify_on(load_cell->on_status_update).wait_for(timeout, pred)
+ */
+class WaitSet {
+public:
+    explicit WaitSet(std::shared_ptr<CancellationToken> token)
+        : token_(std::move(token)) {}
+
+    WaitSet(const WaitSet&) = delete;
+    WaitSet& operator=(const WaitSet&) = delete;
+
+    template<typename Signal>
+    WaitSet& notify_on(Signal& signal) {
+        connections_.emplace_back(signal.connect([token = token_](auto&&...) {
+            token->notify();
+        }));
+        return *this;
+    }
+
+    template<typename Rep, typename Period, typename Predicate>
+    WaitStatus wait_for(std::chrono::duration<Rep, Period> timeout, Predicate pred) {
+        return token_->wait_for(timeout, std::move(pred));
+    }
+
+private:
+    std::shared_ptr<CancellationToken> token_;
+    std::vector<boost::signals2::scoped_connection> connections_;
+};
+
+} // namespace workflows
@@ -0,0 +1,340 @@
+#include "execution_plan.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace enose::workflows {
+
+ExecutionPlan::CompileResult ExecutionPlan::compile(const experiment::ExperimentProgram& program,
+                                                    const ExecutorResolver& resolver) {
+    clear();
+    resolver_ = &resolver;
+    for (const auto& liquid : program.hardware().liquids()) {
+        liquid_pumps_.emplace_back(liquid.id(), liquid.pump_index());
+    }
+
+    CompileResult result;
+    std::vector<LoopFrame> loops;
+    std::vector<LoopFrame> entered;
+    result.success = append(program.steps(), "steps", -1, loops, entered, result);
+    if (!result.success) {
+        clear();
+    }
+
+    resolver_ = nullptr;
+    if (result.success) {
+        spdlog::info("执行计划编译完成: {} 个顶层步骤展开为 {} 步 (保存 {} 步)",
+                     program.steps_size(), size_, steps_.size());
+    }
+    return result;
+}
+
+void ExecutionPlan::clear() {
+    liquid_pumps_.clear();
+    steps_.clear();
+    segments_.clear();
+    size_ = 0;
+}
+
+bool ExecutionPlan::append(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+                           const std::string& path_prefix, int32_t top_level_index,
+                           std::vector<LoopFrame>& loops, std::vector<LoopFrame>& entered,
+                           CompileResult& result) {
+    for (int i = 0; i < steps.size(); ++i) {
+        const auto& step = steps[i];
+        const std::string path = path_prefix + "[" + std::to_string(i) + "]";
+        const int32_t top = top_level_index < 0 ? i : top_level_index;
+
+        if (step.action_case() == experiment::Step::kLoop) {
+            const auto& loop = step.loop();
+            for (int32_t k = 1; k <= loop.count(); ++k) {
+                loops.push_back({k, loop.count()});
+                entered.push_back({k, loop.count()});
+                const bool ok = append(loop.steps(), path + "#" + std::to_string(k) + ".steps",
+                                       top, loops, entered, result);
+                loops.pop_back();
+                if (!ok) return false;
+            }
+            continue;
+        }
+
+        if (step.action_case() == experiment::Step::kSweep) {
+            if (!append_sweep(step, path, top, entered, result)) return false;
+            continue;
+        }
+
+        if (steps_.size() >= MAX_STEPS) {
+            result.error_message = "展开后的步骤数超过上限 " + std::to_string(MAX_STEPS);
+            return false;
+        }
+
+        // 模板步骤的序号和 ID 在生成扫描点时确定
+        PlanStep plan_step;
+        plan_step.index = static_cast<uint32_t>(compiling_sweep_ ? 0 : size_);
+        plan_step.id = path;
+        plan_step.step = &step;
+        plan_step.action = step.action_case();
+        plan_step.top_level_index = top;
+        if (!loops.empty()) {
+            plan_step.loop_iteration = loops.back().iteration;
+            plan_step.loop_total = loops.back().total;
+        }
+        plan_step.loops_entered = std::move(entered);
+        entered.clear();
+
+        if (const char* name = executor_name(plan_step.action); name[0] != '\0' && *resolver_) {
+            plan_step.executor = (*resolver_)(name);
+        }
+        if (plan_step.action == experiment::Step::kInject) {
+            resolve_inject(plan_step);
+        }
+        plan_step.slot = resolve_slot(plan_step);
+
+        if (!compiling_sweep_) {
+            if (segments_.empty() || segments_.back().sweep) {
+                segments_.push_back({size_, steps_.size(), 0, nullptr, {}, {}});
+            }
+            ++segments_.back().count;
+            ++size_;
+        }
+        steps_.push_back(std::move(plan_step));
+    }
+    return true;
+}
+
+bool ExecutionPlan::append_sweep(const experiment::Step& step, const std::string& path, int32_t top_level_index,
+                                 std::vector<LoopFrame>& entered, CompileResult& result) {
+    if (compiling_sweep_) {
+        result.error_message = path + ": 不支持嵌套的参数扫描";
+        return false;
+    }
+
+    auto sweep = std::make_shared<const SweepGenerator>(step.sweep());
+    if (!sweep->error().empty()) {
+        result.error_message = path + ": " + sweep->error();
+        return false;
+    }
+
+    // 模板只编译一次; 循环位置从扫描内部重新计起, 各步 ID 为相对扫描步骤的后缀
+    Segment segment{size_, steps_.size(), 0, sweep, path, std::move(entered)};
+    entered.clear();
+
+    std::vector<LoopFrame> body_loops;
+    std::vector<LoopFrame> body_entered;
+    compiling_sweep_ = sweep.get();
+    const bool ok = append(step.sweep().steps(), ".steps", top_level_index, body_loops, body_entered, result);
+    compiling_sweep_ = nullptr;
+    if (!ok) return false;
+
+    segment.count = steps_.size() - segment.first;
+    if (segment.count == 0) {
+        entered = std::move(segment.entered);
+        return true;
+    }
+
+    if (segment.size() > MAX_PLAN_SIZE - size_) {
+        result.error_message = "展开后的步骤数超过上限 " + std::to_string(MAX_PLAN_SIZE);
+        return false;
+    }
+    size_ += segment.size();
+    segments_.push_back(std::move(segment));
+    return true;
+}
+
+const ExecutionPlan::Segment& ExecutionPlan::segment_at(std::size_t pc) const {
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), pc,
+                               [](std::size_t value, const Segment& segment) { return value < segment.begin; });
+    return *std::prev(it);
+}
+
+const PlanStep& ExecutionPlan::stored(std::size_t pc) const {
+    const auto& segment = segment_at(pc);
+    return steps_[segment.first + (pc - segment.begin) % segment.count];
+}
+
+PlanStep ExecutionPlan::operator[](std::size_t pc) const {
+    const auto& segment = segment_at(pc);
+    const std::size_t offset = pc - segment.begin;
+    if (!segment.sweep) {
+        return steps_[segment.first + offset];
+    }
+
+    const uint64_t point = offset / segment.count;
+    const std::size_t k = offset % segment.count;
+    const auto iteration = static_cast<int32_t>(point + 1);
+    const auto total = static_cast<int32_t>(segment.sweep->size());
+
+    PlanStep plan_step = steps_[segment.first + k];
+    plan_step.index = static_cast<uint32_t>(pc);
+    plan_step.id = segment.id_prefix + "#" + std::to_string(iteration) + plan_step.id;
+    if (plan_step.loop_total == 0) {
+        plan_step.loop_iteration = iteration;
+        plan_step.loop_total = total;
+    }
+    if (k == 0) {
+        std::vector<LoopFrame> entered;
+        if (point == 0) entered = segment.entered;
+        entered.push_back({iteration, total});
+        entered.insert(entered.end(), plan_step.loops_entered.begin(), plan_step.loops_entered.end());
+        plan_step.loops_entered = std::move(entered);
+    }
+    if (plan_step.action == experiment::Step::kInject) {
+        plan_step.inject = {};
+        resolve_inject(plan_step, segment.sweep.get(), point);
+    }
+    return plan_step;
+}
+
+void ExecutionPlan::resolve_inject(PlanStep& plan_step, const SweepGenerator* sweep, uint64_t point) const {
+    const auto& action = plan_step.step->inject();
+    auto& params = plan_step.inject;
+
+    params.speed = action.flow_rate_ml_min() / 60.0 * 1000;  // 转换为 mm/s (假设 1ml ≈ 1000mm)
+    params.accel = params.speed * 2;  // 默认加速度
+
+    float* volumes[] = {
+        &params.pump_0_volume, &params.pump_1_volume, &params.pump_2_volume, &params.pump_3_volume,
+        &params.pump_4_volume, &params.pump_5_volume, &params.pump_6_volume, &params.pump_7_volume,
+    };
+
+    // 扫描点上的成分比例由生成器给出 (模板中的比例只是占位)
+    const double total_volume = action.target_volume_ml();
+    for (const auto& comp : action.components()) {
+        const double ratio = sweep ? sweep->ratio(point, comp) : comp.ratio();
+        for (const auto& [liquid_id, pump] : liquid_pumps_) {
+            if (liquid_id != comp.liquid_id()) continue;
+            if (pump >= 0 && pump < 8) {
+                *volumes[pump] += static_cast<float>(total_volume * ratio * 1000);  // ml to mm
+            }
+            break;
+        }
+    }
+}
+
+::workflows::StepScheduler::Slot ExecutionPlan::resolve_slot(const PlanStep& plan_step) {
+    using Scheduler = ::workflows::StepScheduler;
+
+    if (plan_step.executor) {
+        return {Scheduler::resource_mask(plan_step.executor->required_resources()), false};
+    }
+
+    // 无执行器时按内联实现实际操作的执行机构 (与对应执行器的声明一致).
+    // 进样/排废/采集/清洗都切换 SystemState, 切换重设全部阀门和泵, 所以都占用整套外设
+    constexpr uint32_t PERIPHERALS = Scheduler::VALVES | Scheduler::PERISTALTIC_PUMP |
+                                     Scheduler::CLEAN_PUMP | Scheduler::GAS_PUMP;
+    switch (plan_step.action) {
+        case experiment::Step::kInject:
+        case experiment::Step::kDrain:
+        case experiment::Step::kWash:
+            return {PERIPHERALS | Scheduler::LOAD_CELL, false};
+        case experiment::Step::kAcquire:
+            return {PERIPHERALS | Scheduler::SENSOR, false};
+        case experiment::Step::kSetGasPump:
+            return {Scheduler::GAS_PUMP, false};
+        default:
+            // 等待 (时序依赖前序步骤)、切换状态、阶段标记 (数据标签) 都是屏障
+            return {Scheduler::ALL, true};
+    }
+}
+
+std::size_t ExecutionPlan::safe_resume_point(std::size_t pc, bool disturbed) const {
+    if (pc >= size_ || !disturbed) return pc;
+    
+    for (std::size_t i = pc + 1; i-- > 0;) {
+        if (action(i) == experiment::Step::kDrain) return i;
+    }
+    // 之前没有排废: 只能从中断的步骤重做, 由操作员确认瓶中状态
+    return pc;
+}
+
+std::string ExecutionPlan::phase_at(std::size_t pc) const {
+    std::string phase;
+    for (std::size_t i = 0; i < pc && i < size_; ++i) {
+        const auto& plan_step = stored(i);
+        if (plan_step.action != experiment::Step::kPhaseMarker) continue;
+        const auto& marker = plan_step.step->phase_marker();
+        phase = marker.is_start() ? marker.phase_name() : "";
+    }
+    return phase;
+}
+
+void to_json(nlohmann::json& j, const RunCheckpoint& checkpoint) {
+    j = {
+        {"version", RunCheckpoint::VERSION},
+        {"plan_pc", checkpoint.plan_pc},
+        {"plan_steps", checkpoint.plan_steps},
+        {"step_id", checkpoint.step_id},
+        {"loop_iteration", checkpoint.loop_iteration},
+        {"loop_total", checkpoint.loop_total},
+        {"empty_weight_g", nullptr},
+        {"consumed_ml", checkpoint.consumed_ml},
+        {"elapsed_s", checkpoint.elapsed_s},
+    };
+    if (checkpoint.empty_weight_g) {
+        j["empty_weight_g"] = *checkpoint.empty_weight_g;
+    }
+    if (checkpoint.resume_pc) {
+        j["resume_pc"] = *checkpoint.resume_pc;
+    }
+}
+
+void from_json(const nlohmann::json& j, RunCheckpoint& checkpoint) {
+    checkpoint.plan_pc = j.at("plan_pc").get<std::size_t>();
+    checkpoint.plan_steps = j.at("plan_steps").get<std::size_t>();
+    if (j.contains("resume_pc")) {
+        checkpoint.resume_pc = j["resume_pc"].get<std::size_t>();
+    } else {
+        checkpoint.resume_pc.reset();
+    }
+    checkpoint.step_id = j.value("step_id", "");
+    checkpoint.loop_iteration = j.value("loop_iteration", 0);
+    checkpoint.loop_total = j.value("loop_total", 0);
+    if (j.contains("empty_weight_g") && !j["empty_weight_g"].is_null()) {
+        checkpoint.empty_weight_g = j["empty_weight_g"].get<float>();
+    } else {
+        checkpoint.empty_weight_g.reset();
+    }
+    if (j.contains("consumed_ml")) {
+        checkpoint.consumed_ml = j["consumed_ml"].get<std::array<double, 8>>();
+    }
+    checkpoint.elapsed_s = j.value("elapsed_s", 0.0);
+}
+
+std::size_t ExecutionPlan::find(const std::string& id) const {
+    for (const auto& segment : segments_) {
+        if (!segment.sweep) {
+            for (std::size_t k = 0; k < segment.count; ++k) {
+                if (steps_[segment.first + k].id == id) return segment.begin + k;
+            }
+            continue;
+        }
+        
+        // 扫描点上的步骤: "<扫描路径>#<点序号><模板后缀>"
+        const std::string prefix = segment.id_prefix + "#";
+        if (id.compare(0, prefix.size(), prefix) != 0) continue;
+        std::size_t digits = prefix.size();
+        while (digits < id.size() && id[digits] >= '0' && id[digits] <= '9') ++digits;
+        if (digits == prefix.size() || digits - prefix.size() > 10) continue;
+        
+        const uint64_t point = std::stoull(id.substr(prefix.size(), digits - prefix.size()));
+        if (point < 1 || point > segment.sweep->size()) continue;
+        const std::string suffix = id.substr(digits);
+        for (std::size_t k = 0; k < segment.count; ++k) {
+            if (steps_[segment.first + k].id == suffix) {
+                return segment.begin + (point - 1) * segment.count + k;
+            }
+        }
+    }
+    return size_;
+}
+
+const char* ExecutionPlan::executor_name(experiment::Step::ActionCase action) {
+    switch (action) {
+        case experiment::Step::kInject: return "inject";
+        case experiment::Step::kDrain: return "drain";
+        case experiment::Step::kAcquire: return "acquire";
+        case experiment::Step::kWash: return "wash";
+        default: return "";
+    }
+}
+
+} // namespace enose::workflows
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "enose_experiment.pb.h"
+#include "workflows/action_executor.hpp"
+#include "workflows/step_scheduler.hpp"
+#include "workflows/sweep_generator.hpp"
+#include "workflows/system_state.hpp"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace enose::workflows {
+
+/** @brief 进入一次循环迭代 (从外到内) */
+struct LoopFrame {
+    int32_t iteration;      // 从 1 开始
+    int32_t total;
+};
+
+/**
+ * @brief 执行计划中的一步 (循环已展开)
+ *
+ * step 指向 ExperimentProgram 内的原始步骤, 计划与程序的生命周期相同.
+ * 扫描点上的步骤指向模板步骤, 成分比例已按扫描点换算进 inject.
+ */
+struct PlanStep {
+    uint32_t index;                     // 在计划中的序号
+    std::string id;                     // 稳定步骤ID, e.g. "steps[1]#3.steps[0]" (第 3 次迭代 / 第 3 个扫描点)
+    const experiment::Step* step;
+    experiment::Step::ActionCase action;
+    int32_t top_level_index;            // 所在的顶层步骤
+    int32_t loop_iteration = 0;         // 最内层循环的迭代或扫描点 (不在循环中为 0)
+    int32_t loop_total = 0;
+    std::vector<LoopFrame> loops_entered;   // 本步开始的循环迭代 (用于 LOOP_ITERATION 事件)
+
+    // 按执行器名 (inject / drain / acquire / wash) 预先解析, 无对应执行器时为空
+    ::workflows::IActionExecutor* executor = nullptr;
+    // 进样步骤: 已按液体→泵映射换算好的各泵行程与速度
+    ::workflows::SystemState::InjectionParams inject;
+    // 流水线调度: 占用的执行机构 (有执行器时取其 required_resources) 与是否为屏障
+    ::workflows::StepScheduler::Slot slot;
+};
+
+/**
+ * @brief 运行检查点 (保存在 runs.checkpoint, 进程重启后续跑)
+ *
+ * plan_pc 为已连续完成的步骤数; plan_steps / step_id 用于确认重新编译的计划与中断时一致.
+ * resume_pc 为写入时算出的续跑位置 (版本 1 没有), consumed_ml 是截至 resume_pc 的消耗.
+ */
+struct RunCheckpoint {
+    static constexpr int VERSION = 2;
+    
+    std::size_t plan_pc = 0;
+    std::optional<std::size_t> resume_pc;
+    std::size_t plan_steps = 0;
+    std::string step_id;                    // plan_pc 处步骤的稳定 ID (完成时为空)
+    int32_t loop_iteration = 0;
+    int32_t loop_total = 0;
+    std::optional<float> empty_weight_g;    // 称重传感器的动态空瓶值
+    std::array<double, 8> consumed_ml{};    // 本次运行截至 resume_pc 各泵已消耗的液体量
+    double elapsed_s = 0;
+};
+
+void to_json(nlohmann::json& j, const RunCheckpoint& checkpoint);
+void from_json(const nlohmann::json& j, RunCheckpoint& checkpoint);
+
+/**
+ * @brief 编译后的线性执行计划
+ *
+ * LoadProgram 时编译一次: 循环按次数展开为线性序列, 每步带稳定 ID、所在顶层步骤与循环位置、
+ * 预先解析的执行器和进样泵参数. 运行时按程序计数器顺序执行, 进度为 pc / size,
+ * 暂停 / 恢复 / 断点续跑只需保存和恢复 pc.
+ *
+ * 参数扫描不展开: 模板步骤只编译一次, 计划按段记录 "模板 × 扫描点数",
+ * operator[] 按 pc 算出扫描点并现场生成该步 (ID、进样泵参数), 内存与扫描规模无关.
+ */
+class ExecutionPlan {
+public:
+    // 展开后 (扫描只计模板) 保存的步骤数上限, 超过时拒绝编译 (嵌套循环可能指数增长)
+    static constexpr std::size_t MAX_STEPS = 100000;
+    // 含扫描点在内的总步骤数上限 (步骤序号为 32 位)
+    static constexpr std::size_t MAX_PLAN_SIZE = 0xFFFFFFFFu;
+
+    using ExecutorResolver = std::function<::workflows::IActionExecutor*(const std::string& name)>;
+
+    struct CompileResult {
+        bool success = false;
+        std::string error_message;
+    };
+
+    /**
+     * @brief 编译程序; program 必须在计划使用期间保持有效
+     */
+    CompileResult compile(const experiment::ExperimentProgram& program, const ExecutorResolver& resolver);
+
+    void clear();
+
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+
+    /** @brief 第 pc 步 (扫描点上的步骤按需生成, 因此按值返回) */
+    PlanStep operator[](std::size_t pc) const;
+
+    /** @brief 第 pc 步的动作 / 调度槽, 不生成整步 */
+    experiment::Step::ActionCase action(std::size_t pc) const { return stored(pc).action; }
+    ::workflows::StepScheduler::Slot slot(std::size_t pc) const { return stored(pc).slot; }
+
+    /** @brief 按稳定 ID 查找步骤序号, 不存在时返回 size() */
+    std::size_t find(const std::string& id) const;
+
+    /** @brief 执行到 pc (尚未执行) 时的完成百分比 */
+    int progress_percent(std::size_t pc) const {
+        return size_ == 0 ? 0 : static_cast<int>(pc * 100 / size_);
+    }
+
+    /** @brief 动作对应的执行器名, 无执行器的动作返回空串 */
+    static const char* executor_name(experiment::Step::ActionCase action);
+    
+    /**
+     * @brief 在 pc (尚未完成, 之前的步骤均已完成) 处中断后可安全续跑的位置
+     *
+     * disturbed: pc 及之后已有进样 / 清洗开始执行 (流水线重叠时可能超前于 pc). 此时瓶中液体量未知,
+     * 回退到 pc 及之前最近的排废步骤重新开始; 否则从 pc 重做.
+     */
+    std::size_t safe_resume_point(std::size_t pc, bool disturbed) const;
+    
+    /** @brief 执行到 pc 之前时所处的阶段 (最近一个未结束的 PhaseMarker), 无则为空 */
+    std::string phase_at(std::size_t pc) const;
+
+private:
+    /**
+     * @brief 连续的一段计划
+     *
+     * 普通段: steps_[first, first + count) 按顺序各执行一次, 步骤的 index / id 已是最终值.
+     * 扫描段: 模板 steps_[first, first + count) 对 sweep 的每个点执行一遍,
+     * 模板步骤的 id 为相对 id_prefix 的后缀.
+     */
+    struct Segment {
+        std::size_t begin = 0;              // 段内第一步的 pc
+        std::size_t first = 0;
+        std::size_t count = 0;
+        std::shared_ptr<const SweepGenerator> sweep;
+        std::string id_prefix;              // 扫描步骤的路径, e.g. "steps[2]"
+        std::vector<LoopFrame> entered;     // 进入扫描前尚未分配的外层循环迭代
+
+        std::size_t size() const { return sweep ? count * sweep->size() : count; }
+    };
+
+    // top_level_index < 0 表示 steps 即顶层步骤; loops 为外层的循环位置,
+    // entered 为已进入但尚未分配给步骤的循环迭代
+    bool append(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+                const std::string& path_prefix, int32_t top_level_index,
+                std::vector<LoopFrame>& loops, std::vector<LoopFrame>& entered,
+                CompileResult& result);
+    bool append_sweep(const experiment::Step& step, const std::string& path, int32_t top_level_index,
+                      std::vector<LoopFrame>& entered, CompileResult& result);
+    void resolve_inject(PlanStep& plan_step, const SweepGenerator* sweep = nullptr, uint64_t point = 0) const;
+    static ::workflows::StepScheduler::Slot resolve_slot(const PlanStep& plan_step);
+
+    const Segment& segment_at(std::size_t pc) const;
+    // pc 处的普通步骤或模板步骤
+    const PlanStep& stored(std::size_t pc) const;
+
+    const ExecutorResolver* resolver_ = nullptr;
+    const SweepGenerator* compiling_sweep_ = nullptr;   // 正在编译模板的扫描 (不支持嵌套)
+    std::vector<std::pair<std::string, int>> liquid_pumps_;     // 液体ID → 泵
+    std::vector<PlanStep> steps_;
+    std::vector<Segment> segments_;
+    std::size_t size_ = 0;
+};
+
+} // namespace enose::workflows
@@ -1,7 +1,8 @@
 #include "workflows/executors/acquire_executor.hpp"
+#include "workflows/experiment_simulator.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <chrono>
-#include <thread>
 
 namespace workflows {
 
@@ -64,23 +65,24 @@ ExecuteResult AcquireExecutor::execute(const enose::experiment::Step& step) {
     
     // TODO: 设置气泵PWM到指定值
     
-    // 根据终止条件等待
+    // 根据终止条件等待 (被停止时返回 false, guard 析构时自动回滚)
+    bool completed = true;
     switch (action.termination_case()) {
         case enose::experiment::AcquireAction::kDurationS: {
             add_log("采集模式: 固定时间 " + std::to_string(action.duration_s()) + "s");
-            wait_for_duration(action.duration_s());
+            completed = wait_for_duration(action.duration_s());
             break;
         }
         
         case enose::experiment::AcquireAction::kHeaterCycles: {
             add_log("采集模式: 加热周期 x" + std::to_string(action.heater_cycles()));
-            wait_for_heater_cycles(action.heater_cycles(), action.max_duration_s());
+            completed = wait_for_heater_cycles(action.heater_cycles(), action.max_duration_s());
             break;
         }
         
         case enose::experiment::AcquireAction::kStability: {
             add_log("采集模式: 稳定性检测");
-            wait_for_stability(
+            completed = wait_for_stability(
                 action.stability().window_s(),
                 action.stability().threshold_percent(),
                 action.max_duration_s()
@@ -90,11 +92,15 @@ ExecuteResult AcquireExecutor::execute(const enose::experiment::Step& step) {
         
         default: {
             add_log("采集模式: 默认最大时间 " + std::to_string(action.max_duration_s()) + "s");
-            wait_for_duration(action.max_duration_s());
+            completed = wait_for_duration(action.max_duration_s());
             break;
         }
     }
     
+    if (!completed) {
+        return ExecuteResult::fail("Acquire stopped by user");
+    }
+    
     add_log("采集完成");
     
     // 提交事务
@@ -106,92 +112,40 @@ ExecuteResult AcquireExecutor::execute(const enose::experiment::Step& step) {
     return ExecuteResult::ok("", total_duration);
 }
 
-void AcquireExecutor::wait_for_duration(double seconds) {
-    auto end = std::chrono::steady_clock::now() + 
-               std::chrono::milliseconds(static_cast<int>(seconds * 1000));
-    while (std::chrono::steady_clock::now() < end) {
-        if (check_stop_or_pause()) return;
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+bool AcquireExecutor::wait_for_duration(double seconds) {
+    return token_->sleep_for(std::chrono::duration<double>(seconds));
 }
 
-void AcquireExecutor::wait_for_heater_cycles(int count, double timeout_s) {
+bool AcquireExecutor::wait_for_heater_cycles(int count, double timeout_s) {
     if (!sensor_) {
         add_log("警告: 无传感器驱动，使用估算时间");
-        double estimated_cycle_time = 26.0;
+        double estimated_cycle_time = enose::workflows::SimulationModel::DEFAULT_HEATER_CYCLE_S;
         double total_time = count * estimated_cycle_time;
-        wait_for_duration(std::min(total_time, timeout_s));
-        return;
+        return wait_for_duration(std::min(total_time, timeout_s));
     }
     
     add_log("等待 " + std::to_string(count) + " 个加热周期完成");
     
-    int completed_cycles = 0;
-    int last_heater_step = -1;
-    bool seen_first_cycle = false;
-    
-    auto start = std::chrono::steady_clock::now();
-    auto timeout = std::chrono::seconds(static_cast<int>(timeout_s));
-    
-    std::mutex cycle_mutex;
-    std::condition_variable cycle_cv;
-    
-    auto conn = sensor_->on_packet.connect([&](const nlohmann::json& packet) {
-        if (!packet.contains("type") || packet["type"] != "reading") return;
-        if (!packet.contains("heater_step")) return;
-        
-        int current_step = packet["heater_step"].get<int>();
-        
-        std::lock_guard<std::mutex> lock(cycle_mutex);
-        
-        if (last_heater_step > 0 && current_step == 0 && seen_first_cycle) {
-            completed_cycles++;
-            add_log("完成加热周期 " + std::to_string(completed_cycles) + "/" + std::to_string(count));
-            cycle_cv.notify_all();
-        }
-        
-        if (last_heater_step > current_step && !seen_first_cycle) {
-            seen_first_cycle = true;
-        }
-        
-        last_heater_step = current_step;
-    });
-    
-    {
-        std::unique_lock<std::mutex> lock(cycle_mutex);
-        while (completed_cycles < count) {
-            if (check_stop_or_pause()) {
-                conn.disconnect();
-                return;
-            }
-            
-            if (std::chrono::steady_clock::now() - start > timeout) {
-                add_log("等待加热周期超时");
-                conn.disconnect();
-                return;
-            }
-            
-            cycle_cv.wait_for(lock, std::chrono::milliseconds(100));
-        }
-    }
-    
-    conn.disconnect();
-    add_log("加热周期等待完成");
+    auto status = workflows::wait_for_heater_cycles(token_, *sensor_, count, timeout_s);
+    if (status == WaitStatus::STOPPED) return false;
+    add_log(status == WaitStatus::READY ? "加热周期等待完成" : "等待加热周期超时");
+    return true;
 }
 
-void AcquireExecutor::wait_for_stability(double window_s, double threshold_percent, double timeout_s) {
+bool AcquireExecutor::wait_for_stability(double window_s, double threshold_percent, double timeout_s) {
     if (!sensor_) {
         add_log("警告: 无传感器驱动，使用最大时间");
-        wait_for_duration(timeout_s);
-        return;
+        return wait_for_duration(timeout_s);
     }
     
     add_log("等待传感器稳定 (窗口=" + std::to_string(window_s) + 
             "s, 阈值=" + std::to_string(threshold_percent) + "%)");
     
-    // TODO: 实现稳定性检测逻辑
-    // 暂时使用超时等待
-    wait_for_duration(timeout_s);
+    auto status = workflows::wait_for_sensor_stability(
+        token_, *sensor_, window_s, threshold_percent, timeout_s);
+    if (status == WaitStatus::STOPPED) return false;
+    add_log(status == WaitStatus::READY ? "传感器已稳定" : "等待稳定超时");
+    return true;
 }
 
 double AcquireExecutor::estimate_duration(const enose::experiment::Step& step) const {
@@ -203,7 +157,12 @@ double AcquireExecutor::estimate_duration(const enose::experiment::Step& step) c
         case enose::experiment::AcquireAction::kDurationS:
             return action.duration_s();
         case enose::experiment::AcquireAction::kHeaterCycles:
-            return action.heater_cycles() * 26.0;  // 估算每周期26秒
+        {
+            // 优先用实测的周期时长
+            double cycle_s = sensor_ ? sensor_->heater_cycles().mean_cycle_period_s() : 0;
+            if (cycle_s <= 0) cycle_s = enose::workflows::SimulationModel::DEFAULT_HEATER_CYCLE_S;
+            return action.heater_cycles() * cycle_s;
+        }
         default:
             return action.max_duration_s();
     }
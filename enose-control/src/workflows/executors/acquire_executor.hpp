@@ -43,17 +43,18 @@ public:
     bool is_idempotent() const override { return false; }
     
     std::vector<std::string> required_resources() const override {
-        return {"gas_pump", "sensor", "valves"};
+        // 切换到 SAMPLE 会停止蠕动泵并关闭清洗泵
+        return {"gas_pump", "sensor", "valves", "peristaltic_pump", "clean_pump"};
     }
 
 private:
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
     std::shared_ptr<hal::SensorDriver> sensor_;
     
-    // 等待辅助方法
-    void wait_for_duration(double seconds);
-    void wait_for_heater_cycles(int count, double timeout_s);
-    void wait_for_stability(double window_s, double threshold_percent, double timeout_s);
+    // 等待辅助方法 (被停止时返回 false)
+    bool wait_for_duration(double seconds);
+    bool wait_for_heater_cycles(int count, double timeout_s);
+    bool wait_for_stability(double window_s, double threshold_percent, double timeout_s);
 };
 
 } // namespace workflows
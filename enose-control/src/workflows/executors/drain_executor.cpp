@@ -57,24 +57,31 @@ ExecuteResult DrainExecutor::execute(const enose::experiment::Step& step) {
     
     // 等待空瓶
     if (load_cell_) {
-        auto result = load_cell_->wait_for_empty_bottle(
+        // 排废模型给出预测时记录预计排空时间 (回调在称重 strand 上)
+        boost::signals2::scoped_connection predicted = load_cell_->on_drain_predicted.connect(
+            [this](const hal::DrainPredictor::Prediction& p) {
+                add_log("预计 " + std::to_string(p.remaining_s) + "s 后排空 (" + std::to_string(p.asymptote_g) + "g)");
+            });
+        auto result = wait_for_empty_bottle(
+            token_, *load_cell_,
             action.empty_tolerance_g(),
             action.timeout_s(),
             action.stability_window_s()
         );
+        if (!result) {
+            return ExecuteResult::fail("Drain stopped by user");
+        }
         
-        if (result.success) {
-            add_log("排废完成: " + std::to_string(result.empty_weight) + "g");
+        if (result->success) {
+            add_log("排废完成: " + std::to_string(result->empty_weight) + "g" +
+                    (result->predicted ? " (排废模型确认)" : ""));
         } else {
             add_log("排废超时");
         }
     } else {
         // 无称重传感器，使用超时等待
-        auto timeout = std::chrono::seconds(static_cast<int>(action.timeout_s()));
-        auto start = std::chrono::steady_clock::now();
-        while (!check_stop_or_pause() && 
-               std::chrono::steady_clock::now() - start < timeout) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!token_->sleep_for(std::chrono::duration<double>(action.timeout_s()))) {
+            return ExecuteResult::fail("Drain stopped by user");
         }
         add_log("排废完成 (无称重反馈)");
     }
@@ -39,7 +39,8 @@ public:
     bool is_idempotent() const override { return true; }
     
     std::vector<std::string> required_resources() const override {
-        return {"valves", "load_cell"};
+        // DRAIN 状态开气泵排液, 切换时停止蠕动泵并关闭清洗泵
+        return {"valves", "load_cell", "gas_pump", "peristaltic_pump", "clean_pump"};
     }
 
 private:
@@ -1,7 +1,6 @@
 #include "workflows/executors/inject_executor.hpp"
 #include <spdlog/spdlog.h>
 #include <chrono>
-#include <thread>
 
 namespace workflows {
 
@@ -107,24 +106,23 @@ ExecuteResult InjectExecutor::execute(const enose::experiment::Step& step) {
                           action.target_weight_g() : 
                           total_volume;  // 假设密度≈1
     double tolerance = action.tolerance();
-    auto timeout = std::chrono::seconds(static_cast<int>(action.stable_timeout_s()));
+    auto timeout = std::chrono::duration<double>(action.stable_timeout_s());
     auto inject_start = std::chrono::steady_clock::now();
     
-    while (!check_stop_or_pause()) {
-        if (load_cell_) {
-            float current_weight = load_cell_->get_filtered_weight();
-            if (current_weight >= target_weight - tolerance) {
-                add_log("进样完成: " + std::to_string(current_weight) + "g");
-                break;
-            }
-        }
+    if (load_cell_) {
+        auto status = make_wait_set()
+            .notify_on(load_cell_->on_status_update)
+            .wait_for(timeout, [&] {
+                return load_cell_->get_filtered_weight() >= target_weight - tolerance;
+            });
         
-        if (std::chrono::steady_clock::now() - inject_start > timeout) {
+        if (status == WaitStatus::READY) {
+            add_log("进样完成: " + std::to_string(load_cell_->get_filtered_weight()) + "g");
+        } else if (status == WaitStatus::TIMEOUT) {
             add_log("进样超时");
-            break;
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    } else if (token_->sleep_for(timeout)) {
+        add_log("进样超时");
     }
     
     // 计算执行时间
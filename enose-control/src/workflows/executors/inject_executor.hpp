@@ -40,7 +40,8 @@ public:
     bool is_idempotent() const override { return false; }
     
     std::vector<std::string> required_resources() const override {
-        return {"peristaltic_pump", "load_cell", "valves"};
+        // 切换到 INJECT 会重设全部阀门和气泵/清洗泵 PWM
+        return {"peristaltic_pump", "load_cell", "valves", "gas_pump", "clean_pump"};
     }
 
 private:
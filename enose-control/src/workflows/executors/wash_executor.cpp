@@ -1,7 +1,6 @@
 #include "workflows/executors/wash_executor.hpp"
 #include <spdlog/spdlog.h>
 #include <chrono>
-#include <thread>
 
 namespace workflows {
 
@@ -55,18 +54,30 @@ ExecuteResult WashExecutor::execute(const enose::experiment::Step& step) {
     }
     
     const auto& action = step.wash();
-    add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) + 
-            "g, 重复" + std::to_string(action.repeat_count()) + "次");
+    const auto termination = wash_termination(
+        action, baseline_recovery_ && baseline_recovery_->has_baselines());
+    if (termination.until_baseline) {
+        add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) +
+                "g, " + std::to_string(termination.min_cycles) + "-" + std::to_string(termination.max_cycles) +
+                "次, 直到传感器回到基线");
+    } else {
+        if (action.mode() == enose::experiment::WASH_MODE_UNTIL_BASELINE) {
+            add_log("尚无已预热的传感器基线, 按固定次数清洗");
+        }
+        add_log("清洗: 目标重量变化=" + std::to_string(action.target_weight_g()) +
+                "g, 重复" + std::to_string(termination.max_cycles) + "次");
+    }
     
     // 创建事务守卫 - 不自动切换状态，内部手动管理
     auto guard = create_guard(std::nullopt, "wash");
     
-    for (int i = 0; i < action.repeat_count(); ++i) {
+    bool recovered = false;
+    for (int i = 0; i < termination.max_cycles; ++i) {
         if (check_stop_or_pause()) {
             return ExecuteResult::fail("Wash stopped by user");
         }
         
-        add_log("清洗循环 " + std::to_string(i + 1) + "/" + std::to_string(action.repeat_count()));
+        add_log("清洗循环 " + std::to_string(i + 1) + "/" + std::to_string(termination.max_cycles));
         
         // 1. 排废确认空瓶稳态
         add_log("排废确认空瓶...");
@@ -74,13 +85,17 @@ ExecuteResult WashExecutor::execute(const enose::experiment::Step& step) {
         
         float baseline_weight = 0;
         if (load_cell_) {
-            auto empty_result = load_cell_->wait_for_empty_bottle(
+            auto empty_result = wait_for_empty_bottle(
+                token_, *load_cell_,
                 action.empty_tolerance_g(),
                 action.drain_timeout_s(),
                 action.empty_stability_window_s()
             );
+            if (!empty_result) {
+                return ExecuteResult::fail("Wash stopped by user");
+            }
             
-            if (!empty_result.success) {
+            if (!empty_result->success) {
                 add_log("排废超时，继续清洗");
             }
             
@@ -96,29 +111,22 @@ ExecuteResult WashExecutor::execute(const enose::experiment::Step& step) {
         add_log("开始注入清洗液...");
         system_state_->transition_to(SystemState::State::CLEAN);
         
-        // 3. 监测重量变化
-        auto fill_start = std::chrono::steady_clock::now();
-        auto fill_timeout = std::chrono::seconds(static_cast<int>(action.fill_timeout_s()));
-        bool target_reached = false;
-        
-        while (!check_stop_or_pause()) {
-            if (load_cell_) {
-                float current_weight = load_cell_->get_filtered_weight();
-                float weight_change = current_weight - baseline_weight;
-                
-                if (weight_change >= action.target_weight_g()) {
-                    add_log("达到目标重量变化: " + std::to_string(weight_change) + "g");
-                    target_reached = true;
-                    break;
-                }
-            }
+        // 3. 监测重量变化 (每个称重读数到达时判定)
+        if (load_cell_) {
+            auto fill_status = make_wait_set()
+                .notify_on(load_cell_->on_status_update)
+                .wait_for(std::chrono::duration<double>(action.fill_timeout_s()), [&] {
+                    return load_cell_->get_filtered_weight() - baseline_weight >= action.target_weight_g();
+                });
             
-            if (std::chrono::steady_clock::now() - fill_start > fill_timeout) {
+            if (fill_status == WaitStatus::READY) {
+                float weight_change = load_cell_->get_filtered_weight() - baseline_weight;
+                add_log("达到目标重量变化: " + std::to_string(weight_change) + "g");
+            } else if (fill_status == WaitStatus::TIMEOUT) {
                 add_log("清洗注入超时");
-                break;
             }
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        } else if (token_->sleep_for(std::chrono::duration<double>(action.fill_timeout_s()))) {
+            add_log("清洗注入超时");
         }
         
         if (check_stop_or_pause()) {
@@ -130,18 +138,46 @@ ExecuteResult WashExecutor::execute(const enose::experiment::Step& step) {
         system_state_->transition_to(SystemState::State::DRAIN);
         
         if (load_cell_) {
-            auto drain_result = load_cell_->wait_for_empty_bottle(
+            auto drain_result = wait_for_empty_bottle(
+                token_, *load_cell_,
                 action.empty_tolerance_g(),
                 action.drain_timeout_s(),
                 action.empty_stability_window_s()
             );
+            if (!drain_result) {
+                return ExecuteResult::fail("Wash stopped by user");
+            }
             
-            if (drain_result.success) {
-                add_log("排废完成: " + std::to_string(drain_result.empty_weight) + "g");
+            if (drain_result->success) {
+                add_log("排废完成: " + std::to_string(drain_result->empty_weight) + "g" +
+                    (drain_result->predicted ? " (排废模型确认)" : ""));
             } else {
                 add_log("排废超时");
             }
         }
+        
+        // 5. 自适应终止: 达到最少次数后, 传感器回到基线即结束
+        if (termination.until_baseline && i + 1 >= termination.min_cycles) {
+            hal::BaselineRecoveryMonitor::FrameDeviation latest;
+            auto status = wait_for_baseline_recovery(
+                token_, *baseline_recovery_, termination.tolerance, termination.frames,
+                termination.timeout_s, &latest);
+            if (status == WaitStatus::STOPPED) {
+                return ExecuteResult::fail("Wash stopped by user");
+            }
+            
+            const std::string deviation = std::to_string(latest.max_deviation * 100) + "%";
+            if (status == WaitStatus::READY) {
+                add_log("传感器已回到基线 (最大偏离 " + deviation + "), 第" + std::to_string(i + 1) + "次循环后结束清洗");
+                recovered = true;
+                break;
+            }
+            add_log("传感器未回到基线 (最大偏离 " + deviation + ", 传感器 " +
+                    std::to_string(latest.worst_sensor) + ")");
+        }
+    }
+    if (termination.until_baseline && !recovered) {
+        add_log("已达最多清洗次数 " + std::to_string(termination.max_cycles) + ", 传感器仍未回到基线");
     }
     
     // 提交事务
@@ -158,9 +194,14 @@ double WashExecutor::estimate_duration(const enose::experiment::Step& step) cons
     if (!step.has_wash()) return 0;
     
     const auto& action = step.wash();
-    // 每次循环: 排废 + 填充 + 排废
+    // 每次循环: 排废 + 填充 + 排废 (自适应时按上限, 另加每次的基线等待)
     double per_cycle = action.drain_timeout_s() + action.fill_timeout_s() + action.drain_timeout_s();
-    return per_cycle * action.repeat_count();
+    const auto termination = wash_termination(
+        action, baseline_recovery_ && baseline_recovery_->has_baselines());
+    if (termination.until_baseline) {
+        per_cycle += termination.timeout_s;
+    }
+    return per_cycle * termination.max_cycles;
 }
 
 } // namespace workflows
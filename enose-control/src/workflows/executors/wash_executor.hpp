@@ -14,6 +14,7 @@ namespace workflows {
  * - 多次循环清洗
  * - 每次循环: 排废 -> 注入清洗液 -> 排废
  * - 监测重量变化
+ * - WASH_MODE_UNTIL_BASELINE: 每次排废后等待传感器回到基线, 回到即结束
  * - 恢复初始状态
  */
 class WashExecutor : public ActionExecutorBase {
@@ -26,6 +27,11 @@ public:
         , load_cell_(std::move(load_cell))
     {}
     
+    /** @brief 自适应终止的基线判据 (未设置时退回固定次数) */
+    void set_baseline_recovery(std::shared_ptr<hal::BaselineRecoveryMonitor> monitor) {
+        baseline_recovery_ = std::move(monitor);
+    }
+    
     std::string name() const override { return "wash"; }
     
     PreconditionResult check_preconditions(
@@ -40,11 +46,13 @@ public:
     bool is_idempotent() const override { return false; }
     
     std::vector<std::string> required_resources() const override {
-        return {"clean_pump", "valves", "load_cell"};
+        // 清洗循环在 DRAIN / CLEAN 间切换, 两者都驱动气泵 PWM
+        return {"clean_pump", "valves", "load_cell", "gas_pump", "peristaltic_pump"};
     }
 
 private:
     std::shared_ptr<hal::LoadCellDriver> load_cell_;
+    std::shared_ptr<hal::BaselineRecoveryMonitor> baseline_recovery_;
 };
 
 } // namespace workflows
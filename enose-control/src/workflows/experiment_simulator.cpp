@@ -0,0 +1,464 @@
+#include "experiment_simulator.hpp"
+#include "sweep_generator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace enose::workflows {
+
+namespace {
+
+// 循环增量比较的容差
+bool nearly_equal(double a, double b) {
+    return std::abs(a - b) <= 1e-6 * std::max({1.0, std::abs(a), std::abs(b)});
+}
+
+// 未设置超时 (<= 0) 时不截断
+double capped(double duration_s, double timeout_s) {
+    return timeout_s > 0 ? std::min(duration_s, timeout_s) : duration_s;
+}
+
+} // namespace
+
+void SimulationModel::apply(const SimulationCalibration& calibration) {
+    if (calibration.samples < MIN_CALIBRATION_SAMPLES) return;
+    calibration_samples = calibration.samples;
+
+    // 斜率偏离名义值太多说明样本混入了异常运行, 不采用
+    if (calibration.inject_slope > 0.2 && calibration.inject_slope < 5.0) {
+        inject_time_scale = calibration.inject_slope;
+        inject_overhead_s = std::clamp(calibration.inject_intercept_s, 0.0, 60.0);
+    }
+    if (calibration.drain_s_per_g > 0) {
+        drain_rate_g_s = 1.0 / calibration.drain_s_per_g;
+        drain_overhead_s = std::clamp(calibration.drain_intercept_s, 0.0, 60.0);
+    }
+    if (calibration.wait_empty_s > 0) {
+        empty_confirm_s = calibration.wait_empty_s;
+    }
+}
+
+SimulationResult ExperimentSimulator::run(const experiment::ExperimentProgram& program) {
+    program_ = &program;
+    result_ = SimulationResult{};
+    state_ = State::Initial;
+    volume_ml_ = 0;
+    weight_g_ = 0;
+    window_peak_g_ = 0;
+    window_peak_ml_ = 0;
+    rinse_pump_ = 0;
+    rinse_density_ = 1.0;
+    sweep_ = nullptr;
+    issue_keys_.clear();
+
+    for (const auto& liquid : program.hardware().liquids()) {
+        if (liquid.type() == experiment::LIQUID_RINSE) {
+            rinse_pump_ = liquid.pump_index();
+            if (liquid.density_g_ml() > 0) rinse_density_ = liquid.density_g_ml();
+            break;
+        }
+    }
+
+    run_steps(program.steps(), "steps");
+
+    result_.final_weight_g = weight_g_;
+    program_ = nullptr;
+    return std::move(result_);
+}
+
+void ExperimentSimulator::run_steps(
+    const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+    const std::string& path_prefix) {
+
+    for (int i = 0; i < steps.size(); ++i) {
+        run_step(steps[i], path_prefix + "[" + std::to_string(i) + "]");
+    }
+}
+
+void ExperimentSimulator::run_step(const experiment::Step& step, const std::string& path) {
+    if (step.action_case() != experiment::Step::kLoop && step.action_case() != experiment::Step::kSweep) {
+        ++result_.simulated_steps;
+        ++result_.expanded_steps;
+    }
+
+    switch (step.action_case()) {
+        case experiment::Step::kInject:
+            run_inject(step.inject());
+            break;
+
+        case experiment::Step::kWait:
+            run_wait(step.wait());
+            break;
+
+        case experiment::Step::kDrain:
+            run_drain(step.drain(), path + ".drain");
+            break;
+
+        case experiment::Step::kAcquire:
+            run_acquire(step.acquire());
+            break;
+
+        case experiment::Step::kWash:
+            run_wash(step.wash());
+            break;
+
+        case experiment::Step::kLoop:
+            run_loop(step.loop(), path + ".loop");
+            break;
+
+        case experiment::Step::kSweep:
+            run_sweep(step.sweep(), path + ".sweep");
+            break;
+
+        case experiment::Step::kSetState:
+            // 显式切换的状态一直保持到下一个会恢复 INITIAL 的动作
+            switch (step.set_state().state()) {
+                case experiment::STATE_DRAIN: state_ = State::Drain; break;
+                case experiment::STATE_CLEAN: state_ = State::Clean; break;
+                case experiment::STATE_SAMPLE: state_ = State::Sample; break;
+                case experiment::STATE_INJECT: state_ = State::Inject; break;
+                default: state_ = State::Initial; break;
+            }
+            break;
+
+        case experiment::Step::kSetGasPump:
+        case experiment::Step::kPhaseMarker:
+        case experiment::Step::ACTION_NOT_SET:
+            break;
+    }
+}
+
+void ExperimentSimulator::run_inject(const experiment::InjectAction& action) {
+    const double volume = inject_volume(action);
+
+    double weight = 0;
+    for (const auto& comp : action.components()) {
+        const double comp_volume = volume * component_ratio(comp);
+        weight += comp_volume * liquid_density(comp.liquid_id());
+        for (const auto& liquid : program_->hardware().liquids()) {
+            if (liquid.id() == comp.liquid_id()) {
+                result_.pump_consumption_ml[liquid.pump_index()] += comp_volume;
+                break;
+            }
+        }
+    }
+
+    // 等待滤波重量到达目标, 超时即结束 (泵仍会走完已下发的行程)
+    const double flow = action.flow_rate_ml_min();
+    const double nominal_s = flow > 0 ? volume / flow * 60 : 0;
+    const double fill_s = model_.inject_overhead_s + model_.inject_time_scale * nominal_s;
+    state_ = State::Inject;
+    advance(capped(fill_s, action.stable_timeout_s()));
+    add_liquid(volume, weight);
+    state_ = State::Initial;
+}
+
+void ExperimentSimulator::run_wait(const experiment::WaitAction& action) {
+    switch (action.condition_case()) {
+        case experiment::WaitAction::kDurationS:
+            advance(action.duration_s());
+            break;
+
+        case experiment::WaitAction::kHeaterCycles:
+            result_.heater_cycles += action.heater_cycles();
+            advance(capped(action.heater_cycles() * model_.heater_cycle_s, action.timeout_s()));
+            break;
+
+        case experiment::WaitAction::kStability:
+            advance(capped(action.stability().window_s(), action.timeout_s()));
+            break;
+
+        case experiment::WaitAction::kWeight: {
+            const double missing = action.weight().target_g() - action.weight().tolerance_g() - weight_g_;
+            if (missing <= 0) break;
+            if (state_ == State::Clean && model_.wash_fill_rate_g_s > 0) {
+                advance(capped(missing / model_.wash_fill_rate_g_s, action.timeout_s()));
+            } else {
+                advance(action.timeout_s());
+            }
+            break;
+        }
+
+        case experiment::WaitAction::kEmpty:
+            if (state_ == State::Drain) {
+                drain_until_empty(action.empty().stability_window_s(), action.timeout_s());
+            } else if (weight_g_ <= action.empty().tolerance_g()) {
+                advance(capped(std::max(action.empty().stability_window_s(), model_.empty_confirm_s),
+                               action.timeout_s()));
+            } else {
+                // 未排废时瓶子不会变空, 等到超时
+                advance(action.timeout_s());
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ExperimentSimulator::run_drain(const experiment::DrainAction& action, const std::string& path) {
+    if (weight_g_ <= action.empty_tolerance_g()) {
+        add_issue(path, "EMPTY_DRAIN", "排废时瓶中可能没有液体");
+    }
+    state_ = State::Drain;
+    drain_until_empty(action.stability_window_s(), action.timeout_s());
+    state_ = State::Initial;
+}
+
+void ExperimentSimulator::run_acquire(const experiment::AcquireAction& action) {
+    state_ = State::Sample;
+    switch (action.termination_case()) {
+        case experiment::AcquireAction::kDurationS:
+            advance(capped(action.duration_s(), action.max_duration_s()));
+            break;
+
+        case experiment::AcquireAction::kHeaterCycles:
+            result_.heater_cycles += action.heater_cycles();
+            advance(capped(action.heater_cycles() * model_.heater_cycle_s, action.max_duration_s()));
+            break;
+
+        case experiment::AcquireAction::kStability:
+            advance(capped(action.stability().window_s(), action.max_duration_s()));
+            break;
+
+        default:
+            advance(action.max_duration_s());
+            break;
+    }
+    state_ = State::Initial;
+}
+
+void ExperimentSimulator::run_wash(const experiment::WashAction& action) {
+    // 自适应清洗何时回到基线无法预知, 按最多次数和每次的恢复等待超时取上界
+    // (默认值与 workflows::wash_termination 一致)
+    const bool until_baseline = action.mode() == experiment::WASH_MODE_UNTIL_BASELINE;
+    const int min_cycles = std::max(action.repeat_count(), 1);
+    const int cycles = until_baseline
+        ? std::max(action.max_cycles() > 0 ? action.max_cycles() : 10, min_cycles) : action.repeat_count();
+    const double recovery_s = action.recovery_timeout_s() > 0 ? action.recovery_timeout_s() : 30.0;
+    for (int i = 0; i < cycles; ++i) {
+        // 排废确认空瓶 → 清洗泵注入到目标重量变化 → 排废
+        state_ = State::Drain;
+        drain_until_empty(action.empty_stability_window_s(), action.drain_timeout_s());
+
+        state_ = State::Clean;
+        const double rate = model_.wash_fill_rate_g_s;
+        const double fill_s = rate > 0 ? capped(action.target_weight_g() / rate, action.fill_timeout_s())
+                                       : action.fill_timeout_s();
+        advance(fill_s);
+
+        state_ = State::Drain;
+        drain_until_empty(action.empty_stability_window_s(), action.drain_timeout_s());
+
+        if (until_baseline && i + 1 >= min_cycles) {
+            advance(recovery_s);
+        }
+    }
+    state_ = State::Initial;
+}
+
+void ExperimentSimulator::run_loop(const experiment::LoopAction& action, const std::string& path) {
+    run_repeated(action.steps(), action.count(), path + ".steps");
+}
+
+void ExperimentSimulator::run_sweep(const experiment::SweepAction& action, const std::string& path) {
+    SweepGenerator sweep(action);
+    if (!sweep.error().empty()) {
+        add_issue(path, "INVALID_SWEEP", sweep.error());
+        return;
+    }
+    if (sweep_) {
+        add_issue(path, "NESTED_SWEEP", "不支持嵌套的参数扫描, 未计入资源预估");
+        return;
+    }
+
+    // 时长与液位不随比例变化, 各泵用量对比例是线性的: 按平均点模拟, 再按扫描点数外推
+    sweep_ = &sweep;
+    run_repeated(action.steps(), static_cast<int64_t>(sweep.size()), path + ".steps");
+    sweep_ = nullptr;
+}
+
+void ExperimentSimulator::run_repeated(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+                                       int64_t count, const std::string& body) {
+    if (count <= 0 || steps.size() == 0) return;
+
+    const double outer_peak_g = window_peak_g_;
+    const double outer_peak_ml = window_peak_ml_;
+
+    auto iterate = [&] {
+        window_peak_g_ = weight_g_;
+        window_peak_ml_ = volume_ml_;
+        run_steps(steps, body);
+    };
+
+    const Snapshot s0 = snapshot();
+    iterate();
+    double peak_g = window_peak_g_;
+    double peak_ml = window_peak_ml_;
+
+    if (count >= 2) {
+        const Snapshot s1 = snapshot();
+        iterate();
+        const Snapshot s2 = snapshot();
+        peak_g = std::max(peak_g, window_peak_g_);
+        peak_ml = std::max(peak_ml, window_peak_ml_);
+
+        const int64_t remaining = count - 2;
+        if (remaining > 0 && is_steady(s0, s1, s2)) {
+            const double offset_g = window_peak_g_ - s1.weight_g;
+            const double offset_ml = window_peak_ml_ - s1.volume_ml;
+            extrapolate(s1, s2, remaining, offset_g, offset_ml);
+            peak_g = std::max(peak_g, result_.peak_weight_g);
+            peak_ml = std::max(peak_ml, result_.peak_volume_ml);
+        } else {
+            for (int64_t i = 0; i < remaining; ++i) {
+                iterate();
+                peak_g = std::max(peak_g, window_peak_g_);
+                peak_ml = std::max(peak_ml, window_peak_ml_);
+            }
+        }
+    }
+
+    window_peak_g_ = std::max(outer_peak_g, peak_g);
+    window_peak_ml_ = std::max(outer_peak_ml, peak_ml);
+}
+
+void ExperimentSimulator::advance(double dt) {
+    if (dt <= 0) return;
+    result_.duration_s += dt;
+
+    switch (state_) {
+        case State::Drain:
+            if (weight_g_ > 0) {
+                const double remaining = std::max(0.0, weight_g_ - model_.drain_rate_g_s * dt);
+                volume_ml_ *= remaining / weight_g_;
+                weight_g_ = remaining;
+            }
+            break;
+
+        case State::Clean: {
+            const double weight = model_.wash_fill_rate_g_s * dt;
+            const double volume = weight / rinse_density_;
+            result_.pump_consumption_ml[rinse_pump_] += volume;
+            add_liquid(volume, weight);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+double ExperimentSimulator::drain_until_empty(double stability_window_s, double timeout_s) {
+    // 启动开销内不出液, 之后按排空速率减重; 排空后需稳定 stability_window_s 才确认空瓶
+    const double empty_s = weight_g_ > 0
+        ? model_.drain_overhead_s + weight_g_ / model_.drain_rate_g_s
+        : 0.0;
+    const double confirm_s = std::max(stability_window_s, model_.empty_confirm_s);
+    const double total_s = capped(empty_s + confirm_s, timeout_s);
+
+    result_.duration_s += total_s;
+    if (weight_g_ > 0) {
+        const double flowing_s = std::max(0.0, total_s - model_.drain_overhead_s);
+        const double remaining = std::max(0.0, weight_g_ - model_.drain_rate_g_s * flowing_s);
+        volume_ml_ *= remaining / weight_g_;
+        weight_g_ = remaining;
+    }
+    return total_s;
+}
+
+void ExperimentSimulator::add_liquid(double volume_ml, double weight_g) {
+    volume_ml_ += volume_ml;
+    weight_g_ += weight_g;
+    result_.peak_volume_ml = std::max(result_.peak_volume_ml, volume_ml_);
+    result_.peak_weight_g = std::max(result_.peak_weight_g, weight_g_);
+    window_peak_ml_ = std::max(window_peak_ml_, volume_ml_);
+    window_peak_g_ = std::max(window_peak_g_, weight_g_);
+}
+
+void ExperimentSimulator::add_issue(const std::string& path, const std::string& code,
+                                    const std::string& message) {
+    // 循环体内的步骤只报告一次
+    if (!issue_keys_.insert(path + "|" + code).second) return;
+    result_.issues.push_back({path, code, message});
+}
+
+ExperimentSimulator::Snapshot ExperimentSimulator::snapshot() const {
+    return {result_.duration_s, volume_ml_, weight_g_, result_.heater_cycles,
+            result_.expanded_steps, state_, result_.pump_consumption_ml};
+}
+
+bool ExperimentSimulator::is_steady(const Snapshot& s0, const Snapshot& s1, const Snapshot& s2) {
+    if (s1.state != s2.state || s0.state != s1.state) return false;
+    if (!nearly_equal(s1.time_s - s0.time_s, s2.time_s - s1.time_s)) return false;
+    if (!nearly_equal(s1.weight_g - s0.weight_g, s2.weight_g - s1.weight_g)) return false;
+    if (!nearly_equal(s1.volume_ml - s0.volume_ml, s2.volume_ml - s1.volume_ml)) return false;
+    if (s1.heater_cycles - s0.heater_cycles != s2.heater_cycles - s1.heater_cycles) return false;
+    // 排空截断在 0 时增量虽相等, 再外推会得到负液位
+    if (s2.weight_g - s1.weight_g < 0 && s2.weight_g > 0) return false;
+
+    for (const auto& [pump, total] : s2.pumps) {
+        auto at = [pump](const Snapshot& s) {
+            auto it = s.pumps.find(pump);
+            return it != s.pumps.end() ? it->second : 0.0;
+        };
+        if (!nearly_equal(at(s1) - at(s0), total - at(s1))) return false;
+    }
+    return true;
+}
+
+void ExperimentSimulator::extrapolate(const Snapshot& from, const Snapshot& to, int64_t iterations,
+                                      double peak_offset_g, double peak_offset_ml) {
+    const double dw = to.weight_g - from.weight_g;
+    const double dv = to.volume_ml - from.volume_ml;
+
+    result_.duration_s += (to.time_s - from.time_s) * iterations;
+    result_.heater_cycles += static_cast<int32_t>((to.heater_cycles - from.heater_cycles) * iterations);
+    result_.expanded_steps += (to.expanded_steps - from.expanded_steps) * iterations;
+    for (const auto& [pump, total] : to.pumps) {
+        auto it = from.pumps.find(pump);
+        const double prev = it != from.pumps.end() ? it->second : 0.0;
+        result_.pump_consumption_ml[pump] += (total - prev) * iterations;
+    }
+
+    // 液位线性变化, 峰值出现在外推的第一次或最后一次迭代
+    const double first_start_g = weight_g_;
+    const double first_start_ml = volume_ml_;
+    weight_g_ = std::max(0.0, weight_g_ + dw * iterations);
+    volume_ml_ = std::max(0.0, volume_ml_ + dv * iterations);
+    const double last_start_g = first_start_g + dw * (iterations - 1);
+    const double last_start_ml = first_start_ml + dv * (iterations - 1);
+
+    result_.peak_weight_g = std::max({result_.peak_weight_g,
+                                      first_start_g + peak_offset_g, last_start_g + peak_offset_g});
+    result_.peak_volume_ml = std::max({result_.peak_volume_ml,
+                                       first_start_ml + peak_offset_ml, last_start_ml + peak_offset_ml});
+}
+
+double ExperimentSimulator::liquid_density(const std::string& liquid_id) const {
+    for (const auto& liquid : program_->hardware().liquids()) {
+        if (liquid.id() == liquid_id) {
+            return liquid.density_g_ml() > 0 ? liquid.density_g_ml() : 1.0;
+        }
+    }
+    return 1.0;
+}
+
+double ExperimentSimulator::component_ratio(const experiment::LiquidComponent& component) const {
+    return sweep_ ? sweep_->mean_ratio(component) : component.ratio();
+}
+
+double ExperimentSimulator::inject_volume(const experiment::InjectAction& action) const {
+    if (action.has_target_volume_ml()) {
+        return action.target_volume_ml();
+    }
+    if (action.has_target_weight_g()) {
+        double density = 0;
+        for (const auto& comp : action.components()) {
+            density += liquid_density(comp.liquid_id()) * component_ratio(comp);
+        }
+        return action.target_weight_g() / (density > 0 ? density : 1.0);
+    }
+    return 0;
+}
+
+} // namespace enose::workflows
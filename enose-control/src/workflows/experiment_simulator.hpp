@@ -0,0 +1,157 @@
+#pragma once
+
+#include "enose_experiment.pb.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace enose::workflows {
+
+class SweepGenerator;
+
+/**
+ * @brief 历史测试结果的时长统计 (由 TestRunRepository::get_simulation_calibration 提供)
+ *
+ * 名义进样时长 = 最大泵行程 / 速度, 与实验进样 "体积 / 流速" 的换算一致.
+ */
+struct SimulationCalibration {
+    int samples = 0;
+    // 进样: 实测时长 ≈ inject_intercept_s + inject_slope × 名义时长
+    double inject_slope = 0;
+    double inject_intercept_s = 0;
+    // 排废: 实测时长 ≈ drain_intercept_s + drain_s_per_g × 瓶中重量
+    double drain_s_per_g = 0;
+    double drain_intercept_s = 0;
+    // 排空后确认空瓶的平均时长
+    double wait_empty_s = 0;
+};
+
+/**
+ * @brief 模拟器使用的硬件动态模型
+ *
+ * 默认值为未标定时的保守估计; apply() 用历史数据覆盖可信的部分,
+ * 加热周期时长由调用方按实测周期 (HeaterCycleTracker) 设置.
+ */
+struct SimulationModel {
+    static constexpr double DEFAULT_HEATER_CYCLE_S = 26.0;
+    static constexpr int MIN_CALIBRATION_SAMPLES = 5;
+
+    double heater_cycle_s = DEFAULT_HEATER_CYCLE_S;
+    double inject_time_scale = 1.0;         // 实际进样时长 / 名义时长
+    double inject_overhead_s = 2.0;         // 泵启动与称重滤波滞后
+    double drain_rate_g_s = 5.0;
+    double drain_overhead_s = 2.0;
+    double empty_confirm_s = 0;             // 空瓶确认的下限 (不小于稳定窗口)
+    double wash_fill_rate_g_s = 2.0;        // 清洗泵
+    int calibration_samples = 0;            // 0 = 未标定
+
+    /** @brief 样本不足或统计值不合理的部分保持原值 */
+    void apply(const SimulationCalibration& calibration);
+
+    bool operator==(const SimulationModel&) const = default;
+};
+
+/** @brief 模拟中发现的问题 (由验证器转为警告) */
+struct SimulationIssue {
+    std::string path;
+    std::string code;
+    std::string message;
+};
+
+struct SimulationResult {
+    std::map<int32_t, double> pump_consumption_ml;
+    double duration_s = 0;
+    double peak_volume_ml = 0;
+    double peak_weight_g = 0;
+    double final_weight_g = 0;
+    int32_t heater_cycles = 0;
+    uint64_t simulated_steps = 0;       // 实际模拟的步骤数
+    uint64_t expanded_steps = 0;        // 展开循环后的步骤数 (含外推的迭代)
+    std::vector<SimulationIssue> issues;
+};
+
+/**
+ * @brief 实验程序的离散事件模拟器
+ *
+ * 按执行顺序推进模拟时钟, 跟踪系统状态、瓶中液体 (体积与重量) 和每个泵的消耗:
+ * 进样按流速与标定的时长模型注入, 排废 / DRAIN 状态按排空速率减重,
+ * CLEAN 状态按清洗泵速率注入, 等待类条件按当前液位判定是立即满足、按动态到达还是超时.
+ *
+ * 循环先模拟两次迭代; 若第二次迭代与第一次的状态增量一致 (稳态循环, 例如每轮都排空),
+ * 剩余迭代按增量外推而不逐步模拟, 因此展开后数千步的程序也只需模拟循环体两遍.
+ * 参数扫描按同样的方式处理, 模板中的扫描成分取全部扫描点上的平均比例 (泵用量对比例是线性的).
+ */
+class ExperimentSimulator {
+public:
+    explicit ExperimentSimulator(SimulationModel model = {}) : model_(model) {}
+
+    SimulationResult run(const experiment::ExperimentProgram& program);
+
+    const SimulationModel& model() const { return model_; }
+
+private:
+    enum class State { Initial, Drain, Clean, Sample, Inject };
+
+    // 循环外推用的状态快照
+    struct Snapshot {
+        double time_s;
+        double volume_ml;
+        double weight_g;
+        int32_t heater_cycles;
+        uint64_t expanded_steps;
+        State state;
+        std::map<int32_t, double> pumps;
+    };
+
+    void run_steps(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+                   const std::string& path_prefix);
+    void run_step(const experiment::Step& step, const std::string& path);
+
+    void run_inject(const experiment::InjectAction& action);
+    void run_wait(const experiment::WaitAction& action);
+    void run_drain(const experiment::DrainAction& action, const std::string& path);
+    void run_acquire(const experiment::AcquireAction& action);
+    void run_wash(const experiment::WashAction& action);
+    void run_loop(const experiment::LoopAction& action, const std::string& path);
+    void run_sweep(const experiment::SweepAction& action, const std::string& path);
+    // 循环体执行 count 次 (稳态时外推)
+    void run_repeated(const google::protobuf::RepeatedPtrField<experiment::Step>& steps, int64_t count,
+                      const std::string& body);
+
+    // 按当前状态推进时钟 (DRAIN 排空, CLEAN 注入清洗液)
+    void advance(double dt);
+    // 持续排空直到空瓶确认或超时, 返回耗时
+    double drain_until_empty(double stability_window_s, double timeout_s);
+    void add_liquid(double volume_ml, double weight_g);
+    void add_issue(const std::string& path, const std::string& code, const std::string& message);
+
+    Snapshot snapshot() const;
+    static bool is_steady(const Snapshot& s0, const Snapshot& s1, const Snapshot& s2);
+    // 按 from → to 的增量外推 iterations 次迭代; peak_offset_* 为一次迭代内峰值相对起点的偏移
+    void extrapolate(const Snapshot& from, const Snapshot& to, int64_t iterations,
+                     double peak_offset_g, double peak_offset_ml);
+
+    double liquid_density(const std::string& liquid_id) const;
+    double inject_volume(const experiment::InjectAction& action) const;
+    // 扫描模板内按平均点取比例
+    double component_ratio(const experiment::LiquidComponent& component) const;
+
+    SimulationModel model_;
+
+    // 单次 run() 的状态
+    const experiment::ExperimentProgram* program_ = nullptr;
+    SimulationResult result_;
+    State state_ = State::Initial;
+    double volume_ml_ = 0;
+    double weight_g_ = 0;
+    double window_peak_g_ = 0;          // 当前循环迭代内的峰值 (外推峰值用)
+    double window_peak_ml_ = 0;
+    int32_t rinse_pump_ = 0;
+    double rinse_density_ = 1.0;
+    const SweepGenerator* sweep_ = nullptr;     // 正在模拟的扫描 (模板内)
+    std::set<std::string> issue_keys_;
+};
+
+} // namespace enose::workflows
@@ -1,7 +1,10 @@
 #include "experiment_validator.hpp"
+#include "sweep_generator.hpp"
 #include <spdlog/spdlog.h>
 #include <algorithm>
 #include <cmath>
+#include <future>
+#include <thread>
 
 namespace enose::workflows {
 
@@ -18,43 +21,43 @@ ValidationResultInfo ExperimentValidator::validate(const experiment::ExperimentP
     validate_hardware_constraints();
     
     // 验证步骤
-    validate_steps(program.steps(), "steps");
+    validate_steps(program.steps());
+    
+    // 模拟执行, 得到资源消耗
+    simulation_ = ExperimentSimulator(model_).run(program);
+    for (const auto& issue : simulation_.issues) {
+        findings_.add_warning(issue.path, issue.code, issue.message);
+    }
     
     // 安全检查
+    ValidationResultInfo result;
     check_overflow_risk();
-    check_empty_aspiration_risk();
-    check_liquid_sufficiency();
+    account_liquids(result.estimate.liquid_consumption);
+    
+    // 并行段的结果合并后统一输出, 日志顺序与步骤顺序一致
+    for (const auto& err : findings_.errors) {
+        spdlog::error("[验证错误] {} - {}: {}", err.path, err.code, err.message);
+    }
+    for (const auto& warn : findings_.warnings) {
+        spdlog::warn("[验证警告] {} - {}: {}", warn.path, warn.code, warn.message);
+    }
     
     // 构建结果
-    ValidationResultInfo result;
-    result.valid = errors_.empty();
-    result.errors = std::move(errors_);
-    result.warnings = std::move(warnings_);
+    result.valid = findings_.errors.empty();
+    result.errors = std::move(findings_.errors);
+    result.warnings = std::move(findings_.warnings);
     
     // 资源预估
-    result.estimate.pump_consumption_ml = pump_totals_;
-    result.estimate.peak_liquid_level_ml = peak_liquid_level_;
-    result.estimate.estimated_duration_s = total_duration_;
-    result.estimate.heater_cycles = total_heater_cycles_;
+    result.estimate.pump_consumption_ml = simulation_.pump_consumption_ml;
+    result.estimate.peak_liquid_level_ml = simulation_.peak_volume_ml;
+    result.estimate.peak_bottle_weight_g = simulation_.peak_weight_g;
+    result.estimate.estimated_duration_s = simulation_.duration_s;
+    result.estimate.heater_cycles = simulation_.heater_cycles;
     
-    // 液体消耗详情
-    for (const auto& [liquid_id, inventory] : liquid_map_) {
-        LiquidConsumptionInfo info;
-        info.liquid_id = liquid_id;
-        info.liquid_name = inventory->name();
-        info.pump_index = inventory->pump_index();
-        info.available_ml = inventory->available_ml();
-        
-        // 计算该液体的消耗量 (从泵消耗中提取)
-        auto it = pump_totals_.find(inventory->pump_index());
-        info.required_ml = (it != pump_totals_.end()) ? it->second : 0.0;
-        info.sufficient = info.required_ml <= info.available_ml;
-        
-        result.estimate.liquid_consumption.push_back(info);
-    }
-    
-    spdlog::info("验证完成: valid={}, errors={}, warnings={}", 
-                 result.valid, result.errors.size(), result.warnings.size());
+    spdlog::info("验证完成: valid={}, errors={}, warnings={}, 预计 {:.0f}s ({} 步, 模拟 {} 步, 模型样本 {})", 
+                 result.valid, result.errors.size(), result.warnings.size(),
+                 simulation_.duration_s, simulation_.expanded_steps, simulation_.simulated_steps,
+                 model_.calibration_samples);
     
     return result;
 }
@@ -87,6 +90,7 @@ experiment::ValidationResult ExperimentValidator::to_proto(const ValidationResul
         (*est->mutable_pump_consumption_ml())[pump] = consumption;
     }
     est->set_peak_liquid_level_ml(result.estimate.peak_liquid_level_ml);
+    est->set_peak_bottle_weight_g(result.estimate.peak_bottle_weight_g);
     est->set_estimated_duration_s(result.estimate.estimated_duration_s);
     est->set_heater_cycles(result.estimate.heater_cycles);
     
@@ -106,14 +110,9 @@ experiment::ValidationResult ExperimentValidator::to_proto(const ValidationResul
 
 void ExperimentValidator::reset() {
     program_ = nullptr;
-    errors_.clear();
-    warnings_.clear();
+    findings_ = Findings{};
     liquid_map_.clear();
-    pump_totals_.clear();
-    current_liquid_level_ = 0;
-    peak_liquid_level_ = 0;
-    total_duration_ = 0;
-    total_heater_cycles_ = 0;
+    simulation_ = SimulationResult{};
 }
 
 void ExperimentValidator::build_liquid_map() {
@@ -122,7 +121,7 @@ void ExperimentValidator::build_liquid_map() {
     const auto& hw = program_->hardware();
     for (const auto& liquid : hw.liquids()) {
         if (liquid_map_.count(liquid.id())) {
-            add_error("hardware.liquids", "DUPLICATE_LIQUID_ID",
+            findings_.add_error("hardware.liquids", "DUPLICATE_LIQUID_ID",
                      "重复的液体ID: " + liquid.id());
         } else {
             liquid_map_[liquid.id()] = &liquid;
@@ -132,7 +131,7 @@ void ExperimentValidator::build_liquid_map() {
 
 void ExperimentValidator::validate_hardware_constraints() {
     if (!program_->has_hardware()) {
-        add_error("hardware", "MISSING_HARDWARE", "缺少硬件约束定义");
+        findings_.add_error("hardware", "MISSING_HARDWARE", "缺少硬件约束定义");
         return;
     }
     
@@ -148,7 +147,7 @@ void ExperimentValidator::validate_hardware_constraints() {
     }
     
     if (!has_rinse) {
-        add_warning("hardware.liquids", "NO_RINSE_LIQUID", 
+        findings_.add_warning("hardware.liquids", "NO_RINSE_LIQUID", 
                    "未定义清洗液，清洗步骤可能无法执行");
     }
     
@@ -157,7 +156,7 @@ void ExperimentValidator::validate_hardware_constraints() {
     for (const auto& liquid : hw.liquids()) {
         auto it = pump_to_liquid.find(liquid.pump_index());
         if (it != pump_to_liquid.end()) {
-            add_error("hardware.liquids", "DUPLICATE_PUMP_INDEX",
+            findings_.add_error("hardware.liquids", "DUPLICATE_PUMP_INDEX",
                      "泵" + std::to_string(liquid.pump_index()) + 
                      "被多个液体使用: " + it->second + ", " + liquid.id());
         } else {
@@ -167,41 +166,90 @@ void ExperimentValidator::validate_hardware_constraints() {
 }
 
 void ExperimentValidator::validate_steps(
+    const google::protobuf::RepeatedPtrField<experiment::Step>& steps) {
+    
+    std::vector<FlatStep> flat;
+    flatten_steps(steps, "steps", false, flat);
+    if (flat.empty()) return;
+    
+    const FlatStep* first = flat.data();
+    const FlatStep* last = first + flat.size();
+    
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t segments = std::min(hardware, flat.size() / PARALLEL_MIN_STEPS);
+    if (segments <= 1) {
+        findings_.append(validate_range(first, last));
+        return;
+    }
+    
+    // 第一段在当前线程检查, 其余段各开一个线程
+    const std::size_t per_segment = (flat.size() + segments - 1) / segments;
+    std::vector<std::future<Findings>> pending;
+    pending.reserve(segments - 1);
+    for (const FlatStep* begin = first + per_segment; begin < last; begin += per_segment) {
+        const FlatStep* end = std::min(begin + per_segment, last);
+        pending.push_back(std::async(std::launch::async, &ExperimentValidator::validate_range, this, begin, end));
+    }
+    
+    findings_.append(validate_range(first, std::min(first + per_segment, last)));
+    for (auto& segment : pending) {
+        findings_.append(segment.get());
+    }
+}
+
+void ExperimentValidator::flatten_steps(
     const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
-    const std::string& path_prefix) {
+    const std::string& path_prefix, bool in_sweep, std::vector<FlatStep>& out) {
     
     for (int i = 0; i < steps.size(); ++i) {
         std::string path = path_prefix + "[" + std::to_string(i) + "]";
-        validate_step(steps[i], path);
+        const auto& step = steps[i];
+        out.push_back({&step, path, in_sweep});
+        
+        // 循环体 / 扫描模板只验证一次, 按次数或扫描点展开的资源消耗由模拟器计算
+        if (step.has_loop()) {
+            flatten_steps(step.loop().steps(), path + ".loop.steps", in_sweep, out);
+        } else if (step.has_sweep()) {
+            flatten_steps(step.sweep().steps(), path + ".sweep.steps", true, out);
+        }
     }
 }
 
-void ExperimentValidator::validate_step(const experiment::Step& step, const std::string& path) {
+ExperimentValidator::Findings ExperimentValidator::validate_range(const FlatStep* begin,
+                                                                   const FlatStep* end) const {
+    Findings findings;
+    for (const FlatStep* it = begin; it != end; ++it) {
+        validate_step(*it->step, it->path, findings);
+        if (it->in_sweep && it->step->has_sweep()) {
+            findings.add_error(it->path + ".sweep", "NESTED_SWEEP", "不支持嵌套的参数扫描");
+        }
+    }
+    return findings;
+}
+
+void ExperimentValidator::validate_step(const experiment::Step& step, const std::string& path,
+                                        Findings& out) const {
     // 检查步骤名称
     if (step.name().empty()) {
-        add_warning(path + ".name", "EMPTY_STEP_NAME", "步骤名称为空");
+        out.add_warning(path + ".name", "EMPTY_STEP_NAME", "步骤名称为空");
     }
     
     // 根据动作类型验证
     switch (step.action_case()) {
         case experiment::Step::kInject:
-            validate_inject_action(step.inject(), path + ".inject");
-            calculate_inject_resources(step.inject());
+            validate_inject_action(step.inject(), path + ".inject", out);
             break;
             
         case experiment::Step::kWait:
-            validate_wait_action(step.wait(), path + ".wait");
-            calculate_wait_resources(step.wait());
+            validate_wait_action(step.wait(), path + ".wait", out);
             break;
             
         case experiment::Step::kDrain:
-            validate_drain_action(step.drain(), path + ".drain");
-            calculate_drain_resources(step.drain());
+            // 空瓶排废由模拟器按液位判定
             break;
             
         case experiment::Step::kAcquire:
-            validate_acquire_action(step.acquire(), path + ".acquire");
-            calculate_acquire_resources(step.acquire());
+            validate_acquire_action(step.acquire(), path + ".acquire", out);
             break;
             
         case experiment::Step::kSetState:
@@ -213,208 +261,150 @@ void ExperimentValidator::validate_step(const experiment::Step& step, const std:
             break;
             
         case experiment::Step::kLoop:
-            validate_loop_action(step.loop(), path + ".loop");
+            // 循环体已在展开时加入列表
+            validate_loop_action(step.loop(), path + ".loop", out);
             break;
             
         case experiment::Step::kPhaseMarker:
             // PhaseMarker 动作无需额外验证
             break;
             
+        case experiment::Step::kWash:
+            // Wash 字段范围由 protovalidate 约束, 耗时与清洗液用量由模拟器计算
+            break;
+            
+        case experiment::Step::kSweep:
+            // 模板已在展开时加入列表
+            validate_sweep_action(step.sweep(), path + ".sweep", out);
+            break;
+            
         case experiment::Step::ACTION_NOT_SET:
-            add_error(path, "NO_ACTION", "步骤未指定动作");
+            out.add_error(path, "NO_ACTION", "步骤未指定动作");
             break;
     }
 }
 
 void ExperimentValidator::validate_inject_action(
-    const experiment::InjectAction& action, const std::string& path) {
+    const experiment::InjectAction& action, const std::string& path, Findings& out) const {
     
     // 检查液体引用
     for (int i = 0; i < action.components_size(); ++i) {
         const auto& comp = action.components(i);
-        std::string comp_path = path + ".components[" + std::to_string(i) + "]";
         
         const auto* liquid = find_liquid(comp.liquid_id());
         if (!liquid) {
-            add_error(comp_path + ".liquid_id", "UNKNOWN_LIQUID",
-                     "未知的液体ID: " + comp.liquid_id());
+            out.add_error(path + ".components[" + std::to_string(i) + "].liquid_id", "UNKNOWN_LIQUID",
+                          "未知的液体ID: " + comp.liquid_id());
         }
     }
     
     // 检查目标量
     if (!action.has_target_volume_ml() && !action.has_target_weight_g()) {
-        add_error(path, "NO_TARGET", "进样动作未指定目标量");
+        out.add_error(path, "NO_TARGET", "进样动作未指定目标量");
     }
     
     // 检查容差合理性
     double target = get_inject_volume(action);
     if (action.tolerance() > target * 0.5) {
-        add_warning(path + ".tolerance", "LARGE_TOLERANCE",
-                   "容差过大，可能影响实验精度");
+        out.add_warning(path + ".tolerance", "LARGE_TOLERANCE",
+                        "容差过大，可能影响实验精度");
     }
 }
 
 void ExperimentValidator::validate_wait_action(
-    const experiment::WaitAction& action, const std::string& path) {
+    const experiment::WaitAction& action, const std::string& path, Findings& out) {
     
     // 检查是否指定了条件
     if (action.condition_case() == experiment::WaitAction::CONDITION_NOT_SET) {
-        add_error(path, "NO_CONDITION", "等待动作未指定条件");
+        out.add_error(path, "NO_CONDITION", "等待动作未指定条件");
     }
     
     // 检查超时设置
     if (action.timeout_s() <= 0) {
-        add_warning(path + ".timeout_s", "NO_TIMEOUT", "未设置超时，可能导致无限等待");
-    }
-}
-
-void ExperimentValidator::validate_drain_action(
-    const experiment::DrainAction& action, const std::string& path) {
-    
-    // 检查当前是否有液体可排
-    if (current_liquid_level_ <= 0) {
-        add_warning(path, "EMPTY_DRAIN", "排废时瓶中可能没有液体");
+        out.add_warning(path + ".timeout_s", "NO_TIMEOUT", "未设置超时，可能导致无限等待");
     }
 }
 
 void ExperimentValidator::validate_acquire_action(
-    const experiment::AcquireAction& action, const std::string& path) {
+    const experiment::AcquireAction& action, const std::string& path, Findings& out) {
     
     // 检查终止条件
     if (action.termination_case() == experiment::AcquireAction::TERMINATION_NOT_SET) {
-        add_error(path, "NO_TERMINATION", "采集动作未指定终止条件");
+        out.add_error(path, "NO_TERMINATION", "采集动作未指定终止条件");
     }
     
     // 检查最大时间
     if (action.max_duration_s() <= 0) {
-        add_warning(path + ".max_duration_s", "NO_MAX_DURATION", 
-                   "未设置最大时间，可能导致长时间运行");
+        out.add_warning(path + ".max_duration_s", "NO_MAX_DURATION", 
+                        "未设置最大时间，可能导致长时间运行");
     }
 }
 
 void ExperimentValidator::validate_loop_action(
-    const experiment::LoopAction& action, const std::string& path) {
+    const experiment::LoopAction& action, const std::string& path, Findings& out) {
     
     // 验证循环体
     if (action.steps_size() == 0) {
-        add_error(path + ".steps", "EMPTY_LOOP", "循环体为空");
-        return;
-    }
-    
-    // 模拟执行循环以计算资源
-    // 注意: 这里只验证一次，但资源计算需要乘以循环次数
-    double saved_level = current_liquid_level_;
-    double saved_duration = total_duration_;
-    int32_t saved_cycles = total_heater_cycles_;
-    std::map<int32_t, double> saved_pump_totals = pump_totals_;
-    
-    // 验证一次循环
-    validate_steps(action.steps(), path + ".steps");
-    
-    // 计算单次循环的资源增量
-    double level_delta = current_liquid_level_ - saved_level;
-    double duration_delta = total_duration_ - saved_duration;
-    int32_t cycles_delta = total_heater_cycles_ - saved_cycles;
-    
-    std::map<int32_t, double> pump_delta;
-    for (const auto& [pump, total] : pump_totals_) {
-        auto it = saved_pump_totals.find(pump);
-        double prev = (it != saved_pump_totals.end()) ? it->second : 0.0;
-        pump_delta[pump] = total - prev;
-    }
-    
-    // 应用循环次数
-    int count = action.count();
-    current_liquid_level_ = saved_level + level_delta * count;
-    total_duration_ = saved_duration + duration_delta * count;
-    total_heater_cycles_ = saved_cycles + cycles_delta * count;
-    
-    for (const auto& [pump, delta] : pump_delta) {
-        pump_totals_[pump] = saved_pump_totals[pump] + delta * count;
+        out.add_error(path + ".steps", "EMPTY_LOOP", "循环体为空");
     }
-    
-    // 更新峰值
-    peak_liquid_level_ = std::max(peak_liquid_level_, current_liquid_level_);
 }
 
-void ExperimentValidator::calculate_inject_resources(const experiment::InjectAction& action) {
-    double volume = get_inject_volume(action);
+void ExperimentValidator::validate_sweep_action(
+    const experiment::SweepAction& action, const std::string& path, Findings& out) const {
     
-    // 累加每个泵的消耗
-    for (const auto& comp : action.components()) {
-        const auto* liquid = find_liquid(comp.liquid_id());
-        if (liquid) {
-            double comp_volume = volume * comp.ratio();
-            pump_totals_[liquid->pump_index()] += comp_volume;
-        }
+    // 不枚举扫描点: 只检查取值规则本身和各变量的取值上界
+    SweepGenerator sweep(action);
+    if (!sweep.error().empty()) {
+        out.add_error(path, "INVALID_SWEEP", sweep.error());
+        return;
     }
     
-    // 更新液位
-    current_liquid_level_ += volume;
-    peak_liquid_level_ = std::max(peak_liquid_level_, current_liquid_level_);
-    
-    // 估算时间: 体积 / 流速 + 稳定时间
-    double flow_rate = action.flow_rate_ml_min();
-    if (flow_rate > 0) {
-        total_duration_ += (volume / flow_rate) * 60;  // 转换为秒
+    for (int i = 0; i < action.variables_size(); ++i) {
+        const auto& var = action.variables(i);
+        const std::string var_path = path + ".variables[" + std::to_string(i) + "]";
+        if (!find_liquid(var.liquid_id())) {
+            out.add_error(var_path + ".liquid_id", "UNKNOWN_LIQUID", "未知的液体ID: " + var.liquid_id());
+        }
+        for (double value : var.values()) {
+            if (value < 0 || value > 1) {
+                out.add_error(var_path + ".values", "INVALID_SWEEP", "扫描取值必须在 0-1 之间");
+                break;
+            }
+        }
+        
+        // 变量须出现在模板的进样成分中, 否则扫描不改变任何步骤
+        bool used = false;
+        std::vector<const google::protobuf::RepeatedPtrField<experiment::Step>*> pending{&action.steps()};
+        while (!pending.empty() && !used) {
+            const auto* steps = pending.back();
+            pending.pop_back();
+            for (const auto& step : *steps) {
+                if (step.has_loop()) pending.push_back(&step.loop().steps());
+                if (!step.has_inject()) continue;
+                for (const auto& comp : step.inject().components()) {
+                    used = used || comp.liquid_id() == var.liquid_id();
+                }
+            }
+        }
+        if (!used) {
+            out.add_warning(var_path, "SWEEP_UNUSED_VARIABLE",
+                            "扫描变量 " + var.liquid_id() + " 未出现在模板的进样成分中");
+        }
     }
-    total_duration_ += action.stable_timeout_s();
-}
-
-void ExperimentValidator::calculate_drain_resources(const experiment::DrainAction& action) {
-    // 排废后液位清零
-    current_liquid_level_ = 0;
     
-    // 估算时间
-    total_duration_ += action.timeout_s();
-}
-
-void ExperimentValidator::calculate_wait_resources(const experiment::WaitAction& action) {
-    switch (action.condition_case()) {
-        case experiment::WaitAction::kDurationS:
-            total_duration_ += action.duration_s();
-            break;
-            
-        case experiment::WaitAction::kHeaterCycles:
-            total_heater_cycles_ += action.heater_cycles();
-            // 假设每个加热周期约 2-3 秒
-            total_duration_ += action.heater_cycles() * 2.5;
-            break;
-            
-        case experiment::WaitAction::kStability:
-            total_duration_ += action.stability().window_s();
-            break;
-            
-        case experiment::WaitAction::kWeight:
-        case experiment::WaitAction::kEmpty:
-            // 使用超时作为估算
-            total_duration_ += action.timeout_s() * 0.5;  // 假设平均等待一半时间
-            break;
-            
-        default:
-            break;
-    }
-}
-
-void ExperimentValidator::calculate_acquire_resources(const experiment::AcquireAction& action) {
-    switch (action.termination_case()) {
-        case experiment::AcquireAction::kDurationS:
-            total_duration_ += action.duration_s();
-            break;
-            
-        case experiment::AcquireAction::kHeaterCycles:
-            total_heater_cycles_ += action.heater_cycles();
-            total_duration_ += action.heater_cycles() * 2.5;
-            break;
-            
-        case experiment::AcquireAction::kStability:
-            total_duration_ += action.stability().window_s();
-            break;
-            
-        default:
-            // 使用最大时间
-            total_duration_ += action.max_duration_s();
-            break;
+    if (!action.balance_liquid_id().empty()) {
+        if (!find_liquid(action.balance_liquid_id())) {
+            out.add_error(path + ".balance_liquid_id", "UNKNOWN_LIQUID",
+                          "未知的液体ID: " + action.balance_liquid_id());
+        }
+        
+        // 各变量同时取上界时补足成分仍须为正
+        double max_sum = 0;
+        for (std::size_t v = 0; v < sweep.variable_count(); ++v) max_sum += sweep.max(v);
+        if (max_sum >= 1.0) {
+            out.add_error(path, "SWEEP_RATIO_OVERFLOW",
+                          "扫描变量比例之和可达 " + std::to_string(max_sum) + ", 补足成分比例将不为正");
+        }
     }
 }
 
@@ -425,67 +415,71 @@ void ExperimentValidator::check_overflow_risk() {
     double max_fill = hw.max_fill_ml();
     double capacity = hw.bottle_capacity_ml();
     
-    if (peak_liquid_level_ > max_fill) {
-        add_error("", "OVERFLOW_RISK",
-                 "峰值液位(" + std::to_string(peak_liquid_level_) + 
+    if (simulation_.peak_volume_ml > max_fill) {
+        findings_.add_error("", "OVERFLOW_RISK",
+                 "峰值液位(" + std::to_string(simulation_.peak_volume_ml) + 
                  " ml)超过最大液位(" + std::to_string(max_fill) + " ml)，有溢出风险");
-    } else if (peak_liquid_level_ > max_fill * 0.9) {
-        add_warning("", "HIGH_FILL_LEVEL",
+    } else if (simulation_.peak_volume_ml > max_fill * 0.9) {
+        findings_.add_warning("", "HIGH_FILL_LEVEL",
                    "峰值液位接近最大液位，建议预留更多余量");
     }
     
-    if (peak_liquid_level_ > capacity) {
-        add_error("", "CAPACITY_EXCEEDED",
+    if (simulation_.peak_volume_ml > capacity) {
+        findings_.add_error("", "CAPACITY_EXCEEDED",
                  "峰值液位超过瓶子容量(" + std::to_string(capacity) + " ml)");
     }
 }
 
-void ExperimentValidator::check_empty_aspiration_risk() {
-    // 检查每个液体的消耗是否超过可用量的90%
+void ExperimentValidator::account_liquids(std::vector<LiquidConsumptionInfo>& consumption) {
+    consumption.reserve(liquid_map_.size());
+    
     for (const auto& [liquid_id, inventory] : liquid_map_) {
-        auto it = pump_totals_.find(inventory->pump_index());
-        if (it == pump_totals_.end()) continue;
+        LiquidConsumptionInfo info;
+        info.liquid_id = liquid_id;
+        info.liquid_name = inventory->name();
+        info.pump_index = inventory->pump_index();
+        info.available_ml = inventory->available_ml();
         
-        double required = it->second;
-        double available = inventory->available_ml();
+        // 计算该液体的消耗量 (从泵消耗中提取)
+        auto it = simulation_.pump_consumption_ml.find(inventory->pump_index());
+        const bool used = it != simulation_.pump_consumption_ml.end();
+        info.required_ml = used ? it->second : 0.0;
+        info.sufficient = info.required_ml <= info.available_ml;
+        consumption.push_back(info);
         
-        if (required > available * 0.9 && required <= available) {
-            add_warning("hardware.liquids", "LOW_LIQUID_MARGIN",
-                       "液体 " + liquid_id + " 余量不足10%，建议补充或减少用量");
+        if (!used) continue;
+        
+        if (!info.sufficient) {
+            findings_.add_error("hardware.liquids", "INSUFFICIENT_LIQUID",
+                               "液体 " + liquid_id + " 不足: 需要 " + 
+                               std::to_string(info.required_ml) + " ml，仅有 " + 
+                               std::to_string(info.available_ml) + " ml");
+        } else if (info.required_ml > info.available_ml * 0.9) {
+            // 消耗超过可用量的 90%
+            findings_.add_warning("hardware.liquids", "LOW_LIQUID_MARGIN",
+                                 "液体 " + liquid_id + " 余量不足10%，建议补充或减少用量");
         }
     }
 }
 
-void ExperimentValidator::check_liquid_sufficiency() {
-    for (const auto& [liquid_id, inventory] : liquid_map_) {
-        auto it = pump_totals_.find(inventory->pump_index());
-        if (it == pump_totals_.end()) continue;
-        
-        double required = it->second;
-        double available = inventory->available_ml();
-        
-        if (required > available) {
-            add_error("hardware.liquids", "INSUFFICIENT_LIQUID",
-                     "液体 " + liquid_id + " 不足: 需要 " + 
-                     std::to_string(required) + " ml，仅有 " + 
-                     std::to_string(available) + " ml");
-        }
-    }
+void ExperimentValidator::Findings::add_error(const std::string& path, const std::string& code, 
+                                              const std::string& message) {
+    errors.push_back({path, code, message, ValidationErrorInfo::Severity::ERROR});
 }
 
-void ExperimentValidator::add_error(const std::string& path, const std::string& code, 
-                                    const std::string& message) {
-    errors_.push_back({path, code, message, ValidationErrorInfo::Severity::ERROR});
-    spdlog::error("[验证错误] {} - {}: {}", path, code, message);
+void ExperimentValidator::Findings::add_warning(const std::string& path, const std::string& code, 
+                                                const std::string& message) {
+    warnings.push_back({path, code, message, ValidationErrorInfo::Severity::WARNING});
 }
 
-void ExperimentValidator::add_warning(const std::string& path, const std::string& code, 
-                                      const std::string& message) {
-    warnings_.push_back({path, code, message, ValidationErrorInfo::Severity::WARNING});
-    spdlog::warn("[验证警告] {} - {}: {}", path, code, message);
+void ExperimentValidator::Findings::append(Findings&& other) {
+    errors.insert(errors.end(), std::make_move_iterator(other.errors.begin()),
+                  std::make_move_iterator(other.errors.end()));
+    warnings.insert(warnings.end(), std::make_move_iterator(other.warnings.begin()),
+                    std::make_move_iterator(other.warnings.end()));
 }
 
-double ExperimentValidator::get_inject_volume(const experiment::InjectAction& action) {
+double ExperimentValidator::get_inject_volume(const experiment::InjectAction& action) const {
     if (action.has_target_volume_ml()) {
         return action.target_volume_ml();
     } else if (action.has_target_weight_g()) {
@@ -505,7 +499,7 @@ double ExperimentValidator::get_inject_volume(const experiment::InjectAction& ac
     return 0;
 }
 
-const experiment::LiquidInventory* ExperimentValidator::find_liquid(const std::string& liquid_id) {
+const experiment::LiquidInventory* ExperimentValidator::find_liquid(const std::string& liquid_id) const {
     auto it = liquid_map_.find(liquid_id);
     return (it != liquid_map_.end()) ? it->second : nullptr;
 }
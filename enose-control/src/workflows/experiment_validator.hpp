@@ -1,6 +1,8 @@
 #pragma once
 
 #include "enose_experiment.pb.h"
+#include "experiment_simulator.hpp"
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <map>
@@ -30,6 +32,7 @@ struct LiquidConsumptionInfo {
 struct ResourceEstimateInfo {
     std::map<int32_t, double> pump_consumption_ml;  // 每个泵的消耗量
     double peak_liquid_level_ml;                     // 峰值液位
+    double peak_bottle_weight_g;                     // 峰值瓶中重量
     double estimated_duration_s;                     // 预计时长
     int32_t heater_cycles;                          // 加热器循环数
     std::vector<LiquidConsumptionInfo> liquid_consumption;
@@ -54,10 +57,23 @@ struct ValidationResultInfo {
  *   - 资源消耗计算
  *   - 物理约束检查
  *   - 安全约束检查
+ *
+ * 资源消耗 (时长、各泵用量、峰值液位) 由 ExperimentSimulator 按硬件模型模拟得到.
+ *
+ * 逐步检查不依赖其他步骤: 步骤树先展开为前序列表, 超过 PARALLEL_MIN_STEPS 时分段并行检查,
+ * 各段的结果按原顺序合并, 输出与串行检查完全一致.
  */
 class ExperimentValidator {
 public:
+    // 展开后的步骤数少于此值时不开线程 (线程启动比检查本身更慢)
+    static constexpr std::size_t PARALLEL_MIN_STEPS = 512;
+    
     ExperimentValidator() = default;
+    explicit ExperimentValidator(SimulationModel model) : model_(model) {}
+    
+    /** @brief 替换资源预估使用的硬件模型 (通常为按历史数据标定后的模型) */
+    void set_model(const SimulationModel& model) { model_ = model; }
+    const SimulationModel& model() const { return model_; }
     
     /**
      * 验证实验程序
@@ -72,52 +88,65 @@ public:
     static experiment::ValidationResult to_proto(const ValidationResultInfo& result);
 
 private:
+    // 检查结果 (每个分段一份, 最后按顺序合并)
+    struct Findings {
+        std::vector<ValidationErrorInfo> errors;
+        std::vector<ValidationErrorInfo> warnings;
+        
+        void add_error(const std::string& path, const std::string& code, const std::string& message);
+        void add_warning(const std::string& path, const std::string& code, const std::string& message);
+        void append(Findings&& other);
+    };
+    
+    // 前序展开的步骤 (循环体紧跟在循环步骤之后)
+    struct FlatStep {
+        const experiment::Step* step;
+        std::string path;
+        bool in_sweep;      // 位于参数扫描的模板中
+    };
+    
+    SimulationModel model_;
+    
     // 当前验证上下文
     const experiment::ExperimentProgram* program_ = nullptr;
-    std::vector<ValidationErrorInfo> errors_;
-    std::vector<ValidationErrorInfo> warnings_;
+    Findings findings_;
     
     // 液体ID到库存的映射
     std::map<std::string, const experiment::LiquidInventory*> liquid_map_;
     
-    // 资源追踪
-    std::map<int32_t, double> pump_totals_;  // 每个泵的累计消耗
-    double current_liquid_level_ = 0;         // 当前液位
-    double peak_liquid_level_ = 0;            // 峰值液位
-    double total_duration_ = 0;               // 累计时长
-    int32_t total_heater_cycles_ = 0;         // 累计加热器循环
+    // 模拟结果
+    SimulationResult simulation_;
     
     // 验证步骤
     void reset();
     void build_liquid_map();
     void validate_hardware_constraints();
-    void validate_steps(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
-                       const std::string& path_prefix);
-    void validate_step(const experiment::Step& step, const std::string& path);
-    
-    // 动作验证
-    void validate_inject_action(const experiment::InjectAction& action, const std::string& path);
-    void validate_wait_action(const experiment::WaitAction& action, const std::string& path);
-    void validate_drain_action(const experiment::DrainAction& action, const std::string& path);
-    void validate_acquire_action(const experiment::AcquireAction& action, const std::string& path);
-    void validate_loop_action(const experiment::LoopAction& action, const std::string& path);
+    void validate_steps(const google::protobuf::RepeatedPtrField<experiment::Step>& steps);
+    static void flatten_steps(const google::protobuf::RepeatedPtrField<experiment::Step>& steps,
+                              const std::string& path_prefix, bool in_sweep, std::vector<FlatStep>& out);
+    Findings validate_range(const FlatStep* begin, const FlatStep* end) const;
     
-    // 资源计算
-    void calculate_inject_resources(const experiment::InjectAction& action);
-    void calculate_drain_resources(const experiment::DrainAction& action);
-    void calculate_wait_resources(const experiment::WaitAction& action);
-    void calculate_acquire_resources(const experiment::AcquireAction& action);
+    // 逐步验证 (只读 liquid_map_, 可并发调用)
+    void validate_step(const experiment::Step& step, const std::string& path, Findings& out) const;
+    void validate_inject_action(const experiment::InjectAction& action, const std::string& path,
+                                Findings& out) const;
+    static void validate_wait_action(const experiment::WaitAction& action, const std::string& path,
+                                     Findings& out);
+    static void validate_acquire_action(const experiment::AcquireAction& action, const std::string& path,
+                                        Findings& out);
+    static void validate_loop_action(const experiment::LoopAction& action, const std::string& path,
+                                     Findings& out);
+    void validate_sweep_action(const experiment::SweepAction& action, const std::string& path,
+                               Findings& out) const;
     
     // 安全检查
     void check_overflow_risk();
-    void check_empty_aspiration_risk();
-    void check_liquid_sufficiency();
+    // 各液体的需求 / 余量: 一次遍历得到消耗详情、余量警告和不足错误
+    void account_liquids(std::vector<LiquidConsumptionInfo>& consumption);
     
     // 辅助函数
-    void add_error(const std::string& path, const std::string& code, const std::string& message);
-    void add_warning(const std::string& path, const std::string& code, const std::string& message);
-    double get_inject_volume(const experiment::InjectAction& action);
-    const experiment::LiquidInventory* find_liquid(const std::string& liquid_id);
+    double get_inject_volume(const experiment::InjectAction& action) const;
+    const experiment::LiquidInventory* find_liquid(const std::string& liquid_id) const;
 };
 
 } // namespace enose::workflows
@@ -121,7 +121,7 @@ TransitionResult HardwareStateMachine::request_transition(HardwareState target)
     }
     
     // 检查转换是否合法
-    if (!can_transition_to(target)) {
+    if (!is_valid_transition(current_state_, target)) {
         std::string error = "Invalid transition: " + 
             std::string(state_to_string(current_state_)) + " -> " + 
             std::string(state_to_string(target));
@@ -131,7 +131,7 @@ TransitionResult HardwareStateMachine::request_transition(HardwareState target)
     
     // 执行转换
     HardwareState prev = current_state_;
-    current_state_ = target;
+    set_state(target);
     
     spdlog::info("HardwareStateMachine: {} -> {}", 
         state_to_string(prev), state_to_string(target));
@@ -151,7 +151,7 @@ TransitionResult HardwareStateMachine::force_transition(HardwareState target) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     HardwareState prev = current_state_;
-    current_state_ = target;
+    set_state(target);
     
     spdlog::warn("HardwareStateMachine: FORCE {} -> {}", 
         state_to_string(prev), state_to_string(target));
@@ -166,25 +166,33 @@ TransitionResult HardwareStateMachine::force_transition(HardwareState target) {
 }
 
 bool HardwareStateMachine::can_transition_to(HardwareState target) const {
-    auto it = valid_transitions_.find(current_state_);
+    return is_valid_transition(current_state(), target);
+}
+
+bool HardwareStateMachine::is_valid_transition(HardwareState from, HardwareState to) const {
+    // valid_transitions_ 构造后只读, 无需加锁
+    auto it = valid_transitions_.find(from);
     if (it == valid_transitions_.end()) {
         return false;
     }
     
     const auto& targets = it->second;
-    return std::find(targets.begin(), targets.end(), target) != targets.end();
+    return std::find(targets.begin(), targets.end(), to) != targets.end();
 }
 
 std::vector<HardwareState> HardwareStateMachine::get_available_transitions() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto it = valid_transitions_.find(current_state_);
+    auto it = valid_transitions_.find(current_state());
     if (it == valid_transitions_.end()) {
         return {};
     }
     return it->second;
 }
 
+void HardwareStateMachine::set_state(HardwareState state) {
+    current_state_ = state;
+    snapshot_.publish(state);
+}
+
 SystemState::State HardwareStateMachine::to_legacy_state(HardwareState state) const {
     switch (state) {
         case HardwareState::IDLE:
@@ -236,7 +244,9 @@ void HardwareStateMachine::apply_legacy_state(HardwareState state) {
     if (!legacy_state_) return;
     
     auto legacy = to_legacy_state(state);
+    applying_thread_.store(std::this_thread::get_id(), std::memory_order_release);
     legacy_state_->transition_to(legacy);
+    applying_thread_.store(std::thread::id{}, std::memory_order_release);
 }
 
 TransitionResult HardwareStateMachine::emergency_stop() {
@@ -253,7 +263,7 @@ TransitionResult HardwareStateMachine::recover_from_error() {
     }
     
     HardwareState prev = current_state_;
-    current_state_ = HardwareState::IDLE;
+    set_state(HardwareState::IDLE);
     
     spdlog::info("HardwareStateMachine: Recovered from {} to IDLE", state_to_string(prev));
     
@@ -272,6 +282,11 @@ void HardwareStateMachine::on_legacy_state_changed(
     // 反向同步：当 SystemState (L0) 被外部修改时，同步 HardwareStateMachine (L1)
     // 这通常发生在：急停按钮触发、硬件限位开关触发、或其他非 Executor 路径的状态变更
     
+    // 自身 apply_legacy_state 引起的回调: 状态已由调用方设置
+    if (applying_thread_.load(std::memory_order_acquire) == std::this_thread::get_id()) {
+        return;
+    }
+    
     std::lock_guard<std::mutex> lock(mutex_);
     
     // 将底层状态映射到细粒度状态
@@ -283,7 +298,7 @@ void HardwareStateMachine::on_legacy_state_changed(
     }
     
     HardwareState prev = current_state_;
-    current_state_ = mapped_state;
+    set_state(mapped_state);
     
     spdlog::info("HardwareStateMachine: 反向同步 {} → {} (L0: {} → {})",
         state_to_string(prev), state_to_string(current_state_),
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "workflows/system_state.hpp"
+#include "workflows/versioned_snapshot.hpp"
 #include <spdlog/spdlog.h>
 #include <string>
 #include <optional>
@@ -8,6 +9,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <thread>
 
 namespace workflows {
 
@@ -107,16 +109,30 @@ public:
     TransitionResult force_transition(HardwareState target);
     
     /**
-     * @brief 检查是否可以转换到目标状态
+     * @brief 检查是否可以转换到目标状态 (按最新发布的状态, 不加锁)
      * @param target 目标状态
      * @return 是否可以转换
      */
     bool can_transition_to(HardwareState target) const;
     
     /**
-     * @brief 获取当前状态
+     * @brief 获取当前状态 (无锁读取快照, 不等待进行中的转换)
      */
-    HardwareState current_state() const { return current_state_; }
+    HardwareState current_state() const { return snapshot_.load()->data; }
+    
+    using StateSnapshot = std::shared_ptr<const VersionedSnapshot<HardwareState>::Value>;
+    
+    /**
+     * @brief 当前状态及其版本号 (每次状态变化加一)
+     */
+    StateSnapshot state_snapshot() const { return snapshot_.load(); }
+    
+    /**
+     * @brief 等到状态版本号大于 after_version 或超时 (长轮询)
+     */
+    StateSnapshot wait_for_change(uint64_t after_version, std::chrono::milliseconds timeout) const {
+        return snapshot_.wait_newer(after_version, timeout);
+    }
     
     /**
      * @brief 获取状态名称
@@ -159,6 +175,9 @@ public:
 private:
     void initialize_transition_rules();
     void apply_legacy_state(HardwareState state);
+    bool is_valid_transition(HardwareState from, HardwareState to) const;
+    // 修改状态并发布快照 (持有 mutex_ 时调用)
+    void set_state(HardwareState state);
     
     /**
      * @brief 反向同步回调：当 SystemState (L0) 变化时调用
@@ -174,6 +193,9 @@ private:
     std::vector<TransitionRule> transition_rules_;
     StateCallback state_callback_;
     mutable std::mutex mutex_;
+    VersionedSnapshot<HardwareState> snapshot_{HardwareState::IDLE};
+    // 正在把转换同步到 SystemState 的线程: 由此引起的反向回调直接忽略 (mutex_ 已被它持有)
+    std::atomic<std::thread::id> applying_thread_{};
     
     // 状态转换矩阵 (from -> [to1, to2, ...])
     std::unordered_map<HardwareState, std::vector<HardwareState>> valid_transitions_;
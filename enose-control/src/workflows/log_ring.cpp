@@ -0,0 +1,118 @@
+#include "workflows/log_ring.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+namespace workflows {
+
+namespace {
+
+constexpr std::size_t TIME_PREFIX = 9;      // "HH:MM:SS "
+
+// 同一秒内的日志复用格式化好的时间 (localtime 需要查时区, 较慢)
+void format_time(int64_t unix_s, char* out) {
+    thread_local int64_t cached_s = -1;
+    thread_local char cached[TIME_PREFIX + 1];
+    if (unix_s != cached_s) {
+        const std::time_t t = static_cast<std::time_t>(unix_s);
+        std::tm tm{};
+        localtime_r(&t, &tm);
+        std::strftime(cached, sizeof(cached), "%H:%M:%S ", &tm);
+        cached_s = unix_s;
+    }
+    std::memcpy(out, cached, TIME_PREFIX);
+}
+
+// 截断到不超过 limit 字节且不拆开 UTF-8 多字节字符
+std::size_t utf8_prefix(std::string_view text, std::size_t limit) {
+    if (text.size() <= limit) return text.size();
+    std::size_t n = limit;
+    while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) --n;
+    return n;
+}
+
+} // namespace
+
+LogRing::LogRing() = default;
+
+uint64_t LogRing::push(std::string_view message) {
+    const auto now = std::chrono::system_clock::now();
+    const int64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        now.time_since_epoch()).count();
+
+    std::array<char, MAX_TEXT> text{};
+    format_time(timestamp_us / 1000000, text.data());
+    const std::size_t body = utf8_prefix(message, MAX_TEXT - TIME_PREFIX);
+    std::memcpy(text.data() + TIME_PREFIX, message.data(), body);
+    const std::size_t length = TIME_PREFIX + body;
+
+    const uint64_t index = head_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    Slot& slot = slots_[index & (CAPACITY - 1)];
+
+    // 占用槽位: 等其他写者写完; 已被更新的序号占用 (本条落后一整圈) 时直接丢弃
+    const uint64_t writing = 2 * index + 1;
+    uint64_t current = slot.sequence.load(std::memory_order_acquire);
+    for (;;) {
+        if (current >= writing) return index;
+        if (current & 1) {
+            std::this_thread::yield();
+            current = slot.sequence.load(std::memory_order_acquire);
+            continue;
+        }
+        if (slot.sequence.compare_exchange_weak(current, writing, std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+            break;
+        }
+    }
+
+    slot.timestamp_us.store(timestamp_us, std::memory_order_relaxed);
+    slot.length.store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+    const std::size_t used_words = (length + 7) / 8;
+    for (std::size_t w = 0; w < used_words; ++w) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + w * 8, 8);
+        slot.words[w].store(word, std::memory_order_relaxed);
+    }
+    slot.sequence.store(writing + 1, std::memory_order_release);
+    return index;
+}
+
+LogRing::Batch LogRing::read_after(uint64_t after_index) const {
+    Batch batch;
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    // 游标超过已分配的序号: 来自重启前的进程, 按首次查询处理 (否则要等序号追上才有新日志)
+    if (after_index > head) after_index = 0;
+    const uint64_t oldest = head > CAPACITY ? head - CAPACITY : 0;
+    uint64_t index = std::max({after_index, floor_.load(std::memory_order_acquire), oldest});
+    batch.last_index = std::max(after_index, index);
+    if (index >= head) return batch;
+
+    batch.entries.reserve(head - index);
+    std::array<char, MAX_TEXT> text;
+    while (++index <= head) {
+        const Slot& slot = slots_[index & (CAPACITY - 1)];
+        const uint64_t done = 2 * index + 2;
+
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before < done) break;               // 仍在写入, 下次从这里继续
+        if (before == done) {
+            const int64_t timestamp_us = slot.timestamp_us.load(std::memory_order_relaxed);
+            const std::size_t length = std::min<std::size_t>(slot.length.load(std::memory_order_relaxed), MAX_TEXT);
+            for (std::size_t w = 0; w < (length + 7) / 8; ++w) {
+                const uint64_t word = slot.words[w].load(std::memory_order_relaxed);
+                std::memcpy(text.data() + w * 8, &word, 8);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == done) {
+                batch.entries.push_back({index, timestamp_us, std::string(text.data(), length)});
+            }
+        }
+        // 读取期间被覆盖 (或写入时已落后一圈) 的条目丢弃
+        batch.last_index = index;
+    }
+    return batch;
+}
+
+} // namespace workflows
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace workflows {
+
+/**
+ * @brief 定长无锁日志环 (多生产者, 读者不阻塞写者)
+ *
+ * 每条日志写入时加上 "HH:MM:SS " 前缀并分配单调递增的序号 (从 1 开始).
+ * 状态查询按 read_after(上次看到的序号) 只取新增的条目, 轮询代价与日志总量无关.
+ *
+ * 槽位以序号取模复用, 每个槽位带序列号 (写入中为奇数, 写完为 2 × 序号 + 2):
+ * 写者 CAS 占用槽位后写入, 读者读取前后各比较一次序列号, 被覆盖的条目视为已丢弃.
+ * 正文按 8 字节原子字保存, 并发读写都是良定义的. 超过 MAX_TEXT 的日志在 UTF-8 字符边界截断.
+ */
+class LogRing {
+public:
+    static constexpr std::size_t CAPACITY = 256;        // 2 的幂
+    static constexpr std::size_t MAX_TEXT = 240;        // 含时间前缀, 8 的倍数
+
+    struct Entry {
+        uint64_t index;
+        int64_t timestamp_us;       // Unix 微秒
+        std::string text;           // "HH:MM:SS 消息"
+    };
+
+    LogRing();
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    /** @brief 写入一条日志, 返回其序号 */
+    uint64_t push(std::string_view message);
+
+    struct Batch {
+        std::vector<Entry> entries;
+        uint64_t last_index = 0;    // 下次调用 read_after 的游标
+    };
+
+    /**
+     * @brief 序号大于 after_index 的条目 (按序号升序)
+     *
+     * 已被覆盖或 clear() 之前的条目不返回; 读者落后超过 CAPACITY 时只能拿到最近的部分.
+     * 遇到仍在写入的条目时到此为止, 下次从它继续, 不会跳过.
+     * after_index 大于 last_index() (进程重启后客户端沿用旧游标) 时按 0 处理.
+     */
+    Batch read_after(uint64_t after_index) const;
+
+    /** @brief 最近分配的日志序号 (无日志时为 0) */
+    uint64_t last_index() const { return head_.load(std::memory_order_acquire); }
+
+    /** @brief 隐藏已有条目 (序号继续递增, 旧游标仍然有效) */
+    void clear() { floor_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    static constexpr std::size_t WORDS = MAX_TEXT / 8;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> timestamp_us{0};
+        std::atomic<uint32_t> length{0};
+        std::array<std::atomic<uint64_t>, WORDS> words{};
+    };
+
+    std::array<Slot, CAPACITY> slots_;
+    std::atomic<uint64_t> head_{0};     // 已分配的最大序号
+    std::atomic<uint64_t> floor_{0};    // clear() 时的序号, 不返回不大于它的条目
+};
+
+} // namespace workflows
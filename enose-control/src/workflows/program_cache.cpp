@@ -0,0 +1,92 @@
+#include "program_cache.hpp"
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <algorithm>
+
+namespace enose::workflows {
+
+namespace {
+// 典型程序 (几十个步骤) 一到两个块即可容纳
+constexpr std::size_t PROGRAM_ARENA_START_BLOCK = 4096;
+
+struct ArenaProgram {
+    explicit ArenaProgram(const google::protobuf::ArenaOptions& options) : arena(options) {}
+    google::protobuf::Arena arena;
+    experiment::ExperimentProgram* program = nullptr;
+};
+} // namespace
+
+std::shared_ptr<experiment::ExperimentProgram> make_arena_program() {
+    google::protobuf::ArenaOptions options;
+    options.start_block_size = PROGRAM_ARENA_START_BLOCK;
+    auto holder = std::make_shared<ArenaProgram>(options);
+    holder->program = google::protobuf::Arena::CreateMessage<experiment::ExperimentProgram>(&holder->arena);
+    // 别名构造: 共享 holder 的所有权, 指向 Arena 上的消息 (消息本身不单独析构)
+    return std::shared_ptr<experiment::ExperimentProgram>(holder, holder->program);
+}
+
+ProgramCache::ProgramCache(std::size_t capacity)
+    : capacity_(std::max<std::size_t>(1, capacity)) {}
+
+std::string ProgramCache::key_for_yaml(const std::string& yaml) {
+    return "yaml:" + yaml;
+}
+
+std::string ProgramCache::key_for_program(const experiment::ExperimentProgram& program) {
+    // map 字段的默认序列化顺序不固定, 相同程序须得到相同的键
+    std::string key = "proto:";
+    {
+        google::protobuf::io::StringOutputStream output(&key);
+        google::protobuf::io::CodedOutputStream coded(&output);
+        coded.SetSerializationDeterministic(true);
+        program.SerializeToCodedStream(&coded);
+    }
+    return key;
+}
+
+std::shared_ptr<const ProgramCache::Entry> ProgramCache::find(const std::string& key, const Version& version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || !(it->second->version == version)) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++stats_.hits;
+    return it->second->entry;
+}
+
+void ProgramCache::insert(const std::string& key, const Version& version, std::shared_ptr<const Entry> entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = index_.find(key); it != index_.end()) {
+        it->second->version = version;
+        it->second->entry = std::move(entry);
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.push_front(Node{key, version, std::move(entry)});
+    index_.emplace(lru_.front().key, lru_.begin());
+
+    while (lru_.size() > capacity_) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void ProgramCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    lru_.clear();
+}
+
+ProgramCache::Stats ProgramCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s = stats_;
+    s.size = lru_.size();
+    return s;
+}
+
+} // namespace enose::workflows
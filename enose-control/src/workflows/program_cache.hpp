@@ -0,0 +1,88 @@
+#pragma once
+
+#include "enose_experiment.pb.h"
+#include "workflows/execution_plan.hpp"
+#include "workflows/experiment_validator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace enose::workflows {
+
+/**
+ * @brief 在独占的 Arena 上新建一个空程序
+ *
+ * 程序树 (步骤、动作参数、液体列表) 由大量小消息组成, 放在同一个 Arena 上按块分配,
+ * 最后一个 shared_ptr 释放时整体回收. 应直接填充返回的消息 (YamlParser::parse_into /
+ * JsonStringToMessage / CopyFrom): 把堆上的消息 std::move 进来会退化为逐字段复制.
+ */
+std::shared_ptr<experiment::ExperimentProgram> make_arena_program();
+
+/**
+ * @brief 解析 / 验证 / 编译结果的 LRU 缓存
+ *
+ * 键为 YAML 原文或程序的确定性序列化 (硬件约束是程序的一部分, 改动即换键), 整个键参与
+ * 哈希和比较, 不会因哈希碰撞取错程序. 条目记录生成时的 Version (资源预估模型与液体库存),
+ * 版本不同的条目视为未命中并被替换.
+ *
+ * 条目不可变, 以 shared_ptr 共享: 计划中的步骤指向条目持有的程序, 使用方持有程序的
+ * shared_ptr 即可安全地复制计划.
+ */
+class ProgramCache {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 32;
+
+    struct Version {
+        uint64_t model = 0;         // 资源预估模型 (每次标定结果变化时递增)
+        uint64_t inventory = 0;     // ConsumableCache 快照版本
+        bool operator==(const Version&) const = default;
+    };
+
+    struct Entry {
+        std::shared_ptr<const experiment::ExperimentProgram> program;
+        ValidationResultInfo validation;
+        ExecutionPlan plan;         // 只在验证通过且编译成功时非空
+        std::string compile_error;
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        std::size_t size = 0;
+    };
+
+    explicit ProgramCache(std::size_t capacity = DEFAULT_CAPACITY);
+
+    static std::string key_for_yaml(const std::string& yaml);
+    static std::string key_for_program(const experiment::ExperimentProgram& program);
+
+    /** @brief 命中且版本一致时返回条目并移到队首 */
+    std::shared_ptr<const Entry> find(const std::string& key, const Version& version);
+
+    /** @brief 插入或替换; 超出容量时淘汰最久未用的条目 */
+    void insert(const std::string& key, const Version& version, std::shared_ptr<const Entry> entry);
+
+    void clear();
+    Stats stats() const;
+
+private:
+    struct Node {
+        std::string key;
+        Version version;
+        std::shared_ptr<const Entry> entry;
+    };
+
+    const std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::list<Node> lru_;       // 队首为最近使用
+    std::unordered_map<std::string_view, std::list<Node>::iterator> index_;    // 键指向节点内的 key
+    Stats stats_;
+};
+
+} // namespace enose::workflows
@@ -0,0 +1,179 @@
+#include "workflows/step_scheduler.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace workflows {
+
+namespace {
+
+struct ResourceName {
+    const char* name;
+    StepScheduler::Resource bit;
+};
+
+const ResourceName RESOURCE_NAMES[] = {
+    {"valves", StepScheduler::VALVES},
+    {"peristaltic_pump", StepScheduler::PERISTALTIC_PUMP},
+    {"clean_pump", StepScheduler::CLEAN_PUMP},
+    {"gas_pump", StepScheduler::GAS_PUMP},
+    {"load_cell", StepScheduler::LOAD_CELL},
+    {"sensor", StepScheduler::SENSOR},
+};
+
+} // namespace
+
+StepScheduler::StepScheduler(std::shared_ptr<HardwareStateMachine> hardware_state, std::size_t max_parallel)
+    : hardware_state_(std::move(hardware_state))
+    , max_parallel_(std::max<std::size_t>(1, max_parallel)) {}
+
+StepScheduler::~StepScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+}
+
+uint32_t StepScheduler::resource_mask(const std::vector<std::string>& names) {
+    uint32_t mask = 0;
+    for (const auto& name : names) {
+        auto it = std::find_if(std::begin(RESOURCE_NAMES), std::end(RESOURCE_NAMES),
+                               [&](const ResourceName& r) { return name == r.name; });
+        if (it == std::end(RESOURCE_NAMES)) return ALL;
+        mask |= it->bit;
+    }
+    return mask;
+}
+
+StepScheduler::Stats StepScheduler::stats() const {
+    Stats s;
+    s.steps_run = steps_run_;
+    s.steps_overlapped = steps_overlapped_;
+    return s;
+}
+
+bool StepScheduler::can_issue(const Slot& slot) const {
+    if (running_.empty()) return true;
+    if (running_.size() >= max_parallel_ || slot.barrier) return false;
+
+    for (const auto& r : running_) {
+        if (r.slot.barrier || (r.slot.resources & slot.resources) != 0) return false;
+    }
+
+    // 出错或急停时逐步执行, 避免在恢复过程中再叠加动作
+    if (hardware_state_) {
+        auto state = hardware_state_->current_state();
+        if (state == HardwareState::ERROR || state == HardwareState::EMERGENCY_STOP) return false;
+    }
+    return true;
+}
+
+void StepScheduler::run(std::size_t begin, std::size_t end, const SlotOf& slot_of, const RunStep& run_step,
+                        const ShouldStop& should_stop, const OnProgress& on_progress) {
+    if (begin >= end) return;
+
+    {
+        std::lock_guard<std::mutex> progress_lock(progress_mutex_);
+        reported_ = begin;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.clear();
+        queue_.clear();
+        done_.assign(end - begin, false);
+        begin_ = begin;
+        completed_ = begin;
+        error_ = nullptr;
+        run_step_ = &run_step;
+        on_progress_ = &on_progress;
+    }
+
+    if (workers_.empty()) {
+        workers_.reserve(max_parallel_);
+        for (std::size_t i = 0; i < max_parallel_; ++i) {
+            workers_.emplace_back(&StepScheduler::worker_loop, this);
+        }
+    }
+
+    for (std::size_t next = begin; next < end; ++next) {
+        if (should_stop()) break;
+
+        const Slot slot = slot_of(next);
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return error_ || can_issue(slot); });
+        if (error_) break;
+
+        if (!running_.empty()) ++steps_overlapped_;
+        running_.push_back({next, slot});
+        queue_.push_back(next);
+        cv_.notify_all();
+    }
+
+    // 进度回调引用 on_progress, 等它们也结束后才返回
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return running_.empty() && reporting_ == 0; });
+        error = std::exchange(error_, nullptr);
+        run_step_ = nullptr;
+        on_progress_ = nullptr;
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+void StepScheduler::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return shutdown_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+
+        const std::size_t index = queue_.front();
+        queue_.erase(queue_.begin());
+        const RunStep* run_step = run_step_;
+        const OnProgress* on_progress = on_progress_;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            (*run_step)(index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        ++steps_run_;
+
+        lock.lock();
+        if (error && !error_) error_ = error;
+        running_.erase(std::find_if(running_.begin(), running_.end(),
+                                    [index](const Running& r) { return r.index == index; }));
+        done_[index - begin_] = true;
+
+        const std::size_t before = completed_;
+        while (completed_ - begin_ < done_.size() && done_[completed_ - begin_]) ++completed_;
+        const bool report = completed_ != before && on_progress && *on_progress;
+        const std::size_t completed = completed_;
+        if (report) ++reporting_;
+        cv_.notify_all();
+        if (!report) continue;
+
+        // 完成的前缀推进后在锁外报告 (回调可能写数据库), 不阻塞发射和另一个 worker;
+        // 两个 worker 先后得到的前缀可能乱序到达, 较小的值不再报告
+        lock.unlock();
+        try {
+            std::lock_guard<std::mutex> progress_lock(progress_mutex_);
+            if (completed > reported_) {
+                reported_ = completed;
+                (*on_progress)(completed);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        if (error && !error_) error_ = error;
+        --reporting_;
+        cv_.notify_all();
+    }
+}
+
+} // namespace workflows
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "workflows/hardware_state_machine.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace workflows {
+
+/**
+ * @brief 按资源冲突流水线执行计划步骤
+ *
+ * 每个步骤声明占用的执行机构 (IActionExecutor::required_resources 的位图). 调度器按顺序发射:
+ * 步骤 N+1 在步骤 N 尚未结束时即可开始, 只要它与所有正在执行的步骤资源不相交且双方都不是屏障.
+ * 屏障步骤 (等待、切换状态、阶段标记等依赖前序完成或影响数据标签的步骤) 等所有前序步骤结束才开始,
+ * 且在它结束前不发射后续步骤. 冲突的步骤保持顺序, 不会越过先前的步骤.
+ *
+ * 硬件状态机处于 ERROR / EMERGENCY_STOP 时不再重叠, 退化为逐步执行.
+ */
+class StepScheduler {
+public:
+    enum Resource : uint32_t {
+        VALVES           = 1u << 0,
+        PERISTALTIC_PUMP = 1u << 1,
+        CLEAN_PUMP       = 1u << 2,
+        GAS_PUMP         = 1u << 3,
+        LOAD_CELL        = 1u << 4,
+        SENSOR           = 1u << 5,
+        ALL              = ~0u,
+    };
+
+    struct Slot {
+        uint32_t resources = ALL;
+        bool barrier = true;
+    };
+
+    struct Stats {
+        uint64_t steps_run = 0;
+        uint64_t steps_overlapped = 0;  // 发射时有其他步骤仍在执行
+    };
+
+    using SlotOf = std::function<Slot(std::size_t index)>;
+    using RunStep = std::function<void(std::size_t index)>;
+    using ShouldStop = std::function<bool()>;
+    // 已连续完成的步骤数 (从 0 开始计), 即断点续跑的位置
+    using OnProgress = std::function<void(std::size_t completed)>;
+
+    /**
+     * @param max_parallel 同时执行的步骤上限, 1 = 不重叠
+     */
+    explicit StepScheduler(std::shared_ptr<HardwareStateMachine> hardware_state = nullptr,
+                           std::size_t max_parallel = 2);
+    ~StepScheduler();
+
+    StepScheduler(const StepScheduler&) = delete;
+    StepScheduler& operator=(const StepScheduler&) = delete;
+
+    /** @brief 资源名 → 位图; 未知的资源名按全部资源处理 (保守) */
+    static uint32_t resource_mask(const std::vector<std::string>& names);
+
+    /**
+     * @brief 执行 [begin, end) 的步骤, 返回时所有已发射的步骤都已结束
+     *
+     * should_stop 在每次发射前调用 (暂停时可在其中阻塞), 返回 true 后不再发射.
+     * 步骤抛出的第一个异常在所有步骤结束后重新抛出.
+     * on_progress 在 worker 线程上、不持调度锁调用 (可做数据库写入), 报告值单调递增.
+     * worker 线程在首次 run() 时创建并在各次 run() 间复用; 同一时刻只能有一个 run().
+     */
+    void run(std::size_t begin, std::size_t end, const SlotOf& slot_of, const RunStep& run_step,
+             const ShouldStop& should_stop, const OnProgress& on_progress);
+
+    Stats stats() const;
+
+private:
+    struct Running {
+        std::size_t index;
+        Slot slot;
+    };
+
+    bool can_issue(const Slot& slot) const;
+    void worker_loop();
+
+    std::shared_ptr<HardwareStateMachine> hardware_state_;
+    const std::size_t max_parallel_;
+
+    // 单次 run() 的状态, 由 mutex_ 保护
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Running> running_;
+    std::vector<std::size_t> queue_;        // 已发射待 worker 领取
+    std::vector<bool> done_;
+    std::size_t begin_ = 0;
+    std::size_t completed_ = 0;
+    std::size_t reporting_ = 0;             // 正在 (锁外) 调用 on_progress 的 worker 数
+    std::exception_ptr error_;
+    const RunStep* run_step_ = nullptr;
+    const OnProgress* on_progress_ = nullptr;
+
+    // 进度报告逐个进行, 只报告比上次大的值 (由 progress_mutex_ 保护)
+    std::mutex progress_mutex_;
+    std::size_t reported_ = 0;
+
+    // 常驻 worker, 析构时结束
+    std::vector<std::thread> workers_;
+    bool shutdown_ = false;
+
+    std::atomic<uint64_t> steps_run_{0};
+    std::atomic<uint64_t> steps_overlapped_{0};
+};
+
+} // namespace workflows
@@ -0,0 +1,206 @@
+#include "sweep_generator.hpp"
+#include <algorithm>
+
+namespace enose::workflows {
+
+namespace {
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+constexpr int FEISTEL_ROUNDS = 4;
+
+} // namespace
+
+double SweepGenerator::Variable::at(uint64_t i) const {
+    if (!values.empty()) return values[i];
+    if (points <= 1) return min;
+    return min + (max - min) * static_cast<double>(i) / static_cast<double>(points - 1);
+}
+
+SweepGenerator::SweepGenerator(const experiment::SweepAction& sweep)
+    : mode_(sweep.mode())
+    , seed_(sweep.seed())
+    , balance_liquid_id_(sweep.balance_liquid_id()) {
+
+    auto fail = [this](std::string message) {
+        error_ = std::move(message);
+        size_ = 0;
+    };
+
+    if (sweep.variables_size() == 0) {
+        fail("扫描未定义变量");
+        return;
+    }
+
+    variables_.reserve(sweep.variables_size());
+    for (const auto& var : sweep.variables()) {
+        if (find_variable(var.liquid_id()) >= 0) {
+            fail("扫描变量重复: " + var.liquid_id());
+            return;
+        }
+        if (var.liquid_id() == balance_liquid_id_) {
+            fail("补足成分不能同时是扫描变量: " + var.liquid_id());
+            return;
+        }
+        if (var.min() > var.max()) {
+            fail("扫描变量 " + var.liquid_id() + " 的 min 大于 max");
+            return;
+        }
+
+        Variable v;
+        v.liquid_id = var.liquid_id();
+        v.min = var.min();
+        v.max = var.max();
+        v.points = std::max(1, var.points());
+        v.values.assign(var.values().begin(), var.values().end());
+        variables_.push_back(std::move(v));
+    }
+
+    switch (mode_) {
+        case experiment::SWEEP_GRID: {
+            // 最后一个变量变化最快
+            uint64_t total = 1;
+            for (auto it = variables_.rbegin(); it != variables_.rend(); ++it) {
+                it->stride = total;
+                total *= it->count();
+                if (total > MAX_POINTS) {
+                    fail("扫描点数超过上限 " + std::to_string(MAX_POINTS));
+                    return;
+                }
+            }
+            size_ = total;
+            break;
+        }
+        case experiment::SWEEP_ZIP: {
+            const uint64_t count = variables_.front().count();
+            for (const auto& v : variables_) {
+                if (v.count() != count) {
+                    fail("ZIP 扫描的各变量取值个数必须相同");
+                    return;
+                }
+            }
+            if (count > MAX_POINTS) {
+                fail("扫描点数超过上限 " + std::to_string(MAX_POINTS));
+                return;
+            }
+            size_ = count;
+            break;
+        }
+        case experiment::SWEEP_LATIN_HYPERCUBE: {
+            if (sweep.samples() < 1) {
+                fail("拉丁超立方扫描未指定 samples");
+                return;
+            }
+            size_ = static_cast<uint64_t>(sweep.samples());
+            if (size_ > MAX_POINTS) {
+                fail("扫描点数超过上限 " + std::to_string(MAX_POINTS));
+                return;
+            }
+            // Feistel 网络要求位数为偶数 (左右两半等宽)
+            permutation_bits_ = 2;
+            while ((uint64_t{1} << permutation_bits_) < size_) permutation_bits_ += 2;
+            break;
+        }
+        default:
+            fail("未知的扫描模式");
+            return;
+    }
+}
+
+double SweepGenerator::value(uint64_t point, std::size_t variable) const {
+    const auto& v = variables_[variable];
+    switch (mode_) {
+        case experiment::SWEEP_GRID:
+            return v.at((point / v.stride) % v.count());
+        case experiment::SWEEP_LATIN_HYPERCUBE: {
+            const double u = (static_cast<double>(stratum(point, variable)) + jitter(point, variable)) /
+                             static_cast<double>(size_);
+            return v.min + (v.max - v.min) * u;
+        }
+        default:
+            return v.at(point);
+    }
+}
+
+double SweepGenerator::mean(std::size_t variable) const {
+    const auto& v = variables_[variable];
+    if (mode_ == experiment::SWEEP_LATIN_HYPERCUBE) {
+        return (v.min + v.max) / 2;
+    }
+    // 网格中每个取值出现的次数相同, 平均值即取值的平均
+    double sum = 0;
+    for (uint64_t i = 0; i < v.count(); ++i) sum += v.at(i);
+    return sum / static_cast<double>(v.count());
+}
+
+double SweepGenerator::max(std::size_t variable) const {
+    const auto& v = variables_[variable];
+    if (mode_ == experiment::SWEEP_LATIN_HYPERCUBE || v.values.empty()) {
+        return v.max;
+    }
+    return *std::max_element(v.values.begin(), v.values.end());
+}
+
+double SweepGenerator::ratio(uint64_t point, const experiment::LiquidComponent& component) const {
+    if (const int v = find_variable(component.liquid_id()); v >= 0) {
+        return value(point, static_cast<std::size_t>(v));
+    }
+    if (!balance_liquid_id_.empty() && component.liquid_id() == balance_liquid_id_) {
+        double sum = 0;
+        for (std::size_t v = 0; v < variables_.size(); ++v) sum += value(point, v);
+        return std::max(0.0, 1.0 - sum);
+    }
+    return component.ratio();
+}
+
+double SweepGenerator::mean_ratio(const experiment::LiquidComponent& component) const {
+    if (const int v = find_variable(component.liquid_id()); v >= 0) {
+        return mean(static_cast<std::size_t>(v));
+    }
+    if (!balance_liquid_id_.empty() && component.liquid_id() == balance_liquid_id_) {
+        double sum = 0;
+        for (std::size_t v = 0; v < variables_.size(); ++v) sum += mean(v);
+        return std::max(0.0, 1.0 - sum);
+    }
+    return component.ratio();
+}
+
+uint64_t SweepGenerator::stratum(uint64_t point, std::size_t variable) const {
+    // 以 (seed, 变量) 为键的 Feistel 置换, 超出 [0, size_) 时继续置换 (循环行走)
+    const unsigned half = permutation_bits_ / 2;
+    const uint64_t mask = (uint64_t{1} << half) - 1;
+    const uint64_t key = splitmix64(seed_ ^ splitmix64(variable + 1));
+
+    uint64_t x = point;
+    do {
+        uint64_t left = x >> half;
+        uint64_t right = x & mask;
+        for (int round = 0; round < FEISTEL_ROUNDS; ++round) {
+            const uint64_t f = splitmix64(key ^ (static_cast<uint64_t>(round) << 56) ^ right) & mask;
+            const uint64_t next = left ^ f;
+            left = right;
+            right = next;
+        }
+        x = (left << half) | right;
+    } while (x >= size_);
+    return x;
+}
+
+double SweepGenerator::jitter(uint64_t point, std::size_t variable) const {
+    const uint64_t h = splitmix64(seed_ ^ splitmix64(point) ^ splitmix64(~static_cast<uint64_t>(variable)));
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+int SweepGenerator::find_variable(const std::string& liquid_id) const {
+    for (std::size_t i = 0; i < variables_.size(); ++i) {
+        if (variables_[i].liquid_id == liquid_id) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+} // namespace enose::workflows
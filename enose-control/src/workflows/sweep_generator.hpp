@@ -0,0 +1,79 @@
+#pragma once
+
+#include "enose_experiment.pb.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace enose::workflows {
+
+/**
+ * @brief 参数扫描点的按需生成器
+ *
+ * 只保存各变量的取值规则, 第 k 个点的比例由 k 直接算出 (网格按混合进制拆分序号,
+ * 拉丁超立方用以种子为键的伪随机置换选层), 不物化点表: 内存与扫描规模无关,
+ * 且任意序号可随机访问 (断点续跑从检查点的序号继续).
+ */
+class SweepGenerator {
+public:
+    // 扫描点数上限 (执行计划的步骤序号为 32 位)
+    static constexpr uint64_t MAX_POINTS = 1000000;
+
+    explicit SweepGenerator(const experiment::SweepAction& sweep);
+
+    /** @brief 配置错误 (为空表示可用); 有错误时 size() 为 0 */
+    const std::string& error() const { return error_; }
+
+    uint64_t size() const { return size_; }
+    std::size_t variable_count() const { return variables_.size(); }
+    const std::string& liquid_id(std::size_t variable) const { return variables_[variable].liquid_id; }
+    const std::string& balance_liquid_id() const { return balance_liquid_id_; }
+
+    /** @brief 第 point 个扫描点上变量的比例 */
+    double value(uint64_t point, std::size_t variable) const;
+
+    /** @brief 变量在全部扫描点上的平均比例 (资源预估按平均点模拟) */
+    double mean(std::size_t variable) const;
+
+    /** @brief 变量在全部扫描点上的最大比例 */
+    double max(std::size_t variable) const;
+
+    /**
+     * @brief 成分在第 point 个扫描点上的比例
+     *
+     * 扫描变量取当前点的值, 补足成分取 1 - Σ变量, 其余成分保持模板中的比例.
+     */
+    double ratio(uint64_t point, const experiment::LiquidComponent& component) const;
+
+    /** @brief 按平均点计算的成分比例 */
+    double mean_ratio(const experiment::LiquidComponent& component) const;
+
+private:
+    struct Variable {
+        std::string liquid_id;
+        double min = 0;
+        double max = 0;
+        uint64_t points = 0;
+        std::vector<double> values;     // 显式取值 (GRID / ZIP)
+        uint64_t stride = 1;            // GRID: 本变量在点序号中的权
+
+        uint64_t count() const { return values.empty() ? points : values.size(); }
+        double at(uint64_t i) const;
+    };
+
+    // 拉丁超立方: 变量 variable 上第 point 个样本所在的层 (对 [0, size_) 的置换)
+    uint64_t stratum(uint64_t point, std::size_t variable) const;
+    // [0, 1) 上的确定性抖动
+    double jitter(uint64_t point, std::size_t variable) const;
+    int find_variable(const std::string& liquid_id) const;
+
+    experiment::SweepMode mode_;
+    uint64_t seed_;
+    std::string balance_liquid_id_;
+    std::vector<Variable> variables_;
+    uint64_t size_ = 0;
+    unsigned permutation_bits_ = 1;     // 置换域为 [0, 2^bits), 循环行走到 [0, size_)
+    std::string error_;
+};
+
+} // namespace enose::workflows
@@ -4,9 +4,37 @@
 #include <format>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 namespace workflows {
 
+namespace {
+
+bool any_pump_running(const PeripheralState& state) {
+    return state.pump_0 == PumpState::RUNNING ||
+           state.pump_1 == PumpState::RUNNING ||
+           state.pump_2 == PumpState::RUNNING ||
+           state.pump_3 == PumpState::RUNNING ||
+           state.pump_4 == PumpState::RUNNING ||
+           state.pump_5 == PumpState::RUNNING ||
+           state.pump_6 == PumpState::RUNNING ||
+           state.pump_7 == PumpState::RUNNING;
+}
+
+} // namespace
+
+struct SystemState::WriterGuard {
+    explicit WriterGuard(SystemState& owner) : owner(owner) { owner.writer_mutex_.lock(); }
+    ~WriterGuard() {
+        owner.writer_mutex_.unlock();
+        owner.run_pending_resync();
+    }
+    WriterGuard(const WriterGuard&) = delete;
+    WriterGuard& operator=(const WriterGuard&) = delete;
+
+    SystemState& owner;
+};
+
 // 状态定义表 - 索引对应 State 枚举值
 const PeripheralState SystemState::STATE_DEFINITIONS[] = {
     // INITIAL (开机初始状态)
@@ -118,7 +146,65 @@ const PeripheralState SystemState::STATE_DEFINITIONS[] = {
 
 SystemState::SystemState(std::shared_ptr<hal::ActuatorDriver> actuator)
     : actuator_(std::move(actuator))
-    , current_peripheral_state_(STATE_DEFINITIONS[static_cast<int>(State::INITIAL)]) {}
+    , current_peripheral_state_(STATE_DEFINITIONS[static_cast<int>(State::INITIAL)])
+    , notified_peripheral_state_(current_peripheral_state_)
+    , snapshot_(Snapshot{current_state_, current_peripheral_state_}) {
+    
+    // Klipper 重启后所有引脚回到 printer.cfg 的初始值, 重连或 Klipper 重新 ready 时重放期望状态
+    if (actuator_) {
+        link_connection_ = actuator_->on_connection_changed.connect([this](bool connected) {
+            if (connected) {
+                resync_peripheral_state();
+            }
+        });
+        ready_connection_ = actuator_->on_firmware_ready.connect([this]() {
+            resync_peripheral_state();
+        });
+    }
+}
+
+void SystemState::resync_peripheral_state() {
+    resync_pending_ = true;
+    run_pending_resync();
+}
+
+void SystemState::run_pending_resync() {
+    // 标记先于 try_lock 设置, 写者解锁后再检查: 持锁期间到达的请求不会丢
+    while (resync_pending_ && writer_mutex_.try_lock()) {
+        if (resync_pending_.exchange(false)) {
+            resync_locked();
+        }
+        writer_mutex_.unlock();
+    }
+}
+
+void SystemState::resync_locked() {
+    auto& state = current_peripheral_state_;
+    // Klipper 重启后 GCODE_AXIS 注册已不存在
+    inject_prepared_ = 0;
+    
+    if (any_pump_running(state)) {
+        spdlog::warn("SystemState: Pump motion lost across reconnect, marking pumps stopped");
+        for (auto* pump : {&state.pump_0, &state.pump_1, &state.pump_2, &state.pump_3,
+                           &state.pump_4, &state.pump_5, &state.pump_6, &state.pump_7}) {
+            *pump = PumpState::STOPPED;
+        }
+    }
+    
+    // 可能在 io 线程上执行, 清洗泵直接设定目标值, 不做软启动
+    actuator_->send_gcode_batch({
+        std::format("SET_PIN PIN=valve_outlet VALUE={}", state.valve_outlet),
+        std::format("SET_PIN PIN=valve_pinch VALUE={}", state.valve_pinch),
+        std::format("SET_PIN PIN=inject_fan VALUE={}", state.valve_pinch),
+        std::format("SET_PIN PIN=inject_fan_2 VALUE={}", state.valve_pinch),
+        std::format("SET_PIN PIN=valve_waste VALUE={}", state.valve_waste),
+        std::format("SET_PIN PIN=valve_air VALUE={}", state.valve_air),
+        std::format("SET_PIN PIN=air_pump_pwm VALUE={}", state.air_pump_pwm),
+        std::format("SET_PIN PIN=cleaning_pump VALUE={}", state.cleaning_pump),
+    });
+    spdlog::info("SystemState: Peripheral state resynchronized ({})", state_to_string(current_state_));
+    notify_peripheral_state();
+}
 
 void SystemState::start_drain() {
     transition_to(State::DRAIN);
@@ -136,96 +222,138 @@ void SystemState::stop_clean() {
     transition_to(State::INITIAL);
 }
 
-void SystemState::start_inject(const InjectionParams& params) {
-    // 先切换到 INJECT 状态 (设置阀门)
-    transition_to(State::INJECT);
-    
-    // 使用 GCODE_AXIS 实现真正的并行运动
-    // 1. 注册泵到 A/B/C/D 轴 (宏内部会归零位置)
+uint64_t SystemState::prepare_inject() {
+    WriterGuard guard(*this);
+    if (any_pump_running(current_peripheral_state_)) {
+        return 0;
+    }
     actuator_->send_gcode("REGISTER_PUMPS_TO_AXIS");
+    inject_prepared_ = ++next_prepare_token_;
+    spdlog::debug("SystemState: Pumps pre-registered to GCODE_AXIS (token {})", inject_prepared_);
+    return inject_prepared_;
+}
+
+void SystemState::start_inject(const InjectionParams& params, uint64_t prepared) {
+    State old_state;
+    bool changed;
+    {
+        WriterGuard guard(*this);
+        // 先切换到 INJECT 状态 (设置阀门); 有泵在运行时会 ENOSE_ASYNC_STOP 并作废预注册
+        changed = transition_locked(State::INJECT, old_state);
+    
+        // 使用 GCODE_AXIS 实现真正的并行运动
+        // 1. 注册泵到 A/B/C/D 轴 (宏内部会归零位置); 排废时已预注册且之后没有运动则跳过
+        const bool registered = prepared != 0 && prepared == inject_prepared_;
+        inject_prepared_ = 0;
+        if (!registered) {
+            actuator_->send_gcode("REGISTER_PUMPS_TO_AXIS");
+        }
     
-    // 2. 使用单条 G1 命令同时驱动所有泵
-    // 速度转换: params.speed (mm/s) -> F (mm/min) = speed * 60
-    // 轴映射: A=pump_0, B=pump_1, C=pump_2, D=pump_3, H=pump_4, I=pump_5, J=pump_6, K=pump_7
-    // 注意: 跳过E(挤出机专用)/F(feedrate)/G(G-code前缀)
-    float feedrate = params.speed * 60.0f;
+        // 2. 使用单条 G1 命令同时驱动所有泵
+        // 速度转换: params.speed (mm/s) -> F (mm/min) = speed * 60
+        // 轴映射: A=pump_0, B=pump_1, C=pump_2, D=pump_3, H=pump_4, I=pump_5, J=pump_6, K=pump_7
+        // 注意: 跳过E(挤出机专用)/F(feedrate)/G(G-code前缀)
+        float feedrate = params.speed * 60.0f;
     
-    std::string g1_cmd = std::format("G1 A{:.3f} B{:.3f} C{:.3f} D{:.3f} H{:.3f} I{:.3f} J{:.3f} K{:.3f} F{:.1f}",
-        params.pump_0_volume,  // A = pump_0
-        params.pump_1_volume,  // B = pump_1
-        params.pump_2_volume,  // C = pump_2
-        params.pump_3_volume,  // D = pump_3
-        params.pump_4_volume,  // H = pump_4
-        params.pump_5_volume,  // I = pump_5
-        params.pump_6_volume,  // J = pump_6
-        params.pump_7_volume,  // K = pump_7
-        feedrate);
+        std::string g1_cmd = std::format("G1 A{:.3f} B{:.3f} C{:.3f} D{:.3f} H{:.3f} I{:.3f} J{:.3f} K{:.3f} F{:.1f}",
+            params.pump_0_volume,  // A = pump_0
+            params.pump_1_volume,  // B = pump_1
+            params.pump_2_volume,  // C = pump_2
+            params.pump_3_volume,  // D = pump_3
+            params.pump_4_volume,  // H = pump_4
+            params.pump_5_volume,  // I = pump_5
+            params.pump_6_volume,  // J = pump_6
+            params.pump_7_volume,  // K = pump_7
+            feedrate);
     
-    actuator_->send_gcode(g1_cmd);
+        actuator_->send_gcode(g1_cmd);
     
-    // 更新泵状态
-    if (params.pump_0_volume > 0) current_peripheral_state_.pump_0 = PumpState::RUNNING;
-    if (params.pump_1_volume > 0) current_peripheral_state_.pump_1 = PumpState::RUNNING;
-    if (params.pump_2_volume > 0) current_peripheral_state_.pump_2 = PumpState::RUNNING;
-    if (params.pump_3_volume > 0) current_peripheral_state_.pump_3 = PumpState::RUNNING;
-    if (params.pump_4_volume > 0) current_peripheral_state_.pump_4 = PumpState::RUNNING;
-    if (params.pump_5_volume > 0) current_peripheral_state_.pump_5 = PumpState::RUNNING;
-    if (params.pump_6_volume > 0) current_peripheral_state_.pump_6 = PumpState::RUNNING;
-    if (params.pump_7_volume > 0) current_peripheral_state_.pump_7 = PumpState::RUNNING;
+        // 更新泵状态
+        if (params.pump_0_volume > 0) current_peripheral_state_.pump_0 = PumpState::RUNNING;
+        if (params.pump_1_volume > 0) current_peripheral_state_.pump_1 = PumpState::RUNNING;
+        if (params.pump_2_volume > 0) current_peripheral_state_.pump_2 = PumpState::RUNNING;
+        if (params.pump_3_volume > 0) current_peripheral_state_.pump_3 = PumpState::RUNNING;
+        if (params.pump_4_volume > 0) current_peripheral_state_.pump_4 = PumpState::RUNNING;
+        if (params.pump_5_volume > 0) current_peripheral_state_.pump_5 = PumpState::RUNNING;
+        if (params.pump_6_volume > 0) current_peripheral_state_.pump_6 = PumpState::RUNNING;
+        if (params.pump_7_volume > 0) current_peripheral_state_.pump_7 = PumpState::RUNNING;
     
-    spdlog::info("SystemState: Parallel inject G1 A{:.3f} B{:.3f} C{:.3f} D{:.3f} H{:.3f} I{:.3f} J{:.3f} K{:.3f} F{:.1f}",
-        params.pump_0_volume, params.pump_1_volume,
-        params.pump_2_volume, params.pump_3_volume, 
-        params.pump_4_volume, params.pump_5_volume,
-        params.pump_6_volume, params.pump_7_volume, feedrate);
+        spdlog::info("SystemState: Parallel inject G1 A{:.3f} B{:.3f} C{:.3f} D{:.3f} H{:.3f} I{:.3f} J{:.3f} K{:.3f} F{:.1f}",
+            params.pump_0_volume, params.pump_1_volume,
+            params.pump_2_volume, params.pump_3_volume, 
+            params.pump_4_volume, params.pump_5_volume,
+            params.pump_6_volume, params.pump_7_volume, feedrate);
+    
+        notify_peripheral_state();
+    }
+    if (changed && state_callback_) {
+        state_callback_(old_state, State::INJECT);
+    }
 }
 
 void SystemState::stop_inject() {
-    // 使用 Klipper 插件的异步停止命令
-    // ENOSE_ASYNC_STOP 会:
-    // 1. 通过 reactor 回调立即执行（绕过 G-code 队列）
-    // 2. 重置 motion_queuing 时间变量阻止后续步进生成
-    // 3. 清空 trapq 并取消 GCODE_AXIS 注册
-    // 4. 禁用电机
-    // 延迟约 ~1 秒（已发送到 MCU 的步进会执行完）
-    actuator_->send_gcode("ENOSE_ASYNC_STOP");
+    State old_state;
+    bool changed;
+    {
+        WriterGuard guard(*this);
+        // 使用 Klipper 插件的异步停止命令
+        // ENOSE_ASYNC_STOP 会:
+        // 1. 通过 reactor 回调立即执行（绕过 G-code 队列）
+        // 2. 重置 motion_queuing 时间变量阻止后续步进生成
+        // 3. 清空 trapq 并取消 GCODE_AXIS 注册
+        // 4. 禁用电机
+        // 延迟约 ~1 秒（已发送到 MCU 的步进会执行完）
+        actuator_->send_gcode("ENOSE_ASYNC_STOP");
+        inject_prepared_ = 0;
     
-    spdlog::info("SystemState: ENOSE_ASYNC_STOP sent, pumps will stop in ~1s");
+        spdlog::info("SystemState: ENOSE_ASYNC_STOP sent, pumps will stop in ~1s");
     
-    current_peripheral_state_.pump_0 = PumpState::STOPPED;
-    current_peripheral_state_.pump_1 = PumpState::STOPPED;
-    current_peripheral_state_.pump_2 = PumpState::STOPPED;
-    current_peripheral_state_.pump_3 = PumpState::STOPPED;
-    current_peripheral_state_.pump_4 = PumpState::STOPPED;
-    current_peripheral_state_.pump_5 = PumpState::STOPPED;
-    current_peripheral_state_.pump_6 = PumpState::STOPPED;
-    current_peripheral_state_.pump_7 = PumpState::STOPPED;
+        current_peripheral_state_.pump_0 = PumpState::STOPPED;
+        current_peripheral_state_.pump_1 = PumpState::STOPPED;
+        current_peripheral_state_.pump_2 = PumpState::STOPPED;
+        current_peripheral_state_.pump_3 = PumpState::STOPPED;
+        current_peripheral_state_.pump_4 = PumpState::STOPPED;
+        current_peripheral_state_.pump_5 = PumpState::STOPPED;
+        current_peripheral_state_.pump_6 = PumpState::STOPPED;
+        current_peripheral_state_.pump_7 = PumpState::STOPPED;
     
-    transition_to(State::INITIAL);
+        changed = transition_locked(State::INITIAL, old_state);
+        notify_peripheral_state();
+    }
+    if (changed && state_callback_) {
+        state_callback_(old_state, State::INITIAL);
+    }
 }
 
 bool SystemState::is_any_pump_running() const {
-    return current_peripheral_state_.pump_0 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_1 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_2 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_3 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_4 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_5 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_6 == PumpState::RUNNING ||
-           current_peripheral_state_.pump_7 == PumpState::RUNNING;
+    return any_pump_running(snapshot()->data.peripheral);
 }
 
 void SystemState::transition_to(State target_state) {
+    State old_state;
+    bool changed;
+    {
+        WriterGuard guard(*this);
+        changed = transition_locked(target_state, old_state);
+    }
+    if (changed && state_callback_) {
+        state_callback_(old_state, target_state);
+    }
+}
+
+bool SystemState::transition_locked(State target_state, State& old_state) {
+    old_state = current_state_;
     if (current_state_ == target_state) {
         spdlog::debug("SystemState: Already in state {}", state_to_string(target_state));
-        return;
+        return false;
     }
 
     // 如果有泵正在运行，先停止（自动停止策略）
-    if (is_any_pump_running()) {
+    if (any_pump_running(current_peripheral_state_)) {
         spdlog::info("SystemState: Pumps running, auto-stopping before state transition");
-        // 发送异步停止命令
+        // 发送异步停止命令 (同时取消 GCODE_AXIS 注册)
         actuator_->send_gcode("ENOSE_ASYNC_STOP");
+        inject_prepared_ = 0;
         // 更新泵状态
         current_peripheral_state_.pump_0 = PumpState::STOPPED;
         current_peripheral_state_.pump_1 = PumpState::STOPPED;
@@ -237,7 +365,6 @@ void SystemState::transition_to(State target_state) {
         current_peripheral_state_.pump_7 = PumpState::STOPPED;
     }
 
-    State old_state = current_state_;
     current_state_ = target_state;
 
     spdlog::info("SystemState: {} -> {}", 
@@ -247,10 +374,8 @@ void SystemState::transition_to(State target_state) {
     // 应用新状态对应的外设配置
     const auto& new_peripheral_state = STATE_DEFINITIONS[static_cast<int>(target_state)];
     apply_peripheral_state(new_peripheral_state);
-
-    if (state_callback_) {
-        state_callback_(old_state, target_state);
-    }
+    notify_peripheral_state();
+    return true;
 }
 
 void SystemState::apply_peripheral_state(const PeripheralState& state) {
@@ -259,28 +384,29 @@ void SystemState::apply_peripheral_state(const PeripheralState& state) {
         return;
     }
 
-    // 只发送有变化的命令，减少通信开销
+    // 只发送有变化的命令，减少通信开销; 同一次切换的命令合并为一个脚本发送
+    std::vector<std::string> gcode;
     if (state.valve_outlet != current_peripheral_state_.valve_outlet) {
-        actuator_->send_gcode(std::format("SET_PIN PIN=valve_outlet VALUE={}", state.valve_outlet));
+        gcode.push_back(std::format("SET_PIN PIN=valve_outlet VALUE={}", state.valve_outlet));
     }
     
     if (state.valve_pinch != current_peripheral_state_.valve_pinch) {
-        actuator_->send_gcode(std::format("SET_PIN PIN=valve_pinch VALUE={}", state.valve_pinch));
+        gcode.push_back(std::format("SET_PIN PIN=valve_pinch VALUE={}", state.valve_pinch));
         // 风扇与夹管阀联动：夹管阀通电(1)时风扇转，断电(0)时风扇停
-        actuator_->send_gcode(std::format("SET_PIN PIN=inject_fan VALUE={}", state.valve_pinch));
-        actuator_->send_gcode(std::format("SET_PIN PIN=inject_fan_2 VALUE={}", state.valve_pinch));
+        gcode.push_back(std::format("SET_PIN PIN=inject_fan VALUE={}", state.valve_pinch));
+        gcode.push_back(std::format("SET_PIN PIN=inject_fan_2 VALUE={}", state.valve_pinch));
     }
     
     if (state.valve_waste != current_peripheral_state_.valve_waste) {
-        actuator_->send_gcode(std::format("SET_PIN PIN=valve_waste VALUE={}", state.valve_waste));
+        gcode.push_back(std::format("SET_PIN PIN=valve_waste VALUE={}", state.valve_waste));
     }
     
     if (state.valve_air != current_peripheral_state_.valve_air) {
-        actuator_->send_gcode(std::format("SET_PIN PIN=valve_air VALUE={}", state.valve_air));
+        gcode.push_back(std::format("SET_PIN PIN=valve_air VALUE={}", state.valve_air));
     }
     
     if (state.air_pump_pwm != current_peripheral_state_.air_pump_pwm) {
-        actuator_->send_gcode(std::format("SET_PIN PIN=air_pump_pwm VALUE={}", state.air_pump_pwm));
+        gcode.push_back(std::format("SET_PIN PIN=air_pump_pwm VALUE={}", state.air_pump_pwm));
     }
     
     if (state.cleaning_pump != current_peripheral_state_.cleaning_pump) {
@@ -292,6 +418,9 @@ void SystemState::apply_peripheral_state(const PeripheralState& state) {
             constexpr int steps = 10;
             constexpr int step_delay_ms = 100;
             float step_val = (end_val - start_val) / steps;
+            // 渐变是分时发出的, 先把前面的阀门命令送出
+            actuator_->send_gcode_batch(std::move(gcode));
+            gcode.clear();
             for (int i = 1; i <= steps; ++i) {
                 float val = start_val + step_val * i;
                 actuator_->send_gcode(std::format("SET_PIN PIN=cleaning_pump VALUE={:.2f}", val));
@@ -300,36 +429,38 @@ void SystemState::apply_peripheral_state(const PeripheralState& state) {
             spdlog::info("SystemState: Cleaning pump soft-started to {:.0f}%", end_val * 100);
         } else {
             // 停止：直接关闭
-            actuator_->send_gcode(std::format("SET_PIN PIN=cleaning_pump VALUE={}", state.cleaning_pump));
+            gcode.push_back(std::format("SET_PIN PIN=cleaning_pump VALUE={}", state.cleaning_pump));
         }
     }
     
     // 步进泵控制 (只处理停止命令，运行需要单独调用)
     if (state.pump_0 == PumpState::STOPPED && current_peripheral_state_.pump_0 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_0 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_0 ENABLE=0");
     }
     if (state.pump_1 == PumpState::STOPPED && current_peripheral_state_.pump_1 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_1 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_1 ENABLE=0");
     }
     if (state.pump_2 == PumpState::STOPPED && current_peripheral_state_.pump_2 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_2 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_2 ENABLE=0");
     }
     if (state.pump_3 == PumpState::STOPPED && current_peripheral_state_.pump_3 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_3 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_3 ENABLE=0");
     }
     if (state.pump_4 == PumpState::STOPPED && current_peripheral_state_.pump_4 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_4 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_4 ENABLE=0");
     }
     if (state.pump_5 == PumpState::STOPPED && current_peripheral_state_.pump_5 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_5 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_5 ENABLE=0");
     }
     if (state.pump_6 == PumpState::STOPPED && current_peripheral_state_.pump_6 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_6 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_6 ENABLE=0");
     }
     if (state.pump_7 == PumpState::STOPPED && current_peripheral_state_.pump_7 == PumpState::RUNNING) {
-        actuator_->send_gcode("MANUAL_STEPPER STEPPER=pump_7 ENABLE=0");
+        gcode.push_back("MANUAL_STEPPER STEPPER=pump_7 ENABLE=0");
     }
     
+    actuator_->send_gcode_batch(std::move(gcode));
+    
     // 加热器控制 (通过 Klipper heater_generic)
     // 注: heater_chamber 在 printer.cfg 中被注释，待启用后取消注释
     // if (state.heater_chamber != current_peripheral_state_.heater_chamber) {
@@ -339,6 +470,18 @@ void SystemState::apply_peripheral_state(const PeripheralState& state) {
     current_peripheral_state_ = state;
 }
 
+void SystemState::notify_peripheral_state() {
+    // 先发布快照, 信号的接收方 (及其后的任何读者) 读到的就是本次结果
+    const auto published = snapshot_.load();
+    if (published->data.state != current_state_ || !(published->data.peripheral == current_peripheral_state_)) {
+        snapshot_.publish(Snapshot{current_state_, current_peripheral_state_});
+    }
+
+    if (current_peripheral_state_ == notified_peripheral_state_) return;
+    notified_peripheral_state_ = current_peripheral_state_;
+    on_peripheral_state_changed(notified_peripheral_state_);
+}
+
 const PeripheralState& SystemState::get_state_definition(State state) {
     return STATE_DEFINITIONS[static_cast<int>(state)];
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <functional>
 #include <string>
 #include <array>
+#include <chrono>
+#include <boost/signals2.hpp>
+#include "workflows/versioned_snapshot.hpp"
 
 namespace hal {
 class ActuatorDriver;
@@ -107,6 +112,14 @@ public:
     explicit SystemState(std::shared_ptr<hal::ActuatorDriver> actuator);
     ~SystemState() = default;
 
+    /**
+     * @brief 把当前期望的外设状态完整重发一遍 (Moonraker 重连或 Klipper 重新 ready 后调用)
+     *
+     * 阀门和 PWM 全部重新设置; 运行中的泵在固件重启后已丢失运动, 标记为停止.
+     * 与状态切换互斥; 有切换正在进行时不等待, 由该写者结束时补做 (不阻塞调用方的 strand).
+     */
+    void resync_peripheral_state();
+
     /**
      * @brief 切换到排废状态
      */
@@ -127,11 +140,21 @@ public:
      */
     void stop_clean();
 
+    /**
+     * @brief 预先把进样泵注册到 G1 坐标轴 (REGISTER_PUMPS_TO_AXIS), 不改变阀门和状态
+     *
+     * 排废进入确认窗口时调用, 宏在确认窗口内执行完, 紧随的进样省去这一步.
+     * 有泵在运行时不做, 返回 0. 令牌只对下一次 start_inject 有效; 任何一次
+     * start_inject、ENOSE_ASYNC_STOP 或重连重同步都使其失效.
+     */
+    uint64_t prepare_inject();
+
     /**
      * @brief 开始进样
      * @param params 进样参数 (每个泵的进样量)
+     * @param prepared prepare_inject 返回的令牌; 仍有效时跳过 REGISTER_PUMPS_TO_AXIS
      */
-    void start_inject(const InjectionParams& params);
+    void start_inject(const InjectionParams& params, uint64_t prepared = 0);
 
     /**
      * @brief 停止进样，返回初始状态
@@ -143,15 +166,36 @@ public:
      */
     void transition_to(State target_state);
 
+    /**
+     * @brief 已应用到硬件的系统状态与外设状态 (一次切换完成后整体发布)
+     */
+    struct Snapshot {
+        State state;
+        PeripheralState peripheral;
+    };
+    using SnapshotPtr = std::shared_ptr<const VersionedSnapshot<Snapshot>::Value>;
+
+    /**
+     * @brief 最新发布的状态快照 (无锁, 不等待进行中的切换)
+     */
+    SnapshotPtr snapshot() const { return snapshot_.load(); }
+
+    /**
+     * @brief 等到快照版本号大于 after_version 或超时 (长轮询)
+     */
+    SnapshotPtr wait_for_change(uint64_t after_version, std::chrono::milliseconds timeout) const {
+        return snapshot_.wait_newer(after_version, timeout);
+    }
+
     /**
      * @brief 获取当前状态
      */
-    State get_state() const { return current_state_; }
+    State get_state() const { return snapshot()->data.state; }
 
     /**
      * @brief 获取当前外设状态快照
      */
-    const PeripheralState& get_peripheral_state() const { return current_peripheral_state_; }
+    PeripheralState get_peripheral_state() const { return snapshot()->data.peripheral; }
 
     /**
      * @brief 获取指定系统状态对应的外设状态
@@ -173,13 +217,40 @@ public:
      */
     bool is_any_pump_running() const;
 
+    /**
+     * @brief 外设状态变化 (新状态), 在修改状态的线程上同步发出
+     *
+     * 每次应用到硬件的状态与上次发出的不同才触发; SubscribePeripheralStatus 据此立即推送.
+     */
+    boost::signals2::signal<void(const PeripheralState&)> on_peripheral_state_changed;
+
 private:
+    // 持有 writer_mutex_; 析构时补做持锁期间请求的重同步
+    struct WriterGuard;
+
+    // 以下在持有 writer_mutex_ 时调用
+    bool transition_locked(State target_state, State& old_state);
+    void resync_locked();
     void apply_peripheral_state(const PeripheralState& state);
+    void notify_peripheral_state();
+
+    void run_pending_resync();
 
     std::shared_ptr<hal::ActuatorDriver> actuator_;
+    // 写者 (实验 / gRPC / io 线程上的切换与泵控制, 重连后的重同步) 互斥;
+    // state_callback_ 在释放后调用, 回调方 (HardwareStateMachine) 持自己的锁再切换时不会死锁
+    std::mutex writer_mutex_;
+    std::atomic<bool> resync_pending_{false};
+    uint64_t inject_prepared_{0};       // 当前有效的 prepare_inject 令牌, 0 表示未注册
+    uint64_t next_prepare_token_{0};
+    // 写者的工作副本 (切换过程中逐步修改), 读者只看 snapshot_
     State current_state_{State::INITIAL};
     PeripheralState current_peripheral_state_;
+    PeripheralState notified_peripheral_state_;
+    VersionedSnapshot<Snapshot> snapshot_;
     StateCallback state_callback_;
+    boost::signals2::scoped_connection link_connection_;
+    boost::signals2::scoped_connection ready_connection_;
 
     // 状态定义表
     static const PeripheralState STATE_DEFINITIONS[];
@@ -96,7 +96,7 @@ void TestController::stop_test() {
     }
 }
 
-TestStatus TestController::get_status() const {
+TestStatus TestController::get_status(uint64_t after_log_index) const {
     std::lock_guard<std::mutex> lock(mutex_);
     
     TestStatus status;
@@ -125,8 +125,13 @@ TestStatus TestController::get_status() const {
     status.message = message_;
     status.dynamic_empty_weight = dynamic_empty_weight_;
     
-    // 复制最近日志
-    status.logs.assign(logs_.begin(), logs_.end());
+    // 只复制新增日志
+    auto batch = logs_.read_after(after_log_index);
+    status.logs.reserve(batch.entries.size());
+    for (auto& entry : batch.entries) {
+        status.logs.push_back(std::move(entry.text));
+    }
+    status.last_log_index = batch.last_index;
     
     return status;
 }
@@ -187,19 +192,8 @@ void TestController::record_weight_sample(const std::string& phase) {
 }
 
 void TestController::add_log(const std::string& msg) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&time_t);
-    
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%H:%M:%S") << " " << msg;
-    std::string log_entry = oss.str();
-    
-    logs_.push_back(log_entry);
-    if (logs_.size() > MAX_LOGS) {
-        logs_.pop_front();
-    }
-    
+    // 无锁写入, 持有 mutex_ 时也可调用
+    logs_.push(msg);
     spdlog::info("TestController: {}", msg);
 }
 
@@ -472,6 +466,10 @@ void TestController::run_single_cycle(const ParamSet& param_set, int cycle_num)
         add_log(oss.str());
     }
     
+    if (on_result_) {
+        on_result_(result);
+    }
+    
     // 写入数据库
     if (repository_ && current_run_id_ > 0) {
         repository_->insert_result(current_run_id_, result);
@@ -2,7 +2,6 @@
 
 #include <atomic>
 #include <chrono>
-#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -10,6 +9,7 @@
 #include <string>
 #include <thread>
 #include <vector>
+#include "workflows/log_ring.hpp"
 
 namespace db {
     class TestRunRepository;
@@ -91,7 +91,8 @@ struct TestStatus {
     int global_total_cycles;    // 全局总循环数
     std::string current_param_name;
     std::string message;
-    std::vector<std::string> logs;  // 最近日志
+    std::vector<std::string> logs;  // 序号大于请求游标的日志
+    uint64_t last_log_index{0};     // 下次查询的游标
     std::optional<float> dynamic_empty_weight;
 };
 
@@ -101,6 +102,7 @@ using StartInjectionFunc = std::function<bool(float p0, float p1, float p2, floa
 using WaitForEmptyBottleFunc = std::function<std::pair<bool, float>(float tolerance, float timeout_sec, float stability_window_sec)>;
 using GetWeightFunc = std::function<std::pair<float, bool>()>;  // 返回 (weight, is_stable)
 using ResetDynamicEmptyWeightFunc = std::function<void()>;
+using ResultFunc = std::function<void(const TestResult& result)>;  // 每次循环完成 (测试线程)
 
 class TestController {
 public:
@@ -114,6 +116,7 @@ public:
     void set_wait_empty_callback(WaitForEmptyBottleFunc func) { wait_for_empty_bottle_ = std::move(func); }
     void set_get_weight_callback(GetWeightFunc func) { get_weight_ = std::move(func); }
     void set_reset_empty_weight_callback(ResetDynamicEmptyWeightFunc func) { reset_dynamic_empty_weight_ = std::move(func); }
+    void set_result_callback(ResultFunc func) { on_result_ = std::move(func); }
 
     // 启动测试
     bool start_test(const TestConfig& config);
@@ -121,8 +124,8 @@ public:
     // 停止测试
     void stop_test();
     
-    // 获取状态
-    TestStatus get_status() const;
+    // 获取状态 (只带序号大于 after_log_index 的日志)
+    TestStatus get_status(uint64_t after_log_index = 0) const;
     
     // 获取结果
     std::vector<TestResult> get_results() const;
@@ -147,6 +150,7 @@ private:
     WaitForEmptyBottleFunc wait_for_empty_bottle_;
     GetWeightFunc get_weight_;
     ResetDynamicEmptyWeightFunc reset_dynamic_empty_weight_;
+    ResultFunc on_result_;
 
     // 状态
     mutable std::mutex mutex_;
@@ -164,9 +168,8 @@ private:
     std::string current_param_name_;
     std::string message_;
     
-    // 日志 (保留最近100条)
-    std::deque<std::string> logs_;
-    static constexpr size_t MAX_LOGS = 100;
+    // 日志 (无锁环, 保留最近 LogRing::CAPACITY 条)
+    LogRing logs_;
     
     // 结果
     std::vector<TestResult> results_;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace workflows {
+
+/**
+ * @brief 带版本号的不可变快照 (发布时写者串行, 任意线程无锁读取)
+ *
+ * 写者每次修改完成后整体发布一份新快照, 版本号加一; 读者 load() 只做一次原子读,
+ * 拿到的快照在持有期间不会变化, 与进行中的状态切换互不阻塞.
+ * wait_newer() 供长轮询使用: 等到版本号大于给定值或超时. 等待者只在条件变量上阻塞,
+ * 发布用的锁只在写者之间和等待者检查版本号的瞬间竞争, load() 从不加锁.
+ */
+template <typename T>
+class VersionedSnapshot {
+public:
+    struct Value {
+        uint64_t version;
+        T data;
+    };
+
+    explicit VersionedSnapshot(T initial = {})
+        : value_(std::make_shared<const Value>(Value{1, std::move(initial)})) {}
+
+    VersionedSnapshot(const VersionedSnapshot&) = delete;
+    VersionedSnapshot& operator=(const VersionedSnapshot&) = delete;
+
+    std::shared_ptr<const Value> load() const { return value_.load(std::memory_order_acquire); }
+
+    uint64_t version() const { return load()->version; }
+
+    /** @brief 发布新快照, 返回其版本号 */
+    uint64_t publish(T data) {
+        auto next = std::make_shared<Value>(Value{0, std::move(data)});
+        uint64_t version;
+        {
+            // 写者之间串行 (版本号与发布顺序一致), 同时与等待者的谓词检查互斥, 避免丢失唤醒
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            version = load()->version + 1;
+            next->version = version;
+            value_.store(std::move(next), std::memory_order_release);
+        }
+        changed_.notify_all();
+        return version;
+    }
+
+    /**
+     * @brief 等到版本号大于 after_version 或超时
+     * @return 最新快照 (超时时版本号可能仍不大于 after_version)
+     */
+    std::shared_ptr<const Value> wait_newer(uint64_t after_version, std::chrono::milliseconds timeout) const {
+        auto current = load();
+        if (current->version > after_version || timeout <= std::chrono::milliseconds::zero()) {
+            return current;
+        }
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        changed_.wait_for(lock, timeout, [&] {
+            current = load();
+            return current->version > after_version;
+        });
+        return current;
+    }
+
+private:
+    std::atomic<std::shared_ptr<const Value>> value_;
+    mutable std::mutex wait_mutex_;
+    mutable std::condition_variable changed_;
+};
+
+} // namespace workflows
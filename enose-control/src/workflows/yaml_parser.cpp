@@ -179,6 +179,74 @@ static bool parse_step(const YAML::Node& node, experiment::Step* step, std::stri
             }
         }
     }
+    else if (node["sweep"]) {
+        auto* action = step->mutable_sweep();
+        auto sweep = node["sweep"];
+        
+        // mode: grid (默认) / zip / latin_hypercube
+        const std::string mode = sweep["mode"] ? sweep["mode"].as<std::string>() : "grid";
+        if (mode == "grid") {
+            action->set_mode(experiment::SWEEP_GRID);
+        } else if (mode == "zip") {
+            action->set_mode(experiment::SWEEP_ZIP);
+        } else if (mode == "latin_hypercube" || mode == "lhs") {
+            action->set_mode(experiment::SWEEP_LATIN_HYPERCUBE);
+        } else {
+            error = "步骤 '" + step->name() + "' 的扫描模式未知: " + mode;
+            return false;
+        }
+        
+        if (sweep["samples"]) {
+            action->set_samples(sweep["samples"].as<int>());
+        }
+        if (sweep["seed"]) {
+            action->set_seed(sweep["seed"].as<uint64_t>());
+        }
+        if (sweep["balance"]) {
+            action->set_balance_liquid_id(sweep["balance"].as<std::string>());
+        }
+        
+        // 变量: range: [min, max, points] 或 min / max / points 或 values: [...]
+        if (sweep["variables"] && sweep["variables"].IsSequence()) {
+            for (const auto& var_node : sweep["variables"]) {
+                auto* var = action->add_variables();
+                if (var_node["liquid_id"]) {
+                    var->set_liquid_id(var_node["liquid_id"].as<std::string>());
+                }
+                if (var_node["range"] && var_node["range"].IsSequence()) {
+                    auto range = var_node["range"];
+                    if (range.size() >= 2) {
+                        var->set_min(range[0].as<double>());
+                        var->set_max(range[1].as<double>());
+                    }
+                    var->set_points(range.size() >= 3 ? range[2].as<int>() : 2);
+                }
+                if (var_node["min"]) {
+                    var->set_min(var_node["min"].as<double>());
+                }
+                if (var_node["max"]) {
+                    var->set_max(var_node["max"].as<double>());
+                }
+                if (var_node["points"]) {
+                    var->set_points(var_node["points"].as<int>());
+                }
+                if (var_node["values"] && var_node["values"].IsSequence()) {
+                    for (const auto& value : var_node["values"]) {
+                        var->add_values(value.as<double>());
+                    }
+                }
+            }
+        }
+        
+        if (sweep["steps"]) {
+            for (const auto& sub_step_node : sweep["steps"]) {
+                auto* sub_step = action->add_steps();
+                if (!parse_step(sub_step_node, sub_step, error)) {
+                    return false;
+                }
+            }
+        }
+    }
     else if (node["wash"]) {
         auto* action = step->mutable_wash();
         auto wash = node["wash"];
@@ -233,6 +301,29 @@ static bool parse_step(const YAML::Node& node, experiment::Step* step, std::stri
         } else {
             action->set_empty_stability_window_s(2.0);
         }
+        
+        // 自适应终止: until: baseline 时 repeat_count 为最少次数
+        if (wash["until"]) {
+            auto until = wash["until"].as<std::string>();
+            if (until == "baseline") {
+                action->set_mode(experiment::WASH_MODE_UNTIL_BASELINE);
+            } else if (until != "fixed") {
+                error = "步骤 '" + step->name() + "' 的 wash.until 必须是 baseline 或 fixed: " + until;
+                return false;
+            }
+        }
+        if (wash["baseline_tolerance"]) {
+            action->set_baseline_tolerance(wash["baseline_tolerance"].as<double>());
+        }
+        if (wash["max_cycles"]) {
+            action->set_max_cycles(wash["max_cycles"].as<int>());
+        }
+        if (wash["recovery_timeout_s"]) {
+            action->set_recovery_timeout_s(wash["recovery_timeout_s"].as<double>());
+        }
+        if (wash["recovery_frames"]) {
+            action->set_recovery_frames(wash["recovery_frames"].as<int>());
+        }
     }
     else {
         error = "步骤 '" + step->name() + "' 缺少动作定义";
@@ -242,39 +333,38 @@ static bool parse_step(const YAML::Node& node, experiment::Step* step, std::stri
     return true;
 }
 
-YamlParser::ParseResult YamlParser::parse(const std::string& yaml_content) {
-    ParseResult result;
-    
+bool YamlParser::parse_into(const std::string& yaml_content, experiment::ExperimentProgram& program,
+                            std::string& error) {
     try {
         YAML::Node root = YAML::Load(yaml_content);
         
         // 解析基本信息
         if (root["id"]) {
-            result.program.set_id(root["id"].as<std::string>());
+            program.set_id(root["id"].as<std::string>());
         } else {
-            result.error_message = "程序缺少 id 字段";
-            return result;
+            error = "程序缺少 id 字段";
+            return false;
         }
         
         if (root["name"]) {
-            result.program.set_name(root["name"].as<std::string>());
+            program.set_name(root["name"].as<std::string>());
         } else {
-            result.error_message = "程序缺少 name 字段";
-            return result;
+            error = "程序缺少 name 字段";
+            return false;
         }
         
         if (root["description"]) {
-            result.program.set_description(root["description"].as<std::string>());
+            program.set_description(root["description"].as<std::string>());
         }
         
         if (root["version"]) {
-            result.program.set_version(root["version"].as<std::string>());
+            program.set_version(root["version"].as<std::string>());
         } else {
-            result.program.set_version("1.0.0");
+            program.set_version("1.0.0");
         }
         
         // 解析硬件约束
-        auto* hardware = result.program.mutable_hardware();
+        auto* hardware = program.mutable_hardware();
         if (root["hardware"]) {
             auto hw = root["hardware"];
             if (hw["bottle_capacity_ml"]) {
@@ -344,29 +434,34 @@ YamlParser::ParseResult YamlParser::parse(const std::string& yaml_content) {
         
         // 解析步骤
         if (!root["steps"] || !root["steps"].IsSequence()) {
-            result.error_message = "程序缺少 steps 列表";
-            return result;
+            error = "程序缺少 steps 列表";
+            return false;
         }
         
         for (const auto& step_node : root["steps"]) {
-            auto* step = result.program.add_steps();
-            if (!parse_step(step_node, step, result.error_message)) {
-                return result;
+            auto* step = program.add_steps();
+            if (!parse_step(step_node, step, error)) {
+                return false;
             }
         }
         
-        result.success = true;
         spdlog::info("YAML 解析成功: {} ({}个步骤)", 
-                     result.program.name(), result.program.steps_size());
+                     program.name(), program.steps_size());
+        return true;
         
     } catch (const YAML::Exception& e) {
-        result.error_message = std::string("YAML 解析错误: ") + e.what();
-        spdlog::error("{}", result.error_message);
+        error = std::string("YAML 解析错误: ") + e.what();
+        spdlog::error("{}", error);
     } catch (const std::exception& e) {
-        result.error_message = std::string("解析错误: ") + e.what();
-        spdlog::error("{}", result.error_message);
+        error = std::string("解析错误: ") + e.what();
+        spdlog::error("{}", error);
     }
-    
+    return false;
+}
+
+YamlParser::ParseResult YamlParser::parse(const std::string& yaml_content) {
+    ParseResult result;
+    result.success = parse_into(yaml_content, result.program, result.error_message);
     return result;
 }
 
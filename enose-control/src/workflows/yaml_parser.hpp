@@ -26,6 +26,17 @@ public:
      * @return 解析结果
      */
     static ParseResult parse(const std::string& yaml_content);
+    
+    /**
+     * 解析到调用方提供的消息 (可分配在 Arena 上, 避免解析结果再整体复制一次)
+     * 
+     * @param program 输出; 失败时内容不完整
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    static bool parse_into(const std::string& yaml_content,
+                           ::enose::experiment::ExperimentProgram& program,
+                           std::string& error);
 };
 
 } // namespace workflows
@@ -4,63 +4,139 @@
  */
 
 #include "cmd_handler.h"
+#include "loop_profiler.h"
+#include "utils.h"
 
 CmdHandler::CmdHandler() 
     : _serial(nullptr), _serial2(nullptr), _activeSerial(nullptr), 
-      _sensors(nullptr), _isRunning(false) {}
+      _sensors(nullptr), _isRunning(false), _format(OutputFormat::JSON),
+      _batchSize(0) {}
 
 void CmdHandler::begin(Stream& primary, Stream* secondary) {
     _serial = &primary;
     _serial2 = secondary;
     _activeSerial = _serial;  // 默认使用主串口
-    _buffer.reserve(512);
-    _buffer2.reserve(512);
+    _rx.serial = _serial;
+    _rx2.serial = _serial2;
 }
 
-bool CmdHandler::processSerial(Stream* serial, String& buffer) {
-    if (!serial) return false;
+void CmdHandler::replyOn(Stream* serial, int code, const char* msg) {
+    // 协议错误回给出错的串口, 不切换活跃串口
+    Stream* oldActive = _activeSerial;
+    _activeSerial = serial;
+    sendError(0, code, msg);
+    _activeSerial = oldActive;
+}
+
+bool CmdHandler::processSerial(RxPort& port, uint32_t startUs) {
+    if (!port.serial) return false;
+    Stream* serial = port.serial;
     
     while (serial->available()) {
-        char c = serial->read();
-        if (c == '\n') {
-            if (buffer.length() > 0) {
-                StaticJsonDocument<1024> doc;
-                DeserializationError err = deserializeJson(doc, buffer);
-                buffer = "";
-                
-                if (!err) {
-                    // 切换到收到命令的串口
-                    _activeSerial = serial;
-                    handleCommand(doc);
-                    return true;
+        if (micros() - startUs >= CMD_PROCESS_BUDGET_US) {
+            break;  // 剩余字节留到下一轮
+        }
+        uint8_t c = (uint8_t)serial->read();
+        
+        switch (port.mode) {
+        case RxMode::IDLE:
+            if (c == 0x02) {
+                // 二进制命令帧: reserved = 0 使 COBS 首字节固定为 0x02
+                port.mode = RxMode::BINARY_FRAME;
+            } else if (c == '\n' || c == '\r' || c == 0x00) {
+                break;
+            } else {
+                // 其他字节按 JSON 行接收, 非 JSON 内容在行尾报解析错误
+                port.mode = RxMode::JSON_LINE;
+            }
+            port.len = 0;
+            port.buf[port.len++] = c;
+            break;
+            
+        case RxMode::JSON_LINE:
+            if (c == '\n') {
+                handleLine(port);
+                port.mode = RxMode::IDLE;
+                return true;
+            }
+            if (c == 0x00) {
+                // 行中出现帧结束符: 上位机切换了格式或线路噪声, 丢弃半行
+                port.mode = RxMode::IDLE;
+            } else if (c != '\r') {
+                if (port.len >= CMD_LINE_MAX) {
+                    port.mode = RxMode::DISCARD;
+                    replyOn(serial, -2, "BUFFER_OVERFLOW");
                 } else {
-                    Stream* oldActive = _activeSerial;
-                    _activeSerial = serial;
-                    sendError(0, -1, "JSON_PARSE_ERROR");
-                    _activeSerial = oldActive;
+                    port.buf[port.len++] = c;
                 }
             }
-        } else if (c != '\r') {
-            buffer += c;
-            if (buffer.length() > 1024) {
-                buffer = "";
-                Stream* oldActive = _activeSerial;
-                _activeSerial = serial;
-                sendError(0, -2, "BUFFER_OVERFLOW");
-                _activeSerial = oldActive;
+            break;
+            
+        case RxMode::BINARY_FRAME:
+            if (c == 0x00) {
+                handleFrame(port);
+                port.mode = RxMode::IDLE;
+                return true;
+            }
+            if (port.len >= CMD_LINE_MAX) {
+                port.mode = RxMode::DISCARD;
+                replyOn(serial, -2, "BUFFER_OVERFLOW");
+            } else {
+                port.buf[port.len++] = c;
             }
+            break;
+            
+        case RxMode::DISCARD:
+            if (c == '\n' || c == 0x00) {
+                port.mode = RxMode::IDLE;
+            }
+            break;
         }
     }
     return false;
 }
 
+void CmdHandler::handleLine(RxPort& port) {
+    // 原地解析: 文档中的字符串直接指向 port.buf, 处理完命令前缓冲区保持不变
+    port.buf[port.len] = '\0';
+    DeserializationError err = deserializeJson(_doc, (char*)port.buf, port.len);
+    if (err) {
+        replyOn(port.serial, -1, "JSON_PARSE_ERROR");
+        return;
+    }
+    // 切换到收到命令的串口
+    _activeSerial = port.serial;
+    handleCommand(_doc);
+}
+
+void CmdHandler::handleFrame(RxPort& port) {
+    int rawLen = FrameCodec::decodeFrame(port.buf, port.len);
+    if (rawLen < 1) {
+        replyOn(port.serial, -13, "FRAME_ERROR");
+        return;
+    }
+    _activeSerial = port.serial;
+    
+    const uint8_t* payload = port.buf + 1;
+    size_t payloadLen = rawLen - 1;
+    switch (port.buf[0]) {
+    case FRAME_TYPE_CMD_HEATER:
+        cmdHeaterFrame(payload, payloadLen);
+        break;
+    default:
+        sendError(0, -4, "UNKNOWN_CMD");
+        break;
+    }
+}
+
 bool CmdHandler::process() {
+    uint32_t startUs = micros();
     // 先检查主串口
-    if (processSerial(_serial, _buffer)) {
+    if (processSerial(_rx, startUs)) {
         return true;
     }
     // 再检查备用串口
-    if (processSerial(_serial2, _buffer2)) {
+    if (processSerial(_rx2, startUs)) {
         return true;
     }
     return false;
@@ -76,7 +152,7 @@ void CmdHandler::handleCommand(const JsonDocument& doc) {
     }
     
     if (strcmp(cmd, "sync") == 0) {
-        cmdSync(id);
+        cmdSync(id, doc);
     } else if (strcmp(cmd, "init") == 0) {
         cmdInit(id, doc);
     } else if (strcmp(cmd, "config") == 0) {
@@ -89,13 +165,54 @@ void CmdHandler::handleCommand(const JsonDocument& doc) {
         cmdStatus(id);
     } else if (strcmp(cmd, "reset") == 0) {
         cmdReset(id);
+    } else if (strcmp(cmd, "replay") == 0) {
+        cmdReplay(id, doc);
+    } else if (strcmp(cmd, "stats") == 0) {
+        cmdStats(id, doc);
     } else {
         sendError(id, -4, "UNKNOWN_CMD");
     }
 }
 
-void CmdHandler::cmdSync(int id) {
-    sendAckWith(id, true, "tick_ms", (uint32_t)millis());
+void CmdHandler::cmdSync(int id, const JsonDocument& doc) {
+    // 可选协商数据格式: params.format = "bin" | "json", 省略则保持不变
+    const char* format = doc["params"]["format"];
+    if (format) {
+        if (strcmp(format, "bin") == 0) {
+            _format = OutputFormat::BINARY;
+        } else if (strcmp(format, "json") == 0) {
+            _format = OutputFormat::JSON;
+        } else {
+            sendError(id, -11, "UNKNOWN_FORMAT");
+            return;
+        }
+    }
+    
+    // 可选批量条数: params.batch = 0..DATA_BATCH_MAX
+    JsonVariantConst batch = doc["params"]["batch"];
+    if (!batch.isNull()) {
+        uint8_t n = batch.as<uint8_t>();
+        _batchSize = (n > DATA_BATCH_MAX) ? DATA_BATCH_MAX : n;
+    }
+    
+    // 时钟同步: 尽量靠近收到命令的时刻取时间; 上位机的令牌 t 原样回显
+    uint64_t nowUs = utils::getTickUs();
+    
+    StaticJsonDocument<256> resp;
+    resp["type"] = "ack";
+    resp["id"] = id;
+    resp["ok"] = true;
+    resp["tick_ms"] = (uint32_t)(nowUs / 1000);
+    resp["dev_us"] = nowUs;
+    JsonVariantConst token = doc["params"]["t"];
+    if (!token.isNull()) {
+        resp["t"] = token.as<int64_t>();
+    }
+    resp["format"] = (_format == OutputFormat::BINARY) ? "bin" : "json";
+    resp["batch"] = _batchSize;
+    resp["frame_ver"] = FRAME_VERSION;
+    serializeJson(resp, *_activeSerial);
+    _activeSerial->println();
 }
 
 void CmdHandler::cmdInit(int id, const JsonDocument& doc) {
@@ -126,6 +243,32 @@ void CmdHandler::cmdConfig(int id, const JsonDocument& doc) {
     }
 }
 
+void CmdHandler::cmdHeaterFrame(const uint8_t* payload, size_t len) {
+    HeaterConfigCmdWire cmd;
+    if (len != sizeof(cmd)) {
+        sendError(0, EDK_SENSOR_MANAGER_JSON_FORMAT_ERROR, "CONFIG_FAILED");
+        return;
+    }
+    memcpy(&cmd, payload, sizeof(cmd));
+    
+    if (!_onHeater) {
+        sendError(cmd.id, -7, "NO_CONFIG_HANDLER");
+        return;
+    }
+    // 紧凑结构体的数组成员可能未对齐, 拷贝后再交给回调
+    uint16_t temps[HEATER_PROFILE_MAX];
+    uint16_t durs[HEATER_PROFILE_MAX];
+    memcpy(temps, payload + offsetof(HeaterConfigCmdWire, temps), sizeof(temps));
+    memcpy(durs, payload + offsetof(HeaterConfigCmdWire, durs), sizeof(durs));
+    demoRetCode ret = _onHeater(cmd.sensor_mask, temps, durs, cmd.length,
+                                (cmd.flags & HEATER_CMD_FLAG_NOW) != 0);
+    if (ret >= EDK_OK) {
+        sendAck(cmd.id, true);
+    } else {
+        sendError(cmd.id, ret, "CONFIG_FAILED");
+    }
+}
+
 void CmdHandler::cmdStart(int id, const JsonDocument& doc) {
     if (_isRunning) {
         sendError(id, -6, "ALREADY_RUNNING");
@@ -134,15 +277,16 @@ void CmdHandler::cmdStart(int id, const JsonDocument& doc) {
     
     std::vector<uint8_t> sensorList;
     JsonArrayConst sensors = doc["params"]["sensors"];
+    uint8_t count = _sensors ? _sensors->getSensorCount() : 8;
     
     if (sensors.isNull()) {
-        for (uint8_t i = 0; i < 8; i++) {
+        for (uint8_t i = 0; i < count; i++) {
             sensorList.push_back(i);
         }
     } else {
         for (JsonVariantConst v : sensors) {
             uint8_t idx = v.as<uint8_t>();
-            if (idx < 8) {
+            if (idx < count) {
                 sensorList.push_back(idx);
             }
         }
@@ -164,7 +308,7 @@ void CmdHandler::cmdStop(int id) {
 }
 
 void CmdHandler::cmdStatus(int id) {
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<1024> doc;
     doc["type"] = "status";
     doc["id"] = id;
     doc["tick_ms"] = (uint32_t)millis();
@@ -181,6 +325,11 @@ void CmdHandler::cmdStatus(int id) {
         }
     }
     
+    // 附加运行时统计 (由 main 提供)
+    if (_onStatus) {
+        _onStatus(doc);
+    }
+    
     serializeJson(doc, *_activeSerial);
     _activeSerial->println();
 }
@@ -191,6 +340,52 @@ void CmdHandler::cmdReset(int id) {
     ESP.restart();
 }
 
+void CmdHandler::cmdReplay(int id, const JsonDocument& doc) {
+    if (!_onReplay) {
+        sendError(id, -12, "NO_HISTORY");
+        return;
+    }
+    
+    uint32_t fromSeq = doc["params"]["from_seq"] | 1UL;
+    uint32_t toSeq = doc["params"]["to_seq"] | 0UL;
+    uint32_t first = 0, last = 0;
+    if (!_onReplay(fromSeq, toSeq, first, last)) {
+        sendError(id, -12, "NO_HISTORY");
+        return;
+    }
+    
+    // 补发的读数随后以普通 data 消息发出, 可与实时数据交错
+    StaticJsonDocument<192> resp;
+    resp["type"] = "ack";
+    resp["id"] = id;
+    resp["ok"] = true;
+    resp["from_seq"] = first;
+    resp["to_seq"] = last;
+    serializeJson(resp, *_activeSerial);
+    _activeSerial->println();
+}
+
+void CmdHandler::cmdStats(int id, const JsonDocument& doc) {
+    #if LOOP_PROFILE
+    StaticJsonDocument<STATS_DOC_SIZE> resp;
+    resp["type"] = "stats";
+    resp["id"] = id;
+    resp["tick_ms"] = (uint32_t)millis();
+    resp["cpu_mhz"] = getCpuFrequencyMhz();
+    loopProfiler.toJson(resp);
+    serializeJson(resp, *_activeSerial);
+    _activeSerial->println();
+    
+    // params.reset = true: 应答之后清零, 下一次 stats 只含此后的样本
+    if (doc["params"]["reset"] | false) {
+        loopProfiler.reset();
+    }
+    #else
+    (void)doc;
+    sendError(id, -14, "PROFILE_DISABLED");
+    #endif
+}
+
 void CmdHandler::sendAck(int id, bool ok) {
     StaticJsonDocument<128> doc;
     doc["type"] = "ack";
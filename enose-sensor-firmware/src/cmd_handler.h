@@ -1,6 +1,12 @@
 /**
  * @file    cmd_handler.h
  * @brief   串口命令处理器 - 处理来自树莓派上位机的命令
+ * 
+ * 每个串口一块固定的接收缓冲区, 按首字节逐字节切分消息:
+ *   '{' ... '\n'   JSON 命令行, 在缓冲区内原地解析 (字符串不拷贝)
+ *   0x02 ... 0x00  COBS 二进制命令帧 (见 frame_codec.h)
+ * 接收与解析都不分配堆内存; 每次 process() 读取字节的时间不超过 CMD_PROCESS_BUDGET_US,
+ * 剩余字节留到下一轮, 命令突发时也不会长时间占用通讯任务。
  */
 
 #ifndef CMD_HANDLER_H
@@ -12,6 +18,7 @@
 #include <vector>
 #include "demo_app.h"
 #include "core/sensor_array.h"
+#include "frame_codec.h"
 
 class CmdHandler {
 public:
@@ -19,6 +26,14 @@ public:
     using StopCallback = std::function<void()>;
     using InitCallback = std::function<demoRetCode(const String&)>;
     using ConfigCallback = std::function<demoRetCode(const JsonDocument&)>;
+    // 二进制加热曲线命令: sensorMask 为 0 表示全部 BME688 通道, immediate 为 false 时在周期边界生效
+    using HeaterCallback = std::function<demoRetCode(uint32_t sensorMask, const uint16_t* temps,
+                                                     const uint16_t* durs, uint8_t length, bool immediate)>;
+    using StatusCallback = std::function<void(JsonDocument&)>;
+    // 补发请求: 输入请求区间 [fromSeq, toSeq] (toSeq = 0 表示到最新),
+    // 输出实际可补发的区间 [first, last], 返回 false 表示无历史
+    using ReplayCallback = std::function<bool(uint32_t fromSeq, uint32_t toSeq,
+                                              uint32_t& first, uint32_t& last)>;
 
     CmdHandler();
     
@@ -28,6 +43,9 @@ public:
     void setStopCallback(StopCallback cb) { _onStop = cb; }
     void setInitCallback(InitCallback cb) { _onInit = cb; }
     void setConfigCallback(ConfigCallback cb) { _onConfig = cb; }
+    void setHeaterCallback(HeaterCallback cb) { _onHeater = cb; }
+    void setStatusCallback(StatusCallback cb) { _onStatus = cb; }
+    void setReplayCallback(ReplayCallback cb) { _onReplay = cb; }
     void setSensorArray(ISensorArray* sensors) { _sensors = sensors; }
     
     /**
@@ -57,31 +75,63 @@ public:
      */
     Stream* getActiveSerial() { return _activeSerial ? _activeSerial : _serial; }
     
+    /**
+     * @brief 获取 sync 命令协商的数据上报格式
+     */
+    OutputFormat getOutputFormat() const { return _format; }
+    
+    /**
+     * @brief 获取 sync 命令协商的批量上报条数 (0 = 不批量)
+     */
+    uint8_t getBatchSize() const { return _batchSize; }
+    
 private:
+    // 接收状态: DISCARD 丢弃溢出消息的剩余字节, 直到下一个 '\n' / 0x00
+    enum class RxMode : uint8_t { IDLE, JSON_LINE, BINARY_FRAME, DISCARD };
+    
+    struct RxPort {
+        Stream* serial = nullptr;
+        RxMode mode = RxMode::IDLE;
+        uint16_t len = 0;
+        uint8_t buf[CMD_LINE_MAX + 1];  // +1 留给 JSON 行的结束符 '\0'
+    };
+    
     Stream* _serial;           // 主串口 (USB)
     Stream* _serial2;          // 备用串口 (GPIO 16/17)
     Stream* _activeSerial;     // 当前活跃的串口 (收到命令的那个)
-    String _buffer;
-    String _buffer2;           // 第二个串口的缓冲区
+    RxPort _rx;
+    RxPort _rx2;               // 第二个串口的接收状态
+    StaticJsonDocument<CMD_DOC_SIZE> _doc;  // 命令文档, 各命令复用
     
     StartCallback _onStart;
     StopCallback _onStop;
     InitCallback _onInit;
     ConfigCallback _onConfig;
+    HeaterCallback _onHeater;
+    StatusCallback _onStatus;
+    ReplayCallback _onReplay;
     ISensorArray* _sensors;
     
     bool _isRunning;
+    OutputFormat _format;      // 数据上报格式 (默认 JSON)
+    uint8_t _batchSize;        // 批量上报条数 (仅二进制格式)
     
-    bool processSerial(Stream* serial, String& buffer);
+    bool processSerial(RxPort& port, uint32_t startUs);
+    void handleLine(RxPort& port);
+    void handleFrame(RxPort& port);
+    void replyOn(Stream* serial, int code, const char* msg);
     
     void handleCommand(const JsonDocument& doc);
-    void cmdSync(int id);
+    void cmdHeaterFrame(const uint8_t* payload, size_t len);
+    void cmdSync(int id, const JsonDocument& doc);
     void cmdInit(int id, const JsonDocument& doc);
     void cmdConfig(int id, const JsonDocument& doc);
     void cmdStart(int id, const JsonDocument& doc);
     void cmdStop(int id);
     void cmdStatus(int id);
     void cmdReset(int id);
+    void cmdReplay(int id, const JsonDocument& doc);
+    void cmdStats(int id, const JsonDocument& doc);
 };
 
 template<typename T>
@@ -47,6 +47,9 @@ const uint8_t I2C_EXPANDER_OUTPUT_DESELECT = 0xFF;
 const uint8_t I2C_EXPANDER_CONFIG_REG_ADDR = 0x03;
 const uint8_t I2C_EXPANDER_CONFIG_REG_MASK = 0x00;
 
+// Burst in progress: SPI transaction owned by commMuxBurstBegin/End
+static bool burstActive = false;
+
 /**
  * @brief Function to configure the communication across sensors
  */
@@ -100,12 +103,16 @@ int8_t commMuxWrite(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length,
 	if (comm) {
 		setChipSelect(comm->wireobj, comm->select);
 
-		comm->spiobj->beginTransaction(SPISettings(COMM_SPEED, MSBFIRST, SPI_MODE0));
+		if (!burstActive) {
+			comm->spiobj->beginTransaction(SPISettings(COMM_SPEED, MSBFIRST, SPI_MODE0));
+		}
 		comm->spiobj->transfer(reg_addr);
 		for (i = 0; i < length; i++) {
 			comm->spiobj->transfer(reg_data[i]);
 		}
-		comm->spiobj->endTransaction();
+		if (!burstActive) {
+			comm->spiobj->endTransaction();
+		}
 
 		setChipSelect(comm->wireobj, I2C_EXPANDER_OUTPUT_DESELECT);
 
@@ -126,12 +133,16 @@ int8_t commMuxRead(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *i
 	if (comm) {
 		setChipSelect(comm->wireobj, comm->select);
 
-		comm->spiobj->beginTransaction(SPISettings(COMM_SPEED, MSBFIRST, SPI_MODE0));
+		if (!burstActive) {
+			comm->spiobj->beginTransaction(SPISettings(COMM_SPEED, MSBFIRST, SPI_MODE0));
+		}
 		comm->spiobj->transfer(reg_addr);
 		for (i = 0; i < length; i++) {
 			reg_data[i] = comm->spiobj->transfer(0xFF);
 		}
-		comm->spiobj->endTransaction();
+		if (!burstActive) {
+			comm->spiobj->endTransaction();
+		}
 
 		setChipSelect(comm->wireobj, I2C_EXPANDER_OUTPUT_DESELECT);
 
@@ -141,6 +152,28 @@ int8_t commMuxRead(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *i
 	return 1;
 }
 
+/**
+ * @brief Function to start a burst of transfers under one SPI transaction
+ */
+void commMuxBurstBegin(SPIClass &spiobj)
+{
+	if (!burstActive) {
+		spiobj.beginTransaction(SPISettings(COMM_SPEED, MSBFIRST, SPI_MODE0));
+		burstActive = true;
+	}
+}
+
+/**
+ * @brief Function to end a burst of transfers
+ */
+void commMuxBurstEnd(SPIClass &spiobj)
+{
+	if (burstActive) {
+		burstActive = false;
+		spiobj.endTransaction();
+	}
+}
+
 /**
  * @brief Function to maintain a delay between communication
  */
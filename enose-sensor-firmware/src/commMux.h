@@ -88,6 +88,19 @@ int8_t commMuxWrite(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length,
  */
 int8_t commMuxRead(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr);
 
+/**
+ * @brief Function to start a burst: the SPI transaction stays open across
+ *        consecutive reads/writes (any sensor) until commMuxBurstEnd
+ * @param spiobj  : The SPIClass object shared by the sensors
+ */
+void commMuxBurstBegin(SPIClass &spiobj);
+
+/**
+ * @brief Function to end a burst started with commMuxBurstBegin
+ * @param spiobj  : The SPIClass object shared by the sensors
+ */
+void commMuxBurstEnd(SPIClass &spiobj);
+
 /**
  * @brief Function to maintain a delay between communication
  * @param period_us   : Time delay in micro secs
@@ -27,6 +27,10 @@
 #define HAS_HUMIDITY            1       // 支持湿度读取
 #define HAS_PRESSURE            1       // 支持气压读取
 
+// 同步调度: 全部传感器同时触发并行模式, 每 140 ms 的公共节拍一次性读出, 加热步骤对齐;
+// 0 = 各传感器自由运行 (旧行为)
+#define BME688_SYNC_SCHEDULE    1
+
 #endif // SENSOR_TYPE_BME688
 
 // ============================================================================
@@ -41,7 +45,12 @@
 #define ADC_TYPE                ADC_TYPE_ADS1256
 #define ADC_CS_PIN              5       // SPI 片选引脚
 #define ADC_VREF                3.3f    // 参考电压
-#define ADC_SAMPLE_INTERVAL_MS  10      // 采样间隔 (ms)
+#define ADC_SAMPLE_INTERVAL_MS  10      // 采样间隔 (ms, 仅轮询模式)
+
+// ADS1256 连续转换模式: DRDY 中断驱动的 MUX 轮转, 接 -1 则退回轮询模式
+#define ADC_DRDY_PIN            4       // ADS1256 DRDY (低有效), 与轮询模式共用 SCK/MISO/MOSI
+#define ADC_DATA_RATE_SPS       7500    // 默认数据速率, 可由 config 命令的 rate 修改
+#define ADC_PGA_GAIN            1       // 默认 PGA 增益 (1-64), 可由 config 命令的 gain 修改
 
 #define HAS_TEMPERATURE         0       // 模拟传感器无温度
 #define HAS_HUMIDITY            0
@@ -59,6 +68,42 @@
 #define SERIAL2_RX_PIN          16
 #define SERIAL2_TX_PIN          17
 
+// 二进制模式下的批量上报 (通过 sync 命令的 batch 参数启用)
+#define DATA_BATCH_MAX          8       // 单帧最多读数条数
+#define DATA_BATCH_TIMEOUT_MS   100     // 首条读数入批后最长等待时间 (ms)
+
+// 命令接收: 每个串口一块固定行缓冲, 解析不分配堆内存
+#define CMD_LINE_MAX            1024    // 单条命令 (JSON 行或 COBS 帧) 最大字节数
+#define CMD_DOC_SIZE            1024    // 命令 JSON 文档容量 (原地解析, 字符串不拷贝)
+#define CMD_PROCESS_BUDGET_US   200     // 每次 process() 读取字节的时间上限 (us)
+#define STATS_DOC_SIZE          3072    // stats 应答文档容量 (7 个计时点 + 8 路唤醒偏差, 约 120 个成员)
+
+// ============================================================================
+// 任务配置 (双核流水线)
+// ============================================================================
+// 采集任务独占 APP_CPU, 只做 SPI/ADC 读取并写入环形队列;
+// 命令处理、LED 与串口上报在 PRO_CPU 上运行, 不会拖慢加热步骤时序
+#define ACQ_TASK_CORE           1
+#define ACQ_TASK_PRIORITY       5
+#define ACQ_TASK_STACK          4096
+
+#define COMM_TASK_CORE          0
+#define COMM_TASK_PRIORITY      3
+#define COMM_TASK_STACK         8192
+
+#define READING_RING_SIZE       64      // 采集->上报队列容量 (2 的幂)
+
+// 循环计时统计 (stats 命令): 各阶段耗时与唤醒偏差的直方图, 约 7 KB RAM; 0 = 不插桩
+#define LOOP_PROFILE            1
+
+// ============================================================================
+// 读数历史 (断线补发)
+// ============================================================================
+// 每条 32 字节; 8 路 BME688 约 57 条/秒
+#define HISTORY_CAPACITY_PSRAM  (57 * 60 * 10)  // 有 PSRAM 时约 10 分钟 (~1.1 MB)
+#define HISTORY_CAPACITY_SRAM   2048            // 无 PSRAM 时约 35 秒 (64 KB)
+#define REPLAY_CHUNK            4               // 通讯任务每轮最多补发条数
+
 // ============================================================================
 // 固件版本
 // ============================================================================
@@ -5,8 +5,11 @@
  * 所有传感器实现都需要实现此接口，包括:
  * - BME688Array (数字 MOX)
  * - AnalogSensorArray (模拟 MOX, 通过 SPI ADC)
+ * - CompositeSensorArray (把上面几种拼成一个阵列)
  */
 
+#include <stdint.h>
+
 #ifndef SENSOR_ARRAY_H
 #define SENSOR_ARRAY_H
 
@@ -53,6 +56,16 @@ public:
      */
     virtual uint8_t getNextReadySensor() = 0;
     
+    /**
+     * @brief 最早有读数可取的设备时间 (ms, utils::getTickMs), 供跨阵列调度
+     * @return 截止时间, NO_DEADLINE 表示暂无; 默认 0 表示随时可查询
+     */
+    virtual uint64_t getNextDueTime() const {
+        return 0;
+    }
+    
+    static constexpr uint64_t NO_DEADLINE = UINT64_MAX;
+    
     /**
      * @brief 配置指定传感器
      * @param config 传感器配置
@@ -63,6 +76,29 @@ public:
         return SensorError::OK;
     }
     
+    /**
+     * @brief 让 configure(heater_staged = true) 暂存的配置生效
+     * 
+     * 正在循环的传感器在各自当前加热周期结束时切换, 其余立即生效; 同一批传感器
+     * 先逐个暂存再一次提交, 不会有传感器在整批暂存完之前换上新配置
+     * @param sensorMask 传感器位图, 0 表示全部
+     */
+    virtual void commitStaged(uint32_t sensorMask) {
+        (void)sensorMask;
+    }
+    
+    /**
+     * @brief 采集开始/停止通知 (持 sensorMutex 调用)
+     * 
+     * 自带后台采样的实现 (如 ADS1256 连续转换) 据此启停, 轮询实现无需处理
+     * @param on true 开始采集
+     * @param sensorMask 活跃传感器位图, 0 表示全部
+     */
+    virtual void setStreaming(bool on, uint32_t sensorMask) {
+        (void)on;
+        (void)sensorMask;
+    }
+    
     /**
      * @brief 检查传感器是否已配置
      * @param idx 传感器索引
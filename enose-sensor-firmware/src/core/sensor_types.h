@@ -30,7 +30,8 @@ enum class SensorType : uint8_t {
  * 所有传感器类型统一使用此结构上报数据
  */
 struct SensorReading {
-    uint32_t tick_ms;           // 设备时间戳 (ms)
+    uint32_t seq;               // 上报序号 (从 1 递增, 0 = 未分配)
+    uint32_t tick_ms;           // 设备时间戳 (ms, 64 位设备时钟的低 32 位)
     uint8_t  sensor_idx;        // 传感器索引
     uint32_t sensor_id;         // 传感器唯一ID
     
@@ -43,13 +44,14 @@ struct SensorReading {
     float    pressure;          // hPa
     
     // 元数据
-    uint8_t  heater_step;       // 加热器步骤索引 (仅 MOX_DIGITAL, 0-9)
+    uint8_t  heater_step;       // 加热器步骤索引 (仅 MOX_DIGITAL, 0 - heater_length-1)
     uint8_t  adc_channel;       // ADC 通道 (仅 MOX_ANALOG)
     SensorType type;            // 传感器类型
     
     // 默认构造函数
     SensorReading() 
-        : tick_ms(0)
+        : seq(0)
+        , tick_ms(0)
         , sensor_idx(0)
         , sensor_id(0)
         , primary_value(0.0f)
@@ -67,6 +69,31 @@ struct SensorReading {
     bool hasPressure() const { return !isnan(pressure); }
 };
 
+/**
+ * @brief 二进制帧中的读数布局 (小端, 紧凑排列, 共 32 字节)
+ * 
+ * 与 SensorReading 字段一一对应, 上位机 hal/sensor_frame.hpp 中有同样的定义,
+ * 修改时需两端同步并提升 FRAME_VERSION
+ */
+struct __attribute__((packed)) SensorReadingWire {
+    uint32_t seq;
+    uint32_t tick_ms;
+    uint8_t  sensor_idx;
+    uint32_t sensor_id;
+    float    primary_value;
+    float    temperature;       // NAN 表示无效
+    float    humidity;
+    float    pressure;
+    uint8_t  heater_step;
+    uint8_t  adc_channel;
+    uint8_t  type;              // SensorType
+};
+
+static_assert(sizeof(SensorReadingWire) == 32, "SensorReadingWire layout changed");
+
+// BME688 并行模式的加热曲线容量 (芯片 res_heat_0..9 / gas_wait_0..9)
+#define HEATER_PROFILE_MAX      10
+
 /**
  * @brief 传感器配置结构 (用于动态配置)
  */
@@ -75,9 +102,10 @@ struct SensorConfig {
     uint8_t sensor_idx;
     
     // MOX_DIGITAL 专用: 加热器配置
-    uint16_t heater_temps[10];      // 温度数组 (°C)
-    uint16_t heater_durations[10];  // 持续时间数组 (ms 因子)
-    uint8_t  heater_length;         // 加热器步骤数量 (1-10)
+    uint16_t heater_temps[HEATER_PROFILE_MAX];      // 温度数组 (°C)
+    uint16_t heater_durations[HEATER_PROFILE_MAX];  // 持续时间数组 (ms 因子)
+    uint8_t  heater_length;         // 加热器步骤数量 (1-HEATER_PROFILE_MAX)
+    bool     heater_staged;         // true: 只暂存, 由 commitStaged() 在周期边界生效
     
     // MOX_ANALOG 专用: ADC 配置
     float    adc_vref;              // 参考电压 (V)
@@ -87,6 +115,7 @@ struct SensorConfig {
     SensorConfig() 
         : sensor_idx(0)
         , heater_length(10)
+        , heater_staged(false)
         , adc_vref(3.3f)
         , adc_sample_rate(100)
         , adc_gain(1)
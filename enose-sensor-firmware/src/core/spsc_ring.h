@@ -0,0 +1,85 @@
+/**
+ * @file    spsc_ring.h
+ * @brief   单生产者/单消费者无锁环形队列
+ * 
+ * 用于采集任务 (生产者) 与上报任务 (消费者) 之间跨核传递 SensorReading,
+ * 两端各自只写自己的索引, 不需要互斥锁
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * @brief SPSC 环形队列
+ * @tparam T 元素类型 (需可拷贝)
+ * @tparam N 容量, 必须为 2 的幂; 实际可存 N - 1 个元素
+ */
+template<typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0) {}
+
+    /**
+     * @brief 入队 (仅生产者调用)
+     * @return false 队列已满
+     */
+    bool push(const T& item) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (N - 1);
+        if (next == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _buf[head] = item;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队 (仅消费者调用)
+     * @return false 队列为空
+     */
+    bool pop(T& out) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = _buf[tail];
+        _tail.store((tail + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 查看队首但不出队 (仅消费者调用)
+     * @return false 队列为空
+     */
+    bool peek(T& out) const {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = _buf[tail];
+        return true;
+    }
+
+    bool empty() const {
+        return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return (_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+    static constexpr size_t capacity() { return N - 1; }
+
+private:
+    T _buf[N];
+    std::atomic<size_t> _head;  // 生产者写
+    std::atomic<size_t> _tail;  // 消费者写
+};
+
+#endif // SPSC_RING_H
@@ -4,9 +4,11 @@
  */
 
 #include "data_reporter.h"
+#include "loop_profiler.h"
 
 DataReporter::DataReporter() 
-    : _serial(nullptr), _serial2(nullptr), _activeSerial(nullptr) {}
+    : _serial(nullptr), _serial2(nullptr), _activeSerial(nullptr),
+      _format(OutputFormat::JSON), _batchCount(0), _batchSize(0), _batchStartMs(0) {}
 
 void DataReporter::begin(Stream& primary, Stream* secondary) {
     _serial = &primary;
@@ -17,8 +19,106 @@ void DataReporter::begin(Stream& primary, Stream* secondary) {
 void DataReporter::report(const SensorReading& reading) {
     if (!_activeSerial) return;
     
+    if (_format == OutputFormat::BINARY) {
+        reportBinary(reading);
+    } else {
+        reportJson(reading);
+    }
+}
+
+void DataReporter::setFormat(OutputFormat format) {
+    if (format != _format) {
+        flush();
+    }
+    _format = format;
+}
+
+void DataReporter::setBatchSize(uint8_t maxReadings) {
+    if (maxReadings > DATA_BATCH_MAX) maxReadings = DATA_BATCH_MAX;
+    if (maxReadings != _batchSize) {
+        flush();
+    }
+    _batchSize = maxReadings;
+}
+
+void DataReporter::reportSingle(const SensorReading& reading) {
+    if (!_activeSerial) return;
+    
+    if (_format == OutputFormat::BINARY) {
+        uint8_t frame[FRAME_READING_MAX_LEN];
+        uint32_t start = LoopProfiler::cycles();
+        size_t len = FrameCodec::encodeReading(reading, frame);
+        loopProfiler.record(ProfilePoint::SERIALIZE, LoopProfiler::cycles() - start);
+        writeFrame(frame, len);
+    } else {
+        reportJson(reading);
+    }
+}
+
+void DataReporter::reportBinary(const SensorReading& reading) {
+    if (_batchSize > 1) {
+        appendBatch(reading);
+        return;
+    }
+    
+    uint8_t frame[FRAME_READING_MAX_LEN];
+    uint32_t start = LoopProfiler::cycles();
+    size_t len = FrameCodec::encodeReading(reading, frame);
+    loopProfiler.record(ProfilePoint::SERIALIZE, LoopProfiler::cycles() - start);
+    writeFrame(frame, len);
+}
+
+void DataReporter::appendBatch(const SensorReading& reading) {
+    if (_batchCount > 0) {
+        const SensorReading& first = _batch[0];
+        const SensorReading& last = _batch[_batchCount - 1];
+        // 加热步骤切换、序号不连续或时间增量超出 uint16 时先发送当前批次
+        if (reading.heater_step != last.heater_step ||
+            reading.seq != last.seq + 1 ||
+            reading.tick_ms - first.tick_ms > 0xFFFF) {
+            flush();
+        }
+    }
+    
+    if (_batchCount == 0) {
+        _batchStartMs = millis();
+    }
+    _batch[_batchCount++] = reading;
+    
+    if (_batchCount >= _batchSize) {
+        flush();
+    }
+}
+
+void DataReporter::poll() {
+    if (_batchCount > 0 && millis() - _batchStartMs >= DATA_BATCH_TIMEOUT_MS) {
+        flush();
+    }
+}
+
+void DataReporter::flush() {
+    if (_batchCount == 0 || !_activeSerial) return;
+    
+    uint8_t frame[FRAME_BATCH_MAX_LEN];
+    uint32_t start = LoopProfiler::cycles();
+    size_t len = FrameCodec::encodeBatch(_batch, _batchCount, frame);
+    loopProfiler.record(ProfilePoint::SERIALIZE, LoopProfiler::cycles() - start);
+    writeFrame(frame, len);
+    _batchCount = 0;
+}
+
+void DataReporter::writeFrame(const uint8_t* data, size_t len) {
+    // 串口发送缓冲满时 write 阻塞, 计入 SERIAL_TX
+    ProfileScope scope(ProfilePoint::SERIAL_TX);
+    _activeSerial->write(data, len);
+}
+
+void DataReporter::reportJson(const SensorReading& reading) {
+    // 编码耗时含建文档和浮点格式化, 与二进制帧的 encode 可比
+    uint32_t start = LoopProfiler::cycles();
     StaticJsonDocument<256> doc;
     doc["type"] = "data";
+    doc["seq"] = reading.seq;
     doc["tick"] = reading.tick_ms;
     doc["s"] = reading.sensor_idx;
     doc["id"] = reading.sensor_id;
@@ -53,8 +153,13 @@ void DataReporter::report(const SensorReading& reading) {
         doc["P"] = serialized(String(reading.pressure, 2));
     }
     
-    serializeJson(doc, *_activeSerial);
-    _activeSerial->println();
+    // 先序列化到行缓冲再一次写出: 编码与串口阻塞分开计时, 也省去逐字节写串口
+    char line[JSON_LINE_MAX];
+    size_t len = serializeJson(doc, line, sizeof(line) - 2);
+    loopProfiler.record(ProfilePoint::SERIALIZE, LoopProfiler::cycles() - start);
+    line[len++] = '\r';
+    line[len++] = '\n';
+    writeFrame((const uint8_t*)line, len);
 }
 
 void DataReporter::sendReady(const char* version, uint8_t sensorCount) {
@@ -1,6 +1,6 @@
 /**
  * @file    data_reporter.h
- * @brief   数据上报器 - 将传感器数据以JSON格式上报给树莓派
+ * @brief   数据上报器 - 将传感器数据以JSON或二进制帧格式上报给树莓派
  */
 
 #ifndef DATA_REPORTER_H
@@ -9,6 +9,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "core/sensor_types.h"
+#include "frame_codec.h"
 
 class DataReporter {
 public:
@@ -23,12 +24,41 @@ public:
         if (serial) _activeSerial = serial; 
     }
     
+    /**
+     * @brief 设置数据上报格式 (由 sync 命令协商)
+     */
+    void setFormat(OutputFormat format);
+    OutputFormat getFormat() const { return _format; }
+    
+    /**
+     * @brief 设置批量上报条数 (仅二进制模式生效)
+     * @param maxReadings 每帧最多读数条数, 0 或 1 表示不批量
+     * 
+     * 批次在以下情况发送: 条数已满、加热步骤切换、超过 DATA_BATCH_TIMEOUT_MS
+     */
+    void setBatchSize(uint8_t maxReadings);
+    
     /**
      * @brief 上报传感器数据 (使用统一的 SensorReading)
      * @param reading 传感器读数
      */
     void report(const SensorReading& reading);
     
+    /**
+     * @brief 立即单独上报一条读数 (不进入批次, 用于 replay)
+     */
+    void reportSingle(const SensorReading& reading);
+    
+    /**
+     * @brief 检查批次超时, 应在 loop() 中调用
+     */
+    void poll();
+    
+    /**
+     * @brief 立即发送未满的批次
+     */
+    void flush();
+    
     /**
      * @brief 发送就绪消息到所有串口
      * @param version 固件版本
@@ -37,9 +67,23 @@ public:
     void sendReady(const char* version, uint8_t sensorCount);
     
 private:
+    void reportJson(const SensorReading& reading);
+    void reportBinary(const SensorReading& reading);
+    void appendBatch(const SensorReading& reading);
+    void writeFrame(const uint8_t* data, size_t len);
+    
+    static constexpr size_t JSON_LINE_MAX = 256;    // 一条 data 消息约 150 字节
+    
     Stream* _serial;        // 主串口
     Stream* _serial2;       // 备用串口
     Stream* _activeSerial;  // 当前活跃串口
+    OutputFormat _format;   // 当前上报格式
+    
+    // 批量上报缓冲
+    SensorReading _batch[DATA_BATCH_MAX];
+    uint8_t _batchCount;
+    uint8_t _batchSize;         // 0/1 = 不批量
+    uint32_t _batchStartMs;     // 首条读数入批时间
 };
 
 #endif
@@ -0,0 +1,144 @@
+/**
+ * @file    frame_codec.cpp
+ * @brief   二进制帧编码实现
+ */
+
+#include "frame_codec.h"
+
+uint16_t FrameCodec::crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t FrameCodec::cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t codeIdx = 0;     // 当前 code 字节位置
+    size_t outIdx = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIdx] = code;
+            codeIdx = outIdx++;
+            code = 1;
+        } else {
+            out[outIdx++] = in[i];
+            code++;
+            if (code == 0xFF) {
+                // 满 254 字节无零, 开始新的分组
+                out[codeIdx] = code;
+                codeIdx = outIdx++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIdx] = code;
+    out[outIdx++] = 0x00;   // 帧结束符
+    return outIdx;
+}
+
+int FrameCodec::cobsDecode(uint8_t* buf, size_t len) {
+    size_t inIdx = 0;
+    size_t outIdx = 0;
+
+    while (inIdx < len) {
+        uint8_t code = buf[inIdx++];
+        if (code == 0 || inIdx + code - 1 > len) {
+            return -1;
+        }
+        // 写位置始终不超过读位置, 可以原地搬移
+        for (uint8_t i = 1; i < code; i++) {
+            buf[outIdx++] = buf[inIdx++];
+        }
+        // code == 0xFF 表示无隐含的 0x00; 最后一组也不追加
+        if (code != 0xFF && inIdx < len) {
+            buf[outIdx++] = 0x00;
+        }
+    }
+    return (int)outIdx;
+}
+
+int FrameCodec::decodeFrame(uint8_t* buf, size_t len) {
+    int rawLen = cobsDecode(buf, len);
+    if (rawLen < 3) {
+        return -1;
+    }
+    uint16_t expected = (uint16_t)(buf[rawLen - 2] | (buf[rawLen - 1] << 8));
+    if (crc16(buf, rawLen - 2) != expected) {
+        return -1;
+    }
+    return rawLen - 2;
+}
+
+size_t FrameCodec::encodeReading(const SensorReading& reading, uint8_t* out) {
+    uint8_t raw[1 + sizeof(SensorReadingWire) + 2];
+
+    // ESP32 为小端, 直接按内存布局拷贝
+    SensorReadingWire wire;
+    wire.seq = reading.seq;
+    wire.tick_ms = reading.tick_ms;
+    wire.sensor_idx = reading.sensor_idx;
+    wire.sensor_id = reading.sensor_id;
+    wire.primary_value = reading.primary_value;
+    wire.temperature = reading.temperature;
+    wire.humidity = reading.humidity;
+    wire.pressure = reading.pressure;
+    wire.heater_step = reading.heater_step;
+    wire.adc_channel = reading.adc_channel;
+    wire.type = (uint8_t)reading.type;
+
+    raw[0] = FRAME_TYPE_READING;
+    memcpy(&raw[1], &wire, sizeof(wire));
+
+    uint16_t crc = crc16(raw, 1 + sizeof(wire));
+    raw[1 + sizeof(wire)] = (uint8_t)(crc & 0xFF);
+    raw[2 + sizeof(wire)] = (uint8_t)(crc >> 8);
+
+    out[0] = FRAME_DELIMITER;
+    return 1 + cobsEncode(raw, sizeof(raw), out + 1);
+}
+
+size_t FrameCodec::encodeBatch(const SensorReading* readings, uint8_t count, uint8_t* out) {
+    uint8_t raw[1 + FRAME_BATCH_HEADER_LEN + sizeof(SensorBatchItemWire) * DATA_BATCH_MAX + 2];
+    if (count > DATA_BATCH_MAX) count = DATA_BATCH_MAX;
+
+    uint32_t baseTick = readings[0].tick_ms;
+    uint32_t baseSeq = readings[0].seq;
+    size_t pos = 0;
+    raw[pos++] = FRAME_TYPE_BATCH;
+    raw[pos++] = 0;         // reserved
+    raw[pos++] = count;
+    memcpy(&raw[pos], &baseTick, sizeof(baseTick));
+    pos += sizeof(baseTick);
+    memcpy(&raw[pos], &baseSeq, sizeof(baseSeq));
+    pos += sizeof(baseSeq);
+
+    for (uint8_t i = 0; i < count; i++) {
+        const SensorReading& r = readings[i];
+        SensorBatchItemWire item;
+        item.tick_delta_ms = (uint16_t)(r.tick_ms - baseTick);
+        item.sensor_idx = r.sensor_idx;
+        item.sensor_id = r.sensor_id;
+        item.primary_value = r.primary_value;
+        item.temperature = r.temperature;
+        item.humidity = r.humidity;
+        item.pressure = r.pressure;
+        item.heater_step = r.heater_step;
+        item.adc_channel = r.adc_channel;
+        item.type = (uint8_t)r.type;
+        memcpy(&raw[pos], &item, sizeof(item));
+        pos += sizeof(item);
+    }
+
+    uint16_t crc = crc16(raw, pos);
+    raw[pos++] = (uint8_t)(crc & 0xFF);
+    raw[pos++] = (uint8_t)(crc >> 8);
+
+    out[0] = FRAME_DELIMITER;
+    return 1 + cobsEncode(raw, pos, out + 1);
+}
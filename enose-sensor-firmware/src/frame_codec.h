@@ -0,0 +1,146 @@
+/**
+ * @file    frame_codec.h
+ * @brief   二进制帧编码 - COBS 分帧 + CRC16 校验
+ * 
+ * 帧格式 (COBS 编码前):
+ *   [frame_type:1][payload:N][crc16:2]
+ * crc16 为 CRC-16/CCITT-FALSE, 覆盖 frame_type + payload, 小端存放。
+ * COBS 编码后帧内不含 0x00, 以单个 0x00 作为帧结束符。
+ * 
+ * 批量帧 payload:
+ *   [reserved:1 = 0][count:1][base_tick:4][base_seq:4][SensorBatchItemWire × count]
+ * 批内读数序号连续, 第 i 条为 base_seq + i。
+ * reserved 恒为 0, 使 COBS 首字节固定为 0x02, 不会与 JSON 的 '{' 混淆。
+ * 
+ * 上位机 -> 设备的二进制命令帧格式相同, payload 同样以 reserved = 0 开头,
+ * 命令处理器据首字节 0x02 区分命令帧与 JSON 命令行 (见 HeaterConfigCmdWire)。
+ */
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "core/sensor_types.h"
+
+/**
+ * @brief 数据上报格式
+ */
+enum class OutputFormat : uint8_t {
+    JSON   = 0,     // 默认, 每条消息一行 JSON (调试用)
+    BINARY = 1      // COBS 二进制帧 (通过 sync 命令协商)
+};
+
+// 帧类型
+#define FRAME_TYPE_READING      0x01    // payload = SensorReadingWire
+#define FRAME_TYPE_BATCH        0x02    // payload = 批量头 + SensorBatchItemWire[]
+
+// 命令帧类型 (上位机 -> 设备)
+#define FRAME_TYPE_CMD_HEATER   0x10    // payload = HeaterConfigCmdWire, 等价于 JSON config 的 temps/durs
+
+/**
+ * @brief 批量帧中的单条读数 (小端, 26 字节)
+ * 
+ * 时间戳以相对 base_tick 的增量存放, 序号由 base_seq 推出, 其余字段同 SensorReadingWire
+ */
+struct __attribute__((packed)) SensorBatchItemWire {
+    uint16_t tick_delta_ms;
+    uint8_t  sensor_idx;
+    uint32_t sensor_id;
+    float    primary_value;
+    float    temperature;
+    float    humidity;
+    float    pressure;
+    uint8_t  heater_step;
+    uint8_t  adc_channel;
+    uint8_t  type;
+};
+
+static_assert(sizeof(SensorBatchItemWire) == 26, "SensorBatchItemWire layout changed");
+
+// HeaterConfigCmdWire.flags
+#define HEATER_CMD_FLAG_NOW     0x01    // 立即生效 (中断进行中的加热周期), 默认在周期边界生效
+
+/**
+ * @brief 加热曲线配置命令 (小端, 51 字节)
+ * 
+ * sensor_mask 的 bit i 对应传感器索引 i, 0 表示全部 BME688 通道;
+ * temps/durs 只有前 length 项有效 (1 - HEATER_PROFILE_MAX); 应答为普通 JSON ack
+ */
+struct __attribute__((packed)) HeaterConfigCmdWire {
+    uint8_t  reserved;          // 恒为 0
+    int32_t  id;                // 命令 ID, 原样回显在 ack 中
+    uint32_t sensor_mask;
+    uint8_t  length;
+    uint8_t  flags;
+    uint16_t temps[HEATER_PROFILE_MAX];
+    uint16_t durs[HEATER_PROFILE_MAX];
+};
+
+static_assert(sizeof(HeaterConfigCmdWire) == 51, "HeaterConfigCmdWire layout changed");
+
+// 协议版本 (sync 应答中返回)
+#define FRAME_VERSION           3       // 3: 支持二进制命令帧
+
+// 设备上报的数据帧前后各有一个 0x00: 上位机只在 0x00 之后按二进制帧接收,
+// 行首其他非 '{' 字节 (启动日志、线路噪声) 丢弃到下一个分隔符, 不会吞掉后面的帧
+#define FRAME_DELIMITER         0x00
+
+// 单个读数帧编码后的长度 (前导分隔符 1 字节 + COBS 开销 1 字节 + 结束符 1 字节)
+#define FRAME_READING_MAX_LEN   (1 + 1 + sizeof(SensorReadingWire) + 2 + 1 + 1)
+
+// 批量帧编码后的最大长度 (原始长度 < 254, COBS 开销 1 字节, 含前导分隔符)
+#define FRAME_BATCH_HEADER_LEN  10
+#define FRAME_BATCH_MAX_LEN     (1 + 1 + FRAME_BATCH_HEADER_LEN + sizeof(SensorBatchItemWire) * DATA_BATCH_MAX + 2 + 1 + 1)
+
+class FrameCodec {
+public:
+    /**
+     * @brief 计算 CRC-16/CCITT-FALSE
+     */
+    static uint16_t crc16(const uint8_t* data, size_t len);
+
+    /**
+     * @brief COBS 编码, 并在末尾追加 0x00 结束符
+     * @param in    原始数据
+     * @param len   原始数据长度
+     * @param out   输出缓冲区, 至少 len + len / 254 + 2 字节
+     * @return 写入 out 的字节数
+     */
+    static size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out);
+
+    /**
+     * @brief COBS 原地解码 (输入不含 0x00 结束符)
+     * @param buf   编码数据, 解码结果写回同一缓冲区 (解码后长度总小于输入)
+     * @param len   编码数据长度
+     * @return 解码后的长度, 格式错误返回 -1
+     */
+    static int cobsDecode(uint8_t* buf, size_t len);
+
+    /**
+     * @brief 解码并校验一帧
+     * @param buf   COBS 编码的帧 (不含 0x00 结束符), 原地解码
+     * @param len   编码数据长度
+     * @return 不含 CRC 的原始帧长度 ([frame_type][payload]), COBS/CRC 错误返回 -1
+     */
+    static int decodeFrame(uint8_t* buf, size_t len);
+
+    /**
+     * @brief 将读数编码为完整的二进制帧 (FRAME_DELIMITER + COBS + 0x00)
+     * @param reading 传感器读数
+     * @param out     输出缓冲区, 至少 FRAME_READING_MAX_LEN 字节
+     * @return 帧长度
+     */
+    static size_t encodeReading(const SensorReading& reading, uint8_t* out);
+
+    /**
+     * @brief 将一批读数编码为单个二进制帧 (FRAME_DELIMITER + COBS + 0x00)
+     * @param readings 读数数组, 序号需连续, tick 相对 readings[0] 的增量需 <= 65535 ms
+     * @param count    读数条数 (1 - DATA_BATCH_MAX)
+     * @param out      输出缓冲区, 至少 FRAME_BATCH_MAX_LEN 字节
+     * @return 帧长度
+     */
+    static size_t encodeBatch(const SensorReading* readings, uint8_t count, uint8_t* out);
+};
+
+#endif
@@ -0,0 +1,124 @@
+/**
+ * @file    loop_profiler.cpp
+ * @brief   循环计时统计实现
+ */
+
+#include "loop_profiler.h"
+
+LoopProfiler loopProfiler;
+
+uint8_t CycleHistogram::bucketOf(uint32_t value) {
+    if (value < SUB_BUCKETS) {
+        return (uint8_t)value;
+    }
+    // 最高位所在的 2 的幂区间, 再按其后 SUB_BITS 位分子桶
+    uint8_t msb = 31 - __builtin_clz(value);
+    uint8_t sub = (value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (uint8_t)((msb - SUB_BITS + 1) * SUB_BUCKETS + sub);
+}
+
+uint32_t CycleHistogram::bucketUpper(uint8_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    uint8_t group = bucket / SUB_BUCKETS;
+    uint8_t sub = bucket % SUB_BUCKETS;
+    uint8_t shift = group - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + sub) << shift;
+    uint64_t upper = lower + (1ULL << shift) - 1;
+    return (upper > UINT32_MAX) ? UINT32_MAX : (uint32_t)upper;
+}
+
+void CycleHistogram::clear() {
+    memset(_counts, 0, sizeof(_counts));
+    _count = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+    _sum = 0;
+    _resetPending = false;
+}
+
+void CycleHistogram::record(uint32_t value) {
+    if (_resetPending) {
+        clear();
+    }
+    _counts[bucketOf(value)]++;
+    _count++;
+    _sum += value;
+    if (value < _min) _min = value;
+    if (value > _max) _max = value;
+}
+
+uint32_t CycleHistogram::quantile(float q) const {
+    uint32_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    // 第 ceil(q·n) 个样本所在的桶
+    uint32_t rank = (uint32_t)(q * n);
+    if (rank < n && (float)rank < q * n) rank++;
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) {
+        seen += _counts[b];
+        if (seen >= rank) {
+            uint32_t upper = bucketUpper(b);
+            return (upper < _max) ? upper : _max;
+        }
+    }
+    return _max;
+}
+
+void CycleHistogram::toJson(JsonObject out, float scale) const {
+    uint32_t n = count();
+    out["n"] = n;
+    if (n == 0) {
+        return;
+    }
+    out["min"] = min() * scale;
+    out["p50"] = quantile(0.50f) * scale;
+    out["p99"] = quantile(0.99f) * scale;
+    out["max"] = max() * scale;
+    out["mean"] = (float)(mean() * scale);
+}
+
+LoopProfiler::LoopProfiler() {}
+
+void LoopProfiler::reset() {
+    for (auto& h : _timing) h.requestReset();
+    for (auto& h : _wake) h.requestReset();
+}
+
+const char* LoopProfiler::pointName(ProfilePoint point) {
+    switch (point) {
+        case ProfilePoint::ACQ_LOOP:    return "acq_loop";
+        case ProfilePoint::SENSOR_READ: return "read";
+        case ProfilePoint::SPI_FETCH:   return "fetch";
+        case ProfilePoint::SYNC_BURST:  return "burst";
+        case ProfilePoint::COMM_LOOP:   return "comm_loop";
+        case ProfilePoint::SERIALIZE:   return "serialize";
+        case ProfilePoint::SERIAL_TX:   return "tx";
+        default:                        return "unknown";
+    }
+}
+
+void LoopProfiler::toJson(JsonDocument& doc) const {
+    #if LOOP_PROFILE
+    // 周期 -> µs
+    float usPerCycle = 1.0f / getCpuFrequencyMhz();
+    JsonObject timingObj = doc.createNestedObject("timing");
+    for (uint8_t i = 0; i < (uint8_t)ProfilePoint::COUNT; i++) {
+        _timing[i].toJson(timingObj.createNestedObject(pointName((ProfilePoint)i)), usPerCycle);
+    }
+
+    JsonArray wakeArr = doc.createNestedArray("wake");
+    for (uint8_t i = 0; i < PROFILE_WAKE_SENSORS; i++) {
+        if (_wake[i].count() == 0) continue;
+        JsonObject obj = wakeArr.createNestedObject();
+        obj["s"] = i;
+        _wake[i].toJson(obj, 1.0f);
+    }
+    #else
+    (void)doc;
+    #endif
+}
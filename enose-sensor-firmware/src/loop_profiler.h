@@ -0,0 +1,176 @@
+/**
+ * @file    loop_profiler.h
+ * @brief   循环计时统计 - 采集/通讯任务各阶段耗时与传感器唤醒偏差的直方图
+ *
+ * 耗时以 CPU 周期计数器 (ccount) 计量, 开始与结束在同一个固定核心的任务中取值;
+ * 唤醒偏差为实际读取时刻减去调度时刻 (µs, esp_timer)。由 stats 命令读取 (见 PROTOCOL.md)。
+ *
+ * 每个直方图只有一个写入任务; 读取方 (通讯任务) 不加锁, 读数与写入并发时可能差一条,
+ * 仅用于统计。清零请求由写入方在下一次记录时执行, 不与写入竞争。
+ * LOOP_PROFILE 为 0 时 ProfileScope 与各 record 调用为空操作。
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "config.h"
+
+#ifndef LOOP_PROFILE
+#define LOOP_PROFILE            1
+#endif
+
+// 记录唤醒偏差的传感器数 (BME688 通道索引)
+#define PROFILE_WAKE_SENSORS    8
+
+/**
+ * @brief 对数分桶直方图: 每个 2 的幂区间 4 个子桶 (相对误差 < 25%), 覆盖整个 uint32 范围
+ */
+class CycleHistogram {
+public:
+    static constexpr uint8_t SUB_BITS = 2;
+    static constexpr uint8_t SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr uint8_t BUCKETS = (32 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    CycleHistogram() { clear(); }
+
+    void record(uint32_t value);
+    void requestReset() { _resetPending = true; }
+    void clear();
+
+    uint32_t count() const { return _resetPending ? 0 : _count; }
+    uint32_t min() const { return _count ? _min : 0; }
+    uint32_t max() const { return _max; }
+    double mean() const { return _count ? (double)_sum / _count : 0.0; }
+
+    /**
+     * @brief 分位数 (q: 0-1), 取所在桶的上界, 不超过最大值
+     */
+    uint32_t quantile(float q) const;
+
+    static uint8_t bucketOf(uint32_t value);
+    static uint32_t bucketUpper(uint8_t bucket);
+
+    /**
+     * @brief 写入 {n, min, p50, p99, max, mean}, 数值乘以 scale (如周期 -> µs)
+     */
+    void toJson(JsonObject out, float scale) const;
+
+private:
+    uint32_t _counts[BUCKETS];
+    uint32_t _count;
+    uint32_t _min;
+    uint32_t _max;
+    uint64_t _sum;
+    std::atomic<bool> _resetPending{false};
+};
+
+/**
+ * @brief 计时点; 注释为写入任务
+ */
+enum class ProfilePoint : uint8_t {
+    ACQ_LOOP = 0,   // acq: 一轮采集循环 (不含让出 CPU 的 vTaskDelay)
+    SENSOR_READ,    // acq: 有传感器就绪时 getNextReadySensor + readSensor
+    SPI_FETCH,      // acq: 单个 BME688 fetchData
+    SYNC_BURST,     // acq: 同步调度的一次节拍突发读取
+    COMM_LOOP,      // comm: 一轮通讯循环 (不含 vTaskDelay)
+    SERIALIZE,      // comm: 一条 JSON 消息或一个二进制帧的编码
+    SERIAL_TX,      // comm: 数据写入串口的阻塞时间
+    COUNT
+};
+
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    void record(ProfilePoint point, uint32_t cycles) {
+        #if LOOP_PROFILE
+        _timing[(uint8_t)point].record(cycles);
+        #else
+        (void)point; (void)cycles;
+        #endif
+    }
+
+    /**
+     * @brief 传感器读取时刻相对调度时刻的偏差
+     * @param sensorIdx BME688 通道索引
+     * @param lateUs 晚于调度时刻的微秒数 (早于时记 0)
+     */
+    void recordWake(uint8_t sensorIdx, int64_t lateUs) {
+        #if LOOP_PROFILE
+        if (sensorIdx < PROFILE_WAKE_SENSORS) {
+            _wake[sensorIdx].record(lateUs <= 0 ? 0 : (lateUs > UINT32_MAX ? UINT32_MAX : (uint32_t)lateUs));
+        }
+        #else
+        (void)sensorIdx; (void)lateUs;
+        #endif
+    }
+
+    /** @brief 全部直方图清零 (由各自的写入任务在下一次记录时执行) */
+    void reset();
+
+    /** @brief stats 应答: timing (µs) 与 wake (µs) 两部分 */
+    void toJson(JsonDocument& doc) const;
+
+    const CycleHistogram& timing(ProfilePoint point) const {
+        #if LOOP_PROFILE
+        return _timing[(uint8_t)point];
+        #else
+        (void)point;
+        return _timing[0];
+        #endif
+    }
+    const CycleHistogram& wake(uint8_t sensorIdx) const {
+        #if LOOP_PROFILE
+        return _wake[sensorIdx];
+        #else
+        (void)sensorIdx;
+        return _wake[0];
+        #endif
+    }
+
+    static const char* pointName(ProfilePoint point);
+
+    static uint32_t cycles() {
+        #if LOOP_PROFILE
+        return ESP.getCycleCount();
+        #else
+        return 0;
+        #endif
+    }
+
+private:
+    #if LOOP_PROFILE
+    CycleHistogram _timing[(uint8_t)ProfilePoint::COUNT];
+    CycleHistogram _wake[PROFILE_WAKE_SENSORS];
+    #else
+    // 关闭时保留一个空直方图供 timing()/wake() 返回
+    CycleHistogram _timing[1];
+    CycleHistogram _wake[1];
+    #endif
+};
+
+extern LoopProfiler loopProfiler;
+
+/**
+ * @brief 作用域计时: 析构时把经过的周期数记入 point
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePoint point) : _point(point), _start(LoopProfiler::cycles()) {}
+    ~ProfileScope() {
+        #if LOOP_PROFILE
+        loopProfiler.record(_point, LoopProfiler::cycles() - _start);
+        #endif
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfilePoint _point;
+    uint32_t _start;
+};
+
+#endif
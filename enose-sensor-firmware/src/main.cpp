@@ -5,19 +5,28 @@
  * 
  * 通信协议:
  *   上位机 -> ESP32: JSON 命令 (sync, init, start, stop, status, reset)
- *   ESP32 -> 上位机: JSON 响应/数据流
+ *   ESP32 -> 上位机: JSON 响应/数据流 (数据流可经 sync 协商为 COBS 二进制帧)
  * 
  * 重构说明:
  *   - 使用 ISensorArray 抽象接口支持多种传感器类型
- *   - 通过 config.h 编译时选择传感器类型
+ *   - 通过 config.h 编译时选择传感器类型, SENSOR_TYPE_COMPOSITE 时多个阵列共用一个接口
+ * 
+ * 任务划分:
+ *   - acqTask  (ACQ_TASK_CORE):  轮询传感器, 读数写入 SPSC 环形队列
+ *   - commTask (COMM_TASK_CORE): 命令处理、LED、从队列取出读数上报
+ *   上报或长命令不会再推迟下一次 SPI 读取, 时间戳在采集任务中打上
  */
 
 #include <Arduino.h>
+#include <atomic>
 #include "config.h"
 #include "core/sensor_array.h"
+#include "core/spsc_ring.h"
 #include "cmd_handler.h"
 #include "data_reporter.h"
 #include "led_controller.h"
+#include "loop_profiler.h"
+#include "reading_history.h"
 #include "utils.h"
 
 // 根据配置选择传感器实现
@@ -29,8 +38,21 @@
     AnalogSensorArray sensorArray(
         (AdcType)(ADC_TYPE - 1),  // 转换配置值到枚举
         ADC_CS_PIN,
-        NUM_SENSORS
+        ADC_NUM_CHANNELS,
+        ADC_DRDY_PIN
+    );
+#elif SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+    #include "sensors/bme688_array.h"
+    #include "sensors/analog_array.h"
+    #include "sensors/composite_array.h"
+    BME688Array bmeArray;
+    AnalogSensorArray analogArray(
+        (AdcType)(ADC_TYPE - 1),
+        ADC_CS_PIN,
+        ADC_NUM_CHANNELS,
+        ADC_DRDY_PIN
     );
+    CompositeSensorArray sensorArray;
 #endif
 
 // 全局传感器接口指针
@@ -41,16 +63,161 @@ CmdHandler cmdHandler;
 DataReporter reporter;
 ledController ledCtlr;
 
-// 运行状态
-bool isRunning = false;
-SensorError lastError = SensorError::OK;
-std::vector<uint8_t> activeSensors;
+// 运行状态 (两个任务共享)
+std::atomic<bool> isRunning{false};
+std::atomic<SensorError> lastError{SensorError::OK};
+std::atomic<uint32_t> activeMask{0};        // 活跃传感器位图, bit i = 传感器 i
+std::atomic<uint32_t> droppedReadings{0};   // 队列满时丢弃的读数
+
+// 采集任务 -> 上报任务
+SpscRing<SensorReading, READING_RING_SIZE> readingRing;
+
+// 保护传感器阵列: 采集任务读数时, 命令任务不能同时 init/config
+SemaphoreHandle_t sensorMutex = nullptr;
+
+// 已上报读数的历史与补发游标 (仅通讯任务访问)
+ReadingHistory history;
+uint32_t replayNext = 0;    // 下一条待补发序号, 0 = 无补发
+uint32_t replayLast = 0;
+
+void acqTask(void* arg);
+void commTask(void* arg);
+
+#if SENSOR_TYPE == SENSOR_TYPE_ANALOG
+AnalogSensorArray& analogAdc() { return sensorArray; }
+#elif SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+AnalogSensorArray& analogAdc() { return analogArray; }
+#endif
+
+#if SENSOR_TYPE == SENSOR_TYPE_BME688
+BME688Array& bmeSensors() { return sensorArray; }
+#elif SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+BME688Array& bmeSensors() { return bmeArray; }
+#endif
 
 // 兼容旧的 demoRetCode (用于 LED 和 cmd_handler)
 demoRetCode toRetCode(SensorError err) {
     return (err == SensorError::OK) ? EDK_OK : EDK_BME68X_DRIVER_ERROR;
 }
 
+#if SENSOR_TYPE == SENSOR_TYPE_BME688 || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+/**
+ * @brief 写入 BME688 加热器曲线 (JSON config 与二进制命令帧共用)
+ * @param sensorMask bit i = 传感器索引 i, 0 表示全部 BME688 通道
+ * @param length     步数 (1 - HEATER_PROFILE_MAX)
+ * @param immediate  true: 立即重启加热周期; false: 整批暂存后在各传感器的周期边界生效
+ */
+demoRetCode applyHeaterProfile(uint32_t sensorMask, const uint16_t* temps, const uint16_t* durs,
+                               uint8_t length, bool immediate) {
+    if (length == 0 || length > HEATER_PROFILE_MAX) {
+        return EDK_SENSOR_MANAGER_JSON_FORMAT_ERROR;
+    }
+    SensorConfig config;
+    for (int i = 0; i < length; i++) {
+        config.heater_temps[i] = temps[i];
+        config.heater_durations[i] = durs[i];
+    }
+    config.heater_length = length;
+    config.heater_staged = !immediate;
+
+    // 组合模式下只配置 BME688 通道
+    #if SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+    uint8_t base = sensorArray.baseIndexOf(&bmeArray);
+    uint8_t count = bmeArray.getSensorCount();
+    #else
+    uint8_t base = 0;
+    uint8_t count = sensors->getSensorCount();
+    #endif
+
+    uint32_t validMask = ((count >= 32) ? 0xFFFFFFFFUL : ((1UL << count) - 1)) << base;
+    if (sensorMask == 0) {
+        sensorMask = validMask;
+    } else if (sensorMask & ~validMask) {
+        return EDK_SENSOR_MANAGER_CONFIG_FILE_ERROR;
+    }
+
+    // 逐个传感器持锁, 配置突发时采集任务可以在传感器之间插入读数
+    for (uint8_t idx = base; idx < base + count; idx++) {
+        if (!(sensorMask & (1UL << idx))) continue;
+        config.sensor_idx = idx;
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        SensorError err = sensors->configure(config);
+        xSemaphoreGive(sensorMutex);
+        if (err != SensorError::OK) {
+            return EDK_SENSOR_MANAGER_CONFIG_FILE_ERROR;
+        }
+    }
+
+    if (!immediate) {
+        // 整批一次提交: 同一周期边界上一起切换
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        sensors->commitStaged(sensorMask);
+        xSemaphoreGive(sensorMutex);
+    }
+    return EDK_OK;
+}
+
+/**
+ * @brief config 命令: BME688 加热器曲线
+ */
+demoRetCode configureHeaters(const JsonDocument& doc) {
+    JsonArrayConst sensorsArr = doc["params"]["sensors"];
+    JsonArrayConst temps = doc["params"]["temps"];
+    JsonArrayConst durs = doc["params"]["durs"];
+
+    size_t length = temps.size();
+    if (length == 0 || length > HEATER_PROFILE_MAX || durs.size() != length) {
+        return EDK_SENSOR_MANAGER_JSON_FORMAT_ERROR;
+    }
+
+    // apply: "cycle" (默认, 周期边界生效) | "now" (立即重启加热周期)
+    const char* apply = doc["params"]["apply"] | "cycle";
+    bool immediate = strcmp(apply, "now") == 0;
+    if (!immediate && strcmp(apply, "cycle") != 0) {
+        return EDK_SENSOR_MANAGER_JSON_FORMAT_ERROR;
+    }
+
+    uint16_t tempValues[HEATER_PROFILE_MAX];
+    uint16_t durValues[HEATER_PROFILE_MAX];
+    for (size_t i = 0; i < length; i++) {
+        tempValues[i] = temps[i].as<uint16_t>();
+        durValues[i] = durs[i].as<uint16_t>();
+    }
+
+    // 省略列表时为全部 BME688
+    uint32_t mask = 0;
+    for (JsonVariantConst v : sensorsArr) {
+        uint8_t idx = v.as<uint8_t>();
+        if (idx >= 32) {
+            return EDK_SENSOR_MANAGER_CONFIG_FILE_ERROR;
+        }
+        mask |= (1UL << idx);
+    }
+    if (!sensorsArr.isNull() && mask == 0) {
+        return EDK_OK;  // 空列表: 无需配置
+    }
+    return applyHeaterProfile(mask, tempValues, durValues, (uint8_t)length, immediate);
+}
+#endif
+
+#if SENSOR_TYPE == SENSOR_TYPE_ANALOG || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+/**
+ * @brief config 命令: ADC 数据速率/增益/参考电压, 省略的字段保持不变
+ */
+demoRetCode configureAdc(const JsonDocument& doc) {
+    AnalogSensorArray& adc = analogAdc();
+    SensorConfig config;
+    config.adc_sample_rate = doc["params"]["rate"] | adc.getDataRate();
+    config.adc_gain = doc["params"]["gain"] | adc.getGain();
+    config.adc_vref = doc["params"]["vref"] | adc.getReferenceVoltage();
+    
+    xSemaphoreTake(sensorMutex, portMAX_DELAY);
+    SensorError err = adc.configure(config);
+    xSemaphoreGive(sensorMutex);
+    return (err == SensorError::OK) ? EDK_OK : EDK_SENSOR_MANAGER_CONFIG_FILE_ERROR;
+}
+#endif
+
 void setup() {
     // 初始化主串口 (USB)
     Serial.begin(SERIAL_BAUDRATE);
@@ -75,64 +242,127 @@ void setup() {
     #else
     cmdHandler.begin(Serial);
     #endif
+    
+    #if SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+    analogArray.setSpiBus(HSPI_HOST, ADC_SPI_SCK_PIN, ADC_SPI_MISO_PIN, ADC_SPI_MOSI_PIN);
+    sensorArray.addArray(&bmeArray);
+    sensorArray.addArray(&analogArray);
+    #endif
     cmdHandler.setSensorArray(sensors);
     
+    #if SENSOR_TYPE == SENSOR_TYPE_ANALOG || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+    // init 之前设定 ADC 默认配置, init 时写入芯片
+    SensorConfig adcConfig;
+    adcConfig.adc_vref = ADC_VREF;
+    adcConfig.adc_sample_rate = ADC_DATA_RATE_SPS;
+    adcConfig.adc_gain = ADC_PGA_GAIN;
+    analogAdc().configure(adcConfig);
+    #endif
+    
     // 设置命令回调
     cmdHandler.setInitCallback([](const String& configFile) -> demoRetCode {
         // 初始化传感器阵列
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
         lastError = sensors->init();
+        xSemaphoreGive(sensorMutex);
         return toRetCode(lastError);
     });
 
     cmdHandler.setConfigCallback([](const JsonDocument& doc) -> demoRetCode {
-        JsonArrayConst sensorsArr = doc["params"]["sensors"];
-        JsonArrayConst temps = doc["params"]["temps"];
-        JsonArrayConst durs = doc["params"]["durs"];
-
-        // 仅 BME688 支持加热器配置
         #if SENSOR_TYPE == SENSOR_TYPE_BME688
-        if (temps.size() != 10 || durs.size() != 10) {
+        return configureHeaters(doc);
+        #elif SENSOR_TYPE == SENSOR_TYPE_ANALOG
+        return configureAdc(doc);
+        #elif SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+        // 组合模式: 带 temps/durs 配置 BME688, 带 rate/gain/vref 配置 ADC, 可同时出现
+        JsonVariantConst params = doc["params"];
+        bool heater = !params["temps"].isNull() || !params["durs"].isNull();
+        bool adc = !params["rate"].isNull() || !params["gain"].isNull() || !params["vref"].isNull();
+        if (!heater && !adc) {
             return EDK_SENSOR_MANAGER_JSON_FORMAT_ERROR;
         }
-
-        SensorConfig config;
-        for (int i = 0; i < 10; i++) {
-            config.heater_temps[i] = temps[i].as<uint16_t>();
-            config.heater_durations[i] = durs[i].as<uint16_t>();
+        demoRetCode ret = heater ? configureHeaters(doc) : EDK_OK;
+        if (ret == EDK_OK && adc) {
+            ret = configureAdc(doc);
         }
-        config.heater_length = 10;
-
-        std::vector<uint8_t> targetSensors;
-        if (sensorsArr.isNull()) {
-            for (uint8_t i = 0; i < sensors->getSensorCount(); i++) {
-                targetSensors.push_back(i);
-            }
-        } else {
-            for (JsonVariantConst v : sensorsArr) {
-                targetSensors.push_back(v.as<uint8_t>());
-            }
-        }
-
-        for (uint8_t idx : targetSensors) {
-            config.sensor_idx = idx;
-            SensorError err = sensors->configure(config);
-            if (err != SensorError::OK) {
-                return EDK_SENSOR_MANAGER_CONFIG_FILE_ERROR;
-            }
-        }
-        #endif
-        
+        return ret;
+        #else
+        (void)doc;
         return EDK_OK;
+        #endif
     });
     
+    #if SENSOR_TYPE == SENSOR_TYPE_BME688 || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+    cmdHandler.setHeaterCallback(applyHeaterProfile);
+    #endif
+    
     cmdHandler.setStartCallback([](const std::vector<uint8_t>& sensorList) {
-        activeSensors = sensorList;
+        uint32_t mask = 0;
+        for (uint8_t idx : sensorList) {
+            mask |= (1UL << idx);
+        }
+        activeMask = mask;
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        sensors->setStreaming(true, mask);
+        xSemaphoreGive(sensorMutex);
         isRunning = true;
     });
     
     cmdHandler.setStopCallback([]() {
         isRunning = false;
-        activeSensors.clear();
+        // 等待进行中的读取结束, 把队列中剩余读数在 ack 之前发出
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        sensors->setStreaming(false, 0);
+        xSemaphoreGive(sensorMutex);
+        SensorReading reading;
+        while (readingRing.pop(reading)) {
+            history.append(reading);
+            reporter.report(reading);
+        }
+        reporter.flush();
+        activeMask = 0;
+    });
+    
+    cmdHandler.setReplayCallback([](uint32_t fromSeq, uint32_t toSeq,
+                                    uint32_t& first, uint32_t& last) -> bool {
+        if (history.capacity() == 0) return false;
+        
+        // 已被覆盖的部分无法补发, 从最旧的可用序号开始
+        uint32_t oldest = history.oldestSeq();
+        first = (fromSeq < oldest) ? oldest : fromSeq;
+        last = history.latestSeq();
+        if (toSeq != 0 && toSeq < last) {
+            last = toSeq;
+        }
+        
+        if (oldest == 0 || first > last) {
+            first = last + 1;   // 空区间
+            replayNext = 0;
+        } else {
+            replayNext = first;
+            replayLast = last;
+        }
+        return true;
+    });
+    
+    cmdHandler.setStatusCallback([](JsonDocument& doc) {
+        doc["dropped"] = droppedReadings.load();
+        doc["queued"] = readingRing.size();
+        doc["seq"] = history.latestSeq();
+        doc["oldest_seq"] = history.oldestSeq();
+        #if SENSOR_TYPE == SENSOR_TYPE_BME688 || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+        doc["bme_sync"] = (bool)BME688_SYNC_SCHEDULE;
+        doc["bme_resyncs"] = bmeSensors().getResyncCount();
+        #endif
+        #if SENSOR_TYPE == SENSOR_TYPE_ANALOG || SENSOR_TYPE == SENSOR_TYPE_COMPOSITE
+        AnalogSensorArray& adc = analogAdc();
+        if (adc.isContinuous()) {
+            doc["adc_rate"] = adc.getDataRate();
+            doc["adc_gain"] = adc.getGain();
+            doc["adc_overflow"] = adc.getOverflowCount();
+            doc["adc_drdy_timeouts"] = adc.getDrdyTimeoutCount();
+        }
+        #endif
     });
     
     // 初始化数据上报器 (双串口模式)
@@ -144,38 +374,107 @@ void setup() {
     
     // 发送就绪信号 (会发送到所有串口)
     reporter.sendReady(FIRMWARE_VERSION, sensors->getSensorCount());
+    
+    history.begin();
+    sensorMutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(acqTask, "acq", ACQ_TASK_STACK, nullptr,
+                            ACQ_TASK_PRIORITY, nullptr, ACQ_TASK_CORE);
+    xTaskCreatePinnedToCore(commTask, "comm", COMM_TASK_STACK, nullptr,
+                            COMM_TASK_PRIORITY, nullptr, COMM_TASK_CORE);
 }
 
-void loop() {
-    // 更新 LED 状态
-    ledCtlr.update(toRetCode(lastError));
-    
-    // 处理上位机命令
-    if (cmdHandler.process()) {
-        // 命令被处理，同步活跃串口到 reporter
-        reporter.setActiveSerial(cmdHandler.getActiveSerial());
-    }
+/**
+ * @brief 采集任务: 只负责读取传感器并写入队列
+ */
+void acqTask(void* arg) {
+    (void)arg;
     
-    // 采集并上报数据
-    if (isRunning && lastError == SensorError::OK) {
-        uint8_t sensorIdx = sensors->getNextReadySensor();
+    for (;;) {
+        bool gotReading = false;
+        uint32_t loopStart = LoopProfiler::cycles();
         
-        if (sensorIdx != 0xFF) {
-            // 检查传感器是否在活跃列表中
-            bool isActive = activeSensors.empty(); // 如果为空则全部活跃
-            for (uint8_t idx : activeSensors) {
-                if (idx == sensorIdx) {
-                    isActive = true;
-                    break;
+        if (isRunning && lastError == SensorError::OK) {
+            SensorReading reading;
+            
+            xSemaphoreTake(sensorMutex, portMAX_DELAY);
+            // 持锁后再检查一次, 保证 stop 返回后不会再有读数入队
+            uint32_t readStart = LoopProfiler::cycles();
+            uint8_t sensorIdx = isRunning ? sensors->getNextReadySensor() : 0xFF;
+            
+            if (sensorIdx != 0xFF) {
+                // 检查传感器是否在活跃列表中, 位图为空则全部活跃
+                uint32_t mask = activeMask;
+                bool isActive = (mask == 0) || (mask & (1UL << sensorIdx));
+                
+                if (isActive) {
+                    gotReading = sensors->readSensor(sensorIdx, reading);
                 }
+                loopProfiler.record(ProfilePoint::SENSOR_READ, LoopProfiler::cycles() - readStart);
             }
             
-            if (isActive) {
-                SensorReading reading;
-                if (sensors->readSensor(sensorIdx, reading)) {
-                    reporter.report(reading);
-                }
+            if (gotReading && !readingRing.push(reading)) {
+                droppedReadings++;
+            }
+            xSemaphoreGive(sensorMutex);
+        }
+        loopProfiler.record(ProfilePoint::ACQ_LOOP, LoopProfiler::cycles() - loopStart);
+        
+        // 无新数据时让出 CPU
+        if (!gotReading) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+/**
+ * @brief 通讯任务: 命令处理、LED 与数据上报
+ */
+void commTask(void* arg) {
+    (void)arg;
+    
+    for (;;) {
+        uint32_t loopStart = LoopProfiler::cycles();
+        
+        // 更新 LED 状态
+        ledCtlr.update(toRetCode(lastError));
+        
+        // 处理上位机命令
+        if (cmdHandler.process()) {
+            // 命令被处理，同步活跃串口和上报格式到 reporter
+            reporter.setActiveSerial(cmdHandler.getActiveSerial());
+            reporter.setFormat(cmdHandler.getOutputFormat());
+            reporter.setBatchSize(cmdHandler.getBatchSize());
+        }
+        
+        // 上报队列中的读数
+        SensorReading reading;
+        bool reported = false;
+        while (readingRing.pop(reading)) {
+            history.append(reading);
+            reporter.report(reading);
+            reported = true;
+        }
+        
+        // 分批补发历史读数, 不阻塞实时数据
+        for (int n = 0; replayNext != 0 && n < REPLAY_CHUNK; n++) {
+            if (history.get(replayNext, reading)) {
+                reporter.reportSingle(reading);
+                reported = true;
             }
+            replayNext = (replayNext < replayLast) ? replayNext + 1 : 0;
+        }
+        
+        // 发送超时的批次
+        reporter.poll();
+        loopProfiler.record(ProfilePoint::COMM_LOOP, LoopProfiler::cycles() - loopStart);
+        
+        if (!reported) {
+            vTaskDelay(1);
         }
     }
 }
+
+void loop() {
+    // 工作由 acqTask / commTask 完成
+    vTaskDelete(nullptr);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file    reading_history.cpp
+ * @brief   读数历史缓冲实现
+ */
+
+#include "reading_history.h"
+#include <esp32-hal-psram.h>
+
+ReadingHistory::ReadingHistory()
+    : _buf(nullptr), _capacity(0), _count(0), _nextSeq(1) {}
+
+size_t ReadingHistory::begin() {
+    if (_buf) return _capacity;
+    
+    // 按与二进制帧相同的紧凑布局存储, 节省内存
+    if (psramFound()) {
+        _buf = (SensorReadingWire*)ps_malloc(HISTORY_CAPACITY_PSRAM * sizeof(SensorReadingWire));
+        if (_buf) _capacity = HISTORY_CAPACITY_PSRAM;
+    }
+    if (!_buf) {
+        _buf = (SensorReadingWire*)malloc(HISTORY_CAPACITY_SRAM * sizeof(SensorReadingWire));
+        if (_buf) _capacity = HISTORY_CAPACITY_SRAM;
+    }
+    return _capacity;
+}
+
+void ReadingHistory::append(SensorReading& reading) {
+    reading.seq = _nextSeq++;
+    if (!_buf) return;
+    
+    SensorReadingWire& w = _buf[reading.seq % _capacity];
+    w.seq = reading.seq;
+    w.tick_ms = reading.tick_ms;
+    w.sensor_idx = reading.sensor_idx;
+    w.sensor_id = reading.sensor_id;
+    w.primary_value = reading.primary_value;
+    w.temperature = reading.temperature;
+    w.humidity = reading.humidity;
+    w.pressure = reading.pressure;
+    w.heater_step = reading.heater_step;
+    w.adc_channel = reading.adc_channel;
+    w.type = (uint8_t)reading.type;
+    
+    if (_count < _capacity) _count++;
+}
+
+bool ReadingHistory::get(uint32_t seq, SensorReading& out) const {
+    if (!_buf || seq == 0 || seq < oldestSeq() || seq > latestSeq()) {
+        return false;
+    }
+    
+    const SensorReadingWire& w = _buf[seq % _capacity];
+    out.seq = w.seq;
+    out.tick_ms = w.tick_ms;
+    out.sensor_idx = w.sensor_idx;
+    out.sensor_id = w.sensor_id;
+    out.primary_value = w.primary_value;
+    out.temperature = w.temperature;
+    out.humidity = w.humidity;
+    out.pressure = w.pressure;
+    out.heater_step = w.heater_step;
+    out.adc_channel = w.adc_channel;
+    out.type = (SensorType)w.type;
+    return true;
+}
+
+uint32_t ReadingHistory::oldestSeq() const {
+    if (_count == 0) return 0;
+    return _nextSeq - _count;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file    reading_history.h
+ * @brief   最近读数的环形历史缓冲 - 支持断线后按序号补发 (replay)
+ * 
+ * 每条读数入库时分配单调递增的序号 (从 1 开始), 缓冲满后覆盖最旧的记录。
+ * 有 PSRAM 时使用 PSRAM, 否则退化为较小的 SRAM 缓冲。
+ * 仅在通讯任务中访问, 不需要加锁。
+ */
+
+#ifndef READING_HISTORY_H
+#define READING_HISTORY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "core/sensor_types.h"
+
+class ReadingHistory {
+public:
+    ReadingHistory();
+    
+    /**
+     * @brief 分配缓冲区
+     * @return 实际容量 (条), 0 表示分配失败 (此时仍会分配序号, 但无法补发)
+     */
+    size_t begin();
+    
+    /**
+     * @brief 为读数分配序号并存入历史
+     * @param reading 读数, seq 字段会被填充
+     */
+    void append(SensorReading& reading);
+    
+    /**
+     * @brief 按序号取出历史读数
+     * @return false 序号已被覆盖或尚未产生
+     */
+    bool get(uint32_t seq, SensorReading& out) const;
+    
+    /**
+     * @brief 仍在缓冲中的最旧序号 (无数据时为 0)
+     */
+    uint32_t oldestSeq() const;
+    
+    /**
+     * @brief 最新分配的序号 (无数据时为 0)
+     */
+    uint32_t latestSeq() const { return _nextSeq - 1; }
+    
+    size_t capacity() const { return _capacity; }
+    
+private:
+    SensorReadingWire* _buf;
+    size_t _capacity;
+    size_t _count;          // 已存条数 (<= _capacity)
+    uint32_t _nextSeq;
+};
+
+#endif
@@ -4,26 +4,101 @@
  */
 
 #include "analog_array.h"
+#include "../utils.h"
+#include <esp_timer.h>
+#include <rom/ets_sys.h>
 
 // ADS1256 寄存器和命令
+#define ADS1256_CMD_WAKEUP  0x00
 #define ADS1256_CMD_RDATA   0x01
 #define ADS1256_CMD_WREG    0x50
+#define ADS1256_CMD_SELFCAL 0xF0
+#define ADS1256_CMD_SYNC    0xFC
+#define ADS1256_CMD_RESET   0xFE
+#define ADS1256_REG_STATUS  0x00
 #define ADS1256_REG_MUX     0x01
+#define ADS1256_REG_ADCON   0x02
+#define ADS1256_REG_DRATE   0x03
 #define ADS1256_SPI_SPEED   1000000
 
+// 连续转换模式: SCLK 上限为 fCLKIN / 4 (7.68 MHz 晶振)
+#define ADS1256_SPI_SPEED_FAST  1920000
+#define ADS1256_STATUS_ACAL     0x04    // PGA/DRATE 修改后自动自校准
+#define ADS1256_MUX_AINCOM      0x08
+#define ADS1256_T6_US           7       // RDATA 命令到读数据 (50 tCLKIN)
+#define ADS1256_T11_SYNC_US     4       // SYNC 到 WAKEUP (24 tCLKIN)
+#define ADS1256_CAL_TIMEOUT_MS  1000    // 2.5 SPS 下自校准约 800 ms
+
+// ADC 任务与采集任务同核, 优先级更高: DRDY 后尽快切换 MUX, 不被读数搬运推迟
+#define ADC_TASK_CORE       1
+#define ADC_TASK_PRIORITY   6
+#define ADC_TASK_STACK      3072
+
 // MCP3208 命令
 #define MCP3208_START_BIT   0x04
 #define MCP3208_SINGLE_END  0x02
 #define MCP3208_SPI_SPEED   1000000
 
-AnalogSensorArray::AnalogSensorArray(AdcType type, uint8_t csPin, uint8_t channelCount)
+namespace {
+
+// ADS1256 数据速率档位 (SPS -> DRATE 寄存器值), 降序
+struct Ads1256Rate {
+    uint16_t sps;
+    uint8_t  code;
+};
+
+const Ads1256Rate ADS1256_RATES[] = {
+    {30000, 0xF0}, {15000, 0xE0}, {7500, 0xD0}, {3750, 0xC0},
+    {2000, 0xB0}, {1000, 0xA1}, {500, 0x92}, {100, 0x82},
+    {60, 0x72}, {50, 0x63}, {30, 0x53}, {25, 0x43},
+    {15, 0x33}, {10, 0x23}, {5, 0x13}, {2, 0x03},  // 2 即 2.5 SPS
+};
+
+// 取不超过请求值的最高档
+const Ads1256Rate& ads1256Rate(uint16_t sps) {
+    for (const auto& r : ADS1256_RATES) {
+        if (r.sps <= sps) return r;
+    }
+    return ADS1256_RATES[sizeof(ADS1256_RATES) / sizeof(ADS1256_RATES[0]) - 1];
+}
+
+// 增益 1-64 -> ADCON PGA 位 (log2), 非 2 的幂向下取整
+uint8_t ads1256PgaBits(uint8_t gain) {
+    uint8_t bits = 0;
+    while (bits < 6 && (2u << bits) <= gain) {
+        bits++;
+    }
+    return bits;
+}
+
+} // namespace
+
+AnalogSensorArray::AnalogSensorArray(AdcType type, uint8_t csPin, uint8_t channelCount, int8_t drdyPin)
     : _adcType(type)
     , _csPin(csPin)
     , _channelCount(min(channelCount, (uint8_t)8))
+    , _drdyPin(drdyPin)
     , _vref(3.3f)
     , _sampleIntervalMs(10)
     , _nextChannel(0)
     , _initialized(false)
+    , _continuous(false)
+    , _dataRate(7500)
+    , _gain(1)
+    , _spiHost(VSPI_HOST)
+    , _sckPin(SCK)
+    , _misoPin(MISO)
+    , _mosiPin(MOSI)
+    , _spiDev(nullptr)
+    , _adcTask(nullptr)
+    , _streaming(false)
+    , _seqMask(0)
+    , _seqChannel(0)
+    , _drdyUs(0)
+    , _pending{}
+    , _hasPending(false)
+    , _overflows(0)
+    , _drdyTimeouts(0)
 {
     for (uint8_t i = 0; i < 8; i++) {
         _channels[i].lastReadTime = 0;
@@ -33,20 +108,29 @@ AnalogSensorArray::AnalogSensorArray(AdcType type, uint8_t csPin, uint8_t channe
 }
 
 SensorError AnalogSensorArray::init() {
+    // 重复 init: 先停下连续转换, 之后按当前配置重新编程
+    stopSequencer();
+    
     pinMode(_csPin, OUTPUT);
     digitalWrite(_csPin, HIGH);
     
-    SPI.begin();
-    
     // ADC 特定初始化
     switch (_adcType) {
         case AdcType::ADS1256:
-            // ADS1256 初始化: 设置数据速率等
-            // 简化实现，实际可能需要更多配置
+            if (_drdyPin >= 0) {
+                SensorError err = initAds1256Continuous();
+                if (err != SensorError::OK) {
+                    return err;
+                }
+                _continuous = true;
+            } else {
+                SPI.begin();
+            }
             break;
-            
+        
         case AdcType::MCP3208:
             // MCP3208 无需特殊初始化
+            SPI.begin();
             break;
     }
     
@@ -54,6 +138,255 @@ SensorError AnalogSensorArray::init() {
     return SensorError::OK;
 }
 
+// ============================================================================
+// ADS1256 连续转换模式
+// ============================================================================
+
+SensorError AnalogSensorArray::initAds1256Continuous() {
+    pinMode(_drdyPin, INPUT);
+    
+    if (_spiDev == nullptr) {
+        // 独占 SPI 主机, 不再经过 Arduino SPI 库
+        spi_bus_config_t bus = {};
+        bus.mosi_io_num = _mosiPin;
+        bus.miso_io_num = _misoPin;
+        bus.sclk_io_num = _sckPin;
+        bus.quadwp_io_num = -1;
+        bus.quadhd_io_num = -1;
+        bus.max_transfer_sz = 32;
+        esp_err_t err = spi_bus_initialize(_spiHost, &bus, SPI_DMA_CH_AUTO);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            return SensorError::DRIVER_ERROR;
+        }
+        
+        spi_device_interface_config_t dev = {};
+        dev.mode = 1;                       // CPOL = 0, CPHA = 1
+        dev.clock_speed_hz = ADS1256_SPI_SPEED_FAST;
+        dev.spics_io_num = _csPin;
+        dev.queue_size = 1;
+        if (spi_bus_add_device(_spiHost, &dev, &_spiDev) != ESP_OK) {
+            _spiDev = nullptr;
+            return SensorError::DRIVER_ERROR;
+        }
+    }
+    
+    if (_adcTask == nullptr) {
+        xTaskCreatePinnedToCore(adcTaskEntry, "adc", ADC_TASK_STACK, this,
+                                ADC_TASK_PRIORITY, &_adcTask, ADC_TASK_CORE);
+    }
+    
+    return programAds1256();
+}
+
+SensorError AnalogSensorArray::programAds1256() {
+    const Ads1256Rate& rate = ads1256Rate(_dataRate);
+    _dataRate = rate.sps;
+    uint8_t pga = ads1256PgaBits(_gain);
+    _gain = 1 << pga;
+    
+    spi_device_acquire_bus(_spiDev, portMAX_DELAY);
+    
+    uint8_t reset = ADS1256_CMD_RESET;
+    adsCommand(&reset, 1, false);
+    if (!waitDrdy(DRDY_TIMEOUT_MS)) {
+        spi_device_release_bus(_spiDev);
+        return SensorError::COMMUNICATION_ERROR;   // 芯片不在或未上电
+    }
+    
+    // STATUS, MUX, ADCON (关闭 CLKOUT), DRATE 连续写入
+    WORD_ALIGNED_ATTR uint8_t regs[6] = {
+        ADS1256_CMD_WREG | ADS1256_REG_STATUS, 0x03,
+        ADS1256_STATUS_ACAL,
+        ADS1256_MUX_AINCOM,
+        pga,
+        rate.code,
+    };
+    adsCommand(regs, sizeof(regs), false);
+    
+    uint8_t cal = ADS1256_CMD_SELFCAL;
+    adsCommand(&cal, 1, false);
+    bool ok = waitDrdy(ADS1256_CAL_TIMEOUT_MS);
+    
+    spi_device_release_bus(_spiDev);
+    return ok ? SensorError::OK : SensorError::TIMEOUT;
+}
+
+void AnalogSensorArray::startSequencer() {
+    if (!_continuous || _seqMask == 0) return;
+    
+    // 丢弃停止期间残留的样本 (此时 ADC 任务不会写入)
+    AdcSample stale;
+    while (_samples.pop(stale)) {}
+    _hasPending = false;
+    
+    _seqChannel = nextSeqChannel(7);    // 位图中的第一个通道
+    
+    spi_device_acquire_bus(_spiDev, portMAX_DELAY);
+    WORD_ALIGNED_ATTR uint8_t mux[4] = {
+        ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00,
+        (uint8_t)((_seqChannel << 4) | ADS1256_MUX_AINCOM),
+        ADS1256_CMD_SYNC,
+    };
+    adsCommand(mux, sizeof(mux), true);
+    ets_delay_us(ADS1256_T11_SYNC_US);
+    uint8_t wakeup = ADS1256_CMD_WAKEUP;
+    adsCommand(&wakeup, 1, false);
+    spi_device_release_bus(_spiDev);
+    
+    ulTaskNotifyTake(pdTRUE, 0);
+    _streaming = true;
+    attachInterruptArg(digitalPinToInterrupt(_drdyPin), onDrdy, this, FALLING);
+}
+
+void AnalogSensorArray::stopSequencer() {
+    if (!_continuous || !_streaming) return;
+    
+    _streaming = false;
+    detachInterrupt(digitalPinToInterrupt(_drdyPin));
+    // 等 ADC 任务中进行中的一次读取结束
+    spi_device_acquire_bus(_spiDev, portMAX_DELAY);
+    spi_device_release_bus(_spiDev);
+}
+
+uint8_t AnalogSensorArray::nextSeqChannel(uint8_t ch) const {
+    for (uint8_t i = 1; i <= 8; i++) {
+        uint8_t next = (ch + i) & 0x07;
+        if (_seqMask & (1u << next)) return next;
+    }
+    return ch;
+}
+
+void IRAM_ATTR AnalogSensorArray::onDrdy(void* arg) {
+    AnalogSensorArray* self = static_cast<AnalogSensorArray*>(arg);
+    self->_drdyUs = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->_adcTask, &woken);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void AnalogSensorArray::adcTaskEntry(void* arg) {
+    AnalogSensorArray* self = static_cast<AnalogSensorArray*>(arg);
+    
+    for (;;) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DRDY_TIMEOUT_MS)) == 0) {
+            if (self->_streaming) {
+                self->_drdyTimeouts.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        self->serviceDrdy();
+    }
+}
+
+/**
+ * 一次 DRDY: 切到下一通道并重启转换, 然后读出刚完成的结果.
+ * WAKEUP 之后数据寄存器仍保存上一次转换, 因此切换 MUX 与读数可以合并在同一次 CS 内
+ */
+void AnalogSensorArray::serviceDrdy() {
+    uint64_t tick = _drdyUs / 1000;
+    
+    spi_device_acquire_bus(_spiDev, portMAX_DELAY);
+    if (!_streaming) {
+        spi_device_release_bus(_spiDev);
+        return;
+    }
+    
+    uint8_t done = _seqChannel;
+    uint8_t next = nextSeqChannel(done);
+    if (next != done) {
+        WORD_ALIGNED_ATTR uint8_t mux[4] = {
+            ADS1256_CMD_WREG | ADS1256_REG_MUX, 0x00,
+            (uint8_t)((next << 4) | ADS1256_MUX_AINCOM),
+            ADS1256_CMD_SYNC,
+        };
+        adsCommand(mux, sizeof(mux), true);
+        ets_delay_us(ADS1256_T11_SYNC_US);
+        uint8_t cmds[2] = {ADS1256_CMD_WAKEUP, ADS1256_CMD_RDATA};
+        adsCommand(cmds, sizeof(cmds), true);
+    } else {
+        // 单通道无需切换, 芯片按 DRATE 连续转换
+        uint8_t rdata = ADS1256_CMD_RDATA;
+        adsCommand(&rdata, 1, true);
+    }
+    ets_delay_us(ADS1256_T6_US);
+    uint32_t raw = adsRead24();
+    spi_device_release_bus(_spiDev);
+    
+    _seqChannel = next;
+    
+    AdcSample sample;
+    sample.tick_ms = tick;
+    sample.raw = (raw & 0x800000) ? (int32_t)(raw | 0xFF000000) : (int32_t)raw;
+    sample.channel = done;
+    if (!_samples.push(sample)) {
+        _overflows.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool AnalogSensorArray::waitDrdy(uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (digitalRead(_drdyPin) == HIGH) {
+        if (millis() - start >= timeoutMs) return false;
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// 总线已由调用方 acquire; 每笔都很短, 轮询传输比排队 + 中断的开销小
+void AnalogSensorArray::adsCommand(const uint8_t* tx, size_t len, bool keepCs) {
+    spi_transaction_t t = {};
+    t.length = len * 8;
+    if (len <= 4) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, tx, len);
+    } else {
+        t.tx_buffer = tx;
+    }
+    if (keepCs) {
+        t.flags |= SPI_TRANS_CS_KEEP_ACTIVE;
+    }
+    spi_device_polling_transmit(_spiDev, &t);
+}
+
+uint32_t AnalogSensorArray::adsRead24() {
+    spi_transaction_t t = {};
+    t.length = 24;
+    t.rxlength = 24;
+    t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+    spi_device_polling_transmit(_spiDev, &t);
+    return ((uint32_t)t.rx_data[0] << 16) | ((uint32_t)t.rx_data[1] << 8) | t.rx_data[2];
+}
+
+// 满量程 ±2·VREF / PGA
+float AnalogSensorArray::rawToVolts(int32_t raw) const {
+    return (raw / 8388607.0f) * (2.0f * _vref / _gain);
+}
+
+void AnalogSensorArray::setSpiBus(spi_host_device_t host, int8_t sck, int8_t miso, int8_t mosi) {
+    if (_spiDev != nullptr) return;     // 已初始化的总线不再更换
+    _spiHost = host;
+    _sckPin = sck;
+    _misoPin = miso;
+    _mosiPin = mosi;
+}
+
+void AnalogSensorArray::setStreaming(bool on, uint32_t sensorMask) {
+    if (!_continuous) return;
+    
+    stopSequencer();
+    if (on) {
+        uint8_t all = (uint8_t)((1u << _channelCount) - 1);
+        _seqMask = (sensorMask == 0) ? all : (uint8_t)(sensorMask & all);
+        startSequencer();
+    }
+}
+
+// ============================================================================
+// 轮询模式
+// ============================================================================
+
 void AnalogSensorArray::spiBeginTransaction() {
     uint32_t speed = (_adcType == AdcType::ADS1256) ? ADS1256_SPI_SPEED : MCP3208_SPI_SPEED;
     SPI.beginTransaction(SPISettings(speed, MSBFIRST, SPI_MODE1));
@@ -135,6 +468,12 @@ float AnalogSensorArray::readAdcChannel(uint8_t channel) {
 uint8_t AnalogSensorArray::getNextReadySensor() {
     if (!_initialized) return 0xFF;
     
+    if (_continuous) {
+        // 上一条未被 readSensor 取走 (通道不活跃) 就丢弃, 取下一条
+        _hasPending = _samples.pop(_pending);
+        return _hasPending ? _pending.channel : 0xFF;
+    }
+    
     uint32_t now = millis();
     
     // 轮询找下一个可读通道
@@ -149,15 +488,43 @@ uint8_t AnalogSensorArray::getNextReadySensor() {
     return 0xFF;
 }
 
+uint64_t AnalogSensorArray::getNextDueTime() const {
+    if (!_initialized) return NO_DEADLINE;
+    
+    if (_continuous) {
+        AdcSample next;
+        return _samples.peek(next) ? next.tick_ms : NO_DEADLINE;
+    }
+    
+    uint64_t now = utils::getTickMs();
+    uint32_t remaining = _sampleIntervalMs;
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        uint32_t elapsed = (uint32_t)now - _channels[i].lastReadTime;
+        if (elapsed >= _sampleIntervalMs) return now;
+        remaining = min(remaining, _sampleIntervalMs - elapsed);
+    }
+    return now + remaining;
+}
+
 bool AnalogSensorArray::readSensor(uint8_t idx, SensorReading& out) {
     if (!_initialized || idx >= _channelCount) {
         return false;
     }
     
-    uint32_t now = millis();
-    
-    // 读取 ADC
-    float voltage = readAdcChannel(idx);
+    uint32_t now;
+    float voltage;
+    if (_continuous) {
+        if (!_hasPending || _pending.channel != idx) {
+            return false;
+        }
+        _hasPending = false;
+        now = (uint32_t)_pending.tick_ms;
+        voltage = rawToVolts(_pending.raw);
+    } else {
+        now = (uint32_t)utils::getTickMs();
+        // 读取 ADC
+        voltage = readAdcChannel(idx);
+    }
     
     // 填充输出
     out.tick_ms = now;
@@ -181,7 +548,21 @@ bool AnalogSensorArray::readSensor(uint8_t idx, SensorReading& out) {
 
 SensorError AnalogSensorArray::configure(const SensorConfig& config) {
     _vref = config.adc_vref;
-    // 可扩展更多配置
+    _dataRate = config.adc_sample_rate;
+    _gain = config.adc_gain;
+    
+    // 已在连续模式下运行: 停下重新编程, 采集中则按原通道位图恢复
+    if (_continuous) {
+        bool wasStreaming = _streaming;
+        stopSequencer();
+        SensorError err = programAds1256();
+        if (err != SensorError::OK) {
+            return err;
+        }
+        if (wasStreaming) {
+            startSequencer();
+        }
+    }
     return SensorError::OK;
 }
 
@@ -5,6 +5,10 @@
  * 支持多种 ADC 芯片:
  * - ADS1256: 24-bit, 8通道
  * - MCP3208: 12-bit, 8通道
+ * 
+ * ADS1256 接了 DRDY 时工作在连续转换模式: DRDY 下降沿中断唤醒 ADC 任务,
+ * 任务切换 MUX 到下一通道并读出刚完成的转换 (数据手册 "Cycling the Multiplexer"),
+ * 结果写入内部队列, 采集任务经 getNextReadySensor/readSensor 取走送入采集环形队列
  */
 
 #ifndef ANALOG_ARRAY_H
@@ -12,7 +16,10 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include <atomic>
+#include <driver/spi_master.h>
 #include "../core/sensor_array.h"
+#include "../core/spsc_ring.h"
 
 /**
  * @brief 支持的 ADC 芯片类型
@@ -34,8 +41,9 @@ public:
      * @param type ADC 芯片类型
      * @param csPin SPI 片选引脚
      * @param channelCount 通道数量 (1-8)
+     * @param drdyPin ADS1256 DRDY 引脚, -1 表示轮询模式
      */
-    AnalogSensorArray(AdcType type, uint8_t csPin, uint8_t channelCount);
+    AnalogSensorArray(AdcType type, uint8_t csPin, uint8_t channelCount, int8_t drdyPin = -1);
     
     // ISensorArray 接口实现
     SensorError init() override;
@@ -43,17 +51,34 @@ public:
     SensorType getSensorType() const override { return SensorType::MOX_ANALOG; }
     bool readSensor(uint8_t idx, SensorReading& out) override;
     uint8_t getNextReadySensor() override;
+    uint64_t getNextDueTime() const override;
     SensorError configure(const SensorConfig& config) override;
+    void setStreaming(bool on, uint32_t sensorMask) override;
     uint32_t getSensorId(uint8_t idx) const override;
     
     // 模拟传感器特有配置
     void setReferenceVoltage(float vref) { _vref = vref; }
+    float getReferenceVoltage() const { return _vref; }
     void setSampleInterval(uint32_t intervalMs) { _sampleIntervalMs = intervalMs; }
     
+    /**
+     * @brief 连续模式使用的 SPI 主机与引脚 (init 之前调用)
+     * 
+     * 默认 VSPI + Arduino 默认引脚; 与 BME688 (Arduino SPI 库占用 VSPI) 同板时改用 HSPI
+     */
+    void setSpiBus(spi_host_device_t host, int8_t sck, int8_t miso, int8_t mosi);
+    
+    bool isContinuous() const { return _continuous; }
+    uint16_t getDataRate() const { return _dataRate; }
+    uint8_t getGain() const { return _gain; }
+    uint32_t getOverflowCount() const { return _overflows.load(std::memory_order_relaxed); }
+    uint32_t getDrdyTimeoutCount() const { return _drdyTimeouts.load(std::memory_order_relaxed); }
+
 private:
     AdcType _adcType;
     uint8_t _csPin;
     uint8_t _channelCount;
+    int8_t _drdyPin;
     float _vref;
     uint32_t _sampleIntervalMs;
     
@@ -68,7 +93,54 @@ private:
     uint8_t _nextChannel;
     bool _initialized;
     
-    // ADC 读取实现
+    // ---- ADS1256 连续转换模式 ----
+    
+    // ADC 任务 -> 采集任务, 一条对应一次 DRDY
+    struct AdcSample {
+        uint64_t tick_ms;       // DRDY 时刻
+        int32_t  raw;           // 24-bit 有符号
+        uint8_t  channel;
+    };
+    static constexpr size_t SAMPLE_RING_SIZE = 256;
+    static constexpr uint32_t DRDY_TIMEOUT_MS = 100;
+    
+    bool _continuous;
+    uint16_t _dataRate;         // SPS, 已取整到芯片支持的档位
+    uint8_t _gain;              // PGA 增益 1-64
+    spi_host_device_t _spiHost;
+    int8_t _sckPin;
+    int8_t _misoPin;
+    int8_t _mosiPin;
+    spi_device_handle_t _spiDev;
+    TaskHandle_t _adcTask;
+    
+    std::atomic<bool> _streaming;
+    uint8_t _seqMask;           // 轮转的通道位图, 仅在停止时修改
+    uint8_t _seqChannel;        // 当前 MUX 指向的通道 (ADC 任务)
+    volatile uint64_t _drdyUs;  // 最近一次 DRDY 的设备时间
+    
+    SpscRing<AdcSample, SAMPLE_RING_SIZE> _samples;
+    AdcSample _pending;         // getNextReadySensor 取出、等待 readSensor 的样本
+    bool _hasPending;
+    
+    std::atomic<uint32_t> _overflows;
+    std::atomic<uint32_t> _drdyTimeouts;
+    
+    SensorError initAds1256Continuous();
+    SensorError programAds1256();
+    void startSequencer();
+    void stopSequencer();
+    void serviceDrdy();
+    uint8_t nextSeqChannel(uint8_t ch) const;
+    bool waitDrdy(uint32_t timeoutMs);
+    void adsCommand(const uint8_t* tx, size_t len, bool keepCs);
+    uint32_t adsRead24();
+    float rawToVolts(int32_t raw) const;
+    
+    static void IRAM_ATTR onDrdy(void* arg);
+    static void adcTaskEntry(void* arg);
+    
+    // ADC 读取实现 (轮询模式)
     float readAds1256(uint8_t channel);
     float readMcp3208(uint8_t channel);
     float readAdcChannel(uint8_t channel);
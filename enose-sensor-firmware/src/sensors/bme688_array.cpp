@@ -4,16 +4,20 @@
  */
 
 #include "bme688_array.h"
+#include "../loop_profiler.h"
 #include "../utils.h"
 
-BME688Array::BME688Array() {
+BME688Array::BME688Array()
+    : _activeMask((1UL << BME688_NUM_SENSORS) - 1), _syncTick(0), _resyncPending(true),
+      _resyncCount(0), _burstHead(0), _burstCount(0) {
     for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
         _state[i].id = 0;
         _state[i].wakeUpTime = 0;
         _state[i].nextGasIndex = 0;
         _state[i].mode = BME68X_SLEEP_MODE;
         _state[i].configured = false;
-        _state[i].heaterLength = 10;
+        _state[i].heater.length = 10;
+        _state[i].pendingState = PendingState::NONE;
     }
 }
 
@@ -63,9 +67,10 @@ void BME688Array::setDefaultHeaterProfile(uint8_t idx) {
     uint16_t defaultTemps[10] = {320, 100, 100, 100, 200, 200, 200, 320, 320, 320};
     uint16_t defaultDurs[10]  = {5, 2, 10, 30, 5, 5, 5, 5, 5, 5};
     
-    memcpy(_state[idx].heaterTemps, defaultTemps, sizeof(defaultTemps));
-    memcpy(_state[idx].heaterDurations, defaultDurs, sizeof(defaultDurs));
-    _state[idx].heaterLength = 10;
+    memcpy(_state[idx].heater.temps, defaultTemps, sizeof(defaultTemps));
+    memcpy(_state[idx].heater.durations, defaultDurs, sizeof(defaultDurs));
+    _state[idx].heater.length = 10;
+    _state[idx].pendingState = PendingState::NONE;
 }
 
 int8_t BME688Array::configureSensorHeater(uint8_t idx) {
@@ -81,10 +86,10 @@ int8_t BME688Array::configureSensorHeater(uint8_t idx) {
     
     // 设置加热器配置
     _sensors[idx].setHeaterProf(
-        _state[idx].heaterTemps,
-        _state[idx].heaterDurations,
+        _state[idx].heater.temps,
+        _state[idx].heater.durations,
         sharedHeatrDur,
-        _state[idx].heaterLength
+        _state[idx].heater.length
     );
     
     return _sensors[idx].status;
@@ -95,11 +100,28 @@ SensorError BME688Array::configure(const SensorConfig& config) {
     if (idx >= BME688_NUM_SENSORS) {
         return SensorError::INVALID_INDEX;
     }
+    if (config.heater_length == 0 || config.heater_length > HEATER_PROFILE_MAX) {
+        return SensorError::CONFIG_ERROR;
+    }
+    
+    HeaterProfile profile;
+    memcpy(profile.temps, config.heater_temps, sizeof(profile.temps));
+    memcpy(profile.durations, config.heater_durations, sizeof(profile.durations));
+    profile.length = config.heater_length;
     
-    // 更新加热器配置
-    memcpy(_state[idx].heaterTemps, config.heater_temps, sizeof(_state[idx].heaterTemps));
-    memcpy(_state[idx].heaterDurations, config.heater_durations, sizeof(_state[idx].heaterDurations));
-    _state[idx].heaterLength = config.heater_length;
+    if (config.heater_staged) {
+        // 只写入后备缓冲, 芯片与进行中的周期不受影响, 由 commitStaged 提交
+        _state[idx].pending = profile;
+        _state[idx].pendingState = PendingState::STAGED;
+        return SensorError::OK;
+    }
+    
+    _state[idx].pendingState = PendingState::NONE;
+    return restartWithProfile(idx, profile);
+}
+
+SensorError BME688Array::restartWithProfile(uint8_t idx, const HeaterProfile& profile) {
+    _state[idx].heater = profile;
     
     // 重置状态 - 必须重置所有相关字段才能让传感器重新开始采集
     _state[idx].nextGasIndex = 0;
@@ -116,6 +138,53 @@ SensorError BME688Array::configure(const SensorConfig& config) {
     return SensorError::OK;
 }
 
+void BME688Array::commitStaged(uint32_t sensorMask) {
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+        SensorState& state = _state[i];
+        if (state.pendingState != PendingState::STAGED) continue;
+        if (sensorMask != 0 && !(sensorMask & (1UL << i))) continue;
+        
+        if (state.configured && isActive(i) && state.mode == BME68X_PARALLEL_MODE) {
+            // 正在循环: 等 readSensor 走到周期边界再切换
+            state.pendingState = PendingState::ARMED;
+        } else {
+            // 没有在采集的周期可保留, 直接生效
+            state.pendingState = PendingState::NONE;
+            restartWithProfile(i, state.pending);
+        }
+    }
+}
+
+bool BME688Array::applyPendingProfile(uint8_t idx) {
+    SensorState& state = _state[idx];
+    state.pendingState = PendingState::NONE;
+    state.heater = state.pending;
+    
+    // setHeaterProf 会把芯片切回睡眠模式, 调用方随后恢复并行模式, 新周期从第 0 步开始
+    if (configureSensorHeater(idx) != BME68X_OK) {
+        // 写入失败: 按旧流程从睡眠模式重新唤醒
+        state.mode = BME68X_SLEEP_MODE;
+        state.wakeUpTime = 0;
+        return false;
+    }
+    return true;
+}
+
+bool BME688Array::switchAtCycleBoundary(uint8_t idx, uint64_t timeStamp) {
+    SensorState& state = _state[idx];
+    if (state.pendingState != PendingState::ARMED) {
+        return false;
+    }
+    if (!applyPendingProfile(idx)) {
+        return true;
+    }
+    _sensors[idx].setOpMode(BME68X_PARALLEL_MODE);
+    state.mode = BME68X_PARALLEL_MODE;
+    state.nextGasIndex = 0;
+    state.wakeUpTime = timeStamp + BME688_GAS_WAIT_SHARED;
+    return true;
+}
+
 bool BME688Array::isConfigured(uint8_t idx) const {
     if (idx >= BME688_NUM_SENSORS) return false;
     return _state[idx].configured;
@@ -129,7 +198,7 @@ uint32_t BME688Array::getSensorId(uint8_t idx) const {
 bool BME688Array::selectNextSensor(uint64_t& wakeUpTime, uint8_t& idx, uint8_t mode) {
     idx = 0xFF;
     for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
-        if ((_state[i].mode == mode) && (_state[i].wakeUpTime < wakeUpTime)) {
+        if (isActive(i) && (_state[i].mode == mode) && (_state[i].wakeUpTime < wakeUpTime)) {
             wakeUpTime = _state[i].wakeUpTime;
             idx = i;
         }
@@ -138,6 +207,18 @@ bool BME688Array::selectNextSensor(uint64_t& wakeUpTime, uint8_t& idx, uint8_t m
 }
 
 uint8_t BME688Array::getNextReadySensor() {
+    #if BME688_SYNC_SCHEDULE
+    // 上一节拍的读数交完之后才开始下一个节拍的突发读取
+    if (_burstHead >= _burstCount) {
+        uint64_t now = utils::getTickMs();
+        if (now < _syncTick) {
+            return 0xFF;
+        }
+        ProfileScope scope(ProfilePoint::SYNC_BURST);
+        runSyncBurst(now);
+    }
+    return (_burstHead < _burstCount) ? _burst[_burstHead].sensor_idx : 0xFF;
+    #else
     uint8_t idx;
     uint64_t wakeUpTime = utils::getTickMs() + 20;
     
@@ -146,6 +227,127 @@ uint8_t BME688Array::getNextReadySensor() {
         return idx;
     }
     return 0xFF;
+    #endif
+}
+
+uint64_t BME688Array::getNextDueTime() const {
+    #if BME688_SYNC_SCHEDULE
+    if (_burstHead < _burstCount) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+        if (isStreamable(i)) {
+            return _syncTick;
+        }
+    }
+    return NO_DEADLINE;
+    #else
+    uint64_t due = NO_DEADLINE;
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+        if (isActive(i) && _state[i].configured && _state[i].wakeUpTime < due) {
+            due = _state[i].wakeUpTime;
+        }
+    }
+    return due;
+    #endif
+}
+
+void BME688Array::setStreaming(bool on, uint32_t sensorMask) {
+    uint32_t all = (1UL << BME688_NUM_SENSORS) - 1;
+    // 停止时恢复全部, 与 start 未带列表时一致
+    _activeMask = (!on || sensorMask == 0) ? all : (sensorMask & all);
+    
+    // 同步调度: 每次开始采集都让活跃传感器从同一时刻重新开始周期
+    _burstHead = _burstCount = 0;
+    _resyncPending = true;
+    _syncTick = 0;
+    
+    // 停止采集后不会再走到周期边界, 已提交的暂存配置直接生效
+    if (!on) {
+        for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+            if (_state[i].pendingState == PendingState::ARMED) {
+                _state[i].pendingState = PendingState::NONE;
+                restartWithProfile(i, _state[i].pending);
+            }
+        }
+    }
+}
+
+void BME688Array::triggerAll(uint64_t now) {
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+        if (!isStreamable(i)) continue;
+        // 从任意模式切到并行模式都会先进入睡眠, 加热序列从第 0 步重新开始
+        _sensors[i].setOpMode(BME68X_PARALLEL_MODE);
+        _state[i].mode = BME68X_PARALLEL_MODE;
+        _state[i].nextGasIndex = 0;
+        _state[i].wakeUpTime = now + BME688_GAS_WAIT_SHARED;
+    }
+    _resyncPending = false;
+    _resyncCount++;
+    _syncTick = now + BME688_GAS_WAIT_SHARED + BME688_SYNC_PHASE_MS;
+}
+
+void BME688Array::runSyncBurst(uint64_t now) {
+    _burstHead = _burstCount = 0;
+    
+    // 一次 SPI 事务内依次访问全部传感器, 只切换片选
+    commMuxBurstBegin(SPI);
+    
+    // 刚初始化、立即生效的配置或开始采集: 睡眠中的传感器与其余传感器一起重新触发
+    bool trigger = _resyncPending;
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS && !trigger; i++) {
+        trigger = isStreamable(i) && _state[i].mode == BME68X_SLEEP_MODE;
+    }
+    if (trigger) {
+        triggerAll(now);
+        commMuxBurstEnd(SPI);
+        return;
+    }
+    
+    uint32_t tick = (uint32_t)now;
+    uint8_t ref = 0xFF;
+    bool refWrapped = false;
+    int64_t dueUs = (int64_t)_syncTick * 1000;
+    for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+        if (!isStreamable(i)) continue;
+        // 唤醒偏差: 节拍时刻到读取该传感器的时刻 (含突发中排在前面的传感器)
+        loopProfiler.recordWake(i, (int64_t)utils::getTickUs() - dueUs);
+        bool wrapped = false;
+        if (fetchField(i, tick, _burst[_burstCount], wrapped)) {
+            _burstCount++;
+        }
+        if (ref == 0xFF) {
+            ref = i;
+            refWrapped = wrapped;
+        }
+    }
+    
+    // 参考传感器的周期边界: 换上已提交的暂存配置, 或纠正失步, 都要全部一起重新触发
+    if (refWrapped) {
+        bool resync = false;
+        for (uint8_t i = 0; i < BME688_NUM_SENSORS; i++) {
+            if (!isStreamable(i)) continue;
+            if (_state[i].pendingState == PendingState::ARMED) {
+                applyPendingProfile(i);
+                resync = true;
+            } else if (_state[i].heater.length == _state[ref].heater.length &&
+                       _state[i].nextGasIndex != _state[ref].nextGasIndex) {
+                resync = true;
+            }
+        }
+        if (resync) {
+            triggerAll(now);
+            commMuxBurstEnd(SPI);
+            return;
+        }
+    }
+    commMuxBurstEnd(SPI);
+    
+    // 按节拍累加, 处理耽误的节拍直接跳过
+    _syncTick += BME688_GAS_WAIT_SHARED;
+    if (_syncTick <= now) {
+        _syncTick = now + BME688_GAS_WAIT_SHARED;
+    }
 }
 
 bool BME688Array::readSensor(uint8_t idx, SensorReading& out) {
@@ -153,6 +355,14 @@ bool BME688Array::readSensor(uint8_t idx, SensorReading& out) {
         return false;
     }
     
+    #if BME688_SYNC_SCHEDULE
+    // 交出本节拍突发读出的读数 (按 getNextReadySensor 给出的顺序)
+    if (_burstHead >= _burstCount || _burst[_burstHead].sensor_idx != idx) {
+        return false;
+    }
+    out = _burst[_burstHead++];
+    return true;
+    #else
     SensorState& state = _state[idx];
     uint64_t timeStamp = utils::getTickMs();
     
@@ -169,8 +379,25 @@ bool BME688Array::readSensor(uint8_t idx, SensorReading& out) {
         return false;
     }
     
+    loopProfiler.recordWake(idx, (int64_t)utils::getTickUs() - (int64_t)state.wakeUpTime * 1000);
+    bool wrapped = false;
+    bool got = fetchField(idx, (uint32_t)timeStamp, out, wrapped);
+    // 周期边界 (本条为最后一步, 或最后一步丢失而已回绕): 换上已提交的暂存配置
+    if (got && wrapped) {
+        switchAtCycleBoundary(idx, timeStamp);
+    }
+    return got;
+    #endif
+}
+
+bool BME688Array::fetchField(uint8_t idx, uint32_t tick, SensorReading& out, bool& wrapped) {
+    SensorState& state = _state[idx];
+    uint64_t timeStamp = utils::getTickMs();
+    
     // 读取数据
+    uint32_t fetchStart = LoopProfiler::cycles();
     uint8_t nFields = _sensors[idx].fetchData();
+    loopProfiler.record(ProfilePoint::SPI_FETCH, LoopProfiler::cycles() - fetchStart);
     bme68x_data* sensorData = _sensors[idx].getAllData();
     
     for (int k = 0; k < 3; k++) {
@@ -184,18 +411,19 @@ bool BME688Array::readSensor(uint8_t idx, SensorReading& out) {
             int16_t deltaIndex = (int16_t)_fieldData[i].gas_index - (int16_t)state.nextGasIndex;
             
             // 处理回绕：如果 gas_index 回绕到 0，deltaIndex 会是负数
-            // 此时将其调整为正值（相对于 heaterLength 的回绕距离）
+            // 此时将其调整为正值（相对于 heater.length 的回绕距离）
+            wrapped = deltaIndex < 0;
             if (deltaIndex < 0) {
-                deltaIndex += state.heaterLength;
+                deltaIndex += state.heater.length;
             }
             
             // 跳过明显不匹配的数据（允许一定的滞后）
-            if (deltaIndex < 0 || deltaIndex >= state.heaterLength) {
+            if (deltaIndex < 0 || deltaIndex >= state.heater.length) {
                 continue;
             }
             
             // 填充输出结构
-            out.tick_ms = (uint32_t)millis();
+            out.tick_ms = tick;     // 64 位时钟的低 32 位, 上位机借 sync 还原
             out.sensor_idx = idx;
             out.sensor_id = state.id;
             out.primary_value = _fieldData[i].gas_resistance;
@@ -208,16 +436,17 @@ bool BME688Array::readSensor(uint8_t idx, SensorReading& out) {
             
             // 更新状态
             state.nextGasIndex = _fieldData[i].gas_index + 1;
-            if (state.nextGasIndex >= state.heaterLength) {
+            if (state.nextGasIndex >= state.heater.length) {
                 state.nextGasIndex = 0;
+                wrapped = true;
             }
             state.wakeUpTime = timeStamp + BME688_GAS_WAIT_SHARED;
-            
             return true;
         }
     }
     
     // 无有效数据，更新等待时间
+    wrapped = false;
     state.wakeUpTime = timeStamp + BME688_GAS_WAIT_SHARED;
     return false;
 }
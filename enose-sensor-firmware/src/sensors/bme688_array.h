@@ -13,6 +13,7 @@
 #include <SPI.h>
 #include <Wire.h>
 #include <bme68xLibrary.h>
+#include "../config.h"
 #include "../core/sensor_array.h"
 #include "../commMux.h"
 
@@ -21,10 +22,22 @@
 #define BME688_HEATER_TIME_BASE 140
 #define BME688_GAS_WAIT_SHARED  UINT8_C(140)
 
+#ifndef BME688_SYNC_SCHEDULE
+#define BME688_SYNC_SCHEDULE    1
+#endif
+// 同步调度的读取相位: 节拍落在两次加热步骤结束之间, 各芯片时钟偏差 ±70 ms 内仍读到同一步
+#define BME688_SYNC_PHASE_MS    (BME688_GAS_WAIT_SHARED / 2)
+
 /**
  * @brief BME688 传感器阵列实现
  * 
  * 实现 ISensorArray 接口，管理 8 个 BME688 传感器
+ * 
+ * 同步调度 (BME688_SYNC_SCHEDULE): 活跃传感器在同一时刻触发并行模式, 加热周期同相.
+ * 每个公共节拍 getNextReadySensor() 在一次 commMux 突发中依次取回全部传感器的数据,
+ * 读数带相同的 tick 暂存, 随后逐条交给 readSensor(), 同一步骤的读数连续入队 (一批一帧).
+ * 参考传感器 (编号最小的活跃传感器) 走完一个周期时检查对齐: 有已提交的暂存配置或
+ * 步数不一致的传感器时, 全部一起重新触发.
  */
 class BME688Array : public ISensorArray {
 public:
@@ -36,9 +49,15 @@ public:
     SensorType getSensorType() const override { return SensorType::MOX_DIGITAL; }
     bool readSensor(uint8_t idx, SensorReading& out) override;
     uint8_t getNextReadySensor() override;
+    uint64_t getNextDueTime() const override;
+    void setStreaming(bool on, uint32_t sensorMask) override;
     SensorError configure(const SensorConfig& config) override;
+    void commitStaged(uint32_t sensorMask) override;
     bool isConfigured(uint8_t idx) const override;
     uint32_t getSensorId(uint8_t idx) const override;
+    
+    /** @brief 同步调度下全部传感器重新触发的次数 (开始采集、配置切换、失步) */
+    uint32_t getResyncCount() const { return _resyncCount; }
 
 private:
     // BME68x 驱动实例
@@ -47,6 +66,16 @@ private:
     // 通信设置
     commMux _commSetup[BME688_NUM_SENSORS];
     
+    // 加热器配置
+    struct HeaterProfile {
+        uint16_t temps[HEATER_PROFILE_MAX];
+        uint16_t durations[HEATER_PROFILE_MAX];
+        uint8_t  length;
+    };
+    
+    // 暂存配置的状态: STAGED 等待提交, ARMED 已提交、在下一个周期边界生效
+    enum class PendingState : uint8_t { NONE, STAGED, ARMED };
+    
     // 传感器状态
     struct SensorState {
         uint32_t id;
@@ -55,20 +84,40 @@ private:
         uint8_t  mode;
         bool     configured;
         
-        // 加热器配置
-        uint16_t heaterTemps[10];
-        uint16_t heaterDurations[10];
-        uint8_t  heaterLength;
+        HeaterProfile heater;       // 芯片上当前生效的配置
+        HeaterProfile pending;      // 双缓冲: 暂存的下一套配置
+        PendingState  pendingState;
     };
     SensorState _state[BME688_NUM_SENSORS];
     
+    // 活跃传感器位图, 调度只在其中挑选 (不活跃的不会被读取, 唤醒时间不会前进)
+    uint32_t _activeMask;
+    
     // 临时数据缓冲
     bme68x_data _fieldData[3];
     
+    // 同步调度: 下一个公共节拍, 以及本节拍突发读出、尚未交出的读数
+    uint64_t _syncTick;
+    bool     _resyncPending;    // 下一节拍先全部重新触发
+    uint32_t _resyncCount;
+    SensorReading _burst[BME688_NUM_SENSORS];
+    uint8_t  _burstHead;
+    uint8_t  _burstCount;
+    
     // 私有方法
     int8_t initializeSensor(uint8_t idx);
     int8_t configureSensorHeater(uint8_t idx);
+    SensorError restartWithProfile(uint8_t idx, const HeaterProfile& profile);
+    bool applyPendingProfile(uint8_t idx);
+    bool switchAtCycleBoundary(uint8_t idx, uint64_t timeStamp);
+    bool fetchField(uint8_t idx, uint32_t tick, SensorReading& out, bool& wrapped);
+    
+    // 同步调度
+    bool isStreamable(uint8_t idx) const { return isActive(idx) && _state[idx].configured; }
+    void runSyncBurst(uint64_t now);
+    void triggerAll(uint64_t now);
     bool selectNextSensor(uint64_t& wakeUpTime, uint8_t& idx, uint8_t mode);
+    bool isActive(uint8_t idx) const { return _activeMask & (1UL << idx); }
     
     // 默认加热器配置
     void setDefaultHeaterProfile(uint8_t idx);
@@ -0,0 +1,172 @@
+/**
+ * @file    composite_array.cpp
+ * @brief   组合传感器阵列实现
+ */
+
+#include "composite_array.h"
+#include "../utils.h"
+
+CompositeSensorArray::CompositeSensorArray()
+    : _slotCount(0)
+    , _sensorCount(0)
+    , _lastServed(0)
+{
+    for (uint8_t i = 0; i < COMPOSITE_MAX_ARRAYS; i++) {
+        _slots[i].array = nullptr;
+        _slots[i].base = 0;
+        _slots[i].count = 0;
+    }
+}
+
+bool CompositeSensorArray::addArray(ISensorArray* array) {
+    if (array == nullptr || _slotCount >= COMPOSITE_MAX_ARRAYS) {
+        return false;
+    }
+    uint8_t count = array->getSensorCount();
+    if (_sensorCount + count > 32) {
+        return false;
+    }
+    
+    _slots[_slotCount].array = array;
+    _slots[_slotCount].base = _sensorCount;
+    _slots[_slotCount].count = count;
+    _slotCount++;
+    _sensorCount += count;
+    return true;
+}
+
+bool CompositeSensorArray::locate(uint8_t idx, uint8_t& slot, uint8_t& local) const {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        if (idx >= _slots[i].base && idx < _slots[i].base + _slots[i].count) {
+            slot = i;
+            local = idx - _slots[i].base;
+            return true;
+        }
+    }
+    return false;
+}
+
+ISensorArray* CompositeSensorArray::arrayFor(uint8_t idx) const {
+    uint8_t slot, local;
+    return locate(idx, slot, local) ? _slots[slot].array : nullptr;
+}
+
+uint8_t CompositeSensorArray::baseIndexOf(const ISensorArray* array) const {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        if (_slots[i].array == array) return _slots[i].base;
+    }
+    return 0xFF;
+}
+
+SensorError CompositeSensorArray::init() {
+    if (_slotCount == 0) {
+        return SensorError::NOT_INITIALIZED;
+    }
+    
+    // 全部子阵列都尝试初始化, 返回第一个错误
+    SensorError result = SensorError::OK;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        SensorError err = _slots[i].array->init();
+        if (err != SensorError::OK && result == SensorError::OK) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+uint64_t CompositeSensorArray::getNextDueTime() const {
+    uint64_t due = NO_DEADLINE;
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        uint64_t d = _slots[i].array->getNextDueTime();
+        if (d < due) due = d;
+    }
+    return due;
+}
+
+uint8_t CompositeSensorArray::getNextReadySensor() {
+    uint64_t horizon = utils::getTickMs() + LOOKAHEAD_MS;
+    
+    // 按截止时间排序; 相同时从上次服务的下一个子阵列开始轮转
+    uint8_t order[COMPOSITE_MAX_ARRAYS];
+    uint64_t due[COMPOSITE_MAX_ARRAYS];
+    for (uint8_t n = 0; n < _slotCount; n++) {
+        uint8_t i = (_lastServed + 1 + n) % _slotCount;
+        uint64_t d = _slots[i].array->getNextDueTime();
+        uint8_t pos = n;
+        while (pos > 0 && due[pos - 1] > d) {
+            order[pos] = order[pos - 1];
+            due[pos] = due[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+        due[pos] = d;
+    }
+    
+    // 依次询问到期的子阵列, 没有可读的就问下一个
+    for (uint8_t n = 0; n < _slotCount; n++) {
+        if (due[n] == NO_DEADLINE || due[n] > horizon) {
+            break;
+        }
+        const Slot& s = _slots[order[n]];
+        uint8_t local = s.array->getNextReadySensor();
+        if (local != 0xFF && local < s.count) {
+            _lastServed = order[n];
+            return s.base + local;
+        }
+    }
+    return 0xFF;
+}
+
+bool CompositeSensorArray::readSensor(uint8_t idx, SensorReading& out) {
+    uint8_t slot, local;
+    if (!locate(idx, slot, local)) {
+        return false;
+    }
+    if (!_slots[slot].array->readSensor(local, out)) {
+        return false;
+    }
+    out.sensor_idx = idx;   // 子阵列填的是局部索引
+    return true;
+}
+
+SensorError CompositeSensorArray::configure(const SensorConfig& config) {
+    uint8_t slot, local;
+    if (!locate(config.sensor_idx, slot, local)) {
+        return SensorError::INVALID_INDEX;
+    }
+    SensorConfig forwarded = config;
+    forwarded.sensor_idx = local;
+    return _slots[slot].array->configure(forwarded);
+}
+
+void CompositeSensorArray::commitStaged(uint32_t sensorMask) {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        const Slot& s = _slots[i];
+        uint32_t all = (s.count >= 32) ? UINT32_MAX : ((1UL << s.count) - 1);
+        uint32_t local = (sensorMask >> s.base) & all;
+        if (sensorMask == 0 || local != 0) {
+            s.array->commitStaged(sensorMask == 0 ? 0 : local);
+        }
+    }
+}
+
+void CompositeSensorArray::setStreaming(bool on, uint32_t sensorMask) {
+    for (uint8_t i = 0; i < _slotCount; i++) {
+        const Slot& s = _slots[i];
+        uint32_t all = (s.count >= 32) ? UINT32_MAX : ((1UL << s.count) - 1);
+        uint32_t local = (sensorMask >> s.base) & all;
+        // 指定了位图但没有选中这个子阵列: 让它停着
+        bool active = on && (sensorMask == 0 || local != 0);
+        s.array->setStreaming(active, active ? local : 0);
+    }
+}
+
+bool CompositeSensorArray::isConfigured(uint8_t idx) const {
+    uint8_t slot, local;
+    return locate(idx, slot, local) && _slots[slot].array->isConfigured(local);
+}
+
+uint32_t CompositeSensorArray::getSensorId(uint8_t idx) const {
+    uint8_t slot, local;
+    return locate(idx, slot, local) ? _slots[slot].array->getSensorId(local) : 0;
+}
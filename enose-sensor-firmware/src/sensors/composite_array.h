@@ -0,0 +1,71 @@
+/**
+ * @file    composite_array.h
+ * @brief   组合传感器阵列: 一块板上的多种 ISensorArray 共用一条串口
+ *
+ * 子阵列按添加顺序连续编号: 第一个子阵列占 0..n0-1, 第二个占 n0..n0+n1-1, 以此类推.
+ * 调度按各子阵列的 getNextDueTime() 取最早到期者 (EDF), 截止时间相同时轮流,
+ * 连续转换的 ADC 不会因为总有样本而饿死 BME688, 反之亦然
+ */
+
+#ifndef COMPOSITE_ARRAY_H
+#define COMPOSITE_ARRAY_H
+
+#include <Arduino.h>
+#include "../core/sensor_array.h"
+
+// 子阵列上限
+#define COMPOSITE_MAX_ARRAYS    4
+
+/**
+ * @brief 组合传感器阵列实现
+ */
+class CompositeSensorArray : public ISensorArray {
+public:
+    CompositeSensorArray();
+    
+    /**
+     * @brief 添加子阵列 (setup 中、init 之前调用)
+     * @return false 子阵列已满或总传感器数超过 32 (活跃位图宽度)
+     */
+    bool addArray(ISensorArray* array);
+    
+    // ISensorArray 接口实现
+    SensorError init() override;
+    uint8_t getSensorCount() const override { return _sensorCount; }
+    SensorType getSensorType() const override { return SensorType::UNKNOWN; }  // 混合, 以每条读数的 type 为准
+    bool readSensor(uint8_t idx, SensorReading& out) override;
+    uint8_t getNextReadySensor() override;
+    uint64_t getNextDueTime() const override;
+    SensorError configure(const SensorConfig& config) override;
+    void commitStaged(uint32_t sensorMask) override;
+    void setStreaming(bool on, uint32_t sensorMask) override;
+    bool isConfigured(uint8_t idx) const override;
+    uint32_t getSensorId(uint8_t idx) const override;
+    
+    /**
+     * @brief 全局索引所属的子阵列
+     * @return 子阵列, nullptr 表示索引无效
+     */
+    ISensorArray* arrayFor(uint8_t idx) const;
+    
+    /** @brief 子阵列第一个传感器的全局索引 */
+    uint8_t baseIndexOf(const ISensorArray* array) const;
+
+private:
+    // 提前量: 与 BME688Array 的唤醒窗口一致, 即将到期的也交给子阵列判断
+    static constexpr uint64_t LOOKAHEAD_MS = 20;
+    
+    struct Slot {
+        ISensorArray* array;
+        uint8_t base;           // 第一个传感器的全局索引
+        uint8_t count;
+    };
+    Slot _slots[COMPOSITE_MAX_ARRAYS];
+    uint8_t _slotCount;
+    uint8_t _sensorCount;
+    uint8_t _lastServed;        // 截止时间相同时从下一个子阵列开始
+    
+    bool locate(uint8_t idx, uint8_t& slot, uint8_t& local) const;
+};
+
+#endif // COMPOSITE_ARRAY_H
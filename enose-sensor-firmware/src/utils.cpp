@@ -4,22 +4,19 @@
  */
 
 #include "utils.h"
-
-uint64_t utils::_tickMs = 0;
-uint64_t utils::_tickOverFlowCnt = 0;
+#include <esp_timer.h>
 
 demoRetCode utils::begin() {
     randomSeed(esp_random());
     return EDK_OK;
 }
 
+uint64_t utils::getTickUs() {
+    return (uint64_t)esp_timer_get_time();
+}
+
 uint64_t utils::getTickMs() {
-    uint64_t timeMs = millis();
-    if (_tickMs > timeMs) {
-        _tickOverFlowCnt++;
-    }
-    _tickMs = timeMs;
-    return timeMs + (_tickOverFlowCnt * UINT64_C(0xFFFFFFFF));
+    return getTickUs() / 1000;
 }
 
 String utils::getMacAddress() {
@@ -10,10 +10,6 @@
 #include "demo_app.h"
 
 class utils {
-private:
-    static uint64_t _tickMs;
-    static uint64_t _tickOverFlowCnt;
-
 public:
     /**
      * @brief 初始化工具模块
@@ -22,8 +18,14 @@ public:
     static demoRetCode begin();
 
     /**
-     * @brief 获取 tick 值 (毫秒)，处理溢出
-     * @return 毫秒时间戳
+     * @brief 64 位设备时间 (微秒, 自启动起, 不回绕)
+     *
+     * 与 millis() 同源 (esp_timer), sync 应答中的 dev_us 和读数的 tick_ms 都取自此时钟
+     */
+    static uint64_t getTickUs();
+
+    /**
+     * @brief 64 位设备时间 (毫秒)
      */
     static uint64_t getTickMs();
 
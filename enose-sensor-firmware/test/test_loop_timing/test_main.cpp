@@ -0,0 +1,203 @@
+/**
+ * @file    test_main.cpp
+ * @brief   数据上报与命令解析的耗时基准 (设备上运行)
+ *
+ * 运行: pio test -e bench
+ * 每项基准重复 BENCH_ITERATIONS 次, 以 CycleHistogram 统计并打印 p50/p99/max (µs) 与每条消息的字节数,
+ * 修改帧格式或 JSON 字段前后各运行一次即可对比。写出的数据进入计数用的空串口, 不含真实的串口阻塞
+ * (串口阻塞见固件的 stats 命令)。
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "cmd_handler.h"
+#include "data_reporter.h"
+#include "frame_codec.h"
+#include "loop_profiler.h"
+
+#define BENCH_ITERATIONS    2000
+
+/**
+ * @brief 空串口: 写入只计数, 读取返回预先放入的命令字节
+ */
+class BenchStream : public Stream {
+public:
+    void feed(const uint8_t* data, size_t len) { _in = data; _inLen = len; _inPos = 0; }
+    size_t written() const { return _written; }
+    void clearWritten() { _written = 0; }
+
+    int available() override { return (int)(_inLen - _inPos); }
+    int read() override { return (_inPos < _inLen) ? _in[_inPos++] : -1; }
+    int peek() override { return (_inPos < _inLen) ? _in[_inPos] : -1; }
+    void flush() override {}
+    size_t write(uint8_t) override { _written++; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { _written += size; return size; }
+
+private:
+    const uint8_t* _in = nullptr;
+    size_t _inLen = 0;
+    size_t _inPos = 0;
+    size_t _written = 0;
+};
+
+static BenchStream sink;
+
+static SensorReading makeReading(uint32_t seq) {
+    SensorReading r;
+    r.seq = seq;
+    r.tick_ms = 1000000 + seq * 140;
+    r.sensor_idx = seq % 8;
+    r.sensor_id = 0x12345678;
+    r.primary_value = 123456.7f + seq;
+    r.temperature = 25.31f;
+    r.humidity = 41.07f;
+    r.pressure = 1013.25f;
+    r.heater_step = seq % 10;
+    r.type = SensorType::MOX_DIGITAL;
+    return r;
+}
+
+static void printSummary(const char* name, const CycleHistogram& h, size_t bytesPerOp) {
+    float usPerCycle = 1.0f / getCpuFrequencyMhz();
+    char line[160];
+    snprintf(line, sizeof(line), "%-18s n=%u p50=%.2fus p99=%.2fus max=%.2fus bytes=%u",
+             name, (unsigned)h.count(), h.quantile(0.50f) * usPerCycle, h.quantile(0.99f) * usPerCycle,
+             h.max() * usPerCycle, (unsigned)bytesPerOp);
+    TEST_MESSAGE(line);
+}
+
+void test_histogram_buckets() {
+    // 每个值落在上界不小于它、且前一个桶上界小于它的桶中
+    const uint32_t values[] = {0, 1, 3, 4, 7, 8, 9, 1000, 65535, 65536, 0x80000000UL, UINT32_MAX};
+    for (uint32_t v : values) {
+        uint8_t b = CycleHistogram::bucketOf(v);
+        TEST_ASSERT_LESS_THAN(CycleHistogram::BUCKETS, b);
+        TEST_ASSERT_TRUE(v <= CycleHistogram::bucketUpper(b));
+        if (b > 0) {
+            TEST_ASSERT_TRUE(v > CycleHistogram::bucketUpper(b - 1));
+        }
+    }
+
+    CycleHistogram h;
+    for (uint32_t i = 1; i <= 100; i++) h.record(i * 100);
+    TEST_ASSERT_EQUAL_UINT32(100, h.count());
+    TEST_ASSERT_EQUAL_UINT32(100, h.min());
+    TEST_ASSERT_EQUAL_UINT32(10000, h.max());
+    // 对数分桶的相对误差 < 25%
+    TEST_ASSERT_UINT32_WITHIN(1250, 5000, h.quantile(0.50f));
+    h.requestReset();
+    TEST_ASSERT_EQUAL_UINT32(0, h.count());
+}
+
+void test_encode_reading_binary() {
+    CycleHistogram h;
+    uint8_t frame[FRAME_READING_MAX_LEN];
+    size_t len = 0;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        SensorReading r = makeReading(i + 1);
+        uint32_t start = LoopProfiler::cycles();
+        len = FrameCodec::encodeReading(r, frame);
+        h.record(LoopProfiler::cycles() - start);
+    }
+    TEST_ASSERT_TRUE(len > 0 && len <= FRAME_READING_MAX_LEN);
+    printSummary("encode_reading", h, len);
+}
+
+void test_encode_batch_binary() {
+    CycleHistogram h;
+    SensorReading batch[DATA_BATCH_MAX];
+    uint8_t frame[FRAME_BATCH_MAX_LEN];
+    size_t len = 0;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        for (uint8_t k = 0; k < DATA_BATCH_MAX; k++) {
+            batch[k] = makeReading(i * DATA_BATCH_MAX + k + 1);
+            batch[k].heater_step = 0;
+        }
+        uint32_t start = LoopProfiler::cycles();
+        len = FrameCodec::encodeBatch(batch, DATA_BATCH_MAX, frame);
+        h.record(LoopProfiler::cycles() - start);
+    }
+    TEST_ASSERT_TRUE(len > 0 && len <= FRAME_BATCH_MAX_LEN);
+    printSummary("encode_batch(8)", h, len);
+}
+
+static void benchReport(const char* name, OutputFormat format, uint8_t batchSize) {
+    DataReporter reporter;
+    reporter.begin(sink);
+    reporter.setFormat(format);
+    reporter.setBatchSize(batchSize);
+    sink.clearWritten();
+
+    // 整条上报路径: 建文档/编码 + 写出 (空串口)
+    CycleHistogram h;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        SensorReading r = makeReading(i + 1);
+        r.heater_step = 0;
+        uint32_t start = LoopProfiler::cycles();
+        reporter.report(r);
+        h.record(LoopProfiler::cycles() - start);
+    }
+    reporter.flush();
+    TEST_ASSERT_TRUE(sink.written() > 0);
+    printSummary(name, h, sink.written() / BENCH_ITERATIONS);
+}
+
+void test_report_json() {
+    benchReport("report_json", OutputFormat::JSON, 0);
+}
+
+void test_report_binary() {
+    benchReport("report_bin", OutputFormat::BINARY, 0);
+}
+
+void test_report_binary_batch() {
+    benchReport("report_bin_batch8", OutputFormat::BINARY, DATA_BATCH_MAX);
+}
+
+void test_parse_sync_command() {
+    static const char line[] = "{\"cmd\":\"sync\",\"id\":1,\"params\":{\"t\":81234567890,\"format\":\"bin\",\"batch\":8}}\n";
+    static CmdHandler handler;  // 两块接收缓冲 + 命令文档, 约 3 KB
+    handler.begin(sink);
+
+    // 接收 + 原地解析 + 应答序列化
+    CycleHistogram h;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        sink.feed((const uint8_t*)line, sizeof(line) - 1);
+        uint32_t start = LoopProfiler::cycles();
+        bool handled = handler.process();
+        h.record(LoopProfiler::cycles() - start);
+        TEST_ASSERT_TRUE(handled);
+    }
+    TEST_ASSERT_EQUAL((int)OutputFormat::BINARY, (int)handler.getOutputFormat());
+    printSummary("cmd_sync", h, sizeof(line) - 1);
+}
+
+void test_profiler_overhead() {
+    // 插桩本身的开销: 一次 ProfileScope
+    CycleHistogram h;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        uint32_t start = LoopProfiler::cycles();
+        {
+            ProfileScope scope(ProfilePoint::SERIAL_TX);
+        }
+        h.record(LoopProfiler::cycles() - start);
+    }
+    printSummary("profile_scope", h, 0);
+}
+
+void setup() {
+    // 等待串口监视器连接
+    delay(2000);
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_encode_reading_binary);
+    RUN_TEST(test_encode_batch_binary);
+    RUN_TEST(test_report_json);
+    RUN_TEST(test_report_binary);
+    RUN_TEST(test_report_binary_batch);
+    RUN_TEST(test_parse_sync_command);
+    RUN_TEST(test_profiler_overhead);
+    UNITY_END();
+}
+
+void loop() {}
@@ -1,8 +1,10 @@
-# E-Nose Klipper Plugin v2.0
-# 提供蠕动泵的异步停止功能
+# E-Nose Klipper Plugin v2.1
+# 提供蠕动泵的异步停止和按重量闭环定量功能
 #
 # 命令:
 # - ENOSE_ASYNC_STOP: 立即停止所有泵（绕过 G-code 队列，~1秒延迟）
+# - ENOSE_DISPENSE PUMP=<泵> TARGET=<g>: 按称重闭环定量 (先快后慢)
+# - ENOSE_DISPENSE_CANCEL: 取消进行中的定量
 # - ENOSE_STATUS: 报告插件状态
 #
 # 用法: 在 printer.cfg 中添加 [enose_control]
@@ -12,9 +14,25 @@
 # - 重置 motion_queuing 时间变量阻止后续步进生成
 # - 清空 trapq 并取消 GCODE_AXIS 注册
 # - 禁用电机
+#
+# 定量:
+# - 在 reactor 定时器内直接读取 load_cell 对象的读数 (add_client 批量回调), 不经 Moonraker
+# - 泵以 manual_stepper 短段运动推进, 步进队列最多提前排入 QUEUE_HORIZON 秒,
+#   到达目标时已排入的运动有界, 过冲可预测
+# - 剩余量大于 slowdown 时以 coarse_speed 快速进液, 之后线性减速到 fine_speed
+# - 预测量 (已称得 + 队列中运动和 flow_lag 内泵出的量) 达到目标后停止排入, 等待读数稳定 (SETTLE_TIME);
+#   仍不足 tolerance 时继续以 fine_speed 补液
+# - 进度和结果通过 get_status() 的 dispense 字段推送 (Moonraker 订阅 enose_control)
 
+import collections
 import logging
 
+DISPENSE_TICK = 0.05        # 控制周期 (s)
+QUEUE_HORIZON = 0.2         # 步进队列最多提前排入的运动时长 (s)
+SEGMENT_TIME = 0.1          # 每段运动时长 (s)
+SETTLE_TIME = 0.5           # 停止排入后等待液体落入、读数稳定 (s)
+WEIGHT_WINDOW = 0.1         # 当前重量取最近该时长内读数的平均 (s)
+
 class EnoseControl:
     def __init__(self, config):
         self.printer = config.get_printer()
@@ -28,6 +46,26 @@ class EnoseControl:
         # 停止请求标志（用于异步停止）
         self._stop_requested = False
         
+        # 定量参数默认值 (ENOSE_DISPENSE 参数可覆盖)
+        self.load_cell_name = config.get('load_cell', 'my_hx711')
+        self.invert_reading = config.getboolean('invert_reading', True)
+        self.dispense_coarse_speed = config.getfloat('dispense_coarse_speed', 20., above=0.)
+        self.dispense_fine_speed = config.getfloat('dispense_fine_speed', 2., above=0.)
+        self.dispense_slowdown = config.getfloat('dispense_slowdown', 5., minval=0.)
+        self.dispense_tolerance = config.getfloat('dispense_tolerance', 0.2, above=0.)
+        self.dispense_timeout = config.getfloat('dispense_timeout', 120., above=0.)
+        self.dispense_mm_per_g = config.getfloat('dispense_mm_per_g', 24.75, above=0.)
+        # 泵出的液体经管路落入瓶中、再经称重读数反映出来的延迟 (s)
+        self.dispense_flow_lag = config.getfloat('dispense_flow_lag', 0.2, minval=0.)
+        
+        self._load_cell = None
+        self._weight_samples = collections.deque(maxlen=256)   # (print_time, force_g)
+        self._dispense = None           # 进行中的定量 (内部状态)
+        self._dispense_status = {'state': 'idle'}
+        self._dispense_timer = None
+        self._dispense_id = 0
+        self.printer.register_event_handler('klippy:ready', self._handle_ready)
+        
         # 注册 G-code 命令
         self.gcode.register_command(
             'ENOSE_ASYNC_STOP',
@@ -39,18 +77,43 @@ class EnoseControl:
             self.cmd_status,
             desc="Report E-Nose plugin status")
         
+        self.gcode.register_command(
+            'ENOSE_DISPENSE',
+            self.cmd_dispense,
+            desc="Closed-loop dispense by load cell weight")
+        
+        self.gcode.register_command(
+            'ENOSE_DISPENSE_CANCEL',
+            self.cmd_dispense_cancel,
+            desc="Cancel the running dispense")
+        
         # 注册 webhook endpoint
         webhooks = self.printer.lookup_object('webhooks')
         webhooks.register_endpoint('enose/async_stop', self._handle_async_stop_webhook)
         webhooks.register_endpoint('enose/status', self._handle_status_webhook)
         
-        logging.info("EnoseControl: Plugin v2.0 loaded, pumps: %s", self.pump_names)
-        logging.info("EnoseControl: Commands: ENOSE_ASYNC_STOP, ENOSE_STATUS")
+        logging.info("EnoseControl: Plugin v2.1 loaded, pumps: %s", self.pump_names)
+        logging.info("EnoseControl: Commands: ENOSE_ASYNC_STOP, ENOSE_DISPENSE, "
+                     "ENOSE_DISPENSE_CANCEL, ENOSE_STATUS")
+    
+    def _handle_ready(self):
+        # load_cell 是可选的: 没有称重传感器时只有定量不可用
+        self._load_cell = self.printer.lookup_object(
+            'load_cell ' + self.load_cell_name, None)
+        if self._load_cell is None:
+            logging.warning("EnoseControl: load_cell %s not found, ENOSE_DISPENSE disabled",
+                            self.load_cell_name)
+            return
+        if hasattr(self._load_cell, 'add_client'):
+            self._load_cell.add_client(self._on_load_cell_samples)
+    
+    def get_status(self, eventtime):
+        return {'dispense': dict(self._dispense_status)}
     
     def cmd_status(self, gcmd):
         """报告插件状态"""
         # 检查每个泵的状态
-        status_lines = ["E-Nose Control Plugin v2.0"]
+        status_lines = ["E-Nose Control Plugin v2.1"]
         status_lines.append("Configured pumps: %s" % ', '.join(self.pump_names))
         
         toolhead = self.printer.lookup_object('toolhead')
@@ -65,7 +128,8 @@ class EnoseControl:
             except:
                 status_lines.append("  %s: not found" % pump_name)
         
-        status_lines.append("Commands: ENOSE_ASYNC_STOP, ENOSE_STATUS")
+        status_lines.append("Dispense: %s" % self._dispense_status.get('state'))
+        status_lines.append("Commands: ENOSE_ASYNC_STOP, ENOSE_DISPENSE, ENOSE_DISPENSE_CANCEL, ENOSE_STATUS")
         status_lines.append("Webhooks: enose/async_stop, enose/status")
         gcmd.respond_info('\n'.join(status_lines))
     
@@ -75,6 +139,7 @@ class EnoseControl:
         """异步停止：使用 reactor 回调立即执行停止操作"""
         # 设置停止标志
         self._stop_requested = True
+        self._finish_dispense('cancelled', "Stopped by ENOSE_ASYNC_STOP")
         
         # 使用 reactor.register_async_callback() 立即调度停止操作
         # 这与 M112 急停使用相同的机制
@@ -164,12 +229,187 @@ class EnoseControl:
         except Exception as e:
             logging.exception("EnoseControl: _async_stop_callback error: %s", str(e))
     
+    # ========== 按重量闭环定量 ==========
+    
+    def _on_load_cell_samples(self, msg):
+        """load_cell 批量读数回调 (reactor 内), 行格式 [print_time, force_g, counts]"""
+        for sample in msg.get('data', []):
+            self._weight_samples.append((sample[0], sample[1]))
+        return True
+    
+    def _current_weight(self, eventtime):
+        """最近 WEIGHT_WINDOW 内读数的平均 (g, 未校准); 没有读数时返回 None"""
+        samples = self._weight_samples
+        if samples:
+            latest = samples[-1][0]
+            recent = [f for t, f in samples if t >= latest - WEIGHT_WINDOW]
+            force = sum(recent) / len(recent)
+        else:
+            # 旧版 load_cell 没有 add_client, 退回读取状态
+            force = self._load_cell.get_status(eventtime).get('force_g')
+            if force is None:
+                return None
+        return -force if self.invert_reading else force
+    
+    def cmd_dispense(self, gcmd):
+        if self._dispense is not None:
+            raise gcmd.error("ENOSE_DISPENSE: dispense already running on %s"
+                             % self._dispense['pump'])
+        if self._load_cell is None:
+            raise gcmd.error("ENOSE_DISPENSE: load_cell %s not available" % self.load_cell_name)
+        
+        pump = gcmd.get('PUMP')
+        target = gcmd.get_float('TARGET', above=0.)
+        coarse = gcmd.get_float('COARSE_SPEED', self.dispense_coarse_speed, above=0.)
+        fine = gcmd.get_float('FINE_SPEED', self.dispense_fine_speed, above=0., maxval=coarse)
+        slowdown = gcmd.get_float('SLOWDOWN', self.dispense_slowdown, minval=0.)
+        tolerance = gcmd.get_float('TOLERANCE', self.dispense_tolerance, above=0.)
+        timeout = gcmd.get_float('TIMEOUT', self.dispense_timeout, above=0.)
+        mm_per_g = gcmd.get_float('MM_PER_G', self.dispense_mm_per_g, above=0.)
+        flow_lag = gcmd.get_float('FLOW_LAG', self.dispense_flow_lag, minval=0.)
+        # 主机的重量校准斜率: 真实重量变化 = WEIGHT_SCALE * 读数变化
+        weight_scale = gcmd.get_float('WEIGHT_SCALE', 1., above=0.)
+        
+        stepper = self.printer.lookup_object('manual_stepper ' + pump, None)
+        if stepper is None:
+            raise gcmd.error("ENOSE_DISPENSE: unknown pump %s" % pump)
+        if getattr(stepper, 'axis_gcode_id', None) is not None:
+            raise gcmd.error("ENOSE_DISPENSE: %s is registered to GCODE_AXIS" % pump)
+        
+        eventtime = self.reactor.monotonic()
+        baseline = self._current_weight(eventtime)
+        if baseline is None:
+            raise gcmd.error("ENOSE_DISPENSE: no load cell reading")
+        
+        stepper.do_enable(True)
+        self._dispense_id += 1
+        self._dispense = {
+            'pump': pump, 'stepper': stepper, 'target': target,
+            'coarse': coarse, 'fine': fine, 'slowdown': slowdown,
+            'tolerance': tolerance, 'mm_per_g': mm_per_g, 'scale': weight_scale,
+            'flow_lag': flow_lag,
+            'baseline': baseline, 'deadline': eventtime + timeout,
+            'settle_until': None, 'speed': 0., 'moved_mm': 0.,
+        }
+        self._dispense_status = {
+            'state': 'running', 'id': self._dispense_id, 'pump': pump,
+            'target_g': target, 'dispensed_g': 0., 'speed': 0., 'moved_mm': 0.,
+            'message': '',
+        }
+        self._dispense_timer = self.reactor.register_timer(
+            self._dispense_tick, self.reactor.NOW)
+        gcmd.respond_info("ENOSE_DISPENSE: %s target %.2fg started (id %d)"
+                          % (pump, target, self._dispense_id))
+        logging.info("EnoseControl: Dispense %d started: %s target=%.2fg coarse=%.1f fine=%.1f "
+                     "slowdown=%.1fg tolerance=%.2fg", self._dispense_id, pump, target,
+                     coarse, fine, slowdown, tolerance)
+    
+    def cmd_dispense_cancel(self, gcmd):
+        if self._dispense is None:
+            gcmd.respond_info("ENOSE_DISPENSE_CANCEL: no dispense running")
+            return
+        self._finish_dispense('cancelled', "Cancelled")
+        gcmd.respond_info("ENOSE_DISPENSE_CANCEL: cancelled")
+    
+    def _dispense_tick(self, eventtime):
+        d = self._dispense
+        if d is None:
+            return self.reactor.NEVER
+        # G-code 正在执行时不插入运动, 下个周期再试
+        if self.gcode.get_mutex().test():
+            return eventtime + DISPENSE_TICK
+        
+        try:
+            weight = self._current_weight(eventtime)
+            if weight is None:
+                return eventtime + DISPENSE_TICK
+            dispensed = (weight - d['baseline']) * d['scale']
+            stepper = d['stepper']
+            mcu = self.printer.lookup_object('mcu')
+            queued_time = max(0., getattr(stepper, 'next_cmd_time', 0.)
+                              - mcu.estimated_print_time(eventtime))
+            # 尚未反映到读数的量: 队列中的运动, 加上最近 flow_lag 内泵出但未落秤的液体
+            in_flight = (queued_time + d['flow_lag']) * d['speed'] / d['mm_per_g']
+            remaining = d['target'] - dispensed
+            
+            status = self._dispense_status
+            status['dispensed_g'] = round(dispensed, 2)
+            status['moved_mm'] = round(d['moved_mm'], 2)
+            
+            if eventtime >= d['deadline']:
+                self._finish_dispense('failed', "Timeout at %.2fg" % dispensed)
+                return self.reactor.NEVER
+            
+            if remaining - in_flight <= 0.:
+                # 已排入的运动足以到达目标: 停止排入, 等待读数稳定后判定
+                if d['settle_until'] is None:
+                    d['settle_until'] = eventtime + queued_time + d['flow_lag'] + SETTLE_TIME
+                    d['speed'] = 0.
+                    status['state'] = 'settling'
+                    status['speed'] = 0.
+                if eventtime < d['settle_until']:
+                    return eventtime + DISPENSE_TICK
+            elif d['settle_until'] is not None:
+                if eventtime < d['settle_until']:
+                    return eventtime + DISPENSE_TICK
+                if remaining > d['tolerance']:
+                    # 稳定后仍不足: 以 fine 速度补液
+                    d['settle_until'] = None
+                    d['slowdown'] = 0.
+                    status['state'] = 'running'
+            
+            if d['settle_until'] is not None:
+                if remaining < -d['tolerance']:
+                    self._finish_dispense('failed', "Overshoot: %.2fg" % dispensed)
+                else:
+                    self._finish_dispense('done', "Dispensed %.2fg" % dispensed)
+                return self.reactor.NEVER
+            
+            # 先快后慢: 剩余量低于 slowdown 时线性减速到 fine
+            if d['slowdown'] > 0. and remaining < d['slowdown']:
+                ratio = max(remaining, 0.) / d['slowdown']
+                speed = d['fine'] + (d['coarse'] - d['fine']) * ratio
+            elif d['slowdown'] > 0.:
+                speed = d['coarse']
+            else:
+                speed = d['fine']
+            
+            if queued_time < QUEUE_HORIZON:
+                segment = min(speed * SEGMENT_TIME, (remaining - in_flight) * d['mm_per_g'])
+                if segment > 0.001:
+                    pos = stepper.commanded_pos + segment
+                    stepper.do_move(pos, speed, 0., sync=False)
+                    d['moved_mm'] += segment
+                    d['speed'] = speed
+                    status['speed'] = round(speed, 2)
+        except Exception as e:
+            logging.exception("EnoseControl: Dispense tick error")
+            self._finish_dispense('failed', "Error: %s" % str(e))
+            return self.reactor.NEVER
+        return eventtime + DISPENSE_TICK
+    
+    def _finish_dispense(self, state, message):
+        d = self._dispense
+        if d is None:
+            return
+        self._dispense = None
+        if self._dispense_timer is not None:
+            self.reactor.unregister_timer(self._dispense_timer)
+            self._dispense_timer = None
+        self._dispense_status['state'] = state
+        self._dispense_status['speed'] = 0.
+        self._dispense_status['message'] = message
+        logging.info("EnoseControl: Dispense %d %s: %s", self._dispense_status.get('id', 0),
+                     state, message)
+        self.gcode.respond_info("ENOSE_DISPENSE: %s %s: %s" % (d['pump'], state, message))
+    
     # ========== Webhook handlers ==========
     
     def _handle_async_stop_webhook(self, web_request):
         """Webhook: 异步停止 (通过 reactor 回调)"""
         try:
             self._stop_requested = True
+            self._finish_dispense('cancelled', "Stopped by async_stop webhook")
             self.reactor.register_async_callback(self._async_stop_callback)
             web_request.send({'status': 'scheduled', 'message': 'Stop scheduled via reactor'})
             logging.info("EnoseControl: Webhook async_stop scheduled")
@@ -180,8 +420,9 @@ class EnoseControl:
     def _handle_status_webhook(self, web_request):
         """Webhook: 获取状态"""
         status = {
-            'plugin_version': '2.0',
-            'pumps': {}
+            'plugin_version': '2.1',
+            'pumps': {},
+            'dispense': dict(self._dispense_status)
         }
         for pump_name in self.pump_names:
             try: